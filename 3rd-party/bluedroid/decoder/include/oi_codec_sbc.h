@@ -176,6 +176,9 @@ typedef struct {
     OI_BYTE formatByte;
     OI_UINT8 pcmStride;
     OI_UINT8 maxChannels;
+/* BK4BTSTACK_CHANGE START */
+    OI_UINT8 simd;          /**< OI_CODEC_SBC_SIMD_xxx used for the synthesis window, set by DecoderReset */
+/* BK4BTSTACK_CHANGE END */
 } OI_CODEC_SBC_COMMON_CONTEXT;
 
 
@@ -247,6 +250,15 @@ OI_STATUS OI_CODEC_SBC_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT *context,
 OI_STATUS OI_CODEC_mSBC_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT *context,
                                     OI_UINT32 *decoderData,
                                     OI_UINT32 decoderDataBytes);
+
+#define OI_CODEC_SBC_SIMD_NONE  0
+#define OI_CODEC_SBC_SIMD_AVX2  1
+
+/**
+ * Returns the synthesis window implementations usable on this CPU as bitmask (1 << OI_CODEC_SBC_SIMD_xxx).
+ * OI_CODEC_SBC_DecoderReset() selects the best one, it can be overridden by setting context->common.simd.
+ */
+OI_UINT8 OI_CODEC_SBC_GetSimdSupport(void);
 /* BK4BTSTACK_CHANGE END */
 
 /**
@@ -70,6 +70,13 @@ Function prototypes and macro definitions used internally by the codec.
 #ifndef OI_mSBC_SYNCWORD
 #define OI_mSBC_SYNCWORD 0xad
 #endif
+
+/* SIMD synthesis window for 8 subbands. Define SBC_NO_SIMD to only build the C implementation */
+#ifndef SBC_NO_SIMD
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OI_SBC_SYNTH_SIMD_X86
+#endif
+#endif
 /* BK4BTSTACK_CHANGE END */
 
 #ifndef OI_SBC_SYNCWORD
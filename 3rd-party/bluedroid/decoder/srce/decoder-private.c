@@ -73,6 +73,15 @@ INLINE OI_STATUS internal_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT *context,
     context->limitFrameFormat = FALSE;
     OI_SBC_ExpandFrameFields(&context->common.frameInfo);
 
+    /* BK4BTSTACK_CHANGE START */
+    {
+        OI_UINT8 simdSupport = OI_CODEC_SBC_GetSimdSupport();
+        if (simdSupport & (1 << OI_CODEC_SBC_SIMD_AVX2)) {
+            context->common.simd = OI_CODEC_SBC_SIMD_AVX2;
+        }
+    }
+    /* BK4BTSTACK_CHANGE END */
+
     /*PLATFORM_DECODER_RESET(context);*/
 
     return OI_OK;
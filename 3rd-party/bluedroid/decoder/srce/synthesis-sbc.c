@@ -256,6 +256,117 @@ typedef void (*SYNTH_FRAME)(OI_CODEC_SBC_DECODER_CONTEXT *context, OI_INT16 *pcm
 #define SYNTH112 SynthWindow112_generated
 #endif
 
+/* BK4BTSTACK_CHANGE START */
+#if defined(OI_SBC_SYNTH_SIMD_X86)
+#include <immintrin.h>
+#endif
+
+#if defined(OI_SBC_SYNTH_SIMD_X86)
+/*
+ * Vectorized SynthWindow80_generated: output k sums the terms of buffer[16*i + 4 + k] (A)
+ * and buffer[16*i + 12 - k] (B) for rows i = 0..4. Coefficients and per-term shifts are
+ * taken from synthesis-8-generated.c, unused terms have a zero coefficient.
+ * Products, shifts and 32 bit sums are the same as in the C version, so the output is identical.
+ */
+static const OI_INT32 synth80_coef[5][2][8] = {
+    { {      0,  -3263, -10385, -16457,  10445,  -8443, -10337,  -6087 },
+      {   8235,  29293,  24995,  19083,      0,  16913,  11167,   9293 } },
+    { { -23167,  -5229,   -309, -23641,  -5297,   -301, -30605,  -2893 },
+      {  26479,  30835,   9161, -29015,      0,   3687,   1917,   1247 } },
+    { { -17397, -27021, -23063, -12889,  22299,  10255,   9553,  18055 },
+      {   9399,  31633,  27561,   6145,      0,  15447,   8317,  23671 } },
+    { {  17397,  17319,   2309,  24211,  10603,   9405,  16383,   1747 },
+      {  26479,  26663,  12705,  23469,      0, -18233,  22117,  11537 } },
+    { {  23167,   4555,   6239,  21223,   9539,  26189,   8603,   8721 },
+      {   8235,  12419,   9251,  26913,      0,   1499,   7543,    685 } }
+};
+static const OI_INT32 synth80_lshift[5][2][8] = {
+    { {      0,      0,      0,      0,      0,      0,      0,      0 },
+      {      0,      0,      0,      0,      0,      0,      0,      0 } },
+    { {      0,      0,      4,      0,      1,      5,      0,      3 },
+      {      0,      0,      0,      0,      0,      1,      2,      3 } },
+    { {      1,      1,      1,      2,      2,      2,      2,      1 },
+      {      3,      1,      1,      3,      0,      2,      3,      2 } },
+    { {      1,      1,      3,      0,      0,      0,      0,      1 },
+      {      0,      0,      0,      0,      0,      0,      0,      0 } },
+    { {      0,      0,      0,      0,      0,      0,      0,      0 },
+      {      0,      0,      0,      0,      0,      0,      0,      1 } }
+};
+static const OI_INT32 synth80_rshift[5][2][8] = {
+    { {      0,      5,      6,      6,      4,      7,      4,      2 },
+      {      3,      5,      5,      5,      0,      5,      4,      3 } },
+    { {      3,      0,      0,      2,      0,      0,      1,      0 },
+      {      2,      3,      3,      4,      0,      0,      0,      0 } },
+    { {      0,      0,      0,      0,      0,      0,      0,      0 },
+      {      0,      0,      0,      0,      0,      0,      0,      0 } },
+    { {      0,      0,      0,      1,      0,      1,      2,      0 },
+      {      2,      2,      1,      2,      0,      3,      4,      1 } },
+    { {      3,      1,      3,      8,      4,      7,      6,      7 },
+      {      3,      4,      4,      6,      0,      1,      3,      0 } }
+};
+
+static void SynthWindow80_store(OI_INT16 *pcm, const OI_INT16 out[8], OI_UINT strideShift)
+{
+    OI_UINT k;
+    for (k = 0; k < 8; k++) {
+        pcm[(uint32_t)(k << strideShift)] = out[k];
+    }
+}
+#endif
+
+#ifdef OI_SBC_SYNTH_SIMD_X86
+__attribute__((target("avx2")))
+static __m256i SynthWindow80_term_avx2(__m256i x, OI_UINT i, OI_UINT ab)
+{
+    x = _mm256_mullo_epi32(x, _mm256_loadu_si256((const __m256i *) synth80_coef[i][ab]));
+    x = _mm256_sllv_epi32(x, _mm256_loadu_si256((const __m256i *) synth80_lshift[i][ab]));
+    return _mm256_srav_epi32(x, _mm256_loadu_si256((const __m256i *) synth80_rshift[i][ab]));
+}
+
+__attribute__((target("avx2")))
+static void SynthWindow80_avx2(OI_INT16 *pcm, SBC_BUFFER_T const * RESTRICT buffer, OI_UINT strideShift)
+{
+    const __m256i reverse = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i sum = _mm256_setzero_si256();
+    __m128i out;
+    OI_INT16 tmp[8];
+    OI_UINT i;
+
+    for (i = 0; i < 5; i++) {
+        __m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) &buffer[16 * i + 4]));
+        __m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) &buffer[16 * i + 5]));
+        b = _mm256_permutevar8x32_epi32(b, reverse);
+        sum = _mm256_add_epi32(sum, SynthWindow80_term_avx2(a, i, 0));
+        sum = _mm256_add_epi32(sum, SynthWindow80_term_avx2(b, i, 1));
+    }
+
+    /* divide by 32768 rounding towards zero, then saturate like CLIP_INT16 */
+    sum = _mm256_add_epi32(sum, _mm256_and_si256(_mm256_srai_epi32(sum, 31), _mm256_set1_epi32(32767)));
+    sum = _mm256_srai_epi32(sum, 15);
+    out = _mm_packs_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+
+    if (strideShift == 0) {
+        _mm_storeu_si128((__m128i *) pcm, out);
+    } else {
+        _mm_storeu_si128((__m128i *) tmp, out);
+        SynthWindow80_store(pcm, tmp, strideShift);
+    }
+}
+#endif
+
+OI_UINT8 OI_CODEC_SBC_GetSimdSupport(void)
+{
+    OI_UINT8 support = 1 << OI_CODEC_SBC_SIMD_NONE;
+#ifdef OI_SBC_SYNTH_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        support |= 1 << OI_CODEC_SBC_SIMD_AVX2;
+    }
+#endif
+    return support;
+}
+/* BK4BTSTACK_CHANGE END */
+
 PRIVATE void OI_SBC_SynthFrame_80(OI_CODEC_SBC_DECODER_CONTEXT *context, OI_INT16 *pcm, OI_UINT blkstart, OI_UINT blkcount);
 PRIVATE void OI_SBC_SynthFrame_80(OI_CODEC_SBC_DECODER_CONTEXT *context, OI_INT16 *pcm, OI_UINT blkstart, OI_UINT blkcount)
 {
@@ -280,6 +391,13 @@ PRIVATE void OI_SBC_SynthFrame_80(OI_CODEC_SBC_DECODER_CONTEXT *context, OI_INT1
 
         for (ch = 0; ch < nrof_channels; ch++) {
             DCT2_8(context->common.filterBuffer[ch] + offset, s);
+            /* BK4BTSTACK_CHANGE START */
+#ifdef OI_SBC_SYNTH_SIMD_X86
+            if (context->common.simd == OI_CODEC_SBC_SIMD_AVX2) {
+                SynthWindow80_avx2(pcm + ch, context->common.filterBuffer[ch] + offset, pcmStrideShift);
+            } else
+#endif
+            /* BK4BTSTACK_CHANGE END */
             SYNTH80(pcm + ch, context->common.filterBuffer[ch] + offset, pcmStrideShift);
             s += 8;
         }
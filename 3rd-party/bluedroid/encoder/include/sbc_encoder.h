@@ -151,6 +151,20 @@
 #define SBC_FOR_EMBEDDED_LINUX FALSE
 #endif
 
+/* BK4BTSTACK_CHANGE START */
+/* Analysis window implementation, selected at runtime by SBC_Encoder_Init based on the CPU features. */
+/* Define SBC_NO_SIMD to only build the C implementation */
+#define SBC_SIMD_NONE   0
+#define SBC_SIMD_SSE2   1
+#define SBC_SIMD_AVX2   2
+
+#if !defined(SBC_NO_SIMD) && (SBC_IPAQ_OPT == TRUE) && (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE) && (SBC_ARM_ASM_OPT == FALSE)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SBC_ENC_SIMD_X86
+#endif
+#endif
+/* BK4BTSTACK_CHANGE END */
+
 /*constants used for index calculation*/
 #define SBC_BLK (SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS)
 
@@ -196,6 +210,16 @@ typedef struct SBC_ENC_PARAMS_TAG
     UINT16 u16PacketLength;
     /* BK4BTSTACK_CHANGE START */
     UINT8  mSBCEnabled;
+    /* analysis filter state and scratch buffers, kept per instance to allow multiple encoders */
+    SINT16 s16EncMaxShiftCounter;
+    SINT16 s16ShiftCounter;
+    SINT32 s32X[ENC_VX_BUFFER_SIZE/2];              /* accessed as SINT16, must be 32 bits aligned */
+    SINT32 s32DCTY[16];
+#if (SBC_JOINT_STE_INCLUDED == TRUE)
+    SINT32 s32LRDiff[SBC_MAX_NUM_OF_BLOCKS];
+    SINT32 s32LRSum[SBC_MAX_NUM_OF_BLOCKS];
+#endif
+    UINT8  u8Simd;                                  /* SBC_SIMD_xxx used for the analysis window, set by SBC_Encoder_Init */
     /* BK4BTSTACK_CHANGE END */
 }SBC_ENC_PARAMS;
 
@@ -205,6 +229,10 @@ extern "C"
 #endif
 SBC_API extern void SBC_Encoder(SBC_ENC_PARAMS *strEncParams);
 SBC_API extern void SBC_Encoder_Init(SBC_ENC_PARAMS *strEncParams);
+/* BK4BTSTACK_CHANGE START */
+/* returns bitmask of supported analysis window implementations: (1 << SBC_SIMD_xxx) */
+SBC_API extern UINT8 SBC_Encoder_GetSimdSupport(void);
+/* BK4BTSTACK_CHANGE END */
 #ifdef __cplusplus
 }
 #endif
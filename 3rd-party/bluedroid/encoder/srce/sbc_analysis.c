@@ -25,6 +25,11 @@
 #include <string.h>
 #include "sbc_encoder.h"
 #include "sbc_enc_func_declare.h"
+/* BK4BTSTACK_CHANGE START */
+#if defined(SBC_ENC_SIMD_X86)
+#include <immintrin.h>
+#endif
+/* BK4BTSTACK_CHANGE END */
 /*#include <math.h>*/
 
 #if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
@@ -156,9 +161,9 @@
 #if (SBC_USE_ARM_PRAGMA==TRUE)
 #pragma arm section zidata = "sbc_s32_analysis_section"
 #endif
-static SINT32   s32DCTY[16]  = {0};
-static SINT32   s32X[ENC_VX_BUFFER_SIZE/2];
-static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
+/* BK4BTSTACK_CHANGE START */
+// s32DCTY, s32X/s16X moved into SBC_ENC_PARAMS
+/* BK4BTSTACK_CHANGE END */
 #if (SBC_USE_ARM_PRAGMA==TRUE)
 #pragma arm section zidata
 #endif
@@ -893,8 +898,190 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 #endif
 #endif
 
-static SINT16 ShiftCounter=0;
-extern SINT16 EncMaxShiftCounter;
+/* BK4BTSTACK_CHANGE START */
+// ShiftCounter and EncMaxShiftCounter moved into SBC_ENC_PARAMS
+/* BK4BTSTACK_CHANGE END */
+
+/* BK4BTSTACK_CHANGE START */
+/* SIMD windowing: DCTY[m] = sum over j of window[j][m] * X[ChOffset + j*2*NumOfSubBands + m]
+ * with the symmetric terms of DCTY[0] and DCTY[NumOfSubBands] folded into the coefficient table.
+ * Uses the same 16x16->32 bit products and 32 bit sums as the C implementation, so results are identical */
+#ifdef SBC_ENC_SIMD_X86
+/* coefficients of row pairs (0,1), (2,3) and (4,-) interleaved to match _mm_unpack*_epi16 / _mm_madd_epi16 */
+static const SINT16 sbc_analysis_window8_pairs[3][32] = {
+    {
+        0, WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_0, WIND_8_SUBBANDS_1_1,
+        WIND_8_SUBBANDS_2_0, WIND_8_SUBBANDS_2_1, WIND_8_SUBBANDS_3_0, WIND_8_SUBBANDS_3_1,
+        WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_5_0, WIND_8_SUBBANDS_5_1,
+        WIND_8_SUBBANDS_6_0, WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_7_1,
+        WIND_8_SUBBANDS_8_0, WIND_8_SUBBANDS_8_1, WIND_8_SUBBANDS_7_4, WIND_8_SUBBANDS_7_3,
+        WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_5_4, WIND_8_SUBBANDS_5_3,
+        WIND_8_SUBBANDS_4_4, WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_3_3,
+        WIND_8_SUBBANDS_2_4, WIND_8_SUBBANDS_2_3, WIND_8_SUBBANDS_1_4, WIND_8_SUBBANDS_1_3
+    },
+    {
+        WIND_8_SUBBANDS_0_2, -WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_2, WIND_8_SUBBANDS_1_3,
+        WIND_8_SUBBANDS_2_2, WIND_8_SUBBANDS_2_3, WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_3_3,
+        WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_5_2, WIND_8_SUBBANDS_5_3,
+        WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_7_3,
+        WIND_8_SUBBANDS_8_2, WIND_8_SUBBANDS_8_1, WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_7_1,
+        WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_5_2, WIND_8_SUBBANDS_5_1,
+        WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_3_1,
+        WIND_8_SUBBANDS_2_2, WIND_8_SUBBANDS_2_1, WIND_8_SUBBANDS_1_2, WIND_8_SUBBANDS_1_1
+    },
+    {
+        -WIND_8_SUBBANDS_0_1, 0, WIND_8_SUBBANDS_1_4, 0,
+        WIND_8_SUBBANDS_2_4, 0, WIND_8_SUBBANDS_3_4, 0,
+        WIND_8_SUBBANDS_4_4, 0, WIND_8_SUBBANDS_5_4, 0,
+        WIND_8_SUBBANDS_6_4, 0, WIND_8_SUBBANDS_7_4, 0,
+        WIND_8_SUBBANDS_8_0, 0, WIND_8_SUBBANDS_7_0, 0,
+        WIND_8_SUBBANDS_6_0, 0, WIND_8_SUBBANDS_5_0, 0,
+        WIND_8_SUBBANDS_4_0, 0, WIND_8_SUBBANDS_3_0, 0,
+        WIND_8_SUBBANDS_2_0, 0, WIND_8_SUBBANDS_1_0, 0
+    }
+};
+static const SINT16 sbc_analysis_window4_pairs[3][16] = {
+    {
+        0, WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_0, WIND_4_SUBBANDS_1_1,
+        WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_3_0, WIND_4_SUBBANDS_3_1,
+        WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_3_3,
+        WIND_4_SUBBANDS_2_4, WIND_4_SUBBANDS_2_3, WIND_4_SUBBANDS_1_4, WIND_4_SUBBANDS_1_3
+    },
+    {
+        WIND_4_SUBBANDS_0_2, -WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_2, WIND_4_SUBBANDS_1_3,
+        WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_2_3, WIND_4_SUBBANDS_3_2, WIND_4_SUBBANDS_3_3,
+        WIND_4_SUBBANDS_4_2, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_2, WIND_4_SUBBANDS_3_1,
+        WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_1_2, WIND_4_SUBBANDS_1_1
+    },
+    {
+        -WIND_4_SUBBANDS_0_1, 0, WIND_4_SUBBANDS_1_4, 0,
+        WIND_4_SUBBANDS_2_4, 0, WIND_4_SUBBANDS_3_4, 0,
+        WIND_4_SUBBANDS_4_0, 0, WIND_4_SUBBANDS_3_0, 0,
+        WIND_4_SUBBANDS_2_0, 0, WIND_4_SUBBANDS_1_0, 0
+    }
+};
+
+__attribute__((target("sse2")))
+static void SbcWindow4Sse2(const SINT16 *ps16X, SINT32 *ps32DCTY)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i x0 = _mm_loadu_si128((const __m128i *) &ps16X[0]);
+    __m128i x1 = _mm_loadu_si128((const __m128i *) &ps16X[8]);
+    __m128i x2 = _mm_loadu_si128((const __m128i *) &ps16X[16]);
+    __m128i x3 = _mm_loadu_si128((const __m128i *) &ps16X[24]);
+    __m128i x4 = _mm_loadu_si128((const __m128i *) &ps16X[32]);
+    __m128i lo, hi;
+
+    lo = _mm_madd_epi16(_mm_unpacklo_epi16(x0, x1), _mm_loadu_si128((const __m128i *) &sbc_analysis_window4_pairs[0][0]));
+    hi = _mm_madd_epi16(_mm_unpackhi_epi16(x0, x1), _mm_loadu_si128((const __m128i *) &sbc_analysis_window4_pairs[0][8]));
+    lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(x2, x3), _mm_loadu_si128((const __m128i *) &sbc_analysis_window4_pairs[1][0])));
+    hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(x2, x3), _mm_loadu_si128((const __m128i *) &sbc_analysis_window4_pairs[1][8])));
+    lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(x4, zero), _mm_loadu_si128((const __m128i *) &sbc_analysis_window4_pairs[2][0])));
+    hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(x4, zero), _mm_loadu_si128((const __m128i *) &sbc_analysis_window4_pairs[2][8])));
+
+    _mm_storeu_si128((__m128i *) &ps32DCTY[0], lo);
+    _mm_storeu_si128((__m128i *) &ps32DCTY[4], hi);
+}
+
+__attribute__((target("sse2")))
+static void SbcWindow8Sse2(const SINT16 *ps16X, SINT32 *ps32DCTY)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int half;
+
+    /* DCTY[0..7] and DCTY[8..15] */
+    for (half = 0; half < 16; half += 8)
+    {
+        __m128i x0 = _mm_loadu_si128((const __m128i *) &ps16X[half]);
+        __m128i x1 = _mm_loadu_si128((const __m128i *) &ps16X[half + 16]);
+        __m128i x2 = _mm_loadu_si128((const __m128i *) &ps16X[half + 32]);
+        __m128i x3 = _mm_loadu_si128((const __m128i *) &ps16X[half + 48]);
+        __m128i x4 = _mm_loadu_si128((const __m128i *) &ps16X[half + 64]);
+        __m128i lo, hi;
+
+        lo = _mm_madd_epi16(_mm_unpacklo_epi16(x0, x1), _mm_loadu_si128((const __m128i *) &sbc_analysis_window8_pairs[0][2*half]));
+        hi = _mm_madd_epi16(_mm_unpackhi_epi16(x0, x1), _mm_loadu_si128((const __m128i *) &sbc_analysis_window8_pairs[0][2*half + 8]));
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(x2, x3), _mm_loadu_si128((const __m128i *) &sbc_analysis_window8_pairs[1][2*half])));
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(x2, x3), _mm_loadu_si128((const __m128i *) &sbc_analysis_window8_pairs[1][2*half + 8])));
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(x4, zero), _mm_loadu_si128((const __m128i *) &sbc_analysis_window8_pairs[2][2*half])));
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(x4, zero), _mm_loadu_si128((const __m128i *) &sbc_analysis_window8_pairs[2][2*half + 8])));
+
+        _mm_storeu_si128((__m128i *) &ps32DCTY[half], lo);
+        _mm_storeu_si128((__m128i *) &ps32DCTY[half + 4], hi);
+    }
+}
+
+/* 256 bit unpack works per 128 bit lane: low half yields DCTY[0..3],[8..11], high half DCTY[4..7],[12..15] */
+__attribute__((target("avx2")))
+static __m256i SbcWindow8Avx2Coeff(int pair, int high)
+{
+    __m256i c0 = _mm256_loadu_si256((const __m256i *) &sbc_analysis_window8_pairs[pair][0]);
+    __m256i c1 = _mm256_loadu_si256((const __m256i *) &sbc_analysis_window8_pairs[pair][16]);
+    return high ? _mm256_permute2x128_si256(c0, c1, 0x31) : _mm256_permute2x128_si256(c0, c1, 0x20);
+}
+
+__attribute__((target("avx2")))
+static void SbcWindow8Avx2(const SINT16 *ps16X, SINT32 *ps32DCTY)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i x0 = _mm256_loadu_si256((const __m256i *) &ps16X[0]);
+    __m256i x1 = _mm256_loadu_si256((const __m256i *) &ps16X[16]);
+    __m256i x2 = _mm256_loadu_si256((const __m256i *) &ps16X[32]);
+    __m256i x3 = _mm256_loadu_si256((const __m256i *) &ps16X[48]);
+    __m256i x4 = _mm256_loadu_si256((const __m256i *) &ps16X[64]);
+    __m256i lo, hi;
+
+    lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(x0, x1), SbcWindow8Avx2Coeff(0, 0));
+    hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(x0, x1), SbcWindow8Avx2Coeff(0, 1));
+    lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(x2, x3), SbcWindow8Avx2Coeff(1, 0)));
+    hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(x2, x3), SbcWindow8Avx2Coeff(1, 1)));
+    lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(x4, zero), SbcWindow8Avx2Coeff(2, 0)));
+    hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(x4, zero), SbcWindow8Avx2Coeff(2, 1)));
+
+    _mm256_storeu_si256((__m256i *) &ps32DCTY[0], _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *) &ps32DCTY[8], _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+#endif
+
+#ifdef SBC_ENC_SIMD_X86
+static void SbcWindow4Simd(UINT8 u8Simd, const SINT16 *ps16X, SINT32 *ps32DCTY)
+{
+    /* AVX2 has no benefit over SSE2 for 8 outputs */
+    (void) u8Simd;
+    SbcWindow4Sse2(ps16X, ps32DCTY);
+}
+
+static void SbcWindow8Simd(UINT8 u8Simd, const SINT16 *ps16X, SINT32 *ps32DCTY)
+{
+    if (u8Simd == SBC_SIMD_AVX2)
+    {
+        SbcWindow8Avx2(ps16X, ps32DCTY);
+    }
+    else
+    {
+        SbcWindow8Sse2(ps16X, ps32DCTY);
+    }
+}
+#endif
+
+UINT8 SBC_Encoder_GetSimdSupport(void)
+{
+    UINT8 u8Support = 1 << SBC_SIMD_NONE;
+#ifdef SBC_ENC_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        u8Support |= 1 << SBC_SIMD_SSE2;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        u8Support |= 1 << SBC_SIMD_AVX2;
+    }
+#endif
+    return u8Support;
+}
+/* BK4BTSTACK_CHANGE END */
+
 /****************************************************************************
 * SbcAnalysisFilter - performs Analysis of the input audio stream
 *
@@ -926,6 +1113,13 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
 #endif
 #endif
 
+    /* BK4BTSTACK_CHANGE START */
+    SINT32 *s32DCTY = pstrEncParams->s32DCTY;
+    SINT16 *s16X = (SINT16*) pstrEncParams->s32X;      /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
+    SINT16 ShiftCounter = pstrEncParams->s16ShiftCounter;
+    SINT16 EncMaxShiftCounter = pstrEncParams->s16EncMaxShiftCounter;
+    /* BK4BTSTACK_CHANGE END */
+
     s32NumOfChannels = pstrEncParams->s16NumOfChannels;
     s32NumOfBlocks   = pstrEncParams->s16NumOfBlocks;
 
@@ -961,6 +1155,15 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
         {
             ChOffset=(s32Ch*Offset2)+Offset;
             
+            /* BK4BTSTACK_CHANGE START */
+#ifdef SBC_ENC_SIMD_X86
+            if (pstrEncParams->u8Simd != SBC_SIMD_NONE)
+            {
+                SbcWindow4Simd(pstrEncParams->u8Simd, &s16X[ChOffset], s32DCTY);
+            }
+            else
+#endif
+            /* BK4BTSTACK_CHANGE END */
             WINDOW_PARTIAL_4
 
             SBC_FastIDCT4(s32DCTY, ps32SbBuf);
@@ -991,6 +1194,9 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
             }
         }
     }
+    /* BK4BTSTACK_CHANGE START */
+    pstrEncParams->s16ShiftCounter = ShiftCounter;
+    /* BK4BTSTACK_CHANGE END */
 }
 
 /* //////////////////////////////////////////////////////////////////////////////////////////////////////////////////// */
@@ -1019,6 +1225,13 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
 #endif
 #endif
 
+    /* BK4BTSTACK_CHANGE START */
+    SINT32 *s32DCTY = pstrEncParams->s32DCTY;
+    SINT16 *s16X = (SINT16*) pstrEncParams->s32X;      /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
+    SINT16 ShiftCounter = pstrEncParams->s16ShiftCounter;
+    SINT16 EncMaxShiftCounter = pstrEncParams->s16EncMaxShiftCounter;
+    /* BK4BTSTACK_CHANGE END */
+
     s32NumOfChannels = pstrEncParams->s16NumOfChannels;
     s32NumOfBlocks   = pstrEncParams->s16NumOfBlocks;
 
@@ -1064,6 +1277,15 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
         {
             ChOffset=(s32Ch*Offset2)+Offset;
 
+            /* BK4BTSTACK_CHANGE START */
+#ifdef SBC_ENC_SIMD_X86
+            if (pstrEncParams->u8Simd != SBC_SIMD_NONE)
+            {
+                SbcWindow8Simd(pstrEncParams->u8Simd, &s16X[ChOffset], s32DCTY);
+            }
+            else
+#endif
+            /* BK4BTSTACK_CHANGE END */
             WINDOW_PARTIAL_8
 
             SBC_FastIDCT8 (s32DCTY, ps32SbBuf);
@@ -1095,10 +1317,30 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
             }
         }
     }
+    /* BK4BTSTACK_CHANGE START */
+    pstrEncParams->s16ShiftCounter = ShiftCounter;
+    /* BK4BTSTACK_CHANGE END */
 }
 
-void SbcAnalysisInit (void)
+/* BK4BTSTACK_CHANGE START */
+void SbcAnalysisInit (SBC_ENC_PARAMS *pstrEncParams)
 {
-    memset(s16X,0,ENC_VX_BUFFER_SIZE*sizeof(SINT16));
-    ShiftCounter=0;
+    memset(pstrEncParams->s32X,0,ENC_VX_BUFFER_SIZE*sizeof(SINT16));
+    memset(pstrEncParams->s32DCTY,0,sizeof(pstrEncParams->s32DCTY));
+    pstrEncParams->s16ShiftCounter=0;
+    pstrEncParams->u8Simd=SBC_SIMD_NONE;
+#if defined(SBC_ENC_SIMD_X86)
+    {
+        UINT8 u8Support = SBC_Encoder_GetSimdSupport();
+        if (u8Support & (1 << SBC_SIMD_AVX2))
+        {
+            pstrEncParams->u8Simd=SBC_SIMD_AVX2;
+        }
+        else if (u8Support & (1 << SBC_SIMD_SSE2))
+        {
+            pstrEncParams->u8Simd=SBC_SIMD_SSE2;
+        }
+    }
+#endif
 }
+/* BK4BTSTACK_CHANGE END */
@@ -80,8 +80,6 @@
 #define AUDIO_TIMEOUT_MS            10 
 #define TABLE_SIZE_441HZ            100
 
-#define SBC_STORAGE_SIZE 1030
-
 typedef enum {
     STREAM_SINE = 0,
     STREAM_MOD,
@@ -102,8 +100,6 @@ typedef struct {
     uint8_t  streaming;
     int      max_media_payload_size;
     
-    uint8_t  sbc_storage[SBC_STORAGE_SIZE];
-    uint16_t sbc_storage_count;
     uint8_t  sbc_ready_to_send;
 
     uint8_t volume;
@@ -186,6 +182,12 @@ static uint8_t device_id_sdp_service_buffer[100];
 static media_codec_configuration_sbc_t sbc_configuration;
 static btstack_sbc_encoder_state_t sbc_encoder_state;
 
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+// negotiated configuration and rate control state to lower bitpool on congested link
+static avdtp_configuration_sbc_t sbc_rate_control_configuration;
+static a2dp_source_rate_control_t sbc_rate_control;
+#endif
+
 static uint8_t media_sbc_codec_configuration[4];
 static a2dp_media_sending_context_t media_tracker;
 
@@ -346,25 +348,12 @@ static void a2dp_demo_hexcmod_configure_sample_rate(int sample_rate){
         }
     }
     current_sample_rate = sample_rate;
-    media_tracker.sbc_storage_count = 0;
     media_tracker.samples_ready = 0;
     hxcmod_unload(&mod_context);
     hxcmod_setcfg(&mod_context, current_sample_rate, 16, 1, 1, 1);
     hxcmod_load(&mod_context, (void *) &mod_data, mod_len);
 }
 
-static void a2dp_demo_send_media_packet(void){
-    int num_bytes_in_frame = btstack_sbc_encoder_sbc_buffer_length();
-    int bytes_in_storage = media_tracker.sbc_storage_count;
-    uint8_t num_frames = bytes_in_storage / num_bytes_in_frame;
-    // Prepend SBC Header
-    media_tracker.sbc_storage[0] = num_frames;  // (fragmentation << 7) | (starting_packet << 6) | (last_packet << 5) | num_frames;
-    avdtp_source_stream_send_media_payload_rtp(media_tracker.a2dp_cid, media_tracker.local_seid, 0, media_tracker.sbc_storage, bytes_in_storage + 1);
-
-    media_tracker.sbc_storage_count = 0;
-    media_tracker.sbc_ready_to_send = 0;
-}
-
 static void produce_sine_audio(int16_t * pcm_buffer, int num_samples_to_write){
     int count;
     for (count = 0; count < num_samples_to_write ; count++){
@@ -418,28 +407,54 @@ static void produce_audio(int16_t * pcm_buffer, int num_samples){
 #endif
 }
 
-static int a2dp_demo_fill_sbc_audio_buffer(a2dp_media_sending_context_t * context){
-    // perform sbc encoding
-    int total_num_bytes_read = 0;
+static int a2dp_demo_num_sbc_frames_per_media_packet(a2dp_media_sending_context_t * context){
+    uint16_t sbc_frame_size = btstack_sbc_encoder_sbc_buffer_length();
+    // frame size is known after first frame was encoded
+    if (sbc_frame_size == 0) return 1;
+    // first byte of media payload is the SBC media payload header
+    int num_frames = (context->max_media_payload_size - 1) / sbc_frame_size;
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+    num_frames = btstack_min(num_frames, a2dp_source_rate_control_get_num_frames(&sbc_rate_control));
+#endif
+    // number of frames field in SBC media payload header has 4 bits
+    return btstack_max(1, btstack_min(num_frames, 15));
+}
+
+static void a2dp_demo_send_media_packet(a2dp_media_sending_context_t * context){
+    uint16_t max_media_payload_size;
+    uint8_t * media_payload = a2dp_source_stream_reserve_media_payload(context->a2dp_cid, context->local_seid, &max_media_payload_size);
+    context->sbc_ready_to_send = 0;
+    if (media_payload == NULL) return;
+
+    // encode SBC frames directly into outgoing buffer after the SBC media payload header
     unsigned int num_audio_samples_per_sbc_buffer = btstack_sbc_encoder_num_audio_frames();
-    while (context->samples_ready >= num_audio_samples_per_sbc_buffer
-        && (context->max_media_payload_size - context->sbc_storage_count) >= btstack_sbc_encoder_sbc_buffer_length()){
+    int num_frames_per_media_packet = a2dp_demo_num_sbc_frames_per_media_packet(context);
+    uint16_t media_payload_size = 1;
+    uint8_t num_frames = 0;
+    while ((num_frames < num_frames_per_media_packet) && (context->samples_ready >= num_audio_samples_per_sbc_buffer)
+        && ((media_payload_size + btstack_sbc_encoder_sbc_buffer_length()) <= max_media_payload_size)){
 
         int16_t pcm_frame[256*NUM_CHANNELS];
 
         produce_audio(pcm_frame, num_audio_samples_per_sbc_buffer);
-        btstack_sbc_encoder_process_data(pcm_frame);
-        
-        uint16_t sbc_frame_size = btstack_sbc_encoder_sbc_buffer_length(); 
-        uint8_t * sbc_frame = btstack_sbc_encoder_sbc_buffer();
-        
-        total_num_bytes_read += num_audio_samples_per_sbc_buffer;
-        // first byte in sbc storage contains sbc media header
-        memcpy(&context->sbc_storage[1 + context->sbc_storage_count], sbc_frame, sbc_frame_size);
-        context->sbc_storage_count += sbc_frame_size;
+        btstack_sbc_encoder_process_data_to_buffer(pcm_frame, &media_payload[media_payload_size]);
+
+        media_payload_size += btstack_sbc_encoder_sbc_buffer_length();
         context->samples_ready -= num_audio_samples_per_sbc_buffer;
+        num_frames++;
     }
-    return total_num_bytes_read;
+
+    // Prepend SBC Header
+    media_payload[0] = num_frames;  // (fragmentation << 7) | (starting_packet << 6) | (last_packet << 5) | num_frames;
+    if (num_frames == 0){
+        media_payload_size = 0;
+    }
+    a2dp_source_stream_send_reserved_media_payload(context->a2dp_cid, context->local_seid, 0, media_payload_size);
+
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+    // apply bitpool from rate control for next media packet
+    btstack_sbc_encoder_set_bitpool(a2dp_source_rate_control_get_bitpool(&sbc_rate_control));
+#endif
 }
 
 static void a2dp_demo_audio_timeout_handler(btstack_timer_source_t * timer){
@@ -465,18 +480,16 @@ static void a2dp_demo_audio_timeout_handler(btstack_timer_source_t * timer){
 
     if (context->sbc_ready_to_send) return;
 
-    a2dp_demo_fill_sbc_audio_buffer(context);
-
-    if ((context->sbc_storage_count + btstack_sbc_encoder_sbc_buffer_length()) > context->max_media_payload_size){
-        // schedule sending
+    uint32_t num_samples_per_media_packet = (uint32_t) (a2dp_demo_num_sbc_frames_per_media_packet(context) * btstack_sbc_encoder_num_audio_frames());
+    if (context->samples_ready >= num_samples_per_media_packet){
+        // schedule sending, SBC frames are encoded when media packet can be sent
         context->sbc_ready_to_send = 1;
         a2dp_source_stream_endpoint_request_can_send_now(context->a2dp_cid, context->local_seid);
     }
 }
 
 static void a2dp_demo_timer_start(a2dp_media_sending_context_t * context){
-    context->max_media_payload_size = btstack_min(a2dp_max_media_payload_size(context->a2dp_cid, context->local_seid), SBC_STORAGE_SIZE);
-    context->sbc_storage_count = 0;
+    context->max_media_payload_size = a2dp_max_media_payload_size(context->a2dp_cid, context->local_seid);
     context->sbc_ready_to_send = 0;
     context->streaming = 1;
     btstack_run_loop_remove_timer(&context->audio_timer);
@@ -491,7 +504,6 @@ static void a2dp_demo_timer_stop(a2dp_media_sending_context_t * context){
     context->acc_num_missed_samples = 0;
     context->samples_ready = 0;
     context->streaming = 1;
-    context->sbc_storage_count = 0;
     context->sbc_ready_to_send = 0;
     btstack_run_loop_remove_timer(&context->audio_timer);
 } 
@@ -606,6 +618,16 @@ static void a2dp_source_packet_handler(uint8_t packet_type, uint16_t channel, ui
             }
             dump_sbc_configuration(&sbc_configuration);
 
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+            sbc_rate_control_configuration.sampling_frequency = sbc_configuration.sampling_frequency;
+            sbc_rate_control_configuration.channel_mode = channel_mode;
+            sbc_rate_control_configuration.block_length = sbc_configuration.block_length;
+            sbc_rate_control_configuration.subbands = sbc_configuration.subbands;
+            sbc_rate_control_configuration.allocation_method = (avdtp_sbc_allocation_method_t) allocation_method;
+            sbc_rate_control_configuration.min_bitpool_value = sbc_configuration.min_bitpool_value;
+            sbc_rate_control_configuration.max_bitpool_value = sbc_configuration.max_bitpool_value;
+#endif
+
             btstack_sbc_encoder_init(&sbc_encoder_state, SBC_MODE_STANDARD, 
                 sbc_configuration.block_length, sbc_configuration.subbands, 
                 sbc_configuration.allocation_method, sbc_configuration.sampling_frequency, 
@@ -673,15 +695,30 @@ static void a2dp_source_packet_handler(uint8_t packet_type, uint16_t channel, ui
                 avrcp_target_set_playback_status(media_tracker.avrcp_cid, AVRCP_PLAYBACK_STATUS_PLAYING);
             }
             a2dp_demo_timer_start(&media_tracker);
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+            btstack_sbc_encoder_set_bitpool(sbc_configuration.max_bitpool_value);
+            a2dp_source_rate_control_start(&sbc_rate_control, cid, local_seid, &sbc_rate_control_configuration);
+#endif
             printf("A2DP Source: Stream started, a2dp_cid 0x%02x, local_seid 0x%02x\n", cid, local_seid);
             break;
 
         case A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW:
             local_seid = a2dp_subevent_streaming_can_send_media_packet_now_get_local_seid(packet);
             cid = a2dp_subevent_signaling_media_codec_sbc_configuration_get_a2dp_cid(packet);
-            a2dp_demo_send_media_packet();
+            a2dp_demo_send_media_packet(&media_tracker);
             break;        
 
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+        case A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE:
+            printf("A2DP Source: Rate control, bitpool %u, num frames %u, congested %u, acl queued %u, can send now latency %u ms\n",
+                a2dp_subevent_streaming_rate_control_update_get_bitpool(packet),
+                a2dp_subevent_streaming_rate_control_update_get_num_frames(packet),
+                a2dp_subevent_streaming_rate_control_update_get_congested(packet),
+                a2dp_subevent_streaming_rate_control_update_get_acl_packets_queued(packet),
+                a2dp_subevent_streaming_rate_control_update_get_can_send_now_latency_ms(packet));
+            break;
+#endif
+
         case A2DP_SUBEVENT_STREAM_SUSPENDED:
             local_seid = a2dp_subevent_stream_suspended_get_local_seid(packet);
             cid = a2dp_subevent_stream_suspended_get_a2dp_cid(packet);
@@ -693,6 +730,9 @@ static void a2dp_source_packet_handler(uint8_t packet_type, uint16_t channel, ui
             printf("A2DP Source: Stream paused, a2dp_cid 0x%02x, local_seid 0x%02x\n", cid, local_seid);
             
             a2dp_demo_timer_stop(&media_tracker);
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+            a2dp_source_rate_control_stop(&sbc_rate_control);
+#endif
             break;
 
         case A2DP_SUBEVENT_STREAM_RELEASED:
@@ -711,6 +751,9 @@ static void a2dp_source_packet_handler(uint8_t packet_type, uint16_t channel, ui
                 avrcp_target_set_playback_status(media_tracker.avrcp_cid, AVRCP_PLAYBACK_STATUS_STOPPED);
             }
             a2dp_demo_timer_stop(&media_tracker);
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+            a2dp_source_rate_control_stop(&sbc_rate_control);
+#endif
             break;
         case A2DP_SUBEVENT_SIGNALING_CONNECTION_RELEASED:
             cid = a2dp_subevent_signaling_connection_released_get_a2dp_cid(packet);
@@ -46,6 +46,7 @@
 #include "sco_demo_util.h"
 
 #include "btstack_audio.h"
+#include "btstack_audio_jitter_buffer.h"
 #include "btstack_debug.h"
 #include "btstack_ring_buffer.h"
 #include "classic/btstack_cvsd_plc.h"
@@ -104,9 +105,8 @@
 // output
 
 #if (SCO_DEMO_MODE == SCO_DEMO_MODE_SINE) || (SCO_DEMO_MODE == SCO_DEMO_MODE_MICROPHONE)
-static int                   audio_output_paused  = 0;
-static uint8_t               audio_output_ring_buffer_storage[2*MSBC_PA_PREBUFFER_BYTES];
-static btstack_ring_buffer_t audio_output_ring_buffer;
+static int16_t                       audio_output_jitter_buffer_storage[2*MSBC_PA_PREBUFFER_BYTES/BYTES_PER_FRAME];
+static btstack_audio_jitter_buffer_t audio_output_jitter_buffer;
 #endif
 
 
@@ -194,40 +194,8 @@ static void sco_demo_msbc_fill_sine_audio_frame(void){
 #if (SCO_DEMO_MODE == SCO_DEMO_MODE_SINE) || (SCO_DEMO_MODE == SCO_DEMO_MODE_MICROPHONE)
 
 static void playback_callback(int16_t * buffer, uint16_t num_samples){
-
-    uint32_t prebuffer_bytes;
-    switch (negotiated_codec){
-        case HFP_CODEC_MSBC:
-            prebuffer_bytes = MSBC_PA_PREBUFFER_BYTES;
-            break;
-        case HFP_CODEC_CVSD:
-        default:
-            prebuffer_bytes = CVSD_PA_PREBUFFER_BYTES;
-            break;
-    }
-
-    // fill with silence while paused
-    if (audio_output_paused){
-        if (btstack_ring_buffer_bytes_available(&audio_output_ring_buffer) < prebuffer_bytes){
-            memset(buffer, 0, num_samples * BYTES_PER_FRAME);
-           return;
-        } else {
-            // resume playback
-            audio_output_paused = 0;
-        }
-    }
-
-    // get data from ringbuffer
-    uint32_t bytes_read = 0;
-    btstack_ring_buffer_read(&audio_output_ring_buffer, (uint8_t *) buffer, num_samples * BYTES_PER_FRAME, &bytes_read);
-    num_samples -= bytes_read / BYTES_PER_FRAME;
-    buffer      += bytes_read / BYTES_PER_FRAME;
-
-    // fill with 0 if not enough
-    if (num_samples){
-        memset(buffer, 0, num_samples * BYTES_PER_FRAME);
-        audio_output_paused = 1;
-    }
+    // silence while prebuffering, playback resumes after underrun when prebuffer is full again
+    btstack_audio_jitter_buffer_read(&audio_output_jitter_buffer, buffer, num_samples);
 }
 
 #ifdef USE_AUDIO_INPUT
@@ -241,9 +209,10 @@ static int audio_initialize(int sample_rate){
 
     // -- output -- //
 
-    // init buffers
-    memset(audio_output_ring_buffer_storage, 0, sizeof(audio_output_ring_buffer_storage));
-    btstack_ring_buffer_init(&audio_output_ring_buffer, audio_output_ring_buffer_storage, sizeof(audio_output_ring_buffer_storage));
+    // init buffers, jitter buffer compensates clock drift between remote device and audio output
+    uint16_t prebuffer_ms = (sample_rate == MSBC_SAMPLE_RATE) ? SCO_MSBC_PA_PREBUFFER_MS : SCO_CVSD_PA_PREBUFFER_MS;
+    btstack_audio_jitter_buffer_init(&audio_output_jitter_buffer, audio_output_jitter_buffer_storage,
+                                     sizeof(audio_output_jitter_buffer_storage) / BYTES_PER_FRAME, NUM_CHANNELS, sample_rate, prebuffer_ms);
 
     // config and setup audio playback
     const btstack_audio_sink_t * audio_sink = btstack_audio_sink_get_instance();
@@ -252,8 +221,6 @@ static int audio_initialize(int sample_rate){
     audio_sink->init(1, sample_rate, &playback_callback);
     audio_sink->start_stream();
 
-    audio_output_paused  = 1;
-
     // -- input -- //
 
 #ifdef USE_AUDIO_INPUT
@@ -279,6 +246,13 @@ static void audio_terminate(void){
     if (!audio_sink) return;
     audio_sink->close();
 
+    btstack_audio_jitter_buffer_statistics_t statistics;
+    btstack_audio_jitter_buffer_get_statistics(&audio_output_jitter_buffer, &statistics);
+    printf("Playback: %u underruns, %u overruns, latency %u..%u frames, resampling offset %d\n",
+           (unsigned int) statistics.underruns, (unsigned int) statistics.overruns,
+           (unsigned int) statistics.latency_frames_min, (unsigned int) statistics.latency_frames_max,
+           (int) statistics.resampling_offset);
+
 #ifdef USE_AUDIO_INPUT
     const btstack_audio_source_t * audio_source= btstack_audio_source_get_instance();
     if (!audio_source) return;
@@ -300,7 +274,7 @@ static void handle_pcm_data(int16_t * data, int num_samples, int num_channels, i
     // printf("handle_pcm_data num samples %u, sample rate %d\n", num_samples, num_channels);
 
     // samples in callback in host endianess, ready for playback
-    btstack_ring_buffer_write(&audio_output_ring_buffer, (uint8_t *)data, num_samples*num_channels*2);
+    btstack_audio_jitter_buffer_write(&audio_output_jitter_buffer, data, num_samples);
 
 #ifdef SCO_WAV_FILENAME
     if (!num_samples_to_write) return;
@@ -407,7 +381,7 @@ static void sco_demo_receive_CVSD(uint8_t * packet, uint16_t size){
     }
 #endif
 
-    btstack_ring_buffer_write(&audio_output_ring_buffer, (uint8_t *)audio_frame_out, audio_bytes_read);
+    btstack_audio_jitter_buffer_write(&audio_output_jitter_buffer, audio_frame_out, num_samples);
 }
 
 #endif
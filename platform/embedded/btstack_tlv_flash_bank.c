@@ -168,7 +168,8 @@ static void tlv_iterator_fetch_next(btstack_tlv_flash_bank_t * self, tlv_iterato
 	it->offset += self->delete_tag_len;
 #endif
 
-	if (it->offset >= self->hal_flash_bank_impl->get_size(self->hal_flash_bank_context)) {
+	// end of bank reached if there's no space for another entry header
+	if ((it->offset + 8u) > self->hal_flash_bank_impl->get_size(self->hal_flash_bank_context)) {
 		it->tag = 0xffffffff;
 		it->len = 0;
 		return;
@@ -237,6 +238,93 @@ static void btstack_tlv_flash_bank_erase_bank(btstack_tlv_flash_bank_t * self, i
 	}
 }
 
+// tag index: open addressing with linear probing, at least one slot is kept empty
+
+static uint16_t btstack_tlv_flash_bank_tag_index_home(btstack_tlv_flash_bank_t * self, uint32_t tag){
+	// tags often differ only in the lowest byte, mix all bits
+	uint32_t hash = tag * 0x9E3779B1u;
+	return (uint16_t) ((hash >> 16) % self->tag_index_size);
+}
+
+static uint16_t btstack_tlv_flash_bank_tag_index_next(btstack_tlv_flash_bank_t * self, uint16_t pos){
+	pos++;
+	if (pos == self->tag_index_size){
+		pos = 0;
+	}
+	return pos;
+}
+
+static btstack_tlv_flash_bank_tag_index_entry_t * btstack_tlv_flash_bank_tag_index_lookup(btstack_tlv_flash_bank_t * self, uint32_t tag){
+	uint16_t pos = btstack_tlv_flash_bank_tag_index_home(self, tag);
+	while (true){
+		btstack_tlv_flash_bank_tag_index_entry_t * entry = &self->tag_index[pos];
+		if (entry->tag == tag) return entry;
+		if (entry->tag == 0) return NULL;
+		pos = btstack_tlv_flash_bank_tag_index_next(self, pos);
+	}
+}
+
+static void btstack_tlv_flash_bank_tag_index_set(btstack_tlv_flash_bank_t * self, uint32_t tag, uint32_t offset, uint32_t len){
+	if (self->tag_index_valid == 0) return;
+	uint16_t pos = btstack_tlv_flash_bank_tag_index_home(self, tag);
+	while ((self->tag_index[pos].tag != 0) && (self->tag_index[pos].tag != tag)){
+		pos = btstack_tlv_flash_bank_tag_index_next(self, pos);
+	}
+	btstack_tlv_flash_bank_tag_index_entry_t * entry = &self->tag_index[pos];
+	if (entry->tag == 0){
+		if ((self->tag_index_count + 1u) >= self->tag_index_size){
+			log_info("tag index full, scan bank instead");
+			self->tag_index_valid = 0;
+			return;
+		}
+		self->tag_index_count++;
+	}
+	entry->tag    = tag;
+	entry->offset = offset;
+	entry->len    = len;
+}
+
+static void btstack_tlv_flash_bank_tag_index_remove(btstack_tlv_flash_bank_t * self, uint32_t tag){
+	btstack_tlv_flash_bank_tag_index_entry_t * entry = btstack_tlv_flash_bank_tag_index_lookup(self, tag);
+	if (entry == NULL) return;
+	// backward shift deletion: move following entries of the cluster into the hole unless their home lies in (hole, pos]
+	uint16_t hole = (uint16_t) (entry - self->tag_index);
+	uint16_t pos  = hole;
+	while (true){
+		pos = btstack_tlv_flash_bank_tag_index_next(self, pos);
+		if (self->tag_index[pos].tag == 0) break;
+		uint16_t home = btstack_tlv_flash_bank_tag_index_home(self, self->tag_index[pos].tag);
+		bool reachable;
+		if (hole <= pos){
+			reachable = (hole < home) && (home <= pos);
+		} else {
+			reachable = (hole < home) || (home <= pos);
+		}
+		if (reachable) continue;
+		self->tag_index[hole] = self->tag_index[pos];
+		hole = pos;
+	}
+	self->tag_index[hole].tag = 0;
+	self->tag_index_count--;
+}
+
+static void btstack_tlv_flash_bank_tag_index_build(btstack_tlv_flash_bank_t * self){
+	if (self->tag_index == NULL) return;
+	memset(self->tag_index, 0, self->tag_index_size * sizeof(btstack_tlv_flash_bank_tag_index_entry_t));
+	self->tag_index_count = 0;
+	self->tag_index_valid = 1;
+	tlv_iterator_t it;
+	btstack_tlv_flash_bank_iterator_init(self, &it, self->current_bank);
+	while (btstack_tlv_flash_bank_iterator_has_next(self, &it)){
+		// skip deleted entries
+		if (it.tag) {
+			btstack_tlv_flash_bank_tag_index_set(self, it.tag, it.offset, it.len);
+		}
+		tlv_iterator_fetch_next(self, &it);
+	}
+	log_info("tag index: %u tags, valid %u", self->tag_index_count, self->tag_index_valid);
+}
+
 static void btstack_tlv_flash_bank_migrate(btstack_tlv_flash_bank_t * self){
 
 	int next_bank = 1 - self->current_bank;
@@ -289,25 +377,31 @@ static void btstack_tlv_flash_bank_migrate(btstack_tlv_flash_bank_t * self){
 	btstack_tlv_flash_bank_write_header(self, next_bank, (epoch_buffer + 1) & 3);
 	self->current_bank = next_bank;
 	self->write_offset = next_write_pos;
+
+	// offsets have changed, also retry if index was full
+	btstack_tlv_flash_bank_tag_index_build(self);
 }
 
-static void btstack_tlv_flash_bank_delete_tag_until_offset(btstack_tlv_flash_bank_t * self, uint32_t tag, uint32_t offset){
-	tlv_iterator_t it;
-	btstack_tlv_flash_bank_iterator_init(self, &it, self->current_bank);
-	while (btstack_tlv_flash_bank_iterator_has_next(self, &it) && it.offset < offset){
-		if (it.tag == tag){
-			log_info("Erase tag '%x' at position %u", (unsigned int) tag, (unsigned int) it.offset);
+static void btstack_tlv_flash_bank_mark_deleted(btstack_tlv_flash_bank_t * self, uint32_t tag, uint32_t offset){
+	log_info("Erase tag '%x' at position %u", (unsigned int) tag, (unsigned int) offset);
 
-			// mark entry as invalid
-			uint32_t zero_value = 0;
+	// mark entry as invalid
+	uint32_t zero_value = 0;
 #ifdef ENABLE_TLV_FLASH_EXPLICIT_DELETE_FIELD
-			// write delete field at offset 8
-			btstack_tlv_flash_bank_write(self, self->current_bank, it.offset+8, (uint8_t*) &zero_value, sizeof(zero_value));
+	// write delete field at offset 8
+	btstack_tlv_flash_bank_write(self, self->current_bank, offset+8, (uint8_t*) &zero_value, sizeof(zero_value));
 #else
-			// overwrite tag with zero value
-			btstack_tlv_flash_bank_write(self, self->current_bank, it.offset, (uint8_t*) &zero_value, sizeof(zero_value));
+	// overwrite tag with zero value
+	btstack_tlv_flash_bank_write(self, self->current_bank, offset, (uint8_t*) &zero_value, sizeof(zero_value));
 #endif
+}
 
+static void btstack_tlv_flash_bank_delete_tag_until_offset(btstack_tlv_flash_bank_t * self, uint32_t tag, uint32_t offset){
+	tlv_iterator_t it;
+	btstack_tlv_flash_bank_iterator_init(self, &it, self->current_bank);
+	while (btstack_tlv_flash_bank_iterator_has_next(self, &it) && it.offset < offset){
+		if (it.tag == tag){
+			btstack_tlv_flash_bank_mark_deleted(self, tag, it.offset);
 		}
 		tlv_iterator_fetch_next(self, &it);
 	}
@@ -326,16 +420,24 @@ static int btstack_tlv_flash_bank_get_tag(void * context, uint32_t tag, uint8_t
 
 	uint32_t tag_index = 0;
 	uint32_t tag_len   = 0;
-	tlv_iterator_t it;
-	btstack_tlv_flash_bank_iterator_init(self, &it, self->current_bank);
-	while (btstack_tlv_flash_bank_iterator_has_next(self, &it)){
-		if (it.tag == tag){
-			log_info("Found tag '%x' at position %u", (unsigned int) tag, (unsigned int) it.offset);
-			tag_index = it.offset;
-			tag_len   = it.len;
-			break;
+	if (self->tag_index_valid){
+		const btstack_tlv_flash_bank_tag_index_entry_t * entry = btstack_tlv_flash_bank_tag_index_lookup(self, tag);
+		if (entry != NULL){
+			tag_index = entry->offset;
+			tag_len   = entry->len;
+		}
+	} else {
+		tlv_iterator_t it;
+		btstack_tlv_flash_bank_iterator_init(self, &it, self->current_bank);
+		while (btstack_tlv_flash_bank_iterator_has_next(self, &it)){
+			if (it.tag == tag){
+				log_info("Found tag '%x' at position %u", (unsigned int) tag, (unsigned int) it.offset);
+				tag_index = it.offset;
+				tag_len   = it.len;
+				break;
+			}
+			tlv_iterator_fetch_next(self, &it);
 		}
-		tlv_iterator_fetch_next(self, &it);
 	}
 	if (tag_index == 0) return 0;
 	if (!buffer) return tag_len;
@@ -390,7 +492,15 @@ static int btstack_tlv_flash_bank_store_tag(void * context, uint32_t tag, const
 	btstack_tlv_flash_bank_write(self, self->current_bank, self->write_offset, entry, sizeof(entry));
 
 	// overwrite old entries (if exists)
-	btstack_tlv_flash_bank_delete_tag_until_offset(self, tag, self->write_offset);
+	if (self->tag_index_valid){
+		const btstack_tlv_flash_bank_tag_index_entry_t * index_entry = btstack_tlv_flash_bank_tag_index_lookup(self, tag);
+		if (index_entry != NULL){
+			btstack_tlv_flash_bank_mark_deleted(self, tag, index_entry->offset);
+		}
+		btstack_tlv_flash_bank_tag_index_set(self, tag, self->write_offset, data_size);
+	} else {
+		btstack_tlv_flash_bank_delete_tag_until_offset(self, tag, self->write_offset);
+	}
 
 	// done
 	self->write_offset += sizeof(entry) + btstack_tlv_flash_bank_align_size(self, data_size);
@@ -409,13 +519,51 @@ static int btstack_tlv_flash_bank_store_tag(void * context, uint32_t tag, const
  */
 static void btstack_tlv_flash_bank_delete_tag(void * context, uint32_t tag){
 	btstack_tlv_flash_bank_t * self = (btstack_tlv_flash_bank_t *) context;
+	if (self->tag_index_valid){
+		const btstack_tlv_flash_bank_tag_index_entry_t * index_entry = btstack_tlv_flash_bank_tag_index_lookup(self, tag);
+		if (index_entry == NULL) return;
+		btstack_tlv_flash_bank_mark_deleted(self, tag, index_entry->offset);
+		btstack_tlv_flash_bank_tag_index_remove(self, tag);
+		return;
+	}
 	btstack_tlv_flash_bank_delete_tag_until_offset(self, tag, self->write_offset);
 }
 
+/**
+ * Iterate over stored tags in range
+ * @param tag_first
+ * @param tag_last
+ * @param callback
+ * @param callback_context
+ */
+static void btstack_tlv_flash_bank_iterate_tags(void * context, uint32_t tag_first, uint32_t tag_last, btstack_tlv_iterate_callback_t callback, void * callback_context){
+	btstack_tlv_flash_bank_t * self = (btstack_tlv_flash_bank_t *) context;
+	if (self->tag_index_valid){
+		uint16_t pos;
+		for (pos = 0; pos < self->tag_index_size; pos++){
+			const btstack_tlv_flash_bank_tag_index_entry_t * entry = &self->tag_index[pos];
+			if ((entry->tag != 0) && (entry->tag >= tag_first) && (entry->tag <= tag_last)){
+				if ((*callback)(callback_context, entry->tag, entry->len) == false) return;
+			}
+		}
+		return;
+	}
+	tlv_iterator_t it;
+	btstack_tlv_flash_bank_iterator_init(self, &it, self->current_bank);
+	while (btstack_tlv_flash_bank_iterator_has_next(self, &it)){
+		// deleted entries have tag 0, older versions of a tag are deleted on store
+		if ((it.tag != 0) && (it.tag >= tag_first) && (it.tag <= tag_last)){
+			if ((*callback)(callback_context, it.tag, it.len) == false) return;
+		}
+		tlv_iterator_fetch_next(self, &it);
+	}
+}
+
 static const btstack_tlv_t btstack_tlv_flash_bank = {
 	/* int  (*get_tag)(..);     */ &btstack_tlv_flash_bank_get_tag,
 	/* int (*store_tag)(..);    */ &btstack_tlv_flash_bank_store_tag,
 	/* void (*delete_tag)(v..); */ &btstack_tlv_flash_bank_delete_tag,
+	/* void (*iterate_tags)(..); */ &btstack_tlv_flash_bank_iterate_tags,
 };
 
 /**
@@ -426,6 +574,10 @@ const btstack_tlv_t * btstack_tlv_flash_bank_init_instance(btstack_tlv_flash_ban
 	self->hal_flash_bank_impl    = hal_flash_bank_impl;
 	self->hal_flash_bank_context = hal_flash_bank_context;
 	self->delete_tag_len = 0;
+	self->tag_index = NULL;
+	self->tag_index_size = 0;
+	self->tag_index_count = 0;
+	self->tag_index_valid = 0;
 
 #ifdef ENABLE_TLV_FLASH_EXPLICIT_DELETE_FIELD
 	if (hal_flash_bank_impl->get_alignment(hal_flash_bank_context) > 8){
@@ -488,3 +640,10 @@ const btstack_tlv_t * btstack_tlv_flash_bank_init_instance(btstack_tlv_flash_ban
 	return &btstack_tlv_flash_bank;
 }
 
+void btstack_tlv_flash_bank_enable_tag_index(btstack_tlv_flash_bank_t * self, btstack_tlv_flash_bank_tag_index_entry_t * storage, uint16_t num_entries){
+	// at least one slot is kept empty
+	if (num_entries < 2u) return;
+	self->tag_index = storage;
+	self->tag_index_size = num_entries;
+	btstack_tlv_flash_bank_tag_index_build(self);
+}
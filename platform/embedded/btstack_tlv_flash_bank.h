@@ -47,12 +47,24 @@
 extern "C" {
 #endif
 
+// RAM index entry: offset and len of the current entry for tag, tag 0 = unused
+typedef struct {
+	uint32_t tag;
+	uint32_t offset;
+	uint32_t len;
+} btstack_tlv_flash_bank_tag_index_entry_t;
+
 typedef struct {
 	const hal_flash_bank_t * hal_flash_bank_impl;
 	void * hal_flash_bank_context;
 	int current_bank;
 	int write_offset;
 	int delete_tag_len;
+	// optional tag index
+	btstack_tlv_flash_bank_tag_index_entry_t * tag_index;
+	uint16_t tag_index_size;
+	uint16_t tag_index_count;
+	uint8_t  tag_index_valid;
 } btstack_tlv_flash_bank_t;
 
 /**
@@ -63,6 +75,16 @@ typedef struct {
  */
 const btstack_tlv_t * btstack_tlv_flash_bank_init_instance(btstack_tlv_flash_bank_t * context, const hal_flash_bank_t * hal_flash_bank_impl, void * hal_flash_bank_context);
 
+/**
+ * Enable RAM index of stored tags, must be called after btstack_tlv_flash_bank_init_instance
+ * With the index, get_tag reads only the value from flash, and store_tag/delete_tag don't need to scan the bank.
+ * If the index becomes full, the TLV falls back to scanning the bank until the next migration.
+ * @param context btstack_tlv_flash_bank_t
+ * @param storage for index entries
+ * @param num_entries in storage, should be larger than the number of stored tags, e.g. 1.5x
+ */
+void btstack_tlv_flash_bank_enable_tag_index(btstack_tlv_flash_bank_t * context, btstack_tlv_flash_bank_tag_index_entry_t * storage, uint16_t num_entries);
+
 #if defined __cplusplus
 }
 #endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "btstack_crypto_ecc_p256_executor_posix.c"
+
+/*
+ *  btstack_crypto_ecc_p256_executor_posix.c
+ *
+ *  Runs software ECC P-256 operations on a worker thread and reports completion on the main thread
+ */
+
+#include "btstack_crypto_ecc_p256_executor_posix.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "btstack_debug.h"
+#include "btstack_run_loop.h"
+
+static pthread_mutex_t btstack_crypto_ecc_p256_executor_posix_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  btstack_crypto_ecc_p256_executor_posix_cond  = PTHREAD_COND_INITIALIZER;
+static bool            btstack_crypto_ecc_p256_executor_posix_thread_started;
+
+// single job slot, btstack_crypto only has one ECC operation active
+static btstack_context_callback_registration_t * btstack_crypto_ecc_p256_executor_posix_work;
+static btstack_context_callback_registration_t * btstack_crypto_ecc_p256_executor_posix_done;
+
+static void * btstack_crypto_ecc_p256_executor_posix_thread(void * arg){
+    UNUSED(arg);
+    while (true){
+        // wait for work
+        pthread_mutex_lock(&btstack_crypto_ecc_p256_executor_posix_mutex);
+        while (btstack_crypto_ecc_p256_executor_posix_work == NULL){
+            pthread_cond_wait(&btstack_crypto_ecc_p256_executor_posix_cond, &btstack_crypto_ecc_p256_executor_posix_mutex);
+        }
+        btstack_context_callback_registration_t * work = btstack_crypto_ecc_p256_executor_posix_work;
+        btstack_context_callback_registration_t * done = btstack_crypto_ecc_p256_executor_posix_done;
+        btstack_crypto_ecc_p256_executor_posix_work = NULL;
+        btstack_crypto_ecc_p256_executor_posix_done = NULL;
+        pthread_mutex_unlock(&btstack_crypto_ecc_p256_executor_posix_mutex);
+
+        // execute, work must not log as hci_dump is not thread-safe
+        (*work->callback)(work->context);
+
+        // report completion on main thread
+        btstack_run_loop_execute_on_main_thread(done);
+    }
+    return NULL;
+}
+
+static void btstack_crypto_ecc_p256_executor_posix_execute(btstack_context_callback_registration_t * work, btstack_context_callback_registration_t * done){
+    pthread_mutex_lock(&btstack_crypto_ecc_p256_executor_posix_mutex);
+    // start worker thread on first use
+    if (btstack_crypto_ecc_p256_executor_posix_thread_started == false){
+        pthread_t thread;
+        int err = pthread_create(&thread, NULL, &btstack_crypto_ecc_p256_executor_posix_thread, NULL);
+        btstack_assert(err == 0);
+        UNUSED(err);
+        pthread_detach(thread);
+        btstack_crypto_ecc_p256_executor_posix_thread_started = true;
+    }
+    btstack_assert(btstack_crypto_ecc_p256_executor_posix_work == NULL);
+    btstack_crypto_ecc_p256_executor_posix_work = work;
+    btstack_crypto_ecc_p256_executor_posix_done = done;
+    pthread_cond_signal(&btstack_crypto_ecc_p256_executor_posix_cond);
+    pthread_mutex_unlock(&btstack_crypto_ecc_p256_executor_posix_mutex);
+}
+
+static const btstack_crypto_ecc_p256_executor_t btstack_crypto_ecc_p256_executor_posix = {
+    &btstack_crypto_ecc_p256_executor_posix_execute
+};
+
+const btstack_crypto_ecc_p256_executor_t * btstack_crypto_ecc_p256_executor_posix_get_instance(void){
+    return &btstack_crypto_ecc_p256_executor_posix;
+}
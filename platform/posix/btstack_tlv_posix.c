@@ -29,18 +29,23 @@
  *
  */
 
+
 #define BTSTACK_FILE__ "btstack_tlv_posix.c"
 
 #include "btstack_tlv.h"
 #include "btstack_tlv_posix.h"
 #include "btstack_debug.h"
 #include "btstack_util.h"
-#include "btstack_debug.h"
-#include "string.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
+#ifdef ENABLE_TLV_POSIX_MMAP
+#include <sys/mman.h>
+#endif
 
 // Header:
 // - Magic: 'BTstack'
@@ -53,48 +58,225 @@
 // - Len: 32 bit
 // - Value: Len in bytes
 
+// Each store and delete is appended to the db file. If the size of overwritten and deleted entries
+// exceeds BTSTACK_TLV_POSIX_COMPACTION_MIN_GARBAGE bytes and BTSTACK_TLV_POSIX_COMPACTION_GARBAGE_PERCENT
+// of the file, all current entries are written to a new file which then atomically replaces the db file.
+
 #define BTSTACK_TLV_HEADER_LEN 8
+#define BTSTACK_TLV_ENTRY_HEADER_LEN 8
 
 #define MAX_TLV_VALUE_SIZE 2048
 
+#ifndef BTSTACK_TLV_POSIX_COMPACTION_MIN_GARBAGE
+#define BTSTACK_TLV_POSIX_COMPACTION_MIN_GARBAGE 16384
+#endif
+
+#ifndef BTSTACK_TLV_POSIX_COMPACTION_GARBAGE_PERCENT
+#define BTSTACK_TLV_POSIX_COMPACTION_GARBAGE_PERCENT 50
+#endif
+
+#define BTSTACK_TLV_POSIX_MIN_BUCKETS 64
+
 static const char * btstack_tlv_header_magic = "BTstack";
 
 #define DUMMY_SIZE 4
 typedef struct tlv_entry {
-	void   * next;
+	struct tlv_entry * next;	// next entry in hash bucket
 	uint32_t tag;
 	uint32_t len;
 	uint8_t  value[DUMMY_SIZE];	// dummy size
 } tlv_entry_t;
 
-static int btstack_tlv_posix_append_tag(btstack_tlv_posix_t * self, uint32_t tag, const uint8_t * data, uint32_t data_size){
+static uint32_t btstack_tlv_posix_bucket_for_tag(uint32_t num_buckets, uint32_t tag){
+	// num_buckets is a power of two, so only the low bits select the bucket. Tags of different
+	// users, e.g. 'BTD' + index and 'BTC' + index, differ in the upper bytes only:
+	// multiplication moves them into the upper half, which is then folded into the masked bits
+	uint32_t product = tag * 0x9E3779B1u;
+	return (product ^ (product >> 16)) & (num_buckets - 1u);
+}
 
-	if (!self->file) return 1;
+static tlv_entry_t * btstack_tlv_posix_find_entry(btstack_tlv_posix_t * self, uint32_t tag){
+	if (self->buckets == NULL) return NULL;
+	tlv_entry_t * entry = (tlv_entry_t *) self->buckets[btstack_tlv_posix_bucket_for_tag(self->num_buckets, tag)];
+	while (entry != NULL){
+		if (entry->tag == tag) return entry;
+		entry = entry->next;
+	}
+	return NULL;
+}
 
-	log_info("append tag %04x, len %u", tag, data_size);
+// @returns entry removed from index or NULL
+static tlv_entry_t * btstack_tlv_posix_remove_entry(btstack_tlv_posix_t * self, uint32_t tag){
+	if (self->buckets == NULL) return NULL;
+	tlv_entry_t ** prev = (tlv_entry_t **) &self->buckets[btstack_tlv_posix_bucket_for_tag(self->num_buckets, tag)];
+	while (*prev != NULL){
+		tlv_entry_t * entry = *prev;
+		if (entry->tag == tag){
+			*prev = entry->next;
+			self->num_entries--;
+			self->live_bytes -= BTSTACK_TLV_ENTRY_HEADER_LEN + entry->len;
+			return entry;
+		}
+		prev = &entry->next;
+	}
+	return NULL;
+}
 
-	uint8_t header[8];
+static void btstack_tlv_posix_resize_buckets(btstack_tlv_posix_t * self, uint32_t num_buckets){
+	void ** buckets = (void **) calloc(num_buckets, sizeof(void *));
+	if (buckets == NULL) return;
+	uint32_t i;
+	for (i = 0; i < self->num_buckets; i++){
+		tlv_entry_t * entry = (tlv_entry_t *) self->buckets[i];
+		while (entry != NULL){
+			tlv_entry_t * next = entry->next;
+			uint32_t bucket = btstack_tlv_posix_bucket_for_tag(num_buckets, entry->tag);
+			entry->next = (tlv_entry_t *) buckets[bucket];
+			buckets[bucket] = entry;
+			entry = next;
+		}
+	}
+	free(self->buckets);
+	self->buckets = buckets;
+	self->num_buckets = num_buckets;
+}
+
+static bool btstack_tlv_posix_insert_entry(btstack_tlv_posix_t * self, tlv_entry_t * entry){
+	// keep load factor <= 1
+	if (self->num_entries >= self->num_buckets){
+		btstack_tlv_posix_resize_buckets(self, btstack_max(BTSTACK_TLV_POSIX_MIN_BUCKETS, 2u * self->num_buckets));
+	}
+	if (self->buckets == NULL) return false;
+	uint32_t bucket = btstack_tlv_posix_bucket_for_tag(self->num_buckets, entry->tag);
+	entry->next = (tlv_entry_t *) self->buckets[bucket];
+	self->buckets[bucket] = entry;
+	self->num_entries++;
+	self->live_bytes += BTSTACK_TLV_ENTRY_HEADER_LEN + entry->len;
+	return true;
+}
+
+static void btstack_tlv_posix_free_entries(btstack_tlv_posix_t * self){
+	uint32_t i;
+	for (i = 0; i < self->num_buckets; i++){
+		tlv_entry_t * entry = (tlv_entry_t *) self->buckets[i];
+		while (entry != NULL){
+			tlv_entry_t * next = entry->next;
+			free(entry);
+			entry = next;
+		}
+	}
+	free(self->buckets);
+	self->buckets = NULL;
+	self->num_buckets = 0;
+	self->num_entries = 0;
+	self->live_bytes = 0;
+}
+
+// returns 0 on success
+static int btstack_tlv_posix_write_tag(FILE * file, uint32_t tag, const uint8_t * data, uint32_t data_size){
+	uint8_t header[BTSTACK_TLV_ENTRY_HEADER_LEN];
 	big_endian_store_32(header, 0, tag);
 	big_endian_store_32(header, 4, data_size);
-	size_t written_header = fwrite(header, 1, sizeof(header), self->file);
+	size_t written_header = fwrite(header, 1, sizeof(header), file);
 	if (written_header != sizeof(header)) return 1;
 	if (data_size > 0) {
-		size_t written_value = fwrite(data, 1, data_size, self->file);
+		size_t written_value = fwrite(data, 1, data_size, file);
 		if (written_value != data_size) return 1;
 	}
+	return 0;
+}
+
+static int btstack_tlv_posix_append_tag(btstack_tlv_posix_t * self, uint32_t tag, const uint8_t * data, uint32_t data_size){
+
+	if (!self->file) return 1;
+
+	log_info("append tag %04x, len %u", tag, data_size);
+
+	int err = btstack_tlv_posix_write_tag(self->file, tag, data, data_size);
 	fflush(self->file);
-	return 1;
+	self->file_bytes += BTSTACK_TLV_ENTRY_HEADER_LEN + data_size;
+	return err;
 }
 
-static tlv_entry_t * btstack_tlv_posix_find_entry(btstack_tlv_posix_t * self, uint32_t tag){
-	btstack_linked_list_iterator_t it;
-	btstack_linked_list_iterator_init(&it, &self->entry_list);
-	while (btstack_linked_list_iterator_has_next(&it)){
-		tlv_entry_t * entry = (tlv_entry_t*) btstack_linked_list_iterator_next(&it);
-		if (entry->tag != tag) continue;
-		return entry;
+// flush directory entry after rename, best effort
+static void btstack_tlv_posix_sync_directory(const char * path){
+	const char * separator = strrchr(path, '/');
+	char * dir_path;
+	if (separator == NULL){
+		dir_path = strdup(".");
+	} else if (separator == path){
+		dir_path = strdup("/");
+	} else {
+		dir_path = strndup(path, separator - path);
 	}
-	return NULL;
+	if (dir_path == NULL) return;
+	int dir_fd = open(dir_path, O_RDONLY);
+	if (dir_fd >= 0){
+		fsync(dir_fd);
+		close(dir_fd);
+	}
+	free(dir_path);
+}
+
+// write all entries into new file and replace db file with it
+// returns 0 on success
+static int btstack_tlv_posix_compact(btstack_tlv_posix_t * self){
+	size_t db_path_len = strlen(self->db_path);
+	char * tmp_path = (char *) malloc(db_path_len + 5);
+	if (tmp_path == NULL) return -1;
+	memcpy(tmp_path, self->db_path, db_path_len);
+	memcpy(&tmp_path[db_path_len], ".tmp", 5);
+
+	log_info("compact db %s: %u entries, %u of %u bytes used", self->db_path, (unsigned int) self->num_entries,
+			 (unsigned int) (BTSTACK_TLV_HEADER_LEN + self->live_bytes), (unsigned int) self->file_bytes);
+
+	FILE * file = fopen(tmp_path, "w+");
+	if (!file) {
+		log_error("failed to create file %s", tmp_path);
+		free(tmp_path);
+		return -1;
+	}
+
+	uint8_t header[BTSTACK_TLV_HEADER_LEN];
+	memset(header, 0, sizeof(header));
+	strcpy((char *)header, btstack_tlv_header_magic);
+	int err = (fwrite(header, 1, sizeof(header), file) == sizeof(header)) ? 0 : 1;
+	uint32_t i;
+	for (i = 0; (i < self->num_buckets) && (err == 0); i++){
+		const tlv_entry_t * entry = (const tlv_entry_t *) self->buckets[i];
+		while ((entry != NULL) && (err == 0)){
+			err = btstack_tlv_posix_write_tag(file, entry->tag, &entry->value[0], entry->len);
+			entry = entry->next;
+		}
+	}
+	// new file must be on disk before it replaces the old one
+	if (fflush(file) != 0) err = 1;
+	if (fsync(fileno(file)) != 0) err = 1;
+	if ((err == 0) && (rename(tmp_path, self->db_path) != 0)) err = 1;
+	if (err){
+		log_error("failed to write %s", tmp_path);
+		fclose(file);
+		unlink(tmp_path);
+		free(tmp_path);
+		return -1;
+	}
+	btstack_tlv_posix_sync_directory(self->db_path);
+	free(tmp_path);
+
+	if (self->file){
+		fclose(self->file);
+	}
+	self->file = file;
+	self->file_bytes = BTSTACK_TLV_HEADER_LEN + self->live_bytes;
+	return 0;
+}
+
+static void btstack_tlv_posix_compact_if_needed(btstack_tlv_posix_t * self){
+	if (self->file_bytes < (BTSTACK_TLV_HEADER_LEN + self->live_bytes)) return;
+	uint32_t garbage_bytes = self->file_bytes - BTSTACK_TLV_HEADER_LEN - self->live_bytes;
+	if (garbage_bytes < BTSTACK_TLV_POSIX_COMPACTION_MIN_GARBAGE) return;
+	if (((uint64_t) garbage_bytes * 100u) < ((uint64_t) self->file_bytes * BTSTACK_TLV_POSIX_COMPACTION_GARBAGE_PERCENT)) return;
+	btstack_tlv_posix_compact(self);
 }
 
 /**
@@ -103,16 +285,11 @@ static tlv_entry_t * btstack_tlv_posix_find_entry(btstack_tlv_posix_t * self, ui
  */
 static void btstack_tlv_posix_delete_tag(void * context, uint32_t tag){
 	btstack_tlv_posix_t * self = (btstack_tlv_posix_t *) context;
-	btstack_linked_list_iterator_t it;
-	btstack_linked_list_iterator_init(&it, &self->entry_list);
-	while (btstack_linked_list_iterator_has_next(&it)){
-		tlv_entry_t * entry = (tlv_entry_t*) btstack_linked_list_iterator_next(&it);
-		if (entry->tag != tag) continue;
-		btstack_linked_list_iterator_remove(&it);
-		free(entry);
-		btstack_tlv_posix_append_tag(self, tag, NULL, 0);
-		return;
-	}
+	tlv_entry_t * entry = btstack_tlv_posix_remove_entry(self, tag);
+	if (entry == NULL) return;
+	free(entry);
+	btstack_tlv_posix_append_tag(self, tag, NULL, 0);
+	btstack_tlv_posix_compact_if_needed(self);
 }
 
 /**
@@ -148,9 +325,8 @@ static int btstack_tlv_posix_store_tag(void * context, uint32_t tag, const uint8
 	btstack_assert(data_size <= MAX_TLV_VALUE_SIZE);
 
 	// remove old entry
-	tlv_entry_t * old_entry = btstack_tlv_posix_find_entry(self, tag);
+	tlv_entry_t * old_entry = btstack_tlv_posix_remove_entry(self, tag);
 	if (old_entry){
-		btstack_linked_list_remove(&self->entry_list, (btstack_linked_item_t *) old_entry);
 		free(old_entry);
 	}
 
@@ -163,96 +339,130 @@ static int btstack_tlv_posix_store_tag(void * context, uint32_t tag, const uint8
 	new_entry->len = data_size;
 	memcpy(&new_entry->value[0], data, data_size);
 
-	// append new entry
-	btstack_linked_list_add(&self->entry_list, (btstack_linked_item_t *) new_entry);
+	// add new entry
+	if (!btstack_tlv_posix_insert_entry(self, new_entry)){
+		free(new_entry);
+		return 0;
+	}
 
 	// write new tag
 	btstack_tlv_posix_append_tag(self, tag, data, data_size);
+	btstack_tlv_posix_compact_if_needed(self);
 
 	return 0;
 }
 
+/**
+ * Iterate over stored tags in range
+ * @param tag_first
+ * @param tag_last
+ * @param callback
+ * @param callback_context
+ */
+static void btstack_tlv_posix_iterate_tags(void * context, uint32_t tag_first, uint32_t tag_last, btstack_tlv_iterate_callback_t callback, void * callback_context){
+	btstack_tlv_posix_t * self = (btstack_tlv_posix_t *) context;
+	uint32_t i;
+	for (i = 0; i < self->num_buckets; i++){
+		const tlv_entry_t * entry = (const tlv_entry_t *) self->buckets[i];
+		while (entry != NULL){
+			if ((entry->tag >= tag_first) && (entry->tag <= tag_last)){
+				if ((*callback)(callback_context, entry->tag, entry->len) == false) return;
+			}
+			entry = entry->next;
+		}
+	}
+}
+
+// read entries from db content, later entries replace earlier ones, entries with len = 0 delete a tag
+// returns true if content is complete
+static bool btstack_tlv_posix_parse_db(btstack_tlv_posix_t * self, const uint8_t * data, size_t size){
+	if (size < BTSTACK_TLV_HEADER_LEN) return false;
+	if (memcmp(data, btstack_tlv_header_magic, strlen(btstack_tlv_header_magic)) != 0) return false;
+	log_info("BTstack Magic Header found");
+	size_t offset = BTSTACK_TLV_HEADER_LEN;
+	while (offset < size){
+		if ((size - offset) < BTSTACK_TLV_ENTRY_HEADER_LEN) return false;
+
+		uint32_t tag = big_endian_read_32(data, offset);
+		uint32_t len = big_endian_read_32(data, offset + 4);
+		offset += BTSTACK_TLV_ENTRY_HEADER_LEN;
+
+		// arbitrary safety check: values <= MAX_TLV_VALUE_SIZE
+		if (len > MAX_TLV_VALUE_SIZE) return false;
+		if ((size - offset) < len) return false;
+
+		// remove old entry
+		tlv_entry_t * old_entry = btstack_tlv_posix_remove_entry(self, tag);
+		if (old_entry){
+			free(old_entry);
+		}
+
+		// create new entry for regular tag
+		if (len > 0) {
+			tlv_entry_t * new_entry = (tlv_entry_t *) malloc(sizeof(tlv_entry_t) - DUMMY_SIZE + len);
+			if (!new_entry) return false;
+			new_entry->tag = tag;
+			new_entry->len = len;
+			memcpy(&new_entry->value[0], &data[offset], len);
+			if (!btstack_tlv_posix_insert_entry(self, new_entry)){
+				free(new_entry);
+				return false;
+			}
+		}
+		offset += len;
+	}
+	return true;
+}
+
+static bool btstack_tlv_posix_read_file(btstack_tlv_posix_t * self, size_t size){
+	bool file_valid = false;
+#ifdef ENABLE_TLV_POSIX_MMAP
+	if (size > 0){
+		void * data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(self->file), 0);
+		if (data != MAP_FAILED){
+			file_valid = btstack_tlv_posix_parse_db(self, (const uint8_t *) data, size);
+			munmap(data, size);
+			return file_valid;
+		}
+		log_info("mmap failed, read file");
+	}
+#endif
+	uint8_t * data = (uint8_t *) malloc(size);
+	if ((data == NULL) && (size > 0)) return false;
+	if (fread(data, 1, size, self->file) == size){
+		file_valid = btstack_tlv_posix_parse_db(self, data, size);
+	}
+	free(data);
+	return file_valid;
+}
+
 // returns 0 on success
 static int btstack_tlv_posix_read_db(btstack_tlv_posix_t * self){
 	// open file
 	log_info("open db %s", self->db_path);
-    self->file = fopen(self->db_path,"r+");
-    uint8_t header[BTSTACK_TLV_HEADER_LEN];
-    if (self->file){
-    	// checker header
-	    size_t objects_read = fread(header, 1, BTSTACK_TLV_HEADER_LEN, self->file );
-	    int file_valid = 0;
-	    if (objects_read == BTSTACK_TLV_HEADER_LEN){
-	    	if (memcmp(header, btstack_tlv_header_magic, strlen(btstack_tlv_header_magic)) == 0){
-		    	log_info("BTstack Magic Header found");
-		    	// read entries
-		    	while (true){
-					uint8_t entry[8];
-					size_t 	entries_read = fread(entry, 1, sizeof(entry), self->file);
-					if (entries_read == 0){
-						// EOF, we're good
-						file_valid = 1;
-						break;
-					}
-					if (entries_read != sizeof(entry)) break;
-
-                    uint32_t tag = big_endian_read_32(entry, 0);
-                    uint32_t len = big_endian_read_32(entry, 4);
-
-                    // arbitrary safety check: values <= MAX_TLV_VALUE_SIZE
-                    if (len > MAX_TLV_VALUE_SIZE) break;
-
-                    // create new entry for regular tag
-                    tlv_entry_t * new_entry = NULL;
-                    if (len > 0) {
-                        new_entry = (tlv_entry_t *) malloc(sizeof(tlv_entry_t) - DUMMY_SIZE + len);
-                        if (!new_entry) return 0;
-                        new_entry->tag = tag;
-                        new_entry->len = len;
-
-                        // read
-                        size_t value_read = fread(&new_entry->value[0], 1, len, self->file);
-                        if (value_read != len) break;
-                    }
-
-                    // remove old entry
-                    tlv_entry_t * old_entry = btstack_tlv_posix_find_entry(self, tag);
-                    if (old_entry){
-                        btstack_linked_list_remove(&self->entry_list, (btstack_linked_item_t *) old_entry);
-                        free(old_entry);
-                    }
-
-                    // append new entry
-                    if (new_entry){
-	                    btstack_linked_list_add(&self->entry_list, (btstack_linked_item_t *) new_entry);
-                    }
-		    	}
-	    	}
-	    }
-	    if (!file_valid) {
-	    	log_info("file invalid, re-create");
-    		fclose(self->file);
-    		self->file = NULL;
-	    }
-    }
-    if (!self->file){
-    	// create truncate file
-	    self->file = fopen(self->db_path,"w+");
-        if (!self->file) {
-            log_error("failed to create file");
-            return -1;
-        }
-	    memset(header, 0, sizeof(header));
-	    strcpy((char *)header, btstack_tlv_header_magic);
-	    fwrite(header, 1, sizeof(header), self->file);
-	    // write out all valid entries (if any)
-		btstack_linked_list_iterator_t it;
-		btstack_linked_list_iterator_init(&it, &self->entry_list);
-		while (btstack_linked_list_iterator_has_next(&it)){
-			tlv_entry_t * entry = (tlv_entry_t*) btstack_linked_list_iterator_next(&it);
-			btstack_tlv_posix_append_tag(self, entry->tag, &entry->value[0], entry->len);
+	self->file = fopen(self->db_path,"r+");
+	if (self->file){
+		struct stat file_stat;
+		bool file_valid = false;
+		if (fstat(fileno(self->file), &file_stat) == 0){
+			file_valid = btstack_tlv_posix_read_file(self, (size_t) file_stat.st_size);
+		}
+		if (file_valid){
+			// append new entries
+			fseek(self->file, 0, SEEK_END);
+			self->file_bytes = (uint32_t) file_stat.st_size;
+			btstack_tlv_posix_compact_if_needed(self);
+			return 0;
 		}
-    }
+		log_info("file invalid, re-create");
+		fclose(self->file);
+		self->file = NULL;
+	}
+	// create file with all valid entries (if any)
+	if (btstack_tlv_posix_compact(self) != 0){
+		log_error("failed to create file");
+		return -1;
+	}
 	return 0;
 }
 
@@ -260,6 +470,7 @@ static const btstack_tlv_t btstack_tlv_posix = {
 	/* int  (*get_tag)(..);     */ &btstack_tlv_posix_get_tag,
 	/* int (*store_tag)(..);    */ &btstack_tlv_posix_store_tag,
 	/* void (*delete_tag)(v..); */ &btstack_tlv_posix_delete_tag,
+	/* void (*iterate_tags)(..); */ &btstack_tlv_posix_iterate_tags,
 };
 
 /**
@@ -279,12 +490,6 @@ const btstack_tlv_t * btstack_tlv_posix_init_instance(btstack_tlv_posix_t * self
  * @param self
  */
 void btstack_tlv_posix_deinit(btstack_tlv_posix_t * self){
-    // free all entries
-    btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, &self->entry_list);
-    while (btstack_linked_list_iterator_has_next(&it)){
-        tlv_entry_t * entry = (tlv_entry_t*) btstack_linked_list_iterator_next(&it);
-		btstack_linked_list_iterator_remove(&it);
-		free(entry);
-    }
+	// free all entries
+	btstack_tlv_posix_free_entries(self);
 }
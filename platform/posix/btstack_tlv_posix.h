@@ -42,14 +42,19 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "btstack_tlv.h"
-#include "btstack_linked_list.h"
 
 #if defined __cplusplus
 extern "C" {
 #endif
 
 typedef struct {
-	btstack_linked_list_t entry_list;
+	// hash index of current entries
+	void ** buckets;
+	uint32_t num_buckets;
+	uint32_t num_entries;
+	// size of current entries in file and file size, used to trigger compaction
+	uint32_t live_bytes;
+	uint32_t file_bytes;
 	const char * db_path;
 	FILE * file;
 } btstack_tlv_posix_t;
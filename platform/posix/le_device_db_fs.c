@@ -317,6 +317,25 @@ void le_device_db_info(int index, int * addr_type, bd_addr_t addr, sm_key_t irk)
     if (irk) memcpy(irk, le_devices[index].irk, 16);
 }
 
+int le_device_db_lookup_by_identity_address(int addr_type, const bd_addr_t addr){
+    int i;
+    for (i=0;i<LE_DEVICE_MEMORY_SIZE;i++){
+        if (le_devices[i].addr_type == BD_ADDR_TYPE_UNKNOWN) continue;
+        if (le_devices[i].addr_type != addr_type) continue;
+        if (memcmp(le_devices[i].addr, addr, 6) == 0) return i;
+    }
+    return -1;
+}
+
+int le_device_db_lookup_by_irk(const sm_key_t irk){
+    int i;
+    for (i=0;i<LE_DEVICE_MEMORY_SIZE;i++){
+        if (le_devices[i].addr_type == BD_ADDR_TYPE_UNKNOWN) continue;
+        if (memcmp(le_devices[i].irk, irk, 16) == 0) return i;
+    }
+    return -1;
+}
+
 void le_device_db_encryption_set(int index, uint16_t ediv, uint8_t rand[8], sm_key_t ltk, int key_size, int authenticated, int authorized, int secure_connection){
     log_info("LE Device DB set encryption for %u, ediv x%04x, key size %u, authenticated %u, authorized %u, secure connection %u",
         index, ediv, key_size, authenticated, authorized, secure_connection);
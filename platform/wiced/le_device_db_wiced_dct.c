@@ -212,6 +212,31 @@ void le_device_db_info(int device_index, int * addr_type, bd_addr_t addr, sm_key
     if (irk) memcpy(irk, entry.irk, 16);
 }
 
+int le_device_db_lookup_by_identity_address(int addr_type, const bd_addr_t addr){
+    int i;
+    for (i=0;i<le_device_db_max_count();i++){
+        int entry_addr_type;
+        bd_addr_t entry_addr;
+        le_device_db_info(i, &entry_addr_type, entry_addr, NULL);
+        if (entry_addr_type == BD_ADDR_TYPE_UNKNOWN) continue;
+        if (entry_addr_type != addr_type) continue;
+        if (memcmp(entry_addr, addr, 6) == 0) return i;
+    }
+    return -1;
+}
+
+int le_device_db_lookup_by_irk(const sm_key_t irk){
+    int i;
+    for (i=0;i<le_device_db_max_count();i++){
+        int entry_addr_type;
+        sm_key_t entry_irk;
+        le_device_db_info(i, &entry_addr_type, NULL, entry_irk);
+        if (entry_addr_type == BD_ADDR_TYPE_UNKNOWN) continue;
+        if (memcmp(entry_irk, irk, 16) == 0) return i;
+    }
+    return -1;
+}
+
 // free device
 void le_device_db_remove(int device_index){
 	int absolute_index = le_device_db_get_absolute_index_for_device_index(device_index);
@@ -184,6 +184,25 @@ static int btstack_tlv_windows_store_tag(void * context, uint32_t tag, const uin
 	return 0;
 }
 
+/**
+ * Iterate over stored tags in range
+ * @param tag_first
+ * @param tag_last
+ * @param callback
+ * @param callback_context
+ */
+static void btstack_tlv_windows_iterate_tags(void * context, uint32_t tag_first, uint32_t tag_last, btstack_tlv_iterate_callback_t callback, void * callback_context){
+	btstack_tlv_windows_t * self = (btstack_tlv_windows_t *) context;
+	btstack_linked_list_iterator_t it;
+	btstack_linked_list_iterator_init(&it, &self->entry_list);
+	while (btstack_linked_list_iterator_has_next(&it)){
+		tlv_entry_t * entry = (tlv_entry_t*) btstack_linked_list_iterator_next(&it);
+		if (entry->tag < tag_first) continue;
+		if (entry->tag > tag_last) continue;
+		if ((*callback)(callback_context, entry->tag, entry->len) == false) return;
+	}
+}
+
 // returns 0 on success
 static int btstack_tlv_windows_read_db(btstack_tlv_windows_t * self){
 	// open file
@@ -306,6 +325,7 @@ static const btstack_tlv_t btstack_tlv_windows = {
 	/* int  (*get_tag)(..);     */ &btstack_tlv_windows_get_tag,
 	/* int (*store_tag)(..);    */ &btstack_tlv_windows_store_tag,
 	/* void (*delete_tag)(v..); */ &btstack_tlv_windows_delete_tag,
+	/* void (*iterate_tags)(..); */ &btstack_tlv_windows_iterate_tags,
 };
 
 /**
@@ -69,6 +69,8 @@ static int btstack_tlv_esp32_get_tag(void * context, uint32_t tag, uint8_t * buf
     esp_err_t err = nvs_get_blob(the_nvs_handle, key_buffer, NULL, &size);
     switch (err) {
         case ESP_OK:
+        	// return len if buffer = NULL
+        	if (buffer == NULL) return size;
         	if (size > buffer_size){
         		log_error("buffer_size %u < value size %u", buffer_size, size);
         		return 0;
@@ -133,6 +135,7 @@ static const btstack_tlv_t btstack_tlv_esp32 = {
 	/* int  (*get_tag)(..);     */ &btstack_tlv_esp32_get_tag,
 	/* int (*store_tag)(..);    */ &btstack_tlv_esp32_store_tag,
 	/* void (*delete_tag)(v..); */ &btstack_tlv_esp32_delete_tag,
+	/* void (*iterate_tags)(..); */ NULL,
 };
 
 /**
@@ -100,6 +100,7 @@ static void att_persistent_ccc_cache(att_iterator_t * it);
 static uint8_t const * att_database = NULL;
 static att_read_callback_t  att_read_callback  = NULL;
 static att_write_callback_t att_write_callback = NULL;
+static uint16_t att_read_callback_value_handle = 0;
 static int      att_prepare_write_error_code   = 0;
 static uint16_t att_prepare_write_error_handle = 0x0000;
 
@@ -203,8 +204,15 @@ uint16_t att_uuid_for_handle(uint16_t attribute_handle){
 }
 // end of client API
 
+static bool att_value_from_read_callback(att_iterator_t *it){
+    if ((it->flags & (uint16_t)ATT_PROPERTY_DYNAMIC) != 0u){
+        return true;
+    }
+    return (att_read_callback_value_handle != 0u) && (it->handle == att_read_callback_value_handle);
+}
+
 static void att_update_value_len(att_iterator_t *it, hci_con_handle_t con_handle){
-    if ((it->flags & (uint16_t)ATT_PROPERTY_DYNAMIC) == 0u){
+    if (att_value_from_read_callback(it) == false){
         return;
     }
     it->value_len = (*att_read_callback)(con_handle, it->handle, 0, NULL, 0);
@@ -215,7 +223,7 @@ static void att_update_value_len(att_iterator_t *it, hci_con_handle_t con_handle
 static int att_copy_value(att_iterator_t *it, uint16_t offset, uint8_t * buffer, uint16_t buffer_size, hci_con_handle_t con_handle){
     
     // DYNAMIC 
-    if ((it->flags & (uint16_t)ATT_PROPERTY_DYNAMIC) != 0u){
+    if (att_value_from_read_callback(it)){
         return (*att_read_callback)(con_handle, it->handle, offset, buffer, buffer_size);
     }
     
@@ -243,6 +251,10 @@ void att_set_read_callback(att_read_callback_t callback){
     att_read_callback = callback;
 }
 
+void att_set_read_callback_value_handle(uint16_t value_handle){
+    att_read_callback_value_handle = value_handle;
+}
+
 void att_set_write_callback(att_write_callback_t callback){
     att_write_callback = callback;
 }
@@ -1254,6 +1266,18 @@ static void handle_write_command(att_connection_t * att_connection, uint8_t * re
     (*att_write_callback)(att_connection->con_handle, handle, ATT_TRANSACTION_MODE_NONE, 0u, request_buffer + 3u, request_len - 3u);
 }
 
+uint8_t att_validate_write_command(att_connection_t * att_connection, uint16_t handle){
+    att_iterator_t it;
+    int ok = att_find_handle(&it, handle);
+    if (!ok){
+        return ATT_ERROR_INVALID_HANDLE;
+    }
+    if ((it.flags & (uint16_t)ATT_PROPERTY_WRITE_WITHOUT_RESPONSE) == 0u){
+        return ATT_ERROR_WRITE_NOT_PERMITTED;
+    }
+    return att_validate_security(att_connection, ATT_WRITE, &it);
+}
+
 // MARK: helper for ATT_HANDLE_VALUE_NOTIFICATION and ATT_HANDLE_VALUE_INDICATION
 static uint16_t prepare_handle_value(att_connection_t * att_connection,
                                      uint16_t handle,
@@ -1441,6 +1465,28 @@ uint16_t gatt_server_get_client_configuration_handle_for_characteristic_with_uui
     return gatt_server_get_descriptor_handle_for_characteristic_with_uuid16(start_handle, end_handle, characteristic_uuid16, GATT_CLIENT_CHARACTERISTICS_CONFIGURATION);
 }
 // returns 0 if not found
+uint16_t gatt_server_get_client_configuration_handle_for_value_handle(uint16_t value_handle){
+    att_iterator_t it;
+    att_iterator_init(&it);
+    while (att_iterator_has_next(&it)){
+        att_iterator_fetch_next(&it);
+        if (it.handle == 0u){
+            break;
+        }
+        if (it.handle <= value_handle){
+            continue;
+        }
+        if (att_iterator_match_uuid16(&it, GATT_PRIMARY_SERVICE_UUID)
+         || att_iterator_match_uuid16(&it, GATT_SECONDARY_SERVICE_UUID)
+         || att_iterator_match_uuid16(&it, GATT_CHARACTERISTICS_UUID)){
+            break;
+        }
+        if (att_iterator_match_uuid16(&it, GATT_CLIENT_CHARACTERISTICS_CONFIGURATION)){
+            return it.handle;
+        }
+    }
+    return 0;
+}
 
 uint16_t gatt_server_get_server_configuration_handle_for_characteristic_with_uuid16(uint16_t start_handle, uint16_t end_handle, uint16_t characteristic_uuid16){
     return gatt_server_get_descriptor_handle_for_characteristic_with_uuid16(start_handle, end_handle, characteristic_uuid16, GATT_SERVER_CHARACTERISTICS_CONFIGURATION);
@@ -1592,6 +1638,73 @@ bool att_is_persistent_ccc(uint16_t handle){
     return att_persistent_ccc_uuid16 == (uint16_t)GATT_CLIENT_CHARACTERISTICS_CONFIGURATION;
 }
 
+#ifdef ENABLE_GATT_ROBUST_CACHING
+// GATT Database Hash generator over current ATT DB, see att_db_util_hash_* for ATT DB created by att_db_util
+static att_iterator_t att_database_hash_it;
+static uint16_t att_database_hash_offset;
+static uint16_t att_database_hash_bytes_available;
+
+static uint16_t att_database_hash_bytes_for_attribute(att_iterator_t * it){
+    if (it->handle == 0u){
+        return 0u;
+    }
+    if ((it->flags & (uint16_t)ATT_PROPERTY_UUID128) != 0u){
+        return 0u;
+    }
+    /* «Primary Service», «Secondary Service», «Included Service», «Characteristic», or «Characteristic Extended Properties» */
+    /*  «Characteristic User Description», «Client Characteristic Configuration», «Server Characteristic Configuration»,
+     * «Characteristic Aggregate Format», «Characteristic Format» */
+    switch (little_endian_read_16(it->uuid, 0)){
+        case GATT_PRIMARY_SERVICE_UUID:
+        case GATT_SECONDARY_SERVICE_UUID:
+        case GATT_INCLUDE_SERVICE_UUID:
+        case GATT_CHARACTERISTICS_UUID:
+        case GATT_CHARACTERISTIC_EXTENDED_PROPERTIES:
+            // handle + type + value
+            return 4u + it->value_len;
+        case GATT_CHARACTERISTIC_USER_DESCRIPTION:
+        case GATT_CLIENT_CHARACTERISTICS_CONFIGURATION:
+        case GATT_SERVER_CHARACTERISTICS_CONFIGURATION:
+        case GATT_CHARACTERISTIC_PRESENTATION_FORMAT:
+        case GATT_CHARACTERISTIC_AGGREGATE_FORMAT:
+            // handle + type
+            return 4u;
+        default:
+            return 0u;
+    }
+}
+
+uint16_t att_database_hash_len(void){
+    uint16_t len = 0;
+    att_iterator_t it;
+    att_iterator_init(&it);
+    while (att_iterator_has_next(&it)){
+        att_iterator_fetch_next(&it);
+        len += att_database_hash_bytes_for_attribute(&it);
+    }
+    return len;
+}
+
+void att_database_hash_init(void){
+    att_iterator_init(&att_database_hash_it);
+    att_database_hash_bytes_available = 0u;
+}
+
+uint8_t att_database_hash_get_next(void){
+    // find next hashable data blob
+    while (att_database_hash_bytes_available == 0u){
+        btstack_assert(att_iterator_has_next(&att_database_hash_it));
+        att_iterator_fetch_next(&att_database_hash_it);
+        att_database_hash_bytes_available = att_database_hash_bytes_for_attribute(&att_database_hash_it);
+        att_database_hash_offset = 0u;
+    }
+    // handle is stored right before uuid, followed by value
+    const uint8_t * data = att_database_hash_it.uuid - 2u;
+    att_database_hash_bytes_available--;
+    return data[att_database_hash_offset++];
+}
+#endif
+
 // att_read_callback helpers
 uint16_t att_read_callback_handle_blob(const uint8_t * blob, uint16_t blob_size, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
     btstack_assert(blob != NULL);
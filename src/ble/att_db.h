@@ -187,6 +187,13 @@ void att_set_db(uint8_t const * db);
  */
 void att_set_read_callback(att_read_callback_t callback);
 
+/**
+ * @brief read value of given attribute via read callback even if it is not marked as DYNAMIC
+ * @note used by ATT Server to provide Database Hash calculated at runtime
+ * @param value_handle or 0 to disable
+ */
+void att_set_read_callback_value_handle(uint16_t value_handle);
+
 /**
  * @brief set callback for write of dynamic attributes
  * @param callback
@@ -350,6 +357,13 @@ uint16_t gatt_server_get_descriptor_handle_for_characteristic_with_uuid16(uint16
  */
 uint16_t gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(uint16_t start_handle, uint16_t end_handle, uint16_t characteristic_uuid16);
 
+/**
+ * @brief Get client configuration handle for characteristic value handle.
+ * @param value_handle
+ * @return 0 if not found
+ */
+uint16_t gatt_server_get_client_configuration_handle_for_value_handle(uint16_t value_handle);
+
 /**
  * @brief Get server configuration handle for characteristic.
  * @param start_handle
@@ -399,6 +413,33 @@ uint16_t gatt_server_get_client_configuration_handle_for_characteristic_with_uui
  */
 bool att_is_persistent_ccc(uint16_t handle);
 
+/**
+ * @brief Check if Write Without Response to handle is permitted for connection
+ * @param att_connection
+ * @param handle
+ * @return ATT_ERROR_SUCCESS if attribute exists, supports Write Without Response and security requirements are met
+ */
+uint8_t att_validate_write_command(att_connection_t * att_connection, uint16_t handle);
+
+#ifdef ENABLE_GATT_ROBUST_CACHING
+/**
+ * @brief Get number of bytes of current ATT DB that are included in GATT Database Hash
+ * @return len
+ */
+uint16_t att_database_hash_len(void);
+
+/**
+ * @brief Init generator for GATT Database Hash over current ATT DB
+ */
+void att_database_hash_init(void);
+
+/**
+ * @brief Get next byte from generator for GATT Database Hash
+ * @return byte
+ */
+uint8_t att_database_hash_get_next(void);
+#endif
+
 
 
 // auto-pts testing, returns response size
@@ -67,6 +67,11 @@
 #include "ble/sm.h"
 #endif
 
+#ifdef ENABLE_GATT_ROBUST_CACHING
+#include "bluetooth_gatt.h"
+#include "btstack_crypto.h"
+#endif
+
 #ifdef ENABLE_TESTING_SUPPORT
 #include <stdio.h>
 #endif
@@ -82,6 +87,18 @@ static void att_server_handle_can_send_now(void);
 static void att_server_persistent_ccc_restore(hci_connection_t * hci_connection);
 static void att_server_persistent_ccc_clear(hci_connection_t * hci_connection);
 static void att_server_handle_att_pdu(hci_connection_t * hci_connection, uint8_t * packet, uint16_t size);
+static void att_server_notify_all_done(hci_connection_t * hci_connection, uint8_t status);
+static bool att_server_write_command_sink_handle(hci_connection_t * hci_connection, const uint8_t * packet, uint16_t size);
+#ifdef ENABLE_GATT_ROBUST_CACHING
+static void att_server_robust_caching_init_connection(att_server_t * att_server);
+static void att_server_robust_caching_restore(hci_connection_t * hci_connection);
+static void att_server_robust_caching_store(hci_connection_t * hci_connection);
+static void att_server_robust_caching_clear(hci_connection_t * hci_connection);
+static void att_server_robust_caching_set_change_aware(hci_connection_t * hci_connection);
+static bool att_server_robust_caching_change_unaware(att_server_t * att_server);
+static bool att_server_robust_caching_out_of_sync(hci_connection_t * hci_connection);
+static void att_server_robust_caching_track_ccc(hci_con_handle_t con_handle, uint16_t att_handle, uint16_t value);
+#endif
 
 typedef enum {
     ATT_SERVER_RUN_PHASE_1_REQUESTS = 0,
@@ -94,14 +111,35 @@ typedef struct {
     uint32_t seq_nr;
     uint16_t att_handle;
     uint8_t  value;
-    uint8_t  device_index;
+    uint16_t device_index;
 } persistent_ccc_entry_t;
 
+// entry with 8-bit device index, stored by earlier versions
+typedef struct {
+    uint32_t seq_nr;
+    uint16_t att_handle;
+    uint8_t  value;
+    uint8_t  device_index;
+} persistent_ccc_entry_v1_t;
+
+#ifdef ENABLE_GATT_ROBUST_CACHING
+// Client Supported Features: Robust Caching, Enhanced ATT Bearer, Multiple Handle Value Notifications
+#define GATT_CLIENT_SUPPORTED_FEATURES_ROBUST_CACHING 0x01u
+#define GATT_CLIENT_SUPPORTED_FEATURES_MASK           0x07u
+
+// Database Hash the bonded client is aware of and its Client Supported Features
+typedef struct {
+    uint8_t db_hash[16];
+    uint8_t client_supported_features;
+} persistent_robust_caching_entry_t;
+#endif
+
 // global
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 static btstack_packet_callback_registration_t sm_event_callback_registration;
 static btstack_packet_handler_t               att_client_packet_handler = NULL;
 static btstack_linked_list_t                  service_handlers;
+static btstack_linked_list_t                  write_command_sinks;
 static btstack_context_callback_registration_t att_client_waiting_for_can_send_registration;
 
 static att_read_callback_t                    att_server_client_read_callback;
@@ -110,6 +148,29 @@ static att_write_callback_t                   att_server_client_write_callback;
 // round robin
 static hci_con_handle_t att_server_last_can_send_now = HCI_CON_HANDLE_INVALID;
 
+// multicast notification: results are collected in completion event
+#define ATT_SERVER_NOTIFY_ALL_EVENT_HEADER_SIZE 5u
+static bool           att_server_notify_all_active;
+static uint8_t        att_server_notify_all_header[3];
+static const uint8_t * att_server_notify_all_value;
+static uint16_t       att_server_notify_all_value_len;
+static uint8_t        att_server_notify_all_num_pending;
+static uint8_t        att_server_notify_all_event[255];
+static uint8_t        att_server_notify_all_event_size;
+
+#ifdef ENABLE_GATT_ROBUST_CACHING
+static btstack_crypto_aes128_cmac_t att_server_db_hash_request;
+static uint8_t  att_server_db_hash[16];
+static bool     att_server_db_hash_valid;
+static bool     att_server_db_hash_active;
+static bool     att_server_db_hash_restart;
+static bool     att_server_db_hash_initialized;
+static uint16_t att_server_client_supported_features_handle;
+static uint16_t att_server_database_hash_handle;
+static uint16_t att_server_service_changed_handle;
+static uint16_t att_server_service_changed_ccc_handle;
+#endif
+
 #ifdef ENABLE_LE_SIGNED_WRITE
 static hci_connection_t * hci_connection_for_state(att_server_state_t state){
     btstack_linked_list_iterator_t it;
@@ -287,6 +348,14 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                     if (att_connection->max_mtu > ATT_REQUEST_BUFFER_SIZE){
                         att_connection->max_mtu = ATT_REQUEST_BUFFER_SIZE;
                     }
+#ifdef ENABLE_GATT_ROBUST_CACHING
+                    att_server_robust_caching_init_connection(att_server);
+#endif
+#ifdef ENABLE_ATT_NOTIFICATION_QUEUE
+                    att_server->notification_queue = NULL;
+#endif
+                    att_server->write_command_sink_validated_handle = 0u;
+                    att_server->write_command_sink_busy = false;
 
                     log_info("Connection opened %s, l2cap cid %04x, mtu %u", bd_addr_to_str(address), att_server->l2cap_cid, att_connection->mtu);
 
@@ -303,6 +372,9 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                     // restore persisten ccc if encrypted
                     if ( gap_security_level(con_handle) >= LEVEL_2){
                         att_server_persistent_ccc_restore(hci_connection);
+#ifdef ENABLE_GATT_ROBUST_CACHING
+                        att_server_robust_caching_restore(hci_connection);
+#endif
                     }
                     // TODO: what to do about le device db?
                     att_server->pairing_active = 0;
@@ -338,6 +410,14 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                             att_server->ir_le_device_db_index = sm_le_device_index(con_handle);
                             att_server->ir_lookup_active = 0u;
                             att_server->pairing_active = 0u;
+#ifdef ENABLE_GATT_ROBUST_CACHING
+                            att_server_robust_caching_init_connection(att_server);
+#endif
+#ifdef ENABLE_ATT_NOTIFICATION_QUEUE
+                            att_server->notification_queue = NULL;
+#endif
+                            att_server->write_command_sink_validated_handle = 0u;
+                            att_server->write_command_sink_busy = false;
                             // notify all - old
                             att_emit_event_to_all(packet, size);
                             // notify all - new
@@ -365,10 +445,14 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                     att_connection->secure_connection = gap_secure_connection(con_handle) ? 1 : 0;
                     log_info("encrypted key size %u, authenticated %u, secure connection %u",
                         att_connection->encryption_key_size, att_connection->authenticated, att_connection->secure_connection);
+                    att_server->write_command_sink_validated_handle = 0u;
                     if (hci_event_packet_get_type(packet) == HCI_EVENT_ENCRYPTION_CHANGE){
                         // restore CCC values when encrypted for LE Connections
                         if (hci_event_encryption_change_get_encryption_enabled(packet)){
                             att_server_persistent_ccc_restore(hci_connection);
+#ifdef ENABLE_GATT_ROBUST_CACHING
+                            att_server_robust_caching_restore(hci_connection);
+#endif
                         } 
                     }
                     att_run_for_context(hci_connection);
@@ -385,6 +469,12 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                     att_connection->con_handle = 0;
                     att_server->pairing_active = 0;
                     att_server->state = ATT_SERVER_IDLE;
+#ifdef ENABLE_ATT_NOTIFICATION_QUEUE
+                    att_server->notification_queue = NULL;
+#endif
+                    if (att_server->notify_all_pending){
+                        att_server_notify_all_done(hci_connection, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
+                    }
                     if (att_server->value_indication_handle != 0u){
                         btstack_run_loop_remove_timer(&att_server->value_indication_timer);
                         uint16_t att_handle = att_server->value_indication_handle;
@@ -442,6 +532,9 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                     log_info("SM Pairing started");
                     if (att_server->ir_le_device_db_index < 0) break;
                     att_server_persistent_ccc_clear(hci_connection);
+#ifdef ENABLE_GATT_ROBUST_CACHING
+                    att_server_robust_caching_clear(hci_connection);
+#endif
                     // index not valid anymore
                     att_server->ir_le_device_db_index = -1;
                     break;
@@ -454,6 +547,9 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                     att_server = &hci_connection->att_server;
                     att_server->pairing_active = 0;
                     att_server->ir_le_device_db_index = sm_event_identity_created_get_index(packet);
+#ifdef ENABLE_GATT_ROBUST_CACHING
+                    att_server_robust_caching_store(hci_connection);
+#endif
                     att_run_for_context(hci_connection);
                     break;
 
@@ -475,6 +571,7 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                     att_server = &hci_connection->att_server;
                     att_connection = &hci_connection->att_connection;
                     att_connection->authorized = sm_event_authorization_result_get_authorization_result(packet);
+                    att_server->write_command_sink_validated_handle = 0u;
                     att_server_request_can_send_now(hci_connection);
                 	break;
                 }
@@ -540,7 +637,24 @@ static int att_server_process_validated_request(hci_connection_t * hci_connectio
 
     l2cap_reserve_packet_buffer();
     uint8_t * att_response_buffer = l2cap_get_outgoing_buffer();
-    uint16_t  att_response_size   = att_handle_request(att_connection, att_server->request_buffer, att_server->request_size, att_response_buffer);
+    uint16_t  att_response_size;
+#ifdef ENABLE_GATT_ROBUST_CACHING
+    if (att_server_robust_caching_out_of_sync(hci_connection)){
+        // commands from change-unaware clients are ignored
+        att_response_size = 0u;
+        uint8_t request_opcode = att_server->request_buffer[0];
+        if ((request_opcode & 0x40u) == 0u){
+            att_response_buffer[0] = ATT_ERROR_RESPONSE;
+            att_response_buffer[1] = request_opcode;
+            little_endian_store_16(att_response_buffer, 2, 0);
+            att_response_buffer[4] = ATT_ERROR_DATABASE_OUT_OF_SYNC;
+            att_response_size = 5u;
+        }
+    } else
+#endif
+    {
+        att_response_size = att_handle_request(att_connection, att_server->request_buffer, att_server->request_size, att_response_buffer);
+    }
 
 #ifdef ENABLE_ATT_DELAYED_RESPONSE
     if ((att_response_size == ATT_READ_RESPONSE_PENDING) || (att_response_size == ATT_INTERNAL_WRITE_RESPONSE_PENDING)){
@@ -812,6 +926,12 @@ static void att_server_handle_att_pdu(hci_connection_t * hci_connection, uint8_t
         btstack_run_loop_remove_timer(&att_server->value_indication_timer);
         uint16_t att_handle = att_server->value_indication_handle;
         att_server->value_indication_handle = 0u;    
+#ifdef ENABLE_GATT_ROBUST_CACHING
+        // client becomes change-aware when it confirms the last Service Changed indication
+        if ((att_handle == att_server_service_changed_handle) && (att_server->service_changed_start_handle == 0u)){
+            att_server_robust_caching_set_change_aware(hci_connection);
+        }
+#endif
         att_handle_value_indication_notify_client(0u, att_connection->con_handle, att_handle);
         att_server_request_can_send_now(hci_connection);
         return;
@@ -820,6 +940,10 @@ static void att_server_handle_att_pdu(hci_connection_t * hci_connection, uint8_t
     // directly process command
     // note: signed write cannot be handled directly as authentication needs to be verified
     if (opcode == ATT_WRITE_COMMAND){
+#ifdef ENABLE_GATT_ROBUST_CACHING
+        if (att_server_robust_caching_change_unaware(att_server)) return;
+#endif
+        if (att_server_write_command_sink_handle(hci_connection, packet, size)) return;
         att_handle_request(att_connection, packet, size, NULL);
         return;
     }
@@ -897,6 +1021,24 @@ static uint32_t att_server_persistent_ccc_tag_for_index(uint8_t index){
     return ('B' << 24u) | ('T' << 16u) | ('C' << 8u) | index;
 }
 
+// @return true if tag contains a valid entry
+static bool att_server_persistent_ccc_fetch(const btstack_tlv_t * tlv_impl, void * tlv_context, uint32_t tag, persistent_ccc_entry_t * entry){
+    int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) entry, sizeof(persistent_ccc_entry_t));
+    if (len == (int) sizeof(persistent_ccc_entry_t)){
+        return true;
+    }
+    if (len == (int) sizeof(persistent_ccc_entry_v1_t)){
+        persistent_ccc_entry_v1_t entry_v1;
+        (void) memcpy(&entry_v1, entry, sizeof(entry_v1));
+        entry->seq_nr       = entry_v1.seq_nr;
+        entry->att_handle   = entry_v1.att_handle;
+        entry->value        = entry_v1.value;
+        entry->device_index = entry_v1.device_index;
+        return true;
+    }
+    return false;
+}
+
 static void att_server_persistent_ccc_write(hci_con_handle_t con_handle, uint16_t att_handle, uint16_t value){
     // lookup att_server instance
     hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
@@ -923,10 +1065,9 @@ static void att_server_persistent_ccc_write(hci_con_handle_t con_handle, uint16_
     persistent_ccc_entry_t entry;
     for (index=0; index<NVN_NUM_GATT_SERVER_CCC; index++){
         uint32_t tag = att_server_persistent_ccc_tag_for_index(index);
-        int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) &entry, sizeof(persistent_ccc_entry_t));
 
         // empty/invalid tag
-        if (len != sizeof(persistent_ccc_entry_t)){
+        if (att_server_persistent_ccc_fetch(tlv_impl, tlv_context, tag, &entry) == false){
             tag_for_empty = tag;
             continue;
         }
@@ -983,7 +1124,7 @@ static void att_server_persistent_ccc_write(hci_con_handle_t con_handle, uint16_
     }
     // store ccc tag
     entry.seq_nr       = highest_seq_nr + 1u;
-    entry.device_index = le_device_index;
+    entry.device_index = (uint16_t) le_device_index;
     entry.att_handle   = att_handle;
     entry.value        = (uint8_t) value;
     int result = tlv_impl->store_tag(tlv_context, tag_to_use, (uint8_t *) &entry, sizeof(persistent_ccc_entry_t));
@@ -1010,8 +1151,7 @@ static void att_server_persistent_ccc_clear(hci_connection_t * hci_connection){
     persistent_ccc_entry_t entry;
     for (index=0;index<NVN_NUM_GATT_SERVER_CCC;index++){
         uint32_t tag = att_server_persistent_ccc_tag_for_index(index);
-        int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) &entry, sizeof(persistent_ccc_entry_t));
-        if (len != sizeof(persistent_ccc_entry_t)) continue;
+        if (att_server_persistent_ccc_fetch(tlv_impl, tlv_context, tag, &entry) == false) continue;
         if (entry.device_index != le_device_index) continue;
         // delete entry
         log_info("CCC Index %u: Delete", index);
@@ -1038,13 +1178,15 @@ static void att_server_persistent_ccc_restore(hci_connection_t * hci_connection)
     persistent_ccc_entry_t entry;
     for (index=0;index<NVN_NUM_GATT_SERVER_CCC;index++){
         uint32_t tag = att_server_persistent_ccc_tag_for_index(index);
-        int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) &entry, sizeof(persistent_ccc_entry_t));
-        if (len != sizeof(persistent_ccc_entry_t)) continue;
+        if (att_server_persistent_ccc_fetch(tlv_impl, tlv_context, tag, &entry) == false) continue;
         if (entry.device_index != le_device_index) continue;
         // simulate write callback
         uint16_t attribute_handle = entry.att_handle;
         uint8_t  value[2];
         little_endian_store_16(value, 0, entry.value);
+#ifdef ENABLE_GATT_ROBUST_CACHING
+        att_server_robust_caching_track_ccc(att_connection->con_handle, attribute_handle, entry.value);
+#endif
         att_write_callback_t callback = att_server_write_callback_for_handle(attribute_handle);
         if (!callback) continue;
         log_info("CCC Index %u: Set Attribute handle 0x%04x to value 0x%04x", index, attribute_handle, entry.value );
@@ -1055,6 +1197,327 @@ static void att_server_persistent_ccc_restore(hci_connection_t * hci_connection)
 // persistent CCC writes
 // ---------------------
 
+#ifdef ENABLE_GATT_ROBUST_CACHING
+// ---------------------
+// GATT Robust Caching
+static uint32_t att_server_robust_caching_tag_for_index(uint16_t index){
+    if (index < 256u){
+        return ('B' << 24u) | ('T' << 16u) | ('R' << 8u) | index;
+    }
+    // entries above 255 use 16-bit index, see le_device_db_tlv
+    return ('B' << 24u) | ('R' << 16u) | index;
+}
+
+static void att_server_robust_caching_init_connection(att_server_t * att_server){
+    // clients are change-aware on connection, bonded clients are re-evaluated after encryption
+    att_server->client_supported_features = 0;
+    att_server->change_aware = true;
+    att_server->change_aware_on_next_request = false;
+    att_server->service_changed_enabled = false;
+    att_server->service_changed_start_handle = 0;
+    att_server->service_changed_end_handle = 0;
+}
+
+static void att_server_robust_caching_lookup_handles(void){
+    att_server_client_supported_features_handle = 0;
+    att_server_database_hash_handle = 0;
+    att_server_service_changed_handle = 0;
+    att_server_service_changed_ccc_handle = 0;
+    att_set_read_callback_value_handle(0);
+
+    uint16_t start_handle;
+    uint16_t end_handle;
+    if (!gatt_server_get_handle_range_for_service_with_uuid16(ORG_BLUETOOTH_SERVICE_GENERIC_ATTRIBUTE, &start_handle, &end_handle)) return;
+
+    att_server_client_supported_features_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(start_handle, end_handle, ORG_BLUETOOTH_CHARACTERISTIC_CLIENT_SUPPORTED_FEATURES);
+    att_server_database_hash_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(start_handle, end_handle, ORG_BLUETOOTH_CHARACTERISTIC_DATABASE_HASH);
+    att_server_service_changed_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(start_handle, end_handle, ORG_BLUETOOTH_CHARACTERISTIC_GATT_SERVICE_CHANGED);
+    att_server_service_changed_ccc_handle = gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(start_handle, end_handle, ORG_BLUETOOTH_CHARACTERISTIC_GATT_SERVICE_CHANGED);
+    log_info("Robust Caching: client supported features 0x%04x, database hash 0x%04x, service changed 0x%04x",
+             att_server_client_supported_features_handle, att_server_database_hash_handle, att_server_service_changed_handle);
+
+    // serve Database Hash calculated at runtime instead of value from .gatt file
+    att_set_read_callback_value_handle(att_server_database_hash_handle);
+}
+
+// database changes affect LE connections and GATT over BR/EDR bearers
+static bool att_server_robust_caching_att_bearer(hci_connection_t * hci_connection){
+#ifdef ENABLE_GATT_OVER_CLASSIC
+    if (hci_connection->att_server.l2cap_cid != 0u) return true;
+#endif
+    switch (hci_connection->address_type){
+        case BD_ADDR_TYPE_LE_PUBLIC:
+        case BD_ADDR_TYPE_LE_RANDOM:
+        case BD_ADDR_TYPE_LE_PRIVAT_FALLBACK_PUBLIC:
+        case BD_ADDR_TYPE_LE_PRIVAT_FALLBACK_RANDOM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void att_server_robust_caching_store(hci_connection_t * hci_connection){
+    att_server_t * att_server = &hci_connection->att_server;
+    int le_device_index = att_server->ir_le_device_db_index;
+    // check if bonded
+    if (le_device_index < 0) return;
+    // hash gets stored when calculation is complete
+    if (!att_server_db_hash_valid) return;
+    // get btstack_tlv
+    const btstack_tlv_t * tlv_impl = NULL;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (!tlv_impl) return;
+
+    uint32_t tag = att_server_robust_caching_tag_for_index((uint16_t) le_device_index);
+    persistent_robust_caching_entry_t entry;
+    if (att_server->change_aware){
+        (void)memcpy(entry.db_hash, att_server_db_hash, sizeof(entry.db_hash));
+    } else {
+        // keep hash of database the client is aware of
+        int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) &entry, sizeof(persistent_robust_caching_entry_t));
+        if (len != sizeof(persistent_robust_caching_entry_t)){
+            memset(entry.db_hash, 0, sizeof(entry.db_hash));
+        }
+    }
+    entry.client_supported_features = att_server->client_supported_features;
+    log_info("Robust Caching: store for le device id %d, change aware %u, client supported features 0x%02x",
+             le_device_index, (int) att_server->change_aware, att_server->client_supported_features);
+    int result = tlv_impl->store_tag(tlv_context, tag, (const uint8_t *) &entry, sizeof(persistent_robust_caching_entry_t));
+    if (result != 0){
+        log_error("Store tag for le device id %d failed", le_device_index);
+    }
+}
+
+static void att_server_robust_caching_clear(hci_connection_t * hci_connection){
+    att_server_t * att_server = &hci_connection->att_server;
+    int le_device_index = att_server->ir_le_device_db_index;
+    // check if bonded
+    if (le_device_index < 0) return;
+    // get btstack_tlv
+    const btstack_tlv_t * tlv_impl = NULL;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (!tlv_impl) return;
+    log_info("Robust Caching: clear for le device id %d", le_device_index);
+    tlv_impl->delete_tag(tlv_context, att_server_robust_caching_tag_for_index((uint16_t) le_device_index));
+}
+
+static void att_server_robust_caching_send_service_changed(void * context){
+    hci_con_handle_t con_handle = (hci_con_handle_t) (uintptr_t) context;
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return;
+    att_server_t * att_server = &hci_connection->att_server;
+    if (att_server->service_changed_start_handle == 0u) return;
+
+    uint8_t value[4];
+    little_endian_store_16(value, 0, att_server->service_changed_start_handle);
+    little_endian_store_16(value, 2, att_server->service_changed_end_handle);
+    att_server->service_changed_start_handle = 0;
+    att_server->service_changed_end_handle = 0;
+    log_info("Robust Caching: send Service Changed 0x%04x-0x%04x", little_endian_read_16(value, 0), little_endian_read_16(value, 2));
+    (void) att_server_indicate(con_handle, att_server_service_changed_handle, value, sizeof(value));
+}
+
+static void att_server_robust_caching_service_changed(hci_connection_t * hci_connection, uint16_t start_handle, uint16_t end_handle){
+    att_server_t * att_server = &hci_connection->att_server;
+    att_server->change_aware = false;
+    att_server->change_aware_on_next_request = false;
+
+    if (att_server_service_changed_handle == 0u) return;
+    if (!att_server->service_changed_enabled) return;
+
+    // merge with pending range
+    if (att_server->service_changed_start_handle != 0u){
+        start_handle = (uint16_t) btstack_min(start_handle, att_server->service_changed_start_handle);
+        end_handle   = (uint16_t) btstack_max(end_handle,   att_server->service_changed_end_handle);
+    }
+    att_server->service_changed_start_handle = start_handle;
+    att_server->service_changed_end_handle   = end_handle;
+
+    hci_con_handle_t con_handle = hci_connection->att_connection.con_handle;
+    att_server->service_changed_registration.callback = &att_server_robust_caching_send_service_changed;
+    att_server->service_changed_registration.context  = (void*) (uintptr_t) con_handle;
+    // already queued if not added
+    (void) att_server_request_to_send_indication(&att_server->service_changed_registration, con_handle);
+}
+
+static void att_server_robust_caching_restore(hci_connection_t * hci_connection){
+    att_server_t * att_server = &hci_connection->att_server;
+    int le_device_index = att_server->ir_le_device_db_index;
+    // check if bonded
+    if (le_device_index < 0) return;
+    // restore is retried when hash calculation is complete
+    if (!att_server_db_hash_valid) return;
+    // get btstack_tlv
+    const btstack_tlv_t * tlv_impl = NULL;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (!tlv_impl) return;
+
+    persistent_robust_caching_entry_t entry;
+    uint32_t tag = att_server_robust_caching_tag_for_index((uint16_t) le_device_index);
+    int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) &entry, sizeof(persistent_robust_caching_entry_t));
+    bool change_aware;
+    if (len == sizeof(persistent_robust_caching_entry_t)){
+        att_server->client_supported_features = entry.client_supported_features;
+        change_aware = memcmp(entry.db_hash, att_server_db_hash, sizeof(att_server_db_hash)) == 0;
+    } else {
+        // database state known by client is unknown
+        change_aware = false;
+    }
+    log_info("Robust Caching: restore for le device id %d, change aware %u, client supported features 0x%02x",
+             le_device_index, (int) change_aware, att_server->client_supported_features);
+    if (change_aware) return;
+
+    // database might have changed while disconnected
+    att_server_robust_caching_service_changed(hci_connection, 0x0001, 0xffff);
+}
+
+static void att_server_robust_caching_set_change_aware(hci_connection_t * hci_connection){
+    att_server_t * att_server = &hci_connection->att_server;
+    att_server->change_aware_on_next_request = false;
+    if (att_server->change_aware) return;
+    log_info("Robust Caching: con handle 0x%04x is change-aware", hci_connection->att_connection.con_handle);
+    att_server->change_aware = true;
+    att_server_robust_caching_store(hci_connection);
+}
+
+static bool att_server_robust_caching_change_unaware(att_server_t * att_server){
+    if (att_server->change_aware) return false;
+    return (att_server->client_supported_features & GATT_CLIENT_SUPPORTED_FEATURES_ROBUST_CACHING) != 0u;
+}
+
+// returns true if request from change-unaware client has to be rejected with Database Out Of Sync
+static bool att_server_robust_caching_out_of_sync(hci_connection_t * hci_connection){
+    att_server_t * att_server = &hci_connection->att_server;
+    if (att_server_robust_caching_change_unaware(att_server) == false) return false;
+
+    // client becomes change-aware with the request that follows a Database Out Of Sync error or a Database Hash read
+    if (att_server->change_aware_on_next_request){
+        att_server_robust_caching_set_change_aware(hci_connection);
+        return false;
+    }
+
+    const uint8_t * request = att_server->request_buffer;
+    uint16_t request_size = att_server->request_size;
+    uint8_t  opcode = request[0];
+    switch (opcode){
+        case ATT_EXCHANGE_MTU_REQUEST:
+            return false;
+        case ATT_READ_BY_TYPE_REQUEST:
+            if ((request_size == 7u) && (little_endian_read_16(request, 5) == ORG_BLUETOOTH_CHARACTERISTIC_DATABASE_HASH)){
+                att_server->change_aware_on_next_request = true;
+                return false;
+            }
+            break;
+        case ATT_READ_REQUEST:
+            if ((att_server_database_hash_handle != 0u) && (request_size == 3u) && (little_endian_read_16(request, 1) == att_server_database_hash_handle)){
+                att_server->change_aware_on_next_request = true;
+                return false;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if ((opcode & 0x40u) == 0u){
+        att_server->change_aware_on_next_request = true;
+    }
+    return true;
+}
+
+static void att_server_robust_caching_track_ccc(hci_con_handle_t con_handle, uint16_t att_handle, uint16_t value){
+    if (att_handle == 0u) return;
+    if (att_handle != att_server_service_changed_ccc_handle) return;
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return;
+    att_server_t * att_server = &hci_connection->att_server;
+    att_server->service_changed_enabled = (value & GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_INDICATION) != 0u;
+}
+
+static uint16_t att_server_robust_caching_read_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    if (attribute_handle == att_server_database_hash_handle){
+        // Database Hash is not known during calculation
+        if (!att_server_db_hash_valid) return ATT_READ_ERROR_CODE_OFFSET + ATT_ERROR_UNLIKELY_ERROR;
+        uint8_t db_hash[16];
+        reverse_128(att_server_db_hash, db_hash);
+        return att_read_callback_handle_blob(db_hash, sizeof(db_hash), offset, buffer, buffer_size);
+    }
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return 0;
+    return att_read_callback_handle_byte(hci_connection->att_server.client_supported_features, offset, buffer, buffer_size);
+}
+
+static int att_server_robust_caching_write_client_supported_features(hci_con_handle_t con_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return 0;
+    att_server_t * att_server = &hci_connection->att_server;
+    if (offset != 0u) return ATT_ERROR_INVALID_OFFSET;
+    if (buffer_size == 0u) return ATT_ERROR_INVALID_ATTRIBUTE_VALUE_LENGTH;
+    // additional octets are ignored, only defined features are stored
+    uint8_t client_supported_features = buffer[0] & GATT_CLIENT_SUPPORTED_FEATURES_MASK;
+    // features cannot be disabled
+    if ((att_server->client_supported_features & ~client_supported_features) != 0u) return ATT_ERROR_VALUE_NOT_ALLOWED;
+    if (att_server->client_supported_features == client_supported_features) return 0;
+    att_server->client_supported_features = client_supported_features;
+    att_server_robust_caching_store(hci_connection);
+    return 0;
+}
+
+static uint8_t att_server_db_hash_get(uint16_t offset){
+    UNUSED(offset);
+    return att_database_hash_get_next();
+}
+
+static void att_server_db_hash_calculated(void * arg);
+
+static void att_server_db_hash_calc(void){
+    static const uint8_t zero_key[16] = { 0 };
+    att_server_db_hash_valid = false;
+    if (att_server_db_hash_active){
+        att_server_db_hash_restart = true;
+        return;
+    }
+    att_server_db_hash_active = true;
+    att_database_hash_init();
+    btstack_crypto_aes128_cmac_generator(&att_server_db_hash_request, zero_key, att_database_hash_len(), &att_server_db_hash_get, att_server_db_hash, &att_server_db_hash_calculated, NULL);
+}
+
+static void att_server_db_hash_calculated(void * arg){
+    UNUSED(arg);
+    att_server_db_hash_active = false;
+    if (att_server_db_hash_restart){
+        att_server_db_hash_restart = false;
+        att_server_db_hash_calc();
+        return;
+    }
+    att_server_db_hash_valid = true;
+    log_info("Robust Caching: database hash");
+    log_info_hexdump(att_server_db_hash, sizeof(att_server_db_hash));
+
+    // restore bonded clients that got encrypted before the initial hash was ready, store hash for change-aware clients otherwise
+    bool initial = att_server_db_hash_initialized == false;
+    att_server_db_hash_initialized = true;
+    btstack_linked_list_iterator_t it;
+    hci_connections_get_iterator(&it);
+    while(btstack_linked_list_iterator_has_next(&it)){
+        hci_connection_t * hci_connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        if (!att_server_robust_caching_att_bearer(hci_connection)) continue;
+        if (initial){
+            if (hci_connection->att_connection.encryption_key_size == 0u) continue;
+            att_server_robust_caching_restore(hci_connection);
+        } else {
+            if (!hci_connection->att_server.change_aware) continue;
+            att_server_robust_caching_store(hci_connection);
+        }
+    }
+}
+
+// GATT Robust Caching
+// ---------------------
+#endif
+
 // gatt service management
 static att_service_handler_t * att_service_handler_for_handle(uint16_t handle){
     btstack_linked_list_iterator_t it;
@@ -1113,6 +1576,14 @@ static uint8_t att_validate_prepared_write(hci_con_handle_t con_handle){
 }
 
 static uint16_t att_server_read_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+#ifdef ENABLE_GATT_ROBUST_CACHING
+    if ((attribute_handle != 0u) && (attribute_handle == att_server_client_supported_features_handle)){
+        return att_server_robust_caching_read_callback(con_handle, attribute_handle, offset, buffer, buffer_size);
+    }
+    if ((attribute_handle != 0u) && (attribute_handle == att_server_database_hash_handle)){
+        return att_server_robust_caching_read_callback(con_handle, attribute_handle, offset, buffer, buffer_size);
+    }
+#endif
     att_read_callback_t callback = att_server_read_callback_for_handle(attribute_handle);
     if (!callback) return 0;
     return (*callback)(con_handle, attribute_handle, offset, buffer, buffer_size);
@@ -1130,6 +1601,15 @@ static int att_server_write_callback(hci_con_handle_t con_handle, uint16_t attri
             break;
     }
 
+#ifdef ENABLE_GATT_ROBUST_CACHING
+    if ((attribute_handle != 0u) && (attribute_handle == att_server_client_supported_features_handle)){
+        return att_server_robust_caching_write_client_supported_features(con_handle, offset, buffer, buffer_size);
+    }
+    if ((offset == 0u) && (buffer_size == 2u)){
+        att_server_robust_caching_track_ccc(con_handle, attribute_handle, little_endian_read_16(buffer, 0));
+    }
+#endif
+
     // track CCC writes
     if (att_is_persistent_ccc(attribute_handle) && (offset == 0u) && (buffer_size == 2u)){
         att_server_persistent_ccc_write(con_handle, attribute_handle, little_endian_read_16(buffer, 0));
@@ -1178,6 +1658,115 @@ void att_server_init(uint8_t const * db, att_read_callback_t read_callback, att_
     att_set_db(db);
     att_set_read_callback(att_server_read_callback);
     att_set_write_callback(att_server_write_callback);
+
+#ifdef ENABLE_GATT_ROBUST_CACHING
+    // calculate Database Hash
+    btstack_crypto_init();
+    att_server_robust_caching_lookup_handles();
+    att_server_db_hash_calc();
+#endif
+}
+
+void att_server_db_changed(uint8_t const * db, uint16_t start_handle, uint16_t end_handle){
+    att_set_db(db);
+#ifdef ENABLE_GATT_ROBUST_CACHING
+    att_server_robust_caching_lookup_handles();
+#else
+    UNUSED(start_handle);
+    UNUSED(end_handle);
+#endif
+
+    btstack_linked_list_iterator_t it;
+    hci_connections_get_iterator(&it);
+    while(btstack_linked_list_iterator_has_next(&it)){
+        hci_connection_t * hci_connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        // permissions of Write Without Response sinks need to be validated again
+        hci_connection->att_server.write_command_sink_validated_handle = 0u;
+#ifdef ENABLE_GATT_ROBUST_CACHING
+        // all clients become change-unaware, Service Changed is indicated if enabled
+        if (!att_server_robust_caching_att_bearer(hci_connection)) continue;
+        att_server_robust_caching_service_changed(hci_connection, start_handle, end_handle);
+#endif
+    }
+
+#ifdef ENABLE_GATT_ROBUST_CACHING
+    att_server_db_hash_calc();
+#endif
+}
+
+static att_server_write_command_sink_t * att_server_write_command_sink_for_handle(uint16_t value_handle){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &write_command_sinks);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        att_server_write_command_sink_t * sink = (att_server_write_command_sink_t*) btstack_linked_list_iterator_next(&it);
+        if (sink->value_handle == value_handle) return sink;
+    }
+    return NULL;
+}
+
+// returns true if Write Command was handled by sink
+static bool att_server_write_command_sink_handle(hci_connection_t * hci_connection, const uint8_t * packet, uint16_t size){
+    if (btstack_linked_list_empty(&write_command_sinks)) return false;
+    if (size < 3u) return false;
+
+    uint16_t value_handle = little_endian_read_16(packet, 1);
+    att_server_write_command_sink_t * sink = att_server_write_command_sink_for_handle(value_handle);
+    if (sink == NULL) return false;
+
+    att_server_t * att_server = &hci_connection->att_server;
+    att_connection_t * att_connection = &hci_connection->att_connection;
+
+    // validate permissions once, Write Commands are silently dropped if not permitted
+    if (att_server->write_command_sink_validated_handle != value_handle){
+        uint8_t status = att_validate_write_command(att_connection, value_handle);
+        if (status != ATT_ERROR_SUCCESS){
+            log_info("write command sink 0x%04x: not permitted, status 0x%02x", value_handle, status);
+            return true;
+        }
+        att_server->write_command_sink_validated_handle = value_handle;
+    }
+
+    // sink does not accept data until att_server_write_command_sink_ready is called
+    if (att_server->write_command_sink_busy){
+        log_info("write command sink 0x%04x: busy, drop write command", value_handle);
+        return true;
+    }
+
+    bool ready = (*sink->callback)(att_connection->con_handle, value_handle, &packet[3], size - 3u);
+    if (ready) return true;
+
+    att_server->write_command_sink_busy = true;
+#ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
+    (void) hci_acl_receive_pause(att_connection->con_handle);
+#else
+    log_info("write command sink 0x%04x: busy, no Controller to Host Flow Control", value_handle);
+#endif
+    return true;
+}
+
+void att_server_register_write_command_sink(att_server_write_command_sink_t * sink){
+    btstack_assert(sink->callback != NULL);
+    if (att_server_write_command_sink_for_handle(sink->value_handle) != NULL){
+        log_error("write command sink for handle 0x%04x already registered", sink->value_handle);
+        return;
+    }
+    btstack_linked_list_add(&write_command_sinks, (btstack_linked_item_t*) sink);
+}
+
+void att_server_unregister_write_command_sink(att_server_write_command_sink_t * sink){
+    btstack_linked_list_remove(&write_command_sinks, (btstack_linked_item_t*) sink);
+}
+
+uint8_t att_server_write_command_sink_ready(hci_con_handle_t con_handle){
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (hci_connection == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    att_server_t * att_server = &hci_connection->att_server;
+    if (att_server->write_command_sink_busy == false) return ERROR_CODE_SUCCESS;
+    att_server->write_command_sink_busy = false;
+#ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
+    (void) hci_acl_receive_resume(con_handle);
+#endif
+    return ERROR_CODE_SUCCESS;
 }
 
 void att_server_register_packet_handler(btstack_packet_handler_t handler){
@@ -1274,9 +1863,236 @@ uint8_t att_server_indicate(hci_con_handle_t con_handle, uint16_t attribute_hand
     return 0;
 }
 
+static void att_server_notify_all_emit_complete(void){
+    att_server_notify_all_active = false;
+    uint16_t attribute_handle = little_endian_read_16(att_server_notify_all_header, 1);
+    btstack_packet_handler_t packet_handler = att_server_packet_handler_for_handle(attribute_handle);
+    if (!packet_handler) return;
+    (*packet_handler)(HCI_EVENT_PACKET, 0, att_server_notify_all_event, att_server_notify_all_event_size);
+}
+
+static void att_server_notify_all_done(hci_connection_t * hci_connection, uint8_t status){
+    att_server_t * att_server = &hci_connection->att_server;
+    att_server->notify_all_pending = false;
+    att_server_notify_all_event[att_server->notify_all_result_index + 2u] = status;
+    att_server_notify_all_num_pending--;
+    if (att_server_notify_all_num_pending > 0u) return;
+    att_server_notify_all_emit_complete();
+}
+
+static void att_server_notify_all_send(void * context){
+    hci_con_handle_t con_handle = (hci_con_handle_t) (uintptr_t) context;
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return;
+    att_server_t * att_server = &hci_connection->att_server;
+    att_connection_t * att_connection = &hci_connection->att_connection;
+    if (!att_server->notify_all_pending) return;
+
+    // copy prepared PDU, truncate value to MTU
+    uint16_t value_len = (uint16_t) btstack_min(att_server_notify_all_value_len, att_connection->mtu - 3u);
+    l2cap_reserve_packet_buffer();
+    uint8_t * packet_buffer = l2cap_get_outgoing_buffer();
+    (void)memcpy(packet_buffer, att_server_notify_all_header, sizeof(att_server_notify_all_header));
+    (void)memcpy(&packet_buffer[3], att_server_notify_all_value, value_len);
+    uint16_t size = 3u + value_len;
+    uint8_t status;
+#ifdef ENABLE_GATT_OVER_CLASSIC
+    if (att_server->l2cap_cid != 0){
+        status = l2cap_send_prepared(att_server->l2cap_cid, size);
+    } else
+#endif
+    {
+        status = l2cap_send_prepared_connectionless(att_connection->con_handle, L2CAP_CID_ATTRIBUTE_PROTOCOL, size);
+    }
+    att_server_notify_all_done(hci_connection, status);
+}
+
+uint8_t att_server_notify_all(uint16_t attribute_handle, const uint8_t *value, uint16_t value_len){
+    if (att_server_notify_all_active) return ERROR_CODE_COMMAND_DISALLOWED;
+
+    uint16_t client_configuration_handle = gatt_server_get_client_configuration_handle_for_value_handle(attribute_handle);
+    if (client_configuration_handle == 0u) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+
+    // prepare Handle Value Notification PDU
+    att_server_notify_all_header[0] = ATT_HANDLE_VALUE_NOTIFICATION;
+    little_endian_store_16(att_server_notify_all_header, 1, attribute_handle);
+    att_server_notify_all_value     = value;
+    att_server_notify_all_value_len = value_len;
+
+    // collect subscribed connections
+    uint16_t pos = ATT_SERVER_NOTIFY_ALL_EVENT_HEADER_SIZE;
+    att_server_notify_all_num_pending = 0;
+    btstack_linked_list_iterator_t it;
+    hci_connections_get_iterator(&it);
+    while(btstack_linked_list_iterator_has_next(&it)){
+        hci_connection_t * hci_connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        att_server_t * att_server = &hci_connection->att_server;
+        hci_con_handle_t con_handle = hci_connection->att_connection.con_handle;
+        // CCC values are stored by the services and provided via read callback
+        uint8_t client_configuration[2];
+        uint16_t len = att_server_read_callback(con_handle, client_configuration_handle, 0, client_configuration, sizeof(client_configuration));
+        if (len != sizeof(client_configuration)) continue;
+        if ((little_endian_read_16(client_configuration, 0) & GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION) == 0u) continue;
+        if ((pos + 3u) > sizeof(att_server_notify_all_event)){
+            log_error("notify all: too many subscribed connections");
+            break;
+        }
+        little_endian_store_16(att_server_notify_all_event, pos, con_handle);
+        att_server_notify_all_event[pos + 2u] = ERROR_CODE_SUCCESS;
+        att_server->notify_all_pending = true;
+        att_server->notify_all_result_index = (uint8_t) pos;
+        att_server_notify_all_num_pending++;
+        pos += 3u;
+    }
+
+    att_server_notify_all_event[0] = ATT_EVENT_NOTIFY_ALL_COMPLETE;
+    att_server_notify_all_event[1] = (uint8_t) (pos - 2u);
+    little_endian_store_16(att_server_notify_all_event, 2, attribute_handle);
+    att_server_notify_all_event[4] = (uint8_t) (pos - ATT_SERVER_NOTIFY_ALL_EVENT_HEADER_SIZE);
+    att_server_notify_all_event_size = (uint8_t) pos;
+
+    att_server_notify_all_active = true;
+    if (att_server_notify_all_num_pending == 0u){
+        att_server_notify_all_emit_complete();
+        return ERROR_CODE_SUCCESS;
+    }
+
+    // request to send, callbacks might happen during this loop
+    hci_connections_get_iterator(&it);
+    while(btstack_linked_list_iterator_has_next(&it)){
+        hci_connection_t * hci_connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        att_server_t * att_server = &hci_connection->att_server;
+        if (!att_server->notify_all_pending) continue;
+        hci_con_handle_t con_handle = hci_connection->att_connection.con_handle;
+        att_server->notify_all_registration.callback = &att_server_notify_all_send;
+        att_server->notify_all_registration.context  = (void *) (uintptr_t) con_handle;
+        (void) att_server_request_to_send_notification(&att_server->notify_all_registration, con_handle);
+    }
+    return ERROR_CODE_SUCCESS;
+}
+
 uint16_t att_server_get_mtu(hci_con_handle_t con_handle){
     hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
     if (!hci_connection) return 0;
     att_connection_t * att_connection = &hci_connection->att_connection;
     return att_connection->mtu;
 }
+
+#ifdef ENABLE_ATT_NOTIFICATION_QUEUE
+static uint8_t * att_server_notification_queue_entry(att_server_notification_queue_t * queue, uint8_t index){
+    uint8_t slot = (uint8_t) ((queue->head + index) % queue->num_entries);
+    return &queue->storage[slot * ATT_SERVER_NOTIFICATION_QUEUE_ENTRY_SIZE(queue->max_value_len)];
+}
+
+static att_server_notification_queue_t * att_server_notification_queue_for_handle(hci_con_handle_t con_handle){
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return NULL;
+    return hci_connection->att_server.notification_queue;
+}
+
+static void att_server_notification_queue_send(void * context){
+    att_server_notification_queue_t * queue = (att_server_notification_queue_t *) context;
+    // queue got removed or replaced on disconnect
+    if (att_server_notification_queue_for_handle(queue->con_handle) != queue) return;
+    if (queue->count == 0u) return;
+
+    uint8_t * entry = att_server_notification_queue_entry(queue, 0);
+    uint16_t attribute_handle = little_endian_read_16(entry, 0);
+    uint16_t value_len        = little_endian_read_16(entry, 2);
+    uint8_t status = att_server_notify(queue->con_handle, attribute_handle, &entry[4], value_len);
+    if (status == ERROR_CODE_SUCCESS){
+        queue->head = (uint8_t) ((queue->head + 1u) % queue->num_entries);
+        queue->count--;
+        queue->statistics.sent++;
+    }
+
+    // request to send next one
+    if (queue->count > 0u){
+        att_server_request_to_send_notification(&queue->callback_registration, queue->con_handle);
+    }
+}
+
+uint8_t att_server_notification_queue_init(att_server_notification_queue_t * queue, hci_con_handle_t con_handle,
+                                           att_server_notification_queue_policy_t policy,
+                                           uint8_t * storage, uint16_t storage_size, uint16_t max_value_len){
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+
+    uint16_t num_entries = storage_size / ATT_SERVER_NOTIFICATION_QUEUE_ENTRY_SIZE(max_value_len);
+    if (num_entries == 0u) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    if (num_entries > 255u) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+
+    // drop pending can send now request of replaced or re-initialized queue before its registration is cleared
+    att_server_t * att_server = &hci_connection->att_server;
+    if (att_server->notification_queue != NULL){
+        btstack_linked_list_remove(&att_server->notification_requests, (btstack_linked_item_t *) &att_server->notification_queue->callback_registration);
+    }
+    btstack_linked_list_remove(&att_server->notification_requests, (btstack_linked_item_t *) &queue->callback_registration);
+
+    memset(queue, 0, sizeof(att_server_notification_queue_t));
+    queue->con_handle    = con_handle;
+    queue->policy        = policy;
+    queue->storage       = storage;
+    queue->max_value_len = max_value_len;
+    queue->num_entries   = (uint8_t) num_entries;
+    queue->callback_registration.callback = &att_server_notification_queue_send;
+    queue->callback_registration.context  = queue;
+    att_server->notification_queue = queue;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t att_server_notification_queue_add(hci_con_handle_t con_handle, uint16_t attribute_handle, const uint8_t * value, uint16_t value_len){
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    att_server_notification_queue_t * queue = hci_connection->att_server.notification_queue;
+    if (queue == NULL) return ERROR_CODE_COMMAND_DISALLOWED;
+    if (value_len > queue->max_value_len) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+
+    uint8_t * entry = NULL;
+    uint8_t index;
+    if (queue->policy == ATT_SERVER_NOTIFICATION_QUEUE_POLICY_LATEST_VALUE){
+        // replace queued value for same attribute handle
+        for (index = 0; index < queue->count; index++){
+            uint8_t * queued_entry = att_server_notification_queue_entry(queue, index);
+            if (little_endian_read_16(queued_entry, 0) == attribute_handle){
+                entry = queued_entry;
+                queue->statistics.coalesced++;
+                break;
+            }
+        }
+    }
+
+    if (entry == NULL){
+        if (queue->count == queue->num_entries){
+            queue->statistics.dropped++;
+            return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+        }
+        entry = att_server_notification_queue_entry(queue, queue->count);
+        queue->count++;
+    }
+
+    little_endian_store_16(entry, 0, attribute_handle);
+    little_endian_store_16(entry, 2, value_len);
+    (void)memcpy(&entry[4], value, value_len);
+    queue->statistics.queued++;
+
+    // already registered if not added
+    (void) att_server_request_to_send_notification(&queue->callback_registration, con_handle);
+    return ERROR_CODE_SUCCESS;
+}
+
+uint16_t att_server_notification_queue_get_count(hci_con_handle_t con_handle){
+    att_server_notification_queue_t * queue = att_server_notification_queue_for_handle(con_handle);
+    if (queue == NULL) return 0;
+    return queue->count;
+}
+
+uint8_t att_server_notification_queue_get_statistics(hci_con_handle_t con_handle, att_server_notification_queue_statistics_t * statistics){
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    att_server_notification_queue_t * queue = hci_connection->att_server.notification_queue;
+    if (queue == NULL) return ERROR_CODE_COMMAND_DISALLOWED;
+    *statistics = queue->statistics;
+    return ERROR_CODE_SUCCESS;
+}
+#endif
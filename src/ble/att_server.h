@@ -52,6 +52,51 @@
 extern "C" {
 #endif
 
+#ifdef ENABLE_ATT_NOTIFICATION_QUEUE
+typedef enum {
+    // queue notifications in order, new notifications are dropped if queue is full
+    ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO = 0,
+    // replace queued notification for the same attribute handle with latest value
+    ATT_SERVER_NOTIFICATION_QUEUE_POLICY_LATEST_VALUE,
+} att_server_notification_queue_policy_t;
+
+typedef struct {
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t coalesced;
+} att_server_notification_queue_statistics_t;
+
+// storage per queue entry: attribute handle, value len, value
+#define ATT_SERVER_NOTIFICATION_QUEUE_ENTRY_SIZE(max_value_len) (4u + (max_value_len))
+#define ATT_SERVER_NOTIFICATION_QUEUE_STORAGE_SIZE(num_entries, max_value_len) ((num_entries) * ATT_SERVER_NOTIFICATION_QUEUE_ENTRY_SIZE(max_value_len))
+
+typedef struct att_server_notification_queue {
+    // private
+    btstack_context_callback_registration_t callback_registration;
+    hci_con_handle_t con_handle;
+    att_server_notification_queue_policy_t policy;
+    uint8_t * storage;
+    uint16_t  max_value_len;
+    uint8_t   num_entries;
+    uint8_t   head;
+    uint8_t   count;
+    att_server_notification_queue_statistics_t statistics;
+} att_server_notification_queue_t;
+#endif
+
+/**
+ * @brief Write Without Response sink callback, data points directly into the received L2CAP packet
+ * @return false if no further data can be accepted right now, see att_server_write_command_sink_ready
+ */
+typedef bool (*att_server_write_command_sink_callback_t)(hci_con_handle_t con_handle, uint16_t value_handle, const uint8_t * data, uint16_t data_len);
+
+typedef struct {
+    btstack_linked_item_t item;
+    uint16_t value_handle;
+    att_server_write_command_sink_callback_t callback;
+} att_server_write_command_sink_t;
+
 /* API_START */
 /*
  * @brief setup ATT server
@@ -61,10 +106,21 @@ extern "C" {
  */
 void att_server_init(uint8_t const * db, att_read_callback_t read_callback, att_write_callback_t write_callback);
 
+/*
+ * @brief inform ATT server about modified attribute database, e.g. after adding services with att_db_util
+ * @note If ENABLE_GATT_ROBUST_CACHING is defined, the Database Hash is re-calculated, all clients become change-unaware
+ *       and a Service Changed indication for the given range is sent to clients that enabled it
+ * @param db attribute database
+ * @param start_handle of modified range
+ * @param end_handle of modified range
+ */
+void att_server_db_changed(uint8_t const * db, uint16_t start_handle, uint16_t end_handle);
+
 /*
  * @brief register packet handler for ATT server events:
  *        - ATT_EVENT_CAN_SEND_NOW
  *        - ATT_EVENT_HANDLE_VALUE_INDICATION_COMPLETE
+ *        - ATT_EVENT_NOTIFY_ALL_COMPLETE
  *        - ATT_EVENT_MTU_EXCHANGE_COMPLETE 
  * @param handler
  */
@@ -120,6 +176,19 @@ uint8_t att_server_request_to_send_indication(btstack_context_callback_registrat
  */
 uint8_t att_server_notify(hci_con_handle_t con_handle, uint16_t attribute_handle, const uint8_t *value, uint16_t value_len);
 
+/*
+ * @brief notify all connected clients that enabled notifications for the attribute about its value change
+ * @note Subscribed clients are found by reading the Client Characteristic Configuration via the registered read callbacks.
+ *       Notifications are sent as soon as possible, ATT_EVENT_NOTIFY_ALL_COMPLETE reports the status for each client.
+ *       The value needs to stay valid until ATT_EVENT_NOTIFY_ALL_COMPLETE was received.
+ * @param attribute_handle
+ * @param value
+ * @param value_len
+ * @return ERROR_CODE_SUCCESS if ok, ERROR_CODE_COMMAND_DISALLOWED if previous notify all is not complete,
+ *         ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS if attribute does not have a Client Characteristic Configuration
+ */
+uint8_t att_server_notify_all(uint16_t attribute_handle, const uint8_t *value, uint16_t value_len);
+
 /*
  * @brief indicate value change to client. client is supposed to reply with an indication_response
  * @param con_handle
@@ -141,6 +210,76 @@ uint8_t att_server_indicate(hci_con_handle_t con_handle, uint16_t attribute_hand
 uint8_t att_server_response_ready(hci_con_handle_t con_handle);
 #endif
 
+#ifdef ENABLE_ATT_NOTIFICATION_QUEUE
+/**
+ * @brief Setup notification queue for connection. Queued notifications are sent automatically when possible.
+ * @note The queue is removed on disconnect and needs to be setup again for a new connection, e.g. on ATT_EVENT_CONNECTED
+ * @note Calling it again for the same connection replaces the current queue and discards queued notifications
+ * @param queue
+ * @param con_handle
+ * @param policy ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO or ATT_SERVER_NOTIFICATION_QUEUE_POLICY_LATEST_VALUE
+ * @param storage for queue entries, use ATT_SERVER_NOTIFICATION_QUEUE_STORAGE_SIZE to calculate size, max 255 entries
+ * @param storage_size
+ * @param max_value_len of queued notifications
+ * @return ERROR_CODE_SUCCESS if ok, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER if handle unknown,
+ *         ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS if storage cannot hold a single entry or more than 255 entries
+ */
+uint8_t att_server_notification_queue_init(att_server_notification_queue_t * queue, hci_con_handle_t con_handle,
+                                           att_server_notification_queue_policy_t policy,
+                                           uint8_t * storage, uint16_t storage_size, uint16_t max_value_len);
+
+/**
+ * @brief Queue notification for attribute value change
+ * @param con_handle
+ * @param attribute_handle
+ * @param value
+ * @param value_len
+ * @return ERROR_CODE_SUCCESS if ok, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER if handle unknown, ERROR_CODE_COMMAND_DISALLOWED if no queue was setup,
+ *         ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS if value_len > max_value_len, and ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if queue is full
+ */
+uint8_t att_server_notification_queue_add(hci_con_handle_t con_handle, uint16_t attribute_handle, const uint8_t * value, uint16_t value_len);
+
+/**
+ * @brief Get number of queued notifications
+ * @param con_handle
+ * @return number of notifications in queue
+ */
+uint16_t att_server_notification_queue_get_count(hci_con_handle_t con_handle);
+
+/**
+ * @brief Get statistics for notification queue
+ * @param con_handle
+ * @param statistics
+ * @return ERROR_CODE_SUCCESS if ok, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER if handle unknown, ERROR_CODE_COMMAND_DISALLOWED if no queue was setup
+ */
+uint8_t att_server_notification_queue_get_statistics(hci_con_handle_t con_handle, att_server_notification_queue_statistics_t * statistics);
+#endif
+
+/**
+ * @brief Register sink for Write Without Response to characteristic value handle.
+ * @note Permissions are validated on the first Write Command per connection and again after security changes.
+ *       Valid Write Commands are passed to the sink instead of the write callback of the service or ATT Server.
+ *       Write Requests, Prepare Writes and Signed Writes to the handle are not affected.
+ * @param sink with value_handle and callback
+ */
+void att_server_register_write_command_sink(att_server_write_command_sink_t * sink);
+
+/**
+ * @brief Unregister Write Without Response sink
+ * @param sink
+ */
+void att_server_unregister_write_command_sink(att_server_write_command_sink_t * sink);
+
+/**
+ * @brief Signal that sink is ready to accept data again after its callback returned false
+ * @note While the sink is busy, Write Commands for it are dropped. With ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL,
+ *       reception of ACL packets for the connection is paused to throttle the peer, see hci_acl_receive_pause.
+ *       Without Controller to Host Flow Control, the peer is not throttled.
+ * @param con_handle
+ * @return ERROR_CODE_SUCCESS if ok, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER if handle unknown
+ */
+uint8_t att_server_write_command_sink_ready(hci_con_handle_t con_handle);
+
 // the following functions will be removed soon
 
 /*
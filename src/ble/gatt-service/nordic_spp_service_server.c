@@ -58,6 +58,7 @@
 
 //
 static att_service_handler_t  nordic_spp_service;
+static att_server_write_command_sink_t nordic_spp_rx_sink;
 static btstack_packet_handler_t client_packet_handler;
 
 static uint16_t nordic_spp_rx_value_handle;
@@ -90,6 +91,13 @@ static uint16_t nordic_spp_service_read_callback(hci_con_handle_t con_handle, ui
 	return 0;
 }
 
+// Write Without Response to RX characteristic bypass the write callback
+static bool nordic_spp_service_rx_sink_callback(hci_con_handle_t con_handle, uint16_t value_handle, const uint8_t * data, uint16_t data_len){
+	UNUSED(value_handle);
+	(*client_packet_handler)(RFCOMM_DATA_PACKET, (uint16_t) con_handle, (uint8_t *) data, data_len);
+	return true;
+}
+
 static int nordic_spp_service_write_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t transaction_mode, uint16_t offset, uint8_t *buffer, uint16_t buffer_size){
 	UNUSED(transaction_mode);
 	UNUSED(offset);
@@ -142,6 +150,11 @@ void nordic_spp_service_server_init(btstack_packet_handler_t packet_handler){
 	nordic_spp_service.read_callback  = &nordic_spp_service_read_callback;
 	nordic_spp_service.write_callback = &nordic_spp_service_write_callback;
 	att_server_register_service_handler(&nordic_spp_service);
+
+	// register sink for data from peer
+	nordic_spp_rx_sink.value_handle = nordic_spp_rx_value_handle;
+	nordic_spp_rx_sink.callback     = &nordic_spp_service_rx_sink_callback;
+	att_server_register_write_command_sink(&nordic_spp_rx_sink);
 }
 
 /** 
@@ -858,6 +858,201 @@ static void trigger_next_read_by_type_query(gatt_client_t * gatt_client, uint16_
     trigger_next_query(gatt_client, last_result_handle, P_W2_SEND_READ_BY_TYPE_REQUEST);
 }
 
+// database records: type, handles, properties (characteristic only), uuid len, uuid as received
+#define GATT_CLIENT_DATABASE_SERVICE_HEADER_LEN        6u
+#define GATT_CLIENT_DATABASE_CHARACTERISTIC_HEADER_LEN 9u
+#define GATT_CLIENT_DATABASE_DESCRIPTOR_HEADER_LEN     4u
+
+// returns 0 if record is invalid
+static uint16_t gatt_client_database_record_len(const uint8_t * record, uint16_t available){
+    if (available < 1u) return 0;
+    uint16_t header_len;
+    switch ((gatt_client_database_record_type_t) record[0]){
+        case GATT_CLIENT_DATABASE_RECORD_PRIMARY_SERVICE:
+        case GATT_CLIENT_DATABASE_RECORD_SECONDARY_SERVICE:
+            header_len = GATT_CLIENT_DATABASE_SERVICE_HEADER_LEN;
+            break;
+        case GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC:
+            header_len = GATT_CLIENT_DATABASE_CHARACTERISTIC_HEADER_LEN;
+            break;
+        case GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC_DESCRIPTOR:
+            header_len = GATT_CLIENT_DATABASE_DESCRIPTOR_HEADER_LEN;
+            break;
+        default:
+            return 0;
+    }
+    if (available < header_len) return 0;
+    uint8_t uuid_len = record[header_len - 1u];
+    if ((uuid_len != 2u) && (uuid_len != 16u)) return 0;
+    if (available < (header_len + uuid_len)) return 0;
+    return header_len + uuid_len;
+}
+
+// returns false and completes query if storage is full
+static bool gatt_client_database_add_record(gatt_client_t * gatt_client, uint8_t * header, uint16_t header_len, const uint8_t * uuid, uint8_t uuid_len){
+    gatt_client_database_t * database = gatt_client->database;
+    if ((database->len + header_len + uuid_len) > database->storage_size){
+        log_info("discover database: storage full");
+        gatt_client_handle_transaction_complete(gatt_client);
+        emit_gatt_complete_event(gatt_client, ATT_ERROR_INSUFFICIENT_RESOURCES);
+        return false;
+    }
+    header[header_len - 1u] = uuid_len;
+    (void)memcpy(&database->storage[database->len], header, header_len);
+    database->len += header_len;
+    (void)memcpy(&database->storage[database->len], uuid, uuid_len);
+    database->len += uuid_len;
+    return true;
+}
+
+static bool gatt_client_database_add_services(gatt_client_t * gatt_client, uint8_t * packet, uint16_t size){
+    if (size < 2u) return true;
+    uint8_t attr_length = packet[1];
+    if ((attr_length != 6u) && (attr_length != 20u)) return true;
+    uint8_t header[GATT_CLIENT_DATABASE_SERVICE_HEADER_LEN];
+    header[0] = (gatt_client->uuid16 == GATT_PRIMARY_SERVICE_UUID) ? GATT_CLIENT_DATABASE_RECORD_PRIMARY_SERVICE : GATT_CLIENT_DATABASE_RECORD_SECONDARY_SERVICE;
+    uint16_t i;
+    for (i = 2u; (i + attr_length) <= size; i += attr_length){
+        // start and end group handle
+        (void)memcpy(&header[1], &packet[i], 4);
+        if (!gatt_client_database_add_record(gatt_client, header, sizeof(header), &packet[i + 4u], attr_length - 4u)) return false;
+    }
+    return true;
+}
+
+static bool gatt_client_database_add_characteristics(gatt_client_t * gatt_client, uint8_t * packet, uint16_t size){
+    if (size < 2u) return true;
+    uint8_t attr_length = packet[1];
+    if ((attr_length != 7u) && (attr_length != 21u)) return true;
+    uint8_t header[GATT_CLIENT_DATABASE_CHARACTERISTIC_HEADER_LEN];
+    header[0] = GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC;
+    uint16_t i;
+    for (i = 2u; (i + attr_length) <= size; i += attr_length){
+        little_endian_store_16(header, 1, little_endian_read_16(packet, i));
+        little_endian_store_16(header, 3, little_endian_read_16(packet, i + 3u));
+        // end handle is set when all characteristics are known
+        little_endian_store_16(header, 5, 0);
+        header[7] = packet[i + 2u];
+        if (!gatt_client_database_add_record(gatt_client, header, sizeof(header), &packet[i + 5u], attr_length - 5u)) return false;
+    }
+    return true;
+}
+
+static bool gatt_client_database_add_descriptors(gatt_client_t * gatt_client, uint8_t * packet, uint16_t size, uint16_t pair_size){
+    uint8_t header[GATT_CLIENT_DATABASE_DESCRIPTOR_HEADER_LEN];
+    header[0] = GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC_DESCRIPTOR;
+    uint16_t i;
+    for (i = 0u; (i + pair_size) <= size; i += pair_size){
+        little_endian_store_16(header, 1, little_endian_read_16(packet, i));
+        if (!gatt_client_database_add_record(gatt_client, header, sizeof(header), &packet[i + 2u], pair_size - 2u)) return false;
+    }
+    return true;
+}
+
+static uint16_t gatt_client_database_service_end_handle(const gatt_client_database_t * database, uint16_t services_len, uint16_t handle){
+    uint16_t offset = 0;
+    while (offset < services_len){
+        const uint8_t * record = &database->storage[offset];
+        uint16_t start_group_handle = little_endian_read_16(record, 1);
+        uint16_t end_group_handle   = little_endian_read_16(record, 3);
+        if ((start_group_handle <= handle) && (handle <= end_group_handle)){
+            return end_group_handle;
+        }
+        offset += gatt_client_database_record_len(record, services_len - offset);
+    }
+    return 0xffff;
+}
+
+// characteristic ends before next characteristic or at end of its service
+static void gatt_client_database_set_characteristic_end_handles(gatt_client_database_t * database, uint16_t characteristics_offset){
+    uint16_t offset = characteristics_offset;
+    while (offset < database->len){
+        uint8_t * record = &database->storage[offset];
+        uint16_t next_offset = offset + gatt_client_database_record_len(record, database->len - offset);
+        uint16_t start_handle = little_endian_read_16(record, 1);
+        uint16_t end_handle = gatt_client_database_service_end_handle(database, characteristics_offset, start_handle);
+        if (next_offset < database->len){
+            uint16_t next_start_handle = little_endian_read_16(database->storage, next_offset + 1u);
+            if (next_start_handle <= end_handle){
+                end_handle = next_start_handle - 1u;
+            }
+        }
+        little_endian_store_16(record, 5, end_handle);
+        offset = next_offset;
+    }
+}
+
+// query descriptors for next characteristic that has attributes after its value
+static void gatt_client_database_next_descriptor_query(gatt_client_t * gatt_client){
+    gatt_client_database_t * database = gatt_client->database;
+    while (gatt_client->database_offset < database->len){
+        const uint8_t * record = &database->storage[gatt_client->database_offset];
+        if (record[0] != (uint8_t) GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC) break;
+        uint16_t value_handle = little_endian_read_16(record, 3);
+        uint16_t end_handle   = little_endian_read_16(record, 5);
+        if (end_handle > value_handle){
+            gatt_client->start_group_handle = value_handle + 1u;
+            gatt_client->end_group_handle   = end_handle;
+            gatt_client->gatt_client_state  = P_W2_SEND_DISCOVER_DATABASE_DESCRIPTORS_QUERY;
+            return;
+        }
+        gatt_client->database_offset += gatt_client_database_record_len(record, database->len - gatt_client->database_offset);
+    }
+    gatt_client_handle_transaction_complete(gatt_client);
+    emit_gatt_complete_event(gatt_client, ATT_ERROR_SUCCESS);
+}
+
+static void gatt_client_database_handle_query_done(gatt_client_t * gatt_client){
+    gatt_client_database_t * database = gatt_client->database;
+    switch (gatt_client->gatt_client_state){
+        case P_W4_DISCOVER_DATABASE_SERVICES_QUERY_RESULT:
+            gatt_client->start_group_handle = 0x0001;
+            gatt_client->end_group_handle   = 0xffff;
+            if (gatt_client->uuid16 == GATT_PRIMARY_SERVICE_UUID){
+                gatt_client->uuid16 = GATT_SECONDARY_SERVICE_UUID;
+                gatt_client->gatt_client_state = P_W2_SEND_DISCOVER_DATABASE_SERVICES_QUERY;
+            } else {
+                gatt_client->database_offset = database->len;
+                gatt_client->gatt_client_state = P_W2_SEND_DISCOVER_DATABASE_CHARACTERISTICS_QUERY;
+            }
+            break;
+        case P_W4_DISCOVER_DATABASE_CHARACTERISTICS_QUERY_RESULT:
+            gatt_client_database_set_characteristic_end_handles(database, gatt_client->database_offset);
+            gatt_client_database_next_descriptor_query(gatt_client);
+            break;
+        case P_W4_DISCOVER_DATABASE_DESCRIPTORS_QUERY_RESULT:
+            gatt_client->database_offset += gatt_client_database_record_len(&database->storage[gatt_client->database_offset],
+                                                                            database->len - gatt_client->database_offset);
+            gatt_client_database_next_descriptor_query(gatt_client);
+            break;
+        default:
+            btstack_assert(false);
+            break;
+    }
+}
+
+static void gatt_client_database_trigger_next_query(gatt_client_t * gatt_client, uint16_t last_result_handle){
+    if (is_query_done(gatt_client, last_result_handle)){
+        gatt_client_database_handle_query_done(gatt_client);
+        return;
+    }
+    gatt_client->start_group_handle = last_result_handle + 1u;
+    switch (gatt_client->gatt_client_state){
+        case P_W4_DISCOVER_DATABASE_SERVICES_QUERY_RESULT:
+            gatt_client->gatt_client_state = P_W2_SEND_DISCOVER_DATABASE_SERVICES_QUERY;
+            break;
+        case P_W4_DISCOVER_DATABASE_CHARACTERISTICS_QUERY_RESULT:
+            gatt_client->gatt_client_state = P_W2_SEND_DISCOVER_DATABASE_CHARACTERISTICS_QUERY;
+            break;
+        case P_W4_DISCOVER_DATABASE_DESCRIPTORS_QUERY_RESULT:
+            gatt_client->gatt_client_state = P_W2_SEND_DISCOVER_DATABASE_DESCRIPTORS_QUERY;
+            break;
+        default:
+            btstack_assert(false);
+            break;
+    }
+}
+
 static void trigger_next_prepare_write_query(gatt_client_t * gatt_client, gatt_client_state_t next_query_state, gatt_client_state_t done_state){
     gatt_client->attribute_offset += write_blob_length(gatt_client);
     uint16_t next_blob_length =  write_blob_length(gatt_client);
@@ -986,6 +1181,21 @@ static bool gatt_client_run_for_gatt_client(gatt_client_t * gatt_client){
             send_gatt_included_service_request(gatt_client);
             return true;
 
+        case P_W2_SEND_DISCOVER_DATABASE_SERVICES_QUERY:
+            gatt_client->gatt_client_state = P_W4_DISCOVER_DATABASE_SERVICES_QUERY_RESULT;
+            send_gatt_services_request(gatt_client);
+            return true;
+
+        case P_W2_SEND_DISCOVER_DATABASE_CHARACTERISTICS_QUERY:
+            gatt_client->gatt_client_state = P_W4_DISCOVER_DATABASE_CHARACTERISTICS_QUERY_RESULT;
+            send_gatt_characteristic_request(gatt_client);
+            return true;
+
+        case P_W2_SEND_DISCOVER_DATABASE_DESCRIPTORS_QUERY:
+            gatt_client->gatt_client_state = P_W4_DISCOVER_DATABASE_DESCRIPTORS_QUERY_RESULT;
+            send_gatt_characteristic_descriptor_request(gatt_client);
+            return true;
+
         case P_W2_SEND_INCLUDED_SERVICE_WITH_UUID_QUERY:
             gatt_client->gatt_client_state = P_W4_INCLUDED_SERVICE_UUID_WITH_QUERY_RESULT;
             send_gatt_included_service_uuid_request(gatt_client);
@@ -1366,6 +1576,10 @@ static void gatt_client_att_packet_handler(uint8_t packet_type, uint16_t handle,
                     trigger_next_service_query(gatt_client, get_last_result_handle_from_service_list(packet, size));
                     // GATT_EVENT_QUERY_COMPLETE is emitted by trigger_next_xxx when done
                     break;
+                case P_W4_DISCOVER_DATABASE_SERVICES_QUERY_RESULT:
+                    if (!gatt_client_database_add_services(gatt_client, packet, size)) break;
+                    gatt_client_database_trigger_next_query(gatt_client, get_last_result_handle_from_service_list(packet, size));
+                    break;
                 default:
                     break;
             }
@@ -1388,6 +1602,10 @@ static void gatt_client_att_packet_handler(uint8_t packet_type, uint16_t handle,
                     trigger_next_characteristic_query(gatt_client, get_last_result_handle_from_characteristics_list(packet, size));
                     // GATT_EVENT_QUERY_COMPLETE is emitted by trigger_next_xxx when done, or by ATT_ERROR
                     break;
+                case P_W4_DISCOVER_DATABASE_CHARACTERISTICS_QUERY_RESULT:
+                    if (!gatt_client_database_add_characteristics(gatt_client, packet, size)) break;
+                    gatt_client_database_trigger_next_query(gatt_client, get_last_result_handle_from_characteristics_list(packet, size));
+                    break;
                 case P_W4_INCLUDED_SERVICE_QUERY_RESULT:
                 {
                     if (size < 2u) break;
@@ -1542,6 +1760,11 @@ static void gatt_client_att_packet_handler(uint8_t packet_type, uint16_t handle,
                 break;
             }
 #endif
+            if (gatt_client->gatt_client_state == P_W4_DISCOVER_DATABASE_DESCRIPTORS_QUERY_RESULT){
+                if (!gatt_client_database_add_descriptors(gatt_client, &packet[2], size - 2u, pair_size)) break;
+                gatt_client_database_trigger_next_query(gatt_client, last_descriptor_handle);
+                break;
+            }
             report_gatt_all_characteristic_descriptors(gatt_client, &packet[2], size - 2u, pair_size);
             trigger_next_characteristic_descriptor_query(gatt_client, last_descriptor_handle);
             // GATT_EVENT_QUERY_COMPLETE is emitted by trigger_next_xxx when done
@@ -1680,6 +1903,11 @@ static void gatt_client_att_packet_handler(uint8_t packet_type, uint16_t handle,
                             gatt_client_handle_transaction_complete(gatt_client);
                             emit_gatt_complete_event(gatt_client, ATT_ERROR_SUCCESS);
                             break;
+                        case P_W4_DISCOVER_DATABASE_SERVICES_QUERY_RESULT:
+                        case P_W4_DISCOVER_DATABASE_CHARACTERISTICS_QUERY_RESULT:
+                        case P_W4_DISCOVER_DATABASE_DESCRIPTORS_QUERY_RESULT:
+                            gatt_client_database_handle_query_done(gatt_client);
+                            break;
                         case P_W4_READ_BY_TYPE_RESPONSE:
                             gatt_client_handle_transaction_complete(gatt_client);
                             if (gatt_client->start_group_handle == gatt_client->query_start_handle){
@@ -1982,6 +2210,95 @@ uint8_t gatt_client_discover_characteristic_descriptors(btstack_packet_handler_t
     return ERROR_CODE_SUCCESS;
 }
 
+uint8_t gatt_client_discover_database(btstack_packet_handler_t callback, hci_con_handle_t con_handle, gatt_client_database_t * database){
+    gatt_client_t * gatt_client = gatt_client_provide_context_for_handle_and_start_timer(con_handle);
+    if (gatt_client == NULL) return BTSTACK_MEMORY_ALLOC_FAILED;
+    if (is_ready(gatt_client) == 0) return GATT_CLIENT_IN_WRONG_STATE;
+
+    database->len = 0;
+    gatt_client->callback = callback;
+    gatt_client->database = database;
+    gatt_client->database_offset = 0;
+    gatt_client->start_group_handle = 0x0001;
+    gatt_client->end_group_handle   = 0xffff;
+    gatt_client->uuid16 = GATT_PRIMARY_SERVICE_UUID;
+    gatt_client->gatt_client_state = P_W2_SEND_DISCOVER_DATABASE_SERVICES_QUERY;
+    gatt_client_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+void gatt_client_database_init(gatt_client_database_t * database, uint8_t * storage, uint16_t storage_size){
+    database->storage = storage;
+    database->storage_size = storage_size;
+    database->len = 0;
+}
+
+bool gatt_client_database_init_with_storage(gatt_client_database_t * database, uint8_t * storage, uint16_t storage_size, uint16_t len){
+    gatt_client_database_init(database, storage, storage_size);
+    if (len > storage_size) return false;
+    uint16_t offset = 0;
+    while (offset < len){
+        uint16_t record_len = gatt_client_database_record_len(&storage[offset], len - offset);
+        if (record_len == 0u) return false;
+        offset += record_len;
+    }
+    database->len = len;
+    return true;
+}
+
+void gatt_client_database_iterator_init(gatt_client_database_iterator_t * it, const gatt_client_database_t * database){
+    it->database = database;
+    it->offset = 0;
+    it->next_offset = 0;
+}
+
+bool gatt_client_database_iterator_has_next(gatt_client_database_iterator_t * it){
+    return it->next_offset < it->database->len;
+}
+
+gatt_client_database_record_type_t gatt_client_database_iterator_next(gatt_client_database_iterator_t * it){
+    it->offset = it->next_offset;
+    const uint8_t * record = &it->database->storage[it->offset];
+    it->next_offset += gatt_client_database_record_len(record, it->database->len - it->offset);
+    return (gatt_client_database_record_type_t) record[0];
+}
+
+static void gatt_client_database_get_uuid(const uint8_t * uuid_field, uint16_t * uuid16, uint8_t * uuid128){
+    if (uuid_field[0] == 2u){
+        *uuid16 = little_endian_read_16(uuid_field, 1);
+        uuid_add_bluetooth_prefix(uuid128, *uuid16);
+        return;
+    }
+    reverse_128(&uuid_field[1], uuid128);
+    if (uuid_has_bluetooth_prefix(uuid128)){
+        *uuid16 = big_endian_read_32(uuid128, 0);
+    } else {
+        *uuid16 = 0;
+    }
+}
+
+void gatt_client_database_iterator_get_service(gatt_client_database_iterator_t * it, gatt_client_service_t * service){
+    const uint8_t * record = &it->database->storage[it->offset];
+    service->start_group_handle = little_endian_read_16(record, 1);
+    service->end_group_handle   = little_endian_read_16(record, 3);
+    gatt_client_database_get_uuid(&record[GATT_CLIENT_DATABASE_SERVICE_HEADER_LEN - 1u], &service->uuid16, service->uuid128);
+}
+
+void gatt_client_database_iterator_get_characteristic(gatt_client_database_iterator_t * it, gatt_client_characteristic_t * characteristic){
+    const uint8_t * record = &it->database->storage[it->offset];
+    characteristic->start_handle = little_endian_read_16(record, 1);
+    characteristic->value_handle = little_endian_read_16(record, 3);
+    characteristic->end_handle   = little_endian_read_16(record, 5);
+    characteristic->properties   = record[7];
+    gatt_client_database_get_uuid(&record[GATT_CLIENT_DATABASE_CHARACTERISTIC_HEADER_LEN - 1u], &characteristic->uuid16, characteristic->uuid128);
+}
+
+void gatt_client_database_iterator_get_characteristic_descriptor(gatt_client_database_iterator_t * it, gatt_client_characteristic_descriptor_t * descriptor){
+    const uint8_t * record = &it->database->storage[it->offset];
+    descriptor->handle = little_endian_read_16(record, 1);
+    gatt_client_database_get_uuid(&record[GATT_CLIENT_DATABASE_DESCRIPTOR_HEADER_LEN - 1u], &descriptor->uuid16, descriptor->uuid128);
+}
+
 uint8_t gatt_client_read_value_of_characteristic_using_value_handle(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t value_handle){
     gatt_client_t * gatt_client = gatt_client_provide_context_for_handle_and_start_timer(con_handle);
     if (gatt_client == NULL) return BTSTACK_MEMORY_ALLOC_FAILED;
@@ -68,6 +68,13 @@ typedef enum {
     P_W4_INCLUDED_SERVICE_QUERY_RESULT,
     P_W2_SEND_INCLUDED_SERVICE_WITH_UUID_QUERY,
     P_W4_INCLUDED_SERVICE_UUID_WITH_QUERY_RESULT,
+
+    P_W2_SEND_DISCOVER_DATABASE_SERVICES_QUERY,
+    P_W4_DISCOVER_DATABASE_SERVICES_QUERY_RESULT,
+    P_W2_SEND_DISCOVER_DATABASE_CHARACTERISTICS_QUERY,
+    P_W4_DISCOVER_DATABASE_CHARACTERISTICS_QUERY_RESULT,
+    P_W2_SEND_DISCOVER_DATABASE_DESCRIPTORS_QUERY,
+    P_W4_DISCOVER_DATABASE_DESCRIPTORS_QUERY_RESULT,
     
     P_W2_SEND_READ_CHARACTERISTIC_VALUE_QUERY,
     P_W4_READ_CHARACTERISTIC_VALUE_RESULT,
@@ -197,6 +204,10 @@ typedef struct gatt_client{
 
     gap_security_level_t security_level;
 
+    // database discovery: database and offset of current characteristic record
+    struct gatt_client_database * database;
+    uint16_t database_offset;
+
 } gatt_client_t;
 
 typedef struct gatt_client_notification {
@@ -230,6 +241,30 @@ typedef struct {
     uint8_t  uuid128[16];
 } gatt_client_characteristic_descriptor_t;
 
+typedef enum {
+    GATT_CLIENT_DATABASE_RECORD_PRIMARY_SERVICE = 1,
+    GATT_CLIENT_DATABASE_RECORD_SECONDARY_SERVICE,
+    GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC,
+    GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC_DESCRIPTOR,
+} gatt_client_database_record_type_t;
+
+/**
+ * Compact remote GATT database, stored as contiguous list of variable-size records:
+ * all primary services, all secondary services, all characteristics, then all characteristic descriptors,
+ * each in handle order. 16-bit UUIDs are stored as 2 bytes. storage[0..len-1] can be stored and restored as-is.
+ */
+typedef struct gatt_client_database {
+    uint8_t * storage;
+    uint16_t  storage_size;
+    uint16_t  len;
+} gatt_client_database_t;
+
+typedef struct {
+    const gatt_client_database_t * database;
+    uint16_t offset;
+    uint16_t next_offset;
+} gatt_client_database_iterator_t;
+
 /** 
  * @brief Set up GATT client.
  */
@@ -403,6 +438,81 @@ uint8_t gatt_client_discover_characteristics_for_service_by_uuid128(btstack_pack
  */
 uint8_t gatt_client_discover_characteristic_descriptors(btstack_packet_handler_t callback, hci_con_handle_t con_handle, gatt_client_characteristic_t * characteristic);
 
+/**
+ * @brief Discovers all services, characteristics and characteristic descriptors and stores them in the database.
+ *        Services are discovered by Read By Group Type, all characteristics by Read By Type over the whole handle range,
+ *        and Find Information is only used for characteristics with handles after the value handle.
+ *        No result events are emitted. The gatt_complete_event_t with type set to GATT_EVENT_QUERY_COMPLETE, marks the end of discovery,
+ *        with ATT_ERROR_INSUFFICIENT_RESOURCES if the database storage is too small.
+ * @param  callback
+ * @param  con_handle
+ * @param  database initialized with gatt_client_database_init
+ * @return status BTSTACK_MEMORY_ALLOC_FAILED, if no GATT client for con_handle is found
+ *                GATT_CLIENT_IN_WRONG_STATE , if GATT client is not ready
+ *                ERROR_CODE_SUCCESS         , if query is successfully registered
+ */
+uint8_t gatt_client_discover_database(btstack_packet_handler_t callback, hci_con_handle_t con_handle, gatt_client_database_t * database);
+
+/**
+ * @brief Init empty database with storage
+ * @param database
+ * @param storage
+ * @param storage_size
+ */
+void gatt_client_database_init(gatt_client_database_t * database, uint8_t * storage, uint16_t storage_size);
+
+/**
+ * @brief Init database with storage that contains len bytes of a previously discovered database, e.g. loaded from a cache
+ * @param database
+ * @param storage
+ * @param storage_size
+ * @param len
+ * @return true if records are valid, otherwise database is empty
+ */
+bool gatt_client_database_init_with_storage(gatt_client_database_t * database, uint8_t * storage, uint16_t storage_size, uint16_t len);
+
+/**
+ * @brief Init iterator over database records
+ * @param it
+ * @param database
+ */
+void gatt_client_database_iterator_init(gatt_client_database_iterator_t * it, const gatt_client_database_t * database);
+
+/**
+ * @brief Check if there are more records
+ * @param it
+ * @return true if next record available
+ */
+bool gatt_client_database_iterator_has_next(gatt_client_database_iterator_t * it);
+
+/**
+ * @brief Move to next record
+ * @param it
+ * @return type of record
+ */
+gatt_client_database_record_type_t gatt_client_database_iterator_next(gatt_client_database_iterator_t * it);
+
+/**
+ * @brief Get current record as service, requires primary or secondary service record
+ * @param it
+ * @param service
+ */
+void gatt_client_database_iterator_get_service(gatt_client_database_iterator_t * it, gatt_client_service_t * service);
+
+/**
+ * @brief Get current record as characteristic, requires characteristic record
+ * @param it
+ * @param characteristic
+ */
+void gatt_client_database_iterator_get_characteristic(gatt_client_database_iterator_t * it, gatt_client_characteristic_t * characteristic);
+
+/**
+ * @brief Get current record as characteristic descriptor, requires characteristic descriptor record
+ * @param it
+ * @param descriptor
+ */
+void gatt_client_database_iterator_get_characteristic_descriptor(gatt_client_database_iterator_t * it, gatt_client_characteristic_descriptor_t * descriptor);
+
 /** 
  * @brief Reads the characteristic value using the characteristic's value handle. If the characteristic value is found, an le_characteristic_value_event_t with type set to GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT will be generated and passed to the registered callback. The gatt_complete_event_t with type set to GATT_EVENT_QUERY_COMPLETE, marks the end of read.
  * @param  callback   
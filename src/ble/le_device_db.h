@@ -108,6 +108,21 @@ int le_device_db_max_count(void);
  */
 void le_device_db_info(int index, int * addr_type, bd_addr_t addr, sm_key_t irk);
 
+/**
+ * @brief find device by identity address
+ * @param addr_type
+ * @param addr
+ * @return index if found, -1 otherwise
+ */
+int le_device_db_lookup_by_identity_address(int addr_type, const bd_addr_t addr);
+
+/**
+ * @brief find device by Identity Resolving Key
+ * @param irk
+ * @return index if found, -1 otherwise
+ */
+int le_device_db_lookup_by_irk(const sm_key_t irk);
+
 
 /**
  * @brief set remote encryption info
@@ -47,7 +47,8 @@
 
 // LE Device DB Implementation storing entries in btstack_tlv
 
-// Local cache is used to keep track of deleted entries in TLV
+// In-memory index of identity address and IRK for all stored entries is built on configure
+// and kept in sync on add/remove. It serves le_device_db_info and lookups without TLV access
 
 #define INVALID_ENTRY_ADDR_TYPE 0xff
 
@@ -93,20 +94,55 @@ typedef struct le_device_db_entry_t {
 #error "NVM_NUM_DEVICE_DB_ENTRIES must not be 0, please update in btstack_config.h"
 #endif
 
-// only stores if entry present
-static uint8_t  entry_map[NVM_NUM_DEVICE_DB_ENTRIES];
+#if NVM_NUM_DEVICE_DB_ENTRIES > 0xffff
+#error "NVM_NUM_DEVICE_DB_ENTRIES must not be larger than 65535, please update in btstack_config.h"
+#endif
+
+#if NVM_NUM_DEVICE_DB_ENTRIES > 256
+typedef uint16_t le_device_db_tlv_index_t;
+#else
+typedef uint8_t  le_device_db_tlv_index_t;
+#endif
+
+// In-memory info for each entry
+typedef struct {
+    uint32_t  seq_nr;
+    sm_key_t  irk;
+    bd_addr_t addr;
+    uint8_t   addr_type;    // INVALID_ENTRY_ADDR_TYPE if not present
+} le_device_db_tlv_index_entry_t;
+
+// List of entry indices sorted by key
+typedef struct {
+    le_device_db_tlv_index_t indices[NVM_NUM_DEVICE_DB_ENTRIES];
+    uint32_t num_indices;
+    int (*compare)(const le_device_db_tlv_index_entry_t * a, const le_device_db_tlv_index_entry_t * b);
+} le_device_db_tlv_sorted_list_t;
+
+static le_device_db_tlv_index_entry_t entry_index[NVM_NUM_DEVICE_DB_ENTRIES];
 static uint32_t num_valid_entries;
 
+static int le_device_db_tlv_compare_address(const le_device_db_tlv_index_entry_t * a, const le_device_db_tlv_index_entry_t * b);
+static int le_device_db_tlv_compare_irk(const le_device_db_tlv_index_entry_t * a, const le_device_db_tlv_index_entry_t * b);
+
+// entries sorted by identity address and by IRK, entries without IRK are not listed by IRK
+static le_device_db_tlv_sorted_list_t entries_by_address = { { 0 }, 0, &le_device_db_tlv_compare_address };
+static le_device_db_tlv_sorted_list_t entries_by_irk     = { { 0 }, 0, &le_device_db_tlv_compare_irk };
+
 static const btstack_tlv_t * le_device_db_tlv_btstack_tlv_impl;
 static       void *          le_device_db_tlv_btstack_tlv_context;
 
 
-static uint32_t le_device_db_tlv_tag_for_index(uint8_t index){
+static uint32_t le_device_db_tlv_tag_for_index(uint16_t index){
     static const char tag_0 = 'B';
     static const char tag_1 = 'T';
     static const char tag_2 = 'D';
 
-    return (tag_0 << 24u) | (tag_1 << 16u) | (tag_2 << 8u) | index;
+    if (index < 256u){
+        return (tag_0 << 24u) | (tag_1 << 16u) | (tag_2 << 8u) | index;
+    }
+    // entries above 255 use 16-bit index
+    return (tag_0 << 24u) | (tag_2 << 16u) | index;
 }
 
 // @return success
@@ -144,18 +180,132 @@ static bool le_device_db_tlv_delete(int index){
 	return true;
 }
 
+static int le_device_db_tlv_compare_address(const le_device_db_tlv_index_entry_t * a, const le_device_db_tlv_index_entry_t * b){
+    if (a->addr_type != b->addr_type){
+        return (a->addr_type < b->addr_type) ? -1 : 1;
+    }
+    return memcmp(a->addr, b->addr, 6);
+}
+
+static int le_device_db_tlv_compare_irk(const le_device_db_tlv_index_entry_t * a, const le_device_db_tlv_index_entry_t * b){
+    return memcmp(a->irk, b->irk, 16);
+}
+
+// @return position of first entry not less than key
+static uint32_t le_device_db_tlv_sorted_list_lower_bound(const le_device_db_tlv_sorted_list_t * list, const le_device_db_tlv_index_entry_t * key){
+    uint32_t low  = 0;
+    uint32_t high = list->num_indices;
+    while (low < high){
+        uint32_t mid = (low + high) / 2u;
+        if ((*list->compare)(&entry_index[list->indices[mid]], key) < 0){
+            low = mid + 1u;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void le_device_db_tlv_sorted_list_add(le_device_db_tlv_sorted_list_t * list, uint16_t index){
+    btstack_assert(list->num_indices < NVM_NUM_DEVICE_DB_ENTRIES);
+    uint32_t pos = le_device_db_tlv_sorted_list_lower_bound(list, &entry_index[index]);
+    (void)memmove(&list->indices[pos + 1u], &list->indices[pos], (list->num_indices - pos) * sizeof(le_device_db_tlv_index_t));
+    list->indices[pos] = (le_device_db_tlv_index_t) index;
+    list->num_indices++;
+}
+
+static void le_device_db_tlv_sorted_list_remove(le_device_db_tlv_sorted_list_t * list, uint16_t index){
+    uint32_t pos = le_device_db_tlv_sorted_list_lower_bound(list, &entry_index[index]);
+    // skip other entries with same key
+    while ((pos < list->num_indices) && (list->indices[pos] != index)){
+        pos++;
+    }
+    if (pos == list->num_indices) return;
+    list->num_indices--;
+    (void)memmove(&list->indices[pos], &list->indices[pos + 1u], (list->num_indices - pos) * sizeof(le_device_db_tlv_index_t));
+}
+
+// @return index of first entry with matching key or -1
+static int le_device_db_tlv_sorted_list_lookup(const le_device_db_tlv_sorted_list_t * list, const le_device_db_tlv_index_entry_t * key){
+    uint32_t pos = le_device_db_tlv_sorted_list_lower_bound(list, key);
+    if (pos == list->num_indices) return -1;
+    uint16_t index = list->indices[pos];
+    if ((*list->compare)(&entry_index[index], key) != 0) return -1;
+    return index;
+}
+
+static bool le_device_db_tlv_index_entry_valid(int index){
+    return entry_index[index].addr_type != INVALID_ENTRY_ADDR_TYPE;
+}
+
+static bool le_device_db_tlv_index_entry_has_irk(int index){
+    uint8_t i;
+    for (i=0;i<16u;i++){
+        if (entry_index[index].irk[i] != 0u) return true;
+    }
+    return false;
+}
+
+static void le_device_db_tlv_index_add(uint16_t index, const le_device_db_entry_t * entry){
+    le_device_db_tlv_index_entry_t * index_entry = &entry_index[index];
+    index_entry->seq_nr    = entry->seq_nr;
+    index_entry->addr_type = (uint8_t) entry->addr_type;
+    (void)memcpy(index_entry->addr, entry->addr, 6);
+    (void)memcpy(index_entry->irk, entry->irk, 16);
+    le_device_db_tlv_sorted_list_add(&entries_by_address, index);
+    if (le_device_db_tlv_index_entry_has_irk(index)){
+        le_device_db_tlv_sorted_list_add(&entries_by_irk, index);
+    }
+    num_valid_entries++;
+}
+
+static void le_device_db_tlv_index_remove(uint16_t index){
+    le_device_db_tlv_sorted_list_remove(&entries_by_address, index);
+    if (le_device_db_tlv_index_entry_has_irk(index)){
+        le_device_db_tlv_sorted_list_remove(&entries_by_irk, index);
+    }
+    entry_index[index].addr_type = INVALID_ENTRY_ADDR_TYPE;
+    num_valid_entries--;
+}
+
+static bool le_device_db_tlv_scan_handler(void * context, uint32_t tag, uint32_t value_size){
+    UNUSED(context);
+    if (value_size != sizeof(le_device_db_entry_t)) return true;
+    // tag range only contains valid indices
+    uint16_t index = (uint16_t) (tag & 0xffu);
+#if NVM_NUM_DEVICE_DB_ENTRIES > 256
+    if ((tag >> 8u) != (le_device_db_tlv_tag_for_index(0) >> 8u)){
+        index = (uint16_t) (tag & 0xffffu);
+    }
+#endif
+    le_device_db_entry_t entry;
+    if (le_device_db_tlv_fetch(index, &entry)){
+        le_device_db_tlv_index_add(index, &entry);
+    }
+    return true;
+}
+
 static void le_device_db_tlv_scan(void){
-    int i;
+    uint32_t i;
     num_valid_entries = 0;
-    memset(entry_map, 0, sizeof(entry_map));
+    entries_by_address.num_indices = 0;
+    entries_by_irk.num_indices = 0;
     for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
-        // lookup entry
-        le_device_db_entry_t entry;
-        if (!le_device_db_tlv_fetch(i, &entry)) continue;
-
-        entry_map[i] = 1;
-        num_valid_entries++;
+        entry_index[i].addr_type = INVALID_ENTRY_ADDR_TYPE;
     }
+    // single pass over stored entries
+#if NVM_NUM_DEVICE_DB_ENTRIES > 256
+    btstack_tlv_iterate_tags(le_device_db_tlv_btstack_tlv_impl, le_device_db_tlv_btstack_tlv_context,
+                             le_device_db_tlv_tag_for_index(0), le_device_db_tlv_tag_for_index(255),
+                             &le_device_db_tlv_scan_handler, NULL);
+    btstack_tlv_iterate_tags(le_device_db_tlv_btstack_tlv_impl, le_device_db_tlv_btstack_tlv_context,
+                             le_device_db_tlv_tag_for_index(256), le_device_db_tlv_tag_for_index(NVM_NUM_DEVICE_DB_ENTRIES - 1),
+                             &le_device_db_tlv_scan_handler, NULL);
+#else
+    btstack_tlv_iterate_tags(le_device_db_tlv_btstack_tlv_impl, le_device_db_tlv_btstack_tlv_context,
+                             le_device_db_tlv_tag_for_index(0), le_device_db_tlv_tag_for_index(NVM_NUM_DEVICE_DB_ENTRIES - 1),
+                             &le_device_db_tlv_scan_handler, NULL);
+#endif
     log_info("num valid le device entries %u", (unsigned int) num_valid_entries);
 }
 
@@ -184,16 +334,13 @@ void le_device_db_remove(int index){
     btstack_assert(index < le_device_db_max_count());
     
     // check if entry exists
-    if (entry_map[index] == 0u) return; 
+    if (!le_device_db_tlv_index_entry_valid(index)) return;
 
 	// delete entry in TLV
 	le_device_db_tlv_delete(index);
 
-	// mark as unused
-    entry_map[index] = 0;
-
-    // keep track
-    num_valid_entries--;
+	// mark as unused and keep track
+    le_device_db_tlv_index_remove(index);
 }
 
 int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
@@ -201,28 +348,22 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
     uint32_t highest_seq_nr = 0;
     uint32_t lowest_seq_nr  = 0xFFFFFFFFU;
     int index_for_lowest_seq_nr = -1;
-    int index_for_addr  = -1;
+    int index_for_addr  = le_device_db_lookup_by_identity_address(addr_type, addr);
     int index_for_empty = -1;
-    bool new_entry = false;
 
-	// find unused entry in the used list
+	// find unused entry and entry with lowest seq nr in index
     int i;
     for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
-         if (entry_map[i]) {
-            le_device_db_entry_t entry;
-            le_device_db_tlv_fetch(i, &entry);
-            // found addr?
-            if ((memcmp(addr, entry.addr, 6) == 0) && (addr_type == entry.addr_type)){
-                index_for_addr = i;
-            }
+         if (le_device_db_tlv_index_entry_valid(i)) {
+            const le_device_db_tlv_index_entry_t * index_entry = &entry_index[i];
             // update highest seq nr
-            if (entry.seq_nr > highest_seq_nr){
-                highest_seq_nr = entry.seq_nr;
+            if (index_entry->seq_nr > highest_seq_nr){
+                highest_seq_nr = index_entry->seq_nr;
             }
             // find entry with lowest seq nr
-            if ((index_for_lowest_seq_nr == -1) || (entry.seq_nr < lowest_seq_nr)){
+            if ((index_for_lowest_seq_nr == -1) || (index_entry->seq_nr < lowest_seq_nr)){
                 index_for_lowest_seq_nr = i;
-                lowest_seq_nr = entry.seq_nr;
+                lowest_seq_nr = index_entry->seq_nr;
             }
         } else {
             index_for_empty = i;
@@ -235,7 +376,6 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
     if (index_for_addr >= 0){
         index_to_use = index_for_addr;
     } else if (index_for_empty >= 0){
-        new_entry = true;
         index_to_use = index_for_empty;
     } else if (index_for_lowest_seq_nr >= 0){
         index_to_use = index_for_lowest_seq_nr;
@@ -267,13 +407,12 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
         log_error("tag store failed");
         return -1;
     }
-    // set in entry_mape
-    entry_map[index_to_use] = 1;
 
-    // keep track - don't increase if old entry found or replaced
-    if (new_entry){
-        num_valid_entries++;
+    // update index - old entry found or replaced is removed first
+    if (le_device_db_tlv_index_entry_valid(index_to_use)){
+        le_device_db_tlv_index_remove(index_to_use);
     }
+    le_device_db_tlv_index_add(index_to_use, &entry);
 
     return index_to_use;
 }
@@ -281,21 +420,42 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
 
 // get device information: addr type and address
 void le_device_db_info(int index, int * addr_type, bd_addr_t addr, sm_key_t irk){
+    btstack_assert(index >= 0);
+    btstack_assert(index < NVM_NUM_DEVICE_DB_ENTRIES);
 
-	// fetch entry
-    le_device_db_entry_t entry;
-    int ok = le_device_db_tlv_fetch(index, &entry);
+    // use in-memory index, set defaults if not found
+    const le_device_db_tlv_index_entry_t * index_entry = &entry_index[index];
+    bool ok = le_device_db_tlv_index_entry_valid(index);
 
-    // set defaults if not found
-    if (!ok) {
-        memset(&entry, 0, sizeof(le_device_db_entry_t));
-        entry.addr_type = BD_ADDR_TYPE_UNKNOWN;
+    // setup return values
+    if (addr_type != NULL) *addr_type = ok ? index_entry->addr_type : BD_ADDR_TYPE_UNKNOWN;
+    if (addr != NULL) {
+        if (ok) {
+            (void)memcpy(addr, index_entry->addr, 6);
+        } else {
+            memset(addr, 0, 6);
+        }
+    }
+    if (irk != NULL) {
+        if (ok) {
+            (void)memcpy(irk, index_entry->irk, 16);
+        } else {
+            memset(irk, 0, 16);
+        }
     }
+}
 
-    // setup return values
-    if (addr_type != NULL) *addr_type = entry.addr_type;
-    if (addr != NULL) (void)memcpy(addr, entry.addr, 6);
-    if (irk != NULL) (void)memcpy(irk, entry.irk, 16);
+int le_device_db_lookup_by_identity_address(int addr_type, const bd_addr_t addr){
+    le_device_db_tlv_index_entry_t key;
+    key.addr_type = (uint8_t) addr_type;
+    (void)memcpy(key.addr, addr, 6);
+    return le_device_db_tlv_sorted_list_lookup(&entries_by_address, &key);
+}
+
+int le_device_db_lookup_by_irk(const sm_key_t irk){
+    le_device_db_tlv_index_entry_t key;
+    (void)memcpy(key.irk, irk, 16);
+    return le_device_db_tlv_sorted_list_lookup(&entries_by_irk, &key);
 }
 
 void le_device_db_encryption_set(int index, uint16_t ediv, uint8_t rand[8], sm_key_t ltk, int key_size, int authenticated, int authorized, int secure_connection){
@@ -458,7 +618,7 @@ void le_device_db_dump(void){
     uint32_t i;
 
     for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
-        if (!entry_map[i]) continue;
+        if (!le_device_db_tlv_index_entry_valid(i)) continue;
 		// fetch entry
 		le_device_db_entry_t entry;
 		le_device_db_tlv_fetch(i, &entry);
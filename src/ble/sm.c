@@ -259,6 +259,35 @@ static bd_addr_t sm_address_resolution_address;
 static void *    sm_address_resolution_context;
 static address_resolution_mode_t sm_address_resolution_mode;
 static btstack_linked_list_t sm_address_resolution_general_queue;
+static uint32_t  sm_address_resolution_start_ms;
+static sm_address_resolution_statistics_t sm_address_resolution_statistics;
+
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+#ifndef SM_ADDRESS_RESOLUTION_CACHE_SIZE
+#define SM_ADDRESS_RESOLUTION_CACHE_SIZE 16
+#endif
+#ifndef SM_ADDRESS_RESOLUTION_CACHE_TIMEOUT_MS
+// default Resolvable Private Address timeout of 15 minutes, see Core Spec Vol 3, Part C, Appendix A
+#define SM_ADDRESS_RESOLUTION_CACHE_TIMEOUT_MS (15u * 60u * 1000u)
+#endif
+typedef struct {
+    bd_addr_t address;
+    int       le_device_index;  // -1 if unused
+    uint32_t  created_ms;       // expires after SM_ADDRESS_RESOLUTION_CACHE_TIMEOUT_MS
+    uint32_t  last_used_ms;     // least recently used entry gets replaced
+} sm_address_resolution_cache_entry_t;
+static sm_address_resolution_cache_entry_t sm_address_resolution_cache[SM_ADDRESS_RESOLUTION_CACHE_SIZE];
+// lookup starts with device from cache, which needs to be verified
+static bool sm_address_resolution_cache_verify;
+#endif
+
+// with local AES128, IRKs are checked in batches without AES128 requests
+#if defined(ENABLE_SOFTWARE_AES128) || defined(HAVE_AES128)
+#define USE_SM_ADDRESS_RESOLUTION_BATCH
+#ifndef SM_ADDRESS_RESOLUTION_BATCH_SIZE
+#define SM_ADDRESS_RESOLUTION_BATCH_SIZE 16
+#endif
+#endif
 
 // aes128 crypto engine.
 static sm_aes128_state_t  sm_aes128_state;
@@ -270,8 +299,6 @@ static btstack_crypto_aes128_t   sm_crypto_aes128_request;
 static btstack_crypto_ecc_p256_t sm_crypto_ecc_p256_request;
 #endif
 
-// temp storage for random data
-static uint8_t sm_random_data[8];
 static uint8_t sm_aes128_key[16];
 static uint8_t sm_aes128_plaintext[16];
 static uint8_t sm_aes128_ciphertext[16];
@@ -303,6 +330,13 @@ typedef struct sm_setup_context {
 
     btstack_timer_source_t sm_timeout;
 
+    // crypto requests and temp storage for random data, per context to allow for concurrent pairings
+    btstack_crypto_random_t   sm_crypto_random_request;
+#ifdef ENABLE_LE_SECURE_CONNECTIONS
+    btstack_crypto_ecc_p256_t sm_crypto_ecc_p256_request;
+#endif
+    uint8_t   sm_random_data[8];
+
     // user response, (Phase 1 and/or 2)
     uint8_t   sm_user_response;
     uint8_t   sm_keypress_notification; // bitmap: passkey started, digit entered, digit erased, passkey cleared, passkey complete, 3 bit count
@@ -378,12 +412,40 @@ typedef struct sm_setup_context {
 #endif
 } sm_setup_context_t;
 
+// number of pairings that can be performed concurrently
+#ifndef MAX_NR_SM_SETUP_CONTEXTS
+#define MAX_NR_SM_SETUP_CONTEXTS 1
+#endif
+
 //
-static sm_setup_context_t the_setup;
-static sm_setup_context_t * setup = &the_setup;
+static sm_setup_context_t sm_setup_contexts[MAX_NR_SM_SETUP_CONTEXTS];
+static sm_setup_context_t * setup = &sm_setup_contexts[0];
 
-// active connection - the one for which the_setup is used for
-static uint16_t sm_active_connection_handle = HCI_CON_HANDLE_INVALID;
+// active connections - the ones for which the setup contexts are used for
+static hci_con_handle_t sm_setup_context_handles[MAX_NR_SM_SETUP_CONTEXTS];
+
+// set if a setup context was released during sm_run
+static bool sm_setup_context_released;
+
+#ifdef ENABLE_LE_SECURE_CONNECTIONS
+// set if the local ec key has been used for pairing and should be replaced once no pairing uses it
+static bool sm_ec_key_outdated;
+#endif
+
+static int sm_setup_context_index_for_handle(hci_con_handle_t con_handle){
+    int i;
+    for (i = 0; i < MAX_NR_SM_SETUP_CONTEXTS; i++){
+        if (sm_setup_context_handles[i] == con_handle) return i;
+    }
+    return -1;
+}
+
+// use setup context of connection, if it has one
+static void sm_setup_context_select(hci_con_handle_t con_handle){
+    int index = sm_setup_context_index_for_handle(con_handle);
+    if (index < 0) return;
+    setup = &sm_setup_contexts[index];
+}
 
 // @return 1 if oob data is available
 // stores oob data in provided 16 byte buffer if not null
@@ -677,6 +739,7 @@ static void sm_pairing_complete(sm_connection_t * sm_conn, uint8_t status, uint8
 static void sm_timeout_handler(btstack_timer_source_t * timer){
     log_info("SM timeout");
     sm_connection_t * sm_conn = (sm_connection_t*) btstack_run_loop_get_timer_context(timer);
+    sm_setup_context_select(sm_conn->sm_handle);
     sm_conn->sm_engine_state = SM_GENERAL_TIMEOUT;
     sm_reencryption_complete(sm_conn, ERROR_CODE_CONNECTION_TIMEOUT);
     sm_pairing_complete(sm_conn, ERROR_CODE_CONNECTION_TIMEOUT, 0);
@@ -933,15 +996,122 @@ static int sm_address_resolution_idle(void){
     return sm_address_resolution_mode == ADDRESS_RESOLUTION_IDLE;
 }
 
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+static bool sm_address_resolution_is_resolvable_private_address(uint8_t addr_type, const bd_addr_t addr){
+    return (addr_type == BD_ADDR_TYPE_LE_RANDOM) && ((addr[0] & 0xc0u) == 0x40u);
+}
+
+static sm_address_resolution_cache_entry_t * sm_address_resolution_cache_get(const bd_addr_t address){
+    uint32_t now = btstack_run_loop_get_time_ms();
+    int i;
+    for (i = 0; i < SM_ADDRESS_RESOLUTION_CACHE_SIZE; i++){
+        sm_address_resolution_cache_entry_t * entry = &sm_address_resolution_cache[i];
+        if (entry->le_device_index < 0) continue;
+        if ((now - entry->created_ms) >= SM_ADDRESS_RESOLUTION_CACHE_TIMEOUT_MS){
+            // peer has generated a new address by now
+            entry->le_device_index = -1;
+            continue;
+        }
+        if (memcmp(entry->address, address, 6) != 0) continue;
+        entry->last_used_ms = now;
+        return entry;
+    }
+    return NULL;
+}
+
+static void sm_address_resolution_cache_add(const bd_addr_t address, int le_device_index){
+    uint32_t now = btstack_run_loop_get_time_ms();
+    sm_address_resolution_cache_entry_t * entry = sm_address_resolution_cache_get(address);
+    if (entry == NULL){
+        // use unused or least recently used entry
+        entry = &sm_address_resolution_cache[0];
+        int i;
+        for (i = 0; i < SM_ADDRESS_RESOLUTION_CACHE_SIZE; i++){
+            sm_address_resolution_cache_entry_t * candidate = &sm_address_resolution_cache[i];
+            if (candidate->le_device_index < 0){
+                entry = candidate;
+                break;
+            }
+            if ((now - candidate->last_used_ms) > (now - entry->last_used_ms)){
+                entry = candidate;
+            }
+        }
+        (void)memcpy(entry->address, address, 6);
+        entry->created_ms = now;
+    }
+    entry->le_device_index = le_device_index;
+    entry->last_used_ms = now;
+}
+
+static void sm_address_resolution_cache_remove(const bd_addr_t address){
+    int i;
+    for (i = 0; i < SM_ADDRESS_RESOLUTION_CACHE_SIZE; i++){
+        if (memcmp(sm_address_resolution_cache[i].address, address, 6) != 0) continue;
+        sm_address_resolution_cache[i].le_device_index = -1;
+    }
+}
+
+void sm_address_resolution_cache_flush(void){
+    int i;
+    for (i = 0; i < SM_ADDRESS_RESOLUTION_CACHE_SIZE; i++){
+        sm_address_resolution_cache[i].le_device_index = -1;
+    }
+}
+#endif
+
 static void sm_address_resolution_start_lookup(uint8_t addr_type, hci_con_handle_t con_handle, bd_addr_t addr, address_resolution_mode_t mode, void * context){
     (void)memcpy(sm_address_resolution_address, addr, 6);
     sm_address_resolution_addr_type = addr_type;
     sm_address_resolution_test = 0;
     sm_address_resolution_mode = mode;
     sm_address_resolution_context = context;
+    sm_address_resolution_start_ms = btstack_run_loop_get_time_ms();
+    sm_address_resolution_statistics.lookups++;
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+    sm_address_resolution_cache_verify = false;
+#endif
+    // start with device with matching identity address
+    int le_device_index = le_device_db_lookup_by_identity_address(addr_type, addr);
+    if (le_device_index >= 0){
+        sm_address_resolution_test = le_device_index;
+    } else if (addr_type == BD_ADDR_TYPE_LE_PUBLIC){
+        // public address cannot be resolved by IRK
+        sm_address_resolution_test = le_device_db_max_count();
+    }
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+    // start with device from cache
+    else if (sm_address_resolution_is_resolvable_private_address(addr_type, addr)){
+        sm_address_resolution_cache_entry_t * entry = sm_address_resolution_cache_get(addr);
+        if (entry != NULL){
+            sm_address_resolution_test = entry->le_device_index;
+            sm_address_resolution_cache_verify = true;
+        }
+    }
+#endif
     sm_notify_client_base(SM_EVENT_IDENTITY_RESOLVING_STARTED, con_handle, addr_type, addr);
 }
 
+// continue with next device, or with first device if device from cache did not match
+static void sm_address_resolution_test_next(void){
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+    if (sm_address_resolution_cache_verify){
+        sm_address_resolution_cache_verify = false;
+        sm_address_resolution_cache_remove(sm_address_resolution_address);
+        sm_address_resolution_test = 0;
+        return;
+    }
+#endif
+    sm_address_resolution_test++;
+}
+
+void sm_address_resolution_get_statistics(sm_address_resolution_statistics_t * statistics){
+    *statistics = sm_address_resolution_statistics;
+}
+
+void sm_address_resolution_reset_statistics(void){
+    memset(&sm_address_resolution_statistics, 0, sizeof(sm_address_resolution_statistics));
+}
+
 int sm_address_resolution_lookup(uint8_t address_type, bd_addr_t address){
     // check if already in list
     btstack_linked_list_iterator_t it;
@@ -1087,19 +1257,36 @@ static bool sm_key_distribution_all_received(void) {
     return (setup->sm_key_distribution_expected_set & setup->sm_key_distribution_received_set) == setup->sm_key_distribution_expected_set;
 }
 
+#ifdef ENABLE_LE_SECURE_CONNECTIONS
+static bool sm_setup_context_any_active(void){
+    int i;
+    for (i = 0; i < MAX_NR_SM_SETUP_CONTEXTS; i++){
+        if (sm_setup_context_handles[i] != HCI_CON_HANDLE_INVALID) return true;
+    }
+    return false;
+}
+#endif
+
 static void sm_done_for_handle(hci_con_handle_t con_handle){
-    if (sm_active_connection_handle == con_handle){
-        sm_timeout_stop();
-        sm_active_connection_handle = HCI_CON_HANDLE_INVALID;
-        log_info("sm: connection 0x%x released setup context", con_handle);
+    int index = sm_setup_context_index_for_handle(con_handle);
+    if (index < 0) return;
+
+    setup = &sm_setup_contexts[index];
+    sm_timeout_stop();
+    sm_setup_context_handles[index] = HCI_CON_HANDLE_INVALID;
+    sm_setup_context_released = true;
+    log_info("sm: connection 0x%x released setup context %u", con_handle, index);
 
 #ifdef ENABLE_LE_SECURE_CONNECTIONS
-        // generate new ec key after each pairing (that used it)
-        if (setup->sm_use_secure_connections){
-            sm_ec_generate_new_key();
-        }
-#endif
+    // generate new ec key after each pairing (that used it), as soon as no other pairing might use it
+    if (setup->sm_use_secure_connections){
+        sm_ec_key_outdated = true;
+    }
+    if (sm_ec_key_outdated && !sm_setup_context_any_active()){
+        sm_ec_key_outdated = false;
+        sm_ec_generate_new_key();
     }
+#endif
 }
 
 static void sm_master_pairing_success(sm_connection_t *connection) {// master -> all done
@@ -1272,6 +1459,27 @@ static int sm_stk_generation_init(sm_connection_t * sm_conn){
 
 static void sm_address_resolution_handle_event(address_resolution_event_t event){
 
+    // update statistics and cache
+    uint32_t duration_ms = btstack_run_loop_get_time_ms() - sm_address_resolution_start_ms;
+    sm_address_resolution_statistics.total_time_ms += duration_ms;
+    if (event == ADDRESS_RESOLUTION_SUCCEEDED){
+        sm_address_resolution_statistics.resolved++;
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+        if (sm_address_resolution_cache_verify){
+            sm_address_resolution_statistics.cache_hits++;
+        }
+        if (sm_address_resolution_is_resolvable_private_address(sm_address_resolution_addr_type, sm_address_resolution_address)){
+            sm_address_resolution_cache_add(sm_address_resolution_address, sm_address_resolution_test);
+        }
+#endif
+    } else {
+        sm_address_resolution_statistics.failed++;
+    }
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+    sm_address_resolution_cache_verify = false;
+#endif
+    log_info("LE Device Lookup: done after %u ms", (unsigned int) duration_ms);
+
     // cache and reset context
     int matched_device_id = sm_address_resolution_test;
     address_resolution_mode_t mode = sm_address_resolution_mode;
@@ -1431,22 +1639,15 @@ static void sm_store_bonding_information(sm_connection_t * sm_conn){
 
     // lookup device based on IRK
     if (setup->sm_key_distribution_received_set & SM_KEYDIST_FLAG_IDENTITY_INFORMATION){
-        int i;
-        for (i=0; i < le_device_db_max_count(); i++){
-            sm_key_t irk;
+        int index = le_device_db_lookup_by_irk(setup->sm_peer_irk);
+        if (index >= 0){
             bd_addr_t address;
-            int address_type = BD_ADDR_TYPE_UNKNOWN;
-            le_device_db_info(i, &address_type, address, irk);
-            // skip unused entries
-            if (address_type == BD_ADDR_TYPE_UNKNOWN) continue;
+            le_device_db_info(index, NULL, address, NULL);
             // compare Identity Address
-            if (memcmp(address, setup->sm_peer_address, 6) != 0) continue;
-            // compare Identity Resolving Key
-            if (memcmp(irk, setup->sm_peer_irk, 16) != 0) continue;
-
-            log_info("sm: device found for IRK, updating");
-            le_db_index = i;
-            break;
+            if (memcmp(address, setup->sm_peer_address, 6) == 0){
+                log_info("sm: device found for IRK, updating");
+                le_db_index = index;
+            }
         }
     } else {
         // assert IRK is set to zero
@@ -1456,19 +1657,9 @@ static void sm_store_bonding_information(sm_connection_t * sm_conn){
     // if not found, lookup via public address if possible
     log_info("sm peer addr type %u, peer addres %s", setup->sm_peer_addr_type, bd_addr_to_str(setup->sm_peer_address));
     if ((le_db_index < 0) && (setup->sm_peer_addr_type == BD_ADDR_TYPE_LE_PUBLIC)){
-        int i;
-        for (i=0; i < le_device_db_max_count(); i++){
-            bd_addr_t address;
-            int address_type = BD_ADDR_TYPE_UNKNOWN;
-            le_device_db_info(i, &address_type, address, NULL);
-            // skip unused entries
-            if (address_type == BD_ADDR_TYPE_UNKNOWN) continue;
-            log_info("device %u, sm peer addr type %u, peer addres %s", i, address_type, bd_addr_to_str(address));
-            if ((address_type == BD_ADDR_TYPE_LE_PUBLIC) && (memcmp(address, setup->sm_peer_address, 6) == 0)){
-                log_info("sm: device found for public address, updating");
-                le_db_index = i;
-                break;
-            }
+        le_db_index = le_device_db_lookup_by_identity_address(BD_ADDR_TYPE_LE_PUBLIC, setup->sm_peer_address);
+        if (le_db_index >= 0){
+            log_info("sm: device found for public address, updating");
         }
     }
 
@@ -1563,7 +1754,7 @@ static void sm_sc_start_calculating_local_confirm(sm_connection_t * sm_conn){
     if (setup->sm_stk_generation_method == OOB){
         sm_conn->sm_engine_state = SM_SC_W2_CMAC_FOR_CONFIRMATION;
     } else {
-        btstack_crypto_random_generate(&sm_crypto_random_request, setup->sm_local_nonce, 16, &sm_handle_random_result_sc_next_w2_cmac_for_confirmation, (void *)(uintptr_t) sm_conn->sm_handle);
+        btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_local_nonce, 16, &sm_handle_random_result_sc_next_w2_cmac_for_confirmation, (void *)(uintptr_t) sm_conn->sm_handle);
     }
 }
 
@@ -1573,7 +1764,7 @@ static void sm_sc_state_after_receiving_random(sm_connection_t * sm_conn){
         if (setup->sm_stk_generation_method == OOB){
             // generate Nb
             log_info("Generate Nb");
-            btstack_crypto_random_generate(&sm_crypto_random_request, setup->sm_local_nonce, 16, &sm_handle_random_result_sc_next_send_pairing_random, (void *)(uintptr_t) sm_conn->sm_handle);
+            btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_local_nonce, 16, &sm_handle_random_result_sc_next_send_pairing_random, (void *)(uintptr_t) sm_conn->sm_handle);
         } else {
             sm_conn->sm_engine_state = SM_SC_SEND_PAIRING_RANDOM;
         }
@@ -1618,6 +1809,7 @@ static void sm_sc_cmac_done(uint8_t * hash){
 
     sm_connection_t * sm_conn = sm_cmac_connection;
     sm_cmac_connection = NULL;
+    sm_setup_context_select(sm_conn->sm_handle);
 #ifdef ENABLE_CROSS_TRANSPORT_KEY_DERIVATION
     link_key_type_t link_key_type;
 #endif
@@ -2141,6 +2333,91 @@ static bool sm_run_rau(void){
     return false;
 }
 
+#ifdef USE_SM_ADDRESS_RESOLUTION_BATCH
+#ifdef ENABLE_SOFTWARE_AES128
+static btstack_aes128_key_schedule_t         sm_address_resolution_key_schedules[SM_ADDRESS_RESOLUTION_BATCH_SIZE];
+static const btstack_aes128_key_schedule_t * sm_address_resolution_key_schedule_pointers[SM_ADDRESS_RESOLUTION_BATCH_SIZE];
+static uint8_t sm_address_resolution_plaintext[SM_ADDRESS_RESOLUTION_BATCH_SIZE * 16];
+#endif
+static uint8_t sm_address_resolution_ciphertext[SM_ADDRESS_RESOLUTION_BATCH_SIZE * 16];
+
+// match address against next SM_ADDRESS_RESOLUTION_BATCH_SIZE devices using local AES128
+static void sm_address_resolution_test_batch(void){
+    int device_indices[SM_ADDRESS_RESOLUTION_BATCH_SIZE];
+    uint16_t num_blocks = 0;
+    int identity_address_match = -1;
+    int max_count = le_device_db_max_count();
+    int index = sm_address_resolution_test;
+    sm_key_t r_prime;
+    sm_ah_r_prime(sm_address_resolution_address, r_prime);
+
+    while ((index < max_count) && (num_blocks < SM_ADDRESS_RESOLUTION_BATCH_SIZE)){
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+        // only verify device from cache
+        if (sm_address_resolution_cache_verify && (index != sm_address_resolution_test)) break;
+#endif
+        int addr_type = BD_ADDR_TYPE_UNKNOWN;
+        bd_addr_t addr;
+        sm_key_t irk;
+        le_device_db_info(index, &addr_type, addr, irk);
+
+        // skip unused entries
+        if (addr_type == BD_ADDR_TYPE_UNKNOWN){
+            index++;
+            continue;
+        }
+
+        if ((sm_address_resolution_addr_type == addr_type) && (memcmp(addr, sm_address_resolution_address, 6) == 0)){
+            identity_address_match = index;
+            break;
+        }
+
+        device_indices[num_blocks] = index;
+#ifdef ENABLE_SOFTWARE_AES128
+        btstack_aes128_set_key(&sm_address_resolution_key_schedules[num_blocks], irk);
+        sm_address_resolution_key_schedule_pointers[num_blocks] = &sm_address_resolution_key_schedules[num_blocks];
+        (void)memcpy(&sm_address_resolution_plaintext[num_blocks * 16u], r_prime, 16);
+#else
+        btstack_aes128_calc(irk, r_prime, &sm_address_resolution_ciphertext[num_blocks * 16u]);
+#endif
+        num_blocks++;
+        index++;
+    }
+
+#ifdef ENABLE_SOFTWARE_AES128
+    btstack_aes128_encrypt_blocks(sm_address_resolution_key_schedule_pointers, sm_address_resolution_plaintext, sm_address_resolution_ciphertext, num_blocks);
+    // don't keep expanded IRKs around
+    memset(sm_address_resolution_key_schedules, 0, num_blocks * sizeof(btstack_aes128_key_schedule_t));
+#endif
+
+    // compare hash = ah(irk, prand) against calculated addresses in order of devices
+    uint16_t i;
+    for (i = 0; i < num_blocks; i++){
+        if (memcmp(&sm_address_resolution_address[3], &sm_address_resolution_ciphertext[(i * 16u) + 13u], 3) == 0){
+            log_info("LE Device Lookup: matched resolvable private address");
+            sm_address_resolution_test = device_indices[i];
+            sm_address_resolution_handle_event(ADDRESS_RESOLUTION_SUCCEEDED);
+            return;
+        }
+    }
+
+    if (identity_address_match >= 0){
+        log_info("LE Device Lookup: found CSRK by { addr_type, address} ");
+        sm_address_resolution_test = identity_address_match;
+        sm_address_resolution_handle_event(ADDRESS_RESOLUTION_SUCCEEDED);
+        return;
+    }
+
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+    if (sm_address_resolution_cache_verify){
+        sm_address_resolution_test_next();
+        return;
+    }
+#endif
+    sm_address_resolution_test = index;
+}
+#endif
+
 // CSRK Lookup
 static bool sm_run_csrk(void){
     btstack_linked_list_iterator_t it;
@@ -2172,6 +2449,18 @@ static bool sm_run_csrk(void){
 
     // -- Continue with CSRK device lookup by public or resolvable private address
     if (!sm_address_resolution_idle()){
+#ifdef USE_SM_ADDRESS_RESOLUTION_BATCH
+        if (sm_address_resolution_addr_type != BD_ADDR_TYPE_LE_PUBLIC){
+            sm_address_resolution_test_batch();
+            if (!sm_address_resolution_idle() && (sm_address_resolution_test >= le_device_db_max_count())){
+                log_info("LE Device Lookup: not found");
+                sm_address_resolution_handle_event(ADDRESS_RESOLUTION_FAILED);
+            }
+            // continue with next batch or next lookup
+            sm_trigger_run();
+            return false;
+        }
+#endif
         log_info("LE Device Lookup: device %u/%u", sm_address_resolution_test, le_device_db_max_count());
         while (sm_address_resolution_test < le_device_db_max_count()){
             int addr_type = BD_ADDR_TYPE_UNKNOWN;
@@ -2182,7 +2471,7 @@ static bool sm_run_csrk(void){
 
             // skip unused entries
             if (addr_type == BD_ADDR_TYPE_UNKNOWN){
-                sm_address_resolution_test++;
+                sm_address_resolution_test_next();
                 continue;
             }
 
@@ -2194,7 +2483,7 @@ static bool sm_run_csrk(void){
 
             // if connection type is public, it must be a different one
             if (sm_address_resolution_addr_type == BD_ADDR_TYPE_LE_PUBLIC){
-                sm_address_resolution_test++;
+                sm_address_resolution_test_next();
                 continue;
             }
 
@@ -2287,17 +2576,21 @@ static bool sm_run_basic(void){
 }
 
 static void sm_run_activate_connection(void){
-    // Find connections that requires setup context and make active if no other is locked
+    // Find connections that requires setup context and make active if a setup context is free
     btstack_linked_list_iterator_t it;
     hci_connections_get_iterator(&it);
-    while((sm_active_connection_handle == HCI_CON_HANDLE_INVALID) && btstack_linked_list_iterator_has_next(&it)){
+    int free_index = sm_setup_context_index_for_handle(HCI_CON_HANDLE_INVALID);
+    while((free_index >= 0) && btstack_linked_list_iterator_has_next(&it)){
         hci_connection_t * hci_connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
         sm_connection_t  * sm_connection = &hci_connection->sm_connection;
-        // - if no connection locked and we're ready/waiting for setup context, fetch it and start
+        // - if setup context is free and we're ready/waiting for setup context, fetch it and start
         bool done = true;
         int err;
         UNUSED(err);
 
+        // skip connections that already hold a setup context
+        if (sm_setup_context_index_for_handle(sm_connection->sm_handle) >= 0) continue;
+
 #ifdef ENABLE_LE_SECURE_CONNECTIONS
         // assert ec key is ready
         if (   (sm_connection->sm_engine_state == SM_RESPONDER_PH1_PAIRING_REQUEST_RECEIVED)
@@ -2309,6 +2602,10 @@ static void sm_run_activate_connection(void){
             if (ec_key_generation_state != EC_KEY_GENERATION_DONE){
                 continue;
             }
+            // wait for new ec key if current one has been used by a completed pairing
+            if (sm_ec_key_outdated){
+                continue;
+            }
         }
 #endif
 
@@ -2336,8 +2633,9 @@ static void sm_run_activate_connection(void){
                 break;
         }
         if (done){
-            sm_active_connection_handle = sm_connection->sm_handle;
-            log_info("sm: connection 0x%04x locked setup context as %s, state %u", sm_active_connection_handle, sm_connection->sm_role ? "responder" : "initiator", sm_connection->sm_engine_state);
+            sm_setup_context_handles[free_index] = sm_connection->sm_handle;
+            log_info("sm: connection 0x%04x locked setup context %u as %s, state %u", sm_connection->sm_handle, free_index, sm_connection->sm_role ? "responder" : "initiator", sm_connection->sm_engine_state);
+            free_index = sm_setup_context_index_for_handle(HCI_CON_HANDLE_INVALID);
         }
     }
 }
@@ -2378,7 +2676,7 @@ static void sm_run_send_keypress_notification(sm_connection_t * connection){
     sm_send_connectionless(connection, (uint8_t*) buffer, sizeof(buffer));
 
     // try
-    l2cap_request_can_send_fix_channel_now_event(sm_active_connection_handle, connection->sm_cid);
+    l2cap_request_can_send_fix_channel_now_event(connection->sm_handle, connection->sm_cid);
 }
 
 static void sm_run_distribute_keys(sm_connection_t * connection){
@@ -2519,66 +2817,17 @@ static void sm_key_distribution_complete_initiator(sm_connection_t * connection)
     }
 }
 
-static void sm_run(void){
-
-    // assert that stack has already bootet
-    if (hci_get_state() != HCI_STATE_WORKING) return;
-
-    // assert that we can send at least commands
-    if (!hci_can_send_command_packet_now()) return;
-
-    // pause until IR/ER are ready
-    if (sm_persistent_keys_random_active) return;
-
-    bool done;
-
-    //
-    // non-connection related behaviour
-    //
-
-    done = sm_run_dpkg();
-    if (done) return;
-
-    done = sm_run_rau();
-    if (done) return;
-
-    done = sm_run_csrk();
-    if (done) return;
-
-    done = sm_run_oob();
-    if (done) return;
-
-    // assert that we can send at least commands - cmd might have been sent by crypto engine
-    if (!hci_can_send_command_packet_now()) return;
-
-    // handle basic actions that don't requires the full context
-    done = sm_run_basic();
-    if (done) return;
+static void sm_run_setup_context(sm_connection_t * connection){
+    hci_con_handle_t con_handle = connection->sm_handle;
 
-    //
-    // active connection handling
-    // -- use loop to handle next connection if lock on setup context is released
+    // -- use loop to handle connection again after state change
 
     while (true) {
 
-        sm_run_activate_connection();
-
-        if (sm_active_connection_handle == HCI_CON_HANDLE_INVALID) return;
-
-        //
-        // active connection handling
-        //
-
-        sm_connection_t * connection = sm_get_connection_for_handle(sm_active_connection_handle);
-        if (!connection) {
-            log_info("no connection for handle 0x%04x", sm_active_connection_handle);
-            return;
-        }
-
         // assert that we could send a SM PDU - not needed for all of the following
-        if (!l2cap_can_send_fixed_channel_packet_now(sm_active_connection_handle, connection->sm_cid)) {
+        if (!l2cap_can_send_fixed_channel_packet_now(con_handle, connection->sm_cid)) {
             log_info("cannot send now, requesting can send now event");
-            l2cap_request_can_send_fix_channel_now_event(sm_active_connection_handle, connection->sm_cid);
+            l2cap_request_can_send_fix_channel_now_event(con_handle, connection->sm_cid);
             return;
         }
 
@@ -2597,7 +2846,7 @@ static void sm_run(void){
 #endif
 
         log_info("sm_run: state %u", connection->sm_engine_state);
-        if (!l2cap_can_send_fixed_channel_packet_now(sm_active_connection_handle, connection->sm_cid)) {
+        if (!l2cap_can_send_fixed_channel_packet_now(con_handle, connection->sm_cid)) {
             log_info("sm_run // cannot send");
         }
         switch (connection->sm_engine_state){
@@ -2896,7 +3145,7 @@ static void sm_run(void){
 
 				// generate random number first, if we need to show passkey, otherwise send response
 				if (setup->sm_stk_generation_method == PK_INIT_INPUT){
-					btstack_crypto_random_generate(&sm_crypto_random_request, sm_random_data, 8, &sm_handle_random_result_ph2_tk, (void *)(uintptr_t) connection->sm_handle);
+					btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_random_data, 8, &sm_handle_random_result_ph2_tk, (void *)(uintptr_t) connection->sm_handle);
 					break;
 				}
 
@@ -3221,8 +3470,76 @@ static void sm_run(void){
                 break;
         }
 
-        // check again if active connection was released
-        if (sm_active_connection_handle != HCI_CON_HANDLE_INVALID) break;
+        break;
+    }
+}
+
+static void sm_run(void){
+
+    // assert that stack has already bootet
+    if (hci_get_state() != HCI_STATE_WORKING) return;
+
+    // assert that we can send at least commands
+    if (!hci_can_send_command_packet_now()) return;
+
+    // pause until IR/ER are ready
+    if (sm_persistent_keys_random_active) return;
+
+    bool done;
+
+    //
+    // non-connection related behaviour
+    //
+
+    done = sm_run_dpkg();
+    if (done) return;
+
+    done = sm_run_rau();
+    if (done) return;
+
+    done = sm_run_csrk();
+    if (done) return;
+
+    done = sm_run_oob();
+    if (done) return;
+
+    // assert that we can send at least commands - cmd might have been sent by crypto engine
+    if (!hci_can_send_command_packet_now()) return;
+
+    // handle basic actions that don't requires the full context
+    done = sm_run_basic();
+    if (done) return;
+
+    //
+    // active connection handling
+    // -- use loop to handle next connection if lock on setup context is released
+
+    while (true) {
+
+        sm_run_activate_connection();
+
+        sm_setup_context_released = false;
+
+        int i;
+        for (i = 0; i < MAX_NR_SM_SETUP_CONTEXTS; i++){
+            hci_con_handle_t con_handle = sm_setup_context_handles[i];
+            if (con_handle == HCI_CON_HANDLE_INVALID) continue;
+
+            // assert that we can send commands - cmd might have been sent for other connection
+            if (!hci_can_send_command_packet_now()) return;
+
+            sm_connection_t * connection = sm_get_connection_for_handle(con_handle);
+            if (!connection) {
+                log_info("no connection for handle 0x%04x", con_handle);
+                continue;
+            }
+
+            setup = &sm_setup_contexts[i];
+            sm_run_setup_context(connection);
+        }
+
+        // check again if a setup context was released
+        if (!sm_setup_context_released) break;
     }
 }
 
@@ -3419,7 +3736,7 @@ static void sm_handle_encryption_result_address_resolution(void *arg){
         return;
     }
     // no match, try next
-    sm_address_resolution_test++;
+    sm_address_resolution_test_next();
     sm_trigger_run();
 }
 
@@ -3512,7 +3829,7 @@ static void sm_handle_random_result_ph2_tk(void * arg){
     uint32_t tk;
     if (sm_fixed_passkey_in_display_role == 0xffffffffU){
         // map random to 0-999999 without speding much cycles on a modulus operation
-        tk = little_endian_read_32(sm_random_data,0);
+        tk = little_endian_read_32(setup->sm_random_data,0);
         tk = tk & 0xfffff;  // 1048575
         if (tk >= 999999u){
             tk = tk - 999999u;
@@ -3532,7 +3849,7 @@ static void sm_handle_random_result_ph2_tk(void * arg){
             sm_trigger_user_response(connection);
             // response_idle == nothing <--> sm_trigger_user_response() did not require response
             if (setup->sm_user_response == SM_USER_RESPONSE_IDLE){
-                btstack_crypto_random_generate(&sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) connection->sm_handle);
+                btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) connection->sm_handle);
             }
         }
     }   
@@ -3545,7 +3862,7 @@ static void sm_handle_random_result_ph3_div(void * arg){
     if (connection == NULL) return;
 
     // use 16 bit from random value as div
-    setup->sm_local_div = big_endian_read_16(sm_random_data, 0);
+    setup->sm_local_div = big_endian_read_16(setup->sm_random_data, 0);
     log_info_hex16("div", setup->sm_local_div);
     connection->sm_engine_state = SM_PH3_Y_GET_ENC;
     sm_trigger_run();
@@ -3556,12 +3873,12 @@ static void sm_handle_random_result_ph3_random(void * arg){
     sm_connection_t * connection = sm_get_connection_for_handle(con_handle);
     if (connection == NULL) return;
 
-    reverse_64(sm_random_data, setup->sm_local_rand);
+    reverse_64(setup->sm_random_data, setup->sm_local_rand);
     // no db for encryption size hack: encryption size is stored in lowest nibble of setup->sm_local_rand
     setup->sm_local_rand[7u] = (setup->sm_local_rand[7u] & 0xf0u) + (connection->sm_actual_encryption_key_size - 1u);
     // no db for authenticated flag hack: store flag in bit 4 of LSB
     setup->sm_local_rand[7u] = (setup->sm_local_rand[7u] & 0xefu) + (connection->sm_connection_authenticated << 4u);
-    btstack_crypto_random_generate(&sm_crypto_random_request, sm_random_data, 2, &sm_handle_random_result_ph3_div, (void *)(uintptr_t) connection->sm_handle);
+    btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_random_data, 2, &sm_handle_random_result_ph3_div, (void *)(uintptr_t) connection->sm_handle);
 }
 static void sm_validate_er_ir(void){
     // warn about default ER/IR
@@ -3887,14 +4204,14 @@ static void sm_event_packet_handler (uint8_t packet_type, uint16_t channel, uint
                                 if (setup->sm_use_secure_connections){
                                     sm_conn->sm_engine_state = SM_PH3_DISTRIBUTE_KEYS;
                                 } else {
-                                    btstack_crypto_random_generate(&sm_crypto_random_request, sm_random_data, 8, &sm_handle_random_result_ph3_random, (void *)(uintptr_t) sm_conn->sm_handle);
+                                    btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_random_data, 8, &sm_handle_random_result_ph3_random, (void *)(uintptr_t) sm_conn->sm_handle);
                                 }
                             } else {
                                 // master
                                 if (sm_key_distribution_all_received()){
                                     // skip receiving keys as there are none
                                     sm_key_distribution_handle_all_received(sm_conn);
-                                    btstack_crypto_random_generate(&sm_crypto_random_request, sm_random_data, 8, &sm_handle_random_result_ph3_random, (void *)(uintptr_t) sm_conn->sm_handle);
+                                    btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_random_data, 8, &sm_handle_random_result_ph3_random, (void *)(uintptr_t) sm_conn->sm_handle);
                                 } else {
                                     sm_conn->sm_engine_state = SM_PH3_RECEIVE_KEYS;
                                 }
@@ -3938,7 +4255,7 @@ static void sm_event_packet_handler (uint8_t packet_type, uint16_t channel, uint
                         case SM_PH2_W4_CONNECTION_ENCRYPTED:
                             if (IS_RESPONDER(sm_conn->sm_role)){
                                 // slave
-                                btstack_crypto_random_generate(&sm_crypto_random_request, sm_random_data, 8, &sm_handle_random_result_ph3_random, (void *)(uintptr_t) sm_conn->sm_handle);
+                                btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_random_data, 8, &sm_handle_random_result_ph3_random, (void *)(uintptr_t) sm_conn->sm_handle);
                             } else {
                                 // master
                                 sm_conn->sm_engine_state = SM_PH3_RECEIVE_KEYS;
@@ -4206,7 +4523,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
 
             // generate random number first, if we need to show passkey
             if (setup->sm_stk_generation_method == PK_RESP_INPUT){
-                btstack_crypto_random_generate(&sm_crypto_random_request, sm_random_data, 8, &sm_handle_random_result_ph2_tk,  (void *)(uintptr_t) sm_conn->sm_handle);
+                btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_random_data, 8, &sm_handle_random_result_ph2_tk,  (void *)(uintptr_t) sm_conn->sm_handle);
                 break;
             }
 
@@ -4229,7 +4546,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
             sm_trigger_user_response(sm_conn);
             // response_idle == nothing <--> sm_trigger_user_response() did not require response
             if (setup->sm_user_response == SM_USER_RESPONSE_IDLE){
-                btstack_crypto_random_generate(&sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) sm_conn->sm_handle);
+                btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) sm_conn->sm_handle);
             }
             break;
 
@@ -4322,7 +4639,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
             }
 
             // start calculating dhkey
-            btstack_crypto_ecc_p256_calculate_dhkey(&sm_crypto_ecc_p256_request, setup->sm_peer_q, setup->sm_dhkey, sm_sc_dhkey_calculated, (void*)(uintptr_t) sm_conn->sm_handle);
+            btstack_crypto_ecc_p256_calculate_dhkey(&setup->sm_crypto_ecc_p256_request, setup->sm_peer_q, setup->sm_dhkey, sm_sc_dhkey_calculated, (void*)(uintptr_t) sm_conn->sm_handle);
 
 
             log_info("public key received, generation method %u", setup->sm_stk_generation_method);
@@ -4352,7 +4669,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
                     case OOB:
                         // generate Nx
                         log_info("Generate Na");
-                        btstack_crypto_random_generate(&sm_crypto_random_request, setup->sm_local_nonce, 16, &sm_handle_random_result_sc_next_send_pairing_random, (void*)(uintptr_t) sm_conn->sm_handle);
+                        btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_local_nonce, 16, &sm_handle_random_result_sc_next_send_pairing_random, (void*)(uintptr_t) sm_conn->sm_handle);
                         break;
                     default:
                         btstack_assert(false);
@@ -4388,7 +4705,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
             } else {
                 // initiator
                 if (sm_just_works_or_numeric_comparison(setup->sm_stk_generation_method)){
-                    btstack_crypto_random_generate(&sm_crypto_random_request, setup->sm_local_nonce, 16, &sm_handle_random_result_sc_next_send_pairing_random, (void*)(uintptr_t) sm_conn->sm_handle);
+                    btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_local_nonce, 16, &sm_handle_random_result_sc_next_send_pairing_random, (void*)(uintptr_t) sm_conn->sm_handle);
                 } else {
                     sm_conn->sm_engine_state = SM_SC_SEND_PAIRING_RANDOM;
                 }
@@ -4513,7 +4830,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
             }
 
             // calculate and send local_confirm
-            btstack_crypto_random_generate(&sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) sm_conn->sm_handle);
+            btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) sm_conn->sm_handle);
             break;
 
         case SM_RESPONDER_PH2_W4_PAIRING_RANDOM:
@@ -4572,7 +4889,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
                     if (setup->sm_use_secure_connections){
                         sm_conn->sm_engine_state = SM_PH3_DISTRIBUTE_KEYS;
                     } else {
-                        btstack_crypto_random_generate(&sm_crypto_random_request, sm_random_data, 8, &sm_handle_random_result_ph3_random, (void *)(uintptr_t) sm_conn->sm_handle);
+                        btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_random_data, 8, &sm_handle_random_result_ph3_random, (void *)(uintptr_t) sm_conn->sm_handle);
                     }
                 }
             }
@@ -4777,10 +5094,19 @@ static void sm_state_reset(void) {
     sm_address_resolution_ah_calculation_active = 0;
     sm_address_resolution_mode = ADDRESS_RESOLUTION_IDLE;
     sm_address_resolution_general_queue = NULL;
-    sm_active_connection_handle = HCI_CON_HANDLE_INVALID;
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+    sm_address_resolution_cache_verify = false;
+    sm_address_resolution_cache_flush();
+#endif
+    int i;
+    for (i = 0; i < MAX_NR_SM_SETUP_CONTEXTS; i++){
+        sm_setup_context_handles[i] = HCI_CON_HANDLE_INVALID;
+    }
+    setup = &sm_setup_contexts[0];
     sm_persistent_keys_random_active = false;
 #ifdef ENABLE_LE_SECURE_CONNECTIONS
     ec_key_generation_state = EC_KEY_GENERATION_IDLE;
+    sm_ec_key_outdated = false;
 #endif
 }
 
@@ -4848,6 +5174,8 @@ void sm_allow_ltk_reconstruction_without_le_device_db_entry(int allow){
 static sm_connection_t * sm_get_connection_for_handle(hci_con_handle_t con_handle){
     hci_connection_t * hci_con = hci_connection_for_handle(con_handle);
     if (!hci_con) return NULL;
+    // callers operate on the setup context of this connection
+    sm_setup_context_select(con_handle);
     return &hci_con->sm_connection;
 }
 
@@ -4855,6 +5183,7 @@ static sm_connection_t * sm_get_connection_for_handle(hci_con_handle_t con_handl
 static sm_connection_t * sm_get_connection_for_bd_addr_and_type(bd_addr_t address, bd_addr_type_t addr_type){
     hci_connection_t * hci_con = hci_connection_for_bd_addr_and_type(address, addr_type);
     if (!hci_con) return NULL;
+    sm_setup_context_select(hci_con->con_handle);
     return &hci_con->sm_connection;
 }
 #endif
@@ -5005,7 +5334,7 @@ void sm_just_works_confirm(hci_con_handle_t con_handle){
         if (setup->sm_use_secure_connections){
             sm_conn->sm_engine_state = SM_SC_SEND_PUBLIC_KEY_COMMAND;
         } else {
-            btstack_crypto_random_generate(&sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) sm_conn->sm_handle);
+            btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) sm_conn->sm_handle);
         }
     }
 
@@ -5030,7 +5359,7 @@ void sm_passkey_input(hci_con_handle_t con_handle, uint32_t passkey){
     big_endian_store_32(setup->sm_tk, 12, passkey);
     setup->sm_user_response = SM_USER_RESPONSE_PASSKEY;
     if (sm_conn->sm_engine_state == SM_PH1_W4_USER_RESPONSE){
-        btstack_crypto_random_generate(&sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) sm_conn->sm_handle);
+        btstack_crypto_random_generate(&setup->sm_crypto_random_request, setup->sm_local_random, 16, &sm_handle_random_result_ph2_random, (void *)(uintptr_t) sm_conn->sm_handle);
     }
 #ifdef ENABLE_LE_SECURE_CONNECTIONS
     (void)memcpy(setup->sm_ra, setup->sm_tk, 16);
@@ -5236,19 +5565,10 @@ const uint8_t * gap_get_persistent_irk(void){
 }
 
 void gap_delete_bonding(bd_addr_type_t address_type, bd_addr_t address){
-    uint16_t i;
-    for (i=0; i < le_device_db_max_count(); i++){
-        bd_addr_t entry_address;
-        int entry_address_type = BD_ADDR_TYPE_UNKNOWN;
-        le_device_db_info(i, &entry_address_type, entry_address, NULL);
-        // skip unused entries
-        if (entry_address_type == (int) BD_ADDR_TYPE_UNKNOWN) continue;
-        if ((entry_address_type == (int) address_type) && (memcmp(entry_address, address, 6) == 0)){
+    int index = le_device_db_lookup_by_identity_address((int) address_type, address);
+    if (index < 0) return;
 #ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
-            hci_remove_le_device_db_entry_from_resolving_list(i);
+    hci_remove_le_device_db_entry_from_resolving_list(index);
 #endif
-            le_device_db_remove(i);
-            break;
-        }
-    }
+    le_device_db_remove(index);
 }
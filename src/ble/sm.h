@@ -58,6 +58,14 @@ typedef struct {
     bd_addr_type_t address_type;
 } sm_lookup_entry_t;
 
+typedef struct {
+    uint32_t lookups;           // lookups started
+    uint32_t cache_hits;        // resolvable private addresses resolved via address resolution cache
+    uint32_t resolved;          // lookups succeeded
+    uint32_t failed;            // lookups failed
+    uint32_t total_time_ms;     // sum of lookup durations, average = total_time_ms / (resolved + failed)
+} sm_address_resolution_statistics_t;
+
 /* API_START */
 
 /**
@@ -219,6 +227,25 @@ void sm_cmac_signed_write_start(const sm_key_t key, uint8_t opcode, uint16_t att
  */
 int sm_address_resolution_lookup(uint8_t address_type, bd_addr_t address);
 
+/**
+ * @brief Get address resolution statistics
+ * @param statistics
+ */
+void sm_address_resolution_get_statistics(sm_address_resolution_statistics_t * statistics);
+
+/**
+ * @brief Reset address resolution statistics
+ */
+void sm_address_resolution_reset_statistics(void);
+
+#ifdef ENABLE_LE_ADDRESS_RESOLUTION_CACHE
+/**
+ * @brief Remove all resolvable private addresses from address resolution cache
+ * @note Cached entries are verified before use, call e.g. after deleting all bondings to release entries early
+ */
+void sm_address_resolution_cache_flush(void);
+#endif
+
 /**
  * @brief Get Identity Resolving state
  * @param con_handle
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "btstack_audio_jitter_buffer.c"
+
+/*
+ *  btstack_audio_jitter_buffer.c
+ *
+ */
+
+#include <string.h>
+
+#include "btstack_audio_jitter_buffer.h"
+#include "btstack_debug.h"
+#include "btstack_util.h"
+
+// max resampling offset: 0.5 % in 16.16 fixed point
+#ifndef BTSTACK_AUDIO_JITTER_BUFFER_MAX_RESAMPLING_OFFSET
+#define BTSTACK_AUDIO_JITTER_BUFFER_MAX_RESAMPLING_OFFSET (0x10000 / 200)
+#endif
+
+// PI controller: proportional gain 2^-KP_SHIFT per frame, integral gain 2^-KI_SHIFT per frame^2
+#ifndef BTSTACK_AUDIO_JITTER_BUFFER_KP_SHIFT
+#define BTSTACK_AUDIO_JITTER_BUFFER_KP_SHIFT 8
+#endif
+#ifndef BTSTACK_AUDIO_JITTER_BUFFER_KI_SHIFT
+#define BTSTACK_AUDIO_JITTER_BUFFER_KI_SHIFT 15
+#endif
+
+// low-pass filter for buffer level, time constant 2^FILTER_SHIFT writes
+#ifndef BTSTACK_AUDIO_JITTER_BUFFER_FILTER_SHIFT
+#define BTSTACK_AUDIO_JITTER_BUFFER_FILTER_SHIFT 4
+#endif
+
+// input frames resampled per step
+#define BTSTACK_AUDIO_JITTER_BUFFER_CHUNK_FRAMES 64
+// resampling at max offset creates at most two additional frames per chunk
+#define BTSTACK_AUDIO_JITTER_BUFFER_SCRATCH_FRAMES (BTSTACK_AUDIO_JITTER_BUFFER_CHUNK_FRAMES + 4)
+
+// positions are shared between producer and consumer
+#if defined(__GNUC__) || defined(__clang__)
+#define JITTER_BUFFER_LOAD_ACQUIRE(ptr)         __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define JITTER_BUFFER_STORE_RELEASE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#else
+#define JITTER_BUFFER_LOAD_ACQUIRE(ptr)         (*(ptr))
+#define JITTER_BUFFER_STORE_RELEASE(ptr, value) (*(ptr) = (value))
+#endif
+
+static int32_t btstack_audio_jitter_buffer_clamp(int32_t value, int32_t limit){
+    if (value > limit)  return limit;
+    if (value < -limit) return -limit;
+    return value;
+}
+
+static uint32_t btstack_audio_jitter_buffer_level(const btstack_audio_jitter_buffer_t * jitter_buffer, uint32_t write_pos, uint32_t read_pos){
+    if (write_pos >= read_pos){
+        return write_pos - read_pos;
+    }
+    return write_pos + (2u * jitter_buffer->storage_frames) - read_pos;
+}
+
+static uint32_t btstack_audio_jitter_buffer_advance(const btstack_audio_jitter_buffer_t * jitter_buffer, uint32_t pos, uint32_t num_frames){
+    pos += num_frames;
+    if (pos >= (2u * jitter_buffer->storage_frames)){
+        pos -= 2u * jitter_buffer->storage_frames;
+    }
+    return pos;
+}
+
+static uint32_t btstack_audio_jitter_buffer_index(const btstack_audio_jitter_buffer_t * jitter_buffer, uint32_t pos){
+    if (pos >= jitter_buffer->storage_frames){
+        pos -= jitter_buffer->storage_frames;
+    }
+    return pos;
+}
+
+void btstack_audio_jitter_buffer_init(btstack_audio_jitter_buffer_t * jitter_buffer, int16_t * storage, uint32_t storage_frames,
+                                      uint8_t num_channels, uint32_t sample_rate, uint16_t target_latency_ms){
+    btstack_assert(num_channels <= BTSTACK_RESAMPLE_MAX_CHANNELS);
+    jitter_buffer->storage        = storage;
+    jitter_buffer->storage_frames = storage_frames;
+    jitter_buffer->num_channels   = num_channels;
+    jitter_buffer->sample_rate    = sample_rate;
+    jitter_buffer->target_frames  = btstack_min(storage_frames, (sample_rate * target_latency_ms) / 1000u);
+    btstack_audio_jitter_buffer_reset(jitter_buffer);
+}
+
+void btstack_audio_jitter_buffer_reset(btstack_audio_jitter_buffer_t * jitter_buffer){
+    jitter_buffer->write_pos = 0;
+    jitter_buffer->read_pos  = 0;
+    jitter_buffer->playing   = false;
+
+    btstack_resample_init(&jitter_buffer->resample, jitter_buffer->num_channels);
+    jitter_buffer->level_filtered     = -1;
+    jitter_buffer->integral           = 0;
+    jitter_buffer->resampling_offset  = 0;
+
+    jitter_buffer->frames_written     = 0;
+    jitter_buffer->overruns           = 0;
+    jitter_buffer->dropped_frames     = 0;
+    jitter_buffer->latency_frames     = 0;
+    jitter_buffer->latency_frames_min = UINT32_MAX;
+    jitter_buffer->latency_frames_max = 0;
+    jitter_buffer->frames_read        = 0;
+    jitter_buffer->underruns          = 0;
+}
+
+// returns number of frames dropped
+static uint32_t btstack_audio_jitter_buffer_store(btstack_audio_jitter_buffer_t * jitter_buffer, const int16_t * frames, uint32_t num_frames){
+    uint32_t read_pos  = JITTER_BUFFER_LOAD_ACQUIRE(&jitter_buffer->read_pos);
+    uint32_t write_pos = jitter_buffer->write_pos;
+    uint32_t frames_free = jitter_buffer->storage_frames - btstack_audio_jitter_buffer_level(jitter_buffer, write_pos, read_pos);
+    uint32_t frames_to_store = btstack_min(num_frames, frames_free);
+
+    // copy in up to two parts
+    uint32_t index = btstack_audio_jitter_buffer_index(jitter_buffer, write_pos);
+    uint32_t frames_till_end = btstack_min(frames_to_store, jitter_buffer->storage_frames - index);
+    memcpy(&jitter_buffer->storage[index * jitter_buffer->num_channels], frames, frames_till_end * jitter_buffer->num_channels * sizeof(int16_t));
+    memcpy(jitter_buffer->storage, &frames[frames_till_end * jitter_buffer->num_channels], (frames_to_store - frames_till_end) * jitter_buffer->num_channels * sizeof(int16_t));
+
+    JITTER_BUFFER_STORE_RELEASE(&jitter_buffer->write_pos, btstack_audio_jitter_buffer_advance(jitter_buffer, write_pos, frames_to_store));
+    jitter_buffer->frames_written += frames_to_store;
+    return num_frames - frames_to_store;
+}
+
+static void btstack_audio_jitter_buffer_update_resampling(btstack_audio_jitter_buffer_t * jitter_buffer, uint32_t num_frames){
+    uint32_t level = btstack_audio_jitter_buffer_frames_available(jitter_buffer);
+    jitter_buffer->latency_frames = level;
+
+    if (jitter_buffer->playing == false){
+        // prebuffering or underrun: keep integral, restart filter on next playback start
+        jitter_buffer->level_filtered = -1;
+        return;
+    }
+
+    // latency statistics while playing
+    if (level < jitter_buffer->latency_frames_min){
+        jitter_buffer->latency_frames_min = level;
+    }
+    if (level > jitter_buffer->latency_frames_max){
+        jitter_buffer->latency_frames_max = level;
+    }
+
+    // low-pass filtered level in Q8
+    int32_t level_q8 = (int32_t) (level << 8);
+    if (jitter_buffer->level_filtered < 0){
+        jitter_buffer->level_filtered = level_q8;
+    } else {
+        jitter_buffer->level_filtered += (level_q8 - jitter_buffer->level_filtered) >> BTSTACK_AUDIO_JITTER_BUFFER_FILTER_SHIFT;
+    }
+    int32_t error_q8 = jitter_buffer->level_filtered - (int32_t) (jitter_buffer->target_frames << 8);
+
+    // integrate error over time with anti-windup
+    const int32_t max_offset   = BTSTACK_AUDIO_JITTER_BUFFER_MAX_RESAMPLING_OFFSET;
+    const int32_t max_integral = max_offset << BTSTACK_AUDIO_JITTER_BUFFER_KI_SHIFT;
+    int32_t integral = jitter_buffer->integral + ((error_q8 >> 8) * (int32_t) num_frames);
+    integral = btstack_audio_jitter_buffer_clamp(integral, max_integral);
+    jitter_buffer->integral = integral;
+
+    // positive offset consumes more input frames per output frame and reduces the level
+    int32_t offset = (error_q8 >> BTSTACK_AUDIO_JITTER_BUFFER_KP_SHIFT) + (integral >> BTSTACK_AUDIO_JITTER_BUFFER_KI_SHIFT);
+    offset = btstack_audio_jitter_buffer_clamp(offset, max_offset);
+    jitter_buffer->resampling_offset = offset;
+    btstack_resample_set_factor(&jitter_buffer->resample, (uint32_t) (0x10000 + offset));
+}
+
+void btstack_audio_jitter_buffer_write(btstack_audio_jitter_buffer_t * jitter_buffer, const int16_t * pcm, uint32_t num_frames){
+    int16_t scratch[BTSTACK_AUDIO_JITTER_BUFFER_SCRATCH_FRAMES * BTSTACK_RESAMPLE_MAX_CHANNELS];
+    uint32_t frames_dropped = 0;
+    uint32_t frames_consumed = num_frames;
+
+    while (num_frames > 0u){
+        uint32_t chunk_frames = btstack_min(num_frames, BTSTACK_AUDIO_JITTER_BUFFER_CHUNK_FRAMES);
+        uint16_t resampled_frames = btstack_resample_block(&jitter_buffer->resample, pcm, chunk_frames, scratch);
+        frames_dropped += btstack_audio_jitter_buffer_store(jitter_buffer, scratch, resampled_frames);
+        pcm        += chunk_frames * jitter_buffer->num_channels;
+        num_frames -= chunk_frames;
+    }
+
+    if (frames_dropped > 0u){
+        jitter_buffer->overruns++;
+        jitter_buffer->dropped_frames += frames_dropped;
+    }
+
+    btstack_audio_jitter_buffer_update_resampling(jitter_buffer, frames_consumed);
+}
+
+void btstack_audio_jitter_buffer_read(btstack_audio_jitter_buffer_t * jitter_buffer, int16_t * buffer, uint32_t num_frames){
+    uint32_t write_pos = JITTER_BUFFER_LOAD_ACQUIRE(&jitter_buffer->write_pos);
+    uint32_t read_pos  = jitter_buffer->read_pos;
+    uint32_t level     = btstack_audio_jitter_buffer_level(jitter_buffer, write_pos, read_pos);
+
+    jitter_buffer->frames_read += num_frames;
+
+    // start playback when target latency is reached
+    if (jitter_buffer->playing == false){
+        if (level < jitter_buffer->target_frames){
+            memset(buffer, 0, num_frames * jitter_buffer->num_channels * sizeof(int16_t));
+            return;
+        }
+        jitter_buffer->playing = true;
+    }
+
+    // copy in up to two parts
+    uint32_t frames_to_read  = btstack_min(num_frames, level);
+    uint32_t index           = btstack_audio_jitter_buffer_index(jitter_buffer, read_pos);
+    uint32_t frames_till_end = btstack_min(frames_to_read, jitter_buffer->storage_frames - index);
+    memcpy(buffer, &jitter_buffer->storage[index * jitter_buffer->num_channels], frames_till_end * jitter_buffer->num_channels * sizeof(int16_t));
+    memcpy(&buffer[frames_till_end * jitter_buffer->num_channels], jitter_buffer->storage, (frames_to_read - frames_till_end) * jitter_buffer->num_channels * sizeof(int16_t));
+    JITTER_BUFFER_STORE_RELEASE(&jitter_buffer->read_pos, btstack_audio_jitter_buffer_advance(jitter_buffer, read_pos, frames_to_read));
+
+    // fill with silence and prebuffer again on underrun
+    if (frames_to_read < num_frames){
+        memset(&buffer[frames_to_read * jitter_buffer->num_channels], 0, (num_frames - frames_to_read) * jitter_buffer->num_channels * sizeof(int16_t));
+        jitter_buffer->underruns++;
+        jitter_buffer->playing = false;
+    }
+}
+
+uint32_t btstack_audio_jitter_buffer_frames_available(btstack_audio_jitter_buffer_t * jitter_buffer){
+    uint32_t write_pos = JITTER_BUFFER_LOAD_ACQUIRE(&jitter_buffer->write_pos);
+    uint32_t read_pos  = JITTER_BUFFER_LOAD_ACQUIRE(&jitter_buffer->read_pos);
+    return btstack_audio_jitter_buffer_level(jitter_buffer, write_pos, read_pos);
+}
+
+void btstack_audio_jitter_buffer_get_statistics(btstack_audio_jitter_buffer_t * jitter_buffer, btstack_audio_jitter_buffer_statistics_t * statistics){
+    statistics->frames_written     = jitter_buffer->frames_written;
+    statistics->frames_read        = jitter_buffer->frames_read;
+    statistics->underruns          = jitter_buffer->underruns;
+    statistics->overruns           = jitter_buffer->overruns;
+    statistics->dropped_frames     = jitter_buffer->dropped_frames;
+    statistics->latency_frames     = jitter_buffer->latency_frames;
+    // min not valid before playback started
+    statistics->latency_frames_min = btstack_min(jitter_buffer->latency_frames_min, jitter_buffer->latency_frames_max);
+    statistics->latency_frames_max = jitter_buffer->latency_frames_max;
+    statistics->resampling_offset  = jitter_buffer->resampling_offset;
+}
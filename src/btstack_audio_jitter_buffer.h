@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title Audio Jitter Buffer
+ *
+ * Buffer between audio received over Bluetooth and the audio playback callback.
+ *
+ * Playback starts when the target latency has been buffered. Clock drift between
+ * remote device and local audio output is compensated by adapting the btstack_resample
+ * factor with a PI controller that keeps the buffer level close to the target latency.
+ *
+ * The buffer is a single-producer, single-consumer queue: btstack_audio_jitter_buffer_write
+ * is called from the main thread and btstack_audio_jitter_buffer_read from the audio callback,
+ * which may run on a different thread. No locks are used.
+ *
+ */
+
+#ifndef BTSTACK_AUDIO_JITTER_BUFFER_H
+#define BTSTACK_AUDIO_JITTER_BUFFER_H
+
+#include <stdint.h>
+
+#include "btstack_bool.h"
+#include "btstack_resample.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    // frames accepted from producer after resampling
+    uint32_t frames_written;
+    // frames provided to consumer, including silence
+    uint32_t frames_read;
+    // number of reads that could not be served from buffer
+    uint32_t underruns;
+    // number of writes that did not fit into buffer
+    uint32_t overruns;
+    // frames dropped because of overruns
+    uint32_t dropped_frames;
+    // buffer level after last write
+    uint32_t latency_frames;
+    uint32_t latency_frames_min;
+    uint32_t latency_frames_max;
+    // current resampling factor offset, positive values reduce buffer level
+    int32_t  resampling_offset;
+} btstack_audio_jitter_buffer_statistics_t;
+
+typedef struct {
+    // storage
+    int16_t * storage;
+    uint32_t  storage_frames;
+    uint8_t   num_channels;
+    uint32_t  sample_rate;
+    uint32_t  target_frames;
+
+    // positions in range [0, 2 * storage_frames), written by producer / consumer only
+    volatile uint32_t write_pos;
+    volatile uint32_t read_pos;
+
+    // set and cleared by consumer
+    volatile bool playing;
+
+    // drift compensation, producer only
+    btstack_resample_t resample;
+    int32_t  level_filtered;
+    int32_t  integral;
+    int32_t  resampling_offset;
+
+    // statistics, written by producer
+    uint32_t frames_written;
+    uint32_t overruns;
+    uint32_t dropped_frames;
+    uint32_t latency_frames;
+    uint32_t latency_frames_min;
+    uint32_t latency_frames_max;
+
+    // statistics, written by consumer
+    volatile uint32_t frames_read;
+    volatile uint32_t underruns;
+} btstack_audio_jitter_buffer_t;
+
+/* API_START */
+
+/**
+ * @brief Init jitter buffer
+ * @param jitter_buffer
+ * @param storage for storage_frames * num_channels samples
+ * @param storage_frames should be at least twice the target latency
+ * @param num_channels up to BTSTACK_RESAMPLE_MAX_CHANNELS, larger values trigger an assert
+ * @param sample_rate
+ * @param target_latency_ms
+ */
+void btstack_audio_jitter_buffer_init(btstack_audio_jitter_buffer_t * jitter_buffer, int16_t * storage, uint32_t storage_frames,
+                                      uint8_t num_channels, uint32_t sample_rate, uint16_t target_latency_ms);
+
+/**
+ * @brief Reset jitter buffer to initial state (empty, not playing) and clear statistics
+ * @note must not be called while the audio callback is active
+ * @param jitter_buffer
+ */
+void btstack_audio_jitter_buffer_reset(btstack_audio_jitter_buffer_t * jitter_buffer);
+
+/**
+ * @brief Add received audio. Frames that do not fit are dropped and counted as overrun
+ * @note producer, call from main thread
+ * @param jitter_buffer
+ * @param pcm interleaved samples
+ * @param num_frames
+ */
+void btstack_audio_jitter_buffer_write(btstack_audio_jitter_buffer_t * jitter_buffer, const int16_t * pcm, uint32_t num_frames);
+
+/**
+ * @brief Get audio for playback. Buffer is filled with silence during prebuffering and on underrun
+ * @note consumer, call from audio callback
+ * @param jitter_buffer
+ * @param buffer for num_frames interleaved frames
+ * @param num_frames
+ */
+void btstack_audio_jitter_buffer_read(btstack_audio_jitter_buffer_t * jitter_buffer, int16_t * buffer, uint32_t num_frames);
+
+/**
+ * @brief Get number of buffered frames
+ * @param jitter_buffer
+ * @return num frames
+ */
+uint32_t btstack_audio_jitter_buffer_frames_available(btstack_audio_jitter_buffer_t * jitter_buffer);
+
+/**
+ * @brief Get statistics
+ * @param jitter_buffer
+ * @param statistics
+ */
+void btstack_audio_jitter_buffer_get_statistics(btstack_audio_jitter_buffer_t * jitter_buffer, btstack_audio_jitter_buffer_statistics_t * statistics);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // BTSTACK_AUDIO_JITTER_BUFFER_H
@@ -43,6 +43,7 @@
 #include "btstack_debug.h"
 #include "btstack_event.h"
 #include "btstack_linked_list.h"
+#include "btstack_run_loop.h"
 #include "btstack_util.h"
 #include "btstack_bool.h"
 #include "hci.h"
@@ -61,6 +62,9 @@
 #ifdef ENABLE_SOFTWARE_AES128
 #define HAVE_AES128
 #include "rijndael.h"
+#ifdef __AES__
+#include <wmmintrin.h>
+#endif
 #endif
 
 #ifdef HAVE_AES128
@@ -103,6 +107,10 @@
 #define ENABLE_ECC_P256
 #endif
 
+#if defined(ENABLE_ECC_P256_KEY_POOL) && !defined(USE_SOFTWARE_ECC_P256_IMPLEMENTATION)
+#error "ENABLE_ECC_P256_KEY_POOL requires software ECC implementation, please enable ENABLE_MICRO_ECC_P256 or HAVE_MBEDTLS_ECC_P256"
+#endif
+
 // debugging
 // #define DEBUG_CCM
 
@@ -134,6 +142,28 @@ static bool btstack_crypto_wait_for_hci_result;
 static btstack_linked_list_t btstack_crypto_operations;
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 
+#ifdef ENABLE_CRYPTO_BATCH
+#ifndef BTSTACK_CRYPTO_BATCH_SIZE
+#define BTSTACK_CRYPTO_BATCH_SIZE 8
+#endif
+#ifdef USE_BTSTACK_AES128
+// AES128, CMAC and CCM requests are processed from the run loop, up to BTSTACK_CRYPTO_BATCH_SIZE per iteration
+static btstack_timer_source_t btstack_crypto_batch_timer;
+static bool     btstack_crypto_batch_timer_active;
+static uint16_t btstack_crypto_batch_budget;
+static bool     btstack_crypto_batch_delivering;
+static uint8_t  btstack_crypto_batch_ciphertext[BTSTACK_CRYPTO_BATCH_SIZE * 16];
+#ifdef ENABLE_SOFTWARE_AES128
+static uint8_t  btstack_crypto_batch_plaintext[BTSTACK_CRYPTO_BATCH_SIZE * 16];
+static btstack_aes128_key_schedule_t         btstack_crypto_batch_key_schedules[BTSTACK_CRYPTO_BATCH_SIZE];
+static const btstack_aes128_key_schedule_t * btstack_crypto_batch_key_schedule_pointers[BTSTACK_CRYPTO_BATCH_SIZE];
+#endif
+#else
+// number of AES128 requests at the head of the queue with HCI LE Encrypt sent to Controller
+static uint8_t btstack_crypto_aes128_in_flight;
+#endif
+#endif
+
 // state for AES-CMAC
 #ifndef USE_BTSTACK_AES128
 static btstack_crypto_cmac_state_t btstack_crypto_cmac_state;
@@ -152,11 +182,38 @@ static uint8_t btstack_crypto_ccm_s[16];
 static uint8_t  btstack_crypto_ecc_p256_public_key[64];
 static uint8_t  btstack_crypto_ecc_p256_random[64];
 static uint8_t  btstack_crypto_ecc_p256_random_len;
-static uint8_t  btstack_crypto_ecc_p256_random_offset;
 static btstack_crypto_ecc_p256_key_generation_state_t btstack_crypto_ecc_p256_key_generation_state;
 
 #ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
 static uint8_t btstack_crypto_ecc_p256_d[32];
+
+// random data and offset for RNG during key generation
+static const uint8_t * btstack_crypto_ecc_p256_rng_data;
+static uint8_t  btstack_crypto_ecc_p256_random_offset;
+
+// optional executor for key generation and DH Key calculation
+static const btstack_crypto_ecc_p256_executor_t * btstack_crypto_ecc_p256_executor;
+static bool btstack_crypto_ecc_p256_executor_active;
+// work started before state reset is still running on executor, its result is ignored
+static bool btstack_crypto_ecc_p256_executor_stale;
+static btstack_context_callback_registration_t btstack_crypto_ecc_p256_executor_work;
+static btstack_context_callback_registration_t btstack_crypto_ecc_p256_executor_done;
+#endif
+
+#ifdef ENABLE_ECC_P256_KEY_POOL
+#ifndef BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE
+#define BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE 2
+#endif
+// key pairs are pre-generated while idle
+static uint8_t  btstack_crypto_ecc_p256_key_pool_public_key[BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE][64];
+static uint8_t  btstack_crypto_ecc_p256_key_pool_d[BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE][32];
+static uint16_t btstack_crypto_ecc_p256_key_pool_num_keys;
+static bool     btstack_crypto_ecc_p256_key_pool_refill_active;
+static bool     btstack_crypto_ecc_p256_key_pool_random_ready;
+// pool is only filled after first key generation request
+static bool     btstack_crypto_ecc_p256_key_pool_enabled;
+static uint8_t  btstack_crypto_ecc_p256_key_pool_random[64];
+static btstack_crypto_random_t btstack_crypto_ecc_p256_key_pool_random_request;
 #endif
 
 // Software ECDH implementation provided by mbedtls
@@ -167,16 +224,196 @@ static mbedtls_ecp_group   mbedtls_ec_group;
 #endif /* ENABLE_ECC_P256 */
 
 #ifdef ENABLE_SOFTWARE_AES128
+
 // AES128 using public domain rijndael implementation
+static void btstack_crypto_aes128_rijndael_set_key(btstack_aes128_key_schedule_t * key_schedule, const uint8_t * key){
+    (void) rijndaelSetupEncrypt(key_schedule->round_keys, key, KEYBITS);
+}
+
+static void btstack_crypto_aes128_rijndael_encrypt(const btstack_aes128_key_schedule_t * key_schedule, const uint8_t * plaintext, uint8_t * ciphertext){
+    rijndaelEncrypt(key_schedule->round_keys, NROUNDS(KEYBITS), plaintext, ciphertext);
+}
+
+static const btstack_aes128_engine_t btstack_crypto_aes128_rijndael = {
+    &btstack_crypto_aes128_rijndael_set_key,
+    &btstack_crypto_aes128_rijndael_encrypt,
+    NULL,
+};
+
+const btstack_aes128_engine_t * btstack_crypto_aes128_rijndael_get_instance(void){
+    return &btstack_crypto_aes128_rijndael;
+}
+
+#ifdef __AES__
+// AES128 using x86 AES-NI instructions, round keys are stored as 11 x 128 bit
+static __m128i btstack_crypto_aes128_aesni_expand(__m128i key, __m128i keygened){
+    keygened = _mm_shuffle_epi32(keygened, _MM_SHUFFLE(3,3,3,3));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, keygened);
+}
+
+#define AESNI_EXPAND(index, rcon) \
+    rk[index] = btstack_crypto_aes128_aesni_expand(rk[(index)-1], _mm_aeskeygenassist_si128(rk[(index)-1], rcon))
+
+static void btstack_crypto_aes128_aesni_set_key(btstack_aes128_key_schedule_t * key_schedule, const uint8_t * key){
+    __m128i rk[11];
+    rk[0] = _mm_loadu_si128((const __m128i *) key);
+    AESNI_EXPAND(1, 0x01);
+    AESNI_EXPAND(2, 0x02);
+    AESNI_EXPAND(3, 0x04);
+    AESNI_EXPAND(4, 0x08);
+    AESNI_EXPAND(5, 0x10);
+    AESNI_EXPAND(6, 0x20);
+    AESNI_EXPAND(7, 0x40);
+    AESNI_EXPAND(8, 0x80);
+    AESNI_EXPAND(9, 0x1b);
+    AESNI_EXPAND(10, 0x36);
+    int i;
+    for (i = 0; i < 11; i++){
+        _mm_storeu_si128((__m128i *) &key_schedule->round_keys[i * 4], rk[i]);
+    }
+}
+
+static void btstack_crypto_aes128_aesni_encrypt(const btstack_aes128_key_schedule_t * key_schedule, const uint8_t * plaintext, uint8_t * ciphertext){
+    const __m128i * rk = (const __m128i *) key_schedule->round_keys;
+    __m128i block = _mm_loadu_si128((const __m128i *) plaintext);
+    block = _mm_xor_si128(block, _mm_loadu_si128(&rk[0]));
+    int i;
+    for (i = 1; i < 10; i++){
+        block = _mm_aesenc_si128(block, _mm_loadu_si128(&rk[i]));
+    }
+    block = _mm_aesenclast_si128(block, _mm_loadu_si128(&rk[10]));
+    _mm_storeu_si128((__m128i *) ciphertext, block);
+}
+
+// encrypt four blocks in parallel to hide latency of aesenc
+static void btstack_crypto_aes128_aesni_encrypt_blocks(const btstack_aes128_key_schedule_t * const * key_schedules, const uint8_t * plaintext, uint8_t * ciphertext, uint16_t num_blocks){
+    while (num_blocks >= 4u){
+        const __m128i * rk0 = (const __m128i *) key_schedules[0]->round_keys;
+        const __m128i * rk1 = (const __m128i *) key_schedules[1]->round_keys;
+        const __m128i * rk2 = (const __m128i *) key_schedules[2]->round_keys;
+        const __m128i * rk3 = (const __m128i *) key_schedules[3]->round_keys;
+        __m128i b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &plaintext[ 0]), _mm_loadu_si128(&rk0[0]));
+        __m128i b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &plaintext[16]), _mm_loadu_si128(&rk1[0]));
+        __m128i b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &plaintext[32]), _mm_loadu_si128(&rk2[0]));
+        __m128i b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &plaintext[48]), _mm_loadu_si128(&rk3[0]));
+        int i;
+        for (i = 1; i < 10; i++){
+            b0 = _mm_aesenc_si128(b0, _mm_loadu_si128(&rk0[i]));
+            b1 = _mm_aesenc_si128(b1, _mm_loadu_si128(&rk1[i]));
+            b2 = _mm_aesenc_si128(b2, _mm_loadu_si128(&rk2[i]));
+            b3 = _mm_aesenc_si128(b3, _mm_loadu_si128(&rk3[i]));
+        }
+        _mm_storeu_si128((__m128i *) &ciphertext[ 0], _mm_aesenclast_si128(b0, _mm_loadu_si128(&rk0[10])));
+        _mm_storeu_si128((__m128i *) &ciphertext[16], _mm_aesenclast_si128(b1, _mm_loadu_si128(&rk1[10])));
+        _mm_storeu_si128((__m128i *) &ciphertext[32], _mm_aesenclast_si128(b2, _mm_loadu_si128(&rk2[10])));
+        _mm_storeu_si128((__m128i *) &ciphertext[48], _mm_aesenclast_si128(b3, _mm_loadu_si128(&rk3[10])));
+        key_schedules += 4;
+        plaintext  += 64;
+        ciphertext += 64;
+        num_blocks -= 4u;
+    }
+    while (num_blocks > 0u){
+        btstack_crypto_aes128_aesni_encrypt(key_schedules[0], plaintext, ciphertext);
+        key_schedules++;
+        plaintext  += 16;
+        ciphertext += 16;
+        num_blocks--;
+    }
+}
+
+static const btstack_aes128_engine_t btstack_crypto_aes128_aesni = {
+    &btstack_crypto_aes128_aesni_set_key,
+    &btstack_crypto_aes128_aesni_encrypt,
+    &btstack_crypto_aes128_aesni_encrypt_blocks,
+};
+
+const btstack_aes128_engine_t * btstack_crypto_aes128_aesni_get_instance(void){
+    return &btstack_crypto_aes128_aesni;
+}
+#define BTSTACK_CRYPTO_AES128_DEFAULT_ENGINE btstack_crypto_aes128_aesni
+#else
+#define BTSTACK_CRYPTO_AES128_DEFAULT_ENGINE btstack_crypto_aes128_rijndael
+#endif
+
+static const btstack_aes128_engine_t * btstack_crypto_aes128_engine = &BTSTACK_CRYPTO_AES128_DEFAULT_ENGINE;
+
+// key schedule of last key used by current AES128, CMAC, or CCM operation, cleared when operation is done
+static btstack_aes128_key_schedule_t btstack_crypto_aes128_key_schedule;
+static bool btstack_crypto_aes128_key_schedule_valid;
+
+// overwrite key material, volatile access prevents compiler from removing it
+static void btstack_crypto_aes128_wipe(void * data, uint16_t size){
+    volatile uint8_t * buffer = (volatile uint8_t *) data;
+    while (size > 0u){
+        *buffer++ = 0;
+        size--;
+    }
+}
+
+static void btstack_crypto_aes128_clear_key_schedule(void){
+    btstack_crypto_aes128_wipe(&btstack_crypto_aes128_key_schedule, sizeof(btstack_aes128_key_schedule_t));
+    btstack_crypto_aes128_key_schedule_valid = false;
+}
+
+void btstack_crypto_set_aes128_engine(const btstack_aes128_engine_t * engine){
+    btstack_crypto_aes128_engine = engine;
+    btstack_crypto_aes128_clear_key_schedule();
+}
+
+void btstack_aes128_set_key(btstack_aes128_key_schedule_t * key_schedule, const uint8_t * key){
+    (void)memcpy(key_schedule->key, key, 16);
+    (*btstack_crypto_aes128_engine->set_key)(key_schedule, key);
+}
+
+void btstack_aes128_encrypt(const btstack_aes128_key_schedule_t * key_schedule, const uint8_t * plaintext, uint8_t * ciphertext){
+    (*btstack_crypto_aes128_engine->encrypt)(key_schedule, plaintext, ciphertext);
+}
+
+void btstack_aes128_encrypt_blocks(const btstack_aes128_key_schedule_t * const * key_schedules, const uint8_t * plaintext, uint8_t * ciphertext, uint16_t num_blocks){
+    if (btstack_crypto_aes128_engine->encrypt_blocks != NULL){
+        (*btstack_crypto_aes128_engine->encrypt_blocks)(key_schedules, plaintext, ciphertext, num_blocks);
+        return;
+    }
+    uint16_t i;
+    for (i = 0; i < num_blocks; i++){
+        (*btstack_crypto_aes128_engine->encrypt)(key_schedules[i], &plaintext[i * 16u], &ciphertext[i * 16u]);
+    }
+}
+
 void btstack_aes128_calc(const uint8_t * key, const uint8_t * plaintext, uint8_t * ciphertext){
-    uint32_t rk[RKLENGTH(KEYBITS)];
-    int nrounds = rijndaelSetupEncrypt(rk, &key[0], KEYBITS);
-    rijndaelEncrypt(rk, nrounds, plaintext, ciphertext);
+    btstack_aes128_key_schedule_t key_schedule;
+    btstack_aes128_set_key(&key_schedule, key);
+    btstack_aes128_encrypt(&key_schedule, plaintext, ciphertext);
+    btstack_crypto_aes128_wipe(&key_schedule, sizeof(btstack_aes128_key_schedule_t));
+}
+
+// expand key only once for all blocks of an operation
+static void btstack_crypto_aes128_calc(const uint8_t * key, const uint8_t * plaintext, uint8_t * ciphertext){
+    if (!btstack_crypto_aes128_key_schedule_valid || (memcmp(btstack_crypto_aes128_key_schedule.key, key, 16) != 0)){
+        btstack_aes128_set_key(&btstack_crypto_aes128_key_schedule, key);
+        btstack_crypto_aes128_key_schedule_valid = true;
+    }
+    btstack_aes128_encrypt(&btstack_crypto_aes128_key_schedule, plaintext, ciphertext);
+}
+#elif defined(HAVE_AES128)
+static void btstack_crypto_aes128_calc(const uint8_t * key, const uint8_t * plaintext, uint8_t * ciphertext){
+    btstack_aes128_calc(key, plaintext, ciphertext);
 }
 #endif
 
 static void btstack_crypto_done(btstack_crypto_t * btstack_crypto){
     btstack_linked_list_pop(&btstack_crypto_operations);
+#ifdef ENABLE_SOFTWARE_AES128
+    btstack_crypto_aes128_clear_key_schedule();
+#endif
+#if defined(ENABLE_CRYPTO_BATCH) && defined(USE_BTSTACK_AES128)
+    if (btstack_crypto_batch_budget > 0u){
+        btstack_crypto_batch_budget--;
+    }
+#endif
     (*btstack_crypto->context_callback.callback)(btstack_crypto->context_callback.context);
 }
 
@@ -217,7 +454,7 @@ static void btstack_crypto_cmac_calc(btstack_crypto_aes128_cmac_t * btstack_cryp
     sm_key_t k0, k1, k2;
     uint16_t i;
 
-    btstack_aes128_calc(btstack_crypto_cmac->key, zero, k0);
+    btstack_crypto_aes128_calc(btstack_crypto_cmac->key, zero, k0);
     btstack_crypto_cmac_calc_subkeys(k0, k1, k2);
 
     uint16_t cmac_block_count = (btstack_crypto_cmac->size + 15) / 16;
@@ -238,7 +475,7 @@ static void btstack_crypto_cmac_calc(btstack_crypto_aes128_cmac_t * btstack_cryp
         for (i=0;i<16;i++){
             cmac_y[i] = cmac_x[i] ^ btstack_crypto_cmac_get_byte(btstack_crypto_cmac, (block*16) + i);
         }
-        btstack_aes128_calc(btstack_crypto_cmac->key, cmac_y, cmac_x);
+        btstack_crypto_aes128_calc(btstack_crypto_cmac->key, cmac_y, cmac_x);
     }
 
     // step 4: set m_last
@@ -268,7 +505,7 @@ static void btstack_crypto_cmac_calc(btstack_crypto_aes128_cmac_t * btstack_cryp
     }
 
     // Step 7
-    btstack_aes128_calc(btstack_crypto_cmac->key, cmac_y, btstack_crypto_cmac->hash);
+    btstack_crypto_aes128_calc(btstack_crypto_cmac->key, cmac_y, btstack_crypto_cmac->hash);
 }
 #else
 
@@ -494,13 +731,12 @@ static void btstack_crypto_log_ec_publickey(const uint8_t * ec_q){
 #if (defined(USE_MICRO_ECC_P256) && !defined(WICED_VERSION)) || defined(USE_MBEDTLS_ECC_P256)
 // @return OK
 static int sm_generate_f_rng(unsigned char * buffer, unsigned size){
-    if (btstack_crypto_ecc_p256_key_generation_state != ECC_P256_KEY_GENERATION_ACTIVE) return 0;
-    log_info("sm_generate_f_rng: size %u - offset %u", (int) size, btstack_crypto_ecc_p256_random_offset);
-    btstack_assert((btstack_crypto_ecc_p256_random_offset + size) <= btstack_crypto_ecc_p256_random_len);
+    if (btstack_crypto_ecc_p256_rng_data == NULL) return 0;
+    btstack_assert((btstack_crypto_ecc_p256_random_offset + size) <= 64u);
     uint16_t remaining_size = size;
     uint8_t * buffer_ptr = buffer;
     while (remaining_size) {
-        *buffer_ptr++ = btstack_crypto_ecc_p256_random[btstack_crypto_ecc_p256_random_offset++];
+        *buffer_ptr++ = btstack_crypto_ecc_p256_rng_data[btstack_crypto_ecc_p256_random_offset++];
         remaining_size--;
     }
     return 1;
@@ -514,29 +750,35 @@ static int sm_generate_f_rng_mbedtls(void * context, unsigned char * buffer, siz
 }
 #endif /* USE_MBEDTLS_ECC_P256 */
 
-static void btstack_crypto_ecc_p256_generate_key_software(void){
+#ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
+#ifdef USE_MBEDTLS_ECC_P256
+static int btstack_crypto_ecc_p256_mbedtls_gen_keypair_result;
+#endif
+
+// generate key pair from 64 bytes of random data
+// note: might get called from executor thread, logging is done in btstack_crypto_ecc_p256_generate_key_software_log
+static void btstack_crypto_ecc_p256_generate_key_software(const uint8_t * random, uint8_t * public_key, uint8_t * private_key){
 
+    btstack_crypto_ecc_p256_rng_data = random;
     btstack_crypto_ecc_p256_random_offset = 0;
     
     // generate EC key
 #ifdef USE_MICRO_ECC_P256
 
 #ifndef WICED_VERSION
-    log_info("set uECC RNG for initial key generation with 64 random bytes");
     // micro-ecc from WICED SDK uses its wiced_crypto_get_random by default - no need to set it
     uECC_set_rng(&sm_generate_f_rng);
 #endif /* WICED_VERSION */
 
 #if uECC_SUPPORTS_secp256r1
     // standard version
-    uECC_make_key(btstack_crypto_ecc_p256_public_key, btstack_crypto_ecc_p256_d, uECC_secp256r1());
+    uECC_make_key(public_key, private_key, uECC_secp256r1());
 
     // disable RNG again, as returning no randmon data lets shared key generation fail
-    log_info("disable uECC RNG in standard version after key generation");
     uECC_set_rng(NULL);
 #else
     // static version
-    uECC_make_key(btstack_crypto_ecc_p256_public_key, btstack_crypto_ecc_p256_d);
+    uECC_make_key(public_key, private_key);
 #endif
 #endif /* USE_MICRO_ECC_P256 */
 
@@ -545,17 +787,27 @@ static void btstack_crypto_ecc_p256_generate_key_software(void){
     mbedtls_ecp_point P;
     mbedtls_mpi_init(&d);
     mbedtls_ecp_point_init(&P);
-    int res = mbedtls_ecp_gen_keypair(&mbedtls_ec_group, &d, &P, &sm_generate_f_rng_mbedtls, NULL);
-    log_info("gen keypair %x", res);
-    mbedtls_mpi_write_binary(&P.X, &btstack_crypto_ecc_p256_public_key[0],  32);
-    mbedtls_mpi_write_binary(&P.Y, &btstack_crypto_ecc_p256_public_key[32], 32);
-    mbedtls_mpi_write_binary(&d, btstack_crypto_ecc_p256_d, 32);
+    btstack_crypto_ecc_p256_mbedtls_gen_keypair_result = mbedtls_ecp_gen_keypair(&mbedtls_ec_group, &d, &P, &sm_generate_f_rng_mbedtls, NULL);
+    mbedtls_mpi_write_binary(&P.X, &public_key[0],  32);
+    mbedtls_mpi_write_binary(&P.Y, &public_key[32], 32);
+    mbedtls_mpi_write_binary(&d, private_key, 32);
     mbedtls_ecp_point_free(&P);
     mbedtls_mpi_free(&d);
 #endif  /* USE_MBEDTLS_ECC_P256 */
+
+    btstack_crypto_ecc_p256_rng_data = NULL;
 }
 
-#ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
+static void btstack_crypto_ecc_p256_generate_key_software_log(void){
+#ifdef USE_MICRO_ECC_P256
+    log_info("uECC key generation with 64 random bytes done");
+#endif
+#ifdef USE_MBEDTLS_ECC_P256
+    log_info("gen keypair %x", btstack_crypto_ecc_p256_mbedtls_gen_keypair_result);
+#endif
+}
+
+// note: might get called from executor thread, DH Key is logged in btstack_crypto_ecc_p256_calculate_dhkey_done
 static void btstack_crypto_ecc_p256_calculate_dhkey_software(btstack_crypto_ecc_p256_t * btstack_crypto_ec_p192){
     memset(btstack_crypto_ec_p192->dhkey, 0, 32);
 
@@ -587,11 +839,128 @@ static void btstack_crypto_ecc_p256_calculate_dhkey_software(btstack_crypto_ecc_
     mbedtls_mpi_free(&d);
     mbedtls_ecp_point_free(&Q);
 #endif
+}
 
-    log_info("dhkey");
-    log_info_hexdump(btstack_crypto_ec_p192->dhkey, 32);
+static bool btstack_crypto_ecc_p256_executor_busy(void){
+    return btstack_crypto_ecc_p256_executor_active || btstack_crypto_ecc_p256_executor_stale;
+}
+
+// @return true if done belongs to work started before state reset
+static bool btstack_crypto_ecc_p256_executor_done_stale(void){
+    if (btstack_crypto_ecc_p256_executor_stale == false) return false;
+    log_info("ignore ECC P-256 result from before reset");
+    btstack_crypto_ecc_p256_executor_stale = false;
+    btstack_crypto_run();
+    return true;
+}
+
+static void btstack_crypto_ecc_p256_executor_done_run(void){
+    btstack_crypto_ecc_p256_executor_active = false;
+    // trigger btstack_crypto_run if called from executor
+    if (btstack_crypto_ecc_p256_executor != NULL){
+        btstack_crypto_run();
+    }
+}
+
+static void btstack_crypto_ecc_p256_execute(void (*work)(void * context), void (*done)(void * context), void * context){
+    btstack_crypto_ecc_p256_executor_work.callback = work;
+    btstack_crypto_ecc_p256_executor_work.context  = context;
+    btstack_crypto_ecc_p256_executor_done.callback = done;
+    btstack_crypto_ecc_p256_executor_done.context  = context;
+    btstack_crypto_ecc_p256_executor_active = true;
+    if (btstack_crypto_ecc_p256_executor == NULL){
+        // execute on main thread, btstack_crypto_run continues afterwards
+        (*work)(context);
+        (*done)(context);
+    } else {
+        (*btstack_crypto_ecc_p256_executor->execute)(&btstack_crypto_ecc_p256_executor_work, &btstack_crypto_ecc_p256_executor_done);
+    }
+}
+
+static void btstack_crypto_ecc_p256_generate_key_work(void * context){
+    UNUSED(context);
+    btstack_crypto_ecc_p256_generate_key_software(btstack_crypto_ecc_p256_random, btstack_crypto_ecc_p256_public_key, btstack_crypto_ecc_p256_d);
+}
+
+static void btstack_crypto_ecc_p256_generate_key_done(void * context){
+    UNUSED(context);
+    if (btstack_crypto_ecc_p256_executor_done_stale()) return;
+    btstack_crypto_ecc_p256_generate_key_software_log();
+    btstack_crypto_ecc_p256_key_generation_state = ECC_P256_KEY_GENERATION_DONE;
+    btstack_crypto_ecc_p256_executor_done_run();
+}
+
+static void btstack_crypto_ecc_p256_calculate_dhkey_work(void * context){
+    btstack_crypto_ecc_p256_calculate_dhkey_software((btstack_crypto_ecc_p256_t *) context);
+}
+
+static void btstack_crypto_ecc_p256_calculate_dhkey_done(void * context){
+    btstack_crypto_ecc_p256_t * btstack_crypto_ec_p192 = (btstack_crypto_ecc_p256_t *) context;
+    if (btstack_crypto_ecc_p256_executor_done_stale()) return;
+    // request might have been dropped by stack shutdown
+    if (btstack_linked_list_get_first_item(&btstack_crypto_operations) == (btstack_linked_item_t *) btstack_crypto_ec_p192){
+        log_info("dhkey");
+        log_info_hexdump(btstack_crypto_ec_p192->dhkey, 32);
+        btstack_linked_list_pop(&btstack_crypto_operations);
+        (*btstack_crypto_ec_p192->btstack_crypto.context_callback.callback)(btstack_crypto_ec_p192->btstack_crypto.context_callback.context);
+    }
+    btstack_crypto_ecc_p256_executor_done_run();
+}
+
+#ifdef ENABLE_ECC_P256_KEY_POOL
+static void btstack_crypto_ecc_p256_key_pool_generate_work(void * context){
+    UNUSED(context);
+    uint16_t index = btstack_crypto_ecc_p256_key_pool_num_keys;
+    btstack_crypto_ecc_p256_generate_key_software(btstack_crypto_ecc_p256_key_pool_random,
+                                                  btstack_crypto_ecc_p256_key_pool_public_key[index],
+                                                  btstack_crypto_ecc_p256_key_pool_d[index]);
+}
+
+static void btstack_crypto_ecc_p256_key_pool_generate_done(void * context){
+    UNUSED(context);
+    if (btstack_crypto_ecc_p256_executor_done_stale()) return;
+    btstack_crypto_ecc_p256_generate_key_software_log();
+    btstack_crypto_ecc_p256_key_pool_num_keys++;
+    btstack_crypto_ecc_p256_key_pool_refill_active = false;
+    log_info("ecc key pool: %u keys", btstack_crypto_ecc_p256_key_pool_num_keys);
+    btstack_crypto_ecc_p256_executor_done_run();
+}
+
+static void btstack_crypto_ecc_p256_key_pool_handle_random(void * context){
+    UNUSED(context);
+    btstack_crypto_ecc_p256_key_pool_random_ready = true;
+}
+
+// start key pair generation for pool when random data is ready
+static void btstack_crypto_ecc_p256_key_pool_generate(void){
+    if (btstack_crypto_ecc_p256_key_pool_random_ready == false) return;
+    if (btstack_crypto_ecc_p256_executor_busy()) return;
+    btstack_crypto_ecc_p256_key_pool_random_ready = false;
+    btstack_crypto_ecc_p256_execute(&btstack_crypto_ecc_p256_key_pool_generate_work, &btstack_crypto_ecc_p256_key_pool_generate_done, NULL);
 }
-#endif
+
+// request random data for next key pair if pool is not full
+static void btstack_crypto_ecc_p256_key_pool_refill(void){
+    if (btstack_crypto_ecc_p256_key_pool_enabled == false) return;
+    if (btstack_crypto_ecc_p256_key_pool_refill_active) return;
+    if (btstack_crypto_ecc_p256_key_pool_num_keys >= BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE) return;
+    btstack_crypto_ecc_p256_key_pool_refill_active = true;
+    btstack_crypto_random_generate(&btstack_crypto_ecc_p256_key_pool_random_request, btstack_crypto_ecc_p256_key_pool_random,
+                                   sizeof(btstack_crypto_ecc_p256_key_pool_random), &btstack_crypto_ecc_p256_key_pool_handle_random, NULL);
+}
+
+// use pre-generated key pair, if available
+static bool btstack_crypto_ecc_p256_key_pool_get(void){
+    if (btstack_crypto_ecc_p256_key_pool_num_keys == 0u) return false;
+    (void)memcpy(btstack_crypto_ecc_p256_public_key, btstack_crypto_ecc_p256_key_pool_public_key[0], 64);
+    (void)memcpy(btstack_crypto_ecc_p256_d, btstack_crypto_ecc_p256_key_pool_d[0], 32);
+    btstack_crypto_ecc_p256_key_pool_num_keys--;
+    (void)memmove(btstack_crypto_ecc_p256_key_pool_public_key[0], btstack_crypto_ecc_p256_key_pool_public_key[1], btstack_crypto_ecc_p256_key_pool_num_keys * 64u);
+    (void)memmove(btstack_crypto_ecc_p256_key_pool_d[0], btstack_crypto_ecc_p256_key_pool_d[1], btstack_crypto_ecc_p256_key_pool_num_keys * 32u);
+    return true;
+}
+#endif /* ENABLE_ECC_P256_KEY_POOL */
+#endif /* USE_SOFTWARE_ECC_P256_IMPLEMENTATION */
 
 #endif
 
@@ -715,7 +1084,7 @@ static void btstack_crypto_ccm_calc_s0(btstack_crypto_ccm_t * btstack_crypto_ccm
     btstack_crypto_ccm_setup_a_i(btstack_crypto_ccm, 0);
 #ifdef USE_BTSTACK_AES128
     uint8_t data[16];
-    btstack_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm_s, data);
+    btstack_crypto_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm_s, data);
     btstack_crypto_ccm_handle_s0(btstack_crypto_ccm, data);
 #else
     btstack_crypto_aes128_start(btstack_crypto_ccm->key, btstack_crypto_ccm_s);
@@ -730,7 +1099,7 @@ static void btstack_crypto_ccm_calc_sn(btstack_crypto_ccm_t * btstack_crypto_ccm
     btstack_crypto_ccm_setup_a_i(btstack_crypto_ccm, btstack_crypto_ccm->counter);
 #ifdef USE_BTSTACK_AES128
     uint8_t data[16];
-    btstack_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm_s, data);
+    btstack_crypto_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm_s, data);
     btstack_crypto_ccm_handle_sn(btstack_crypto_ccm, data);
 #else
     btstack_crypto_aes128_start(btstack_crypto_ccm->key, btstack_crypto_ccm_s);
@@ -742,7 +1111,7 @@ static void btstack_crypto_ccm_calc_x1(btstack_crypto_ccm_t * btstack_crypto_ccm
     btstack_crypto_ccm->state = CCM_W4_X1;
     btstack_crypto_ccm_setup_b_0(btstack_crypto_ccm, btstack_crypto_ccm_buffer);
 #ifdef USE_BTSTACK_AES128
-    btstack_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm_buffer, btstack_crypto_ccm->x_i);
+    btstack_crypto_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm_buffer, btstack_crypto_ccm->x_i);
     btstack_crypto_ccm_handle_x1(btstack_crypto_ccm);
 #else
     btstack_crypto_aes128_start(btstack_crypto_ccm->key, btstack_crypto_ccm_buffer);
@@ -774,7 +1143,7 @@ static void btstack_crypto_ccm_calc_xn(btstack_crypto_ccm_t * btstack_crypto_ccm
 #endif
 
 #ifdef USE_BTSTACK_AES128
-    btstack_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm_buffer, btstack_crypto_ccm->x_i);
+    btstack_crypto_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm_buffer, btstack_crypto_ccm->x_i);
     btstack_crypto_ccm_handle_xn(btstack_crypto_ccm);
 #else
     btstack_crypto_aes128_start(btstack_crypto_ccm->key, btstack_crypto_ccm_buffer);
@@ -822,13 +1191,107 @@ static void btstack_crypto_ccm_calc_aad_xn(btstack_crypto_ccm_t * btstack_crypto
     btstack_crypto_ccm->aad_remainder_len = 0;
     btstack_crypto_ccm->state = CCM_W4_AAD_XN;
 #ifdef USE_BTSTACK_AES128
-    btstack_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm->x_i, btstack_crypto_ccm->x_i);
+    btstack_crypto_aes128_calc(btstack_crypto_ccm->key, btstack_crypto_ccm->x_i, btstack_crypto_ccm->x_i);
     btstack_crypto_ccm_handle_aad_xn(btstack_crypto_ccm);
 #else
     btstack_crypto_aes128_start(btstack_crypto_ccm->key, btstack_crypto_ccm->x_i);
 #endif
 }
 
+#ifdef ENABLE_CRYPTO_BATCH
+#ifdef USE_BTSTACK_AES128
+static bool btstack_crypto_batch_operation(const btstack_crypto_t * btstack_crypto){
+    switch (btstack_crypto->operation){
+        case BTSTACK_CRYPTO_AES128:
+        case BTSTACK_CRYPTO_CMAC_GENERATOR:
+        case BTSTACK_CRYPTO_CMAC_MESSAGE:
+        case BTSTACK_CRYPTO_CCM_DIGEST_BLOCK:
+        case BTSTACK_CRYPTO_CCM_ENCRYPT_BLOCK:
+        case BTSTACK_CRYPTO_CCM_DECRYPT_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// encrypt consecutive AES128 requests at the head of the queue together
+static void btstack_crypto_batch_aes128(void){
+    btstack_crypto_aes128_t * requests[BTSTACK_CRYPTO_BATCH_SIZE];
+    uint16_t num_blocks = 0;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &btstack_crypto_operations);
+    while ((num_blocks < btstack_crypto_batch_budget) && btstack_linked_list_iterator_has_next(&it)){
+        btstack_crypto_aes128_t * request = (btstack_crypto_aes128_t *) btstack_linked_list_iterator_next(&it);
+        if (request->btstack_crypto.operation != BTSTACK_CRYPTO_AES128) break;
+        requests[num_blocks] = request;
+#ifdef ENABLE_SOFTWARE_AES128
+        (void)memcpy(&btstack_crypto_batch_plaintext[num_blocks * 16u], request->plaintext, 16);
+        // share key schedule with previous request if same key is used
+        if ((num_blocks > 0u) && (memcmp(btstack_crypto_batch_key_schedule_pointers[num_blocks - 1u]->key, request->key, 16) == 0)){
+            btstack_crypto_batch_key_schedule_pointers[num_blocks] = btstack_crypto_batch_key_schedule_pointers[num_blocks - 1u];
+        } else {
+            btstack_aes128_set_key(&btstack_crypto_batch_key_schedules[num_blocks], request->key);
+            btstack_crypto_batch_key_schedule_pointers[num_blocks] = &btstack_crypto_batch_key_schedules[num_blocks];
+        }
+#else
+        btstack_crypto_aes128_calc(request->key, request->plaintext, &btstack_crypto_batch_ciphertext[num_blocks * 16u]);
+#endif
+        num_blocks++;
+    }
+    if (num_blocks == 0u) return;
+
+#ifdef ENABLE_SOFTWARE_AES128
+    btstack_aes128_encrypt_blocks(btstack_crypto_batch_key_schedule_pointers, btstack_crypto_batch_plaintext, btstack_crypto_batch_ciphertext, num_blocks);
+    btstack_crypto_aes128_wipe(btstack_crypto_batch_key_schedules, num_blocks * sizeof(btstack_aes128_key_schedule_t));
+#endif
+
+    // deliver results in order, requests from callbacks only get queued
+    btstack_crypto_batch_delivering = true;
+    uint16_t i;
+    for (i = 0; i < num_blocks; i++){
+        (void)memcpy(requests[i]->ciphertext, &btstack_crypto_batch_ciphertext[i * 16u], 16);
+        btstack_crypto_done(&requests[i]->btstack_crypto);
+    }
+    btstack_crypto_batch_delivering = false;
+}
+
+static void btstack_crypto_batch_timer_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    btstack_crypto_batch_timer_active = false;
+    btstack_crypto_batch_budget = BTSTACK_CRYPTO_BATCH_SIZE;
+    btstack_crypto_batch_aes128();
+    btstack_crypto_run();
+    btstack_crypto_batch_budget = 0;
+}
+
+static void btstack_crypto_batch_trigger(void){
+    if (btstack_crypto_batch_timer_active) return;
+    btstack_crypto_batch_timer_active = true;
+    btstack_run_loop_set_timer_handler(&btstack_crypto_batch_timer, &btstack_crypto_batch_timer_handler);
+    btstack_run_loop_set_timer(&btstack_crypto_batch_timer, 0);
+    btstack_run_loop_add_timer(&btstack_crypto_batch_timer);
+}
+#else
+// send LE Encrypt for next AES128 request while AES128 requests are in flight and Controller accepts more commands
+static bool btstack_crypto_aes128_send_next(void){
+    if (btstack_crypto_aes128_in_flight == 0u) return false;
+    if (btstack_crypto_aes128_in_flight >= BTSTACK_CRYPTO_BATCH_SIZE) return false;
+    if (!hci_can_send_command_packet_now()) return false;
+    btstack_linked_item_t * item = btstack_crypto_operations;
+    uint8_t i;
+    for (i = 0; (i < btstack_crypto_aes128_in_flight) && (item != NULL); i++){
+        item = item->next;
+    }
+    if (item == NULL) return false;
+    btstack_crypto_aes128_t * btstack_crypto_aes128 = (btstack_crypto_aes128_t *) item;
+    if (btstack_crypto_aes128->btstack_crypto.operation != BTSTACK_CRYPTO_AES128) return false;
+    btstack_crypto_aes128_start(btstack_crypto_aes128->key, btstack_crypto_aes128->plaintext);
+    btstack_crypto_aes128_in_flight++;
+    return true;
+}
+#endif
+#endif
+
 static void btstack_crypto_run(void){
 
     btstack_crypto_aes128_t        * btstack_crypto_aes128;
@@ -844,17 +1307,59 @@ static void btstack_crypto_run(void){
     // try to do as much as possible
     while (true){
 
+#ifdef ENABLE_ECC_P256_KEY_POOL
+        // generate key pair for pool if random data is ready
+        btstack_crypto_ecc_p256_key_pool_generate();
+#endif
+
         // anything to do?
-        if (btstack_linked_list_empty(&btstack_crypto_operations)) return;
+        if (btstack_linked_list_empty(&btstack_crypto_operations)) {
+#ifdef ENABLE_ECC_P256_KEY_POOL
+            // use idle time to refill key pool
+            btstack_crypto_ecc_p256_key_pool_refill();
+            if (btstack_linked_list_empty(&btstack_crypto_operations) == false) continue;
+#endif
+            return;
+        }
 
         // already active?
-        if (btstack_crypto_wait_for_hci_result) return;
+        if (btstack_crypto_wait_for_hci_result) {
+#if defined(ENABLE_CRYPTO_BATCH) && !defined(USE_BTSTACK_AES128)
+            if (btstack_crypto_aes128_send_next()) continue;
+#endif
+            return;
+        }
 
         // can send a command?
         if (!hci_can_send_command_packet_now()) return;
 
         // ok, find next task
     	btstack_crypto_t * btstack_crypto = (btstack_crypto_t*) btstack_linked_list_get_first_item(&btstack_crypto_operations);
+
+#ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
+        // ECC operations are executed one at a time
+        if (btstack_crypto_ecc_p256_executor_busy()){
+            switch (btstack_crypto->operation){
+                case BTSTACK_CRYPTO_ECC_P256_GENERATE_KEY:
+                case BTSTACK_CRYPTO_ECC_P256_CALCULATE_DHKEY:
+                    return;
+                default:
+                    break;
+            }
+        }
+#endif
+
+#if defined(ENABLE_CRYPTO_BATCH) && defined(USE_BTSTACK_AES128)
+        // process AES128, CMAC and CCM requests from run loop
+        if (btstack_crypto_batch_operation(btstack_crypto)){
+            if (btstack_crypto_batch_delivering) return;
+            if (btstack_crypto_batch_budget == 0u){
+                btstack_crypto_batch_trigger();
+                return;
+            }
+        }
+#endif
+
     	switch (btstack_crypto->operation){
     		case BTSTACK_CRYPTO_RANDOM:
     			btstack_crypto_wait_for_hci_result = true;
@@ -863,10 +1368,13 @@ static void btstack_crypto_run(void){
     		case BTSTACK_CRYPTO_AES128:
                 btstack_crypto_aes128 = (btstack_crypto_aes128_t *) btstack_crypto;
 #ifdef USE_BTSTACK_AES128
-                btstack_aes128_calc(btstack_crypto_aes128->key, btstack_crypto_aes128->plaintext, btstack_crypto_aes128->ciphertext);
+                btstack_crypto_aes128_calc(btstack_crypto_aes128->key, btstack_crypto_aes128->plaintext, btstack_crypto_aes128->ciphertext);
                 btstack_crypto_done(btstack_crypto);
 #else
                 btstack_crypto_aes128_start(btstack_crypto_aes128->key, btstack_crypto_aes128->plaintext);
+#ifdef ENABLE_CRYPTO_BATCH
+                btstack_crypto_aes128_in_flight = 1;
+#endif
 #endif
     		    break;
 
@@ -939,6 +1447,15 @@ static void btstack_crypto_run(void){
                         (*btstack_crypto_ec_p192->btstack_crypto.context_callback.callback)(btstack_crypto_ec_p192->btstack_crypto.context_callback.context);
                         break;
                     case ECC_P256_KEY_GENERATION_IDLE:
+#ifdef ENABLE_ECC_P256_KEY_POOL
+                        if (btstack_crypto_ecc_p256_key_pool_get()){
+                            log_info("use key pair from pool");
+                            btstack_crypto_ecc_p256_key_generation_state = ECC_P256_KEY_GENERATION_DONE;
+                            break;
+                        }
+                        // pool is being refilled, wait for next key pair
+                        if (btstack_crypto_ecc_p256_key_pool_refill_active) return;
+#endif
 #ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
                         log_info("start ecc random");
                         btstack_crypto_ecc_p256_key_generation_state = ECC_P256_KEY_GENERATION_GENERATING_RANDOM;
@@ -965,10 +1482,7 @@ static void btstack_crypto_run(void){
             case BTSTACK_CRYPTO_ECC_P256_CALCULATE_DHKEY:
                 btstack_crypto_ec_p192 = (btstack_crypto_ecc_p256_t *) btstack_crypto;
 #ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
-                btstack_crypto_ecc_p256_calculate_dhkey_software(btstack_crypto_ec_p192);
-                // done
-                btstack_linked_list_pop(&btstack_crypto_operations);
-                (*btstack_crypto_ec_p192->btstack_crypto.context_callback.callback)(btstack_crypto_ec_p192->btstack_crypto.context_callback.context);
+                btstack_crypto_ecc_p256_execute(&btstack_crypto_ecc_p256_calculate_dhkey_work, &btstack_crypto_ecc_p256_calculate_dhkey_done, btstack_crypto_ec_p192);
 #else
                 btstack_crypto_wait_for_hci_result = 1;
                 hci_send_cmd(&hci_le_generate_dhkey, &btstack_crypto_ec_p192->public_key[0], &btstack_crypto_ec_p192->public_key[32]);
@@ -1008,9 +1522,10 @@ static void btstack_crypto_handle_random_data(const uint8_t * data, uint16_t len
             (void)memcpy(&btstack_crypto_ecc_p256_random[btstack_crypto_ecc_p256_random_len], data, 8);
             btstack_crypto_ecc_p256_random_len += 8u;
             if (btstack_crypto_ecc_p256_random_len >= 64u) {
+#ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
                 btstack_crypto_ecc_p256_key_generation_state = ECC_P256_KEY_GENERATION_ACTIVE;
-                btstack_crypto_ecc_p256_generate_key_software();
-                btstack_crypto_ecc_p256_key_generation_state = ECC_P256_KEY_GENERATION_DONE;
+                btstack_crypto_ecc_p256_execute(&btstack_crypto_ecc_p256_generate_key_work, &btstack_crypto_ecc_p256_generate_key_done, NULL);
+#endif
             }
             break;
 #endif
@@ -1107,6 +1622,12 @@ static void btstack_crypto_event_handler(uint8_t packet_type, uint16_t cid, uint
                 case HCI_OPCODE_HCI_LE_ENCRYPT:
                     if (!btstack_crypto_wait_for_hci_result) return;
                     btstack_crypto_wait_for_hci_result = 0;
+#ifdef ENABLE_CRYPTO_BATCH
+                    if (btstack_crypto_aes128_in_flight > 0u){
+                        btstack_crypto_aes128_in_flight--;
+                        btstack_crypto_wait_for_hci_result = btstack_crypto_aes128_in_flight > 0u;
+                    }
+#endif
     	            btstack_crypto_handle_encryption_result(&packet[6]);
                     break;
 #endif
@@ -1242,6 +1763,10 @@ void btstack_crypto_ecc_p256_generate_key(btstack_crypto_ecc_p256_t * request, u
     request->btstack_crypto.context_callback.context   = callback_arg;
     request->btstack_crypto.operation                  = BTSTACK_CRYPTO_ECC_P256_GENERATE_KEY;
     request->public_key                                = public_key;
+#ifdef ENABLE_ECC_P256_KEY_POOL
+    // start filling the pool with first use of ECC
+    btstack_crypto_ecc_p256_key_pool_enabled = true;
+#endif
     btstack_linked_list_add_tail(&btstack_crypto_operations, (btstack_linked_item_t*) request);
     btstack_crypto_run();
 }
@@ -1352,9 +1877,33 @@ static void btstack_crypto_state_reset() {
 #endif
 #ifdef ENABLE_ECC_P256
     btstack_crypto_ecc_p256_key_generation_state = ECC_P256_KEY_GENERATION_IDLE;
+#endif
+#ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
+    // running executor work cannot be cancelled, new ECC work starts after its done was ignored
+    if (btstack_crypto_ecc_p256_executor_active){
+        btstack_crypto_ecc_p256_executor_stale = true;
+    }
+    btstack_crypto_ecc_p256_executor_active = false;
+#endif
+#ifdef ENABLE_ECC_P256_KEY_POOL
+    // pending random request is dropped, key pairs in pool stay valid
+    btstack_crypto_ecc_p256_key_pool_refill_active = false;
+    btstack_crypto_ecc_p256_key_pool_random_ready  = false;
 #endif
     btstack_crypto_wait_for_hci_result = false;
     btstack_crypto_operations = NULL;
+#ifdef ENABLE_CRYPTO_BATCH
+#ifdef USE_BTSTACK_AES128
+    if (btstack_crypto_batch_timer_active){
+        (void)btstack_run_loop_remove_timer(&btstack_crypto_batch_timer);
+        btstack_crypto_batch_timer_active = false;
+    }
+    btstack_crypto_batch_budget = 0;
+    btstack_crypto_batch_delivering = false;
+#else
+    btstack_crypto_aes128_in_flight = 0;
+#endif
+#endif
 }
 
 void btstack_crypto_init(void){
@@ -1370,6 +1919,11 @@ void btstack_crypto_init(void){
 	mbedtls_ecp_group_load(&mbedtls_ec_group, MBEDTLS_ECP_DP_SECP256R1);
 #endif
 
+#ifdef ENABLE_ECC_P256_KEY_POOL
+    btstack_crypto_ecc_p256_key_pool_num_keys = 0;
+    btstack_crypto_ecc_p256_key_pool_enabled  = false;
+#endif
+
     // reset state
     btstack_crypto_state_reset();
 }
@@ -1377,6 +1931,9 @@ void btstack_crypto_init(void){
 // De-Init
 void btstack_crypto_deinit(void) {
     btstack_crypto_initialized = false;
+#ifdef ENABLE_SOFTWARE_AES128
+    btstack_crypto_aes128_clear_key_schedule();
+#endif
 }
 
 // PTS only
@@ -1391,6 +1948,22 @@ void btstack_crypto_ecc_p256_set_key(const uint8_t * public_key, const uint8_t *
 #endif
 }
 
+void btstack_crypto_ecc_p256_set_executor(const btstack_crypto_ecc_p256_executor_t * executor){
+#ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
+    btstack_crypto_ecc_p256_executor = executor;
+#else
+    UNUSED(executor);
+#endif
+}
+
+uint16_t btstack_crypto_ecc_p256_key_pool_count(void){
+#ifdef ENABLE_ECC_P256_KEY_POOL
+    return btstack_crypto_ecc_p256_key_pool_num_keys;
+#else
+    return 0;
+#endif
+}
+
 // Unit testing
 int btstack_crypto_idle(void){
     return btstack_linked_list_empty(&btstack_crypto_operations);
@@ -131,8 +131,34 @@ typedef struct {
 	uint8_t         aad_remainder_len;
 } btstack_crypto_ccm_t;
 
+// Executor for software ECC P-256 operations
+typedef struct {
+	// execute work outside the main thread, then pass done to btstack_run_loop_execute_on_main_thread. only one work item is active at any time
+	void (*execute)(btstack_context_callback_registration_t * work, btstack_context_callback_registration_t * done);
+} btstack_crypto_ecc_p256_executor_t;
+
+#ifdef ENABLE_SOFTWARE_AES128
+// AES128 key with expanded round keys
+typedef struct {
+	uint8_t  key[16];
+	uint32_t round_keys[44];
+} btstack_aes128_key_schedule_t;
+
+// AES128 block cipher implementation used for software AES128
+typedef struct {
+	// expand key into key schedule
+	void (*set_key)(btstack_aes128_key_schedule_t * key_schedule, const uint8_t * key);
+	// encrypt single block with expanded key
+	void (*encrypt)(const btstack_aes128_key_schedule_t * key_schedule, const uint8_t * plaintext, uint8_t * ciphertext);
+	// optional: encrypt independent blocks, each with its own key schedule. plaintext and ciphertext are num_blocks * 16 bytes
+	void (*encrypt_blocks)(const btstack_aes128_key_schedule_t * const * key_schedules, const uint8_t * plaintext, uint8_t * ciphertext, uint16_t num_blocks);
+} btstack_aes128_engine_t;
+#endif
+
 /** 
  * Initialize crypto functions
+ * @note With ENABLE_CRYPTO_BATCH, AES128, CMAC and CCM requests are processed in batches from the run loop,
+ *       i.e. callbacks are not called before the request function returns
  */
 void btstack_crypto_init(void);
 
@@ -197,6 +223,7 @@ void btstack_crypto_aes128_cmac_zero(btstack_crypto_aes128_cmac_t * request, uin
  * Generate Elliptic Curve Public/Private Key Pair (FIPS P-256)
  * @note BTstack uses a single ECC key pair per reset. 
  * @note If LE Controller is used for ECC, private key cannot be read or managed
+ * @note With ENABLE_ECC_P256_KEY_POOL, a pre-generated key pair is used if available. The pool is filled after the first call
  * @param request
  * @param public_key (64 bytes)
  * @param callback
@@ -214,6 +241,21 @@ void btstack_crypto_ecc_p256_generate_key(btstack_crypto_ecc_p256_t * request, u
  */
 void btstack_crypto_ecc_p256_calculate_dhkey(btstack_crypto_ecc_p256_t * request, const uint8_t * public_key, uint8_t * dhkey, void (* callback)(void * arg), void * callback_arg);
 
+/**
+ * Set executor for software ECC P-256 key generation and DH Key calculation, e.g. to run them on a worker thread
+ * @note Only used with micro-ecc or mbedTLS. Without executor, they are executed synchronously
+ * @note Work does not log, as HCI Dump is not thread-safe. Results are logged in done on the main thread
+ * @note Done is still required for work running during stack shutdown, its result is ignored
+ * @param executor or NULL
+ */
+void btstack_crypto_ecc_p256_set_executor(const btstack_crypto_ecc_p256_executor_t * executor);
+
+/**
+ * Get number of pre-generated key pairs in ECC P-256 key pool (ENABLE_ECC_P256_KEY_POOL)
+ * @return num keys
+ */
+uint16_t btstack_crypto_ecc_p256_key_pool_count(void);
+
 /*
  * Validate public key (not implemented for LE Controller ECC)
  * @param public_key (64 bytes)
@@ -282,6 +324,59 @@ void btstack_crypto_ccm_decrypt_block(btstack_crypto_ccm_t * request, uint16_t l
 void btstack_aes128_calc(const uint8_t * key, const uint8_t * plaintext, uint8_t * ciphertext);
 #endif
 
+#ifdef ENABLE_SOFTWARE_AES128
+/**
+ * Set AES128 engine for software AES128
+ * @note Default is AES-NI if the compiler targets it (__AES__), table-based rijndael otherwise.
+ *       The key schedule of the last used key is cached for all blocks of an AES128, CMAC or CCM operation
+ *       and cleared when the operation is done.
+ *       Engines may use different round key layouts: key schedules expanded with btstack_aes128_set_key
+ *       before switching engines become invalid and must be expanded again.
+ * @param engine
+ */
+void btstack_crypto_set_aes128_engine(const btstack_aes128_engine_t * engine);
+
+/**
+ * Get table-based AES128 engine using public domain rijndael implementation
+ * @return engine
+ */
+const btstack_aes128_engine_t * btstack_crypto_aes128_rijndael_get_instance(void);
+
+#ifdef __AES__
+/**
+ * Get AES128 engine using x86 AES-NI instructions
+ * @return engine
+ */
+const btstack_aes128_engine_t * btstack_crypto_aes128_aesni_get_instance(void);
+#endif
+
+/**
+ * Expand key with current AES128 engine, e.g. to encrypt many blocks with the same key
+ * @note Key schedule is only valid for the current engine, see btstack_crypto_set_aes128_engine.
+ *       Caller should clear it after use.
+ * @param key_schedule
+ * @param key (16 bytes)
+ */
+void btstack_aes128_set_key(btstack_aes128_key_schedule_t * key_schedule, const uint8_t * key);
+
+/**
+ * Encrypt plaintext with expanded key using current AES128 engine
+ * @param key_schedule
+ * @param plaintext (16 bytes)
+ * @param ciphertext (16 bytes)
+ */
+void btstack_aes128_encrypt(const btstack_aes128_key_schedule_t * key_schedule, const uint8_t * plaintext, uint8_t * ciphertext);
+
+/**
+ * Encrypt independent blocks using current AES128 engine
+ * @param key_schedules array of num_blocks key schedules, may point to the same key schedule
+ * @param plaintext (num_blocks * 16 bytes)
+ * @param ciphertext (num_blocks * 16 bytes)
+ * @param num_blocks
+ */
+void btstack_aes128_encrypt_blocks(const btstack_aes128_key_schedule_t * const * key_schedules, const uint8_t * plaintext, uint8_t * ciphertext, uint16_t num_blocks);
+#endif
+
 /**
  * @brief De-Init BTstack Crypto
  */
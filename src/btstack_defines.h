@@ -1527,6 +1527,14 @@ typedef uint8_t sm_key_t[16];
  */
 #define ATT_EVENT_CAN_SEND_NOW                                   0xB7u
 
+/**
+ * @format 2JV
+ * @param attribute_handle
+ * @param results_len
+ * @param results list of {con_handle (16 bit), status (8 bit)}
+ */
+#define ATT_EVENT_NOTIFY_ALL_COMPLETE                            0xB8u
+
 // TODO: daemon only event
 
 /**
@@ -3069,6 +3077,19 @@ typedef uint8_t sm_key_t[16];
  */
 #define A2DP_SUBEVENT_SIGNALING_CAPABILITIES_COMPLETE                0x1Bu
 
+/**
+ * @format 12111112      Sent only by A2DP source with ENABLE_A2DP_SOURCE_RATE_CONTROL.
+ * @param subevent_code
+ * @param a2dp_cid
+ * @param local_seid
+ * @param bitpool
+ * @param num_frames
+ * @param congested
+ * @param acl_packets_queued
+ * @param can_send_now_latency_ms
+ */
+#define A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE                  0x1Cu
+
 
 /** AVRCP Subevent */
 
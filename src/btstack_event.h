@@ -2975,6 +2975,34 @@ static inline uint16_t att_event_handle_value_indication_complete_get_attribute_
 }
 
 
+/**
+ * @brief Get field attribute_handle from event ATT_EVENT_NOTIFY_ALL_COMPLETE
+ * @param event packet
+ * @return attribute_handle
+ * @note: btstack_type 2
+ */
+static inline uint16_t att_event_notify_all_complete_get_attribute_handle(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+/**
+ * @brief Get field results_len from event ATT_EVENT_NOTIFY_ALL_COMPLETE
+ * @param event packet
+ * @return results_len
+ * @note: btstack_type J
+ */
+static inline uint8_t att_event_notify_all_complete_get_results_len(const uint8_t * event){
+    return event[4];
+}
+/**
+ * @brief Get field results from event ATT_EVENT_NOTIFY_ALL_COMPLETE
+ * @param event packet
+ * @return results
+ * @note: btstack_type V
+ */
+static inline const uint8_t * att_event_notify_all_complete_get_results(const uint8_t * event){
+    return &event[5];
+}
+
 /**
  * @brief Get field status from event BNEP_EVENT_SERVICE_REGISTERED
  * @param event packet
@@ -9850,6 +9878,70 @@ static inline uint16_t a2dp_subevent_signaling_capabilities_complete_get_a2dp_ci
     return little_endian_read_16(event, 3);
 }
 
+/**
+ * @brief Get field a2dp_cid from event A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE
+ * @param event packet
+ * @return a2dp_cid
+ * @note: btstack_type 2
+ */
+static inline uint16_t a2dp_subevent_streaming_rate_control_update_get_a2dp_cid(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+/**
+ * @brief Get field local_seid from event A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE
+ * @param event packet
+ * @return local_seid
+ * @note: btstack_type 1
+ */
+static inline uint8_t a2dp_subevent_streaming_rate_control_update_get_local_seid(const uint8_t * event){
+    return event[5];
+}
+/**
+ * @brief Get field bitpool from event A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE
+ * @param event packet
+ * @return bitpool
+ * @note: btstack_type 1
+ */
+static inline uint8_t a2dp_subevent_streaming_rate_control_update_get_bitpool(const uint8_t * event){
+    return event[6];
+}
+/**
+ * @brief Get field num_frames from event A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE
+ * @param event packet
+ * @return num_frames
+ * @note: btstack_type 1
+ */
+static inline uint8_t a2dp_subevent_streaming_rate_control_update_get_num_frames(const uint8_t * event){
+    return event[7];
+}
+/**
+ * @brief Get field congested from event A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE
+ * @param event packet
+ * @return congested
+ * @note: btstack_type 1
+ */
+static inline uint8_t a2dp_subevent_streaming_rate_control_update_get_congested(const uint8_t * event){
+    return event[8];
+}
+/**
+ * @brief Get field acl_packets_queued from event A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE
+ * @param event packet
+ * @return acl_packets_queued
+ * @note: btstack_type 1
+ */
+static inline uint8_t a2dp_subevent_streaming_rate_control_update_get_acl_packets_queued(const uint8_t * event){
+    return event[9];
+}
+/**
+ * @brief Get field can_send_now_latency_ms from event A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE
+ * @param event packet
+ * @return can_send_now_latency_ms
+ * @note: btstack_type 2
+ */
+static inline uint16_t a2dp_subevent_streaming_rate_control_update_get_can_send_now_latency_ms(const uint8_t * event){
+    return little_endian_read_16(event, 10);
+}
+
 /**
  * @brief Get field avrcp_cid from event AVRCP_SUBEVENT_NOTIFICATION_PLAYBACK_STATUS_CHANGED
  * @param event packet
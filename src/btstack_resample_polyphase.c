@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "btstack_resample_polyphase.c"
+
+/*
+ *  btstack_resample_polyphase.c
+ *
+ *  Output frame n is calculated at upsampled position n * decimation, with upsampled rate = input rate * num_phases.
+ *  The prototype low-pass filter h with num_phases * num_taps coefficients is split into num_phases sub-filters,
+ *  so that each output frame requires a single dot product of num_taps input frames and one sub-filter.
+ *
+ */
+
+#include <string.h>
+
+#include "btstack_resample_polyphase.h"
+#include "bluetooth.h"
+#include "btstack_util.h"
+
+#if !defined(BTSTACK_RESAMPLE_POLYPHASE_NO_SIMD)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BTSTACK_RESAMPLE_POLYPHASE_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#define BTSTACK_RESAMPLE_POLYPHASE_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+// cutoff frequency relative to lower Nyquist frequency
+#define BTSTACK_RESAMPLE_POLYPHASE_CUTOFF 0.9
+
+#define BTSTACK_RESAMPLE_POLYPHASE_PI 3.14159265358979323846
+
+// sin without libm, only used for filter design
+static double btstack_resample_polyphase_sin(double x){
+    const double two_pi = 2.0 * BTSTACK_RESAMPLE_POLYPHASE_PI;
+    // reduce to [-pi, pi]
+    x -= two_pi * (double) (int32_t) (x / two_pi);
+    if (x >  BTSTACK_RESAMPLE_POLYPHASE_PI) x -= two_pi;
+    if (x < -BTSTACK_RESAMPLE_POLYPHASE_PI) x += two_pi;
+    // reduce to [-pi/2, pi/2]
+    if (x >  (BTSTACK_RESAMPLE_POLYPHASE_PI / 2.0)) x =  BTSTACK_RESAMPLE_POLYPHASE_PI - x;
+    if (x < -(BTSTACK_RESAMPLE_POLYPHASE_PI / 2.0)) x = -BTSTACK_RESAMPLE_POLYPHASE_PI - x;
+    // Taylor series up to x^17
+    double x2 = x * x;
+    double term = x;
+    double result = x;
+    int i;
+    for (i = 2; i <= 16; i += 2){
+        term = -term * x2 / (double) (i * (i + 1));
+        result += term;
+    }
+    return result;
+}
+
+static double btstack_resample_polyphase_cos(double x){
+    return btstack_resample_polyphase_sin(x + (BTSTACK_RESAMPLE_POLYPHASE_PI / 2.0));
+}
+
+static uint32_t btstack_resample_polyphase_gcd(uint32_t a, uint32_t b){
+    while (b != 0u){
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static bool btstack_resample_polyphase_get_ratio(uint32_t input_sample_rate, uint32_t output_sample_rate, uint16_t num_taps,
+                                                 uint32_t * num_phases, uint32_t * decimation){
+    if ((input_sample_rate == 0u) || (output_sample_rate == 0u)) return false;
+    if ((num_taps == 0u) || ((num_taps & 7u) != 0u) || (num_taps > BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS)) return false;
+    uint32_t gcd = btstack_resample_polyphase_gcd(input_sample_rate, output_sample_rate);
+    *num_phases = output_sample_rate / gcd;
+    *decimation = input_sample_rate  / gcd;
+    if (*num_phases > 0xffffu) return false;
+    if ((*decimation / *num_phases) > 0xffffu) return false;
+    return true;
+}
+
+uint32_t btstack_resample_polyphase_get_num_coefficients(uint32_t input_sample_rate, uint32_t output_sample_rate, uint16_t num_taps){
+    uint32_t num_phases;
+    uint32_t decimation;
+    if (btstack_resample_polyphase_get_ratio(input_sample_rate, output_sample_rate, num_taps, &num_phases, &decimation) == false){
+        return 0;
+    }
+    return num_phases * num_taps;
+}
+
+// Blackman windowed sinc
+static double btstack_resample_polyphase_prototype(uint32_t index, uint32_t num_coefficients, double cutoff){
+    double t = (double) index - ((double) (num_coefficients - 1u) / 2.0);
+    double x = (2.0 * BTSTACK_RESAMPLE_POLYPHASE_PI * (double) index) / (double) (num_coefficients - 1u);
+    double window = 0.42 - (0.5 * btstack_resample_polyphase_cos(x)) + (0.08 * btstack_resample_polyphase_cos(2.0 * x));
+    if (t == 0.0){
+        return window * 2.0 * cutoff;
+    }
+    return window * btstack_resample_polyphase_sin(2.0 * BTSTACK_RESAMPLE_POLYPHASE_PI * cutoff * t) / (BTSTACK_RESAMPLE_POLYPHASE_PI * t);
+}
+
+// coefficients are stored per phase in reverse order, for dot product with oldest input frame first
+static void btstack_resample_polyphase_design(int16_t * coefficients, uint32_t num_phases, uint32_t decimation, uint16_t num_taps){
+    uint32_t num_coefficients = num_phases * num_taps;
+    double cutoff = (0.5 * BTSTACK_RESAMPLE_POLYPHASE_CUTOFF) / (double) btstack_max(num_phases, decimation);
+    double sum = 0.0;
+    uint32_t i;
+
+    // scale for unity DC gain of each phase
+    for (i = 0; i < num_coefficients; i++){
+        sum += btstack_resample_polyphase_prototype(i, num_coefficients, cutoff);
+    }
+    double scale = (32768.0 * (double) num_phases) / sum;
+
+    for (i = 0; i < num_coefficients; i++){
+        double value = btstack_resample_polyphase_prototype(i, num_coefficients, cutoff) * scale;
+        int32_t quantized = (int32_t) (value + ((value < 0.0) ? -0.5 : 0.5));
+        if (quantized >  32767) quantized =  32767;
+        if (quantized < -32767) quantized = -32767;
+        // h[tap * num_phases + phase] -> coefficients[phase][num_taps - 1 - tap]
+        uint32_t phase = i % num_phases;
+        uint32_t tap   = i / num_phases;
+        coefficients[(phase * num_taps) + (num_taps - 1u - tap)] = (int16_t) quantized;
+    }
+}
+
+// dot product of num_taps 16-bit values, num_taps is a multiple of 8
+#if defined(BTSTACK_RESAMPLE_POLYPHASE_NEON)
+static int32_t btstack_resample_polyphase_dot(const int16_t * coefficients, const int16_t * samples, uint16_t num_taps){
+    int32x4_t sum = vdupq_n_s32(0);
+    uint16_t i;
+    for (i = 0; i < num_taps; i += 8u){
+        int16x8_t c = vld1q_s16(&coefficients[i]);
+        int16x8_t s = vld1q_s16(&samples[i]);
+        sum = vmlal_s16(sum, vget_low_s16(c),  vget_low_s16(s));
+        sum = vmlal_s16(sum, vget_high_s16(c), vget_high_s16(s));
+    }
+#if defined(__aarch64__)
+    return vaddvq_s32(sum);
+#else
+    int32x2_t pair = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+    return vget_lane_s32(vpadd_s32(pair, pair), 0);
+#endif
+}
+#elif defined(BTSTACK_RESAMPLE_POLYPHASE_SSE2)
+static int32_t btstack_resample_polyphase_dot(const int16_t * coefficients, const int16_t * samples, uint16_t num_taps){
+    __m128i sum = _mm_setzero_si128();
+    uint16_t i;
+    for (i = 0; i < num_taps; i += 8u){
+        __m128i c = _mm_loadu_si128((const __m128i *) &coefficients[i]);
+        __m128i s = _mm_loadu_si128((const __m128i *) &samples[i]);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(c, s));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+#else
+static int32_t btstack_resample_polyphase_dot(const int16_t * coefficients, const int16_t * samples, uint16_t num_taps){
+    int32_t sum = 0;
+    uint16_t i;
+    for (i = 0; i < num_taps; i++){
+        sum += (int32_t) coefficients[i] * (int32_t) samples[i];
+    }
+    return sum;
+}
+#endif
+
+static int16_t btstack_resample_polyphase_saturate(int32_t value){
+    value = (value + (1 << 14)) >> 15;
+    if (value >  32767) return  32767;
+    if (value < -32768) return -32768;
+    return (int16_t) value;
+}
+
+uint8_t btstack_resample_polyphase_init(btstack_resample_polyphase_t * context, uint32_t input_sample_rate, uint32_t output_sample_rate,
+                                        uint8_t num_channels, uint16_t num_taps, int16_t * coefficient_storage, uint32_t coefficient_storage_size){
+    uint32_t num_phases;
+    uint32_t decimation;
+    if ((num_channels == 0u) || (num_channels > BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS)){
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+    if (btstack_resample_polyphase_get_ratio(input_sample_rate, output_sample_rate, num_taps, &num_phases, &decimation) == false){
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+    if (coefficient_storage_size < (num_phases * num_taps)){
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+
+    btstack_resample_polyphase_design(coefficient_storage, num_phases, decimation, num_taps);
+
+    context->coefficients = coefficient_storage;
+    context->num_phases   = (uint16_t) num_phases;
+    context->num_taps     = num_taps;
+    context->input_step   = (uint16_t) (decimation / num_phases);
+    context->phase_step   = (uint16_t) (decimation % num_phases);
+    context->num_channels = num_channels;
+    btstack_resample_polyphase_reset(context);
+    return ERROR_CODE_SUCCESS;
+}
+
+void btstack_resample_polyphase_reset(btstack_resample_polyphase_t * context){
+    // start with silence in history, first input frame is newest frame for first output frame
+    memset(context->history, 0, sizeof(context->history));
+    context->history_frames = context->num_taps - 1u;
+    context->input_index    = context->num_taps - 1u;
+    context->phase          = 0;
+}
+
+uint32_t btstack_resample_polyphase_get_max_output_frames(const btstack_resample_polyphase_t * context, uint32_t num_frames){
+    uint32_t decimation = ((uint32_t) context->input_step * context->num_phases) + context->phase_step;
+    // 64-bit product, num_frames * num_phases does not fit into 32 bit for large blocks
+    uint64_t max_output_frames = (((uint64_t) num_frames * context->num_phases) / decimation) + 1u;
+    if (max_output_frames > UINT32_MAX){
+        return UINT32_MAX;
+    }
+    return (uint32_t) max_output_frames;
+}
+
+uint32_t btstack_resample_polyphase_block(btstack_resample_polyphase_t * context, const int16_t * input_buffer, uint32_t num_frames, int16_t * output_buffer){
+    const uint8_t  num_channels = context->num_channels;
+    const uint16_t num_taps     = context->num_taps;
+    uint32_t output_frames = 0;
+
+    while (num_frames > 0u){
+        // deinterleave next block after history
+        uint16_t block_frames = (uint16_t) btstack_min(num_frames, BTSTACK_RESAMPLE_POLYPHASE_BLOCK_FRAMES);
+        uint16_t i;
+        uint8_t channel;
+        for (i = 0; i < block_frames; i++){
+            for (channel = 0; channel < num_channels; channel++){
+                context->history[channel][context->history_frames + i] = *input_buffer++;
+            }
+        }
+        context->history_frames += block_frames;
+        num_frames -= block_frames;
+
+        // all output frames with newest input frame in buffer
+        while (context->input_index < context->history_frames){
+            const int16_t * coefficients = &context->coefficients[context->phase * num_taps];
+            uint32_t first_frame = context->input_index + 1u - num_taps;
+            for (channel = 0; channel < num_channels; channel++){
+                *output_buffer++ = btstack_resample_polyphase_saturate(btstack_resample_polyphase_dot(coefficients, &context->history[channel][first_frame], num_taps));
+            }
+            output_frames++;
+            context->input_index += context->input_step;
+            context->phase       += context->phase_step;
+            if (context->phase >= context->num_phases){
+                context->phase -= context->num_phases;
+                context->input_index++;
+            }
+        }
+
+        // keep num_taps - 1 frames as history
+        uint32_t frames_to_drop = context->history_frames - (num_taps - 1u);
+        for (channel = 0; channel < num_channels; channel++){
+            memmove(&context->history[channel][0], &context->history[channel][frames_to_drop], (num_taps - 1u) * sizeof(int16_t));
+        }
+        context->history_frames = num_taps - 1u;
+        context->input_index   -= frames_to_drop;
+    }
+    return output_frames;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title Polyphase Resampling
+ *
+ * Sample rate conversion for 16-bit audio with arbitrary rational ratio, e.g. 44.1 kHz <-> 48 kHz or 16 kHz <-> 48 kHz,
+ * using a windowed-sinc polyphase FIR filter with 16-bit coefficients.
+ *
+ * The filter coefficients are calculated during init and stored in a caller-provided buffer of
+ * btstack_resample_polyphase_get_num_coefficients() entries. On x86 with SSE2 and on ARM with NEON,
+ * the filter uses SIMD instructions, which can be disabled with BTSTACK_RESAMPLE_POLYPHASE_NO_SIMD.
+ *
+ * For small drift compensation with minimal CPU and memory use, see btstack_resample.
+ *
+ */
+
+#ifndef BTSTACK_RESAMPLE_POLYPHASE_H
+#define BTSTACK_RESAMPLE_POLYPHASE_H
+
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#ifndef BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS
+#define BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS 2
+#endif
+
+// filter taps per phase, multiple of 8
+#ifndef BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS
+#define BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS 64
+#endif
+
+// input frames processed per step
+#define BTSTACK_RESAMPLE_POLYPHASE_BLOCK_FRAMES 64
+
+typedef struct {
+    // filter
+    const int16_t * coefficients;
+    uint16_t num_phases;
+    uint16_t num_taps;
+    uint16_t input_step;
+    uint16_t phase_step;
+    uint8_t  num_channels;
+
+    // position of next output frame
+    uint16_t phase;
+    uint32_t input_index;
+
+    // deinterleaved history and current block
+    uint16_t history_frames;
+    int16_t  history[BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS][BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS + BTSTACK_RESAMPLE_POLYPHASE_BLOCK_FRAMES];
+} btstack_resample_polyphase_t;
+
+/* API_START */
+
+/**
+ * @brief Get number of filter coefficients for given conversion
+ * @param input_sample_rate
+ * @param output_sample_rate
+ * @param num_taps per phase, multiple of 8 up to BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS. 32 is a good start
+ * @return num coefficients or 0 if conversion is not supported
+ */
+uint32_t btstack_resample_polyphase_get_num_coefficients(uint32_t input_sample_rate, uint32_t output_sample_rate, uint16_t num_taps);
+
+/**
+ * @brief Init resample context and calculate filter coefficients
+ * @param context
+ * @param input_sample_rate
+ * @param output_sample_rate
+ * @param num_channels up to BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS
+ * @param num_taps per phase, multiple of 8 up to BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS
+ * @param coefficient_storage
+ * @param coefficient_storage_size number of int16_t in coefficient_storage
+ * @return status ERROR_CODE_SUCCESS, ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, or ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if coefficient storage is too small
+ */
+uint8_t btstack_resample_polyphase_init(btstack_resample_polyphase_t * context, uint32_t input_sample_rate, uint32_t output_sample_rate,
+                                        uint8_t num_channels, uint16_t num_taps, int16_t * coefficient_storage, uint32_t coefficient_storage_size);
+
+/**
+ * @brief Clear filter history, e.g. when starting a new stream
+ * @param context
+ */
+void btstack_resample_polyphase_reset(btstack_resample_polyphase_t * context);
+
+/**
+ * @brief Get max number of output frames for given number of input frames
+ * @param context
+ * @param num_frames
+ * @return max number of output frames, saturates at UINT32_MAX
+ */
+uint32_t btstack_resample_polyphase_get_max_output_frames(const btstack_resample_polyphase_t * context, uint32_t num_frames);
+
+/**
+ * @brief Process block of interleaved input frames. The filter delays the signal by num_taps / 2 input frames
+ * @note size of output buffer is not checked, see btstack_resample_polyphase_get_max_output_frames
+ * @param context
+ * @param input_buffer
+ * @param num_frames
+ * @param output_buffer
+ * @return number of output frames
+ */
+uint32_t btstack_resample_polyphase_block(btstack_resample_polyphase_t * context, const int16_t * input_buffer, uint32_t num_frames, int16_t * output_buffer);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // BTSTACK_RESAMPLE_POLYPHASE_H
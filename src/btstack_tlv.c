@@ -40,6 +40,8 @@
 #include "btstack_tlv.h"
 #include "btstack_debug.h"
 
+#include <stddef.h>
+
 
 static const btstack_tlv_t * btstack_tlv_singleton_impl;
 static void * 		         btstack_tlv_singleton_context;
@@ -54,3 +56,22 @@ void btstack_tlv_get_instance(const btstack_tlv_t ** tlv_impl, void ** tlv_conte
 	*tlv_impl    = btstack_tlv_singleton_impl;
 	*tlv_context = btstack_tlv_singleton_context;
 }
+
+void btstack_tlv_iterate_tags(const btstack_tlv_t * tlv_impl, void * tlv_context, uint32_t tag_first, uint32_t tag_last,
+                              btstack_tlv_iterate_callback_t callback, void * callback_context){
+	if (tag_first > tag_last) return;
+	if (tlv_impl->iterate_tags != NULL){
+		(*tlv_impl->iterate_tags)(tlv_context, tag_first, tag_last, callback, callback_context);
+		return;
+	}
+	// fallback: probe every tag in range, get_tag returns value size for buffer = NULL
+	uint32_t tag = tag_first;
+	while (true){
+		int value_size = (*tlv_impl->get_tag)(tlv_context, tag, NULL, 0);
+		if (value_size > 0){
+			if ((*callback)(callback_context, tag, (uint32_t) value_size) == false) return;
+		}
+		if (tag == tag_last) return;
+		tag++;
+	}
+}
@@ -41,6 +41,7 @@
 #define BTSTACK_TLV_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #if defined __cplusplus
 extern "C" {
@@ -48,6 +49,15 @@ extern "C" {
 
 /* API_START */
 
+/**
+ * @brief Callback for tag iteration
+ * @param context provided to iterate_tags
+ * @param tag
+ * @param value_size
+ * @return true to continue iteration, false to stop
+ */
+typedef bool (*btstack_tlv_iterate_callback_t)(void * context, uint32_t tag, uint32_t value_size);
+
 typedef struct {
 
 	/**
@@ -56,7 +66,7 @@ typedef struct {
 	 * @param tag
 	 * @param buffer
 	 * @param buffer_size
-	 * @return size of value
+	 * @return size of value, size of stored value if buffer is NULL
 	 */
 	int (*get_tag)(void * context, uint32_t tag, uint8_t * buffer, uint32_t buffer_size);
 
@@ -78,6 +88,17 @@ typedef struct {
 	 */
 	void (*delete_tag)(void * context,  uint32_t tag);
 
+	/**
+	 * Iterate over all stored tags in range [tag_first, tag_last] in unspecified order (optional, can be NULL)
+	 * @note callback may call get_tag, but must not store or delete tags
+	 * @param context
+	 * @param tag_first
+	 * @param tag_last
+	 * @param callback
+	 * @param callback_context
+	 */
+	void (*iterate_tags)(void * context, uint32_t tag_first, uint32_t tag_last, btstack_tlv_iterate_callback_t callback, void * callback_context);
+
 } btstack_tlv_t;
 
 /** 
@@ -95,6 +116,20 @@ void btstack_tlv_set_instance(const btstack_tlv_t * tlv_impl, void * tlv_context
  */
 void btstack_tlv_get_instance(const btstack_tlv_t ** tlv_impl, void ** tlv_context);
 
+/**
+ * @brief Iterate over all stored tags in range [tag_first, tag_last]. Uses iterate_tags of the TLV implementation if
+ *        available, otherwise each tag in the range is checked with get_tag.
+ * @note For a prefix scan, use tag_first = prefix and tag_last = prefix | ~prefix_mask
+ * @param tlv_impl
+ * @param tlv_context
+ * @param tag_first
+ * @param tag_last
+ * @param callback
+ * @param callback_context
+ */
+void btstack_tlv_iterate_tags(const btstack_tlv_t * tlv_impl, void * tlv_context, uint32_t tag_first, uint32_t tag_last,
+                              btstack_tlv_iterate_callback_t callback, void * callback_context);
+
 /* API_END */
 
 #if defined __cplusplus
@@ -62,10 +62,17 @@ static int btstack_tlv_none_store_tag(void * context, uint32_t tag, const uint8_
 static void btstack_tlv_none_delete_tag(void * context, uint32_t tag){
 }
 
+/**
+ * Iterate Tags
+ */
+static void btstack_tlv_none_iterate_tags(void * context, uint32_t tag_first, uint32_t tag_last, btstack_tlv_iterate_callback_t callback, void * callback_context){
+}
+
 static const btstack_tlv_t btstack_tlv_none = {
 	/* int  (*get_tag)(..);     */ &btstack_tlv_none_get_tag,
 	/* int (*store_tag)(..);    */ &btstack_tlv_none_store_tag,
 	/* void (*delete_tag)(v..); */ &btstack_tlv_none_delete_tag,
+	/* void (*iterate_tags)(..); */ &btstack_tlv_none_iterate_tags,
 };
 
 /**
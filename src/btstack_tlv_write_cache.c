@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#define BTSTACK_FILE__ "btstack_tlv_write_cache.c"
+
+#include "btstack_tlv_write_cache.h"
+#include "btstack_debug.h"
+#include "btstack_util.h"
+
+#include <string.h>
+
+static btstack_tlv_write_cache_entry_t * btstack_tlv_write_cache_find_entry(btstack_tlv_write_cache_t * self, uint32_t tag){
+	uint16_t i;
+	for (i = 0; i < self->num_entries; i++){
+		btstack_tlv_write_cache_entry_t * entry = &self->entries[i];
+		if (entry->state == BTSTACK_TLV_WRITE_CACHE_ENTRY_EMPTY) continue;
+		if (entry->tag == tag) return entry;
+	}
+	return NULL;
+}
+
+static void btstack_tlv_write_cache_touch_entry(btstack_tlv_write_cache_t * self, btstack_tlv_write_cache_entry_t * entry){
+	self->use_counter++;
+	entry->last_used = self->use_counter;
+}
+
+// @returns empty or least recently used clean entry, NULL if all entries are dirty
+static btstack_tlv_write_cache_entry_t * btstack_tlv_write_cache_find_free_entry(btstack_tlv_write_cache_t * self){
+	btstack_tlv_write_cache_entry_t * lru_entry = NULL;
+	uint16_t i;
+	for (i = 0; i < self->num_entries; i++){
+		btstack_tlv_write_cache_entry_t * entry = &self->entries[i];
+		switch (entry->state){
+			case BTSTACK_TLV_WRITE_CACHE_ENTRY_EMPTY:
+				return entry;
+			case BTSTACK_TLV_WRITE_CACHE_ENTRY_CLEAN:
+				if ((lru_entry == NULL) || ((int32_t)(entry->last_used - lru_entry->last_used) < 0)){
+					lru_entry = entry;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	return lru_entry;
+}
+
+static btstack_tlv_write_cache_entry_t * btstack_tlv_write_cache_add_entry(btstack_tlv_write_cache_t * self, uint32_t tag){
+	btstack_tlv_write_cache_entry_t * entry = btstack_tlv_write_cache_find_free_entry(self);
+	if (entry == NULL){
+		// all entries dirty, write them now
+		btstack_tlv_write_cache_flush(self);
+		entry = btstack_tlv_write_cache_find_free_entry(self);
+		if (entry == NULL) return NULL;
+	}
+	memset(entry, 0, sizeof(btstack_tlv_write_cache_entry_t));
+	entry->tag = tag;
+	return entry;
+}
+
+static void btstack_tlv_write_cache_flush_timer_handler(btstack_timer_source_t * ts){
+	btstack_tlv_write_cache_t * self = (btstack_tlv_write_cache_t *) btstack_run_loop_get_timer_context(ts);
+	self->flush_timer_active = false;
+	btstack_tlv_write_cache_flush(self);
+}
+
+static void btstack_tlv_write_cache_mark_dirty(btstack_tlv_write_cache_t * self, btstack_tlv_write_cache_entry_t * entry){
+	entry->state = BTSTACK_TLV_WRITE_CACHE_ENTRY_DIRTY;
+	if (self->flush_delay_ms == 0) return;
+	if (self->flush_timer_active) return;
+	self->flush_timer_active = true;
+	btstack_run_loop_set_timer_handler(&self->flush_timer, &btstack_tlv_write_cache_flush_timer_handler);
+	btstack_run_loop_set_timer_context(&self->flush_timer, self);
+	btstack_run_loop_set_timer(&self->flush_timer, self->flush_delay_ms);
+	btstack_run_loop_add_timer(&self->flush_timer);
+}
+
+/**
+ * Get Value for Tag
+ * @param tag
+ * @param buffer
+ * @param buffer_size
+ * @return size of value
+ */
+static int btstack_tlv_write_cache_get_tag(void * context, uint32_t tag, uint8_t * buffer, uint32_t buffer_size){
+	btstack_tlv_write_cache_t * self = (btstack_tlv_write_cache_t *) context;
+	btstack_tlv_write_cache_entry_t * entry = btstack_tlv_write_cache_find_entry(self, tag);
+	if (entry == NULL){
+		return self->tlv_impl->get_tag(self->tlv_context, tag, buffer, buffer_size);
+	}
+	btstack_tlv_write_cache_touch_entry(self, entry);
+	if (entry->deleted) return 0;
+	// return len if buffer = NULL
+	if (buffer == NULL) return entry->len;
+	uint16_t bytes_to_copy = btstack_min(buffer_size, entry->len);
+	memcpy(buffer, entry->value, bytes_to_copy);
+	return bytes_to_copy;
+}
+
+/**
+ * Store Tag
+ * @param tag
+ * @param data
+ * @param data_size
+ * @return 0 on success
+ */
+static int btstack_tlv_write_cache_store_tag(void * context, uint32_t tag, const uint8_t * data, uint32_t data_size){
+	btstack_tlv_write_cache_t * self = (btstack_tlv_write_cache_t *) context;
+	self->statistics.num_requests++;
+
+	btstack_tlv_write_cache_entry_t * entry = btstack_tlv_write_cache_find_entry(self, tag);
+
+	// write through if value is too large, overwrites pending change
+	if (data_size > BTSTACK_TLV_WRITE_CACHE_MAX_VALUE_SIZE){
+		if (entry != NULL){
+			entry->state = BTSTACK_TLV_WRITE_CACHE_ENTRY_EMPTY;
+		}
+		self->statistics.num_writes++;
+		return self->tlv_impl->store_tag(self->tlv_context, tag, data, data_size);
+	}
+
+	if (entry == NULL){
+		entry = btstack_tlv_write_cache_add_entry(self, tag);
+		if (entry == NULL){
+			self->statistics.num_writes++;
+			return self->tlv_impl->store_tag(self->tlv_context, tag, data, data_size);
+		}
+	} else if ((entry->deleted == false) && (entry->len == data_size) && (memcmp(entry->value, data, data_size) == 0)){
+		// value unchanged
+		entry->statistics.num_requests++;
+		btstack_tlv_write_cache_touch_entry(self, entry);
+		return 0;
+	}
+
+	entry->statistics.num_requests++;
+	btstack_tlv_write_cache_touch_entry(self, entry);
+	entry->deleted = false;
+	entry->len = (uint16_t) data_size;
+	(void) memcpy(entry->value, data, data_size);
+	btstack_tlv_write_cache_mark_dirty(self, entry);
+	return 0;
+}
+
+/**
+ * Delete Tag
+ * @param tag
+ */
+static void btstack_tlv_write_cache_delete_tag(void * context, uint32_t tag){
+	btstack_tlv_write_cache_t * self = (btstack_tlv_write_cache_t *) context;
+	self->statistics.num_requests++;
+
+	btstack_tlv_write_cache_entry_t * entry = btstack_tlv_write_cache_find_entry(self, tag);
+	if (entry == NULL){
+		entry = btstack_tlv_write_cache_add_entry(self, tag);
+		if (entry == NULL){
+			self->statistics.num_writes++;
+			self->tlv_impl->delete_tag(self->tlv_context, tag);
+			return;
+		}
+	} else if (entry->deleted){
+		// already deleted
+		entry->statistics.num_requests++;
+		btstack_tlv_write_cache_touch_entry(self, entry);
+		return;
+	}
+
+	entry->statistics.num_requests++;
+	btstack_tlv_write_cache_touch_entry(self, entry);
+	entry->deleted = true;
+	entry->len = 0;
+	btstack_tlv_write_cache_mark_dirty(self, entry);
+}
+
+/**
+ * Iterate over stored tags in range, pending changes are written first
+ * @param tag_first
+ * @param tag_last
+ * @param callback
+ * @param callback_context
+ */
+static void btstack_tlv_write_cache_iterate_tags(void * context, uint32_t tag_first, uint32_t tag_last, btstack_tlv_iterate_callback_t callback, void * callback_context){
+	btstack_tlv_write_cache_t * self = (btstack_tlv_write_cache_t *) context;
+	btstack_tlv_write_cache_flush(self);
+	btstack_tlv_iterate_tags(self->tlv_impl, self->tlv_context, tag_first, tag_last, callback, callback_context);
+}
+
+static const btstack_tlv_t btstack_tlv_write_cache = {
+	/* int  (*get_tag)(..);     */ &btstack_tlv_write_cache_get_tag,
+	/* int (*store_tag)(..);    */ &btstack_tlv_write_cache_store_tag,
+	/* void (*delete_tag)(v..); */ &btstack_tlv_write_cache_delete_tag,
+	/* void (*iterate_tags)(..); */ &btstack_tlv_write_cache_iterate_tags,
+};
+
+const btstack_tlv_t * btstack_tlv_write_cache_init_instance(btstack_tlv_write_cache_t * self, const btstack_tlv_t * tlv_impl, void * tlv_context,
+                                                            btstack_tlv_write_cache_entry_t * entries, uint16_t num_entries, uint32_t flush_delay_ms){
+	memset(self, 0, sizeof(btstack_tlv_write_cache_t));
+	memset(entries, 0, num_entries * sizeof(btstack_tlv_write_cache_entry_t));
+	self->tlv_impl = tlv_impl;
+	self->tlv_context = tlv_context;
+	self->entries = entries;
+	self->num_entries = num_entries;
+	self->flush_delay_ms = flush_delay_ms;
+	return &btstack_tlv_write_cache;
+}
+
+void btstack_tlv_write_cache_flush(btstack_tlv_write_cache_t * self){
+	if (self->flush_timer_active){
+		self->flush_timer_active = false;
+		btstack_run_loop_remove_timer(&self->flush_timer);
+	}
+	uint16_t i;
+	for (i = 0; i < self->num_entries; i++){
+		btstack_tlv_write_cache_entry_t * entry = &self->entries[i];
+		if (entry->state != BTSTACK_TLV_WRITE_CACHE_ENTRY_DIRTY) continue;
+		if (entry->deleted){
+			self->tlv_impl->delete_tag(self->tlv_context, entry->tag);
+		} else {
+			int result = self->tlv_impl->store_tag(self->tlv_context, entry->tag, entry->value, entry->len);
+			if (result != 0){
+				log_error("store tag %08x failed", (unsigned int) entry->tag);
+			}
+		}
+		entry->state = BTSTACK_TLV_WRITE_CACHE_ENTRY_CLEAN;
+		entry->statistics.num_writes++;
+		self->statistics.num_writes++;
+	}
+}
+
+bool btstack_tlv_write_cache_get_tag_statistics(btstack_tlv_write_cache_t * self, uint32_t tag, btstack_tlv_write_cache_statistics_t * statistics){
+	const btstack_tlv_write_cache_entry_t * entry = btstack_tlv_write_cache_find_entry(self, tag);
+	if (entry == NULL) return false;
+	*statistics = entry->statistics;
+	return true;
+}
+
+void btstack_tlv_write_cache_get_statistics(btstack_tlv_write_cache_t * self, btstack_tlv_write_cache_statistics_t * statistics){
+	*statistics = self->statistics;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * @title TLV Write Cache
+ *
+ * Decorator for a btstack_tlv_t implementation that collects stores and deletes in RAM and
+ * writes them to the underlying TLV after a delay or on btstack_tlv_write_cache_flush.
+ * Repeated stores to the same tag result in a single write. Reads return the latest value.
+ *
+ */
+
+#ifndef BTSTACK_TLV_WRITE_CACHE_H
+#define BTSTACK_TLV_WRITE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "btstack_config.h"
+#include "btstack_run_loop.h"
+#include "btstack_tlv.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// larger values are written through
+#ifndef BTSTACK_TLV_WRITE_CACHE_MAX_VALUE_SIZE
+#define BTSTACK_TLV_WRITE_CACHE_MAX_VALUE_SIZE 128
+#endif
+
+typedef struct {
+	// number of store and delete operations for tag
+	uint32_t num_requests;
+	// number of store and delete operations passed to underlying TLV
+	uint32_t num_writes;
+} btstack_tlv_write_cache_statistics_t;
+
+typedef enum {
+	BTSTACK_TLV_WRITE_CACHE_ENTRY_EMPTY = 0,
+	BTSTACK_TLV_WRITE_CACHE_ENTRY_CLEAN,
+	BTSTACK_TLV_WRITE_CACHE_ENTRY_DIRTY,
+} btstack_tlv_write_cache_entry_state_t;
+
+typedef struct {
+	uint32_t tag;
+	uint32_t last_used;
+	btstack_tlv_write_cache_statistics_t statistics;
+	btstack_tlv_write_cache_entry_state_t state;
+	bool     deleted;
+	uint16_t len;
+	uint8_t  value[BTSTACK_TLV_WRITE_CACHE_MAX_VALUE_SIZE];
+} btstack_tlv_write_cache_entry_t;
+
+typedef struct {
+	const btstack_tlv_t * tlv_impl;
+	void * tlv_context;
+	btstack_tlv_write_cache_entry_t * entries;
+	uint16_t num_entries;
+	uint32_t flush_delay_ms;
+	uint32_t use_counter;
+	bool     flush_timer_active;
+	btstack_timer_source_t flush_timer;
+	btstack_tlv_write_cache_statistics_t statistics;
+} btstack_tlv_write_cache_t;
+
+/* API_START */
+
+/**
+ * @brief Init write cache for TLV implementation
+ * @param context btstack_tlv_write_cache_t
+ * @param tlv_impl of underlying TLV
+ * @param tlv_context of underlying TLV
+ * @param entries storage for cached tags
+ * @param num_entries in storage
+ * @param flush_delay_ms after first modification until changes are written, 0 = only on btstack_tlv_write_cache_flush
+ * @return btstack_tlv_t implementation to use with context
+ */
+const btstack_tlv_t * btstack_tlv_write_cache_init_instance(btstack_tlv_write_cache_t * context, const btstack_tlv_t * tlv_impl, void * tlv_context,
+                                                            btstack_tlv_write_cache_entry_t * entries, uint16_t num_entries, uint32_t flush_delay_ms);
+
+/**
+ * @brief Write all pending changes to underlying TLV, e.g. before shutdown
+ * @param context btstack_tlv_write_cache_t
+ */
+void btstack_tlv_write_cache_flush(btstack_tlv_write_cache_t * context);
+
+/**
+ * @brief Get number of requests and writes for tag, only available while tag is cached
+ * @param context btstack_tlv_write_cache_t
+ * @param tag
+ * @param statistics
+ * @return true if tag is cached
+ */
+bool btstack_tlv_write_cache_get_tag_statistics(btstack_tlv_write_cache_t * context, uint32_t tag, btstack_tlv_write_cache_statistics_t * statistics);
+
+/**
+ * @brief Get number of requests and writes for all tags
+ * @param context btstack_tlv_write_cache_t
+ * @param statistics
+ */
+void btstack_tlv_write_cache_get_statistics(btstack_tlv_write_cache_t * context, btstack_tlv_write_cache_statistics_t * statistics);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+#endif // BTSTACK_TLV_WRITE_CACHE_H
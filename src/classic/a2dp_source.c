@@ -57,14 +57,55 @@
 #include "bluetooth_sdp.h"
 #include "btstack_debug.h"
 #include "btstack_event.h"
+#include "btstack_run_loop.h"
 #include "classic/a2dp.h"
 #include "classic/a2dp_source.h"
 #include "classic/avdtp_source.h"
 #include "classic/avdtp_util.h"
 #include "classic/sdp_util.h"
+#include "hci.h"
 #include "l2cap.h"
 #include "a2dp.h"
 
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+
+// link is considered congested if either ACL packets queued in Controller or can send now latency reach high threshold
+#ifndef A2DP_SOURCE_RATE_CONTROL_ACL_QUEUE_HIGH
+#define A2DP_SOURCE_RATE_CONTROL_ACL_QUEUE_HIGH 4
+#endif
+#ifndef A2DP_SOURCE_RATE_CONTROL_LATENCY_HIGH_MS
+#define A2DP_SOURCE_RATE_CONTROL_LATENCY_HIGH_MS 20
+#endif
+
+// link is considered clear if both are at or below low threshold
+#ifndef A2DP_SOURCE_RATE_CONTROL_ACL_QUEUE_LOW
+#define A2DP_SOURCE_RATE_CONTROL_ACL_QUEUE_LOW 1
+#endif
+#ifndef A2DP_SOURCE_RATE_CONTROL_LATENCY_LOW_MS
+#define A2DP_SOURCE_RATE_CONTROL_LATENCY_LOW_MS 5
+#endif
+
+// number of consecutive samples before bitpool is changed: decrease quickly, increase slowly
+#ifndef A2DP_SOURCE_RATE_CONTROL_DECREASE_SAMPLES
+#define A2DP_SOURCE_RATE_CONTROL_DECREASE_SAMPLES 2
+#endif
+#ifndef A2DP_SOURCE_RATE_CONTROL_INCREASE_SAMPLES
+#define A2DP_SOURCE_RATE_CONTROL_INCREASE_SAMPLES 50
+#endif
+
+#ifndef A2DP_SOURCE_RATE_CONTROL_BITPOOL_STEP_DOWN
+#define A2DP_SOURCE_RATE_CONTROL_BITPOOL_STEP_DOWN 6
+#endif
+#ifndef A2DP_SOURCE_RATE_CONTROL_BITPOOL_STEP_UP
+#define A2DP_SOURCE_RATE_CONTROL_BITPOOL_STEP_UP 2
+#endif
+
+// number of frames field in SBC media payload header has 4 bits
+#define A2DP_SOURCE_RATE_CONTROL_MAX_NUM_FRAMES 15
+
+static btstack_linked_list_t a2dp_source_rate_controls;
+#endif
+
 static const char * a2dp_source_default_service_name = "BTstack A2DP Source Service";
 static const char * a2dp_default_source_service_provider_name = "BTstack A2DP Source Service Provider";
 
@@ -81,6 +122,172 @@ void a2dp_source_create_sdp_record(uint8_t * service, uint32_t service_record_ha
                            supported_features, service_name, service_provider_name);
 }
 
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+static a2dp_source_rate_control_t * a2dp_source_rate_control_for_stream(uint16_t a2dp_cid, uint8_t local_seid){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &a2dp_source_rate_controls);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        a2dp_source_rate_control_t * rate_control = (a2dp_source_rate_control_t *) btstack_linked_list_iterator_next(&it);
+        if ((rate_control->a2dp_cid == a2dp_cid) && (rate_control->local_seid == local_seid)){
+            return rate_control;
+        }
+    }
+    return NULL;
+}
+
+// SBC frame length according to A2DP spec, section 12.9
+static uint16_t a2dp_source_rate_control_sbc_frame_length(const avdtp_configuration_sbc_t * configuration, uint8_t bitpool){
+    uint16_t num_channels = (configuration->channel_mode == AVDTP_CHANNEL_MODE_MONO) ? 1 : 2;
+    uint16_t num_bits;
+    switch (configuration->channel_mode){
+        case AVDTP_CHANNEL_MODE_MONO:
+        case AVDTP_CHANNEL_MODE_DUAL_CHANNEL:
+            num_bits = configuration->block_length * num_channels * bitpool;
+            break;
+        case AVDTP_CHANNEL_MODE_JOINT_STEREO:
+            num_bits = configuration->subbands + (configuration->block_length * bitpool);
+            break;
+        default:
+            num_bits = configuration->block_length * bitpool;
+            break;
+    }
+    return 4u + ((4u * configuration->subbands * num_channels) / 8u) + ((num_bits + 7u) / 8u);
+}
+
+static void a2dp_source_rate_control_update_num_frames(a2dp_source_rate_control_t * rate_control){
+    // fill media payload after SBC media payload header
+    uint16_t frame_length = a2dp_source_rate_control_sbc_frame_length(&rate_control->configuration, rate_control->bitpool);
+    uint16_t num_frames = 1;
+    if (rate_control->max_media_payload_size > frame_length){
+        num_frames = (rate_control->max_media_payload_size - 1u) / frame_length;
+    }
+    rate_control->num_frames = (uint8_t) btstack_max(1, btstack_min(num_frames, A2DP_SOURCE_RATE_CONTROL_MAX_NUM_FRAMES));
+}
+
+static void a2dp_source_rate_control_emit_update(a2dp_source_rate_control_t * rate_control){
+    uint8_t event[12];
+    int pos = 0;
+    event[pos++] = HCI_EVENT_A2DP_META;
+    event[pos++] = sizeof(event) - 2;
+    event[pos++] = A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE;
+    little_endian_store_16(event, pos, rate_control->a2dp_cid);
+    pos += 2;
+    event[pos++] = rate_control->local_seid;
+    event[pos++] = rate_control->bitpool;
+    event[pos++] = rate_control->num_frames;
+    event[pos++] = rate_control->congested ? 1 : 0;
+    event[pos++] = rate_control->acl_packets_queued;
+    little_endian_store_16(event, pos, rate_control->can_send_now_latency_ms);
+    pos += 2;
+    a2dp_replace_subevent_id_and_emit_source(event, pos, A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE);
+}
+
+static void a2dp_source_rate_control_handle_can_send_now(uint16_t a2dp_cid, uint8_t local_seid){
+    a2dp_source_rate_control_t * rate_control = a2dp_source_rate_control_for_stream(a2dp_cid, local_seid);
+    if (rate_control == NULL) return;
+
+    // sample can send now latency
+    rate_control->can_send_now_latency_ms = 0;
+    if (rate_control->can_send_now_requested){
+        uint32_t latency_ms = btstack_run_loop_get_time_ms() - rate_control->can_send_now_request_time_ms;
+        rate_control->can_send_now_latency_ms = (uint16_t) btstack_min(latency_ms, 0xffff);
+        rate_control->can_send_now_requested = false;
+    }
+
+    // sample outgoing ACL packets that have not been completed by the Controller yet
+    rate_control->acl_packets_queued = 0;
+    avdtp_stream_endpoint_t * stream_endpoint = avdtp_get_stream_endpoint_for_seid(local_seid);
+    if (stream_endpoint != NULL){
+        hci_connection_t * hci_connection = hci_connection_for_handle(stream_endpoint->media_con_handle);
+        if (hci_connection != NULL){
+            rate_control->acl_packets_queued = hci_connection->num_packets_sent;
+        }
+    }
+
+    bool congested = (rate_control->acl_packets_queued >= A2DP_SOURCE_RATE_CONTROL_ACL_QUEUE_HIGH) ||
+                     (rate_control->can_send_now_latency_ms >= A2DP_SOURCE_RATE_CONTROL_LATENCY_HIGH_MS);
+    bool clear     = (rate_control->acl_packets_queued <= A2DP_SOURCE_RATE_CONTROL_ACL_QUEUE_LOW) &&
+                     (rate_control->can_send_now_latency_ms <= A2DP_SOURCE_RATE_CONTROL_LATENCY_LOW_MS);
+
+    // hysteresis: samples between low and high threshold reset both counters
+    if (congested){
+        rate_control->num_congested_samples++;
+        rate_control->num_clear_samples = 0;
+    } else if (clear){
+        rate_control->num_clear_samples++;
+        rate_control->num_congested_samples = 0;
+    } else {
+        rate_control->num_congested_samples = 0;
+        rate_control->num_clear_samples = 0;
+    }
+
+    uint8_t old_bitpool = rate_control->bitpool;
+    bool old_congested  = rate_control->congested;
+    uint8_t min_bitpool = rate_control->configuration.min_bitpool_value;
+    uint8_t max_bitpool = rate_control->configuration.max_bitpool_value;
+
+    if (rate_control->num_congested_samples >= A2DP_SOURCE_RATE_CONTROL_DECREASE_SAMPLES){
+        rate_control->num_congested_samples = 0;
+        rate_control->congested = true;
+        if (rate_control->bitpool > (min_bitpool + A2DP_SOURCE_RATE_CONTROL_BITPOOL_STEP_DOWN)){
+            rate_control->bitpool -= A2DP_SOURCE_RATE_CONTROL_BITPOOL_STEP_DOWN;
+        } else {
+            rate_control->bitpool = min_bitpool;
+        }
+    }
+
+    if (rate_control->num_clear_samples >= A2DP_SOURCE_RATE_CONTROL_INCREASE_SAMPLES){
+        rate_control->num_clear_samples = 0;
+        rate_control->congested = false;
+        if ((rate_control->bitpool + A2DP_SOURCE_RATE_CONTROL_BITPOOL_STEP_UP) < max_bitpool){
+            rate_control->bitpool += A2DP_SOURCE_RATE_CONTROL_BITPOOL_STEP_UP;
+        } else {
+            rate_control->bitpool = max_bitpool;
+        }
+    }
+
+    if ((old_bitpool == rate_control->bitpool) && (old_congested == rate_control->congested)) return;
+
+    a2dp_source_rate_control_update_num_frames(rate_control);
+    log_info("Rate control a2dp_cid 0x%02x, local seid %u: bitpool %u, num frames %u, acl queued %u, latency %u ms",
+             a2dp_cid, local_seid, rate_control->bitpool, rate_control->num_frames, rate_control->acl_packets_queued, rate_control->can_send_now_latency_ms);
+    a2dp_source_rate_control_emit_update(rate_control);
+}
+
+uint8_t a2dp_source_rate_control_start(a2dp_source_rate_control_t * rate_control, uint16_t a2dp_cid, uint8_t local_seid, const avdtp_configuration_sbc_t * configuration){
+    btstack_assert(rate_control != NULL);
+    btstack_assert(configuration != NULL);
+
+    if (avdtp_get_stream_endpoint_for_seid(local_seid) == NULL){
+        return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    }
+
+    btstack_linked_list_remove(&a2dp_source_rate_controls, (btstack_linked_item_t *) rate_control);
+    memset(rate_control, 0, sizeof(a2dp_source_rate_control_t));
+    rate_control->a2dp_cid = a2dp_cid;
+    rate_control->local_seid = local_seid;
+    rate_control->configuration = *configuration;
+    rate_control->max_media_payload_size = (uint16_t) avdtp_max_media_payload_size(a2dp_cid, local_seid);
+    rate_control->bitpool = configuration->max_bitpool_value;
+    a2dp_source_rate_control_update_num_frames(rate_control);
+
+    btstack_linked_list_add(&a2dp_source_rate_controls, (btstack_linked_item_t *) rate_control);
+    return ERROR_CODE_SUCCESS;
+}
+
+void a2dp_source_rate_control_stop(a2dp_source_rate_control_t * rate_control){
+    btstack_linked_list_remove(&a2dp_source_rate_controls, (btstack_linked_item_t *) rate_control);
+}
+
+uint8_t a2dp_source_rate_control_get_bitpool(const a2dp_source_rate_control_t * rate_control){
+    return rate_control->bitpool;
+}
+
+uint8_t a2dp_source_rate_control_get_num_frames(const a2dp_source_rate_control_t * rate_control){
+    return rate_control->num_frames;
+}
+#endif
+
 static void a2dp_source_packet_handler_internal(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
     UNUSED(channel);
     UNUSED(size);
@@ -95,6 +302,10 @@ static void a2dp_source_packet_handler_internal(uint8_t packet_type, uint16_t ch
             break;
 
         case AVDTP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW:
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+            a2dp_source_rate_control_handle_can_send_now(avdtp_subevent_streaming_can_send_media_packet_now_get_avdtp_cid(packet),
+                                                         avdtp_subevent_streaming_can_send_media_packet_now_get_local_seid(packet));
+#endif
             a2dp_replace_subevent_id_and_emit_source(packet, size, A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW);
             break;
         
@@ -120,6 +331,9 @@ void a2dp_source_deinit(void){
     a2dp_deinit();
     avdtp_source_deinit();
     a2dp_source_media_config_validator = NULL;
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+    a2dp_source_rate_controls = NULL;
+#endif
 }
 
 avdtp_stream_endpoint_t * a2dp_source_create_stream_endpoint(avdtp_media_type_t media_type, avdtp_media_codec_type_t media_codec_type,
@@ -200,6 +414,13 @@ uint8_t a2dp_source_pause_stream(uint16_t avdtp_cid, uint8_t local_seid){
 }
 
 void a2dp_source_stream_endpoint_request_can_send_now(uint16_t avdtp_cid, uint8_t local_seid){
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+    a2dp_source_rate_control_t * rate_control = a2dp_source_rate_control_for_stream(avdtp_cid, local_seid);
+    if ((rate_control != NULL) && (rate_control->can_send_now_requested == false)){
+        rate_control->can_send_now_requested = true;
+        rate_control->can_send_now_request_time_ms = btstack_run_loop_get_time_ms();
+    }
+#endif
     avdtp_source_stream_endpoint_request_can_send_now(avdtp_cid, local_seid);
 }
 
@@ -215,6 +436,14 @@ uint8_t a2dp_source_stream_send_media_payload_rtp(uint16_t a2dp_cid, uint8_t loc
     return avdtp_source_stream_send_media_payload_rtp(a2dp_cid, local_seid, marker, payload, payload_size);
 }
 
+uint8_t * a2dp_source_stream_reserve_media_payload(uint16_t a2dp_cid, uint8_t local_seid, uint16_t * max_payload_size){
+    return avdtp_source_stream_reserve_media_payload(a2dp_cid, local_seid, max_payload_size);
+}
+
+uint8_t a2dp_source_stream_send_reserved_media_payload(uint16_t a2dp_cid, uint8_t local_seid, uint8_t marker, uint16_t payload_size){
+    return avdtp_source_stream_send_reserved_media_payload(a2dp_cid, local_seid, marker, payload_size);
+}
+
 uint8_t	a2dp_source_stream_send_media_packet(uint16_t a2dp_cid, uint8_t local_seid, const uint8_t * packet, uint16_t size){
     return avdtp_source_stream_send_media_packet(a2dp_cid, local_seid, packet, size);
 }
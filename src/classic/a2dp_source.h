@@ -46,12 +46,42 @@
 #define A2DP_SOURCE_H
 
 #include <stdint.h>
+#include "btstack_linked_list.h"
 #include "classic/avdtp.h"
 
 #if defined __cplusplus
 extern "C" {
 #endif
 
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+// SBC rate control state, storage provided by application
+typedef struct {
+    btstack_linked_item_t item;
+
+    uint16_t a2dp_cid;
+    uint8_t  local_seid;
+
+    // stream configuration
+    avdtp_configuration_sbc_t configuration;
+    uint16_t max_media_payload_size;
+
+    // current output
+    uint8_t  bitpool;
+    uint8_t  num_frames;
+
+    // measurement
+    bool     can_send_now_requested;
+    uint32_t can_send_now_request_time_ms;
+    uint16_t can_send_now_latency_ms;
+    uint8_t  acl_packets_queued;
+    bool     congested;
+
+    // hysteresis
+    uint8_t  num_congested_samples;
+    uint8_t  num_clear_samples;
+} a2dp_source_rate_control_t;
+#endif
+
 /* API_START */
 
 /**
@@ -107,6 +137,7 @@ void a2dp_source_finalize_stream_endpoint(avdtp_stream_endpoint_t * stream_endpo
  * - A2DP_SUBEVENT_SIGNALING_MEDIA_CODEC_SBC_CONFIGURATION      SBC configuration
  * - A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW          Signals that a media packet can be sent
  * - A2DP_SUBEVENT_COMMAND_REJECTED                             Command reject
+ * - A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE                Bitpool or number of frames changed by SBC rate control
  * @param callback
  */
 void a2dp_source_register_packet_handler(btstack_packet_handler_t callback);
@@ -184,6 +215,29 @@ int  	a2dp_source_stream_send_media_payload(uint16_t a2dp_cid, uint8_t local_sei
  */
 uint8_t a2dp_source_stream_send_media_payload_rtp(uint16_t a2dp_cid, uint8_t local_seid, uint8_t marker, uint8_t * payload, uint16_t payload_size);
 
+/**
+ * @brief Reserve outgoing packet buffer and get media payload location to encode media frames in place, without copying them.
+ *        For SBC, the first byte is the SBC media payload header with the number of frames, followed by the SBC frames.
+ * @note  Only valid while handling A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW. Must be followed by a2dp_source_stream_send_reserved_media_payload
+ * @param a2dp_cid 			A2DP channel identifier.
+ * @param local_seid  		ID of a local stream endpoint.
+ * @param max_payload_size  max size of media payload, without RTP header
+ * @return media payload in outgoing buffer or NULL if stream is not streaming or buffer is not available
+ */
+uint8_t * a2dp_source_stream_reserve_media_payload(uint16_t a2dp_cid, uint8_t local_seid, uint16_t * max_payload_size);
+
+/**
+ * @brief Add RTP header in front of media payload reserved with a2dp_source_stream_reserve_media_payload and send it
+ * @note  Outgoing buffer is released if payload_size is 0 or media payload cannot be sent.
+ *        Returns ERROR_CODE_COMMAND_DISALLOWED if no media payload was reserved or stream is not streaming
+ * @param a2dp_cid 			A2DP channel identifier.
+ * @param local_seid  		ID of a local stream endpoint.
+ * @param marker
+ * @param payload_size      size of media payload written into reserved buffer
+ * @return status
+ */
+uint8_t a2dp_source_stream_send_reserved_media_payload(uint16_t a2dp_cid, uint8_t local_seid, uint8_t marker, uint16_t payload_size);
+
 /**
  * @brief Send media packet
  * @param a2dp_cid 			A2DP channel identifier.
@@ -259,6 +313,43 @@ void a2dp_source_register_media_config_validator(uint8_t (*callback)(const avdtp
  */
 void a2dp_source_deinit(void);
 
+#ifdef ENABLE_A2DP_SOURCE_RATE_CONTROL
+/**
+ * @brief Start SBC rate control for a started stream. On each A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW,
+ *        the number of ACL packets queued in the Controller and the time since the can send now request are sampled.
+ *        If the link stays congested, the bitpool is lowered towards min_bitpool_value, if it stays clear for a
+ *        longer period, it is raised again up to max_bitpool_value. The number of frames per media packet follows
+ *        from the current bitpool and the max media payload size. Changes are reported via A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE.
+ * @note  Thresholds and steps can be tuned via A2DP_SOURCE_RATE_CONTROL_* defines in btstack_config.h
+ * @param rate_control      storage for rate control state, must stay valid until a2dp_source_rate_control_stop
+ * @param a2dp_cid          A2DP channel identifier.
+ * @param local_seid        ID of a local stream endpoint.
+ * @param configuration     negotiated SBC configuration, from A2DP_SUBEVENT_SIGNALING_MEDIA_CODEC_SBC_CONFIGURATION
+ * @return status ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER if stream endpoint unknown
+ */
+uint8_t a2dp_source_rate_control_start(a2dp_source_rate_control_t * rate_control, uint16_t a2dp_cid, uint8_t local_seid, const avdtp_configuration_sbc_t * configuration);
+
+/**
+ * @brief Stop SBC rate control, e.g. on A2DP_SUBEVENT_STREAM_SUSPENDED or A2DP_SUBEVENT_STREAM_RELEASED
+ * @param rate_control
+ */
+void a2dp_source_rate_control_stop(a2dp_source_rate_control_t * rate_control);
+
+/**
+ * @brief Get SBC bitpool to use for next media packet
+ * @param rate_control
+ * @return bitpool
+ */
+uint8_t a2dp_source_rate_control_get_bitpool(const a2dp_source_rate_control_t * rate_control);
+
+/**
+ * @brief Get max number of SBC frames for next media packet
+ * @param rate_control
+ * @return num_frames
+ */
+uint8_t a2dp_source_rate_control_get_num_frames(const a2dp_source_rate_control_t * rate_control);
+#endif
+
 /* API_END */
 
 #if defined __cplusplus
@@ -243,6 +243,79 @@ uint8_t avdtp_source_stream_send_media_payload_rtp(uint16_t avdtp_cid, uint8_t l
     return l2cap_send_prepared(stream_endpoint->l2cap_media_cid, (uint16_t) packet_size);
 }
 
+uint8_t * avdtp_source_stream_reserve_media_payload(uint16_t avdtp_cid, uint8_t local_seid, uint16_t * max_payload_size){
+    UNUSED(avdtp_cid);
+
+    *max_payload_size = 0;
+
+    avdtp_stream_endpoint_t * stream_endpoint = avdtp_get_stream_endpoint_for_seid(local_seid);
+    if (!stream_endpoint) {
+        log_error("avdtp source: no stream_endpoint with seid %d", local_seid);
+        return NULL;
+    }
+
+    if (stream_endpoint->l2cap_media_cid == 0){
+        log_error("avdtp source: no media connection for seid %d", local_seid);
+        return NULL;
+    }
+
+    if (stream_endpoint->state != AVDTP_STREAM_ENDPOINT_STREAMING){
+        log_error("avdtp source: stream with seid %d not streaming", local_seid);
+        return NULL;
+    }
+
+    if (l2cap_reserve_packet_buffer() == false){
+        return NULL;
+    }
+
+    // media payload follows RTP header, which is filled in by avdtp_source_stream_send_reserved_media_payload
+    *max_payload_size = l2cap_get_remote_mtu_for_local_cid(stream_endpoint->l2cap_media_cid) - AVDTP_MEDIA_PAYLOAD_HEADER_SIZE;
+    return &l2cap_get_outgoing_buffer()[AVDTP_MEDIA_PAYLOAD_HEADER_SIZE];
+}
+
+uint8_t avdtp_source_stream_send_reserved_media_payload(uint16_t avdtp_cid, uint8_t local_seid, uint8_t marker, uint16_t payload_size){
+    UNUSED(avdtp_cid);
+
+    // media payload must have been reserved with avdtp_source_stream_reserve_media_payload
+    if (hci_is_packet_buffer_reserved() == false){
+        log_error("avdtp source: media payload for seid %d not reserved", local_seid);
+        return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+
+    avdtp_stream_endpoint_t * stream_endpoint = avdtp_get_stream_endpoint_for_seid(local_seid);
+    if ((stream_endpoint == NULL) || (stream_endpoint->l2cap_media_cid == 0)){
+        l2cap_release_packet_buffer();
+        return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    }
+
+    if (stream_endpoint->state != AVDTP_STREAM_ENDPOINT_STREAMING){
+        l2cap_release_packet_buffer();
+        return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+
+    // nothing to send, only release outgoing buffer
+    if (payload_size == 0u){
+        l2cap_release_packet_buffer();
+        return ERROR_CODE_SUCCESS;
+    }
+
+    uint32_t buffer_size = l2cap_get_remote_mtu_for_local_cid(stream_endpoint->l2cap_media_cid);
+    uint32_t packet_size = AVDTP_MEDIA_PAYLOAD_HEADER_SIZE + payload_size;
+    if (packet_size > buffer_size) {
+        l2cap_release_packet_buffer();
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+
+    uint8_t * media_packet = l2cap_get_outgoing_buffer();
+    avdtp_source_setup_media_header(media_packet, marker, stream_endpoint->sequence_number);
+    stream_endpoint->sequence_number++;
+    uint8_t status = l2cap_send_prepared(stream_endpoint->l2cap_media_cid, (uint16_t) packet_size);
+    if (status != ERROR_CODE_SUCCESS){
+        l2cap_release_packet_buffer();
+    }
+    return status;
+}
+
 uint8_t avdtp_source_stream_send_media_packet(uint16_t avdtp_cid, uint8_t local_seid, const uint8_t * packet, uint16_t size){
     UNUSED(avdtp_cid);
 
@@ -246,6 +246,28 @@ void avdtp_source_finalize_stream_endpoint(avdtp_stream_endpoint_t * stream_endp
  */
 uint8_t avdtp_source_stream_send_media_packet(uint16_t avdtp_cid, uint8_t local_seid, const uint8_t * packet, uint16_t size);
 
+/**
+ * @brief Reserve outgoing packet buffer and get media payload location to write media payload, e.g. encoded SBC frames, in place
+ * @note  Only valid while handling AVDTP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW. Must be followed by avdtp_source_stream_send_reserved_media_payload
+ * @param avdtp_cid         AVDTP channel identifier.
+ * @param local_seid        ID of a local stream endpoint.
+ * @param max_payload_size  max size of media payload, without RTP header
+ * @return media payload in outgoing buffer or NULL if stream is not streaming or buffer is not available
+ */
+uint8_t * avdtp_source_stream_reserve_media_payload(uint16_t avdtp_cid, uint8_t local_seid, uint16_t * max_payload_size);
+
+/**
+ * @brief Add RTP header in front of reserved media payload and send it
+ * @note  Outgoing buffer is released if payload_size is 0 or media payload cannot be sent.
+ *        Returns ERROR_CODE_COMMAND_DISALLOWED if no media payload was reserved or stream is not streaming
+ * @param avdtp_cid         AVDTP channel identifier.
+ * @param local_seid        ID of a local stream endpoint.
+ * @param marker
+ * @param payload_size      size of media payload written into buffer from avdtp_source_stream_reserve_media_payload
+ * @return status
+ */
+uint8_t avdtp_source_stream_send_reserved_media_payload(uint16_t avdtp_cid, uint8_t local_seid, uint8_t marker, uint16_t payload_size);
+
 /**
  * @brief Send media payload including RTP header
  * @param avdtp_cid         AVDTP channel identifier.
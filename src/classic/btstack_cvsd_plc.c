@@ -52,94 +52,28 @@
 
 #include "btstack_cvsd_plc.h"
 #include "btstack_debug.h"
+#include "btstack_plc_core.h"
 
-// static float rcos[CVSD_OLAL] = {
-//     0.99148655f,0.96623611f,0.92510857f,0.86950446f,
-//     0.80131732f,0.72286918f,0.63683150f,0.54613418f, 
-//     0.45386582f,0.36316850f,0.27713082f,0.19868268f, 
-//     0.13049554f,0.07489143f,0.03376389f,0.00851345f};
-
-static float rcos[CVSD_OLAL] = {
-    0.99148655f,0.92510857f,
-    0.80131732f,0.63683150f, 
-    0.45386582f,0.27713082f, 
-    0.13049554f,0.03376389f};
+/* Raised COSine table for OLA in Q15 */
+static const uint16_t rcos[CVSD_OLAL] = {
+    32489, 30314,
+    26258, 20868,
+    14872,  9081,
+     4276,  1106};
 
 float btstack_cvsd_plc_rcos(int index){
     if (index >= CVSD_OLAL) return 0;
-    return rcos[index];
-}
-
-// taken from http://www.codeproject.com/Articles/69941/Best-Square-Root-Method-Algorithm-Function-Precisi
-// Algorithm: Babylonian Method + some manipulations on IEEE 32 bit floating point representation
-static float sqrt3(const float x){
-    union {
-        int i;
-        float x;
-    } u;
-    u.x = x;
-    u.i = (1<<29) + (u.i >> 1) - (1<<22); 
-
-    // Two Babylonian Steps (simplified from:)
-    // u.x = 0.5f * (u.x + x/u.x);
-    // u.x = 0.5f * (u.x + x/u.x);
-    u.x =       u.x + (x/u.x);
-    u.x = (0.25f*u.x) + (x/u.x);
-
-    return u.x;
-}
-
-static float btstack_cvsd_plc_absolute(float x){
-     if (x < 0) x = -x;
-     return x;
-}
-
-static float btstack_cvsd_plc_cross_correlation(BTSTACK_CVSD_PLC_SAMPLE_FORMAT *x, BTSTACK_CVSD_PLC_SAMPLE_FORMAT *y){
-    float num = 0;
-    float den = 0;
-    float x2 = 0;
-    float y2 = 0;
-    int   m;
-    for (m=0;m<CVSD_M;m++){
-        num+=((float)x[m])*y[m];
-        x2+=((float)x[m])*x[m];
-        y2+=((float)y[m])*y[m];
-    }
-    den = (float)sqrt3(x2*y2);
-    return num/den;
+    return (float) rcos[index] / BTSTACK_PLC_CORE_Q15_ONE;
 }
 
 int btstack_cvsd_plc_pattern_match(BTSTACK_CVSD_PLC_SAMPLE_FORMAT *y){
-    float maxCn = -999999.0;  // large negative number
-    int   bestmatch = 0;
-    float Cn;
-    int   n;
-    for (n=0;n<CVSD_N;n++){
-        Cn = btstack_cvsd_plc_cross_correlation(&y[CVSD_LHIST-CVSD_M], &y[n]); 
-        if (Cn>maxCn){
-            bestmatch=n;
-            maxCn = Cn; 
-        }
-    }
-    return bestmatch;
+    return btstack_plc_core_pattern_match(y, CVSD_N, &y[CVSD_LHIST-CVSD_M], CVSD_M);
 }
 
 float btstack_cvsd_plc_amplitude_match(btstack_cvsd_plc_state_t *plc_state, uint16_t num_samples, BTSTACK_CVSD_PLC_SAMPLE_FORMAT *y, BTSTACK_CVSD_PLC_SAMPLE_FORMAT bestmatch){
     UNUSED(plc_state);
-    int   i;
-    float sumx = 0;
-    float sumy = 0.000001f;
-    float sf;
-    
-    for (i=0;i<num_samples;i++){
-        sumx += btstack_cvsd_plc_absolute(y[CVSD_LHIST-num_samples+i]);
-        sumy += btstack_cvsd_plc_absolute(y[bestmatch+i]);
-    }
-    sf = sumx/sumy;
-    // This is not in the paper, but limit the scaling factor to something reasonable to avoid creating artifacts 
-    if (sf<0.75f) sf=0.75f;
-    if (sf>1.0) sf=1.0f;
-    return sf;
+    uint16_t sf = btstack_plc_core_amplitude_match(&y[CVSD_LHIST-num_samples], &y[bestmatch], num_samples);
+    return (float) sf / BTSTACK_PLC_CORE_Q15_ONE;
 }
 
 BTSTACK_CVSD_PLC_SAMPLE_FORMAT btstack_cvsd_plc_crop_sample(float val){
@@ -313,9 +247,8 @@ static void octave_fprintf_plot_output(btstack_cvsd_plc_state_t *plc_state, FILE
 #endif
 
 void btstack_cvsd_plc_bad_frame(btstack_cvsd_plc_state_t *plc_state, uint16_t num_samples, BTSTACK_CVSD_PLC_SAMPLE_FORMAT *out){
-    float val;
-    int   i;
-    float sf = 1;
+    int      i;
+    uint16_t sf;
     plc_state->nbf++;
     
     if (plc_state->max_consecutive_bad_frames_nr < plc_state->nbf){
@@ -339,22 +272,16 @@ void btstack_cvsd_plc_bad_frame(btstack_cvsd_plc_state_t *plc_state, uint16_t nu
         plc_state->bestlag += CVSD_M; 
         
         // Compute Scale Factor to Match Amplitude of Substitution Packet to that of Preceding Packet
-        sf = btstack_cvsd_plc_amplitude_match(plc_state, num_samples, plc_state->hist, plc_state->bestlag);
-        for (i=0; i<CVSD_OLAL; i++){
-            val = sf*plc_state->hist[plc_state->bestlag+i];
-            plc_state->hist[CVSD_LHIST+i] = btstack_cvsd_plc_crop_sample(val);
-        }
-        
-        for (i=CVSD_OLAL; i<num_samples; i++){
-            val = sf*plc_state->hist[plc_state->bestlag+i]; 
-            plc_state->hist[CVSD_LHIST+i] = btstack_cvsd_plc_crop_sample(val);
+        sf = btstack_plc_core_amplitude_match(&plc_state->hist[CVSD_LHIST-num_samples], &plc_state->hist[plc_state->bestlag], num_samples);
+        for (i=0; i<num_samples; i++){
+            plc_state->hist[CVSD_LHIST+i] = btstack_plc_core_scale_sample(plc_state->hist[plc_state->bestlag+i], sf);
         }
         
         for (i=num_samples; i<(num_samples+CVSD_OLAL); i++){
-            float left  = sf*plc_state->hist[plc_state->bestlag+i];
-            float right = plc_state->hist[plc_state->bestlag+i];
-            val = (left*rcos[i-num_samples]) + (right*rcos[CVSD_OLAL-1-i+num_samples]);
-            plc_state->hist[CVSD_LHIST+i] = btstack_cvsd_plc_crop_sample(val);
+            int16_t sample = plc_state->hist[plc_state->bestlag+i];
+            uint16_t left  = btstack_plc_core_scale_weight(rcos[i-num_samples], sf);
+            uint16_t right = rcos[CVSD_OLAL-1-i+num_samples];
+            plc_state->hist[CVSD_LHIST+i] = btstack_plc_core_mix_samples(sample, left, sample, right);
         }
 
         for (i=(num_samples+CVSD_OLAL); i<(num_samples+CVSD_RT+CVSD_OLAL); i++){
@@ -384,7 +311,6 @@ void btstack_cvsd_plc_bad_frame(btstack_cvsd_plc_state_t *plc_state, uint16_t nu
 }
 
 void btstack_cvsd_plc_good_frame(btstack_cvsd_plc_state_t *plc_state, uint16_t num_samples, BTSTACK_CVSD_PLC_SAMPLE_FORMAT *in, BTSTACK_CVSD_PLC_SAMPLE_FORMAT *out){
-    float val;
     int i = 0;
 #ifdef OCTAVE_OUTPUT
     FILE * oct_file = NULL;
@@ -401,10 +327,7 @@ void btstack_cvsd_plc_good_frame(btstack_cvsd_plc_state_t *plc_state, uint16_t n
         }
             
         for (i=CVSD_RT;i<(CVSD_RT+CVSD_OLAL);i++){
-            float left  = plc_state->hist[CVSD_LHIST+i];
-            float right = in[i];
-            val = (left * rcos[i-CVSD_RT]) + (right *rcos[CVSD_OLAL+CVSD_RT-1-i]);
-            out[i] = btstack_cvsd_plc_crop_sample((BTSTACK_CVSD_PLC_SAMPLE_FORMAT)val);
+            out[i] = btstack_plc_core_mix_samples(plc_state->hist[CVSD_LHIST+i], rcos[i-CVSD_RT], in[i], rcos[CVSD_OLAL+CVSD_RT-1-i]);
         }
     }
 
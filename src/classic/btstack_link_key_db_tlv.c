@@ -43,6 +43,7 @@
 #include "classic/btstack_link_key_db_tlv.h"
 
 #include "btstack_debug.h"
+#include "btstack_tlv.h"
 #include "btstack_util.h"
 #include "classic/core.h"
 
@@ -85,67 +86,83 @@ static void btstack_link_key_db_tlv_set_bd_addr(bd_addr_t bd_addr){
 static void btstack_link_key_db_tlv_close(void){ 
 }
 
-static int btstack_link_key_db_tlv_get_link_key(bd_addr_t bd_addr, link_key_t link_key, link_key_type_t * link_key_type) {
-    int i;
-    for (i=0;i<NVM_NUM_LINK_KEYS;i++){
-        link_key_nvm_t entry;
-        uint32_t tag = btstack_link_key_db_tag_for_index(i);
-        int size = self->btstack_tlv_impl->get_tag(self->btstack_tlv_context, tag, (uint8_t*) &entry, sizeof(entry));
-        if (size == 0) continue;
-        log_info("tag %x, addr %s", (unsigned int) tag, bd_addr_to_str(entry.bd_addr));
-        if (memcmp(bd_addr, entry.bd_addr, 6)) continue;
-        // found, pass back
-        (void)memcpy(link_key, entry.link_key, 16);
-        *link_key_type = entry.link_key_type;
-        return 1;
+// context for single pass over stored link keys
+typedef struct {
+    const uint8_t * bd_addr;
+    uint32_t tag_for_addr;
+    link_key_nvm_t entry_for_addr;
+    uint32_t highest_seq_nr;
+    uint32_t lowest_seq_nr;
+    uint32_t tag_for_lowest_seq_nr;
+    uint8_t  used[(NVM_NUM_LINK_KEYS + 7) / 8];
+} btstack_link_key_db_tlv_scan_t;
+
+static bool btstack_link_key_db_tlv_scan_handler(void * context, uint32_t tag, uint32_t value_size){
+    btstack_link_key_db_tlv_scan_t * scan = (btstack_link_key_db_tlv_scan_t *) context;
+    UNUSED(value_size);
+    link_key_nvm_t entry;
+    int size = self->btstack_tlv_impl->get_tag(self->btstack_tlv_context, tag, (uint8_t*) &entry, sizeof(entry));
+    if (size == 0) return true;
+    uint8_t index = (uint8_t) (tag & 0xffu);
+    scan->used[index >> 3] |= 1u << (index & 7u);
+    // found addr?
+    if (memcmp(scan->bd_addr, entry.bd_addr, 6) == 0){
+        scan->tag_for_addr = tag;
+        scan->entry_for_addr = entry;
+    }
+    // update highest seq nr
+    if (entry.seq_nr > scan->highest_seq_nr){
+        scan->highest_seq_nr = entry.seq_nr;
+    }
+    // find entry with lowest seq nr
+    if ((scan->tag_for_lowest_seq_nr == 0) || (entry.seq_nr < scan->lowest_seq_nr)){
+        scan->tag_for_lowest_seq_nr = tag;
+        scan->lowest_seq_nr = entry.seq_nr;
     }
-	return 0;
+    return true;
+}
+
+static void btstack_link_key_db_tlv_scan(btstack_link_key_db_tlv_scan_t * scan, const uint8_t * bd_addr){
+    memset(scan, 0, sizeof(btstack_link_key_db_tlv_scan_t));
+    scan->bd_addr = bd_addr;
+    btstack_tlv_iterate_tags(self->btstack_tlv_impl, self->btstack_tlv_context,
+                             btstack_link_key_db_tag_for_index(0), btstack_link_key_db_tag_for_index(NVM_NUM_LINK_KEYS - 1),
+                             &btstack_link_key_db_tlv_scan_handler, scan);
+}
+
+static int btstack_link_key_db_tlv_get_link_key(bd_addr_t bd_addr, link_key_t link_key, link_key_type_t * link_key_type) {
+    btstack_link_key_db_tlv_scan_t scan;
+    btstack_link_key_db_tlv_scan(&scan, bd_addr);
+    if (scan.tag_for_addr == 0) return 0;
+    // found, pass back
+    log_info("tag %x, addr %s", (unsigned int) scan.tag_for_addr, bd_addr_to_str(scan.entry_for_addr.bd_addr));
+    (void)memcpy(link_key, scan.entry_for_addr.link_key, 16);
+    *link_key_type = scan.entry_for_addr.link_key_type;
+    return 1;
 }
 
 static void btstack_link_key_db_tlv_delete_link_key(bd_addr_t bd_addr){
-    int i;
-    for (i=0;i<NVM_NUM_LINK_KEYS;i++){
-        link_key_nvm_t entry;
-        uint32_t tag = btstack_link_key_db_tag_for_index(i);
-        int size = self->btstack_tlv_impl->get_tag(self->btstack_tlv_context, tag, (uint8_t*) &entry, sizeof(entry));
-        if (size == 0) continue;
-        if (memcmp(bd_addr, entry.bd_addr, 6)) continue;
-        // found, delete tag
-        self->btstack_tlv_impl->delete_tag(self->btstack_tlv_context, tag);
-        break;
-    }
+    btstack_link_key_db_tlv_scan_t scan;
+    btstack_link_key_db_tlv_scan(&scan, bd_addr);
+    if (scan.tag_for_addr == 0) return;
+    // found, delete tag
+    self->btstack_tlv_impl->delete_tag(self->btstack_tlv_context, scan.tag_for_addr);
 }
 
 static void btstack_link_key_db_tlv_put_link_key(bd_addr_t bd_addr, link_key_t link_key, link_key_type_t link_key_type){
-    int i;
-    uint32_t highest_seq_nr = 0;
-    uint32_t lowest_seq_nr = 0;
-    uint32_t tag_for_lowest_seq_nr = 0;
-    uint32_t tag_for_addr = 0;
+    btstack_link_key_db_tlv_scan_t scan;
+    btstack_link_key_db_tlv_scan(&scan, bd_addr);
+
+    uint32_t highest_seq_nr = scan.highest_seq_nr;
+    uint32_t tag_for_lowest_seq_nr = scan.tag_for_lowest_seq_nr;
+    uint32_t tag_for_addr = scan.tag_for_addr;
     uint32_t tag_for_empty = 0;
 
+    // use last empty/deleted tag
+    int i;
     for (i=0;i<NVM_NUM_LINK_KEYS;i++){
-        link_key_nvm_t entry;
-        uint32_t tag = btstack_link_key_db_tag_for_index(i);
-        int size = self->btstack_tlv_impl->get_tag(self->btstack_tlv_context, tag, (uint8_t*) &entry, sizeof(entry));
-        // empty/deleted tag
-        if (size == 0) {
-            tag_for_empty = tag;
-            continue;
-        }
-        // found addr?
-        if (memcmp(bd_addr, entry.bd_addr, 6) == 0){
-            tag_for_addr = tag;
-        }
-        // update highest seq nr
-        if (entry.seq_nr > highest_seq_nr){
-            highest_seq_nr = entry.seq_nr;
-        }
-        // find entry with lowest seq nr
-        if ((tag_for_lowest_seq_nr == 0) || (entry.seq_nr < lowest_seq_nr)){
-            tag_for_lowest_seq_nr = tag;
-            lowest_seq_nr = entry.seq_nr;
-        }
+        if ((scan.used[i >> 3] & (1u << (i & 7))) != 0u) continue;
+        tag_for_empty = btstack_link_key_db_tag_for_index(i);
     }
 
     log_info("tag_for_addr %x, tag_for_empy %x, tag_for_lowest_seq_nr %x",
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "btstack_plc_core.c"
+
+/*
+ *  btstack_plc_core.c
+ *
+ *  The normalized cross-correlation num / sqrt(x2 * y2) is calculated as signed square num * |num| / (x2 * y2)
+ *  in Q30 from 30 bit mantissas of num and the energies, which avoids a square root for pattern matching.
+ *  The template energy is constant and the candidate energy is updated incrementally, so only one dot product
+ *  and one division are needed per candidate.
+ *
+ */
+
+#include "btstack_plc_core.h"
+
+#if !defined(BTSTACK_PLC_CORE_NO_SIMD) && defined(__SSE2__)
+#define BTSTACK_PLC_CORE_SSE2
+#include <emmintrin.h>
+#endif
+
+static int64_t btstack_plc_core_dot_product_scalar(const int16_t * x, const int16_t * y, uint16_t len){
+    int64_t sum = 0;
+    uint16_t i;
+    for (i = 0; i < len; i++){
+        sum += (int32_t) x[i] * y[i];
+    }
+    return sum;
+}
+
+#ifdef BTSTACK_PLC_CORE_SSE2
+int64_t btstack_plc_core_dot_product(const int16_t * x, const int16_t * y, uint16_t len){
+    const __m128i int32_min = _mm_set1_epi32(INT32_MIN);
+    __m128i sum = _mm_setzero_si128();
+    int64_t lanes[2];
+    uint16_t i;
+    for (i = 0; (i + 8u) <= len; i += 8u){
+        __m128i a = _mm_loadu_si128((const __m128i *) &x[i]);
+        __m128i b = _mm_loadu_si128((const __m128i *) &y[i]);
+        __m128i products = _mm_madd_epi16(a, b);
+        // sign extend pairwise sums to 64 bit. (-32768)^2 * 2 wraps to INT32_MIN, which cannot occur otherwise
+        __m128i sign = _mm_andnot_si128(_mm_cmpeq_epi32(products, int32_min), _mm_srai_epi32(products, 31));
+        sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(products, sign));
+        sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(products, sign));
+    }
+    _mm_storeu_si128((__m128i *) lanes, sum);
+    return lanes[0] + lanes[1] + btstack_plc_core_dot_product_scalar(&x[i], &y[i], len - i);
+}
+#else
+int64_t btstack_plc_core_dot_product(const int16_t * x, const int16_t * y, uint16_t len){
+    return btstack_plc_core_dot_product_scalar(x, y, len);
+}
+#endif
+
+static uint16_t btstack_plc_core_sqrt(uint32_t value){
+    uint32_t result = 0;
+    uint32_t bit = 1ul << 30;
+    while (bit > value){
+        bit >>= 2;
+    }
+    while (bit != 0u){
+        if (value >= (result + bit)){
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t) result;
+}
+
+static int8_t btstack_plc_core_bit_length(uint64_t value){
+    int8_t bits = 0;
+    int8_t step;
+    for (step = 32; step > 0; step >>= 1){
+        if ((value >> step) != 0u){
+            value >>= step;
+            bits += step;
+        }
+    }
+    return bits + (int8_t) value;
+}
+
+// value = mantissa * 2^exponent with mantissa in [2^29, 2^30), value > 0
+static uint32_t btstack_plc_core_normalize(uint64_t value, int8_t * exponent){
+    int8_t shift = btstack_plc_core_bit_length(value) - 30;
+    *exponent = shift;
+    return (uint32_t) ((shift >= 0) ? (value >> shift) : (value << -shift));
+}
+
+// sign(num) * num^2 / (x2 * y2) in Q30, with x2 given as normalized mantissa and exponent
+static int32_t btstack_plc_core_signed_square_correlation(int64_t num, uint32_t x_mantissa, int8_t x_exponent, uint64_t y2){
+    if ((num == 0) || (x_mantissa == 0u) || (y2 == 0u)) return 0;
+    int8_t num_exponent;
+    int8_t y_exponent;
+    uint32_t num_mantissa = btstack_plc_core_normalize((uint64_t) ((num < 0) ? -num : num), &num_exponent);
+    uint32_t y_mantissa   = btstack_plc_core_normalize(y2, &y_exponent);
+    // num_mantissa^2 / (x_mantissa * y_mantissa) in Q30 is in (2^28, 2^32)
+    uint64_t square = ((uint64_t) num_mantissa * num_mantissa) / (((uint64_t) x_mantissa * y_mantissa) >> 30);
+    int shift = (2 * num_exponent) - x_exponent - y_exponent;
+    // num^2 <= x2 * y2 limits shift to 2
+    if (shift >= 0){
+        square <<= shift;
+    } else if (shift > -64){
+        square >>= -shift;
+    } else {
+        square = 0;
+    }
+    if (square > (1ul << 30)){
+        square = 1ul << 30;
+    }
+    return (num < 0) ? -(int32_t) square : (int32_t) square;
+}
+
+int32_t btstack_plc_core_cross_correlation(const int16_t * x, const int16_t * y, uint16_t len){
+    int64_t  num = btstack_plc_core_dot_product(x, y, len);
+    uint64_t x2  = (uint64_t) btstack_plc_core_dot_product(x, x, len);
+    uint64_t y2  = (uint64_t) btstack_plc_core_dot_product(y, y, len);
+    if (x2 == 0u) return 0;
+    int8_t   x_exponent;
+    uint32_t x_mantissa = btstack_plc_core_normalize(x2, &x_exponent);
+    int32_t  square = btstack_plc_core_signed_square_correlation(num, x_mantissa, x_exponent, y2);
+    // sqrt of Q30 is Q15
+    return (square < 0) ? -(int32_t) btstack_plc_core_sqrt((uint32_t) -square) : (int32_t) btstack_plc_core_sqrt((uint32_t) square);
+}
+
+uint16_t btstack_plc_core_pattern_match(const int16_t * history, uint16_t num_candidates, const int16_t * template_samples, uint16_t template_len){
+    uint64_t x2 = (uint64_t) btstack_plc_core_dot_product(template_samples, template_samples, template_len);
+    uint64_t y2 = (uint64_t) btstack_plc_core_dot_product(history, history, template_len);
+    int8_t   x_exponent = 0;
+    uint32_t x_mantissa = 0;
+    if (x2 > 0u){
+        x_mantissa = btstack_plc_core_normalize(x2, &x_exponent);
+    }
+    int32_t  best_score = INT32_MIN;
+    uint16_t best_match = 0;
+    uint16_t n;
+    for (n = 0; n < num_candidates; n++){
+        if (n > 0u){
+            // slide candidate window by one sample
+            y2 -= (uint64_t) ((int32_t) history[n - 1u] * history[n - 1u]);
+            y2 += (uint64_t) ((int32_t) history[n + template_len - 1u] * history[n + template_len - 1u]);
+        }
+        int64_t num = btstack_plc_core_dot_product(template_samples, &history[n], template_len);
+        // candidates without positive correlation cannot beat a non-negative score
+        if ((num <= 0) && (best_score >= 0)) continue;
+        // signed square is monotonic in correlation, no square root needed
+        int32_t score = btstack_plc_core_signed_square_correlation(num, x_mantissa, x_exponent, y2);
+        if (score > best_score){
+            best_score = score;
+            best_match = n;
+        }
+    }
+    return best_match;
+}
+
+uint16_t btstack_plc_core_amplitude_match(const int16_t * reference, const int16_t * substitution, uint16_t len){
+    uint32_t sum_reference = 0;
+    uint32_t sum_substitution = 0;
+    uint16_t i;
+    for (i = 0; i < len; i++){
+        sum_reference    += (uint32_t) ((reference[i]    < 0) ? -reference[i]    : reference[i]);
+        sum_substitution += (uint32_t) ((substitution[i] < 0) ? -substitution[i] : substitution[i]);
+    }
+    if (sum_substitution == 0u){
+        return (sum_reference > 0u) ? BTSTACK_PLC_CORE_SCALE_FACTOR_MAX : BTSTACK_PLC_CORE_SCALE_FACTOR_MIN;
+    }
+    uint64_t scale_factor = ((uint64_t) sum_reference << 15) / sum_substitution;
+    if (scale_factor < BTSTACK_PLC_CORE_SCALE_FACTOR_MIN) return BTSTACK_PLC_CORE_SCALE_FACTOR_MIN;
+    if (scale_factor > BTSTACK_PLC_CORE_SCALE_FACTOR_MAX) return BTSTACK_PLC_CORE_SCALE_FACTOR_MAX;
+    return (uint16_t) scale_factor;
+}
+
+static int16_t btstack_plc_core_saturate(int32_t value){
+    if (value >  32767) return  32767;
+    if (value < -32768) return -32768;
+    return (int16_t) value;
+}
+
+int16_t btstack_plc_core_scale_sample(int16_t sample, uint16_t scale_factor){
+    return btstack_plc_core_saturate(((int32_t) sample * scale_factor + 0x4000) >> 15);
+}
+
+uint16_t btstack_plc_core_scale_weight(uint16_t weight, uint16_t scale_factor){
+    return (uint16_t) (((uint32_t) weight * scale_factor + 0x4000u) >> 15);
+}
+
+int16_t btstack_plc_core_mix_samples(int16_t a, uint16_t weight_a, int16_t b, uint16_t weight_b){
+    // weights up to 1.0 cannot overflow 32 bit
+    return btstack_plc_core_saturate(((int32_t) a * weight_a + (int32_t) b * weight_b + 0x4000) >> 15);
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title PLC Core
+ *
+ * Fixed-point kernels shared by CVSD and SBC Packet Loss Concealment: normalized cross-correlation
+ * for pattern matching, amplitude matching and overlap-add. Correlations and scale factors are in Q15.
+ *
+ * On x86 with SSE2, the dot product uses SIMD instructions, which can be disabled with
+ * BTSTACK_PLC_CORE_NO_SIMD. Both variants return exactly the same result.
+ *
+ */
+
+#ifndef BTSTACK_PLC_CORE_H
+#define BTSTACK_PLC_CORE_H
+
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// 1.0 in Q15
+#define BTSTACK_PLC_CORE_Q15_ONE 32768
+
+// amplitude match scale factor is limited to [0.75, 1.0] to avoid artifacts
+#define BTSTACK_PLC_CORE_SCALE_FACTOR_MIN 24576
+#define BTSTACK_PLC_CORE_SCALE_FACTOR_MAX BTSTACK_PLC_CORE_Q15_ONE
+
+/* API_START */
+
+/**
+ * @brief Calculate dot product of two sample vectors without overflow
+ * @param x
+ * @param y
+ * @param len
+ * @return sum of x[i] * y[i]
+ */
+int64_t btstack_plc_core_dot_product(const int16_t * x, const int16_t * y, uint16_t len);
+
+/**
+ * @brief Calculate normalized cross-correlation of two sample vectors
+ * @param x
+ * @param y
+ * @param len
+ * @return correlation in Q15, 0 if one vector is silent
+ */
+int32_t btstack_plc_core_cross_correlation(const int16_t * x, const int16_t * y, uint16_t len);
+
+/**
+ * @brief Find position in history with highest normalized cross-correlation to template
+ * @param history
+ * @param num_candidates positions checked, starting at history[0]
+ * @param template_samples
+ * @param template_len
+ * @return best matching position, first one if several candidates have the same correlation
+ */
+uint16_t btstack_plc_core_pattern_match(const int16_t * history, uint16_t num_candidates, const int16_t * template_samples, uint16_t template_len);
+
+/**
+ * @brief Calculate scale factor to match amplitude of substitution to that of reference
+ * @param reference
+ * @param substitution
+ * @param len
+ * @return scale factor in Q15, limited to [BTSTACK_PLC_CORE_SCALE_FACTOR_MIN, BTSTACK_PLC_CORE_SCALE_FACTOR_MAX]
+ */
+uint16_t btstack_plc_core_amplitude_match(const int16_t * reference, const int16_t * substitution, uint16_t len);
+
+/**
+ * @brief Scale sample with rounding and saturation
+ * @param sample
+ * @param scale_factor in Q15
+ * @return scaled sample
+ */
+int16_t btstack_plc_core_scale_sample(int16_t sample, uint16_t scale_factor);
+
+/**
+ * @brief Combine overlap-add weight with scale factor
+ * @param weight in Q15
+ * @param scale_factor in Q15
+ * @return weight * scale_factor in Q15
+ */
+uint16_t btstack_plc_core_scale_weight(uint16_t weight, uint16_t scale_factor);
+
+/**
+ * @brief Overlap-add two samples with rounding and saturation
+ * @param a
+ * @param weight_a in Q15
+ * @param b
+ * @param weight_b in Q15
+ * @return a * weight_a + b * weight_b
+ */
+int16_t btstack_plc_core_mix_samples(int16_t a, uint16_t weight_a, int16_t b, uint16_t weight_b);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // BTSTACK_PLC_CORE_H
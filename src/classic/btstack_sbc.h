@@ -92,6 +92,8 @@ typedef struct {
 /* BTstack SBC decoder */
 /**
  * @brief Init SBC decoder
+ * @note Uses shared decoder storage, only a single decoder can be used at a time.
+ *       See btstack_sbc_decoder_init_instance to decode multiple streams.
  * @param state
  * @param mode
  * @param callback for decoded PCM data in host endianess
@@ -128,6 +130,8 @@ int btstack_sbc_decoder_sample_rate(btstack_sbc_decoder_state_t * state);
 /* BTstack SBC Encoder */
 /**
  * @brief Init SBC encoder
+ * @note Uses shared encoder storage and registers state for the btstack_sbc_encoder_* functions below.
+ *       See btstack_sbc_encoder_init_instance to encode multiple streams.
  * @param state
  * @param mode 
  * @param blocks
@@ -147,6 +151,14 @@ void btstack_sbc_encoder_init(btstack_sbc_encoder_state_t * state, btstack_sbc_m
  */
 void btstack_sbc_encoder_process_data(int16_t * input_buffer);
 
+/**
+ * @brief Encode PCM data into given buffer instead of internal SBC frame buffer, e.g. into reserved A2DP media payload
+ * @note  Buffer must hold a complete SBC frame. Frame length is returned by btstack_sbc_encoder_sbc_buffer_length afterwards
+ * @param buffer with samples in host endianess
+ * @param sbc_buffer
+ */
+void btstack_sbc_encoder_process_data_to_buffer(int16_t * input_buffer, uint8_t * sbc_buffer);
+
 /**
  * @brief Return SBC frame
  */
@@ -163,9 +175,56 @@ uint16_t  btstack_sbc_encoder_sbc_buffer_length(void);
  */
 int  btstack_sbc_encoder_num_audio_frames(void);
 
+/**
+ * @brief Set bitpool for following SBC frames, e.g. to follow A2DP rate control
+ * @note  bitpool has to be within negotiated range. Ignored in mSBC mode
+ * @param bitpool
+ */
+void btstack_sbc_encoder_set_bitpool(int bitpool);
+
+/**
+ * @brief Encode PCM data with given encoder instance
+ * @param state
+ * @param buffer with samples in host endianess
+ */
+void btstack_sbc_encoder_instance_process_data(btstack_sbc_encoder_state_t * state, int16_t * input_buffer);
+
+/**
+ * @brief Encode PCM data with given encoder instance into given buffer
+ * @param state
+ * @param buffer with samples in host endianess
+ * @param sbc_buffer
+ */
+void btstack_sbc_encoder_instance_process_data_to_buffer(btstack_sbc_encoder_state_t * state, int16_t * input_buffer, uint8_t * sbc_buffer);
+
+/**
+ * @brief Return SBC frame of given encoder instance
+ * @param state
+ */
+uint8_t * btstack_sbc_encoder_instance_sbc_buffer(btstack_sbc_encoder_state_t * state);
+
+/**
+ * @brief Return SBC frame length of given encoder instance
+ * @param state
+ */
+uint16_t  btstack_sbc_encoder_instance_sbc_buffer_length(btstack_sbc_encoder_state_t * state);
+
+/**
+ * @brief Return number of audio frames required for one SBC packet of given encoder instance
+ * @param state
+ */
+int  btstack_sbc_encoder_instance_num_audio_frames(btstack_sbc_encoder_state_t * state);
+
+/**
+ * @brief Set bitpool for following SBC frames of given encoder instance
+ * @param state
+ * @param bitpool
+ */
+void btstack_sbc_encoder_instance_set_bitpool(btstack_sbc_encoder_state_t * state, int bitpool);
+
 /* API_END */
 
-// testing only
+// testing only, affects all decoder instances
 void btstack_sbc_decoder_test_set_plc_enabled(int plc_enabled);
 void btstack_sbc_decoder_test_simulate_corrupt_frames(int period);
 
@@ -57,6 +57,7 @@
 #include "btstack_debug.h"
 #include "btstack_util.h"
 #include "btstack_sbc.h"
+#include "btstack_sbc_decoder_bluedroid.h"
 #include "btstack_sbc_plc.h"
 
 #include "oi_codec_sbc.h"
@@ -64,27 +65,11 @@
 
 #define mSBC_SYNCWORD 0xad
 #define SBC_SYNCWORD 0x9c
-#define SBC_MAX_CHANNELS 2
 // #define LOG_FRAME_STATUS
 
-#define DECODER_DATA_SIZE (SBC_MAX_CHANNELS*SBC_MAX_BLOCKS*SBC_MAX_BANDS * 4 + SBC_CODEC_MIN_FILTER_BUFFERS*SBC_MAX_BANDS*SBC_MAX_CHANNELS * 2)
-
-typedef struct {
-    OI_UINT32 bytes_in_frame_buffer;
-    OI_CODEC_SBC_DECODER_CONTEXT decoder_context;
-
-    uint8_t   frame_buffer[SBC_MAX_FRAME_LEN];
-    int16_t   pcm_plc_data[SBC_MAX_CHANNELS * SBC_MAX_BANDS * SBC_MAX_BLOCKS];
-    int16_t   pcm_data[SBC_MAX_CHANNELS * SBC_MAX_BANDS * SBC_MAX_BLOCKS];
-    uint32_t  pcm_bytes;
-    OI_UINT32 decoder_data[(DECODER_DATA_SIZE+3)/4];
-    int       first_good_frame_found;
-    int       h2_sequence_nr;
-    uint16_t  msbc_bad_bytes;
-} bludroid_decoder_state_t;
-
+// storage for btstack_sbc_decoder_init
 static btstack_sbc_decoder_state_t * sbc_decoder_state_singleton = NULL;
-static bludroid_decoder_state_t bd_decoder_state;
+static btstack_sbc_decoder_bluedroid_t bd_decoder_state;
 
 // Testing only - START
 static int plc_enabled = 1;
@@ -143,17 +128,17 @@ static int find_h2_sync(const OI_BYTE *frame_data, OI_UINT32 frame_bytes, int *
 }
 
 int btstack_sbc_decoder_num_samples_per_frame(btstack_sbc_decoder_state_t * state){
-    bludroid_decoder_state_t * decoder_state = (bludroid_decoder_state_t *) state->decoder_state;
+    btstack_sbc_decoder_bluedroid_t * decoder_state = (btstack_sbc_decoder_bluedroid_t *) state->decoder_state;
     return decoder_state->decoder_context.common.frameInfo.nrof_blocks * decoder_state->decoder_context.common.frameInfo.nrof_subbands;
 }
 
 int btstack_sbc_decoder_num_channels(btstack_sbc_decoder_state_t * state){
-    bludroid_decoder_state_t * decoder_state = (bludroid_decoder_state_t *) state->decoder_state;
+    btstack_sbc_decoder_bluedroid_t * decoder_state = (btstack_sbc_decoder_bluedroid_t *) state->decoder_state;
     return decoder_state->decoder_context.common.frameInfo.nrof_channels;
 }
 
 int btstack_sbc_decoder_sample_rate(btstack_sbc_decoder_state_t * state){
-    bludroid_decoder_state_t * decoder_state = (bludroid_decoder_state_t *) state->decoder_state;
+    btstack_sbc_decoder_bluedroid_t * decoder_state = (btstack_sbc_decoder_bluedroid_t *) state->decoder_state;
     return decoder_state->decoder_context.common.frameInfo.frequency;
 }
 
@@ -163,18 +148,22 @@ void OI_AssertFail(const char* file, int line, const char* reason){
 }
 #endif
 
-void btstack_sbc_decoder_init(btstack_sbc_decoder_state_t * state, btstack_sbc_mode_t mode, void (*callback)(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context), void * context){
-    if (sbc_decoder_state_singleton && (sbc_decoder_state_singleton != state) ){
-        log_error("SBC decoder: different sbc decoder state already registered");
-    }
+void btstack_sbc_decoder_init_instance(btstack_sbc_decoder_state_t * state, btstack_sbc_decoder_bluedroid_t * decoder,
+                        btstack_sbc_mode_t mode, void (*callback)(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context), void * context){
+    btstack_assert(state != NULL);
+    btstack_assert(decoder != NULL);
+
+    // decoder reset does not clear the synthesis filter history in decoder_data
+    memset(decoder, 0, sizeof(btstack_sbc_decoder_bluedroid_t));
+
     OI_STATUS status = OI_STATUS_SUCCESS;
     switch (mode){
         case SBC_MODE_STANDARD:
             // note: we always request stereo output, even for mono input
-            status = OI_CODEC_SBC_DecoderReset(&(bd_decoder_state.decoder_context), bd_decoder_state.decoder_data, sizeof(bd_decoder_state.decoder_data), 2, 2, FALSE);
+            status = OI_CODEC_SBC_DecoderReset(&(decoder->decoder_context), decoder->decoder_data, sizeof(decoder->decoder_data), 2, 2, FALSE);
             break;
         case SBC_MODE_mSBC:
-            status = OI_CODEC_mSBC_DecoderReset(&(bd_decoder_state.decoder_context), bd_decoder_state.decoder_data, sizeof(bd_decoder_state.decoder_data));
+            status = OI_CODEC_mSBC_DecoderReset(&(decoder->decoder_context), decoder->decoder_data, sizeof(decoder->decoder_data));
             break;
         default:
             break;
@@ -184,22 +173,30 @@ void btstack_sbc_decoder_init(btstack_sbc_decoder_state_t * state, btstack_sbc_m
         log_error("SBC decoder: error during reset %d\n", status);
     }
 
-    sbc_decoder_state_singleton = state;
-
-    bd_decoder_state.bytes_in_frame_buffer = 0;
-    bd_decoder_state.pcm_bytes = sizeof(bd_decoder_state.pcm_data);
-    bd_decoder_state.h2_sequence_nr = -1;
-    bd_decoder_state.first_good_frame_found = 0;
+    decoder->bytes_in_frame_buffer = 0;
+    decoder->pcm_bytes = sizeof(decoder->pcm_data);
+    decoder->h2_sequence_nr = -1;
+    decoder->first_good_frame_found = 0;
+    decoder->msbc_bad_bytes = 0;
+    decoder->corrupt_frame_count = 0;
 
     memset(state, 0, sizeof(btstack_sbc_decoder_state_t));
     state->handle_pcm_data = callback;
     state->mode = mode;
     state->context = context;
-    state->decoder_state = &bd_decoder_state;
+    state->decoder_state = decoder;
     btstack_sbc_plc_init(&state->plc_state);
 }
 
-static void append_received_sbc_data(bludroid_decoder_state_t * state, uint8_t * buffer, int size){
+void btstack_sbc_decoder_init(btstack_sbc_decoder_state_t * state, btstack_sbc_mode_t mode, void (*callback)(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context), void * context){
+    if (sbc_decoder_state_singleton && (sbc_decoder_state_singleton != state) ){
+        log_error("SBC decoder: different sbc decoder state already registered");
+    }
+    sbc_decoder_state_singleton = state;
+    btstack_sbc_decoder_init_instance(state, &bd_decoder_state, mode, callback, context);
+}
+
+static void append_received_sbc_data(btstack_sbc_decoder_bluedroid_t * state, uint8_t * buffer, int size){
     int numFreeBytes = sizeof(state->frame_buffer) - state->bytes_in_frame_buffer;
 
     if (size > numFreeBytes){
@@ -211,20 +208,19 @@ static void append_received_sbc_data(bludroid_decoder_state_t * state, uint8_t *
     state->bytes_in_frame_buffer += size;
 }
 
-static void btstack_sbc_decoder_bluedroid_simulate_error(const OI_BYTE *frame_data) {
-    static int frame_count = 0;
+static void btstack_sbc_decoder_bluedroid_simulate_error(btstack_sbc_decoder_bluedroid_t * decoder_state, const OI_BYTE *frame_data) {
     if (corrupt_frame_period > 0){
-        frame_count++;
+        decoder_state->corrupt_frame_count++;
 
-        if ((frame_count % corrupt_frame_period) == 0){
+        if ((decoder_state->corrupt_frame_count % corrupt_frame_period) == 0){
             *(uint8_t*)&frame_data[5] = 0;
-            frame_count = 0;
+            decoder_state->corrupt_frame_count = 0;
         }
     }
 }
 
 static void btstack_sbc_decoder_process_sbc_data(btstack_sbc_decoder_state_t * state, uint8_t * buffer, int size){
-    bludroid_decoder_state_t * decoder_state = (bludroid_decoder_state_t*)state->decoder_state;
+    btstack_sbc_decoder_bluedroid_t * decoder_state = (btstack_sbc_decoder_bluedroid_t*)state->decoder_state;
     int input_bytes_to_process = size;
     int keep_decoding = 1;
 
@@ -250,7 +246,7 @@ static void btstack_sbc_decoder_process_sbc_data(btstack_sbc_decoder_state_t * s
         uint16_t bytes_processed = bytes_in_frame_buffer_before_decoding - frame_data_len;
 
         // testing only - corrupt frame periodically
-        btstack_sbc_decoder_bluedroid_simulate_error(frame_data);
+        btstack_sbc_decoder_bluedroid_simulate_error(decoder_state, frame_data);
 
         // Handle decoding result.
         switch(status){
@@ -302,7 +298,7 @@ static void btstack_sbc_decoder_process_sbc_data(btstack_sbc_decoder_state_t * s
                 // The codec apparently does not recover from this.
                 // Re-initialize the codec.
                 log_info("SBC decode: invalid parameters: resetting codec");
-                if (OI_CODEC_SBC_DecoderReset(&(bd_decoder_state.decoder_context), bd_decoder_state.decoder_data, sizeof(bd_decoder_state.decoder_data), 2, 2, FALSE) != OI_STATUS_SUCCESS){
+                if (OI_CODEC_SBC_DecoderReset(&(decoder_state->decoder_context), decoder_state->decoder_data, sizeof(decoder_state->decoder_data), 2, 2, FALSE) != OI_STATUS_SUCCESS){
                     log_info("SBC decode: resetting codec failed");
 
                 }
@@ -326,7 +322,7 @@ static void btstack_sbc_decoder_process_sbc_data(btstack_sbc_decoder_state_t * s
 
 
 static void btstack_sbc_decoder_insert_missing_frames(btstack_sbc_decoder_state_t *state) {
-    bludroid_decoder_state_t * decoder_state = (bludroid_decoder_state_t*)state->decoder_state;
+    btstack_sbc_decoder_bluedroid_t * decoder_state = (btstack_sbc_decoder_bluedroid_t*)state->decoder_state;
     const unsigned int MSBC_FRAME_SIZE = 60;
 
     while (decoder_state->first_good_frame_found && (decoder_state->msbc_bad_bytes >= MSBC_FRAME_SIZE)){
@@ -368,13 +364,13 @@ static void btstack_sbc_decoder_insert_missing_frames(btstack_sbc_decoder_state_
     }
 }
 
-static void btstack_sbc_decoder_drop_processed_bytes(bludroid_decoder_state_t * decoder_state, uint16_t bytes_processed){
+static void btstack_sbc_decoder_drop_processed_bytes(btstack_sbc_decoder_bluedroid_t * decoder_state, uint16_t bytes_processed){
     memmove(decoder_state->frame_buffer, decoder_state->frame_buffer + bytes_processed, decoder_state->bytes_in_frame_buffer-bytes_processed);
     decoder_state->bytes_in_frame_buffer -= bytes_processed;
 }
 
 static void btstack_sbc_decoder_process_msbc_data(btstack_sbc_decoder_state_t * state, int packet_status_flag, uint8_t * buffer, int size){
-    bludroid_decoder_state_t * decoder_state = (bludroid_decoder_state_t*)state->decoder_state;
+    btstack_sbc_decoder_bluedroid_t * decoder_state = (btstack_sbc_decoder_bluedroid_t*)state->decoder_state;
     int input_bytes_to_process = size;
     const unsigned int MSBC_FRAME_SIZE = 60;
 
@@ -398,7 +394,7 @@ static void btstack_sbc_decoder_process_msbc_data(btstack_sbc_decoder_state_t *
         const OI_BYTE *frame_data = decoder_state->frame_buffer;
 
         // testing only - corrupt frame periodically
-        btstack_sbc_decoder_bluedroid_simulate_error(frame_data);
+        btstack_sbc_decoder_bluedroid_simulate_error(decoder_state, frame_data);
 
         // assert frame looks like this: 01 x8 AD [rest of frame 56 bytes] 00
         int h2_syncword = 0;
@@ -509,7 +505,7 @@ static void btstack_sbc_decoder_process_msbc_data(btstack_sbc_decoder_state_t *
                 // The codec apparently does not recover from this.
                 // Re-initialize the codec.
                 log_info("SBC decode: invalid parameters: resetting codec");
-                if (OI_CODEC_mSBC_DecoderReset(&(bd_decoder_state.decoder_context), bd_decoder_state.decoder_data, sizeof(bd_decoder_state.decoder_data)) != OI_STATUS_SUCCESS){
+                if (OI_CODEC_mSBC_DecoderReset(&(decoder_state->decoder_context), decoder_state->decoder_data, sizeof(decoder_state->decoder_data)) != OI_STATUS_SUCCESS){
                     log_info("SBC decode: resetting codec failed");
                 }
                 break;
@@ -50,6 +50,7 @@
 #include <string.h>
 
 #include "btstack_sbc.h"
+#include "btstack_sbc_encoder_bluedroid.h"
 #include "btstack_sbc_plc.h"
 #include "btstack_debug.h"
 #include "btstack_util.h"
@@ -61,80 +62,82 @@
 #define SBC_MAX_CHANNELS 2
 // #define LOG_FRAME_STATUS
 
-
-typedef struct {
-    SBC_ENC_PARAMS context;
-    int num_data_bytes;
-    uint8_t sbc_packet[1000];
-} bludroid_encoder_state_t;
-
+// storage and state for btstack_sbc_encoder_init and btstack_sbc_encoder_* functions without state argument
 static btstack_sbc_encoder_state_t * sbc_encoder_state_singleton = NULL;
-static bludroid_encoder_state_t bd_encoder_state;
+static btstack_sbc_encoder_bluedroid_t bd_encoder_state;
 
+static SBC_ENC_PARAMS * btstack_sbc_encoder_get_context(btstack_sbc_encoder_state_t * state){
+    return &((btstack_sbc_encoder_bluedroid_t *)state->encoder_state)->context;
+}
 
-void btstack_sbc_encoder_init(btstack_sbc_encoder_state_t * state, btstack_sbc_mode_t mode, 
-                        int blocks, int subbands, btstack_sbc_allocation_method_t allocation_method, 
+void btstack_sbc_encoder_init_instance(btstack_sbc_encoder_state_t * state, btstack_sbc_encoder_bluedroid_t * encoder,
+                        btstack_sbc_mode_t mode, int blocks, int subbands, btstack_sbc_allocation_method_t allocation_method,
                         int sample_rate, int bitpool, btstack_sbc_channel_mode_t channel_mode){
 
-    if (sbc_encoder_state_singleton && (sbc_encoder_state_singleton != state) ){
-        log_error("SBC encoder: different sbc decoder state is allready registered");
-    } 
-    
-    sbc_encoder_state_singleton = state;
+    btstack_assert(state != NULL);
+    btstack_assert(encoder != NULL);
 
-    if (!sbc_encoder_state_singleton){
-        log_error("SBC encoder init: sbc state is NULL");
-    }
-
-    sbc_encoder_state_singleton->mode = mode;
+    state->mode = mode;
 
-    switch (sbc_encoder_state_singleton->mode){
+    switch (state->mode){
         case SBC_MODE_STANDARD:
-            bd_encoder_state.context.s16NumOfBlocks = blocks;                          
-            bd_encoder_state.context.s16NumOfSubBands = subbands;                       
-            bd_encoder_state.context.s16AllocationMethod = (uint8_t)allocation_method;                     
-            bd_encoder_state.context.s16BitPool = bitpool;  
-            bd_encoder_state.context.mSBCEnabled = 0;
-            bd_encoder_state.context.s16ChannelMode = (uint8_t)channel_mode;
-            bd_encoder_state.context.s16NumOfChannels = 2;
-            if (bd_encoder_state.context.s16ChannelMode == SBC_MONO){
-                bd_encoder_state.context.s16NumOfChannels = 1;
+            encoder->context.s16NumOfBlocks = blocks;
+            encoder->context.s16NumOfSubBands = subbands;
+            encoder->context.s16AllocationMethod = (uint8_t)allocation_method;
+            encoder->context.s16BitPool = bitpool;
+            encoder->context.mSBCEnabled = 0;
+            encoder->context.s16ChannelMode = (uint8_t)channel_mode;
+            encoder->context.s16NumOfChannels = 2;
+            if (encoder->context.s16ChannelMode == SBC_MONO){
+                encoder->context.s16NumOfChannels = 1;
             }
             switch(sample_rate){
-                case 16000: bd_encoder_state.context.s16SamplingFreq = SBC_sf16000; break;
-                case 32000: bd_encoder_state.context.s16SamplingFreq = SBC_sf32000; break;
-                case 44100: bd_encoder_state.context.s16SamplingFreq = SBC_sf44100; break;
-                case 48000: bd_encoder_state.context.s16SamplingFreq = SBC_sf48000; break;
-                default: bd_encoder_state.context.s16SamplingFreq = 0; break;
+                case 16000: encoder->context.s16SamplingFreq = SBC_sf16000; break;
+                case 32000: encoder->context.s16SamplingFreq = SBC_sf32000; break;
+                case 44100: encoder->context.s16SamplingFreq = SBC_sf44100; break;
+                case 48000: encoder->context.s16SamplingFreq = SBC_sf48000; break;
+                default: encoder->context.s16SamplingFreq = 0; break;
             }
             break;
         case SBC_MODE_mSBC:
-            bd_encoder_state.context.s16NumOfBlocks    = 15;
-            bd_encoder_state.context.s16NumOfSubBands  = 8;
-            bd_encoder_state.context.s16AllocationMethod = SBC_LOUDNESS;
-            bd_encoder_state.context.s16BitPool   = 26;
-            bd_encoder_state.context.s16ChannelMode = SBC_MONO;
-            bd_encoder_state.context.s16NumOfChannels = 1;
-            bd_encoder_state.context.mSBCEnabled = 1;
-            bd_encoder_state.context.s16SamplingFreq = SBC_sf16000;
+            encoder->context.s16NumOfBlocks    = 15;
+            encoder->context.s16NumOfSubBands  = 8;
+            encoder->context.s16AllocationMethod = SBC_LOUDNESS;
+            encoder->context.s16BitPool   = 26;
+            encoder->context.s16ChannelMode = SBC_MONO;
+            encoder->context.s16NumOfChannels = 1;
+            encoder->context.mSBCEnabled = 1;
+            encoder->context.s16SamplingFreq = SBC_sf16000;
             break;
         default:
             btstack_assert(false);
             break;
     }
-    bd_encoder_state.context.pu8Packet = bd_encoder_state.sbc_packet;
-    
-    sbc_encoder_state_singleton->encoder_state = &bd_encoder_state;
-    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
-    SBC_Encoder_Init(context);
+    encoder->context.pu8Packet = encoder->sbc_packet;
+
+    state->encoder_state = encoder;
+    SBC_Encoder_Init(&encoder->context);
 }
 
+void btstack_sbc_encoder_init(btstack_sbc_encoder_state_t * state, btstack_sbc_mode_t mode, 
+                        int blocks, int subbands, btstack_sbc_allocation_method_t allocation_method, 
+                        int sample_rate, int bitpool, btstack_sbc_channel_mode_t channel_mode){
+
+    if (sbc_encoder_state_singleton && (sbc_encoder_state_singleton != state) ){
+        log_error("SBC encoder: different sbc decoder state is allready registered");
+    } 
+    
+    sbc_encoder_state_singleton = state;
 
-void btstack_sbc_encoder_process_data(int16_t * input_buffer){
     if (!sbc_encoder_state_singleton){
-        log_error("SBC encoder: sbc state is NULL, call btstack_sbc_encoder_init to initialize it");
+        log_error("SBC encoder init: sbc state is NULL");
     }
-    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
+
+    btstack_sbc_encoder_init_instance(state, &bd_encoder_state, mode, blocks, subbands, allocation_method, sample_rate, bitpool, channel_mode);
+}
+
+void btstack_sbc_encoder_instance_process_data(btstack_sbc_encoder_state_t * state, int16_t * input_buffer){
+    SBC_ENC_PARAMS * context = btstack_sbc_encoder_get_context(state);
     context->ps16PcmBuffer = input_buffer;
     if (context->mSBCEnabled){
         context->pu8Packet[0] = 0xad;
@@ -142,17 +145,63 @@ void btstack_sbc_encoder_process_data(int16_t * input_buffer){
     SBC_Encoder(context);
 }
 
-int btstack_sbc_encoder_num_audio_frames(void){
-    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
+void btstack_sbc_encoder_instance_process_data_to_buffer(btstack_sbc_encoder_state_t * state, int16_t * input_buffer, uint8_t * sbc_buffer){
+    SBC_ENC_PARAMS * context = btstack_sbc_encoder_get_context(state);
+    // encode directly into sbc_buffer, then point to internal frame buffer again
+    context->pu8Packet = sbc_buffer;
+    btstack_sbc_encoder_instance_process_data(state, input_buffer);
+    context->pu8Packet = ((btstack_sbc_encoder_bluedroid_t *)state->encoder_state)->sbc_packet;
+}
+
+int btstack_sbc_encoder_instance_num_audio_frames(btstack_sbc_encoder_state_t * state){
+    SBC_ENC_PARAMS * context = btstack_sbc_encoder_get_context(state);
     return context->s16NumOfSubBands * context->s16NumOfBlocks;
 }
 
-uint8_t * btstack_sbc_encoder_sbc_buffer(void){
-    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
+void btstack_sbc_encoder_instance_set_bitpool(btstack_sbc_encoder_state_t * state, int bitpool){
+    SBC_ENC_PARAMS * context = btstack_sbc_encoder_get_context(state);
+    // mSBC uses fixed bitpool
+    if (context->mSBCEnabled) return;
+    // bitpool is read by bit allocation and packing for each frame
+    context->s16BitPool = (SINT16) bitpool;
+}
+
+uint8_t * btstack_sbc_encoder_instance_sbc_buffer(btstack_sbc_encoder_state_t * state){
+    SBC_ENC_PARAMS * context = btstack_sbc_encoder_get_context(state);
     return context->pu8Packet;
 }
 
-uint16_t  btstack_sbc_encoder_sbc_buffer_length(void){
-    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
+uint16_t btstack_sbc_encoder_instance_sbc_buffer_length(btstack_sbc_encoder_state_t * state){
+    SBC_ENC_PARAMS * context = btstack_sbc_encoder_get_context(state);
     return context->u16PacketLength;
 }
+
+void btstack_sbc_encoder_process_data(int16_t * input_buffer){
+    if (!sbc_encoder_state_singleton){
+        log_error("SBC encoder: sbc state is NULL, call btstack_sbc_encoder_init to initialize it");
+    }
+    btstack_sbc_encoder_instance_process_data(sbc_encoder_state_singleton, input_buffer);
+}
+
+void btstack_sbc_encoder_process_data_to_buffer(int16_t * input_buffer, uint8_t * sbc_buffer){
+    if (!sbc_encoder_state_singleton){
+        log_error("SBC encoder: sbc state is NULL, call btstack_sbc_encoder_init to initialize it");
+    }
+    btstack_sbc_encoder_instance_process_data_to_buffer(sbc_encoder_state_singleton, input_buffer, sbc_buffer);
+}
+
+int btstack_sbc_encoder_num_audio_frames(void){
+    return btstack_sbc_encoder_instance_num_audio_frames(sbc_encoder_state_singleton);
+}
+
+uint8_t * btstack_sbc_encoder_sbc_buffer(void){
+    return btstack_sbc_encoder_instance_sbc_buffer(sbc_encoder_state_singleton);
+}
+
+uint16_t  btstack_sbc_encoder_sbc_buffer_length(void){
+    return btstack_sbc_encoder_instance_sbc_buffer_length(sbc_encoder_state_singleton);
+}
+
+void btstack_sbc_encoder_set_bitpool(int bitpool){
+    btstack_sbc_encoder_instance_set_bitpool(sbc_encoder_state_singleton, bitpool);
+}
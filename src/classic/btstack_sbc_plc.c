@@ -52,6 +52,7 @@
 
 #include "btstack_sbc_plc.h"
 #include "btstack_debug.h"
+#include "btstack_plc_core.h"
 
 #define SAMPLE_FORMAT int16_t
 
@@ -66,92 +67,14 @@ static uint8_t indices0[] = {
     /*                padding            */   0x00, 0x00, 0x00
 };
 
-/* Raised COSine table for OLA */
-static float rcos[SBC_OLAL] = {
-    0.99148655f,0.96623611f,0.92510857f,0.86950446f,
-    0.80131732f,0.72286918f,0.63683150f,0.54613418f, 
-    0.45386582f,0.36316850f,0.27713082f,0.19868268f, 
-    0.13049554f,0.07489143f,0.03376389f,0.00851345f
+/* Raised COSine table for OLA in Q15 */
+static const uint16_t rcos[SBC_OLAL] = {
+    32489, 31662, 30314, 28492,
+    26258, 23687, 20868, 17896,
+    14872, 11900,  9081,  6510,
+     4276,  2454,  1106,   279
 };
 
-// taken from http://www.codeproject.com/Articles/69941/Best-Square-Root-Method-Algorithm-Function-Precisi
-// Algorithm: Babylonian Method + some manipulations on IEEE 32 bit floating point representation
-static float sqrt3(const float x){
-    union {
-        int i;
-        float x;
-    } u;
-    u.x = x;
-    u.i = (1<<29) + (u.i >> 1) - (1<<22); 
-
-    // Two Babylonian Steps (simplified from:)
-    // u.x = 0.5f * (u.x + x/u.x);
-    // u.x = 0.5f * (u.x + x/u.x);
-    u.x =       u.x + (x/u.x);
-    u.x = (0.25f*u.x) + (x/u.x);
-
-    return u.x;
-}
-
-static float absolute(float x){
-     if (x < 0) x = -x;
-     return x;
-}
-
-static float CrossCorrelation(SAMPLE_FORMAT *x, SAMPLE_FORMAT *y){
-    float num = 0;
-    float den = 0;
-    float x2 = 0;
-    float y2 = 0;
-    int   m;
-    for (m=0;m<SBC_M;m++){
-        num+=((float)x[m])*y[m];
-        x2+=((float)x[m])*x[m];
-        y2+=((float)y[m])*y[m];
-    }
-    den = (float)sqrt3(x2*y2);
-    return num/den;
-}
-
-static int PatternMatch(SAMPLE_FORMAT *y){
-    float maxCn = -999999.0;  // large negative number
-    int   bestmatch = 0;
-    float Cn;
-    int   n;
-    for (n=0;n<SBC_N;n++){
-        Cn = CrossCorrelation(&y[SBC_LHIST-SBC_M], &y[n]); 
-        if (Cn>maxCn){
-            bestmatch=n;
-            maxCn = Cn; 
-        }
-    }
-    return bestmatch;
-}
-
-static float AmplitudeMatch(SAMPLE_FORMAT *y, SAMPLE_FORMAT bestmatch) {
-    int   i;
-    float sumx = 0;
-    float sumy = 0.000001f;
-    float sf;
-    
-    for (i=0;i<SBC_FS;i++){
-        sumx += absolute(y[SBC_LHIST-SBC_FS+i]);
-        sumy += absolute(y[bestmatch+i]);
-    }
-    sf = sumx/sumy;
-    // This is not in the paper, but limit the scaling factor to something reasonable to avoid creating artifacts 
-    if (sf<0.75f) sf=0.75f;
-    if (sf>1.0f) sf=1.0f;
-    return sf;
-}
-
-static SAMPLE_FORMAT crop_sample(float val){
-    float croped_val = val;
-    if (croped_val > 32767.0)  croped_val= 32767.0;
-    if (croped_val < -32768.0) croped_val=-32768.0; 
-    return (SAMPLE_FORMAT) croped_val;
-}
-
 uint8_t * btstack_sbc_plc_zero_signal_frame(void){
     return (uint8_t *)&indices0;
 }
@@ -323,9 +246,8 @@ static void octave_fprintf_plot_output(btstack_sbc_plc_state_t *plc_state, FILE
 
 
 void btstack_sbc_plc_bad_frame(btstack_sbc_plc_state_t *plc_state, SAMPLE_FORMAT *ZIRbuf, SAMPLE_FORMAT *out){
-    float val;
-    int   i;
-    float sf = 1;
+    int      i;
+    uint16_t sf;
 
     plc_state->nbf++;   
     plc_state->bad_frames_nr++;
@@ -338,7 +260,7 @@ void btstack_sbc_plc_bad_frame(btstack_sbc_plc_state_t *plc_state, SAMPLE_FORMAT
     if (plc_state->nbf==1){
         // printf("first bad frame\n");
         // Perform pattern matching to find where to replicate
-        plc_state->bestlag = PatternMatch(plc_state->hist);
+        plc_state->bestlag = btstack_plc_core_pattern_match(plc_state->hist, SBC_N, &plc_state->hist[SBC_LHIST-SBC_M], SBC_M);
     }
 
 #ifdef OCTAVE_OUTPUT
@@ -353,26 +275,21 @@ void btstack_sbc_plc_bad_frame(btstack_sbc_plc_state_t *plc_state, SAMPLE_FORMAT
         plc_state->bestlag += SBC_M; 
         
         // Compute Scale Factor to Match Amplitude of Substitution Packet to that of Preceding Packet
-        sf = AmplitudeMatch(plc_state->hist, plc_state->bestlag);
-        // printf("sf Apmlitude Match %f, new data %d, bestlag+M %d\n", sf, ZIRbuf[0], plc_state->hist[plc_state->bestlag]);
+        sf = btstack_plc_core_amplitude_match(&plc_state->hist[SBC_LHIST-SBC_FS], &plc_state->hist[plc_state->bestlag], SBC_FS);
+        // printf("sf Apmlitude Match %u, new data %d, bestlag+M %d\n", sf, ZIRbuf[0], plc_state->hist[plc_state->bestlag]);
         for (i=0; i<SBC_OLAL; i++){
-            float left  = ZIRbuf[i];
-            float right = sf*plc_state->hist[plc_state->bestlag+i];
-            val = (left*rcos[i]) + (right*rcos[SBC_OLAL-1-i]);
-            // val = sf*plc_state->hist[plc_state->bestlag+i];
-            plc_state->hist[SBC_LHIST+i] = crop_sample(val);
+            uint16_t right = btstack_plc_core_scale_weight(rcos[SBC_OLAL-1-i], sf);
+            plc_state->hist[SBC_LHIST+i] = btstack_plc_core_mix_samples(ZIRbuf[i], rcos[i], plc_state->hist[plc_state->bestlag+i], right);
         }
         
         for (i=SBC_OLAL; i<SBC_FS; i++){
-            val = sf*plc_state->hist[plc_state->bestlag+i]; 
-            plc_state->hist[SBC_LHIST+i] = crop_sample(val);
+            plc_state->hist[SBC_LHIST+i] = btstack_plc_core_scale_sample(plc_state->hist[plc_state->bestlag+i], sf);
         }
         
         for (i=SBC_FS; i<(SBC_FS+SBC_OLAL); i++){
-            float left  = sf*plc_state->hist[plc_state->bestlag+i];
-            float right = plc_state->hist[plc_state->bestlag+i];
-            val = (left*rcos[i-SBC_FS])+(right*rcos[SBC_OLAL-1-i+SBC_FS]);
-            plc_state->hist[SBC_LHIST+i] = crop_sample(val);
+            int16_t sample = plc_state->hist[plc_state->bestlag+i];
+            uint16_t left  = btstack_plc_core_scale_weight(rcos[i-SBC_FS], sf);
+            plc_state->hist[SBC_LHIST+i] = btstack_plc_core_mix_samples(sample, left, sample, rcos[SBC_OLAL-1-i+SBC_FS]);
         }
 
         for (i=(SBC_FS+SBC_OLAL); i<(SBC_FS+SBC_RT+SBC_OLAL); i++){
@@ -402,7 +319,6 @@ void btstack_sbc_plc_bad_frame(btstack_sbc_plc_state_t *plc_state, SAMPLE_FORMAT
 }
 
 void btstack_sbc_plc_good_frame(btstack_sbc_plc_state_t *plc_state, SAMPLE_FORMAT *in, SAMPLE_FORMAT *out){
-    float val;
     int i = 0;
     plc_state->good_frames_nr++;
     plc_state->frame_count++;
@@ -423,10 +339,7 @@ void btstack_sbc_plc_good_frame(btstack_sbc_plc_state_t *plc_state, SAMPLE_FORMA
         }
             
         for (i = SBC_RT;i<(SBC_RT+SBC_OLAL);i++){
-            float left  = plc_state->hist[SBC_LHIST+i];
-            float right = in[i];  
-            val = (left*rcos[i-SBC_RT]) + (right*rcos[SBC_OLAL+SBC_RT-1-i]);
-            out[i] = crop_sample(val);
+            out[i] = btstack_plc_core_mix_samples(plc_state->hist[SBC_LHIST+i], rcos[i-SBC_RT], in[i], rcos[SBC_OLAL+SBC_RT-1-i]);
         }
     }
 
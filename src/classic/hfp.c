@@ -54,6 +54,7 @@
 #include "classic/sdp_server.h"
 #include "classic/sdp_util.h"
 #include "classic/sdp_client.h"
+#include "classic/hfp_at_command_trie.h"
 #include "hci.h"
 #include "hci_cmd.h"
 #include "hci_dump.h"
@@ -1081,73 +1082,6 @@ void hfp_handle_rfcomm_event(uint8_t packet_type, uint16_t channel, uint8_t *pac
 }
 // translates command string into hfp_command_t CMD
 
-typedef struct {
-    const char * command;
-    hfp_command_t command_id;
-} hfp_command_entry_t;
-
-static hfp_command_entry_t hfp_ag_commmand_table[] = {
-    { "AT+BAC=",   HFP_CMD_AVAILABLE_CODECS },
-    { "AT+BCC",    HFP_CMD_TRIGGER_CODEC_CONNECTION_SETUP },
-    { "AT+BCS=",   HFP_CMD_HF_CONFIRMED_CODEC },
-    { "AT+BIA=",   HFP_CMD_ENABLE_INDIVIDUAL_AG_INDICATOR_STATUS_UPDATE, }, // +BIA:<enabled>,,<enabled>,,,<enabled>
-    { "AT+BIEV=",  HFP_CMD_HF_INDICATOR_STATUS },
-    { "AT+BIND=",  HFP_CMD_LIST_GENERIC_STATUS_INDICATORS },
-    { "AT+BIND=?", HFP_CMD_RETRIEVE_GENERIC_STATUS_INDICATORS },
-    { "AT+BIND?",  HFP_CMD_RETRIEVE_GENERIC_STATUS_INDICATORS_STATE },
-    { "AT+BINP=",  HFP_CMD_HF_REQUEST_PHONE_NUMBER },
-    { "AT+BLDN",   HFP_CMD_REDIAL_LAST_NUMBER },
-    { "AT+BRSF=",  HFP_CMD_SUPPORTED_FEATURES },
-    { "AT+BTRH=",  HFP_CMD_RESPONSE_AND_HOLD_COMMAND },
-    { "AT+BTRH?",  HFP_CMD_RESPONSE_AND_HOLD_QUERY },
-    { "AT+BVRA=",  HFP_CMD_HF_ACTIVATE_VOICE_RECOGNITION },
-    { "AT+CCWA=",  HFP_CMD_ENABLE_CALL_WAITING_NOTIFICATION},
-    { "AT+CHLD=",  HFP_CMD_CALL_HOLD },
-    { "AT+CHLD=?", HFP_CMD_SUPPORT_CALL_HOLD_AND_MULTIPARTY_SERVICES },
-    { "AT+CHUP",   HFP_CMD_HANG_UP_CALL },
-    { "AT+CIND=?", HFP_CMD_RETRIEVE_AG_INDICATORS },
-    { "AT+CIND?",  HFP_CMD_RETRIEVE_AG_INDICATORS_STATUS },
-    { "AT+CLCC",   HFP_CMD_LIST_CURRENT_CALLS },
-    { "AT+CLIP=",  HFP_CMD_ENABLE_CLIP},
-    { "AT+CMEE=",  HFP_CMD_ENABLE_EXTENDED_AUDIO_GATEWAY_ERROR},
-    { "AT+CMER=",  HFP_CMD_ENABLE_INDICATOR_STATUS_UPDATE },
-    { "AT+CNUM",   HFP_CMD_GET_SUBSCRIBER_NUMBER_INFORMATION },
-    { "AT+COPS=",  HFP_CMD_QUERY_OPERATOR_SELECTION_NAME_FORMAT },
-    { "AT+COPS?",  HFP_CMD_QUERY_OPERATOR_SELECTION_NAME },
-    { "AT+NREC=",  HFP_CMD_TURN_OFF_EC_AND_NR, },
-    { "AT+VGM=",   HFP_CMD_SET_MICROPHONE_GAIN },
-    { "AT+VGS=",   HFP_CMD_SET_SPEAKER_GAIN },
-    { "AT+VTS=",   HFP_CMD_TRANSMIT_DTMF_CODES },
-    { "ATA",       HFP_CMD_CALL_ANSWERED },
-};
-
-static hfp_command_entry_t hfp_hf_commmand_table[] = {
-    { "+BCS:",  HFP_CMD_AG_SUGGESTED_CODEC },
-    { "+BIND:", HFP_CMD_SET_GENERIC_STATUS_INDICATOR_STATUS },
-    { "+BINP:", HFP_CMD_AG_SENT_PHONE_NUMBER },
-    { "+BRSF:", HFP_CMD_SUPPORTED_FEATURES },
-    { "+BSIR:", HFP_CMD_CHANGE_IN_BAND_RING_TONE_SETTING },
-    { "+BTRH:", HFP_CMD_RESPONSE_AND_HOLD_STATUS },
-    { "+BVRA:", HFP_CMD_AG_ACTIVATE_VOICE_RECOGNITION },
-    { "+CCWA:", HFP_CMD_AG_SENT_CALL_WAITING_NOTIFICATION_UPDATE, },
-    { "+CHLD:", HFP_CMD_SUPPORT_CALL_HOLD_AND_MULTIPARTY_SERVICES },
-    { "+CIEV:", HFP_CMD_TRANSFER_AG_INDICATOR_STATUS},
-    { "+CIND:", HFP_CMD_RETRIEVE_AG_INDICATORS_GENERIC },
-    { "+CLCC:", HFP_CMD_LIST_CURRENT_CALLS },
-    { "+CLIP:", HFP_CMD_AG_SENT_CLIP_INFORMATION },
-    { "+CME ERROR:", HFP_CMD_EXTENDED_AUDIO_GATEWAY_ERROR },
-    { "+CNUM:", HFP_CMD_GET_SUBSCRIBER_NUMBER_INFORMATION},
-    { "+COPS:", HFP_CMD_QUERY_OPERATOR_SELECTION_NAME },
-    { "+VGM:",  HFP_CMD_SET_MICROPHONE_GAIN },
-    { "+VGM=",  HFP_CMD_SET_MICROPHONE_GAIN },
-    { "+VGS:",  HFP_CMD_SET_SPEAKER_GAIN},
-    { "+VGS=",  HFP_CMD_SET_SPEAKER_GAIN},
-    { "ERROR",  HFP_CMD_ERROR},
-    { "NOP",    HFP_CMD_NONE}, // dummy command used by unit tests
-    { "OK",     HFP_CMD_OK },
-    { "RING",   HFP_CMD_RING },
-};
-
 static const hfp_custom_at_command_t * hfp_custom_command_lookup(const char * text){
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &hfp_custom_commands_ag);
@@ -1161,62 +1095,56 @@ static const hfp_custom_at_command_t * hfp_custom_command_lookup(const char * te
     return NULL;
 }
 
-static hfp_command_t parse_command(const char * line_buffer, int isHandsFree){
+// walk trie, returns exact match or command of longest matching prefix
+static hfp_command_t hfp_command_trie_lookup(const hfp_at_command_trie_node_t * trie, const char * text){
+    const hfp_at_command_trie_node_t * node = &trie[0];
+    uint8_t command = HFP_AT_COMMAND_TRIE_NO_COMMAND;
+    while (true){
+        if (node->prefix_command != HFP_AT_COMMAND_TRIE_NO_COMMAND){
+            command = node->prefix_command;
+        }
+        uint8_t character = (uint8_t) *text++;
+        if (character == 0){
+            if (node->command != HFP_AT_COMMAND_TRIE_NO_COMMAND){
+                command = node->command;
+            }
+            break;
+        }
+        // children are sorted by character
+        const hfp_at_command_trie_node_t * child = &trie[node->first_child];
+        const hfp_at_command_trie_node_t * end   = child + node->num_children;
+        while ((child < end) && (child->character < character)){
+            child++;
+        }
+        if ((child == end) || (child->character != character)) break;
+        node = child;
+    }
+    if (command == HFP_AT_COMMAND_TRIE_NO_COMMAND){
+        return HFP_CMD_NONE;
+    }
+    return (hfp_command_t) command;
+}
+
+static hfp_command_t parse_command(hfp_connection_t * hfp_connection, int isHandsFree){
+    const char * line_buffer = (const char *) hfp_connection->line_buffer;
 
     // check for custom commands, AG only
     if (isHandsFree == 0) {
         const hfp_custom_at_command_t * custom_at_command = hfp_custom_command_lookup(line_buffer);
         if (custom_at_command != NULL){
+            hfp_connection->ag_custom_at_command_id = custom_at_command->command_id;
             return HFP_CMD_CUSTOM_MESSAGE;
         }
     }
 
-    // table lookup based on role
-    uint16_t num_entries;
-    hfp_command_entry_t * table;
-    if (isHandsFree == 0){
-        table = hfp_ag_commmand_table;
-        num_entries = sizeof(hfp_ag_commmand_table) / sizeof(hfp_command_entry_t);
-    } else {
-        table = hfp_hf_commmand_table;
-        num_entries = sizeof(hfp_hf_commmand_table) / sizeof(hfp_command_entry_t);
-    }
-    // binary search
-    uint16_t left = 0;
-    uint16_t right = num_entries - 1;
-    while (left <= right){
-        uint16_t middle = left + (right - left) / 2;
-        hfp_command_entry_t *entry = &table[middle];
-        int match = strcmp(line_buffer, entry->command);
-        if (match < 0){
-            // search term is lower than middle element
-            if (right == 0) break;
-            right = middle - 1;
-        } else if (match == 0){
-            return entry->command_id;
-        } else {
-            // search term is higher than middle element
-            left = middle + 1;
-        }
-    }
-
+    // trie lookup based on role, also covers prefix matches on 'ATD' and valid looking, but unknown commands/responses
     // note: if parser in CMD_HEADER state would treats digits and maybe '+' as separator, match on "ATD" would work.
     // note: phone number is currently expected in line_buffer[3..]
-    // prefix match on 'ATD', AG only
-    if ((isHandsFree == 0) && (strncmp(line_buffer, HFP_CALL_PHONE_NUMBER, strlen(HFP_CALL_PHONE_NUMBER)) == 0)){
-        return HFP_CMD_CALL_PHONE_NUMBER;
-    }
-
-    // Valid looking, but unknown commands/responses
-    if ((isHandsFree == 0) && (strncmp(line_buffer, "AT+", 3) == 0)){
-        return HFP_CMD_UNKNOWN;
-    }
-
-    if ((isHandsFree != 0) && (strncmp(line_buffer, "+", 1) == 0)){
-        return HFP_CMD_UNKNOWN;
+    if (isHandsFree == 0){
+        return hfp_command_trie_lookup(hfp_ag_command_trie, line_buffer);
+    } else {
+        return hfp_command_trie_lookup(hfp_hf_command_trie, line_buffer);
     }
-
-    return HFP_CMD_NONE;
 }
 
 static void hfp_parser_store_byte(hfp_connection_t * hfp_connection, uint8_t byte){
@@ -1316,7 +1244,7 @@ static bool hfp_parse_byte(hfp_connection_t * hfp_connection, uint8_t byte, int
             if (hfp_parser_is_buffer_empty(hfp_connection)) return true;
 
             // parse
-            hfp_connection->command = parse_command((char *)hfp_connection->line_buffer, isHandsFree);
+            hfp_connection->command = parse_command(hfp_connection, isHandsFree);
 
             // pick +CIND version based on connection state: descriptions during SLC vs. states later
             if (hfp_connection->command == HFP_CMD_RETRIEVE_AG_INDICATORS_GENERIC){
@@ -1335,12 +1263,10 @@ static bool hfp_parse_byte(hfp_connection_t * hfp_connection, uint8_t byte, int
 
             log_info("command string '%s', handsfree %u -> cmd id %u", (char *)hfp_connection->line_buffer, isHandsFree, hfp_connection->command);
 
-            // store command id for custom command and just store rest of line
+            // command id for custom command stored by parse_command, just store rest of line
             if (hfp_connection->command == HFP_CMD_CUSTOM_MESSAGE){
-                const hfp_custom_at_command_t * at_command = hfp_custom_command_lookup((const char *)hfp_connection->line_buffer);
-                hfp_connection->ag_custom_at_command_id = at_command->command_id;
                 hfp_connection->parser_state = HFP_PARSER_CUSTOM_COMMAND;
-                return true;
+                return processed;
             }
 
             // next state
@@ -1493,6 +1419,50 @@ void hfp_parse(hfp_connection_t * hfp_connection, uint8_t byte, int isHandsFree)
     }
 }
 
+// number of bytes at the start of data that the current parser state would store without further processing
+static uint16_t hfp_parser_plain_run_length(hfp_connection_t * hfp_connection, const uint8_t * data, uint16_t size){
+    uint16_t len;
+    for (len = 0; len < size; len++){
+        uint8_t byte = data[len];
+        if ((byte == '"') || hfp_parser_is_end_of_line(byte)) break;
+        if (hfp_connection->parser_quoted) continue;
+        if (byte == ' ') break;
+        switch (hfp_connection->parser_state){
+            case HFP_PARSER_CUSTOM_COMMAND:
+                break;
+            case HFP_PARSER_CMD_SEQUENCE:
+            case HFP_PARSER_SECOND_ITEM:
+            case HFP_PARSER_THIRD_ITEM:
+                if ((byte == '(') || (byte == ')') || hfp_parser_is_separator(byte)) return len;
+                break;
+            default:
+                return len;
+        }
+    }
+    return len;
+}
+
+uint16_t hfp_parse_line(hfp_connection_t * hfp_connection, const uint8_t * data, uint16_t size, int isHandsFree){
+    uint16_t pos = 0;
+    while (pos < size){
+        // copy runs of plain bytes, e.g. quoted strings, arguments and custom commands, into line buffer
+        uint16_t len = hfp_parser_plain_run_length(hfp_connection, &data[pos], size - pos);
+        if (len > 0){
+            uint16_t space = (uint16_t) (HFP_MAX_VR_TEXT_SIZE - 1 - hfp_connection->line_size);
+            uint16_t bytes_to_store = btstack_min(len, space);
+            (void)memcpy(&hfp_connection->line_buffer[hfp_connection->line_size], &data[pos], bytes_to_store);
+            hfp_connection->line_size += bytes_to_store;
+            hfp_connection->line_buffer[hfp_connection->line_size] = 0;
+            pos += len;
+            continue;
+        }
+        uint8_t byte = data[pos++];
+        hfp_parse(hfp_connection, byte, isHandsFree);
+        if (hfp_parser_is_end_of_line(byte)) break;
+    }
+    return pos;
+}
+
 static void parse_sequence(hfp_connection_t * hfp_connection){
     int value;
     switch (hfp_connection->command){
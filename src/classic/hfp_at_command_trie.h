@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/*
+ * hfp_at_command_trie.h
+ *
+ * @brief Tries for AT commands (AG) and result codes (HF), included by hfp.c
+ *
+ * Generated by tool/hfp_at_command_trie_generator.py - do not edit
+ */
+
+#ifndef HFP_AT_COMMAND_TRIE_H
+#define HFP_AT_COMMAND_TRIE_H
+
+// children of a node are stored consecutively and sorted by character, node 0 is the root
+// command:        command id if the text ends at this node
+// prefix_command: command id if the text continues with a character that has no child
+typedef struct {
+    uint8_t character;
+    uint8_t first_child;
+    uint8_t num_children;
+    uint8_t command;
+    uint8_t prefix_command;
+} hfp_at_command_trie_node_t;
+
+#define HFP_AT_COMMAND_TRIE_NO_COMMAND 0xff
+
+// 95 nodes
+static const hfp_at_command_trie_node_t hfp_ag_command_trie[] = {
+    {   0,   1,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'A',   2,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'T',   3,  3, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '+',   6,  4, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_CMD_UNKNOWN },
+    { 'A',   0,  0, HFP_CMD_CALL_ANSWERED, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'D',   0,  0, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_CMD_CALL_PHONE_NUMBER },
+    { 'B',  10,  7, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  17,  7, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',  24,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'V',  25,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'A',  27,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  28,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'I',  30,  3, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'L',  33,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  34,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'T',  35,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'V',  36,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  37,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'H',  38,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'I',  40,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'L',  41,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'M',  43,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',  44,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'O',  45,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  46,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'G',  47,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'T',  49,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  50,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',   0,  0, HFP_CMD_TRIGGER_CODEC_CONNECTION_SETUP, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  51,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'A',  52,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'E',  53,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',  54,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'D',  56,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  57,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  58,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  59,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'W',  60,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'L',  61,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'U',  62,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',  63,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  64,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'I',  65,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'E',  66,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'U',  68,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'P',  69,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'E',  70,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'M',  71,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  72,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  73,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_AVAILABLE_CODECS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_HF_CONFIRMED_CODEC, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_ENABLE_INDIVIDUAL_AG_INDICATOR_STATUS_UPDATE, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'V',  74,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'D',  75,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'P',  77,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',   0,  0, HFP_CMD_REDIAL_LAST_NUMBER, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'F',  78,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'H',  79,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'A',  81,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'A',  82,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'D',  83,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'P',   0,  0, HFP_CMD_HANG_UP_CALL, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'D',  84,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',   0,  0, HFP_CMD_LIST_CURRENT_CALLS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'P',  86,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'E',  87,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  88,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'M',   0,  0, HFP_CMD_GET_SUBSCRIBER_NUMBER_INFORMATION, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  89,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  91,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_SET_MICROPHONE_GAIN, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_SET_SPEAKER_GAIN, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_TRANSMIT_DTMF_CODES, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_HF_INDICATOR_STATUS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',  92,  1, HFP_CMD_LIST_GENERIC_STATUS_INDICATORS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '?',   0,  0, HFP_CMD_RETRIEVE_GENERIC_STATUS_INDICATORS_STATE, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_HF_REQUEST_PHONE_NUMBER, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_SUPPORTED_FEATURES, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_RESPONSE_AND_HOLD_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '?',   0,  0, HFP_CMD_RESPONSE_AND_HOLD_QUERY, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_HF_ACTIVATE_VOICE_RECOGNITION, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_ENABLE_CALL_WAITING_NOTIFICATION, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',  93,  1, HFP_CMD_CALL_HOLD, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',  94,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '?',   0,  0, HFP_CMD_RETRIEVE_AG_INDICATORS_STATUS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_ENABLE_CLIP, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_ENABLE_EXTENDED_AUDIO_GATEWAY_ERROR, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_ENABLE_INDICATOR_STATUS_UPDATE, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_QUERY_OPERATOR_SELECTION_NAME_FORMAT, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '?',   0,  0, HFP_CMD_QUERY_OPERATOR_SELECTION_NAME, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_TURN_OFF_EC_AND_NR, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '?',   0,  0, HFP_CMD_RETRIEVE_GENERIC_STATUS_INDICATORS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '?',   0,  0, HFP_CMD_SUPPORT_CALL_HOLD_AND_MULTIPARTY_SERVICES, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '?',   0,  0, HFP_CMD_RETRIEVE_AG_INDICATORS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+};
+
+// 90 nodes
+static const hfp_at_command_trie_node_t hfp_hf_command_trie[] = {
+    {   0,   1,  5, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '+',   6,  3, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_CMD_UNKNOWN },
+    { 'E',   9,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',  10,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'O',  11,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  12,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'B',  13,  6, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  19,  7, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'V',  26,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  27,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'O',  28,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'K',   0,  0, HFP_CMD_OK, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'I',  29,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  30,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'I',  31,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  32,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  33,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'T',  34,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'V',  35,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  36,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'H',  37,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'I',  38,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'L',  40,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'M',  42,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',  43,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'O',  44,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'G',  45,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  47,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'P',   0,  0, HFP_CMD_NONE, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',  48,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  49,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',  50,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  52,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'I',  53,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  54,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  55,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'W',  56,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'L',  57,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'E',  58,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'N',  59,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  60,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'I',  61,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'E',  62,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'U',  63,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'P',  64,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'M',  65,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  67,  2, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'O',  69,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'G',   0,  0, HFP_CMD_RING, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_AG_SUGGESTED_CODEC, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'D',  70,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'P',  71,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'F',  72,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  73,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'H',  74,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'A',  75,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'A',  76,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'D',  77,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'V',  78,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'D',  79,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'C',  80,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'P',  81,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ' ',  82,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'M',  83,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'S',  84,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_SET_MICROPHONE_GAIN, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_SET_MICROPHONE_GAIN, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_SET_SPEAKER_GAIN, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { '=',   0,  0, HFP_CMD_SET_SPEAKER_GAIN, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',   0,  0, HFP_CMD_ERROR, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_SET_GENERIC_STATUS_INDICATOR_STATUS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_AG_SENT_PHONE_NUMBER, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_SUPPORTED_FEATURES, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_CHANGE_IN_BAND_RING_TONE_SETTING, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_RESPONSE_AND_HOLD_STATUS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_AG_ACTIVATE_VOICE_RECOGNITION, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_AG_SENT_CALL_WAITING_NOTIFICATION_UPDATE, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_SUPPORT_CALL_HOLD_AND_MULTIPARTY_SERVICES, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_TRANSFER_AG_INDICATOR_STATUS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_RETRIEVE_AG_INDICATORS_GENERIC, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_LIST_CURRENT_CALLS, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_AG_SENT_CLIP_INFORMATION, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'E',  85,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_GET_SUBSCRIBER_NUMBER_INFORMATION, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_QUERY_OPERATOR_SELECTION_NAME, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  86,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  87,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'O',  88,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { 'R',  89,  1, HFP_AT_COMMAND_TRIE_NO_COMMAND, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+    { ':',   0,  0, HFP_CMD_EXTENDED_AUDIO_GATEWAY_ERROR, HFP_AT_COMMAND_TRIE_NO_COMMAND },
+};
+
+#endif // HFP_AT_COMMAND_TRIE_H
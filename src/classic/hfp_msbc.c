@@ -51,74 +51,92 @@
 #include "btstack_sbc.h"
 #include "hfp_msbc.h"
 
-#define MSBC_FRAME_SIZE 57
-#define MSBC_HEADER_H2_SIZE 2
-#define MSBC_PADDING_SIZE 1
-#define MSBC_EXTRA_SIZE (MSBC_HEADER_H2_SIZE + MSBC_PADDING_SIZE)
-
 // const
 static const uint8_t hfp_msbc_header_h2_byte_0         = 1;
 static const uint8_t hfp_msbc_header_h2_byte_1_table[] = {0x08, 0x38, 0xc8, 0xf8 };
 
-static btstack_sbc_encoder_state_t hfp_msbc_state;
-static int hfp_msbc_msbc_sequence_number;
-
-static uint8_t hfp_msbc_buffer[2 * (MSBC_FRAME_SIZE + MSBC_EXTRA_SIZE)];
-static int hfp_msbc_buffer_offset = 0;
+// instance for hfp_msbc_* functions without instance argument
+static hfp_msbc_t hfp_msbc_singleton;
 
-void hfp_msbc_init(void){
-    btstack_sbc_encoder_init(&hfp_msbc_state, SBC_MODE_mSBC, 16, 8, SBC_ALLOCATION_METHOD_LOUDNESS, 16000, 26, SBC_CHANNEL_MODE_MONO);
-    hfp_msbc_buffer_offset = 0;
-    hfp_msbc_msbc_sequence_number = 0;
+void hfp_msbc_init_instance(hfp_msbc_t * msbc){
+    btstack_sbc_encoder_init_instance(&msbc->sbc_encoder_state, &msbc->sbc_encoder, SBC_MODE_mSBC, 16, 8, SBC_ALLOCATION_METHOD_LOUDNESS, 16000, 26, SBC_CHANNEL_MODE_MONO);
+    msbc->buffer_offset = 0;
+    msbc->msbc_sequence_number = 0;
 }
 
-void hfp_msbc_deinit(void){
-    (void) memset(&hfp_msbc_state, 0, sizeof(btstack_sbc_encoder_state_t));
-    hfp_msbc_msbc_sequence_number = 0;
-    hfp_msbc_buffer_offset = 0;
+void hfp_msbc_deinit_instance(hfp_msbc_t * msbc){
+    (void) memset(&msbc->sbc_encoder_state, 0, sizeof(btstack_sbc_encoder_state_t));
+    msbc->msbc_sequence_number = 0;
+    msbc->buffer_offset = 0;
 }
 
-int hfp_msbc_can_encode_audio_frame_now(void){
-    return (sizeof(hfp_msbc_buffer) - hfp_msbc_buffer_offset) >= (MSBC_FRAME_SIZE + MSBC_EXTRA_SIZE);
+int hfp_msbc_instance_can_encode_audio_frame_now(hfp_msbc_t * msbc){
+    return (sizeof(msbc->buffer) - msbc->buffer_offset) >= (HFP_MSBC_FRAME_SIZE + HFP_MSBC_EXTRA_SIZE);
 }
 
-void hfp_msbc_encode_audio_frame(int16_t * pcm_samples){
-    if (!hfp_msbc_can_encode_audio_frame_now()) return;
+void hfp_msbc_instance_encode_audio_frame(hfp_msbc_t * msbc, int16_t * pcm_samples){
+    if (!hfp_msbc_instance_can_encode_audio_frame_now(msbc)) return;
 
     // Synchronization Header H2
-    hfp_msbc_buffer[hfp_msbc_buffer_offset++] = hfp_msbc_header_h2_byte_0;
-    hfp_msbc_buffer[hfp_msbc_buffer_offset++] = hfp_msbc_header_h2_byte_1_table[hfp_msbc_msbc_sequence_number];
-    hfp_msbc_msbc_sequence_number = (hfp_msbc_msbc_sequence_number + 1) & 3;
+    msbc->buffer[msbc->buffer_offset++] = hfp_msbc_header_h2_byte_0;
+    msbc->buffer[msbc->buffer_offset++] = hfp_msbc_header_h2_byte_1_table[msbc->msbc_sequence_number];
+    msbc->msbc_sequence_number = (msbc->msbc_sequence_number + 1) & 3;
 
     // SBC Frame
-    btstack_sbc_encoder_process_data(pcm_samples);
-    (void)memcpy(hfp_msbc_buffer + hfp_msbc_buffer_offset,
-                 btstack_sbc_encoder_sbc_buffer(), MSBC_FRAME_SIZE);
-    hfp_msbc_buffer_offset += MSBC_FRAME_SIZE;
+    btstack_sbc_encoder_instance_process_data(&msbc->sbc_encoder_state, pcm_samples);
+    (void)memcpy(msbc->buffer + msbc->buffer_offset,
+                 btstack_sbc_encoder_instance_sbc_buffer(&msbc->sbc_encoder_state), HFP_MSBC_FRAME_SIZE);
+    msbc->buffer_offset += HFP_MSBC_FRAME_SIZE;
 
     // Final padding to use 60 bytes for 120 audio samples
-    hfp_msbc_buffer[hfp_msbc_buffer_offset++] = 0;
+    msbc->buffer[msbc->buffer_offset++] = 0;
 }
 
-void hfp_msbc_read_from_stream(uint8_t * buf, int size){
+void hfp_msbc_instance_read_from_stream(hfp_msbc_t * msbc, uint8_t * buf, int size){
     int bytes_to_copy = size;
-    if (size > hfp_msbc_buffer_offset){
-        bytes_to_copy = hfp_msbc_buffer_offset;
+    if (size > msbc->buffer_offset){
+        bytes_to_copy = msbc->buffer_offset;
         log_error("sbc frame storage is smaller then the output buffer");
         return;
     }
 
-    (void)memcpy(buf, hfp_msbc_buffer, bytes_to_copy);
-    memmove(hfp_msbc_buffer, hfp_msbc_buffer + bytes_to_copy, sizeof(hfp_msbc_buffer) - bytes_to_copy);
-    hfp_msbc_buffer_offset -= bytes_to_copy;
+    (void)memcpy(buf, msbc->buffer, bytes_to_copy);
+    memmove(msbc->buffer, msbc->buffer + bytes_to_copy, sizeof(msbc->buffer) - bytes_to_copy);
+    msbc->buffer_offset -= bytes_to_copy;
 }
 
-int hfp_msbc_num_bytes_in_stream(void){
-    return hfp_msbc_buffer_offset;
+int hfp_msbc_instance_num_bytes_in_stream(hfp_msbc_t * msbc){
+    return msbc->buffer_offset;
 }
 
-int hfp_msbc_num_audio_samples_per_frame(void){
-    return btstack_sbc_encoder_num_audio_frames();
+int hfp_msbc_instance_num_audio_samples_per_frame(hfp_msbc_t * msbc){
+    return btstack_sbc_encoder_instance_num_audio_frames(&msbc->sbc_encoder_state);
+}
+
+void hfp_msbc_init(void){
+    hfp_msbc_init_instance(&hfp_msbc_singleton);
+}
+
+void hfp_msbc_deinit(void){
+    hfp_msbc_deinit_instance(&hfp_msbc_singleton);
+}
+
+int hfp_msbc_can_encode_audio_frame_now(void){
+    return hfp_msbc_instance_can_encode_audio_frame_now(&hfp_msbc_singleton);
+}
+
+void hfp_msbc_encode_audio_frame(int16_t * pcm_samples){
+    hfp_msbc_instance_encode_audio_frame(&hfp_msbc_singleton, pcm_samples);
 }
 
+void hfp_msbc_read_from_stream(uint8_t * buf, int size){
+    hfp_msbc_instance_read_from_stream(&hfp_msbc_singleton, buf, size);
+}
 
+int hfp_msbc_num_bytes_in_stream(void){
+    return hfp_msbc_instance_num_bytes_in_stream(&hfp_msbc_singleton);
+}
+
+int hfp_msbc_num_audio_samples_per_frame(void){
+    return hfp_msbc_instance_num_audio_samples_per_frame(&hfp_msbc_singleton);
+}
@@ -47,10 +47,26 @@
 
 #include <stdint.h>
 
+#include "btstack_sbc.h"
+#include "btstack_sbc_encoder_bluedroid.h"
+
 #if defined __cplusplus
 extern "C" {
 #endif
 
+#define HFP_MSBC_FRAME_SIZE 57
+// H2 synchronization header and padding
+#define HFP_MSBC_EXTRA_SIZE 3
+
+typedef struct {
+    // private
+    btstack_sbc_encoder_state_t sbc_encoder_state;
+    btstack_sbc_encoder_bluedroid_t sbc_encoder;
+    int msbc_sequence_number;
+    uint8_t buffer[2 * (HFP_MSBC_FRAME_SIZE + HFP_MSBC_EXTRA_SIZE)];
+    int buffer_offset;
+} hfp_msbc_t;
+
 /* API_START */
 
 /**
@@ -90,6 +106,46 @@ void hfp_msbc_read_from_stream(uint8_t * buffer, int size);
  */
 void hfp_msbc_deinit(void);
 
+/**
+ * @brief Init HFP mSBC encoder instance, allows to encode multiple streams independently
+ * @param msbc
+ */
+void hfp_msbc_init_instance(hfp_msbc_t * msbc);
+
+/**
+ * @param msbc
+ */
+int  hfp_msbc_instance_num_audio_samples_per_frame(hfp_msbc_t * msbc);
+
+/**
+ * @param msbc
+ */
+int  hfp_msbc_instance_can_encode_audio_frame_now(hfp_msbc_t * msbc);
+
+/**
+ * @param msbc
+ * @param pcm_samples - complete audio frame of hfp_msbc_instance_num_audio_samples_per_frame int16 samples
+ */
+void hfp_msbc_instance_encode_audio_frame(hfp_msbc_t * msbc, int16_t * pcm_samples);
+
+/**
+ * @param msbc
+ */
+int  hfp_msbc_instance_num_bytes_in_stream(hfp_msbc_t * msbc);
+
+/**
+ * @param msbc
+ * @param buffer to store stream
+ * @param size num bytes to read from stream
+ */
+void hfp_msbc_instance_read_from_stream(hfp_msbc_t * msbc, uint8_t * buffer, int size);
+
+/**
+ * @brief De-Init HFP mSBC encoder instance
+ * @param msbc
+ */
+void hfp_msbc_deinit_instance(hfp_msbc_t * msbc);
+
 /* API_END */
 
 #if defined __cplusplus
@@ -53,6 +53,11 @@
 #include "hci_cmd.h"
 #include "l2cap.h"
 
+#ifdef ENABLE_SDP_CLIENT_CACHE
+#include "btstack_run_loop.h"
+#include "btstack_tlv.h"
+#endif
+
 // Types SDP Parser - Data Element stream helper
 typedef enum { 
     GET_LIST_LENGTH = 1,
@@ -65,7 +70,7 @@ typedef enum {
 
 // Types SDP Client 
 typedef enum {
-    INIT, W4_CONNECT, W2_SEND, W4_RESPONSE, QUERY_COMPLETE
+    INIT, W4_CONNECT, W2_SEND, W4_RESPONSE, QUERY_COMPLETE, W4_CACHE_REPLAY
 } sdp_client_state_t;
 
 static uint8_t sdp_client_des_attribute_id_list[] = {0x35, 0x05, 0x0A, 0x00, 0x00, 0xff, 0xff};  // Attribute: 0x0000 - 0xffff
@@ -88,6 +93,11 @@ static uint16_t sdp_client_setup_service_attribute_request(uint8_t * data);
 static void     sdp_client_parse_service_search_response(uint8_t* packet, uint16_t size);
 static void     sdp_client_parse_service_attribute_response(uint8_t* packet, uint16_t size);
 #endif
+#ifdef ENABLE_SDP_CLIENT_CACHE
+static void     sdp_client_cache_collect(const uint8_t * data, uint16_t size);
+static void     sdp_client_cache_handle_done(uint8_t status);
+static bool     sdp_client_cache_lookup(bd_addr_t remote, const uint8_t * des_service_search_pattern, const uint8_t * des_attribute_id_list);
+#endif
 
 // State DES Parser
 static de_state_t des_parser_de_header_state;
@@ -124,6 +134,79 @@ static uint32_t sdp_client_service_record_handle;
 static uint32_t sdp_client_record_handle;
 #endif
 
+#ifdef ENABLE_SDP_CLIENT_CACHE
+#ifndef SDP_CLIENT_CACHE_NUM_ENTRIES
+#define SDP_CLIENT_CACHE_NUM_ENTRIES 4
+#endif
+#ifndef SDP_CLIENT_CACHE_MAX_RESULT_SIZE
+#define SDP_CLIENT_CACHE_MAX_RESULT_SIZE 512
+#endif
+#ifndef SDP_CLIENT_CACHE_TIMEOUT_MS
+#define SDP_CLIENT_CACHE_TIMEOUT_MS (24u * 60u * 60u * 1000u)
+#endif
+#if SDP_CLIENT_CACHE_NUM_ENTRIES > 32
+#error "SDP_CLIENT_CACHE_NUM_ENTRIES must not exceed 32"
+#endif
+
+// service search pattern and attribute id list are copied for background verification
+#define SDP_CLIENT_CACHE_REQUEST_SIZE 64
+
+typedef enum {
+    SDP_CLIENT_CACHE_IDLE,
+    SDP_CLIENT_CACHE_REPLAY,        // query answered from cache
+    SDP_CLIENT_CACHE_COLLECT,       // query sent to remote, result gets stored
+    SDP_CLIENT_CACHE_VERIFY,        // expired result delivered, query sent to remote in background
+} sdp_client_cache_mode_t;
+
+typedef struct {
+    uint32_t  seq_nr;       // used for "least recently stored" eviction strategy
+    uint32_t  stored_ms;    // run loop time when stored or verified
+    bd_addr_t bd_addr;
+    uint16_t  result_len;   // size of AttributeLists
+    uint16_t  request_len;  // size of service search pattern and attribute id list
+    uint8_t   request[SDP_CLIENT_CACHE_REQUEST_SIZE];
+} sdp_client_cache_header_t;    // sizeof(sdp_client_cache_header_t) = 84 bytes
+
+// TLV value: header followed by AttributeLists of the ServiceSearchAttributeResponse(s)
+typedef struct {
+    sdp_client_cache_header_t header;
+    uint8_t result[SDP_CLIENT_CACHE_MAX_RESULT_SIZE];
+} sdp_client_cache_entry_t;
+
+// context for single pass over stored entries
+typedef struct {
+    const uint8_t * bd_addr;    // NULL matches all entries
+    const uint8_t * request;    // NULL matches no query
+    uint16_t request_len;
+    uint32_t tag_for_query;
+    uint32_t highest_seq_nr;
+    uint32_t lowest_seq_nr;
+    uint32_t tag_for_lowest_seq_nr;
+    uint32_t used;
+    uint32_t for_addr;
+} sdp_client_cache_scan_t;
+
+static const btstack_tlv_t * sdp_client_cache_tlv_impl;
+static void *                sdp_client_cache_tlv_context;
+
+static sdp_client_cache_mode_t sdp_client_cache_mode;
+static btstack_timer_source_t  sdp_client_cache_replay_timer;
+// replayed entries with expired or unknown age, verified when no other query is pending
+static uint32_t  sdp_client_cache_verify_requested;
+static bd_addr_t sdp_client_cache_bd_addr;
+static uint8_t   sdp_client_cache_request[SDP_CLIENT_CACHE_REQUEST_SIZE];
+static uint16_t  sdp_client_cache_request_len;
+// entry read from TLV, used for replay and to detect changes during verification
+static sdp_client_cache_entry_t sdp_client_cache_entry;
+// AttributeLists received from remote
+static uint8_t   sdp_client_cache_result[SDP_CLIENT_CACHE_MAX_RESULT_SIZE];
+static uint16_t  sdp_client_cache_result_len;
+static bool      sdp_client_cache_result_overflow;
+// entries stored or verified in this power cycle, older entries have unknown age
+static uint32_t  sdp_client_cache_stored_in_session;
+static sdp_client_cache_statistics_t sdp_client_cache_statistics;
+#endif
+
 // DES Parser
 void de_state_init(de_state_t * de_state){
     de_state->in_state_GET_DE_HEADER_LENGTH = 1;
@@ -303,6 +386,13 @@ void sdp_client_deinit(void){
     sdp_client_service_record_handle = 0;
     sdp_client_record_handle = 0;
 #endif
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    (void)btstack_run_loop_remove_timer(&sdp_client_cache_replay_timer);
+    sdp_client_cache_mode = SDP_CLIENT_CACHE_IDLE;
+    sdp_client_cache_verify_requested = 0;
+    sdp_client_cache_stored_in_session = 0;
+    sdp_client_cache_reset_statistics();
+#endif
 }
 
 // for testing only
@@ -358,26 +448,319 @@ static void sdp_client_notify_callbacks(void){
     (*callback->callback)(callback->context);
 }
 
-void sdp_parser_handle_done(uint8_t status){
-    // reset state
-    sdp_client_state = INIT;
+#ifdef ENABLE_SDP_CLIENT_CACHE
+static void sdp_client_cache_verify_next(void);
+#endif
 
-    // emit query complete event
+static void sdp_parser_emit_query_complete(uint8_t status){
     uint8_t event[3];
     event[0] = SDP_EVENT_QUERY_COMPLETE;
     event[1] = 1;
     event[2] = status;
-    (*sdp_parser_callback)(HCI_EVENT_PACKET, 0, event, sizeof(event)); 
+    (*sdp_parser_callback)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+void sdp_parser_handle_done(uint8_t status){
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    sdp_client_cache_handle_done(status);
+#endif
+
+    // reset state
+    sdp_client_state = INIT;
+
+    // emit query complete event
+    sdp_parser_emit_query_complete(status);
 
     // trigger next query if pending
     sdp_client_notify_callbacks();
+
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    // verify replayed results after all pending queries
+    sdp_client_cache_verify_next();
+#endif
+}
+
+#ifdef ENABLE_SDP_CLIENT_CACHE
+
+static uint32_t sdp_client_cache_tag_for_index(uint8_t index){
+    return ((uint32_t) 'S' << 24) | ((uint32_t) 'D' << 16) | ((uint32_t) 'C' << 8) | index;
+}
+
+static bool sdp_client_cache_scan_handler(void * context, uint32_t tag, uint32_t value_size){
+    sdp_client_cache_scan_t * scan = (sdp_client_cache_scan_t *) context;
+    UNUSED(value_size);
+    sdp_client_cache_header_t header;
+    int size = sdp_client_cache_tlv_impl->get_tag(sdp_client_cache_tlv_context, tag, (uint8_t *) &header, sizeof(header));
+    if (size != (int) sizeof(header)) return true;
+    uint8_t index = (uint8_t) (tag & 0xffu);
+    scan->used |= 1u << index;
+    // found addr?
+    if ((scan->bd_addr == NULL) || (memcmp(scan->bd_addr, header.bd_addr, 6) == 0)){
+        scan->for_addr |= 1u << index;
+        // compare full request
+        if ((scan->request != NULL) && (header.request_len == scan->request_len) &&
+            (memcmp(header.request, scan->request, scan->request_len) == 0)){
+            scan->tag_for_query = tag;
+        }
+    }
+    // update highest seq nr
+    if (header.seq_nr > scan->highest_seq_nr){
+        scan->highest_seq_nr = header.seq_nr;
+    }
+    // find entry with lowest seq nr
+    if ((scan->tag_for_lowest_seq_nr == 0) || (header.seq_nr < scan->lowest_seq_nr)){
+        scan->tag_for_lowest_seq_nr = tag;
+        scan->lowest_seq_nr = header.seq_nr;
+    }
+    return true;
+}
+
+static void sdp_client_cache_scan(sdp_client_cache_scan_t * scan, const uint8_t * bd_addr, const uint8_t * request, uint16_t request_len){
+    memset(scan, 0, sizeof(sdp_client_cache_scan_t));
+    scan->bd_addr = bd_addr;
+    scan->request = request;
+    scan->request_len = request_len;
+    btstack_tlv_iterate_tags(sdp_client_cache_tlv_impl, sdp_client_cache_tlv_context,
+                             sdp_client_cache_tag_for_index(0), sdp_client_cache_tag_for_index(SDP_CLIENT_CACHE_NUM_ENTRIES - 1),
+                             &sdp_client_cache_scan_handler, scan);
+}
+
+static bool sdp_client_cache_available(void){
+    btstack_tlv_get_instance(&sdp_client_cache_tlv_impl, &sdp_client_cache_tlv_context);
+    return sdp_client_cache_tlv_impl != NULL;
+}
+
+static void sdp_client_cache_delete_tag(uint32_t tag){
+    sdp_client_cache_stored_in_session &= ~(1u << (tag & 0xffu));
+    sdp_client_cache_verify_requested  &= ~(1u << (tag & 0xffu));
+    sdp_client_cache_tlv_impl->delete_tag(sdp_client_cache_tlv_context, tag);
+}
+
+static void sdp_client_cache_delete_entries(uint32_t entries){
+    uint8_t i;
+    for (i = 0; i < SDP_CLIENT_CACHE_NUM_ENTRIES; i++){
+        if ((entries & (1u << i)) == 0u) continue;
+        sdp_client_cache_delete_tag(sdp_client_cache_tag_for_index(i));
+    }
+}
+
+static void sdp_client_cache_store(void){
+    sdp_client_cache_scan_t scan;
+    sdp_client_cache_scan(&scan, sdp_client_cache_bd_addr, sdp_client_cache_request, sdp_client_cache_request_len);
+
+    // use entry for query, empty entry, or least recently stored entry
+    uint32_t tag_to_use = scan.tag_for_query;
+    if (tag_to_use == 0){
+        uint8_t i;
+        for (i = 0; i < SDP_CLIENT_CACHE_NUM_ENTRIES; i++){
+            if ((scan.used & (1u << i)) != 0u) continue;
+            tag_to_use = sdp_client_cache_tag_for_index(i);
+            break;
+        }
+    }
+    if (tag_to_use == 0){
+        tag_to_use = scan.tag_for_lowest_seq_nr;
+    }
+    if (tag_to_use == 0){
+        // should not happen
+        return;
+    }
+
+    sdp_client_cache_entry.header.seq_nr = scan.highest_seq_nr + 1;
+    sdp_client_cache_entry.header.request_len = sdp_client_cache_request_len;
+    (void)memcpy(sdp_client_cache_entry.header.request, sdp_client_cache_request, sdp_client_cache_request_len);
+    sdp_client_cache_entry.header.stored_ms = btstack_run_loop_get_time_ms();
+    (void)memcpy(sdp_client_cache_entry.header.bd_addr, sdp_client_cache_bd_addr, 6);
+    sdp_client_cache_entry.header.result_len = sdp_client_cache_result_len;
+    (void)memcpy(sdp_client_cache_entry.result, sdp_client_cache_result, sdp_client_cache_result_len);
+
+    log_info("store %u bytes for %s with tag %x", sdp_client_cache_result_len, bd_addr_to_str(sdp_client_cache_bd_addr), (unsigned int) tag_to_use);
+    int result = sdp_client_cache_tlv_impl->store_tag(sdp_client_cache_tlv_context, tag_to_use, (uint8_t *) &sdp_client_cache_entry,
+                                                      sizeof(sdp_client_cache_header_t) + sdp_client_cache_result_len);
+    if (result != 0){
+        log_error("store query result failed");
+        return;
+    }
+    sdp_client_cache_stored_in_session |= 1u << (tag_to_use & 0xffu);
+}
+
+static void sdp_client_cache_collect(const uint8_t * data, uint16_t size){
+    if ((sdp_client_cache_mode != SDP_CLIENT_CACHE_COLLECT) && (sdp_client_cache_mode != SDP_CLIENT_CACHE_VERIFY)) return;
+    if (sdp_client_cache_result_overflow) return;
+    if ((sdp_client_cache_result_len + size) > SDP_CLIENT_CACHE_MAX_RESULT_SIZE){
+        sdp_client_cache_result_overflow = true;
+        return;
+    }
+    (void)memcpy(&sdp_client_cache_result[sdp_client_cache_result_len], data, size);
+    sdp_client_cache_result_len += size;
+}
+
+static void sdp_client_cache_handle_done(uint8_t status){
+    sdp_client_cache_mode_t mode = sdp_client_cache_mode;
+    sdp_client_cache_mode = SDP_CLIENT_CACHE_IDLE;
+    switch (mode){
+        case SDP_CLIENT_CACHE_COLLECT:
+            if ((status != ERROR_CODE_SUCCESS) || sdp_client_cache_result_overflow) break;
+            sdp_client_cache_store();
+            break;
+        case SDP_CLIENT_CACHE_VERIFY:
+            if ((status != ERROR_CODE_SUCCESS) || sdp_client_cache_result_overflow){
+                // remove entry, next query goes to remote device
+                sdp_client_cache_scan_t scan;
+                sdp_client_cache_scan(&scan, sdp_client_cache_bd_addr, sdp_client_cache_request, sdp_client_cache_request_len);
+                if (scan.tag_for_query == 0) break;
+                log_info("verification failed with status 0x%02x, remove entry", status);
+                sdp_client_cache_delete_tag(scan.tag_for_query);
+                sdp_client_cache_statistics.invalidations++;
+                break;
+            }
+            if ((sdp_client_cache_result_len != sdp_client_cache_entry.header.result_len) ||
+                (memcmp(sdp_client_cache_result, sdp_client_cache_entry.result, sdp_client_cache_result_len) != 0)){
+                log_info("verification found different result");
+                sdp_client_cache_statistics.changes++;
+            }
+            // store to refresh timestamp
+            sdp_client_cache_store();
+            break;
+        default:
+            break;
+    }
+}
+
+static void sdp_client_cache_verify_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    // result is collected by sdp_client_parse_attribute_lists and handled by sdp_client_cache_handle_done
+    UNUSED(packet_type);
+    UNUSED(channel);
+    UNUSED(packet);
+    UNUSED(size);
+}
+
+static void sdp_client_cache_start_verification(void){
+    uint16_t pattern_len = (uint16_t) de_get_len(sdp_client_cache_request);
+    sdp_parser_init(&sdp_client_cache_verify_handler);
+    sdp_client_service_search_pattern = &sdp_client_cache_request[0];
+    sdp_client_attribute_id_list = &sdp_client_cache_request[pattern_len];
+    sdp_client_continuation_state_len = 0;
+    sdp_client_pdu_id = SDP_ServiceSearchAttributeResponse;
+    sdp_client_cache_mode = SDP_CLIENT_CACHE_VERIFY;
+    sdp_client_cache_result_len = 0;
+    sdp_client_cache_result_overflow = false;
+    sdp_client_cache_statistics.verifications++;
+
+    sdp_client_state = W4_CONNECT;
+    uint8_t status = l2cap_create_channel(sdp_client_packet_handler, sdp_client_cache_bd_addr, BLUETOOTH_PSM_SDP, l2cap_max_mtu(), NULL);
+    if (status != ERROR_CODE_SUCCESS){
+        sdp_parser_handle_done(status);
+    }
+}
+
+static void sdp_client_cache_verify_next(void){
+    while (sdp_client_ready() && (sdp_client_cache_verify_requested != 0u)){
+        uint8_t index = 0;
+        while ((sdp_client_cache_verify_requested & (1u << index)) == 0u){
+            index++;
+        }
+        sdp_client_cache_verify_requested &= ~(1u << index);
+        if (sdp_client_cache_available() == false) return;
+
+        // entry may have been replaced or removed since replay
+        int size = sdp_client_cache_tlv_impl->get_tag(sdp_client_cache_tlv_context, sdp_client_cache_tag_for_index(index),
+                                                      (uint8_t *) &sdp_client_cache_entry, sizeof(sdp_client_cache_entry));
+        if (size < (int) sizeof(sdp_client_cache_header_t)) continue;
+        (void)memcpy(sdp_client_cache_bd_addr, sdp_client_cache_entry.header.bd_addr, 6);
+        (void)memcpy(sdp_client_cache_request, sdp_client_cache_entry.header.request, sdp_client_cache_entry.header.request_len);
+        sdp_client_cache_request_len = sdp_client_cache_entry.header.request_len;
+        sdp_client_cache_start_verification();
+    }
+}
+
+static void sdp_client_cache_replay_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    sdp_parser_handle_chunk(sdp_client_cache_entry.result, sdp_client_cache_entry.header.result_len);
+    sdp_client_cache_mode = SDP_CLIENT_CACHE_IDLE;
+    sdp_parser_handle_done(ERROR_CODE_SUCCESS);
 }
 
+// @return true if query is answered from cache
+static bool sdp_client_cache_lookup(bd_addr_t remote, const uint8_t * des_service_search_pattern, const uint8_t * des_attribute_id_list){
+    sdp_client_cache_mode = SDP_CLIENT_CACHE_IDLE;
+    if (sdp_client_cache_available() == false) return false;
+
+    uint16_t pattern_len = (uint16_t) de_get_len(des_service_search_pattern);
+    uint16_t attribute_id_list_len = (uint16_t) de_get_len(des_attribute_id_list);
+    if ((pattern_len + attribute_id_list_len) > SDP_CLIENT_CACHE_REQUEST_SIZE) return false;
+    (void)memcpy(&sdp_client_cache_request[0], des_service_search_pattern, pattern_len);
+    (void)memcpy(&sdp_client_cache_request[pattern_len], des_attribute_id_list, attribute_id_list_len);
+    sdp_client_cache_request_len = pattern_len + attribute_id_list_len;
+    (void)memcpy(sdp_client_cache_bd_addr, remote, 6);
+
+    sdp_client_cache_scan_t scan;
+    sdp_client_cache_scan(&scan, remote, sdp_client_cache_request, sdp_client_cache_request_len);
+    if (scan.tag_for_query != 0){
+        int size = sdp_client_cache_tlv_impl->get_tag(sdp_client_cache_tlv_context, scan.tag_for_query,
+                                                      (uint8_t *) &sdp_client_cache_entry, sizeof(sdp_client_cache_entry));
+        if ((size >= (int) sizeof(sdp_client_cache_header_t)) &&
+            (sdp_client_cache_entry.header.result_len == (size - (int) sizeof(sdp_client_cache_header_t)))){
+            uint32_t now = btstack_run_loop_get_time_ms();
+            bool stored_in_session = (sdp_client_cache_stored_in_session & (1u << (scan.tag_for_query & 0xffu))) != 0u;
+            bool verify = (stored_in_session == false) ||
+                          ((now - sdp_client_cache_entry.header.stored_ms) >= SDP_CLIENT_CACHE_TIMEOUT_MS);
+            if (verify){
+                sdp_client_cache_verify_requested |= 1u << (scan.tag_for_query & 0xffu);
+            }
+            sdp_client_cache_statistics.hits++;
+            log_info("query answered from cache, verify %u", (int) verify);
+
+            // deliver result from run loop
+            sdp_client_cache_mode = SDP_CLIENT_CACHE_REPLAY;
+            sdp_client_state = W4_CACHE_REPLAY;
+            btstack_run_loop_set_timer_handler(&sdp_client_cache_replay_timer, &sdp_client_cache_replay_handler);
+            btstack_run_loop_set_timer(&sdp_client_cache_replay_timer, 0);
+            btstack_run_loop_add_timer(&sdp_client_cache_replay_timer);
+            return true;
+        }
+        // invalid entry
+        sdp_client_cache_delete_tag(scan.tag_for_query);
+    }
+
+    sdp_client_cache_statistics.misses++;
+    sdp_client_cache_mode = SDP_CLIENT_CACHE_COLLECT;
+    sdp_client_cache_result_len = 0;
+    sdp_client_cache_result_overflow = false;
+    return false;
+}
+
+void sdp_client_cache_remove(bd_addr_t remote){
+    if (sdp_client_cache_available() == false) return;
+    sdp_client_cache_scan_t scan;
+    sdp_client_cache_scan(&scan, remote, NULL, 0);
+    sdp_client_cache_delete_entries(scan.for_addr);
+}
+
+void sdp_client_cache_flush(void){
+    if (sdp_client_cache_available() == false) return;
+    sdp_client_cache_scan_t scan;
+    sdp_client_cache_scan(&scan, NULL, NULL, 0);
+    sdp_client_cache_delete_entries(scan.used);
+}
+
+void sdp_client_cache_get_statistics(sdp_client_cache_statistics_t * statistics){
+    *statistics = sdp_client_cache_statistics;
+}
+
+void sdp_client_cache_reset_statistics(void){
+    memset(&sdp_client_cache_statistics, 0, sizeof(sdp_client_cache_statistics));
+}
+#endif
+
 // SDP Client
 
 // TODO: inline if not needed (des(des))
 
 static void sdp_client_parse_attribute_lists(uint8_t* packet, uint16_t length){
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    sdp_client_cache_collect(packet, length);
+#endif
     sdp_parser_handle_chunk(packet, length);
 }
 
@@ -753,6 +1136,12 @@ uint8_t sdp_client_query(btstack_packet_handler_t callback, bd_addr_t remote, co
     sdp_client_continuation_state_len = 0;
     sdp_client_pdu_id = SDP_ServiceSearchAttributeResponse;
 
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    if (sdp_client_cache_lookup(remote, des_service_search_pattern, des_attribute_id_list)){
+        return ERROR_CODE_SUCCESS;
+    }
+#endif
+
     sdp_client_state = W4_CONNECT;
     return l2cap_create_channel(sdp_client_packet_handler, remote, BLUETOOTH_PSM_SDP, l2cap_max_mtu(), NULL);
 }
@@ -776,6 +1165,9 @@ uint8_t sdp_client_service_attribute_search(btstack_packet_handler_t callback, b
     sdp_client_attribute_id_list = des_attribute_id_list;
     sdp_client_continuation_state_len = 0;
     sdp_client_pdu_id = SDP_ServiceAttributeResponse;
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    sdp_client_cache_mode = SDP_CLIENT_CACHE_IDLE;
+#endif
 
     sdp_client_state = W4_CONNECT;
     l2cap_create_channel(sdp_client_packet_handler, remote, BLUETOOTH_PSM_SDP, l2cap_max_mtu(), NULL);
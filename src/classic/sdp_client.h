@@ -60,6 +60,14 @@ typedef struct de_state {
     uint32_t de_offset;
 } de_state_t; 
 
+typedef struct {
+    uint32_t hits;              // queries answered from cache
+    uint32_t misses;            // queries sent to remote device
+    uint32_t verifications;     // background queries for expired entries
+    uint32_t changes;           // verifications that found a different result
+    uint32_t invalidations;     // entries removed after failed query
+} sdp_client_cache_statistics_t;
+
 void de_state_init(de_state_t * state);
 int  de_state_size(uint8_t eventByte, de_state_t *de_state);
 
@@ -89,6 +97,10 @@ uint8_t sdp_client_register_query_callback(btstack_context_callback_registration
  * @param remote address
  * @param des_service_search_pattern 
  * @param des_attribute_id_list
+ * @note with ENABLE_SDP_CLIENT_CACHE, results are stored in TLV per remote device. Cached results are delivered without
+ *       connecting to the remote device. Results older than SDP_CLIENT_CACHE_TIMEOUT_MS or from a previous power cycle
+ *       are delivered as well and then verified by a background query, which updates or removes the entry.
+ *       Background queries run after queries registered with sdp_client_register_query_callback.
  */
 uint8_t sdp_client_query(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern, const uint8_t * des_attribute_id_list);
 
@@ -126,6 +138,31 @@ uint8_t sdp_client_service_attribute_search(btstack_packet_handler_t callback, b
  */
 uint8_t sdp_client_service_search(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern);
 
+#ifdef ENABLE_SDP_CLIENT_CACHE
+/**
+ * @brief Remove all cached query results for remote device
+ * @note called by gap_drop_link_key_for_bd_addr. Call e.g. when a service of the remote device is known to have changed
+ * @param remote address
+ */
+void sdp_client_cache_remove(bd_addr_t remote);
+
+/**
+ * @brief Remove all cached query results
+ */
+void sdp_client_cache_flush(void);
+
+/**
+ * @brief Get SDP Client cache statistics
+ * @param statistics
+ */
+void sdp_client_cache_get_statistics(sdp_client_cache_statistics_t * statistics);
+
+/**
+ * @brief Reset SDP Client cache statistics
+ */
+void sdp_client_cache_reset_statistics(void);
+#endif
+
 #ifdef ENABLE_SDP_EXTRA_QUERIES
 void sdp_client_parse_service_record_handle_list(uint8_t* packet, uint16_t total_count, uint16_t current_count);
 #endif
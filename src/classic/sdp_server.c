@@ -84,6 +84,12 @@ static uint16_t sdp_server_response_size;
 static uint16_t sdp_server_l2cap_waiting_list_cids[SDP_WAITING_LIST_MAX_COUNT];
 static int      sdp_server_l2cap_waiting_list_count;
 
+// optional UUID index, sorted by key
+static sdp_server_uuid_index_entry_t * sdp_server_uuid_index;
+static uint16_t sdp_server_uuid_index_size;
+static uint16_t sdp_server_uuid_index_count;
+static bool     sdp_server_uuid_index_valid;
+
 void sdp_init(void){
     sdp_server_next_service_record_handle = ((uint32_t) MAX_RESERVED_SERVICE_RECORD_HANDLE) + 2;
     // register with l2cap psm sevices - max MTU
@@ -95,6 +101,10 @@ void sdp_deinit(void){
     sdp_server_l2cap_cid = 0;
     sdp_server_response_size = 0;
     sdp_server_l2cap_waiting_list_count = 0;
+    sdp_server_uuid_index = NULL;
+    sdp_server_uuid_index_size = 0;
+    sdp_server_uuid_index_count = 0;
+    sdp_server_uuid_index_valid = false;
 }
 
 uint32_t sdp_get_service_record_handle(const uint8_t * record){
@@ -133,6 +143,156 @@ uint32_t sdp_create_service_record_handle(void){
     return handle;
 }
 
+// MARK: UUID index
+
+// first entry with key >= given key
+static uint16_t sdp_server_uuid_index_lower_bound(uint32_t key){
+    uint16_t left  = 0;
+    uint16_t right = sdp_server_uuid_index_count;
+    while (left < right){
+        uint16_t middle = left + ((right - left) / 2u);
+        if (sdp_server_uuid_index[middle].key < key){
+            left = middle + 1u;
+        } else {
+            right = middle;
+        }
+    }
+    return left;
+}
+
+static bool sdp_server_uuid_index_entry_matches(const sdp_server_uuid_index_entry_t * entry, const uint8_t * uuid128){
+    uint8_t entry_uuid128[16];
+    (void) de_get_normalized_uuid(entry_uuid128, entry->uuid);
+    return memcmp(entry_uuid128, uuid128, 16) == 0;
+}
+
+static bool sdp_server_uuid_index_add(service_record_item_t * item, const uint8_t * uuid){
+    uint8_t uuid128[16];
+    if (!de_get_normalized_uuid(uuid128, uuid)) return true;
+    uint32_t key = big_endian_read_32(uuid128, 0);
+    uint16_t pos = sdp_server_uuid_index_lower_bound(key);
+    // skip entries with same key, UUIDs are stored only once per record
+    while ((pos < sdp_server_uuid_index_count) && (sdp_server_uuid_index[pos].key == key)){
+        const sdp_server_uuid_index_entry_t * entry = &sdp_server_uuid_index[pos];
+        if ((entry->item == item) && sdp_server_uuid_index_entry_matches(entry, uuid128)) return true;
+        pos++;
+    }
+    if (sdp_server_uuid_index_count == sdp_server_uuid_index_size) return false;
+    (void) memmove(&sdp_server_uuid_index[pos + 1u], &sdp_server_uuid_index[pos], (sdp_server_uuid_index_count - pos) * sizeof(sdp_server_uuid_index_entry_t));
+    sdp_server_uuid_index[pos].key  = key;
+    sdp_server_uuid_index[pos].uuid = uuid;
+    sdp_server_uuid_index[pos].item = item;
+    sdp_server_uuid_index_count++;
+    return true;
+}
+
+// add all UUIDs contained in data element sequence, including nested sequences
+static bool sdp_server_uuid_index_add_sequence(service_record_item_t * item, uint8_t * element){
+    des_iterator_t des_it;
+    if (!des_iterator_init(&des_it, element)) return true;
+    for ( ; des_iterator_has_more(&des_it) ; des_iterator_next(&des_it)){
+        uint8_t * child = des_iterator_get_element(&des_it);
+        bool ok = true;
+        switch (des_iterator_get_type(&des_it)){
+            case DE_UUID:
+                ok = sdp_server_uuid_index_add(item, child);
+                break;
+            case DE_DES:
+                ok = sdp_server_uuid_index_add_sequence(item, child);
+                break;
+            default:
+                break;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static void sdp_server_uuid_index_add_record(service_record_item_t * item){
+    if (!sdp_server_uuid_index_valid) return;
+    if (sdp_server_uuid_index_add_sequence(item, item->service_record)) return;
+    log_error("UUID index full, %u entries", sdp_server_uuid_index_size);
+    sdp_server_uuid_index_valid = false;
+}
+
+static void sdp_server_uuid_index_remove_record(service_record_item_t * item){
+    if (!sdp_server_uuid_index_valid) return;
+    uint16_t pos_read;
+    uint16_t pos_write = 0;
+    for (pos_read = 0; pos_read < sdp_server_uuid_index_count; pos_read++){
+        if (sdp_server_uuid_index[pos_read].item == item) continue;
+        sdp_server_uuid_index[pos_write++] = sdp_server_uuid_index[pos_read];
+    }
+    sdp_server_uuid_index_count = pos_write;
+}
+
+void sdp_server_enable_uuid_index(sdp_server_uuid_index_entry_t * storage, uint16_t num_entries){
+    sdp_server_uuid_index = storage;
+    sdp_server_uuid_index_size = num_entries;
+    sdp_server_uuid_index_count = 0;
+    sdp_server_uuid_index_valid = true;
+    btstack_linked_item_t *it;
+    for (it = (btstack_linked_item_t *) sdp_server_service_records; it ; it = it->next){
+        sdp_server_uuid_index_add_record((service_record_item_t *) it);
+    }
+    log_info("UUID index: %u entries, valid %u", sdp_server_uuid_index_count, sdp_server_uuid_index_valid);
+}
+
+// set search_match for all service records
+static void sdp_server_match_service_search_pattern(uint8_t * serviceSearchPattern){
+    btstack_linked_item_t *it;
+
+    if (!sdp_server_uuid_index_valid){
+        for (it = (btstack_linked_item_t *) sdp_server_service_records; it ; it = it->next){
+            service_record_item_t * item = (service_record_item_t *) it;
+            item->search_match = sdp_record_matches_service_search_pattern(item->service_record, serviceSearchPattern) != 0;
+        }
+        return;
+    }
+
+    for (it = (btstack_linked_item_t *) sdp_server_service_records; it ; it = it->next){
+        ((service_record_item_t *) it)->search_mask = 0;
+    }
+
+    // mark records that contain the n-th UUID of the pattern with bit n
+    bool pattern_valid = true;
+    uint16_t pattern_mask = 0;
+    uint8_t  pattern_index = 0;
+    des_iterator_t des_it;
+    if (des_iterator_init(&des_it, serviceSearchPattern)){
+        for ( ; des_iterator_has_more(&des_it) ; des_iterator_next(&des_it)){
+            uint8_t uuid128[16];
+            if ((pattern_index == 16u) || !de_get_normalized_uuid(uuid128, des_iterator_get_element(&des_it))){
+                pattern_valid = false;
+                break;
+            }
+            uint16_t uuid_bit = 1u << pattern_index++;
+            pattern_mask |= uuid_bit;
+            uint32_t key = big_endian_read_32(uuid128, 0);
+            uint16_t pos;
+            for (pos = sdp_server_uuid_index_lower_bound(key); pos < sdp_server_uuid_index_count; pos++){
+                sdp_server_uuid_index_entry_t * entry = &sdp_server_uuid_index[pos];
+                if (entry->key != key) break;
+                if (!sdp_server_uuid_index_entry_matches(entry, uuid128)) continue;
+                entry->item->search_mask |= uuid_bit;
+            }
+        }
+    }
+
+    for (it = (btstack_linked_item_t *) sdp_server_service_records; it ; it = it->next){
+        service_record_item_t * item = (service_record_item_t *) it;
+        if (pattern_valid){
+            item->search_match = item->search_mask == pattern_mask;
+        } else if (pattern_index < 16u){
+            // invalid UUID in pattern
+            item->search_match = false;
+        } else {
+            // more than 16 UUIDs in pattern
+            item->search_match = sdp_record_matches_service_search_pattern(item->service_record, serviceSearchPattern) != 0;
+        }
+    }
+}
+
 /**
  * @brief Register Service Record with database using ServiceRecordHandle stored in record
  * @pre AttributeIDs are in ascending order
@@ -158,7 +318,9 @@ uint8_t sdp_register_service(const uint8_t * record){
     
     // add to linked list
     btstack_linked_list_add(&sdp_server_service_records, (btstack_linked_item_t *) newRecordItem);
-    
+
+    sdp_server_uuid_index_add_record(newRecordItem);
+
     return 0;
 }
 
@@ -168,6 +330,7 @@ uint8_t sdp_register_service(const uint8_t * record){
 void sdp_unregister_service(uint32_t service_record_handle){
     service_record_item_t * record_item = sdp_get_record_item_for_handle(service_record_handle);
     if (!record_item) return;
+    sdp_server_uuid_index_remove_record(record_item);
     btstack_linked_list_remove(&sdp_server_service_records, (btstack_linked_item_t *) record_item);
     btstack_memory_service_record_item_free(record_item);
 }
@@ -214,11 +377,12 @@ int sdp_handle_service_search_request(uint8_t * packet, uint16_t remote_mtu){
     }
     
     // get and limit total count
+    sdp_server_match_service_search_pattern(serviceSearchPattern);
     btstack_linked_item_t *it;
     uint16_t total_service_count   = 0;
     for (it = (btstack_linked_item_t *) sdp_server_service_records; it ; it = it->next){
         service_record_item_t * item = (service_record_item_t *) it;
-        if (!sdp_record_matches_service_search_pattern(item->service_record, serviceSearchPattern)) continue;
+        if (!item->search_match) continue;
         total_service_count++;
     }
     if (total_service_count > maximumServiceRecordCount){
@@ -233,7 +397,7 @@ int sdp_handle_service_search_request(uint8_t * packet, uint16_t remote_mtu){
     for (it = (btstack_linked_item_t *) sdp_server_service_records; it ; it = it->next, ++current_service_index){
         service_record_item_t * item = (service_record_item_t *) it;
 
-        if (!sdp_record_matches_service_search_pattern(item->service_record, serviceSearchPattern)) continue;
+        if (!item->search_match) continue;
         matching_service_count++;
         
         if (current_service_index < continuation_index) continue;
@@ -350,16 +514,18 @@ int sdp_handle_service_attribute_request(uint8_t * packet, uint16_t remote_mtu){
     return pos;
 }
 
-static uint16_t sdp_get_size_for_service_search_attribute_response(uint8_t * serviceSearchPattern, uint8_t * attributeIDList){
+// pre: search_match set by sdp_server_match_service_search_pattern, stores filtered_attributes_size for matching records
+static uint16_t sdp_get_size_for_service_search_attribute_response(uint8_t * attributeIDList){
     uint16_t total_response_size = 0;
     btstack_linked_item_t *it;
     for (it = (btstack_linked_item_t *) sdp_server_service_records; it ; it = it->next){
         service_record_item_t * item = (service_record_item_t *) it;
         
-        if (!sdp_record_matches_service_search_pattern(item->service_record, serviceSearchPattern)) continue;
+        if (!item->search_match) continue;
         
         // for all service records that match
-        total_response_size += 3 + spd_get_filtered_size(item->service_record, attributeIDList);
+        item->filtered_attributes_size = spd_get_filtered_size(item->service_record, attributeIDList);
+        total_response_size += 3 + item->filtered_attributes_size;
     }
     return total_response_size;
 }
@@ -411,9 +577,13 @@ int sdp_handle_service_search_attribute_request(uint8_t * packet, uint16_t remot
     // AttributeLists - starts at offset 7
     uint16_t pos = 7;
     
+    sdp_server_match_service_search_pattern(serviceSearchPattern);
+
     // add DES with total size for first request
+    bool filtered_attributes_size_valid = false;
     if ((continuation_service_index == 0) && (continuation_offset == 0)){
-        uint16_t total_response_size = sdp_get_size_for_service_search_attribute_response(serviceSearchPattern, attributeIDList);
+        uint16_t total_response_size = sdp_get_size_for_service_search_attribute_response(attributeIDList);
+        filtered_attributes_size_valid = true;
         de_store_descriptor_with_len(&sdp_response_buffer[pos], DE_DES, DE_SIZE_VAR_16, total_response_size);
         // log_info("total response size %u", total_response_size);
         pos += 3;
@@ -429,12 +599,15 @@ int sdp_handle_service_search_attribute_request(uint8_t * packet, uint16_t remot
         service_record_item_t * item = (service_record_item_t *) it;
         
         if (current_service_index < continuation_service_index ) continue;
-        if (!sdp_record_matches_service_search_pattern(item->service_record, serviceSearchPattern)) continue;
+        if (!item->search_match) continue;
 
         if (continuation_offset == 0){
             
             // get size of this record
-            uint16_t filtered_attributes_size = spd_get_filtered_size(item->service_record, attributeIDList);
+            if (!filtered_attributes_size_valid){
+                item->filtered_attributes_size = spd_get_filtered_size(item->service_record, attributeIDList);
+            }
+            uint16_t filtered_attributes_size = item->filtered_attributes_size;
             
             // stop if complete record doesn't fits into response but we already have a partial response
             if (((filtered_attributes_size + 3) > maximumAttributeByteCount) && !first_answer) {
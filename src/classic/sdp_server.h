@@ -44,6 +44,7 @@
 #define SDP_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "btstack_linked_list.h"
 
 #include "btstack_config.h"
@@ -58,8 +59,21 @@ typedef struct {
 
     uint32_t        service_record_handle;
     uint8_t *       service_record;
+
+    // state for current request
+    uint16_t        search_mask;
+    bool            search_match;
+    uint16_t        filtered_attributes_size;
 } service_record_item_t;
 
+typedef struct {
+    // first 32 bits of normalized UUID, equals UUID32 for Bluetooth Base UUIDs
+    uint32_t                key;
+    // UUID Data Element in service record
+    const uint8_t *         uuid;
+    service_record_item_t * item;
+} sdp_server_uuid_index_entry_t;
+
 int sdp_handle_service_search_request(uint8_t * packet, uint16_t remote_mtu);
 int sdp_handle_service_attribute_request(uint8_t * packet, uint16_t remote_mtu);
 int sdp_handle_service_search_attribute_request(uint8_t * packet, uint16_t remote_mtu);
@@ -104,6 +118,14 @@ uint32_t sdp_create_service_record_handle(void);
 
 uint8_t * sdp_get_record_for_handle(uint32_t handle);
 
+/**
+ * @brief Enable UUID index for ServiceSearch and ServiceSearchAttribute requests
+ * @note Requests are handled by traversing all service records if storage is too small
+ * @param storage for index entries
+ * @param num_entries in storage, should be larger than the number of UUIDs in all registered service records
+ */
+void sdp_server_enable_uuid_index(sdp_server_uuid_index_entry_t * storage, uint16_t num_entries);
+
 /**
  * @brief De-Init SDP Server
  */
@@ -51,6 +51,9 @@
 #ifdef HAVE_EMBEDDED_TICK
 #include "btstack_run_loop_embedded.h"
 #endif
+#ifdef ENABLE_SDP_CLIENT_CACHE
+#include "classic/sdp_client.h"
+#endif
 #endif
 
 #ifdef ENABLE_BLE
@@ -91,6 +94,10 @@
 #ifndef HCI_HOST_SCO_PACKET_LEN
 #error "ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL requires to define HCI_HOST_SCO_PACKET_LEN"
 #endif
+// host ACL buffers are shared by all connections, a paused connection only holds back this many to not stall the others
+#ifndef HCI_ACL_RECEIVE_PAUSE_MAX_PACKETS
+#define HCI_ACL_RECEIVE_PAUSE_MAX_PACKETS (HCI_HOST_ACL_PACKET_NUM / 2)
+#endif
 #endif
 
 #if defined(ENABLE_SCO_OVER_HCI) && defined(ENABLE_SCO_OVER_PCM)
@@ -545,6 +552,10 @@ bool hci_authentication_active_for_handle(hci_con_handle_t handle){
 }
 
 void gap_drop_link_key_for_bd_addr(bd_addr_t addr){
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    // cached SDP records of unpaired device might not be trusted
+    sdp_client_cache_remove(addr);
+#endif
     if (!hci_stack->link_key_db) return;
     log_info("gap_drop_link_key_for_bd_addr: %s", bd_addr_to_str(addr));
     hci_stack->link_key_db->delete_link_key(addr);
@@ -1182,8 +1193,10 @@ static void acl_handler(uint8_t *packet, uint16_t size){
 #endif
 
 #ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
-    hci_stack->host_completed_packets = 1;
     conn->num_packets_completed++;
+    if ((conn->acl_receive_paused == false) || (conn->num_packets_completed > HCI_ACL_RECEIVE_PAUSE_MAX_PACKETS)){
+        hci_stack->host_completed_packets = 1;
+    }
 #endif
 
     // handle different packet types
@@ -5315,14 +5328,20 @@ static void hci_host_num_completed_packets(void){
     btstack_linked_item_t * it;
     for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
         hci_connection_t * connection = (hci_connection_t *) it;
-        if (connection->num_packets_completed){
+        // paused connection holds back up to HCI_ACL_RECEIVE_PAUSE_MAX_PACKETS
+        uint8_t num_packets_withheld = 0;
+        if (connection->acl_receive_paused){
+            num_packets_withheld = (uint8_t) btstack_min(connection->num_packets_completed, HCI_ACL_RECEIVE_PAUSE_MAX_PACKETS);
+        }
+        uint8_t num_packets_reported = connection->num_packets_completed - num_packets_withheld;
+        if (num_packets_reported){
             little_endian_store_16(packet, size, connection->con_handle);
             size += 2;
-            little_endian_store_16(packet, size, connection->num_packets_completed);
+            little_endian_store_16(packet, size, num_packets_reported);
             size += 2;
             //
             num_handles++;
-            connection->num_packets_completed = 0;
+            connection->num_packets_completed = num_packets_withheld;
         }
     }    
 
@@ -5340,6 +5359,25 @@ static void hci_host_num_completed_packets(void){
         hci_emit_transport_packet_sent();
     }
 }
+
+uint8_t hci_acl_receive_pause(hci_con_handle_t con_handle){
+    hci_connection_t * conn = hci_connection_for_handle(con_handle);
+    if (conn == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    conn->acl_receive_paused = true;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t hci_acl_receive_resume(hci_con_handle_t con_handle){
+    hci_connection_t * conn = hci_connection_for_handle(con_handle);
+    if (conn == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    if (conn->acl_receive_paused == false) return ERROR_CODE_SUCCESS;
+    conn->acl_receive_paused = false;
+    if (conn->num_packets_completed > 0u){
+        hci_stack->host_completed_packets = 1;
+        hci_run();
+    }
+    return ERROR_CODE_SUCCESS;
+}
 #endif
 
 static void hci_halting_timeout_handler(btstack_timer_source_t * ds){
@@ -9034,7 +9072,7 @@ void gap_set_page_timeout(uint16_t page_timeout){
 void hci_load_le_device_db_entry_into_resolving_list(uint16_t le_device_db_index){
     if (le_device_db_index >= MAX_NUM_RESOLVING_LIST_ENTRIES) return;
     if (le_device_db_index >= le_device_db_max_count()) return;
-    uint8_t offset = le_device_db_index >> 3;
+    uint16_t offset = le_device_db_index >> 3;
     uint8_t mask = 1 << (le_device_db_index & 7);
     hci_stack->le_resolving_list_add_entries[offset] |= mask;
     if (hci_stack->le_resolving_list_state == LE_RESOLVING_LIST_DONE){
@@ -9046,7 +9084,7 @@ void hci_load_le_device_db_entry_into_resolving_list(uint16_t le_device_db_index
 void hci_remove_le_device_db_entry_from_resolving_list(uint16_t le_device_db_index){
 	if (le_device_db_index >= MAX_NUM_RESOLVING_LIST_ENTRIES) return;
 	if (le_device_db_index >= le_device_db_max_count()) return;
-	uint8_t offset = le_device_db_index >> 3;
+	uint16_t offset = le_device_db_index >> 3;
 	uint8_t mask = 1 << (le_device_db_index & 7);
 	hci_stack->le_resolving_list_remove_entries[offset] |= mask;
 	if (hci_stack->le_resolving_list_state == LE_RESOLVING_LIST_DONE){
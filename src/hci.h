@@ -491,10 +491,32 @@ typedef struct {
     btstack_linked_list_t   notification_requests;
     btstack_linked_list_t   indication_requests;
 
+#ifdef ENABLE_ATT_NOTIFICATION_QUEUE
+    struct att_server_notification_queue * notification_queue;
+#endif
+
+    bool                    notify_all_pending;
+    uint8_t                 notify_all_result_index;
+    btstack_context_callback_registration_t notify_all_registration;
+
+    // Write Without Response sink: handle with validated permissions, sink could not accept data
+    uint16_t                write_command_sink_validated_handle;
+    bool                    write_command_sink_busy;
+
 #ifdef ENABLE_GATT_OVER_CLASSIC
     uint16_t                l2cap_cid;
 #endif
 
+#ifdef ENABLE_GATT_ROBUST_CACHING
+    uint8_t                 client_supported_features;
+    bool                    change_aware;
+    bool                    change_aware_on_next_request;
+    bool                    service_changed_enabled;
+    uint16_t                service_changed_start_handle;
+    uint16_t                service_changed_end_handle;
+    btstack_context_callback_registration_t service_changed_registration;
+#endif
+
     uint16_t                request_size;
     uint8_t                 request_buffer[ATT_REQUEST_BUFFER_SIZE];
 
@@ -622,6 +644,8 @@ typedef struct {
 
 #ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
     uint8_t num_packets_completed;
+    // completed packets are not reported to Controller while paused
+    bool    acl_receive_paused;
 #endif
 
     // LE Connection parameter update
@@ -1465,6 +1489,26 @@ void hci_release_packet_buffer(void);
 */
 void hci_set_master_slave_policy(uint8_t policy);
 
+#ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
+/**
+ * @brief Pause reception of ACL packets for connection by not reporting processed packets to the Controller
+ * @note Host buffers are shared by all connections. To not stall other connections, a paused connection holds back at most
+ *       HCI_ACL_RECEIVE_PAUSE_MAX_PACKETS buffers (default: HCI_HOST_ACL_PACKET_NUM / 2). Further packets are still
+ *       received and need to be dropped or buffered by the caller.
+ * @note Only available with ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
+ * @param con_handle
+ * @return status ERROR_CODE_SUCCESS, or ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER
+ */
+uint8_t hci_acl_receive_pause(hci_con_handle_t con_handle);
+
+/**
+ * @brief Resume reception of ACL packets for connection paused by hci_acl_receive_pause
+ * @param con_handle
+ * @return status ERROR_CODE_SUCCESS, or ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER
+ */
+uint8_t hci_acl_receive_resume(hci_con_handle_t con_handle);
+#endif
+
 /* API_END */
 
 
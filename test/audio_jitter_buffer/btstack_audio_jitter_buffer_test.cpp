@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_audio_jitter_buffer.h"
+#include "btstack_util.h"
+
+#define SAMPLE_RATE       16000
+#define TARGET_LATENCY_MS 50
+#define TARGET_FRAMES     (SAMPLE_RATE * TARGET_LATENCY_MS / 1000)
+#define STORAGE_FRAMES    (2 * TARGET_FRAMES)
+
+// like mSBC: 120 frames every 7.5 ms
+#define PRODUCER_FRAMES   120
+// audio callback with 256 frames every 16 ms
+#define CONSUMER_FRAMES   256
+
+static int16_t storage[STORAGE_FRAMES * 2];
+
+uint32_t btstack_min(uint32_t a, uint32_t b){
+    return a < b ? a : b;
+}
+
+uint32_t btstack_max(uint32_t a, uint32_t b){
+    return a > b ? a : b;
+}
+
+TEST_GROUP(AudioJitterBuffer){
+    btstack_audio_jitter_buffer_t jitter_buffer;
+    btstack_audio_jitter_buffer_statistics_t statistics;
+    int16_t producer_buffer[PRODUCER_FRAMES * 2];
+    int16_t consumer_buffer[CONSUMER_FRAMES * 2];
+    double  time_us;
+    double  next_producer_us;
+    double  next_consumer_us;
+
+    void setup(void){
+        time_us = 0.0;
+        next_producer_us = 0.0;
+        next_consumer_us = 0.0;
+        btstack_audio_jitter_buffer_init(&jitter_buffer, storage, STORAGE_FRAMES, 1, SAMPLE_RATE, TARGET_LATENCY_MS);
+        int i;
+        for (i = 0; i < PRODUCER_FRAMES * 2; i++){
+            producer_buffer[i] = 1000;
+        }
+    }
+
+    bool consumer_buffer_is_silent(uint32_t offset, uint32_t num_samples){
+        uint32_t i;
+        for (i = offset; i < (offset + num_samples); i++){
+            if (consumer_buffer[i] != 0) return false;
+        }
+        return true;
+    }
+
+    // run producer with given clock drift against consumer with nominal rate
+    void simulate(uint32_t duration_ms, int32_t producer_drift_ppm){
+        double producer_period_us = (PRODUCER_FRAMES * 1000000.0) / (SAMPLE_RATE * (1.0 + (producer_drift_ppm / 1000000.0)));
+        double consumer_period_us = (CONSUMER_FRAMES * 1000000.0) / SAMPLE_RATE;
+        time_us += duration_ms * 1000.0;
+        while ((next_producer_us < time_us) || (next_consumer_us < time_us)){
+            if (next_producer_us <= next_consumer_us){
+                btstack_audio_jitter_buffer_write(&jitter_buffer, producer_buffer, PRODUCER_FRAMES);
+                next_producer_us += producer_period_us;
+            } else {
+                btstack_audio_jitter_buffer_read(&jitter_buffer, consumer_buffer, CONSUMER_FRAMES);
+                next_consumer_us += consumer_period_us;
+            }
+        }
+    }
+
+    // average level over 10 seconds
+    uint32_t average_level(int32_t producer_drift_ppm){
+        uint32_t sum = 0;
+        int i;
+        for (i = 0; i < 100; i++){
+            simulate(100, producer_drift_ppm);
+            sum += btstack_audio_jitter_buffer_frames_available(&jitter_buffer);
+        }
+        return sum / 100;
+    }
+};
+
+TEST(AudioJitterBuffer, Prebuffering){
+    btstack_audio_jitter_buffer_write(&jitter_buffer, producer_buffer, PRODUCER_FRAMES);
+    // resampler keeps last frame for interpolation
+    CHECK_EQUAL(PRODUCER_FRAMES - 1, btstack_audio_jitter_buffer_frames_available(&jitter_buffer));
+
+    // silence until target latency is reached
+    btstack_audio_jitter_buffer_read(&jitter_buffer, consumer_buffer, PRODUCER_FRAMES);
+    CHECK_TRUE(consumer_buffer_is_silent(0, PRODUCER_FRAMES));
+    CHECK_EQUAL(PRODUCER_FRAMES - 1, btstack_audio_jitter_buffer_frames_available(&jitter_buffer));
+
+    while (btstack_audio_jitter_buffer_frames_available(&jitter_buffer) < TARGET_FRAMES){
+        btstack_audio_jitter_buffer_write(&jitter_buffer, producer_buffer, PRODUCER_FRAMES);
+    }
+    btstack_audio_jitter_buffer_read(&jitter_buffer, consumer_buffer, PRODUCER_FRAMES);
+    CHECK_EQUAL(1000, consumer_buffer[0]);
+    CHECK_EQUAL(1000, consumer_buffer[PRODUCER_FRAMES - 1]);
+
+    btstack_audio_jitter_buffer_get_statistics(&jitter_buffer, &statistics);
+    CHECK_EQUAL(0, statistics.underruns);
+    CHECK_EQUAL(0, statistics.overruns);
+    CHECK_EQUAL(2 * PRODUCER_FRAMES, statistics.frames_read);
+}
+
+TEST(AudioJitterBuffer, Underrun){
+    while (btstack_audio_jitter_buffer_frames_available(&jitter_buffer) < TARGET_FRAMES){
+        btstack_audio_jitter_buffer_write(&jitter_buffer, producer_buffer, PRODUCER_FRAMES);
+    }
+    uint32_t level = btstack_audio_jitter_buffer_frames_available(&jitter_buffer);
+    while (btstack_audio_jitter_buffer_frames_available(&jitter_buffer) >= CONSUMER_FRAMES){
+        btstack_audio_jitter_buffer_read(&jitter_buffer, consumer_buffer, CONSUMER_FRAMES);
+    }
+    uint32_t remaining = btstack_audio_jitter_buffer_frames_available(&jitter_buffer);
+    CHECK_EQUAL(level % CONSUMER_FRAMES, remaining);
+
+    // partial read is filled with silence
+    btstack_audio_jitter_buffer_read(&jitter_buffer, consumer_buffer, CONSUMER_FRAMES);
+    CHECK_EQUAL(1000, consumer_buffer[remaining - 1]);
+    CHECK_TRUE(consumer_buffer_is_silent(remaining, CONSUMER_FRAMES - remaining));
+    btstack_audio_jitter_buffer_get_statistics(&jitter_buffer, &statistics);
+    CHECK_EQUAL(1, statistics.underruns);
+
+    // prebuffering again
+    btstack_audio_jitter_buffer_write(&jitter_buffer, producer_buffer, PRODUCER_FRAMES);
+    btstack_audio_jitter_buffer_read(&jitter_buffer, consumer_buffer, 1);
+    CHECK_TRUE(consumer_buffer_is_silent(0, 1));
+    btstack_audio_jitter_buffer_get_statistics(&jitter_buffer, &statistics);
+    CHECK_EQUAL(1, statistics.underruns);
+}
+
+TEST(AudioJitterBuffer, Overrun){
+    int i;
+    for (i = 0; i < (STORAGE_FRAMES / PRODUCER_FRAMES) + 1; i++){
+        btstack_audio_jitter_buffer_write(&jitter_buffer, producer_buffer, PRODUCER_FRAMES);
+    }
+    CHECK_EQUAL(STORAGE_FRAMES, btstack_audio_jitter_buffer_frames_available(&jitter_buffer));
+    btstack_audio_jitter_buffer_get_statistics(&jitter_buffer, &statistics);
+    CHECK_EQUAL(1, statistics.overruns);
+    CHECK_EQUAL(STORAGE_FRAMES, statistics.frames_written);
+    CHECK_EQUAL(((STORAGE_FRAMES / PRODUCER_FRAMES) + 1) * PRODUCER_FRAMES - STORAGE_FRAMES - 1, statistics.dropped_frames);
+
+    // reset
+    btstack_audio_jitter_buffer_reset(&jitter_buffer);
+    CHECK_EQUAL(0, btstack_audio_jitter_buffer_frames_available(&jitter_buffer));
+    btstack_audio_jitter_buffer_get_statistics(&jitter_buffer, &statistics);
+    CHECK_EQUAL(0, statistics.overruns);
+    CHECK_EQUAL(0, statistics.dropped_frames);
+}
+
+TEST(AudioJitterBuffer, Stereo){
+    btstack_audio_jitter_buffer_init(&jitter_buffer, storage, STORAGE_FRAMES, 2, SAMPLE_RATE, TARGET_LATENCY_MS);
+    int i;
+    for (i = 0; i < PRODUCER_FRAMES; i++){
+        producer_buffer[2 * i]     =  1000;
+        producer_buffer[2 * i + 1] = -1000;
+    }
+    while (btstack_audio_jitter_buffer_frames_available(&jitter_buffer) < TARGET_FRAMES){
+        btstack_audio_jitter_buffer_write(&jitter_buffer, producer_buffer, PRODUCER_FRAMES);
+    }
+    btstack_audio_jitter_buffer_read(&jitter_buffer, consumer_buffer, CONSUMER_FRAMES);
+    for (i = 0; i < CONSUMER_FRAMES; i++){
+        CHECK_EQUAL( 1000, consumer_buffer[2 * i]);
+        CHECK_EQUAL(-1000, consumer_buffer[2 * i + 1]);
+    }
+}
+
+TEST(AudioJitterBuffer, NoDrift){
+    simulate(5000, 0);
+    uint32_t level = average_level(0);
+    btstack_audio_jitter_buffer_get_statistics(&jitter_buffer, &statistics);
+    CHECK_EQUAL(0, statistics.underruns);
+    CHECK_EQUAL(0, statistics.overruns);
+    CHECK_TRUE(level > (TARGET_FRAMES - (TARGET_FRAMES / 4)));
+    CHECK_TRUE(level < (TARGET_FRAMES + (TARGET_FRAMES / 4)));
+}
+
+TEST(AudioJitterBuffer, ProducerFaster){
+    // 0.3 % faster, without compensation the buffer would overflow after ~17 seconds
+    simulate(20000, 3000);
+    uint32_t level = average_level(3000);
+    btstack_audio_jitter_buffer_get_statistics(&jitter_buffer, &statistics);
+    CHECK_EQUAL(0, statistics.underruns);
+    CHECK_EQUAL(0, statistics.overruns);
+    CHECK_TRUE(statistics.resampling_offset > 0);
+    CHECK_TRUE(level > (TARGET_FRAMES - (TARGET_FRAMES / 4)));
+    CHECK_TRUE(level < (TARGET_FRAMES + (TARGET_FRAMES / 4)));
+}
+
+TEST(AudioJitterBuffer, ProducerSlower){
+    // 0.3 % slower, without compensation the buffer would run empty after ~17 seconds
+    simulate(20000, -3000);
+    uint32_t level = average_level(-3000);
+    btstack_audio_jitter_buffer_get_statistics(&jitter_buffer, &statistics);
+    CHECK_EQUAL(0, statistics.underruns);
+    CHECK_EQUAL(0, statistics.overruns);
+    CHECK_TRUE(statistics.resampling_offset < 0);
+    CHECK_TRUE(level > (TARGET_FRAMES - (TARGET_FRAMES / 4)));
+    CHECK_TRUE(level < (TARGET_FRAMES + (TARGET_FRAMES / 4)));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
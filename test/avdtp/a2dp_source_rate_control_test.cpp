@@ -0,0 +1,349 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// test A2DP Source SBC rate control
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack.h"
+#include "classic/a2dp.h"
+#include "classic/a2dp_source.h"
+#include "classic/avdtp_source.h"
+
+#define TEST_A2DP_CID                0x41
+#define TEST_LOCAL_SEID              1
+#define TEST_MEDIA_CON_HANDLE        0x0001
+#define TEST_MAX_MEDIA_PAYLOAD_SIZE  883
+
+static avdtp_stream_endpoint_t test_stream_endpoint;
+static hci_connection_t        test_hci_connection;
+static btstack_packet_handler_t avdtp_source_packet_handler;
+static uint32_t                time_ms;
+static uint8_t                 rate_control_event[20];
+static int                     rate_control_event_count;
+
+// mock start
+extern "C" void a2dp_config_process_avdtp_event_handler(avdtp_role_t role, uint8_t *packet, uint16_t size){}
+extern "C" void a2dp_config_process_ready_for_sep_discovery(avdtp_role_t role, avdtp_connection_t *connection){}
+extern "C" uint8_t a2dp_config_process_set_atrac(avdtp_role_t role, uint16_t a2dp_cid, uint8_t local_seid, uint8_t remote_seid, const avdtp_configuration_atrac_t * configuration){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t a2dp_config_process_set_mpeg_aac(avdtp_role_t role, uint16_t a2dp_cid, uint8_t local_seid, uint8_t remote_seid, const avdtp_configuration_mpeg_aac_t * configuration){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t a2dp_config_process_set_mpeg_audio(avdtp_role_t role, uint16_t a2dp_cid, uint8_t local_seid, uint8_t remote_seid, const avdtp_configuration_mpeg_audio_t * configuration){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t a2dp_config_process_set_other(avdtp_role_t role, uint16_t a2dp_cid, uint8_t local_seid, uint8_t remote_seid, const uint8_t * media_codec_information, uint8_t media_codec_information_len){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t a2dp_config_process_set_sbc(avdtp_role_t role, uint16_t a2dp_cid, uint8_t local_seid, uint8_t remote_seid, const avdtp_configuration_sbc_t * configuration){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" void a2dp_create_sdp_record(uint8_t * service, uint32_t service_record_handle, uint16_t service_class_uuid, uint16_t supported_features, const char * service_name, const char * service_provider_name){}
+extern "C" void a2dp_init(void){}
+extern "C" void a2dp_deinit(void){}
+extern "C" void a2dp_register_source_packet_handler(btstack_packet_handler_t callback){}
+extern "C" void a2dp_replace_subevent_id_and_emit_source(uint8_t * packet, uint16_t size, uint8_t subevent_id){
+    if (subevent_id != A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE) return;
+    CHECK(size <= sizeof(rate_control_event));
+    memcpy(rate_control_event, packet, size);
+    rate_control_event_count++;
+}
+extern "C" uint8_t a2dp_subevent_id_for_avdtp_subevent_id(uint8_t subevent){
+    return subevent;
+}
+extern "C" void avdtp_config_atrac_set_sampling_frequency(uint8_t * config, uint16_t sampling_frequency_hz){}
+extern "C" void avdtp_config_mpeg_aac_set_sampling_frequency(uint8_t * config, uint16_t sampling_frequency_hz){}
+extern "C" void avdtp_config_mpeg_audio_set_sampling_frequency(uint8_t * config, uint16_t sampling_frequency_hz){}
+extern "C" void avdtp_config_sbc_set_sampling_frequency(uint8_t * config, uint16_t sampling_frequency_hz){}
+extern "C" uint8_t avdtp_disconnect(uint16_t avdtp_cid){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" avdtp_connection_t * avdtp_get_connection_for_avdtp_cid(uint16_t avdtp_cid){
+    return NULL;
+}
+extern "C" avdtp_connection_t * avdtp_get_connection_for_bd_addr(bd_addr_t addr){
+    return NULL;
+}
+extern "C" avdtp_stream_endpoint_t * avdtp_get_stream_endpoint_for_seid(uint16_t seid){
+    if (seid != TEST_LOCAL_SEID) return NULL;
+    return &test_stream_endpoint;
+}
+extern "C" int avdtp_max_media_payload_size(uint16_t avdtp_cid, uint8_t local_seid){
+    return TEST_MAX_MEDIA_PAYLOAD_SIZE;
+}
+extern "C" uint8_t avdtp_source_connect(bd_addr_t bd_addr, uint16_t * avdtp_cid){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" avdtp_stream_endpoint_t * avdtp_source_create_stream_endpoint(avdtp_sep_type_t sep_type, avdtp_media_type_t media_type){
+    return NULL;
+}
+extern "C" void avdtp_source_init(void){}
+extern "C" void avdtp_source_deinit(void){}
+extern "C" void avdtp_source_finalize_stream_endpoint(avdtp_stream_endpoint_t * stream_endpoint){}
+extern "C" uint8_t avdtp_source_reconfigure(uint16_t avdtp_cid, uint8_t int_seid, uint8_t acp_seid, uint16_t configured_services_bitmap, avdtp_capabilities_t configuration){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" void avdtp_source_register_delay_reporting_category(uint8_t seid){}
+extern "C" void avdtp_source_register_media_codec_category(uint8_t seid, avdtp_media_type_t media_type, avdtp_media_codec_type_t media_codec_type, const uint8_t *media_codec_info, uint16_t media_codec_info_len){}
+extern "C" void avdtp_source_register_media_config_validator(uint8_t (*callback)(const avdtp_stream_endpoint_t * stream_endpoint, const uint8_t * event, uint16_t size)){}
+extern "C" void avdtp_source_register_media_transport_category(uint8_t seid){}
+extern "C" void avdtp_source_register_packet_handler(btstack_packet_handler_t callback){
+    avdtp_source_packet_handler = callback;
+}
+extern "C" void avdtp_source_stream_endpoint_request_can_send_now(uint16_t avddp_cid, uint8_t local_seid){}
+extern "C" uint8_t * avdtp_source_stream_reserve_media_payload(uint16_t avdtp_cid, uint8_t local_seid, uint16_t * max_payload_size){
+    return NULL;
+}
+extern "C" uint8_t avdtp_source_stream_send_media_packet(uint16_t avdtp_cid, uint8_t local_seid, const uint8_t * packet, uint16_t size){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" int avdtp_source_stream_send_media_payload(uint16_t avdtp_cid, uint8_t local_seid, const uint8_t * payload, uint16_t payload_size, uint8_t num_frames, uint8_t marker){
+    return 0;
+}
+extern "C" uint8_t avdtp_source_stream_send_media_payload_rtp(uint16_t avdtp_cid, uint8_t local_seid, uint8_t marker, const uint8_t * payload, uint16_t size){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t avdtp_source_stream_send_reserved_media_payload(uint16_t avdtp_cid, uint8_t local_seid, uint8_t marker, uint16_t payload_size){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t avdtp_start_stream(uint16_t avdtp_cid, uint8_t local_seid){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t avdtp_suspend_stream(uint16_t avdtp_cid, uint8_t local_seid){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t avdtp_stream_endpoint_seid(avdtp_stream_endpoint_t * stream_endpoint){
+    return TEST_LOCAL_SEID;
+}
+extern "C" hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
+    if (con_handle != TEST_MEDIA_CON_HANDLE) return NULL;
+    return &test_hci_connection;
+}
+extern "C" uint32_t btstack_run_loop_get_time_ms(void){
+    return time_ms;
+}
+// mock end
+
+static void dummy_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){}
+
+// request can send now, let time pass and deliver can send now with given number of outstanding ACL packets
+static void can_send_now(uint8_t acl_packets_queued, uint32_t latency_ms){
+    a2dp_source_stream_endpoint_request_can_send_now(TEST_A2DP_CID, TEST_LOCAL_SEID);
+    time_ms += latency_ms;
+    test_hci_connection.num_packets_sent = acl_packets_queued;
+
+    uint8_t event[8];
+    event[0] = HCI_EVENT_AVDTP_META;
+    event[1] = sizeof(event) - 2;
+    event[2] = AVDTP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW;
+    little_endian_store_16(event, 3, TEST_A2DP_CID);
+    event[5] = TEST_LOCAL_SEID;
+    little_endian_store_16(event, 6, 0);
+    (*avdtp_source_packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+static void can_send_now_repeat(uint8_t acl_packets_queued, uint32_t latency_ms, int num_samples){
+    int i;
+    for (i=0; i<num_samples; i++){
+        can_send_now(acl_packets_queued, latency_ms);
+    }
+}
+
+TEST_GROUP(A2dpSourceRateControl){
+    a2dp_source_rate_control_t rate_control;
+    avdtp_configuration_sbc_t configuration;
+
+    void setup(){
+        memset(&test_stream_endpoint, 0, sizeof(test_stream_endpoint));
+        memset(&test_hci_connection, 0, sizeof(test_hci_connection));
+        memset(rate_control_event, 0, sizeof(rate_control_event));
+        rate_control_event_count = 0;
+        time_ms = 1000;
+        test_stream_endpoint.media_con_handle = TEST_MEDIA_CON_HANDLE;
+
+        // 44.1 kHz, joint stereo, 16 blocks, 8 subbands, bitpool 35..53
+        memset(&configuration, 0, sizeof(configuration));
+        configuration.sampling_frequency = 44100;
+        configuration.channel_mode = AVDTP_CHANNEL_MODE_JOINT_STEREO;
+        configuration.block_length = 16;
+        configuration.subbands = 8;
+        configuration.allocation_method = AVDTP_SBC_ALLOCATION_METHOD_LOUDNESS;
+        configuration.min_bitpool_value = 35;
+        configuration.max_bitpool_value = 53;
+
+        a2dp_source_init();
+        a2dp_source_register_packet_handler(&dummy_packet_handler);
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, a2dp_source_rate_control_start(&rate_control, TEST_A2DP_CID, TEST_LOCAL_SEID, &configuration));
+    }
+
+    void teardown(){
+        a2dp_source_deinit();
+    }
+};
+
+TEST(A2dpSourceRateControl, start_unknown_stream_endpoint){
+    a2dp_source_rate_control_t other;
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, a2dp_source_rate_control_start(&other, TEST_A2DP_CID, TEST_LOCAL_SEID + 1, &configuration));
+}
+
+TEST(A2dpSourceRateControl, start_with_max_bitpool){
+    // SBC frame: 4 + 8 + (8 + 16 * 53 + 7) / 8 = 119 bytes, 882 / 119 = 7 frames
+    CHECK_EQUAL(53, a2dp_source_rate_control_get_bitpool(&rate_control));
+    CHECK_EQUAL(7, a2dp_source_rate_control_get_num_frames(&rate_control));
+}
+
+TEST(A2dpSourceRateControl, decrease_on_acl_queue_growing){
+    can_send_now(4, 0);
+    CHECK_EQUAL(53, a2dp_source_rate_control_get_bitpool(&rate_control));
+    CHECK_EQUAL(0, rate_control_event_count);
+
+    can_send_now(4, 0);
+    // SBC frame: 4 + 8 + (8 + 16 * 47 + 7) / 8 = 107 bytes, 882 / 107 = 8 frames
+    CHECK_EQUAL(47, a2dp_source_rate_control_get_bitpool(&rate_control));
+    CHECK_EQUAL(8, a2dp_source_rate_control_get_num_frames(&rate_control));
+    CHECK_EQUAL(1, rate_control_event_count);
+}
+
+TEST(A2dpSourceRateControl, decrease_on_can_send_now_latency){
+    can_send_now_repeat(0, 20, 2);
+    CHECK_EQUAL(47, a2dp_source_rate_control_get_bitpool(&rate_control));
+}
+
+TEST(A2dpSourceRateControl, decrease_stops_at_min_bitpool){
+    can_send_now_repeat(5, 0, 2);
+    CHECK_EQUAL(47, a2dp_source_rate_control_get_bitpool(&rate_control));
+    can_send_now_repeat(5, 0, 2);
+    CHECK_EQUAL(41, a2dp_source_rate_control_get_bitpool(&rate_control));
+    can_send_now_repeat(5, 0, 2);
+    CHECK_EQUAL(35, a2dp_source_rate_control_get_bitpool(&rate_control));
+    can_send_now_repeat(5, 0, 10);
+    CHECK_EQUAL(35, a2dp_source_rate_control_get_bitpool(&rate_control));
+    // no further events once at min bitpool and congested
+    CHECK_EQUAL(3, rate_control_event_count);
+}
+
+TEST(A2dpSourceRateControl, increase_on_acl_queue_draining){
+    can_send_now_repeat(4, 0, 4);
+    CHECK_EQUAL(41, a2dp_source_rate_control_get_bitpool(&rate_control));
+
+    can_send_now_repeat(1, 5, 49);
+    CHECK_EQUAL(41, a2dp_source_rate_control_get_bitpool(&rate_control));
+    can_send_now(1, 5);
+    CHECK_EQUAL(43, a2dp_source_rate_control_get_bitpool(&rate_control));
+    // SBC frame: 4 + 8 + (8 + 16 * 43 + 7) / 8 = 99 bytes, 882 / 99 = 8 frames
+    CHECK_EQUAL(8, a2dp_source_rate_control_get_num_frames(&rate_control));
+}
+
+TEST(A2dpSourceRateControl, increase_stops_at_max_bitpool){
+    can_send_now_repeat(4, 0, 2);
+    CHECK_EQUAL(47, a2dp_source_rate_control_get_bitpool(&rate_control));
+    can_send_now_repeat(0, 0, 3 * 50);
+    CHECK_EQUAL(53, a2dp_source_rate_control_get_bitpool(&rate_control));
+    CHECK_EQUAL(7, a2dp_source_rate_control_get_num_frames(&rate_control));
+    can_send_now_repeat(0, 0, 2 * 50);
+    CHECK_EQUAL(53, a2dp_source_rate_control_get_bitpool(&rate_control));
+}
+
+TEST(A2dpSourceRateControl, hysteresis_resets_congested_samples){
+    // samples between low and high threshold reset the congested counter
+    can_send_now(4, 0);
+    can_send_now(2, 0);
+    can_send_now(4, 0);
+    can_send_now(0, 10);
+    can_send_now(4, 0);
+    CHECK_EQUAL(53, a2dp_source_rate_control_get_bitpool(&rate_control));
+    CHECK_EQUAL(0, rate_control_event_count);
+}
+
+TEST(A2dpSourceRateControl, hysteresis_resets_clear_samples){
+    can_send_now_repeat(4, 0, 2);
+    CHECK_EQUAL(47, a2dp_source_rate_control_get_bitpool(&rate_control));
+    can_send_now_repeat(0, 0, 49);
+    can_send_now(3, 0);
+    can_send_now_repeat(0, 0, 49);
+    CHECK_EQUAL(47, a2dp_source_rate_control_get_bitpool(&rate_control));
+    can_send_now(0, 0);
+    CHECK_EQUAL(49, a2dp_source_rate_control_get_bitpool(&rate_control));
+}
+
+TEST(A2dpSourceRateControl, stop){
+    a2dp_source_rate_control_stop(&rate_control);
+    can_send_now_repeat(4, 0, 4);
+    CHECK_EQUAL(53, a2dp_source_rate_control_get_bitpool(&rate_control));
+    CHECK_EQUAL(0, rate_control_event_count);
+}
+
+TEST(A2dpSourceRateControl, rate_control_update_event){
+    can_send_now(4, 0);
+    can_send_now(6, 30);
+    CHECK_EQUAL(1, rate_control_event_count);
+    CHECK_EQUAL(HCI_EVENT_A2DP_META, hci_event_packet_get_type(rate_control_event));
+    CHECK_EQUAL(A2DP_SUBEVENT_STREAMING_RATE_CONTROL_UPDATE, hci_event_a2dp_meta_get_subevent_code(rate_control_event));
+    CHECK_EQUAL(TEST_A2DP_CID, a2dp_subevent_streaming_rate_control_update_get_a2dp_cid(rate_control_event));
+    CHECK_EQUAL(TEST_LOCAL_SEID, a2dp_subevent_streaming_rate_control_update_get_local_seid(rate_control_event));
+    CHECK_EQUAL(47, a2dp_subevent_streaming_rate_control_update_get_bitpool(rate_control_event));
+    CHECK_EQUAL(8, a2dp_subevent_streaming_rate_control_update_get_num_frames(rate_control_event));
+    CHECK_EQUAL(1, a2dp_subevent_streaming_rate_control_update_get_congested(rate_control_event));
+    CHECK_EQUAL(6, a2dp_subevent_streaming_rate_control_update_get_acl_packets_queued(rate_control_event));
+    CHECK_EQUAL(30, a2dp_subevent_streaming_rate_control_update_get_can_send_now_latency_ms(rate_control_event));
+
+    // clear again after bitpool back at max
+    can_send_now_repeat(0, 0, 3 * 50);
+    CHECK_EQUAL(4, rate_control_event_count);
+    CHECK_EQUAL(53, a2dp_subevent_streaming_rate_control_update_get_bitpool(rate_control_event));
+    CHECK_EQUAL(7, a2dp_subevent_streaming_rate_control_update_get_num_frames(rate_control_event));
+    CHECK_EQUAL(0, a2dp_subevent_streaming_rate_control_update_get_congested(rate_control_event));
+    CHECK_EQUAL(0, a2dp_subevent_streaming_rate_control_update_get_acl_packets_queued(rate_control_event));
+    CHECK_EQUAL(0, a2dp_subevent_streaming_rate_control_update_get_can_send_now_latency_ms(rate_control_event));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// test AVDTP Source reserve and send of media payloads
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack.h"
+#include "classic/avdtp.h"
+#include "classic/avdtp_source.h"
+
+#define TEST_AVDTP_CID          0x41
+#define TEST_LOCAL_SEID         1
+#define TEST_L2CAP_MEDIA_CID    0x0045
+#define TEST_REMOTE_MTU         672
+#define TEST_RTP_HEADER_SIZE    12
+
+static avdtp_stream_endpoint_t test_stream_endpoint;
+static uint8_t  outgoing_buffer[1024];
+static bool     outgoing_buffer_reserved;
+static uint8_t  send_prepared_status;
+static int      send_prepared_count;
+static uint16_t send_prepared_cid;
+static uint16_t send_prepared_len;
+static uint32_t time_ms;
+
+// mock start
+extern "C" uint8_t avdtp_abort_stream(uint16_t avdtp_cid, uint8_t local_seid){ return ERROR_CODE_SUCCESS; }
+extern "C" uint8_t avdtp_connect(bd_addr_t remote, avdtp_role_t role, uint16_t * avdtp_cid){ return ERROR_CODE_SUCCESS; }
+extern "C" avdtp_stream_endpoint_t * avdtp_create_stream_endpoint(avdtp_sep_type_t sep_type, avdtp_media_type_t media_type){ return NULL; }
+extern "C" void avdtp_init(void){}
+extern "C" void avdtp_deinit(void){}
+extern "C" uint8_t avdtp_disconnect(uint16_t avdtp_cid){ return ERROR_CODE_SUCCESS; }
+extern "C" uint8_t avdtp_discover_stream_endpoints(uint16_t avdtp_cid){ return ERROR_CODE_SUCCESS; }
+extern "C" void avdtp_finalize_stream_endpoint(avdtp_stream_endpoint_t * stream_endpoint){}
+extern "C" uint8_t avdtp_get_all_capabilities(uint16_t avdtp_cid, uint8_t remote_seid, avdtp_role_t role){ return ERROR_CODE_SUCCESS; }
+extern "C" uint8_t avdtp_get_capabilities(uint16_t avdtp_cid, uint8_t remote_seid){ return ERROR_CODE_SUCCESS; }
+extern "C" uint8_t avdtp_get_configuration(uint16_t avdtp_cid, uint8_t remote_seid){ return ERROR_CODE_SUCCESS; }
+extern "C" uint8_t avdtp_open_stream(uint16_t avdtp_cid, uint8_t local_seid, uint8_t remote_seid){ return ERROR_CODE_SUCCESS; }
+extern "C" uint8_t avdtp_reconfigure(uint16_t avdtp_cid, uint8_t local_seid, uint8_t remote_seid, uint16_t configured_services_bitmap, avdtp_capabilities_t configuration){ return ERROR_CODE_SUCCESS; }
+extern "C" void avdtp_register_content_protection_category(avdtp_stream_endpoint_t * stream_endpoint, uint16_t cp_type, const uint8_t * cp_type_value, uint8_t cp_type_value_len){}
+extern "C" void avdtp_register_delay_reporting_category(avdtp_stream_endpoint_t * stream_endpoint){}
+extern "C" void avdtp_register_header_compression_category(avdtp_stream_endpoint_t * stream_endpoint, uint8_t back_ch, uint8_t media, uint8_t recovery){}
+extern "C" void avdtp_register_media_codec_category(avdtp_stream_endpoint_t * stream_endpoint, avdtp_media_type_t media_type, avdtp_media_codec_type_t media_codec_type, const uint8_t *media_codec_info, uint16_t media_codec_info_len){}
+extern "C" void avdtp_register_media_transport_category(avdtp_stream_endpoint_t * stream_endpoint){}
+extern "C" void avdtp_register_multiplexing_category(avdtp_stream_endpoint_t * stream_endpoint, uint8_t fragmentation){}
+extern "C" void avdtp_register_recovery_category(avdtp_stream_endpoint_t * stream_endpoint, uint8_t maximum_recovery_window_size, uint8_t maximum_number_media_packets){}
+extern "C" void avdtp_register_reporting_category(avdtp_stream_endpoint_t * stream_endpoint){}
+extern "C" void avdtp_register_source_packet_handler(btstack_packet_handler_t callback){}
+extern "C" uint8_t avdtp_set_configuration(uint16_t avdtp_cid, uint8_t local_seid, uint8_t remote_seid, uint16_t configured_services_bitmap, avdtp_capabilities_t configuration){ return ERROR_CODE_SUCCESS; }
+extern "C" uint8_t avdtp_start_stream(uint16_t avdtp_cid, uint8_t local_seid){ return ERROR_CODE_SUCCESS; }
+extern "C" uint8_t avdtp_stop_stream(uint16_t avdtp_cid, uint8_t local_seid){ return ERROR_CODE_SUCCESS; }
+extern "C" uint8_t avdtp_suspend_stream(uint16_t avdtp_cid, uint8_t local_seid){ return ERROR_CODE_SUCCESS; }
+extern "C" avdtp_stream_endpoint_t * avdtp_get_stream_endpoint_for_seid(uint16_t seid){
+    if (seid != TEST_LOCAL_SEID) return NULL;
+    return &test_stream_endpoint;
+}
+extern "C" uint32_t btstack_run_loop_get_time_ms(void){
+    return time_ms;
+}
+extern "C" bool hci_is_packet_buffer_reserved(void){
+    return outgoing_buffer_reserved;
+}
+extern "C" bool l2cap_reserve_packet_buffer(void){
+    if (outgoing_buffer_reserved) return false;
+    outgoing_buffer_reserved = true;
+    return true;
+}
+extern "C" void l2cap_release_packet_buffer(void){
+    outgoing_buffer_reserved = false;
+}
+extern "C" uint8_t * l2cap_get_outgoing_buffer(void){
+    return outgoing_buffer;
+}
+extern "C" uint16_t l2cap_get_remote_mtu_for_local_cid(uint16_t local_cid){
+    return TEST_REMOTE_MTU;
+}
+extern "C" uint8_t l2cap_request_can_send_now_event(uint16_t local_cid){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t l2cap_send(uint16_t local_cid, const uint8_t *data, uint16_t len){
+    return ERROR_CODE_SUCCESS;
+}
+extern "C" uint8_t l2cap_send_prepared(uint16_t local_cid, uint16_t len){
+    CHECK(outgoing_buffer_reserved);
+    send_prepared_count++;
+    send_prepared_cid = local_cid;
+    send_prepared_len = len;
+    if (send_prepared_status == ERROR_CODE_SUCCESS){
+        // buffer is released by HCI after sending
+        outgoing_buffer_reserved = false;
+    }
+    return send_prepared_status;
+}
+// mock end
+
+TEST_GROUP(AvdtpSourceMediaPayload){
+    void setup(){
+        memset(&test_stream_endpoint, 0, sizeof(test_stream_endpoint));
+        memset(outgoing_buffer, 0, sizeof(outgoing_buffer));
+        test_stream_endpoint.l2cap_media_cid = TEST_L2CAP_MEDIA_CID;
+        test_stream_endpoint.state = AVDTP_STREAM_ENDPOINT_STREAMING;
+        test_stream_endpoint.sequence_number = 0x1234;
+        outgoing_buffer_reserved = false;
+        send_prepared_status = ERROR_CODE_SUCCESS;
+        send_prepared_count = 0;
+        send_prepared_cid = 0;
+        send_prepared_len = 0;
+        time_ms = 0x01020304;
+    }
+};
+
+TEST(AvdtpSourceMediaPayload, reserve_payload_after_rtp_header){
+    uint16_t max_payload_size = 0;
+    uint8_t * payload = avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size);
+    CHECK(payload == &outgoing_buffer[TEST_RTP_HEADER_SIZE]);
+    CHECK_EQUAL(TEST_REMOTE_MTU - TEST_RTP_HEADER_SIZE, max_payload_size);
+    CHECK(outgoing_buffer_reserved);
+}
+
+TEST(AvdtpSourceMediaPayload, send_reserved_payload){
+    uint16_t max_payload_size = 0;
+    uint8_t * payload = avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size);
+    uint16_t i;
+    for (i=0;i<100;i++){
+        payload[i] = (uint8_t) i;
+    }
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, avdtp_source_stream_send_reserved_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, 1, 100));
+    CHECK_EQUAL(1, send_prepared_count);
+    CHECK_EQUAL(TEST_L2CAP_MEDIA_CID, send_prepared_cid);
+    CHECK_EQUAL(TEST_RTP_HEADER_SIZE + 100, send_prepared_len);
+
+    // RTP header: version 2, marker, payload type 0x60, sequence number, timestamp, ssrc
+    const uint8_t expected_header[] = { 0x80, 0xe0, 0x12, 0x34, 0x01, 0x02, 0x03, 0x04, 0x11, 0x22, 0x33, 0x44 };
+    MEMCMP_EQUAL(expected_header, outgoing_buffer, sizeof(expected_header));
+    // media payload unchanged
+    for (i=0;i<100;i++){
+        CHECK_EQUAL(i, outgoing_buffer[TEST_RTP_HEADER_SIZE + i]);
+    }
+    CHECK_EQUAL(0x1235, test_stream_endpoint.sequence_number);
+}
+
+TEST(AvdtpSourceMediaPayload, send_reserved_payload_without_marker){
+    uint16_t max_payload_size = 0;
+    (void) avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, avdtp_source_stream_send_reserved_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, 0, max_payload_size));
+    CHECK_EQUAL(TEST_REMOTE_MTU, send_prepared_len);
+    CHECK_EQUAL(0x60, outgoing_buffer[1]);
+}
+
+TEST(AvdtpSourceMediaPayload, send_reserved_payload_exceeds_mtu){
+    uint16_t max_payload_size = 0;
+    (void) avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size);
+    CHECK_EQUAL(ERROR_CODE_MEMORY_CAPACITY_EXCEEDED, avdtp_source_stream_send_reserved_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, 0, max_payload_size + 1));
+    CHECK_EQUAL(0, send_prepared_count);
+    CHECK_FALSE(outgoing_buffer_reserved);
+    CHECK_EQUAL(0x1234, test_stream_endpoint.sequence_number);
+}
+
+TEST(AvdtpSourceMediaPayload, send_reserved_empty_payload){
+    uint16_t max_payload_size = 0;
+    (void) avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, avdtp_source_stream_send_reserved_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, 0, 0));
+    CHECK_EQUAL(0, send_prepared_count);
+    CHECK_FALSE(outgoing_buffer_reserved);
+}
+
+TEST(AvdtpSourceMediaPayload, send_reserved_payload_send_fails){
+    uint16_t max_payload_size = 0;
+    (void) avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size);
+    send_prepared_status = BTSTACK_ACL_BUFFERS_FULL;
+    CHECK_EQUAL(BTSTACK_ACL_BUFFERS_FULL, avdtp_source_stream_send_reserved_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, 0, 10));
+    CHECK_FALSE(outgoing_buffer_reserved);
+}
+
+TEST(AvdtpSourceMediaPayload, send_without_reserve){
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, avdtp_source_stream_send_reserved_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, 0, 10));
+    CHECK_EQUAL(0, send_prepared_count);
+    CHECK_FALSE(outgoing_buffer_reserved);
+    CHECK_EQUAL(0x1234, test_stream_endpoint.sequence_number);
+}
+
+TEST(AvdtpSourceMediaPayload, reserve_while_buffer_in_use){
+    outgoing_buffer_reserved = true;
+    uint16_t max_payload_size = 0xffff;
+    CHECK(avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size) == NULL);
+    CHECK_EQUAL(0, max_payload_size);
+}
+
+TEST(AvdtpSourceMediaPayload, reserve_unknown_stream_endpoint){
+    uint16_t max_payload_size = 0xffff;
+    CHECK(avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID + 1, &max_payload_size) == NULL);
+    CHECK_EQUAL(0, max_payload_size);
+    CHECK_FALSE(outgoing_buffer_reserved);
+}
+
+TEST(AvdtpSourceMediaPayload, reserve_without_media_connection){
+    test_stream_endpoint.l2cap_media_cid = 0;
+    uint16_t max_payload_size = 0xffff;
+    CHECK(avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size) == NULL);
+    CHECK_EQUAL(0, max_payload_size);
+    CHECK_FALSE(outgoing_buffer_reserved);
+}
+
+TEST(AvdtpSourceMediaPayload, reserve_not_streaming){
+    test_stream_endpoint.state = AVDTP_STREAM_ENDPOINT_OPENED;
+    uint16_t max_payload_size = 0xffff;
+    CHECK(avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size) == NULL);
+    CHECK_EQUAL(0, max_payload_size);
+    CHECK_FALSE(outgoing_buffer_reserved);
+}
+
+TEST(AvdtpSourceMediaPayload, send_reserved_after_media_disconnect){
+    uint16_t max_payload_size = 0;
+    (void) avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size);
+    test_stream_endpoint.l2cap_media_cid = 0;
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, avdtp_source_stream_send_reserved_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, 0, 10));
+    CHECK_EQUAL(0, send_prepared_count);
+    CHECK_FALSE(outgoing_buffer_reserved);
+}
+
+TEST(AvdtpSourceMediaPayload, send_reserved_not_streaming){
+    uint16_t max_payload_size = 0;
+    (void) avdtp_source_stream_reserve_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, &max_payload_size);
+    test_stream_endpoint.state = AVDTP_STREAM_ENDPOINT_OPENED;
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, avdtp_source_stream_send_reserved_media_payload(TEST_AVDTP_CID, TEST_LOCAL_SEID, 0, 10));
+    CHECK_EQUAL(0, send_prepared_count);
+    CHECK_FALSE(outgoing_buffer_reserved);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
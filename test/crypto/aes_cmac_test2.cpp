@@ -138,6 +138,141 @@ TEST(AES_CMAC,CMAC_40){
     CHECK_EQUAL_ARRAY(cmac, cmac_calculated, 16);
 }
 
+static const char fips_key_string[]        = "00010203 04050607 08090a0b 0c0d0e0f";
+static const char fips_plaintext_string[]  = "00112233 44556677 8899aabb ccddeeff";
+static const char fips_ciphertext_string[] = "69c4e0d8 6a7b0430 d8cdb780 70b4c55a";
+
+TEST_GROUP(AES128_ENGINE){
+    void teardown(void){
+        btstack_crypto_set_aes128_engine(btstack_crypto_aes128_rijndael_get_instance());
+    }
+    void check_engine(const btstack_aes128_engine_t * engine){
+        uint8_t k[16];
+        uint8_t pt[16];
+        uint8_t ct[16];
+        uint8_t ct_calculated[16];
+        parse_hex(k, fips_key_string);
+        parse_hex(pt, fips_plaintext_string);
+        parse_hex(ct, fips_ciphertext_string);
+        btstack_crypto_set_aes128_engine(engine);
+        btstack_aes128_key_schedule_t key_schedule;
+        btstack_aes128_set_key(&key_schedule, k);
+        btstack_aes128_encrypt(&key_schedule, pt, ct_calculated);
+        CHECK_EQUAL_ARRAY(ct, ct_calculated, 16);
+        memset(ct_calculated, 0, 16);
+        btstack_aes128_calc(k, pt, ct_calculated);
+        CHECK_EQUAL_ARRAY(ct, ct_calculated, 16);
+    }
+};
+
+TEST(AES128_ENGINE, Rijndael){
+    check_engine(btstack_crypto_aes128_rijndael_get_instance());
+}
+
+#ifdef __AES__
+TEST(AES128_ENGINE, AESNI){
+    check_engine(btstack_crypto_aes128_aesni_get_instance());
+}
+#endif
+
+TEST(AES128_ENGINE, KeyChange){
+    uint8_t k1[16];
+    uint8_t k2[16];
+    uint8_t pt[16];
+    uint8_t ct[16];
+    uint8_t ct_calculated[16];
+    parse_hex(k1, fips_key_string);
+    parse_hex(k2, key_string);
+    parse_hex(pt, fips_plaintext_string);
+    parse_hex(ct, fips_ciphertext_string);
+    // cached key schedule must not be used for different key
+    btstack_aes128_calc(k1, pt, ct_calculated);
+    CHECK_EQUAL_ARRAY(ct, ct_calculated, 16);
+    btstack_aes128_calc(k2, pt, ct_calculated);
+    CHECK(memcmp(ct, ct_calculated, 16) != 0);
+    btstack_aes128_calc(k1, pt, ct_calculated);
+    CHECK_EQUAL_ARRAY(ct, ct_calculated, 16);
+    // CMAC after key change
+    uint8_t cmac[16];
+    uint8_t m[16];
+    parse_hex(m, example_16_string);
+    parse_hex(cmac, cmac_16_string);
+    btstack_crypto_aes128_cmac_message(&cmac_context, k2, 16, m, cmac_calculated, gatt_hash_calculated, NULL);
+    CHECK_EQUAL_ARRAY(cmac, cmac_calculated, 16);
+}
+
+// rijndael engine that counts key expansions
+static int set_key_count;
+static void counting_set_key(btstack_aes128_key_schedule_t * key_schedule, const uint8_t * key){
+    set_key_count++;
+    (*btstack_crypto_aes128_rijndael_get_instance()->set_key)(key_schedule, key);
+}
+static void counting_encrypt(const btstack_aes128_key_schedule_t * key_schedule, const uint8_t * plaintext, uint8_t * ciphertext){
+    (*btstack_crypto_aes128_rijndael_get_instance()->encrypt)(key_schedule, plaintext, ciphertext);
+}
+static const btstack_aes128_engine_t counting_engine = {
+    &counting_set_key,
+    &counting_encrypt,
+    NULL,
+};
+
+TEST_GROUP(AES128_KEY_SCHEDULE){
+    void setup(void){
+        btstack_crypto_set_aes128_engine(&counting_engine);
+        set_key_count = 0;
+    }
+    void teardown(void){
+        btstack_crypto_set_aes128_engine(btstack_crypto_aes128_rijndael_get_instance());
+    }
+};
+
+TEST(AES128_KEY_SCHEDULE, ExpandedOncePerOperation){
+    uint8_t k[16];
+    uint8_t cmac[16];
+    uint8_t m[40];
+    parse_hex(k, key_string);
+    parse_hex(m, example_40_string);
+    parse_hex(cmac, cmac_40_string);
+    btstack_crypto_aes128_cmac_message(&cmac_context, k, 40, m, cmac_calculated, gatt_hash_calculated, NULL);
+    CHECK_EQUAL_ARRAY(cmac, cmac_calculated, 16);
+    CHECK_EQUAL(1, set_key_count);
+}
+
+TEST(AES128_KEY_SCHEDULE, ClearedAfterOperation){
+    uint8_t k[16];
+    uint8_t cmac[16];
+    uint8_t m[16];
+    parse_hex(k, key_string);
+    parse_hex(m, example_16_string);
+    parse_hex(cmac, cmac_16_string);
+    btstack_crypto_aes128_cmac_message(&cmac_context, k, 16, m, cmac_calculated, gatt_hash_calculated, NULL);
+    CHECK_EQUAL_ARRAY(cmac, cmac_calculated, 16);
+    // same key is expanded again for next operation
+    btstack_crypto_aes128_cmac_message(&cmac_context, k, 16, m, cmac_calculated, gatt_hash_calculated, NULL);
+    CHECK_EQUAL_ARRAY(cmac, cmac_calculated, 16);
+    CHECK_EQUAL(2, set_key_count);
+}
+
+TEST(AES128_KEY_SCHEDULE, EngineSwitch){
+    uint8_t k[16];
+    uint8_t pt[16];
+    uint8_t ct[16];
+    uint8_t ct_calculated[16];
+    parse_hex(k, fips_key_string);
+    parse_hex(pt, fips_plaintext_string);
+    parse_hex(ct, fips_ciphertext_string);
+    btstack_aes128_calc(k, pt, ct_calculated);
+    CHECK_EQUAL(1, set_key_count);
+    // direct calls don't use the cached key schedule
+    btstack_aes128_calc(k, pt, ct_calculated);
+    CHECK_EQUAL(2, set_key_count);
+    btstack_crypto_set_aes128_engine(btstack_crypto_aes128_rijndael_get_instance());
+    memset(ct_calculated, 0, 16);
+    btstack_aes128_calc(k, pt, ct_calculated);
+    CHECK_EQUAL_ARRAY(ct, ct_calculated, 16);
+    CHECK_EQUAL(2, set_key_count);
+}
+
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
 }
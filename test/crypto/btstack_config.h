@@ -19,7 +19,10 @@
 #define ENABLE_LOG_ERROR
 #define ENABLE_LOG_INFO
 #define ENABLE_PRINTF_HEXDUMP
+// crypto_batch_controller_test uses HCI LE Encrypt
+#ifndef UNIT_TEST_CONTROLLER_AES128
 #define ENABLE_SOFTWARE_AES128
+#endif
 
 // BTstack configuration. buffers, sizes, ...
 #define HCI_ACL_PAYLOAD_SIZE 1024
@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+// *****************************************************************************
+//
+// test batched processing of crypto requests with ENABLE_CRYPTO_BATCH
+//
+// - software AES128: requests are processed from the run loop in batches
+// - Controller AES128 (UNIT_TEST_CONTROLLER_AES128): HCI LE Encrypt commands are pipelined
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "hci.h"
+#include "hci_cmd.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "btstack_run_loop.h"
+#include "bluetooth.h"
+#include "btstack_crypto.h"
+
+extern "C" {
+#include "aes_cmac.h"
+}
+
+#define NUM_REQUESTS 20
+#define BATCH_SIZE   8
+
+static const uint8_t cmac_key[] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+static const uint8_t cmac_message[] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+};
+// RFC 4493 example 3, 40 byte message
+static const uint8_t cmac_40_expected[] = { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 };
+
+static btstack_crypto_aes128_t      aes128_requests[NUM_REQUESTS];
+static btstack_crypto_aes128_cmac_t cmac_request;
+static uint8_t keys[NUM_REQUESTS][16];
+static uint8_t plaintexts[NUM_REQUESTS][16];
+static uint8_t ciphertexts[NUM_REQUESTS][16];
+static uint8_t cmac_result[16];
+
+// callback order, AES128 requests report their index, CMAC reports CMAC_DONE
+#define CMAC_DONE 0xff
+static uint8_t  done_order[NUM_REQUESTS + 2];
+static uint16_t done_count;
+
+static void request_done(void * context){
+    CHECK(done_count < sizeof(done_order));
+    done_order[done_count++] = (uint8_t) (uintptr_t) context;
+}
+
+static void check_aes128_result(uint8_t index){
+    uint8_t expected[16];
+    aes128_calc_cyphertext(keys[index], plaintexts[index], expected);
+    MEMCMP_EQUAL(expected, ciphertexts[index], 16);
+}
+
+static void start_aes128(uint8_t index){
+    btstack_crypto_aes128_encrypt(&aes128_requests[index], keys[index], plaintexts[index], ciphertexts[index], &request_done, (void *) (uintptr_t) index);
+}
+
+// mock hci
+static btstack_packet_callback_registration_t * hci_event_handler;
+static bool     hci_can_send_command;
+static uint16_t hci_le_encrypt_sent;
+static uint8_t  hci_le_encrypt_pending[NUM_REQUESTS * 2][32];
+static uint16_t hci_le_encrypt_pending_count;
+
+extern "C" {
+    void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+        hci_event_handler = callback_handler;
+    }
+    bool hci_can_send_command_packet_now(void){
+        return hci_can_send_command;
+    }
+    HCI_STATE hci_get_state(void){
+        return HCI_STATE_WORKING;
+    }
+    void hci_halting_defer(void){
+    }
+    uint8_t hci_send_cmd(const hci_cmd_t *cmd, ...){
+        uint8_t packet[40];
+        va_list argptr;
+        va_start(argptr, cmd);
+        (void) hci_cmd_create_from_template(packet, cmd, argptr);
+        va_end(argptr);
+        if (cmd->opcode == hci_le_encrypt.opcode){
+            CHECK(hci_le_encrypt_pending_count < (sizeof(hci_le_encrypt_pending) / 32));
+            // key and plaintext are sent little endian
+            memcpy(hci_le_encrypt_pending[hci_le_encrypt_pending_count++], &packet[3], 32);
+            hci_le_encrypt_sent++;
+        }
+        return ERROR_CODE_SUCCESS;
+    }
+}
+
+// Controller reports result of oldest LE Encrypt command
+static void controller_le_encrypt_complete(void){
+    CHECK(hci_le_encrypt_pending_count > 0);
+    uint8_t key[16];
+    uint8_t plaintext[16];
+    uint8_t ciphertext[16];
+    reverse_128(&hci_le_encrypt_pending[0][0],  key);
+    reverse_128(&hci_le_encrypt_pending[0][16], plaintext);
+    hci_le_encrypt_pending_count--;
+    memmove(hci_le_encrypt_pending[0], hci_le_encrypt_pending[1], hci_le_encrypt_pending_count * 32);
+    aes128_calc_cyphertext(key, plaintext, ciphertext);
+
+    uint8_t event[22] = { HCI_EVENT_COMMAND_COMPLETE, 20, 0x01, 0x00, 0x00, ERROR_CODE_SUCCESS };
+    little_endian_store_16(event, 3, hci_le_encrypt.opcode);
+    reverse_128(ciphertext, &event[6]);
+    (*hci_event_handler->callback)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+// mock run loop
+static btstack_timer_source_t * run_loop_timer;
+
+extern "C" {
+    void btstack_run_loop_set_timer_handler(btstack_timer_source_t * timer, void (*process)(btstack_timer_source_t * _timer)){
+        timer->process = process;
+    }
+    void btstack_run_loop_set_timer(btstack_timer_source_t * timer, uint32_t timeout_in_ms){
+        UNUSED(timer);
+        CHECK_EQUAL(0, timeout_in_ms);
+    }
+    void btstack_run_loop_add_timer(btstack_timer_source_t * timer){
+        CHECK(run_loop_timer == NULL);
+        run_loop_timer = timer;
+    }
+    int btstack_run_loop_remove_timer(btstack_timer_source_t * timer){
+        if (run_loop_timer != timer) return 0;
+        run_loop_timer = NULL;
+        return 1;
+    }
+}
+
+static bool run_loop_process_timer(void){
+    btstack_timer_source_t * timer = run_loop_timer;
+    if (timer == NULL) return false;
+    run_loop_timer = NULL;
+    (*timer->process)(timer);
+    return true;
+}
+
+static void halt_stack(void){
+    uint8_t event[] = { BTSTACK_EVENT_STATE, 1, HCI_STATE_HALTING };
+    (*hci_event_handler->callback)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+TEST_GROUP(CryptoBatch){
+    void setup(void){
+        uint8_t i;
+        for (i = 0; i < NUM_REQUESTS; i++){
+            memset(keys[i], 0x10 + i, 16);
+            memset(plaintexts[i], 0xf0 - i, 16);
+            memset(ciphertexts[i], 0, 16);
+        }
+        memset(cmac_result, 0, sizeof(cmac_result));
+        done_count = 0;
+        hci_can_send_command = true;
+        hci_le_encrypt_sent = 0;
+        hci_le_encrypt_pending_count = 0;
+        run_loop_timer = NULL;
+        btstack_crypto_init();
+    }
+    void teardown(void){
+        // drop pending requests
+        halt_stack();
+        run_loop_timer = NULL;
+    }
+};
+
+#ifndef UNIT_TEST_CONTROLLER_AES128
+
+TEST(CryptoBatch, AES128DeliveredFromRunLoopInBatches){
+    uint8_t i;
+    for (i = 0; i < NUM_REQUESTS; i++){
+        start_aes128(i);
+    }
+    // nothing is processed from the API call
+    CHECK_EQUAL(0, done_count);
+
+    run_loop_process_timer();
+    CHECK_EQUAL(BATCH_SIZE, done_count);
+    run_loop_process_timer();
+    CHECK_EQUAL(2 * BATCH_SIZE, done_count);
+    run_loop_process_timer();
+    CHECK_EQUAL(NUM_REQUESTS, done_count);
+    CHECK_FALSE(run_loop_process_timer());
+
+    for (i = 0; i < NUM_REQUESTS; i++){
+        CHECK_EQUAL(i, done_order[i]);
+        check_aes128_result(i);
+    }
+    CHECK_EQUAL(0, hci_le_encrypt_sent);
+}
+
+TEST(CryptoBatch, SameKeyInBatch){
+    uint8_t i;
+    for (i = 0; i < 4; i++){
+        memset(keys[i], 0x42, 16);
+        start_aes128(i);
+    }
+    run_loop_process_timer();
+    CHECK_EQUAL(4, done_count);
+    for (i = 0; i < 4; i++){
+        check_aes128_result(i);
+    }
+}
+
+TEST(CryptoBatch, CMACBetweenAES128){
+    uint8_t i;
+    for (i = 0; i < 3; i++){
+        start_aes128(i);
+    }
+    btstack_crypto_aes128_cmac_message(&cmac_request, cmac_key, sizeof(cmac_message), cmac_message, cmac_result, &request_done, (void *) (uintptr_t) CMAC_DONE);
+    for (i = 3; i < 6; i++){
+        start_aes128(i);
+    }
+    while (run_loop_process_timer()){
+    }
+
+    // delivered in request order
+    CHECK_EQUAL(7, done_count);
+    const uint8_t expected_order[] = { 0, 1, 2, CMAC_DONE, 3, 4, 5 };
+    MEMCMP_EQUAL(expected_order, done_order, sizeof(expected_order));
+    MEMCMP_EQUAL(cmac_40_expected, cmac_result, 16);
+    for (i = 0; i < 6; i++){
+        check_aes128_result(i);
+    }
+}
+
+static void request_done_start_next(void * context){
+    request_done(context);
+    if (context == (void *) 0){
+        // queued behind requests that are already pending
+        start_aes128(3);
+        CHECK_EQUAL(1, done_count);
+    }
+}
+
+TEST(CryptoBatch, RequestFromCallbackIsQueued){
+    uint8_t i;
+    for (i = 0; i < 3; i++){
+        btstack_crypto_aes128_encrypt(&aes128_requests[i], keys[i], plaintexts[i], ciphertexts[i], &request_done_start_next, (void *) (uintptr_t) i);
+    }
+    while (run_loop_process_timer()){
+    }
+    CHECK_EQUAL(4, done_count);
+    const uint8_t expected_order[] = { 0, 1, 2, 3 };
+    MEMCMP_EQUAL(expected_order, done_order, sizeof(expected_order));
+    for (i = 0; i < 4; i++){
+        check_aes128_result(i);
+    }
+}
+
+TEST(CryptoBatch, HaltDropsBatch){
+    start_aes128(0);
+    CHECK(run_loop_timer != NULL);
+    halt_stack();
+    CHECK(run_loop_timer == NULL);
+    CHECK_EQUAL(0, done_count);
+}
+
+#else
+
+TEST(CryptoBatch, LEEncryptPipelined){
+    uint8_t i;
+    for (i = 0; i < NUM_REQUESTS; i++){
+        start_aes128(i);
+    }
+    // up to BATCH_SIZE commands in flight
+    CHECK_EQUAL(BATCH_SIZE, hci_le_encrypt_sent);
+    CHECK_EQUAL(BATCH_SIZE, hci_le_encrypt_pending_count);
+
+    // each result frees a slot for the next request
+    controller_le_encrypt_complete();
+    CHECK_EQUAL(1, done_count);
+    CHECK_EQUAL(BATCH_SIZE + 1, hci_le_encrypt_sent);
+    CHECK_EQUAL(BATCH_SIZE, hci_le_encrypt_pending_count);
+
+    while (hci_le_encrypt_pending_count > 0){
+        controller_le_encrypt_complete();
+    }
+    CHECK_EQUAL(NUM_REQUESTS, done_count);
+    CHECK_EQUAL(NUM_REQUESTS, hci_le_encrypt_sent);
+    for (i = 0; i < NUM_REQUESTS; i++){
+        CHECK_EQUAL(i, done_order[i]);
+        check_aes128_result(i);
+    }
+}
+
+TEST(CryptoBatch, LEEncryptNotPipelinedWhenControllerIsBusy){
+    uint8_t i;
+    start_aes128(0);
+    CHECK_EQUAL(1, hci_le_encrypt_sent);
+
+    // controller busy, no further commands are pipelined
+    hci_can_send_command = false;
+    start_aes128(1);
+    start_aes128(2);
+    CHECK_EQUAL(1, hci_le_encrypt_sent);
+    controller_le_encrypt_complete();
+    CHECK_EQUAL(1, done_count);
+    CHECK_EQUAL(1, hci_le_encrypt_sent);
+    hci_can_send_command = true;
+    start_aes128(3);
+    CHECK_EQUAL(4, hci_le_encrypt_sent);
+
+    while (hci_le_encrypt_pending_count > 0){
+        controller_le_encrypt_complete();
+    }
+    CHECK_EQUAL(4, done_count);
+    for (i = 0; i < 4; i++){
+        CHECK_EQUAL(i, done_order[i]);
+        check_aes128_result(i);
+    }
+}
+
+TEST(CryptoBatch, LEEncryptPipelineStopsAtCMAC){
+    uint8_t i;
+    for (i = 0; i < 3; i++){
+        start_aes128(i);
+    }
+    btstack_crypto_aes128_cmac_message(&cmac_request, cmac_key, sizeof(cmac_message), cmac_message, cmac_result, &request_done, (void *) (uintptr_t) CMAC_DONE);
+    for (i = 3; i < 6; i++){
+        start_aes128(i);
+    }
+    // CMAC is not pipelined
+    CHECK_EQUAL(3, hci_le_encrypt_sent);
+
+    while (hci_le_encrypt_pending_count > 0){
+        controller_le_encrypt_complete();
+    }
+    CHECK_EQUAL(7, done_count);
+    const uint8_t expected_order[] = { 0, 1, 2, CMAC_DONE, 3, 4, 5 };
+    MEMCMP_EQUAL(expected_order, done_order, sizeof(expected_order));
+    MEMCMP_EQUAL(cmac_40_expected, cmac_result, 16);
+    for (i = 0; i < 6; i++){
+        check_aes128_result(i);
+    }
+}
+
+#endif
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// Throughput benchmark for AES128 engines and batched btstack_crypto requests
+// requires ENABLE_SOFTWARE_AES128 and ENABLE_CRYPTO_BATCH, build with -march=native to include AES-NI engine
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "btstack_crypto.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_posix.h"
+#include "btstack_util.h"
+#include "hci.h"
+
+#include "aes_cmac.h"
+
+#define BENCHMARK_BLOCKS   200000
+#define BENCHMARK_REQUESTS 64
+#define BENCHMARK_ROUNDS   2000
+#define BENCHMARK_CMAC_LEN 64
+
+// mock
+void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    UNUSED(callback_handler);
+}
+bool hci_can_send_command_packet_now(void){
+    return true;
+}
+HCI_STATE hci_get_state(void){
+    return HCI_STATE_WORKING;
+}
+uint8_t hci_send_cmd(const hci_cmd_t * cmd, ...){
+    UNUSED(cmd);
+    return ERROR_CODE_SUCCESS;
+}
+
+static uint8_t keys[BENCHMARK_REQUESTS][16];
+static uint8_t plaintext[BENCHMARK_REQUESTS][16];
+static uint8_t ciphertext[BENCHMARK_REQUESTS][16];
+static uint8_t message[BENCHMARK_CMAC_LEN];
+
+static btstack_crypto_aes128_t      aes128_requests[BENCHMARK_REQUESTS];
+static btstack_crypto_aes128_cmac_t cmac_requests[BENCHMARK_REQUESTS];
+static uint16_t requests_pending;
+static uint16_t rounds_remaining;
+static bool     benchmark_cmac;
+static double   benchmark_start_us;
+static bool     benchmark_failed;
+
+static double benchmark_time_us(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double) now.tv_sec * 1000000.0) + ((double) now.tv_nsec / 1000.0);
+}
+
+static void benchmark_report(const char * name, uint32_t blocks, double duration_us){
+    printf("%-40s %10.0f blocks/s %8.2f MB/s\n", name, (blocks * 1000000.0) / duration_us, (blocks * 16.0) / duration_us);
+}
+
+static void benchmark_engine(const char * name, const btstack_aes128_engine_t * engine){
+    char label[60];
+    uint32_t i;
+    double start;
+    btstack_aes128_key_schedule_t key_schedules[BENCHMARK_REQUESTS];
+    const btstack_aes128_key_schedule_t * key_schedule_pointers[BENCHMARK_REQUESTS];
+
+    btstack_crypto_set_aes128_engine(engine);
+
+    // new key for every block
+    start = benchmark_time_us();
+    for (i = 0; i < BENCHMARK_BLOCKS; i++){
+        btstack_aes128_set_key(&key_schedules[0], keys[i % BENCHMARK_REQUESTS]);
+        btstack_aes128_encrypt(&key_schedules[0], plaintext[0], ciphertext[0]);
+    }
+    snprintf(label, sizeof(label), "%s: key setup + encrypt", name);
+    benchmark_report(label, BENCHMARK_BLOCKS, benchmark_time_us() - start);
+
+    // same key, btstack_aes128_calc expands the key schedule on every call
+    start = benchmark_time_us();
+    for (i = 0; i < BENCHMARK_BLOCKS; i++){
+        btstack_aes128_calc(keys[0], plaintext[i % BENCHMARK_REQUESTS], ciphertext[0]);
+    }
+    snprintf(label, sizeof(label), "%s: same key", name);
+    benchmark_report(label, BENCHMARK_BLOCKS, benchmark_time_us() - start);
+
+    // independent blocks with different keys
+    for (i = 0; i < BENCHMARK_REQUESTS; i++){
+        btstack_aes128_set_key(&key_schedules[i], keys[i]);
+        key_schedule_pointers[i] = &key_schedules[i];
+    }
+    start = benchmark_time_us();
+    for (i = 0; i < (BENCHMARK_BLOCKS / BENCHMARK_REQUESTS); i++){
+        btstack_aes128_encrypt_blocks(key_schedule_pointers, &plaintext[0][0], &ciphertext[0][0], BENCHMARK_REQUESTS);
+    }
+    snprintf(label, sizeof(label), "%s: multi-block", name);
+    benchmark_report(label, (BENCHMARK_BLOCKS / BENCHMARK_REQUESTS) * BENCHMARK_REQUESTS, benchmark_time_us() - start);
+}
+
+static void benchmark_check_results(void){
+    uint16_t i;
+    for (i = 0; i < BENCHMARK_REQUESTS; i++){
+        uint8_t expected[16];
+        if (benchmark_cmac){
+            aes_cmac(expected, keys[i], message, BENCHMARK_CMAC_LEN);
+        } else {
+            aes128_calc_cyphertext(keys[i], plaintext[i], expected);
+        }
+        if (memcmp(expected, ciphertext[i], 16) != 0){
+            printf("%s: result %u wrong\n", benchmark_cmac ? "btstack_crypto_aes128_cmac_message" : "btstack_crypto_aes128_encrypt", i);
+            benchmark_failed = true;
+        }
+    }
+}
+
+static void benchmark_request_done(void * arg);
+static void benchmark_requests(bool cmac);
+
+static void benchmark_requests_start(void){
+    uint16_t i;
+    requests_pending = BENCHMARK_REQUESTS;
+    for (i = 0; i < BENCHMARK_REQUESTS; i++){
+        if (benchmark_cmac){
+            btstack_crypto_aes128_cmac_message(&cmac_requests[i], keys[i], BENCHMARK_CMAC_LEN, message, ciphertext[i], &benchmark_request_done, NULL);
+        } else {
+            btstack_crypto_aes128_encrypt(&aes128_requests[i], keys[i], plaintext[i], ciphertext[i], &benchmark_request_done, NULL);
+        }
+    }
+}
+
+static void benchmark_request_done(void * arg){
+    UNUSED(arg);
+    requests_pending--;
+    if (requests_pending > 0u) return;
+    rounds_remaining--;
+    if (rounds_remaining > 0u){
+        benchmark_requests_start();
+        return;
+    }
+    double duration_us = benchmark_time_us() - benchmark_start_us;
+    benchmark_check_results();
+    if (benchmark_cmac){
+        // CMAC: subkey generation + one block per 16 bytes
+        benchmark_report("btstack_crypto_aes128_cmac_message", BENCHMARK_ROUNDS * BENCHMARK_REQUESTS * (1u + (BENCHMARK_CMAC_LEN / 16u)), duration_us);
+        btstack_run_loop_trigger_exit();
+    } else {
+        benchmark_report("btstack_crypto_aes128_encrypt", BENCHMARK_ROUNDS * BENCHMARK_REQUESTS, duration_us);
+        benchmark_requests(true);
+    }
+}
+
+static void benchmark_requests(bool cmac){
+    benchmark_cmac = cmac;
+    rounds_remaining = BENCHMARK_ROUNDS;
+    benchmark_start_us = benchmark_time_us();
+    benchmark_requests_start();
+}
+
+int main(void){
+    uint16_t i;
+    for (i = 0; i < BENCHMARK_REQUESTS; i++){
+        memset(keys[i], (int) i, 16);
+        memset(plaintext[i], (int) (0xff - i), 16);
+    }
+    memset(message, 0x55, sizeof(message));
+
+    btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+    btstack_crypto_init();
+
+    benchmark_engine("rijndael", btstack_crypto_aes128_rijndael_get_instance());
+#ifdef __AES__
+    benchmark_engine("aes-ni", btstack_crypto_aes128_aesni_get_instance());
+#endif
+
+    // requests are processed in batches from the run loop
+    benchmark_requests(false);
+    btstack_run_loop_execute();
+    return benchmark_failed ? 1 : 0;
+}
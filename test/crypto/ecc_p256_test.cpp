@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2024 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// Tests for ECC P-256 key pool and executor, requires ENABLE_MICRO_ECC_P256 and ENABLE_ECC_P256_KEY_POOL
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "hci.h"
+#include "btstack_util.h"
+#include "btstack_crypto.h"
+#include "uECC.h"
+
+#ifndef BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE
+#define BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE 2
+#endif
+
+static btstack_packet_callback_registration_t * event_callback_registration;
+static uint16_t num_le_rand_pending;
+static uint16_t num_le_rand_commands;
+static uint8_t  random_counter;
+
+// mock
+extern "C" {
+    void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+        event_callback_registration = callback_handler;
+    }
+    bool hci_can_send_command_packet_now(void){
+        return true;
+    }
+    HCI_STATE hci_get_state(void){
+        return HCI_STATE_WORKING;
+    }
+    void hci_halting_defer(void){
+    }
+    uint8_t hci_send_cmd(const hci_cmd_t *cmd, ...){
+        if (cmd->opcode == hci_le_rand.opcode){
+            num_le_rand_pending++;
+            num_le_rand_commands++;
+        }
+        return ERROR_CODE_SUCCESS;
+    }
+}
+
+// deliver LE Rand results until no more commands are sent
+static void mock_process(void){
+    while (num_le_rand_pending > 0u){
+        num_le_rand_pending--;
+        uint8_t event[] = { HCI_EVENT_COMMAND_COMPLETE, 12, 1, 0x18, 0x20, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+        uint8_t i;
+        for (i = 0; i < 8u; i++){
+            event[6u + i] = random_counter;
+            random_counter += 97u;
+        }
+        (*event_callback_registration->callback)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    }
+}
+
+static int test_rng(uint8_t * dest, unsigned size){
+    while (size > 0u){
+        *dest++ = random_counter;
+        random_counter += 31u;
+        size--;
+    }
+    return 1;
+}
+
+// no random data available, as set by btstack_crypto after key generation
+static int no_rng(uint8_t * dest, unsigned size){
+    UNUSED(dest);
+    UNUSED(size);
+    return 0;
+}
+
+// executor that runs work only when requested by test
+static btstack_context_callback_registration_t * deferred_work;
+static btstack_context_callback_registration_t * deferred_done;
+
+static void deferred_execute(btstack_context_callback_registration_t * work, btstack_context_callback_registration_t * done){
+    CHECK(deferred_work == NULL);
+    deferred_work = work;
+    deferred_done = done;
+}
+
+static const btstack_crypto_ecc_p256_executor_t deferred_executor = {
+    &deferred_execute
+};
+
+static bool deferred_complete(void){
+    if (deferred_work == NULL) return false;
+    btstack_context_callback_registration_t * work = deferred_work;
+    btstack_context_callback_registration_t * done = deferred_done;
+    deferred_work = NULL;
+    deferred_done = NULL;
+    (*work->callback)(work->context);
+    (*done->callback)(done->context);
+    return true;
+}
+
+// deliver HCI events and complete executor work until idle
+static void process_all(void){
+    do {
+        mock_process();
+    } while (deferred_complete());
+}
+
+static uint16_t num_callbacks;
+
+static void handle_crypto_done(void * arg){
+    UNUSED(arg);
+    num_callbacks++;
+}
+
+TEST_GROUP(ECC_P256){
+    btstack_crypto_ecc_p256_t request;
+    uint8_t public_key[64];
+
+    void setup(void){
+        num_callbacks = 0;
+        num_le_rand_pending = 0;
+        num_le_rand_commands = 0;
+        deferred_work = NULL;
+        deferred_done = NULL;
+        btstack_crypto_ecc_p256_set_executor(NULL);
+        btstack_crypto_reset();
+    }
+
+    void teardown(void){
+        btstack_crypto_ecc_p256_set_executor(NULL);
+    }
+
+    void generate_key(void){
+        uint16_t callbacks = num_callbacks;
+        btstack_crypto_ecc_p256_generate_key(&request, public_key, &handle_crypto_done, NULL);
+        process_all();
+        CHECK_EQUAL(callbacks + 1, num_callbacks);
+    }
+
+    // create peer key pair and check DH Key calculated by btstack_crypto
+    void check_dhkey(void){
+        uint8_t peer_public_key[64];
+        uint8_t peer_private_key[32];
+        uint8_t dhkey[32];
+        uint8_t dhkey_expected[32];
+        uECC_set_rng(&test_rng);
+        CHECK(uECC_make_key(peer_public_key, peer_private_key));
+        CHECK(uECC_shared_secret(public_key, peer_private_key, dhkey_expected));
+        uECC_set_rng(&no_rng);
+
+        uint16_t callbacks = num_callbacks;
+        btstack_crypto_ecc_p256_calculate_dhkey(&request, peer_public_key, dhkey, &handle_crypto_done, NULL);
+        process_all();
+        CHECK_EQUAL(callbacks + 1, num_callbacks);
+        MEMCMP_EQUAL(dhkey_expected, dhkey, 32);
+    }
+};
+
+TEST(ECC_P256, KeyPoolNotFilledBeforeFirstUse){
+    // other crypto operations don't start pool refill
+    btstack_crypto_random_t random_request;
+    uint8_t random[8];
+    btstack_crypto_random_generate(&random_request, random, sizeof(random), &handle_crypto_done, NULL);
+    process_all();
+    CHECK_EQUAL(1, num_callbacks);
+    CHECK_EQUAL(1, num_le_rand_commands);
+    CHECK_EQUAL(0, btstack_crypto_ecc_p256_key_pool_count());
+    CHECK(btstack_crypto_idle());
+}
+
+TEST(ECC_P256, KeyPoolFilledWhenIdle){
+    generate_key();
+    CHECK_EQUAL(BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE, btstack_crypto_ecc_p256_key_pool_count());
+    CHECK(btstack_crypto_idle());
+}
+
+TEST(ECC_P256, GenerateKeyFromPool){
+    generate_key();
+    uint8_t previous_public_key[64];
+    memcpy(previous_public_key, public_key, 64);
+
+    // key pair is provided without HCI LE Rand
+    num_le_rand_commands = 0;
+    btstack_crypto_ecc_p256_generate_key(&request, public_key, &handle_crypto_done, NULL);
+    CHECK_EQUAL(2, num_callbacks);
+    CHECK(memcmp(previous_public_key, public_key, 64) != 0);
+    CHECK(uECC_valid_public_key(public_key) != 0);
+
+    // pool refilled afterwards with 64 random bytes
+    CHECK_EQUAL(1, num_le_rand_pending);
+    mock_process();
+    CHECK_EQUAL(8, num_le_rand_commands);
+    CHECK_EQUAL(BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE, btstack_crypto_ecc_p256_key_pool_count());
+    check_dhkey();
+}
+
+TEST(ECC_P256, DHKey){
+    generate_key();
+    check_dhkey();
+    check_dhkey();
+}
+
+TEST(ECC_P256, Executor){
+    btstack_crypto_ecc_p256_set_executor(&deferred_executor);
+    // pool key pairs also generated by executor
+    generate_key();
+    CHECK_EQUAL(BTSTACK_CRYPTO_ECC_P256_KEY_POOL_SIZE, btstack_crypto_ecc_p256_key_pool_count());
+
+    // DH Key calculation is deferred until executor completes
+    uint8_t peer_public_key[64];
+    uint8_t peer_private_key[32];
+    uint8_t dhkey[32];
+    uint8_t dhkey_expected[32];
+    uECC_set_rng(&test_rng);
+    CHECK(uECC_make_key(peer_public_key, peer_private_key));
+    CHECK(uECC_shared_secret(public_key, peer_private_key, dhkey_expected));
+    uECC_set_rng(&no_rng);
+    btstack_crypto_ecc_p256_calculate_dhkey(&request, peer_public_key, dhkey, &handle_crypto_done, NULL);
+
+    // key generation queued behind DH Key calculation has to wait
+    btstack_crypto_ecc_p256_t request_2;
+    uint8_t public_key_2[64];
+    btstack_crypto_ecc_p256_generate_key(&request_2, public_key_2, &handle_crypto_done, NULL);
+    CHECK_EQUAL(1, num_callbacks);
+    CHECK(deferred_work != NULL);
+
+    CHECK(deferred_complete());
+    MEMCMP_EQUAL(dhkey_expected, dhkey, 32);
+    // DH Key callback and key pair from pool
+    CHECK_EQUAL(3, num_callbacks);
+    memcpy(public_key, public_key_2, 64);
+    check_dhkey();
+}
+
+TEST(ECC_P256, ExecutorResultIgnoredAfterReset){
+    btstack_crypto_ecc_p256_set_executor(&deferred_executor);
+    btstack_crypto_ecc_p256_generate_key(&request, public_key, &handle_crypto_done, NULL);
+    mock_process();
+    CHECK(deferred_work != NULL);
+
+    // stack shutdown while key generation is running on executor
+    uint8_t halting_event[] = { BTSTACK_EVENT_STATE, 1, HCI_STATE_HALTING };
+    (*event_callback_registration->callback)(HCI_EVENT_PACKET, 0, halting_event, sizeof(halting_event));
+
+    // new key generation waits for running work, pool refill got random data
+    btstack_crypto_ecc_p256_t request_2;
+    uint8_t public_key_2[64];
+    btstack_crypto_ecc_p256_generate_key(&request_2, public_key_2, &handle_crypto_done, NULL);
+    mock_process();
+
+    // result of running work is ignored
+    CHECK(deferred_complete());
+    CHECK_EQUAL(0, num_callbacks);
+
+    // key pair is generated for pool and used for request instead of the ignored result
+    CHECK(deferred_complete());
+    CHECK_EQUAL(1, num_callbacks);
+    CHECK_EQUAL(0, btstack_crypto_ecc_p256_key_pool_count());
+    process_all();
+    CHECK(uECC_valid_public_key(public_key_2) != 0);
+    memcpy(public_key, public_key_2, 64);
+    check_dhkey();
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
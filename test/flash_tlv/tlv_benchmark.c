@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// Benchmark for btstack_tlv_flash_bank with and without tag index on hal_flash_bank_memory
+// reports time and number of flash read calls per operation
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "btstack_tlv.h"
+#include "btstack_tlv_flash_bank.h"
+#include "btstack_util.h"
+#include "hal_flash_bank_memory.h"
+
+#define BENCHMARK_BANK_SIZE    (32 * 1024)
+#define BENCHMARK_NUM_TAGS     64
+#define BENCHMARK_VALUE_SIZE   32
+#define BENCHMARK_OVERWRITES   8
+#define BENCHMARK_ROUNDS       200
+#define BENCHMARK_INDEX_SIZE   96
+
+static uint8_t hal_flash_bank_memory_storage[2 * BENCHMARK_BANK_SIZE];
+static hal_flash_bank_memory_t hal_flash_bank_memory_context;
+static const hal_flash_bank_t * hal_flash_bank_memory_impl;
+
+static btstack_tlv_flash_bank_tag_index_entry_t tag_index[BENCHMARK_INDEX_SIZE];
+
+// count flash reads by wrapping hal_flash_bank_memory
+static uint32_t flash_reads;
+static hal_flash_bank_t hal_flash_bank_counting;
+
+static void hal_flash_bank_counting_read(void * context, int bank, uint32_t offset, uint8_t * buffer, uint32_t size){
+    flash_reads++;
+    hal_flash_bank_memory_impl->read(context, bank, offset, buffer, size);
+}
+
+static double benchmark_time_us(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double) now.tv_sec * 1000000.0) + ((double) now.tv_nsec / 1000.0);
+}
+
+static uint32_t benchmark_tag(uint16_t index){
+    return ('B' << 24) | ('T' << 16) | ('D' << 8) | index;
+}
+
+static void benchmark_report(const char * name, uint32_t operations, double start_us, uint32_t start_reads){
+    double duration_us = benchmark_time_us() - start_us;
+    printf("%-40s %10.3f us/op %8.1f reads/op\n", name, duration_us / operations, (double) (flash_reads - start_reads) / operations);
+}
+
+static void benchmark(bool use_index){
+    btstack_tlv_flash_bank_t btstack_tlv_flash_bank_context;
+    const btstack_tlv_t * btstack_tlv_impl;
+    uint8_t value[BENCHMARK_VALUE_SIZE];
+    char label[60];
+    const char * name = use_index ? "tag index" : "scan";
+    uint16_t i;
+    uint16_t round;
+    double start;
+    uint32_t start_reads;
+
+    hal_flash_bank_memory_impl = hal_flash_bank_memory_init_instance(&hal_flash_bank_memory_context, hal_flash_bank_memory_storage, sizeof(hal_flash_bank_memory_storage));
+    hal_flash_bank_counting = *hal_flash_bank_memory_impl;
+    hal_flash_bank_counting.read = &hal_flash_bank_counting_read;
+
+    btstack_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_flash_bank_context, &hal_flash_bank_counting, &hal_flash_bank_memory_context);
+    if (use_index){
+        btstack_tlv_flash_bank_enable_tag_index(&btstack_tlv_flash_bank_context, tag_index, BENCHMARK_INDEX_SIZE);
+    }
+
+    // fill bank with current and deleted entries
+    memset(value, 0x55, sizeof(value));
+    start = benchmark_time_us();
+    start_reads = flash_reads;
+    for (round = 0; round < BENCHMARK_OVERWRITES; round++){
+        for (i = 0; i < BENCHMARK_NUM_TAGS; i++){
+            value[0] = (uint8_t) round;
+            btstack_tlv_impl->store_tag(&btstack_tlv_flash_bank_context, benchmark_tag(i), value, sizeof(value));
+        }
+    }
+    snprintf(label, sizeof(label), "%s: store_tag", name);
+    benchmark_report(label, BENCHMARK_OVERWRITES * BENCHMARK_NUM_TAGS, start, start_reads);
+
+    start = benchmark_time_us();
+    start_reads = flash_reads;
+    for (round = 0; round < BENCHMARK_ROUNDS; round++){
+        for (i = 0; i < BENCHMARK_NUM_TAGS; i++){
+            btstack_tlv_impl->get_tag(&btstack_tlv_flash_bank_context, benchmark_tag(i), value, sizeof(value));
+            if (value[0] != (BENCHMARK_OVERWRITES - 1)){
+                printf("%s: tag %u wrong value\n", name, i);
+            }
+        }
+    }
+    snprintf(label, sizeof(label), "%s: get_tag", name);
+    benchmark_report(label, BENCHMARK_ROUNDS * BENCHMARK_NUM_TAGS, start, start_reads);
+
+    start = benchmark_time_us();
+    start_reads = flash_reads;
+    for (round = 0; round < BENCHMARK_ROUNDS; round++){
+        btstack_tlv_impl->get_tag(&btstack_tlv_flash_bank_context, benchmark_tag(0xff), value, sizeof(value));
+    }
+    snprintf(label, sizeof(label), "%s: get_tag (missing)", name);
+    benchmark_report(label, BENCHMARK_ROUNDS, start, start_reads);
+
+    start = benchmark_time_us();
+    start_reads = flash_reads;
+    for (i = 0; i < BENCHMARK_NUM_TAGS; i++){
+        btstack_tlv_impl->delete_tag(&btstack_tlv_flash_bank_context, benchmark_tag(i));
+    }
+    snprintf(label, sizeof(label), "%s: delete_tag", name);
+    benchmark_report(label, BENCHMARK_NUM_TAGS, start, start_reads);
+}
+
+int main(void){
+    benchmark(false);
+    benchmark(true);
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include "hal_flash_bank_memory.h"
 #include "btstack_tlv.h"
 #include "btstack_tlv_flash_bank.h"
+#include "btstack_tlv_write_cache.h"
 #include "hci_dump.h"
 #include "hci_dump_posix_fs.h"
 #include "classic/btstack_link_key_db.h"
@@ -245,6 +246,95 @@ TEST(BSTACK_TLV, TestWriteResetRead){
     CHECK_EQUAL(buffer, data);
 }
 
+static bool iterate_callback(void * context, uint32_t tag, uint32_t value_size){
+    uint32_t * sum = (uint32_t *) context;
+    sum[0]++;
+    sum[1] += value_size;
+    return true;
+}
+
+TEST(BSTACK_TLV, TestIterateTags){
+    btstack_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_context, hal_flash_bank_impl, &hal_flash_bank_context);
+    uint8_t data[4] = { 1, 2, 3, 4 };
+    btstack_tlv_impl->store_tag(&btstack_tlv_context, 'BTD\0', data, 1);
+    btstack_tlv_impl->store_tag(&btstack_tlv_context, 'BTD\1', data, 2);
+    btstack_tlv_impl->store_tag(&btstack_tlv_context, 'BTD\1', data, 3);
+    btstack_tlv_impl->store_tag(&btstack_tlv_context, 'BTD\2', data, 4);
+    btstack_tlv_impl->store_tag(&btstack_tlv_context, 'BTL\0', data, 4);
+    btstack_tlv_impl->delete_tag(&btstack_tlv_context, 'BTD\2');
+    btstack_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_context, hal_flash_bank_impl, &hal_flash_bank_context);
+
+    // deleted and overwritten entries are skipped
+    uint32_t sum[2] = { 0, 0 };
+    btstack_tlv_iterate_tags(btstack_tlv_impl, &btstack_tlv_context, 'BTD\0', 'BTD\377', &iterate_callback, sum);
+    CHECK_EQUAL(2, sum[0]);
+    CHECK_EQUAL(4, sum[1]);
+}
+
+static void check_tags(const btstack_tlv_t * btstack_tlv_impl, btstack_tlv_flash_bank_t * btstack_tlv_context, const int * values, int num_tags){
+    int i;
+    for (i=0;i<num_tags;i++){
+        uint8_t buffer = 0;
+        int size = btstack_tlv_impl->get_tag(btstack_tlv_context, 'BTD\0' + i, &buffer, 1);
+        if (values[i] < 0){
+            CHECK_EQUAL(0, size);
+        } else {
+            CHECK_EQUAL(1, size);
+            CHECK_EQUAL(values[i], buffer);
+        }
+    }
+}
+
+TEST(BSTACK_TLV, TestTagIndex){
+    btstack_tlv_flash_bank_tag_index_entry_t tag_index[7];
+    int values[6];
+    int i;
+    for (i=0;i<6;i++){
+        values[i] = -1;
+    }
+    btstack_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_context, hal_flash_bank_impl, &hal_flash_bank_context);
+    btstack_tlv_flash_bank_enable_tag_index(&btstack_tlv_context, tag_index, 7);
+
+    // random stores and deletes with frequent migrations, compare with index disabled after re-init
+    srand(1234);
+    for (i=0;i<2000;i++){
+        int tag_nr = rand() % 6;
+        if ((rand() % 4) == 0){
+            btstack_tlv_impl->delete_tag(&btstack_tlv_context, 'BTD\0' + tag_nr);
+            values[tag_nr] = -1;
+        } else {
+            uint8_t value = (uint8_t) (rand() & 0xff);
+            btstack_tlv_impl->store_tag(&btstack_tlv_context, 'BTD\0' + tag_nr, &value, 1);
+            values[tag_nr] = value;
+        }
+        CHECK_EQUAL(1, btstack_tlv_context.tag_index_valid);
+        check_tags(btstack_tlv_impl, &btstack_tlv_context, values, 6);
+        if ((i % 100) == 99){
+            btstack_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_context, hal_flash_bank_impl, &hal_flash_bank_context);
+            check_tags(btstack_tlv_impl, &btstack_tlv_context, values, 6);
+            btstack_tlv_flash_bank_enable_tag_index(&btstack_tlv_context, tag_index, 7);
+        }
+    }
+}
+
+TEST(BSTACK_TLV, TestTagIndexFull){
+    btstack_tlv_flash_bank_tag_index_entry_t tag_index[3];
+    int values[4] = { 1, 2, 3, 4 };
+    btstack_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_context, hal_flash_bank_impl, &hal_flash_bank_context);
+    btstack_tlv_flash_bank_enable_tag_index(&btstack_tlv_context, tag_index, 3);
+    int i;
+    for (i=0;i<4;i++){
+        uint8_t value = (uint8_t) values[i];
+        btstack_tlv_impl->store_tag(&btstack_tlv_context, 'BTD\0' + i, &value, 1);
+    }
+    // falls back to scanning the bank
+    CHECK_EQUAL(0, btstack_tlv_context.tag_index_valid);
+    check_tags(btstack_tlv_impl, &btstack_tlv_context, values, 4);
+    btstack_tlv_impl->delete_tag(&btstack_tlv_context, 'BTD\3');
+    values[3] = -1;
+    check_tags(btstack_tlv_impl, &btstack_tlv_context, values, 4);
+}
+
 //
 TEST_GROUP(LINK_KEY_DB){
 	const hal_flash_bank_t * hal_flash_bank_impl;
@@ -326,6 +416,147 @@ TEST(LINK_KEY_DB, KeyReplacement){
     CHECK(btstack_link_key_db->get_link_key(addr1, test_link_key, &test_link_key_type) == 0);
     CHECK_EQUAL_ARRAY(link_key1, test_link_key, 16);
 }
+// mock run loop timer for write cache
+static btstack_timer_source_t * mock_timer;
+
+extern "C" void btstack_run_loop_set_timer(btstack_timer_source_t * timer, uint32_t timeout_in_ms){
+    timer->timeout = timeout_in_ms;
+}
+extern "C" void btstack_run_loop_set_timer_handler(btstack_timer_source_t * timer, void (*process)(btstack_timer_source_t * _timer)){
+    timer->process = process;
+}
+extern "C" void btstack_run_loop_set_timer_context(btstack_timer_source_t * timer, void * context){
+    timer->context = context;
+}
+extern "C" void * btstack_run_loop_get_timer_context(btstack_timer_source_t * timer){
+    return timer->context;
+}
+extern "C" void btstack_run_loop_add_timer(btstack_timer_source_t * timer){
+    mock_timer = timer;
+}
+extern "C" int btstack_run_loop_remove_timer(btstack_timer_source_t * timer){
+    if (mock_timer != timer) return 0;
+    mock_timer = NULL;
+    return 1;
+}
+
+static void mock_timer_fire(void){
+    btstack_timer_source_t * timer = mock_timer;
+    mock_timer = NULL;
+    timer->process(timer);
+}
+
+// count writes to underlying TLV
+static const btstack_tlv_t * counting_tlv_impl;
+static int counting_tlv_writes;
+
+static int counting_tlv_get_tag(void * context, uint32_t tag, uint8_t * buffer, uint32_t buffer_size){
+    return counting_tlv_impl->get_tag(context, tag, buffer, buffer_size);
+}
+static int counting_tlv_store_tag(void * context, uint32_t tag, const uint8_t * data, uint32_t data_size){
+    counting_tlv_writes++;
+    return counting_tlv_impl->store_tag(context, tag, data, data_size);
+}
+static void counting_tlv_delete_tag(void * context, uint32_t tag){
+    counting_tlv_writes++;
+    counting_tlv_impl->delete_tag(context, tag);
+}
+static const btstack_tlv_t counting_tlv = {
+    &counting_tlv_get_tag,
+    &counting_tlv_store_tag,
+    &counting_tlv_delete_tag,
+    NULL,
+};
+
+TEST_GROUP(TLV_WRITE_CACHE){
+    const hal_flash_bank_t * hal_flash_bank_impl;
+    hal_flash_bank_memory_t  hal_flash_bank_context;
+    btstack_tlv_flash_bank_t btstack_tlv_flash_bank_context;
+
+    btstack_tlv_write_cache_entry_t entries[2];
+    btstack_tlv_write_cache_t       btstack_tlv_write_cache_context;
+    const btstack_tlv_t *           btstack_tlv_impl;
+
+    void setup(void){
+        hal_flash_bank_impl = hal_flash_bank_memory_init_instance(&hal_flash_bank_context, hal_flash_bank_memory_storage, HAL_FLASH_BANK_MEMORY_STORAGE_SIZE);
+        counting_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_flash_bank_context, hal_flash_bank_impl, &hal_flash_bank_context);
+        counting_tlv_writes = 0;
+        mock_timer = NULL;
+        btstack_tlv_impl = btstack_tlv_write_cache_init_instance(&btstack_tlv_write_cache_context, &counting_tlv, &btstack_tlv_flash_bank_context, entries, 2, 1000);
+    }
+    int get_value(uint32_t tag){
+        uint8_t value = 0;
+        int size = btstack_tlv_impl->get_tag(&btstack_tlv_write_cache_context, tag, &value, 1);
+        if (size == 0) return -1;
+        return value;
+    }
+    int get_stored_value(uint32_t tag){
+        uint8_t value = 0;
+        int size = counting_tlv_impl->get_tag(&btstack_tlv_flash_bank_context, tag, &value, 1);
+        if (size == 0) return -1;
+        return value;
+    }
+};
+
+TEST(TLV_WRITE_CACHE, RepeatedStores){
+    uint8_t i;
+    for (i=0;i<10;i++){
+        btstack_tlv_impl->store_tag(&btstack_tlv_write_cache_context, 'abcd', &i, 1);
+        CHECK_EQUAL(i, get_value('abcd'));
+    }
+    CHECK_EQUAL(0, counting_tlv_writes);
+    CHECK_EQUAL(-1, get_stored_value('abcd'));
+    CHECK(mock_timer != NULL);
+    mock_timer_fire();
+    CHECK_EQUAL(1, counting_tlv_writes);
+    CHECK_EQUAL(9, get_stored_value('abcd'));
+
+    // unchanged value is not written again
+    i = 9;
+    btstack_tlv_impl->store_tag(&btstack_tlv_write_cache_context, 'abcd', &i, 1);
+    CHECK(mock_timer == NULL);
+
+    btstack_tlv_write_cache_statistics_t statistics;
+    CHECK_TRUE(btstack_tlv_write_cache_get_tag_statistics(&btstack_tlv_write_cache_context, 'abcd', &statistics));
+    CHECK_EQUAL(11, statistics.num_requests);
+    CHECK_EQUAL(1, statistics.num_writes);
+}
+
+TEST(TLV_WRITE_CACHE, StoreDelete){
+    uint8_t value = 1;
+    counting_tlv_impl->store_tag(&btstack_tlv_flash_bank_context, 'abcd', &value, 1);
+    btstack_tlv_impl->store_tag(&btstack_tlv_write_cache_context, 'abcd', &value, 1);
+    btstack_tlv_impl->delete_tag(&btstack_tlv_write_cache_context, 'abcd');
+    CHECK_EQUAL(-1, get_value('abcd'));
+    CHECK_EQUAL(1, get_stored_value('abcd'));
+    btstack_tlv_write_cache_flush(&btstack_tlv_write_cache_context);
+    CHECK(mock_timer == NULL);
+    CHECK_EQUAL(-1, get_stored_value('abcd'));
+    // store and delete result in single delete
+    CHECK_EQUAL(1, counting_tlv_writes);
+}
+
+TEST(TLV_WRITE_CACHE, CacheFull){
+    uint8_t value = 1;
+    btstack_tlv_impl->store_tag(&btstack_tlv_write_cache_context, 'aaaa', &value, 1);
+    btstack_tlv_impl->store_tag(&btstack_tlv_write_cache_context, 'bbbb', &value, 1);
+    CHECK_EQUAL(0, counting_tlv_writes);
+    // all entries dirty, pending changes are written
+    value = 2;
+    btstack_tlv_impl->store_tag(&btstack_tlv_write_cache_context, 'cccc', &value, 1);
+    CHECK_EQUAL(2, counting_tlv_writes);
+    CHECK_EQUAL(1, get_value('bbbb'));
+    // 'aaaa' was least recently used
+    btstack_tlv_impl->store_tag(&btstack_tlv_write_cache_context, 'dddd', &value, 1);
+    btstack_tlv_write_cache_statistics_t statistics;
+    CHECK_FALSE(btstack_tlv_write_cache_get_tag_statistics(&btstack_tlv_write_cache_context, 'aaaa', &statistics));
+    CHECK_EQUAL(1, get_value('aaaa'));
+    mock_timer_fire();
+    CHECK_EQUAL(2, get_stored_value('dddd'));
+    btstack_tlv_write_cache_get_statistics(&btstack_tlv_write_cache_context, &statistics);
+    CHECK_EQUAL(4, statistics.num_requests);
+    CHECK_EQUAL(4, statistics.num_writes);
+}
 
 int main (int argc, const char * argv[]){
     // log into file using HCI_DUMP_PACKETLOGGER format
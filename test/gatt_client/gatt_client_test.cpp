@@ -700,6 +700,126 @@ TEST(GATTClient, TestWriteReliableLongCharacteristicValue){
 }
 
 
+static uint8_t discover_database_status;
+
+static void handle_discover_database_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+	if (packet_type != HCI_EVENT_PACKET) return;
+	if (packet[0] != GATT_EVENT_QUERY_COMPLETE) return;
+	gatt_query_complete = 1;
+	discover_database_status = packet[4];
+}
+
+TEST(GATTClient, TestDiscoverDatabase){
+	static uint8_t storage[1000];
+	gatt_client_database_t database;
+	gatt_client_database_init(&database, storage, sizeof(storage));
+
+	reset_query_state();
+	status = gatt_client_discover_database(handle_discover_database_event, gatt_client_handle, &database);
+	CHECK_EQUAL(0, status);
+	CHECK_EQUAL(1, gatt_query_complete);
+	CHECK_EQUAL(ATT_ERROR_SUCCESS, discover_database_status);
+
+	// compare with primary services and characteristics of service F000 discovered individually
+	test = DISCOVER_PRIMARY_SERVICES;
+	reset_query_state();
+	status = gatt_client_discover_primary_services(handle_ble_client_event, gatt_client_handle);
+	CHECK_EQUAL(0, status);
+
+	int num_primary_services = 0;
+	int num_secondary_services = 0;
+	int num_characteristics = 0;
+	int num_descriptors = 0;
+	uint16_t f100_value_handle = 0;
+	uint16_t f100_descriptors[3];
+	gatt_client_database_iterator_t it;
+	gatt_client_database_iterator_init(&it, &database);
+	while (gatt_client_database_iterator_has_next(&it)){
+		gatt_client_service_t service;
+		gatt_client_characteristic_t characteristic;
+		gatt_client_characteristic_descriptor_t descriptor;
+		switch (gatt_client_database_iterator_next(&it)){
+			case GATT_CLIENT_DATABASE_RECORD_PRIMARY_SERVICE:
+				gatt_client_database_iterator_get_service(&it, &service);
+				CHECK_EQUAL(services[num_primary_services].start_group_handle, service.start_group_handle);
+				CHECK_EQUAL(services[num_primary_services].end_group_handle, service.end_group_handle);
+				CHECK_EQUAL_ARRAY(services[num_primary_services].uuid128, service.uuid128, 16);
+				num_primary_services++;
+				break;
+			case GATT_CLIENT_DATABASE_RECORD_SECONDARY_SERVICE:
+				num_secondary_services++;
+				break;
+			case GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC:
+				gatt_client_database_iterator_get_characteristic(&it, &characteristic);
+				if (characteristic.uuid16 == 0xF100){
+					f100_value_handle = characteristic.value_handle;
+				}
+				num_characteristics++;
+				break;
+			case GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC_DESCRIPTOR:
+				gatt_client_database_iterator_get_characteristic_descriptor(&it, &descriptor);
+				if ((descriptor.handle > f100_value_handle) && (descriptor.handle <= (f100_value_handle + 3))){
+					f100_descriptors[descriptor.handle - f100_value_handle - 1] = descriptor.uuid16;
+				}
+				num_descriptors++;
+				break;
+			default:
+				FAIL("unexpected record");
+				break;
+		}
+	}
+	CHECK_EQUAL(6, num_primary_services);
+	CHECK_EQUAL(3, num_secondary_services);
+	CHECK_EQUAL(39, num_characteristics);
+	CHECK(num_descriptors > 0);
+	CHECK_EQUAL(0x2902, f100_descriptors[0]);
+	CHECK_EQUAL(0x2900, f100_descriptors[1]);
+	CHECK_EQUAL(0x2901, f100_descriptors[2]);
+
+	// characteristics of service F000 match individual discovery
+	test = DISCOVER_CHARACTERISTICS_FOR_SERVICE_WITH_UUID16;
+	reset_query_state();
+	gatt_client_discover_primary_services_by_uuid16(handle_ble_client_event, gatt_client_handle, service_uuid16);
+	reset_query_state();
+	gatt_client_discover_characteristics_for_service(handle_ble_client_event, gatt_client_handle, &services[0]);
+	int index = 0;
+	gatt_client_database_iterator_init(&it, &database);
+	while (gatt_client_database_iterator_has_next(&it)){
+		if (gatt_client_database_iterator_next(&it) != GATT_CLIENT_DATABASE_RECORD_CHARACTERISTIC) continue;
+		gatt_client_characteristic_t characteristic;
+		gatt_client_database_iterator_get_characteristic(&it, &characteristic);
+		if (characteristic.start_handle < services[0].start_group_handle) continue;
+		if (characteristic.start_handle > services[0].end_group_handle) continue;
+		CHECK_EQUAL(characteristics[index].start_handle, characteristic.start_handle);
+		CHECK_EQUAL(characteristics[index].value_handle, characteristic.value_handle);
+		CHECK_EQUAL(characteristics[index].end_handle, characteristic.end_handle);
+		CHECK_EQUAL(characteristics[index].properties, characteristic.properties);
+		CHECK_EQUAL_ARRAY(characteristics[index].uuid128, characteristic.uuid128, 16);
+		index++;
+	}
+	CHECK_EQUAL(15, index);
+
+	// restore from storage
+	gatt_client_database_t restored;
+	CHECK_EQUAL(true, gatt_client_database_init_with_storage(&restored, storage, sizeof(storage), database.len));
+	CHECK_EQUAL(database.len, restored.len);
+	CHECK_EQUAL(false, gatt_client_database_init_with_storage(&restored, storage, sizeof(storage), database.len - 1));
+	CHECK_EQUAL(0, restored.len);
+}
+
+TEST(GATTClient, TestDiscoverDatabaseStorageFull){
+	uint8_t storage[20];
+	gatt_client_database_t database;
+	gatt_client_database_init(&database, storage, sizeof(storage));
+	reset_query_state();
+	status = gatt_client_discover_database(handle_discover_database_event, gatt_client_handle, &database);
+	CHECK_EQUAL(0, status);
+	CHECK_EQUAL(1, gatt_query_complete);
+	CHECK_EQUAL(ATT_ERROR_INSUFFICIENT_RESOURCES, discover_database_status);
+	CHECK(database.len <= sizeof(storage));
+}
+
+
 int main (int argc, const char * argv[]){
 	att_set_db(profile_data);
 	att_set_write_callback(&att_write_callback);
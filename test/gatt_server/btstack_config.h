@@ -13,8 +13,10 @@
 
 // BTstack features that can be enabled
 #define ENABLE_ATT_DELAYED_RESPONSE
+#define ENABLE_ATT_NOTIFICATION_QUEUE
 #define ENABLE_BLE
 #define ENABLE_CLASSIC
+#define ENABLE_GATT_ROBUST_CACHING
 #define ENABLE_MICRO_ECC_FOR_LE_SECURE_CONNECTIONS
 #define ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
 #define ENABLE_LE_CENTRAL
@@ -19,12 +19,16 @@
 #include "ble/att_db_util.h"
 #include "ble/att_server.h"
 #include "btstack_util.h"
+#include "btstack_event.h"
 #include "bluetooth.h"
 #include "btstack_tlv.h"
 #include "mock_btstack_tlv.h"
 
 #include "bluetooth_gatt.h"
 
+// compile_gatt generated database with static Database Hash
+#include "robust_caching.h"
+
 static uint8_t battery_level = 100;
 static const uint8_t uuid128_with_bluetooth_base[] = { 0x00, 0x00, 0xBB, 0xBB, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB};
 static const uint8_t uuid128_no_bluetooth_base[] =   { 0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0xAA, 0xAA, 0x00, 0x00 };
@@ -322,6 +326,809 @@ TEST(ATT_SERVER, connection_disconnect_complete_event) {
 }
 
 
+extern "C" const uint8_t * mock_l2cap_get_sent_packet(uint16_t * len);
+
+static bool db_hash_calculated;
+static uint8_t database_hash_get_next(uint16_t pos){
+    UNUSED(pos);
+    return att_database_hash_get_next();
+}
+static void db_hash_calculated_callback(void * arg){
+    UNUSED(arg);
+    db_hash_calculated = true;
+}
+
+TEST_GROUP(ATT_SERVER_ROBUST_CACHING){
+    uint16_t att_con_handle;
+    mock_btstack_tlv_t tlv_context;
+    const btstack_tlv_t * tlv_impl;
+    uint16_t service_changed_handle;
+    uint16_t service_changed_ccc_handle;
+    uint16_t database_hash_handle;
+    uint16_t client_supported_features_handle;
+    uint16_t battery_level_handle;
+
+    void setup(void){
+        att_con_handle = 0x01;
+
+        hci_setup_le_connection(att_con_handle);
+
+        tlv_impl = mock_btstack_tlv_init_instance(&tlv_context);
+        btstack_tlv_set_instance(tlv_impl, &tlv_context);
+
+        l2cap_can_send_fixed_channel_packet_now_set_status(1);
+
+        // GATT Service with Service Changed, Database Hash and Client Supported Features
+        att_db_util_init();
+        att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_GENERIC_ATTRIBUTE);
+        service_changed_handle = att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_GATT_SERVICE_CHANGED, ATT_PROPERTY_INDICATE, ATT_SECURITY_NONE, ATT_SECURITY_NONE, NULL, 0);
+        service_changed_ccc_handle = service_changed_handle + 1;
+        database_hash_handle = att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_DATABASE_HASH, ATT_PROPERTY_READ | ATT_PROPERTY_DYNAMIC, ATT_SECURITY_NONE, ATT_SECURITY_NONE, NULL, 0);
+        client_supported_features_handle = att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_CLIENT_SUPPORTED_FEATURES, ATT_PROPERTY_READ | ATT_PROPERTY_WRITE | ATT_PROPERTY_DYNAMIC, ATT_SECURITY_NONE, ATT_SECURITY_NONE, NULL, 0);
+        att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_BATTERY_SERVICE);
+        battery_level_handle = att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL, ATT_PROPERTY_READ, ATT_SECURITY_NONE, ATT_SECURITY_NONE, &battery_level, 1);
+        att_server_init(att_db_util_get_address(), att_read_callback, att_write_callback);
+
+        // reset connection state
+        uint8_t buffer[21];
+        memset(buffer, 0, sizeof(buffer));
+        buffer[0] = HCI_EVENT_LE_META;
+        buffer[1] = 19;
+        buffer[2] = HCI_SUBEVENT_LE_CONNECTION_COMPLETE;
+        little_endian_store_16(buffer, 4, att_con_handle);
+        mock_call_att_packet_handler(HCI_EVENT_PACKET, 0, &buffer[0], sizeof(buffer));
+
+        // bonded with le device index 0
+        hci_setup_le_connection(att_con_handle);
+    }
+
+    void teardown(void) {
+        mock_btstack_tlv_deinit(&tlv_context);
+        hci_deinit();
+    }
+
+    const uint8_t * send_request(const uint8_t * request, uint16_t request_len, uint16_t * response_len){
+        (void)memcpy(att_request, request, request_len);
+        mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], request_len);
+        return mock_l2cap_get_sent_packet(response_len);
+    }
+
+    const uint8_t * read_request(uint16_t attribute_handle, uint16_t * response_len){
+        uint8_t request[3];
+        request[0] = ATT_READ_REQUEST;
+        little_endian_store_16(request, 1, attribute_handle);
+        return send_request(request, sizeof(request), response_len);
+    }
+
+    const uint8_t * write_request(uint16_t attribute_handle, const uint8_t * value, uint16_t value_len, uint16_t * response_len){
+        uint16_t request_len = att_write_request(ATT_WRITE_REQUEST, attribute_handle, value_len, value);
+        mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], request_len);
+        return mock_l2cap_get_sent_packet(response_len);
+    }
+
+    void enable_robust_caching(void){
+        uint16_t response_len;
+        const uint8_t value[] = { 0x01 };
+        const uint8_t * response = write_request(client_supported_features_handle, value, sizeof(value), &response_len);
+        CHECK_EQUAL(1, response_len);
+        CHECK_EQUAL(ATT_WRITE_RESPONSE, response[0]);
+    }
+};
+
+TEST(ATT_SERVER_ROBUST_CACHING, read_database_hash){
+    btstack_crypto_aes128_cmac_t request;
+    uint8_t db_hash[16];
+    uint8_t expected_hash[16];
+    db_hash_calculated = false;
+    att_db_util_hash_calc(&request, db_hash, &db_hash_calculated_callback, NULL);
+    CHECK_TRUE(db_hash_calculated);
+    reverse_128(db_hash, expected_hash);
+
+    uint16_t response_len;
+    const uint8_t * response = read_request(database_hash_handle, &response_len);
+    CHECK_EQUAL(17, response_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+    MEMCMP_EQUAL(expected_hash, &response[1], 16);
+}
+
+TEST(ATT_SERVER_ROBUST_CACHING, client_supported_features){
+    uint16_t response_len;
+    const uint8_t * response;
+
+    enable_robust_caching();
+
+    response = read_request(client_supported_features_handle, &response_len);
+    CHECK_EQUAL(2, response_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+    CHECK_EQUAL(0x01, response[1]);
+
+    // features cannot be disabled
+    const uint8_t value[] = { 0x00 };
+    response = write_request(client_supported_features_handle, value, sizeof(value), &response_len);
+    CHECK_EQUAL(5, response_len);
+    CHECK_EQUAL(ATT_ERROR_RESPONSE, response[0]);
+    CHECK_EQUAL(ATT_ERROR_VALUE_NOT_ALLOWED, response[4]);
+
+    // stored for bonded client
+    uint8_t entry[17];
+    uint32_t tag = ('B' << 24u) | ('T' << 16u) | ('R' << 8u) | 0;
+    int len = tlv_impl->get_tag(&tlv_context, tag, entry, sizeof(entry));
+    CHECK_EQUAL(sizeof(entry), len);
+    CHECK_EQUAL(0x01, entry[16]);
+}
+
+TEST(ATT_SERVER_ROBUST_CACHING, database_out_of_sync){
+    uint16_t response_len;
+    const uint8_t * response;
+
+    enable_robust_caching();
+    att_server_db_changed(att_db_util_get_address(), 0x0001, 0xffff);
+
+    // change-unaware client gets error
+    response = read_request(battery_level_handle, &response_len);
+    CHECK_EQUAL(5, response_len);
+    CHECK_EQUAL(ATT_ERROR_RESPONSE, response[0]);
+    CHECK_EQUAL(ATT_READ_REQUEST, response[1]);
+    CHECK_EQUAL(ATT_ERROR_DATABASE_OUT_OF_SYNC, response[4]);
+
+    // and is change-aware afterwards
+    response = read_request(battery_level_handle, &response_len);
+    CHECK_EQUAL(2, response_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+}
+
+TEST(ATT_SERVER_ROBUST_CACHING, database_hash_read_when_change_unaware){
+    uint16_t response_len;
+    const uint8_t * response;
+
+    enable_robust_caching();
+    att_server_db_changed(att_db_util_get_address(), 0x0001, 0xffff);
+
+    // reading Database Hash by type is allowed
+    uint8_t request[7];
+    request[0] = ATT_READ_BY_TYPE_REQUEST;
+    little_endian_store_16(request, 1, 0x0001);
+    little_endian_store_16(request, 3, 0xffff);
+    little_endian_store_16(request, 5, ORG_BLUETOOTH_CHARACTERISTIC_DATABASE_HASH);
+    response = send_request(request, sizeof(request), &response_len);
+    CHECK_EQUAL(ATT_READ_BY_TYPE_RESPONSE, response[0]);
+
+    response = read_request(battery_level_handle, &response_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+}
+
+TEST(ATT_SERVER_ROBUST_CACHING, service_changed_indication){
+    uint16_t response_len;
+    const uint8_t * response;
+
+    // enable Service Changed indications
+    const uint8_t ccc[] = { 0x02, 0x00 };
+    response = write_request(service_changed_ccc_handle, ccc, sizeof(ccc), &response_len);
+    CHECK_EQUAL(ATT_WRITE_RESPONSE, response[0]);
+    enable_robust_caching();
+
+    uint16_t old_hash_len;
+    uint8_t old_hash[16];
+    response = read_request(database_hash_handle, &old_hash_len);
+    (void)memcpy(old_hash, &response[1], 16);
+
+    // add service
+    uint16_t start_handle = att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_DEVICE_INFORMATION);
+    att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_MANUFACTURER_NAME_STRING, ATT_PROPERTY_READ, ATT_SECURITY_NONE, ATT_SECURITY_NONE, &battery_level, 1);
+    att_server_db_changed(att_db_util_get_address(), start_handle, 0xffff);
+
+    response = mock_l2cap_get_sent_packet(&response_len);
+    CHECK_EQUAL(7, response_len);
+    CHECK_EQUAL(ATT_HANDLE_VALUE_INDICATION, response[0]);
+    CHECK_EQUAL(service_changed_handle, little_endian_read_16(response, 1));
+    CHECK_EQUAL(start_handle, little_endian_read_16(response, 3));
+    CHECK_EQUAL(0xffff, little_endian_read_16(response, 5));
+
+    // confirmation makes client change-aware
+    uint8_t confirmation[] = { ATT_HANDLE_VALUE_CONFIRMATION };
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, confirmation, sizeof(confirmation));
+
+    response = read_request(database_hash_handle, &response_len);
+    CHECK_EQUAL(17, response_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+    CHECK_TRUE(memcmp(old_hash, &response[1], 16) != 0);
+
+    response = read_request(battery_level_handle, &response_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+}
+
+TEST(ATT_SERVER_ROBUST_CACHING, database_changed_ignores_classic_connection){
+    uint16_t response_len;
+    const uint8_t * response;
+
+    enable_robust_caching();
+
+    // classic ACL connection is not an ATT bearer
+    hci_connection_t * hci_connection = hci_connection_for_handle(att_con_handle);
+    hci_connection->address_type = BD_ADDR_TYPE_ACL;
+    att_server_db_changed(att_db_util_get_address(), 0x0001, 0xffff);
+    hci_connection->address_type = BD_ADDR_TYPE_LE_PUBLIC;
+
+    response = read_request(battery_level_handle, &response_len);
+    CHECK_EQUAL(2, response_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+}
+
+static uint32_t persistent_ccc_tag_for_index(uint8_t index){
+    return ('B' << 24u) | ('T' << 16u) | ('C' << 8u) | index;
+}
+
+// @return length of first stored CCC entry, default NVN_NUM_GATT_SERVER_CCC = 20
+static int persistent_ccc_get_first_entry(const btstack_tlv_t * tlv_impl, void * tlv_context, uint8_t * entry, uint32_t entry_size){
+    uint8_t index;
+    for (index = 0; index < 20; index++){
+        int len = tlv_impl->get_tag(tlv_context, persistent_ccc_tag_for_index(index), entry, entry_size);
+        if (len > 0) return len;
+    }
+    return 0;
+}
+
+TEST(ATT_SERVER_ROBUST_CACHING, persistent_ccc_le_device_index_above_255){
+    uint16_t response_len;
+    const uint8_t * response;
+    hci_connection_t * hci_connection = hci_connection_for_handle(att_con_handle);
+
+    // store CCC for bond 300
+    hci_connection->att_server.ir_le_device_db_index = 300;
+    const uint8_t indicate[] = { 0x02, 0x00 };
+    response = write_request(service_changed_ccc_handle, indicate, sizeof(indicate), &response_len);
+    CHECK_EQUAL(ATT_WRITE_RESPONSE, response[0]);
+
+    uint8_t entry[16];
+    int len = persistent_ccc_get_first_entry(tlv_impl, &tlv_context, entry, sizeof(entry));
+    CHECK_EQUAL(12, len);
+    CHECK_EQUAL(service_changed_ccc_handle, little_endian_read_16(entry, 4));
+    CHECK_EQUAL(0x02, entry[6]);
+    CHECK_EQUAL(300, little_endian_read_16(entry, 8));
+
+    // bond 44 does not see or clear CCC of bond 300
+    hci_connection->att_server.ir_le_device_db_index = 300 - 256;
+    const uint8_t disable[] = { 0x00, 0x00 };
+    response = write_request(service_changed_ccc_handle, disable, sizeof(disable), &response_len);
+    CHECK_EQUAL(ATT_WRITE_RESPONSE, response[0]);
+    len = persistent_ccc_get_first_entry(tlv_impl, &tlv_context, entry, sizeof(entry));
+    CHECK_EQUAL(12, len);
+    CHECK_EQUAL(0x02, entry[6]);
+}
+
+TEST(ATT_SERVER_ROBUST_CACHING, persistent_ccc_entry_with_8_bit_device_index){
+    uint16_t response_len;
+    const uint8_t * response;
+    hci_connection_t * hci_connection = hci_connection_for_handle(att_con_handle);
+
+    // entry stored with 8-bit device index: seq_nr, att_handle, value, device_index
+    uint8_t entry_v1[8];
+    little_endian_store_32(entry_v1, 0, 1);
+    little_endian_store_16(entry_v1, 4, service_changed_ccc_handle);
+    entry_v1[6] = 0x02;
+    entry_v1[7] = 5;
+    uint32_t tag = persistent_ccc_tag_for_index(0);
+    tlv_impl->store_tag(&tlv_context, tag, entry_v1, sizeof(entry_v1));
+
+    // disable for bond 5 deletes entry
+    hci_connection->att_server.ir_le_device_db_index = 5;
+    const uint8_t disable[] = { 0x00, 0x00 };
+    response = write_request(service_changed_ccc_handle, disable, sizeof(disable), &response_len);
+    CHECK_EQUAL(ATT_WRITE_RESPONSE, response[0]);
+    uint8_t entry[16];
+    CHECK_EQUAL(0, tlv_impl->get_tag(&tlv_context, tag, entry, sizeof(entry)));
+}
+
+TEST_GROUP(ATT_SERVER_ROBUST_CACHING_COMPILE_GATT){
+    uint16_t att_con_handle;
+    mock_btstack_tlv_t tlv_context;
+    const btstack_tlv_t * tlv_impl;
+    uint8_t att_db[sizeof(profile_data)];
+
+    void setup(void){
+        att_con_handle = 0x01;
+
+        hci_setup_le_connection(att_con_handle);
+
+        tlv_impl = mock_btstack_tlv_init_instance(&tlv_context);
+        btstack_tlv_set_instance(tlv_impl, &tlv_context);
+
+        l2cap_can_send_fixed_channel_packet_now_set_status(1);
+
+        (void)memcpy(att_db, profile_data, sizeof(profile_data));
+        att_server_init(att_db, att_read_callback, att_write_callback);
+
+        // reset connection state
+        uint8_t buffer[21];
+        memset(buffer, 0, sizeof(buffer));
+        buffer[0] = HCI_EVENT_LE_META;
+        buffer[1] = 19;
+        buffer[2] = HCI_SUBEVENT_LE_CONNECTION_COMPLETE;
+        little_endian_store_16(buffer, 4, att_con_handle);
+        mock_call_att_packet_handler(HCI_EVENT_PACKET, 0, &buffer[0], sizeof(buffer));
+
+        hci_setup_le_connection(att_con_handle);
+    }
+
+    void teardown(void) {
+        mock_btstack_tlv_deinit(&tlv_context);
+        hci_deinit();
+    }
+
+    const uint8_t * read_request(uint16_t attribute_handle, uint16_t * response_len){
+        att_request[0] = ATT_READ_REQUEST;
+        little_endian_store_16(att_request, 1, attribute_handle);
+        mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], 3);
+        return mock_l2cap_get_sent_packet(response_len);
+    }
+
+    void read_database_hash(uint8_t * hash){
+        uint16_t response_len;
+        const uint8_t * response = read_request(ATT_CHARACTERISTIC_GATT_DATABASE_HASH_01_VALUE_HANDLE, &response_len);
+        CHECK_EQUAL(17, response_len);
+        CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+        (void)memcpy(hash, &response[1], 16);
+    }
+
+    void set_battery_service_uuid(uint16_t uuid16){
+        // primary service declaration: size, flags, handle, uuid 0x2800, value
+        uint16_t pos = 1;
+        while (little_endian_read_16(att_db, pos) != 0u){
+            uint16_t size = little_endian_read_16(att_db, pos);
+            if ((little_endian_read_16(att_db, pos + 4u) == ATT_SERVICE_ORG_BLUETOOTH_SERVICE_BATTERY_SERVICE_START_HANDLE)
+             && (little_endian_read_16(att_db, pos + 6u) == GATT_PRIMARY_SERVICE_UUID)){
+                little_endian_store_16(att_db, pos + 8u, uuid16);
+                return;
+            }
+            pos += size;
+        }
+        FAIL("Battery Service declaration not found");
+    }
+};
+
+TEST(ATT_SERVER_ROBUST_CACHING_COMPILE_GATT, read_database_hash){
+    // compile_gatt stores a random hash if pycryptodome is not available, current hash is calculated at runtime
+    static const uint8_t zero_key[16] = { 0 };
+    btstack_crypto_aes128_cmac_t request;
+    uint8_t db_hash[16];
+    uint8_t expected_hash[16];
+    db_hash_calculated = false;
+    att_database_hash_init();
+    btstack_crypto_aes128_cmac_generator(&request, zero_key, att_database_hash_len(), &database_hash_get_next, db_hash, &db_hash_calculated_callback, NULL);
+    CHECK_TRUE(db_hash_calculated);
+    reverse_128(db_hash, expected_hash);
+
+    uint8_t hash[16];
+    read_database_hash(hash);
+    MEMCMP_EQUAL(expected_hash, hash, 16);
+}
+
+TEST(ATT_SERVER_ROBUST_CACHING_COMPILE_GATT, read_database_hash_after_db_changed){
+    uint8_t initial_hash[16];
+    uint8_t changed_hash[16];
+    uint8_t restored_hash[16];
+    read_database_hash(initial_hash);
+
+    // Database Hash is not DYNAMIC, but current hash is provided nevertheless
+    set_battery_service_uuid(ORG_BLUETOOTH_SERVICE_DEVICE_INFORMATION);
+    att_server_db_changed(att_db, ATT_SERVICE_ORG_BLUETOOTH_SERVICE_BATTERY_SERVICE_START_HANDLE, 0xffff);
+    read_database_hash(changed_hash);
+    CHECK_TRUE(memcmp(initial_hash, changed_hash, 16) != 0);
+
+    set_battery_service_uuid(ORG_BLUETOOTH_SERVICE_BATTERY_SERVICE);
+    att_server_db_changed(att_db, ATT_SERVICE_ORG_BLUETOOTH_SERVICE_BATTERY_SERVICE_START_HANDLE, 0xffff);
+    read_database_hash(restored_hash);
+    MEMCMP_EQUAL(initial_hash, restored_hash, 16);
+}
+
+TEST(ATT_SERVER_ROBUST_CACHING_COMPILE_GATT, client_supported_features){
+    uint16_t response_len;
+    const uint8_t value[] = { 0x01 };
+    uint16_t request_len = att_write_request(ATT_WRITE_REQUEST, ATT_CHARACTERISTIC_GATT_CLIENT_SUPPORTED_FEATURES_01_VALUE_HANDLE, sizeof(value), value);
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], request_len);
+    const uint8_t * response = mock_l2cap_get_sent_packet(&response_len);
+    CHECK_EQUAL(1, response_len);
+    CHECK_EQUAL(ATT_WRITE_RESPONSE, response[0]);
+
+    att_server_db_changed(att_db, 0x0001, 0xffff);
+
+    // change-unaware client gets error
+    response = read_request(ATT_CHARACTERISTIC_ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL_01_VALUE_HANDLE, &response_len);
+    CHECK_EQUAL(5, response_len);
+    CHECK_EQUAL(ATT_ERROR_RESPONSE, response[0]);
+    CHECK_EQUAL(ATT_ERROR_DATABASE_OUT_OF_SYNC, response[4]);
+
+    // and is change-aware afterwards
+    response = read_request(ATT_CHARACTERISTIC_ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL_01_VALUE_HANDLE, &response_len);
+    CHECK_EQUAL(2, response_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+}
+
+
+TEST_GROUP(ATT_SERVER_NOTIFICATION_QUEUE){
+    uint16_t att_con_handle;
+    uint16_t value_handle;
+    att_server_notification_queue_t queue;
+    uint8_t queue_storage[ATT_SERVER_NOTIFICATION_QUEUE_STORAGE_SIZE(3, 4)];
+
+    void setup(void){
+        att_con_handle = 0x01;
+        hci_setup_le_connection(att_con_handle);
+        btstack_tlv_set_instance(NULL, NULL);
+        l2cap_can_send_fixed_channel_packet_now_set_status(1);
+
+        att_db_util_init();
+        att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_BATTERY_SERVICE);
+        value_handle = att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL, ATT_PROPERTY_READ | ATT_PROPERTY_NOTIFY, ATT_SECURITY_NONE, ATT_SECURITY_NONE, &battery_level, 1);
+        att_server_init(att_db_util_get_address(), att_read_callback, att_write_callback);
+    }
+
+    void teardown(void) {
+        hci_deinit();
+    }
+
+    void add_values(uint8_t first, uint8_t num_values, uint16_t attribute_handle){
+        uint8_t i;
+        for (i = 0; i < num_values; i++){
+            uint8_t value = first + i;
+            att_server_notification_queue_add(att_con_handle, attribute_handle, &value, 1);
+        }
+    }
+
+    void drain(void){
+        l2cap_can_send_fixed_channel_packet_now_set_status(1);
+        uint8_t event[] = { L2CAP_EVENT_CAN_SEND_NOW, 2, 1, 0};
+        mock_call_att_server_packet_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    }
+};
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, init){
+    uint8_t status;
+    status = att_server_notification_queue_init(&queue, 0x50, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, queue_storage, sizeof(queue_storage), 4);
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, status);
+    status = att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, queue_storage, 4, 4);
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, status);
+
+    // no queue
+    uint8_t value = 0;
+    status = att_server_notification_queue_add(att_con_handle, value_handle, &value, 1);
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, status);
+
+    status = att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, queue_storage, sizeof(queue_storage), 4);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+
+    uint8_t long_value[5] = { 0 };
+    status = att_server_notification_queue_add(att_con_handle, value_handle, long_value, sizeof(long_value));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, status);
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, init_too_many_entries){
+    static uint8_t large_storage[ATT_SERVER_NOTIFICATION_QUEUE_STORAGE_SIZE(256, 1)];
+    uint8_t status;
+    status = att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, large_storage, sizeof(large_storage), 1);
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, status);
+    status = att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, large_storage, ATT_SERVER_NOTIFICATION_QUEUE_STORAGE_SIZE(255, 1), 1);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+}
+
+static uint8_t notification_queue_other_request_count;
+static void notification_queue_other_request_callback(void * context){
+    UNUSED(context);
+    notification_queue_other_request_count++;
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, init_while_pending){
+    att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, queue_storage, sizeof(queue_storage), 4);
+    l2cap_can_send_fixed_channel_packet_now_set_status(0);
+    add_values(0x10, 2, value_handle);
+    CHECK_EQUAL(2, att_server_notification_queue_get_count(att_con_handle));
+
+    // request queued behind queue
+    btstack_context_callback_registration_t other_request;
+    other_request.callback = &notification_queue_other_request_callback;
+    other_request.context = NULL;
+    notification_queue_other_request_count = 0;
+    att_server_request_to_send_notification(&other_request, att_con_handle);
+
+    // re-init discards queued notifications and pending request
+    uint8_t status = att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, queue_storage, sizeof(queue_storage), 4);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+    CHECK_EQUAL(0, att_server_notification_queue_get_count(att_con_handle));
+
+    add_values(0x20, 1, value_handle);
+    drain();
+    drain();
+    CHECK_EQUAL(0, att_server_notification_queue_get_count(att_con_handle));
+
+    att_server_notification_queue_statistics_t statistics;
+    att_server_notification_queue_get_statistics(att_con_handle, &statistics);
+    CHECK_EQUAL(1, statistics.sent);
+    CHECK_EQUAL(1, notification_queue_other_request_count);
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, send_directly){
+    att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, queue_storage, sizeof(queue_storage), 4);
+    add_values(0x10, 1, value_handle);
+    CHECK_EQUAL(0, att_server_notification_queue_get_count(att_con_handle));
+
+    uint16_t packet_len;
+    const uint8_t * packet = mock_l2cap_get_sent_packet(&packet_len);
+    CHECK_EQUAL(4, packet_len);
+    CHECK_EQUAL(ATT_HANDLE_VALUE_NOTIFICATION, packet[0]);
+    CHECK_EQUAL(value_handle, little_endian_read_16(packet, 1));
+    CHECK_EQUAL(0x10, packet[3]);
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, fifo){
+    att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, queue_storage, sizeof(queue_storage), 4);
+    l2cap_can_send_fixed_channel_packet_now_set_status(0);
+    add_values(0x10, 4, value_handle);
+    CHECK_EQUAL(3, att_server_notification_queue_get_count(att_con_handle));
+
+    att_server_notification_queue_statistics_t statistics;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, att_server_notification_queue_get_statistics(att_con_handle, &statistics));
+    CHECK_EQUAL(3, statistics.queued);
+    CHECK_EQUAL(1, statistics.dropped);
+    CHECK_EQUAL(0, statistics.coalesced);
+
+    drain();
+    CHECK_EQUAL(0, att_server_notification_queue_get_count(att_con_handle));
+    att_server_notification_queue_get_statistics(att_con_handle, &statistics);
+    CHECK_EQUAL(3, statistics.sent);
+
+    uint16_t packet_len;
+    const uint8_t * packet = mock_l2cap_get_sent_packet(&packet_len);
+    CHECK_EQUAL(0x12, packet[3]);
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, latest_value){
+    att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_LATEST_VALUE, queue_storage, sizeof(queue_storage), 4);
+    l2cap_can_send_fixed_channel_packet_now_set_status(0);
+    add_values(0x10, 5, value_handle);
+    add_values(0x20, 1, value_handle + 1);
+    CHECK_EQUAL(2, att_server_notification_queue_get_count(att_con_handle));
+
+    att_server_notification_queue_statistics_t statistics;
+    att_server_notification_queue_get_statistics(att_con_handle, &statistics);
+    CHECK_EQUAL(6, statistics.queued);
+    CHECK_EQUAL(4, statistics.coalesced);
+    CHECK_EQUAL(0, statistics.dropped);
+
+    drain();
+    att_server_notification_queue_get_statistics(att_con_handle, &statistics);
+    CHECK_EQUAL(2, statistics.sent);
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, disconnect){
+    att_server_notification_queue_init(&queue, att_con_handle, ATT_SERVER_NOTIFICATION_QUEUE_POLICY_FIFO, queue_storage, sizeof(queue_storage), 4);
+    uint8_t buffer[6];
+    buffer[0] = HCI_EVENT_DISCONNECTION_COMPLETE;
+    buffer[1] = 4;
+    buffer[2] = 0;
+    little_endian_store_16(buffer, 3, att_con_handle);
+    mock_call_att_packet_handler(HCI_EVENT_PACKET, 0, &buffer[0], sizeof(buffer));
+
+    att_server_notification_queue_statistics_t statistics;
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, att_server_notification_queue_get_statistics(att_con_handle, &statistics));
+}
+
+
+static uint16_t notify_all_ccc_handle;
+static uint16_t notify_all_ccc_value;
+static uint8_t  notify_all_event[32];
+static uint16_t notify_all_event_size;
+
+static uint16_t notify_all_read_callback(hci_con_handle_t connection_handle, uint16_t att_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    UNUSED(connection_handle);
+    if (att_handle != notify_all_ccc_handle) return 0;
+    return att_read_callback_handle_little_endian_16(notify_all_ccc_value, offset, buffer, buffer_size);
+}
+
+static void notify_all_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size) {
+    UNUSED(channel);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != ATT_EVENT_NOTIFY_ALL_COMPLETE) return;
+    notify_all_event_size = size;
+    (void)memcpy(notify_all_event, packet, size);
+}
+
+TEST_GROUP(ATT_SERVER_NOTIFY_ALL){
+    uint16_t att_con_handle;
+    uint16_t value_handle;
+    uint16_t no_ccc_value_handle;
+
+    void setup(void){
+        att_con_handle = 0x01;
+        hci_setup_le_connection(att_con_handle);
+        btstack_tlv_set_instance(NULL, NULL);
+        l2cap_can_send_fixed_channel_packet_now_set_status(1);
+
+        att_db_util_init();
+        att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_BATTERY_SERVICE);
+        value_handle = att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL, ATT_PROPERTY_READ | ATT_PROPERTY_NOTIFY, ATT_SECURITY_NONE, ATT_SECURITY_NONE, &battery_level, 1);
+        no_ccc_value_handle = att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL_STATE, ATT_PROPERTY_READ, ATT_SECURITY_NONE, ATT_SECURITY_NONE, &battery_level, 1);
+        notify_all_ccc_handle = gatt_server_get_client_configuration_handle_for_value_handle(value_handle);
+        notify_all_ccc_value = 0;
+        notify_all_event_size = 0;
+        att_server_init(att_db_util_get_address(), notify_all_read_callback, att_write_callback);
+        att_server_register_packet_handler(&notify_all_packet_handler);
+    }
+
+    void teardown(void) {
+        att_server_register_packet_handler(NULL);
+        hci_deinit();
+    }
+};
+
+TEST(ATT_SERVER_NOTIFY_ALL, client_configuration_handle){
+    CHECK_EQUAL(value_handle + 1, notify_all_ccc_handle);
+    CHECK_EQUAL(0, gatt_server_get_client_configuration_handle_for_value_handle(no_ccc_value_handle));
+}
+
+TEST(ATT_SERVER_NOTIFY_ALL, no_client_configuration){
+    uint8_t value[] = { 0x55 };
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, att_server_notify_all(no_ccc_value_handle, value, sizeof(value)));
+}
+
+TEST(ATT_SERVER_NOTIFY_ALL, not_subscribed){
+    uint8_t value[] = { 0x55 };
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, att_server_notify_all(value_handle, value, sizeof(value)));
+    CHECK_EQUAL(5, notify_all_event_size);
+    CHECK_EQUAL(value_handle, att_event_notify_all_complete_get_attribute_handle(notify_all_event));
+    CHECK_EQUAL(0, att_event_notify_all_complete_get_results_len(notify_all_event));
+}
+
+TEST(ATT_SERVER_NOTIFY_ALL, subscribed){
+    uint8_t value[] = { 0x55 };
+    notify_all_ccc_value = GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, att_server_notify_all(value_handle, value, sizeof(value)));
+
+    uint16_t packet_len;
+    const uint8_t * packet = mock_l2cap_get_sent_packet(&packet_len);
+    CHECK_EQUAL(4, packet_len);
+    CHECK_EQUAL(ATT_HANDLE_VALUE_NOTIFICATION, packet[0]);
+    CHECK_EQUAL(value_handle, little_endian_read_16(packet, 1));
+    CHECK_EQUAL(0x55, packet[3]);
+
+    CHECK_EQUAL(3, att_event_notify_all_complete_get_results_len(notify_all_event));
+    const uint8_t * results = att_event_notify_all_complete_get_results(notify_all_event);
+    CHECK_EQUAL(att_con_handle, little_endian_read_16(results, 0));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, results[2]);
+}
+
+TEST(ATT_SERVER_NOTIFY_ALL, disconnect){
+    uint8_t value[] = { 0x55 };
+    notify_all_ccc_value = GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION;
+    l2cap_can_send_fixed_channel_packet_now_set_status(0);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, att_server_notify_all(value_handle, value, sizeof(value)));
+    CHECK_EQUAL(0, notify_all_event_size);
+
+    // only one at a time
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, att_server_notify_all(value_handle, value, sizeof(value)));
+
+    uint8_t buffer[6];
+    buffer[0] = HCI_EVENT_DISCONNECTION_COMPLETE;
+    buffer[1] = 4;
+    buffer[2] = 0;
+    little_endian_store_16(buffer, 3, att_con_handle);
+    mock_call_att_packet_handler(HCI_EVENT_PACKET, 0, &buffer[0], sizeof(buffer));
+
+    CHECK_EQUAL(3, att_event_notify_all_complete_get_results_len(notify_all_event));
+    const uint8_t * results = att_event_notify_all_complete_get_results(notify_all_event);
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, results[2]);
+}
+
+
+static uint16_t write_command_sink_count;
+static uint16_t write_command_sink_data_len;
+static uint8_t  write_command_sink_data[8];
+static bool     write_command_sink_ready;
+static uint16_t write_command_write_callback_count;
+
+static bool write_command_sink_callback(hci_con_handle_t con_handle, uint16_t value_handle, const uint8_t * data, uint16_t data_len){
+    UNUSED(con_handle);
+    UNUSED(value_handle);
+    write_command_sink_count++;
+    write_command_sink_data_len = data_len;
+    (void)memcpy(write_command_sink_data, data, btstack_min(data_len, sizeof(write_command_sink_data)));
+    return write_command_sink_ready;
+}
+
+static int write_command_write_callback(hci_con_handle_t connection_handle, uint16_t att_handle, uint16_t transaction_mode, uint16_t offset, uint8_t *buffer, uint16_t buffer_size){
+    UNUSED(connection_handle);
+    UNUSED(att_handle);
+    UNUSED(transaction_mode);
+    UNUSED(offset);
+    UNUSED(buffer);
+    UNUSED(buffer_size);
+    write_command_write_callback_count++;
+    return 0;
+}
+
+TEST_GROUP(ATT_SERVER_WRITE_COMMAND_SINK){
+    uint16_t att_con_handle;
+    uint16_t value_handle;
+    uint16_t authenticated_value_handle;
+    uint16_t write_only_value_handle;
+    att_server_write_command_sink_t sink;
+
+    void setup(void){
+        att_con_handle = 0x01;
+        hci_setup_le_connection(att_con_handle);
+        btstack_tlv_set_instance(NULL, NULL);
+
+        att_db_util_init();
+        att_db_util_add_service_uuid16(0xFF10);
+        value_handle = att_db_util_add_characteristic_uuid16(0xFF11, ATT_PROPERTY_WRITE_WITHOUT_RESPONSE | ATT_PROPERTY_DYNAMIC, ATT_SECURITY_NONE, ATT_SECURITY_NONE, NULL, 0);
+        authenticated_value_handle = att_db_util_add_characteristic_uuid16(0xFF12, ATT_PROPERTY_WRITE_WITHOUT_RESPONSE | ATT_PROPERTY_DYNAMIC, ATT_SECURITY_NONE, ATT_SECURITY_AUTHENTICATED, NULL, 0);
+        write_only_value_handle = att_db_util_add_characteristic_uuid16(0xFF13, ATT_PROPERTY_WRITE | ATT_PROPERTY_DYNAMIC, ATT_SECURITY_NONE, ATT_SECURITY_NONE, NULL, 0);
+        att_server_init(att_db_util_get_address(), att_read_callback, write_command_write_callback);
+
+        write_command_sink_count = 0;
+        write_command_sink_data_len = 0;
+        write_command_sink_ready = true;
+        write_command_write_callback_count = 0;
+
+        sink.value_handle = value_handle;
+        sink.callback = &write_command_sink_callback;
+        att_server_register_write_command_sink(&sink);
+    }
+
+    void teardown(void) {
+        att_server_unregister_write_command_sink(&sink);
+        hci_deinit();
+    }
+
+    void send_write_command(uint16_t handle){
+        uint8_t value[] = { 0x11, 0x22, 0x33 };
+        uint16_t request_len = att_write_request(ATT_WRITE_COMMAND, handle, sizeof(value), value);
+        mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], request_len);
+    }
+};
+
+TEST(ATT_SERVER_WRITE_COMMAND_SINK, deliver){
+    send_write_command(value_handle);
+    send_write_command(value_handle);
+    CHECK_EQUAL(2, write_command_sink_count);
+    CHECK_EQUAL(3, write_command_sink_data_len);
+    CHECK_EQUAL(0x11, write_command_sink_data[0]);
+    CHECK_EQUAL(0x33, write_command_sink_data[2]);
+    CHECK_EQUAL(0, write_command_write_callback_count);
+}
+
+TEST(ATT_SERVER_WRITE_COMMAND_SINK, insufficient_security){
+    sink.value_handle = authenticated_value_handle;
+    send_write_command(authenticated_value_handle);
+    CHECK_EQUAL(0, write_command_sink_count);
+    CHECK_EQUAL(0, write_command_write_callback_count);
+}
+
+TEST(ATT_SERVER_WRITE_COMMAND_SINK, write_not_permitted){
+    sink.value_handle = write_only_value_handle;
+    send_write_command(write_only_value_handle);
+    CHECK_EQUAL(0, write_command_sink_count);
+}
+
+TEST(ATT_SERVER_WRITE_COMMAND_SINK, other_handle){
+    sink.value_handle = write_only_value_handle;
+    send_write_command(value_handle);
+    CHECK_EQUAL(0, write_command_sink_count);
+    CHECK_EQUAL(1, write_command_write_callback_count);
+}
+
+TEST(ATT_SERVER_WRITE_COMMAND_SINK, busy){
+    write_command_sink_ready = false;
+    send_write_command(value_handle);
+    // busy sink does not get data
+    send_write_command(value_handle);
+    CHECK_EQUAL(1, write_command_sink_count);
+    CHECK_EQUAL(0, write_command_write_callback_count);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, att_server_write_command_sink_ready(att_con_handle));
+    send_write_command(value_handle);
+    CHECK_EQUAL(2, write_command_sink_count);
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, att_server_write_command_sink_ready(HCI_CON_HANDLE_INVALID));
+}
+
 
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
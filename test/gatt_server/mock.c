@@ -22,6 +22,8 @@ static uint16_t max_mtu = 23;
 static uint8_t  l2cap_stack_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + 8 + ATT_DEFAULT_MTU];	// pre buffer + HCI Header + L2CAP header
 static uint16_t gatt_client_handle = 0x40;
 static hci_connection_t hci_connection;
+static uint8_t  sent_packet[ATT_DEFAULT_MTU];
+static uint16_t sent_packet_len;
 
 uint16_t get_gatt_client_handle(void){
 	return gatt_client_handle;
@@ -72,6 +74,8 @@ void hci_setup_le_connection(uint16_t con_handle){
 
     hci_connection.att_server.ir_le_device_db_index = 0;
 
+    hci_connection.address_type = BD_ADDR_TYPE_LE_PUBLIC;
+
     hci_connection.con_handle = con_handle;
 
     if (btstack_linked_list_empty(&connections)){
@@ -94,6 +98,7 @@ void hci_deinit(void){
     hci_connection.att_server.notification_requests = NULL;
     hci_connection.att_server.indication_requests = NULL;
     connections = NULL;
+    sent_packet_len = 0;
 }
 
 void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
@@ -162,8 +167,15 @@ void l2cap_request_can_send_fix_channel_now_event(uint16_t handle, uint16_t chan
     att_server_packet_handler(HCI_EVENT_PACKET, 0, (uint8_t*)event, sizeof(event));
 }
 
+const uint8_t * mock_l2cap_get_sent_packet(uint16_t * len){
+    *len = sent_packet_len;
+    return sent_packet;
+}
+
 uint8_t l2cap_send_prepared_connectionless(uint16_t handle, uint16_t cid, uint16_t len){
 	att_connection_t att_connection;
+    sent_packet_len = btstack_min(len, sizeof(sent_packet));
+    (void)memcpy(sent_packet, l2cap_get_outgoing_buffer(), sent_packet_len);
     hci_setup_le_connection(handle);
 	uint8_t response[max_mtu];
 	uint16_t response_len = att_handle_request(&att_connection, l2cap_get_outgoing_buffer(), len, &response[0]);
@@ -94,6 +94,11 @@ TEST_GROUP(HFPParser){
         context.bnip_type = 0;
         memset(packet,0, sizeof(packet));
     }
+
+    void teardown(void){
+        // drop custom AT commands registered by tests
+        hfp_deinit();
+    }
 };
 
 TEST(HFPParser, HFP_HF_OK){
@@ -582,6 +587,49 @@ TEST(HFPParser, HFP_CMD_AG_SENT_CALL_WAITING_INFORMATION){
     STRCMP_EQUAL("BlueKitchen GmbH", (const char *)context.line_buffer);
 }
 
+TEST(HFPParser, HFP_AG_UNKNOWN_COMMAND){
+    parse_ag("\r\nAT+BIN=1\r\n");
+    CHECK_EQUAL(HFP_CMD_UNKNOWN, context.command);
+}
+
+TEST(HFPParser, HFP_HF_UNKNOWN_RESULT){
+    parse_hf("\r\n+XAPL=iPhone,2\r\n");
+    CHECK_EQUAL(HFP_CMD_UNKNOWN, context.command);
+}
+
+TEST(HFPParser, HFP_AG_CUSTOM_COMMAND){
+    static hfp_custom_at_command_t custom_command = { NULL, "AT+FOO=", 0x1234 };
+    hfp_register_custom_ag_command(&custom_command);
+    parse_ag("\r\nAT+FOO=bar baz\r");
+    CHECK_EQUAL(HFP_CMD_CUSTOM_MESSAGE, context.command);
+    CHECK_EQUAL(0x1234, context.ag_custom_at_command_id);
+    STRCMP_EQUAL("AT+FOO=barbaz\r", (const char *)context.line_buffer);
+}
+
+TEST(HFPParser, HFP_PARSE_LINE){
+    const char * line = "\r\n+CLIP: \"+123456789\",145,\"\",,\"BlueKitchen GmbH\"\r\nOK\r\n";
+    const uint8_t * data = (const uint8_t *) line;
+    uint16_t size = (uint16_t) strlen(line);
+    // stops after each end-of-line
+    CHECK_EQUAL(1, hfp_parse_line(&context, data, size, 1));
+    CHECK_EQUAL(1, hfp_parse_line(&context, &data[1], size - 1, 1));
+    // fragmented line
+    uint16_t pos = 2;
+    pos += hfp_parse_line(&context, &data[pos], 20, 1);
+    CHECK_EQUAL(22, pos);
+    pos += hfp_parse_line(&context, &data[pos], size - pos, 1);
+    CHECK_EQUAL('\r', data[pos - 1]);
+    CHECK_EQUAL(HFP_CMD_AG_SENT_CLIP_INFORMATION, context.command);
+    STRCMP_EQUAL("+123456789", context.bnip_number);
+    CHECK_EQUAL(145, context.bnip_type);
+    CHECK_EQUAL(true, context.clip_have_alpha);
+    STRCMP_EQUAL("BlueKitchen GmbH", (const char *)context.line_buffer);
+    while (pos < size){
+        pos += hfp_parse_line(&context, &data[pos], size - pos, 1);
+    }
+    CHECK_EQUAL(HFP_CMD_OK, context.command);
+}
+
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
 }
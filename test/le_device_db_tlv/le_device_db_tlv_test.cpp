@@ -212,6 +212,65 @@ TEST(LE_DEVICE_DB_TLV, ReplaceOldest){
     CHECK_EQUAL(num_entries, num_entries_test);
 }
 
+TEST(LE_DEVICE_DB_TLV, LookupByIdentityAddress){
+    int index_a = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_aa);
+    int index_b = le_device_db_add(BD_ADDR_TYPE_LE_RANDOM, addr_bb, sm_key_bb);
+    CHECK_EQUAL(index_a, le_device_db_lookup_by_identity_address(BD_ADDR_TYPE_LE_PUBLIC, addr_aa));
+    CHECK_EQUAL(index_b, le_device_db_lookup_by_identity_address(BD_ADDR_TYPE_LE_RANDOM, addr_bb));
+    // address type has to match
+    CHECK_EQUAL(-1, le_device_db_lookup_by_identity_address(BD_ADDR_TYPE_LE_RANDOM, addr_aa));
+    CHECK_EQUAL(-1, le_device_db_lookup_by_identity_address(BD_ADDR_TYPE_LE_PUBLIC, addr_cc));
+    le_device_db_remove(index_a);
+    CHECK_EQUAL(-1, le_device_db_lookup_by_identity_address(BD_ADDR_TYPE_LE_PUBLIC, addr_aa));
+    CHECK_EQUAL(index_b, le_device_db_lookup_by_identity_address(BD_ADDR_TYPE_LE_RANDOM, addr_bb));
+}
+
+TEST(LE_DEVICE_DB_TLV, LookupByIrk){
+    int index_a = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_aa);
+    int index_b = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_bb, sm_key_bb);
+    le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_cc, sm_key_zero);
+    CHECK_EQUAL(index_a, le_device_db_lookup_by_irk(sm_key_aa));
+    CHECK_EQUAL(index_b, le_device_db_lookup_by_irk(sm_key_bb));
+    CHECK_EQUAL(-1, le_device_db_lookup_by_irk(sm_key_cc));
+    // devices without IRK are not found by IRK
+    CHECK_EQUAL(-1, le_device_db_lookup_by_irk(sm_key_zero));
+    // update IRK for existing device
+    le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_cc);
+    CHECK_EQUAL(-1, le_device_db_lookup_by_irk(sm_key_aa));
+    CHECK_EQUAL(index_a, le_device_db_lookup_by_irk(sm_key_cc));
+}
+
+TEST(LE_DEVICE_DB_TLV, IndexRestoredFromTlv){
+    bd_addr_t addr;
+    sm_key_t  sm_key;
+    int indices[NVM_NUM_DEVICE_DB_ENTRIES];
+    int i;
+    for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
+        set_addr_and_sm_key(0x10 + i, addr, sm_key);
+        indices[i] = le_device_db_add(BD_ADDR_TYPE_LE_RANDOM, addr, sm_key);
+    }
+    le_device_db_remove(indices[3]);
+
+    // re-configure builds index from TLV
+    le_device_db_tlv_configure(btstack_tlv_impl, &btstack_tlv_context);
+    CHECK_EQUAL(NVM_NUM_DEVICE_DB_ENTRIES - 1, le_device_db_count());
+    for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
+        set_addr_and_sm_key(0x10 + i, addr, sm_key);
+        int expected_index = (i == 3) ? -1 : indices[i];
+        CHECK_EQUAL(expected_index, le_device_db_lookup_by_identity_address(BD_ADDR_TYPE_LE_RANDOM, addr));
+        CHECK_EQUAL(expected_index, le_device_db_lookup_by_irk(sm_key));
+    }
+
+    // oldest entry replaced
+    set_addr_and_sm_key(0x80, addr, sm_key);
+    CHECK_EQUAL(indices[3], le_device_db_add(BD_ADDR_TYPE_LE_RANDOM, addr, sm_key));
+    set_addr_and_sm_key(0x81, addr, sm_key);
+    CHECK_EQUAL(indices[0], le_device_db_add(BD_ADDR_TYPE_LE_RANDOM, addr, sm_key));
+    set_addr_and_sm_key(0x10, addr, sm_key);
+    CHECK_EQUAL(-1, le_device_db_lookup_by_identity_address(BD_ADDR_TYPE_LE_RANDOM, addr));
+    CHECK_EQUAL(-1, le_device_db_lookup_by_irk(sm_key));
+}
+
 TEST(LE_DEVICE_DB_TLV, le_device_db_encryption_set_non_existing){
     uint16_t ediv = 16;
     int encryption_key_size = 10;
@@ -131,10 +131,30 @@ static void mock_btstack_tlv_delete_tag(void * context, uint32_t tag){
     }
 }
 
+/**
+ * Iterate over stored tags in range
+ * @param tag_first
+ * @param tag_last
+ * @param callback
+ * @param callback_context
+ */
+static void mock_btstack_tlv_iterate_tags(void * context, uint32_t tag_first, uint32_t tag_last, btstack_tlv_iterate_callback_t callback, void * callback_context){
+    mock_btstack_tlv_t * self = (mock_btstack_tlv_t *) context;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &self->entry_list);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        tlv_entry_t * entry = (tlv_entry_t*) btstack_linked_list_iterator_next(&it);
+        if (entry->tag < tag_first) continue;
+        if (entry->tag > tag_last) continue;
+        if ((*callback)(callback_context, entry->tag, entry->len) == false) return;
+    }
+}
+
 static const btstack_tlv_t mock_btstack_tlv = {
         /* int  (*get_tag)(..);     */ &mock_btstack_tlv_get_tag,
         /* int (*store_tag)(..);    */ &mock_btstack_tlv_store_tag,
         /* void (*delete_tag)(v..); */ &mock_btstack_tlv_delete_tag,
+        /* void (*iterate_tags)(..); */ &mock_btstack_tlv_iterate_tags,
 };
 
 /**
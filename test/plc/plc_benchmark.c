@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// Benchmark for PLC pattern match as used by CVSD and SBC PLC, fixed-point kernel vs. float implementation
+// build with -DBTSTACK_PLC_CORE_NO_SIMD to benchmark the scalar kernel
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "btstack_plc_core.h"
+
+#define BENCHMARK_ROUNDS 2000
+#define BENCHMARK_MAX_N  512
+#define BENCHMARK_MAX_FS 120
+
+static int16_t history[BENCHMARK_ROUNDS / 100][BENCHMARK_MAX_N + BENCHMARK_MAX_FS];
+
+static double benchmark_time_us(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double) now.tv_sec * 1000000.0) + ((double) now.tv_nsec / 1000.0);
+}
+
+// float implementation previously used by CVSD and SBC PLC
+static float float_sqrt3(const float x){
+    union {
+        int i;
+        float x;
+    } u;
+    u.x = x;
+    u.i = (1<<29) + (u.i >> 1) - (1<<22);
+    u.x =       u.x + (x/u.x);
+    u.x = (0.25f*u.x) + (x/u.x);
+    return u.x;
+}
+
+static float float_cross_correlation(const int16_t * x, const int16_t * y, int len){
+    float num = 0;
+    float x2 = 0;
+    float y2 = 0;
+    int   m;
+    for (m=0;m<len;m++){
+        num+=((float)x[m])*y[m];
+        x2+=((float)x[m])*x[m];
+        y2+=((float)y[m])*y[m];
+    }
+    return num/float_sqrt3(x2*y2);
+}
+
+static int float_pattern_match(const int16_t * y, int num_candidates, int template_pos, int len){
+    float maxCn = -999999.0;
+    int   bestmatch = 0;
+    int   n;
+    for (n=0;n<num_candidates;n++){
+        float Cn = float_cross_correlation(&y[template_pos], &y[n], len);
+        if (Cn>maxCn){
+            bestmatch=n;
+            maxCn = Cn;
+        }
+    }
+    return bestmatch;
+}
+
+static void benchmark(const char * name, int num_candidates, int template_len, int frame_size){
+    const int num_histories = BENCHMARK_ROUNDS / 100;
+    const int template_pos = num_candidates + frame_size - 1 - template_len;
+    char label[60];
+    uint32_t checksum;
+    double start;
+    int round;
+
+    checksum = 0;
+    start = benchmark_time_us();
+    for (round = 0; round < BENCHMARK_ROUNDS; round++){
+        const int16_t * y = history[round % num_histories];
+        checksum += (uint32_t) float_pattern_match(y, num_candidates, template_pos, template_len);
+    }
+    snprintf(label, sizeof(label), "%s: float", name);
+    printf("%-40s %10.3f us/frame, checksum %u\n", label, (benchmark_time_us() - start) / BENCHMARK_ROUNDS, checksum);
+
+    checksum = 0;
+    start = benchmark_time_us();
+    for (round = 0; round < BENCHMARK_ROUNDS; round++){
+        const int16_t * y = history[round % num_histories];
+        checksum += btstack_plc_core_pattern_match(y, (uint16_t) num_candidates, &y[template_pos], (uint16_t) template_len);
+    }
+#ifdef BTSTACK_PLC_CORE_NO_SIMD
+    snprintf(label, sizeof(label), "%s: fixed-point", name);
+#else
+    snprintf(label, sizeof(label), "%s: fixed-point SIMD", name);
+#endif
+    printf("%-40s %10.3f us/frame, checksum %u\n", label, (benchmark_time_us() - start) / BENCHMARK_ROUNDS, checksum);
+}
+
+int main(void){
+    uint32_t random_state = 0x1234;
+    int h;
+    int i;
+    // voiced speech like signal with noise and varying pitch
+    for (h = 0; h < (BENCHMARK_ROUNDS / 100); h++){
+        double period = 40.0 + h * 3.0;
+        for (i = 0; i < (BENCHMARK_MAX_N + BENCHMARK_MAX_FS); i++){
+            double phase = (2.0 * M_PI * i) / period;
+            random_state = random_state * 1664525u + 1013904223u;
+            history[h][i] = (int16_t) lrint(9000.0 * sin(phase) + 4000.0 * sin(2.0 * phase + 0.3)) + (int16_t) ((random_state >> 20) & 0x3ff) - 512;
+        }
+    }
+    benchmark("CVSD", 256,  32,  60);
+    benchmark("SBC",  512,  64, 120);
+    return 0;
+}
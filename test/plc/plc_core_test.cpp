@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// compare fixed-point PLC kernels against float implementation previously used by CVSD and SBC PLC
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_plc_core.h"
+
+// SBC PLC dimensions
+#define PLC_N    512
+#define PLC_M     64
+#define PLC_FS   120
+#define PLC_LHIST (PLC_N + PLC_FS - 1)
+
+static int16_t history[PLC_LHIST];
+static uint32_t random_state;
+
+static int16_t random_sample(int32_t amplitude){
+    random_state = random_state * 1664525u + 1013904223u;
+    return (int16_t) (((int32_t) (random_state >> 16) % (2 * amplitude + 1)) - amplitude);
+}
+
+// float reference
+static float reference_sqrt3(const float x){
+    union {
+        int i;
+        float x;
+    } u;
+    u.x = x;
+    u.i = (1<<29) + (u.i >> 1) - (1<<22);
+    u.x =       u.x + (x/u.x);
+    u.x = (0.25f*u.x) + (x/u.x);
+    return u.x;
+}
+
+static float reference_cross_correlation(const int16_t * x, const int16_t * y, int len){
+    float num = 0;
+    float x2 = 0;
+    float y2 = 0;
+    int   m;
+    for (m=0;m<len;m++){
+        num+=((float)x[m])*y[m];
+        x2+=((float)x[m])*x[m];
+        y2+=((float)y[m])*y[m];
+    }
+    return num/reference_sqrt3(x2*y2);
+}
+
+static int reference_pattern_match(const int16_t * y){
+    float maxCn = -999999.0;
+    int   bestmatch = 0;
+    int   n;
+    for (n=0;n<PLC_N;n++){
+        float Cn = reference_cross_correlation(&y[PLC_LHIST-PLC_M], &y[n], PLC_M);
+        if (Cn>maxCn){
+            bestmatch=n;
+            maxCn = Cn;
+        }
+    }
+    return bestmatch;
+}
+
+static float reference_amplitude_match(const int16_t * x, const int16_t * y, int len){
+    float sumx = 0;
+    float sumy = 0.000001f;
+    int   i;
+    for (i=0;i<len;i++){
+        sumx += fabsf(x[i]);
+        sumy += fabsf(y[i]);
+    }
+    float sf = sumx/sumy;
+    if (sf<0.75f) sf=0.75f;
+    if (sf>1.0f) sf=1.0f;
+    return sf;
+}
+
+static double exact_cross_correlation(const int16_t * x, const int16_t * y, int len){
+    double num = 0, x2 = 0, y2 = 0;
+    int m;
+    for (m=0;m<len;m++){
+        num += (double) x[m] * y[m];
+        x2  += (double) x[m] * x[m];
+        y2  += (double) y[m] * y[m];
+    }
+    if ((x2 == 0) || (y2 == 0)) return 0;
+    return num / sqrt(x2 * y2);
+}
+
+static void generate_voice(int16_t * buffer, int len, double period, int32_t noise){
+    int i;
+    for (i=0;i<len;i++){
+        double phase = (2.0 * M_PI * i) / period;
+        double value = 9000.0 * sin(phase) + 4000.0 * sin(2.0 * phase + 0.3) + 2000.0 * sin(3.0 * phase + 1.1);
+        buffer[i] = (int16_t) lrint(value) + random_sample(noise);
+    }
+}
+
+TEST_GROUP(PLC_CORE){
+    void setup(void){
+        random_state = 0x1234;
+        memset(history, 0, sizeof(history));
+    }
+};
+
+TEST(PLC_CORE, DotProductExact){
+    static int16_t x[PLC_M + 7];
+    static int16_t y[PLC_M + 7];
+    uint16_t len;
+    int i;
+    // extreme values overflow 32 bit pairwise sums
+    for (i=0;i<(PLC_M+7);i++){
+        x[i] = -32768;
+        y[i] = -32768;
+    }
+    CHECK_EQUAL((int64_t) (PLC_M + 7) << 30, btstack_plc_core_dot_product(x, y, PLC_M + 7));
+    for (i=0;i<(PLC_M+7);i++){
+        x[i] = (i & 1) ? -32768 :  32767;
+        y[i] = (i & 1) ?  32767 : -32768;
+    }
+    CHECK_EQUAL(-(int64_t) (PLC_M + 7) * 32768 * 32767, btstack_plc_core_dot_product(x, y, PLC_M + 7));
+    // all lengths, unaligned
+    for (i=0;i<(PLC_M+7);i++){
+        x[i] = random_sample(32767);
+        y[i] = random_sample(32767);
+    }
+    for (len=0;len<=(PLC_M+6);len++){
+        int64_t expected = 0;
+        for (i=0;i<len;i++){
+            expected += (int32_t) x[i+1] * y[i];
+        }
+        CHECK_EQUAL(expected, btstack_plc_core_dot_product(&x[1], y, len));
+    }
+}
+
+TEST(PLC_CORE, CrossCorrelation){
+    static int16_t x[PLC_M];
+    static int16_t y[PLC_M];
+    int round;
+    int i;
+    for (round=0;round<200;round++){
+        int32_t amplitude = (round < 100) ? 32767 : (round - 99);
+        for (i=0;i<PLC_M;i++){
+            x[i] = random_sample(amplitude);
+            // partially correlated
+            y[i] = (int16_t) ((x[i] * (round % 5)) / 8) + random_sample(amplitude / 2);
+        }
+        float expected = reference_cross_correlation(x, y, PLC_M) * 32768.0f;
+        int32_t correlation = btstack_plc_core_cross_correlation(x, y, PLC_M);
+        CHECK(fabsf(expected - (float) correlation) <= 4.0f);
+        CHECK(fabs(exact_cross_correlation(x, y, PLC_M) * 32768.0 - correlation) <= 1.0);
+    }
+    // silence
+    memset(y, 0, sizeof(y));
+    CHECK_EQUAL(0, btstack_plc_core_cross_correlation(x, y, PLC_M));
+    // identical and inverted
+    CHECK_EQUAL(32768, btstack_plc_core_cross_correlation(x, x, PLC_M));
+    for (i=0;i<PLC_M;i++){
+        y[i] = (int16_t) -x[i];
+    }
+    CHECK_EQUAL(-32768, btstack_plc_core_cross_correlation(x, y, PLC_M));
+}
+
+TEST(PLC_CORE, PatternMatchSameAsFloat){
+    int round;
+    for (round=0;round<20;round++){
+        // noise with template copied to unique position
+        int i;
+        int position = (round * 37) % PLC_N;
+        for (i=0;i<PLC_LHIST;i++){
+            history[i] = random_sample(20000);
+        }
+        memcpy(&history[position], &history[PLC_LHIST-PLC_M], PLC_M * 2);
+        int expected = reference_pattern_match(history);
+        CHECK_EQUAL(position, expected);
+        CHECK_EQUAL(expected, btstack_plc_core_pattern_match(history, PLC_N, &history[PLC_LHIST-PLC_M], PLC_M));
+    }
+}
+
+TEST(PLC_CORE, PatternMatchBestCorrelation){
+    int round;
+    for (round=0;round<40;round++){
+        // periodic signal, several positions can have (nearly) the same correlation
+        generate_voice(history, PLC_LHIST, 40.0 + round * 3.7, 500 + round * 100);
+        int expected = reference_pattern_match(history);
+        int match = btstack_plc_core_pattern_match(history, PLC_N, &history[PLC_LHIST-PLC_M], PLC_M);
+        double expected_correlation = exact_cross_correlation(&history[PLC_LHIST-PLC_M], &history[expected], PLC_M);
+        double correlation          = exact_cross_correlation(&history[PLC_LHIST-PLC_M], &history[match],    PLC_M);
+        CHECK(correlation >= (expected_correlation - 0.0001));
+    }
+}
+
+TEST(PLC_CORE, PatternMatchSilence){
+    CHECK_EQUAL(0, btstack_plc_core_pattern_match(history, PLC_N, &history[PLC_LHIST-PLC_M], PLC_M));
+    CHECK_EQUAL(reference_pattern_match(history), btstack_plc_core_pattern_match(history, PLC_N, &history[PLC_LHIST-PLC_M], PLC_M));
+}
+
+TEST(PLC_CORE, AmplitudeMatch){
+    static int16_t x[PLC_FS];
+    static int16_t y[PLC_FS];
+    int round;
+    int i;
+    for (round=0;round<100;round++){
+        for (i=0;i<PLC_FS;i++){
+            x[i] = random_sample(30000);
+            y[i] = (int16_t) ((random_sample(30000) * (round + 50)) / 100);
+        }
+        float expected = reference_amplitude_match(x, y, PLC_FS) * 32768.0f;
+        uint16_t scale_factor = btstack_plc_core_amplitude_match(x, y, PLC_FS);
+        CHECK(fabsf(expected - (float) scale_factor) <= 1.0f);
+    }
+    // silence
+    memset(x, 0, sizeof(x));
+    memset(y, 0, sizeof(y));
+    CHECK_EQUAL(BTSTACK_PLC_CORE_SCALE_FACTOR_MIN, btstack_plc_core_amplitude_match(x, y, PLC_FS));
+    x[0] = 1;
+    CHECK_EQUAL(BTSTACK_PLC_CORE_SCALE_FACTOR_MAX, btstack_plc_core_amplitude_match(x, y, PLC_FS));
+}
+
+TEST(PLC_CORE, ScaleAndMix){
+    int32_t sample;
+    for (sample=-32768;sample<=32767;sample+=7){
+        uint16_t scale_factor = (uint16_t) (BTSTACK_PLC_CORE_SCALE_FACTOR_MIN + (sample & 0x1fff));
+        float expected = (float) sample * scale_factor / 32768.0f;
+        CHECK(fabsf(expected - btstack_plc_core_scale_sample((int16_t) sample, scale_factor)) <= 1.0f);
+
+        uint16_t weight = (uint16_t) ((sample + 32768) / 2);
+        int16_t other = (int16_t) (-sample / 3);
+        expected = ((float) sample * weight + (float) other * (32768 - weight)) / 32768.0f;
+        CHECK(fabsf(expected - btstack_plc_core_mix_samples((int16_t) sample, weight, other, (uint16_t) (32768 - weight))) <= 1.0f);
+    }
+    // saturation
+    CHECK_EQUAL(-32768, btstack_plc_core_scale_sample(-32768, 32768));
+    CHECK_EQUAL(32767, btstack_plc_core_mix_samples(32767, 32768, 32767, 32768));
+    CHECK_EQUAL(-32768, btstack_plc_core_mix_samples(-32768, 32768, -32768, 32768));
+    CHECK_EQUAL(16384, btstack_plc_core_scale_weight(32768, 16384));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
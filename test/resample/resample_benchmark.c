@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// Throughput benchmark for btstack_resample_polyphase, btstack_resample for reference
+// run 'make benchmark' to compare SIMD and scalar build
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "btstack_resample.h"
+#include "btstack_resample_polyphase.h"
+
+#define BENCHMARK_SECONDS      10
+#define BENCHMARK_BLOCK_FRAMES 128
+#define BENCHMARK_MAX_TAPS     64
+
+static int16_t coefficients[441 * BENCHMARK_MAX_TAPS];
+static int16_t input_buffer[BENCHMARK_BLOCK_FRAMES * 2];
+static int16_t output_buffer[(BENCHMARK_BLOCK_FRAMES * 6 + 8) * 2];
+
+uint32_t btstack_min(uint32_t a, uint32_t b){
+    return a < b ? a : b;
+}
+
+uint32_t btstack_max(uint32_t a, uint32_t b){
+    return a > b ? a : b;
+}
+
+static double benchmark_time_us(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double) now.tv_sec * 1000000.0) + ((double) now.tv_nsec / 1000.0);
+}
+
+static void benchmark_report(const char * name, uint32_t input_frames, double duration_us, uint32_t checksum){
+    printf("%-44s %8.1f x realtime %10.0f frames/s  checksum %08x\n", name, (input_frames * 1000000.0) / duration_us / (input_frames / BENCHMARK_SECONDS),
+           (input_frames * 1000000.0) / duration_us, checksum);
+}
+
+static void benchmark_fill_input(uint8_t num_channels){
+    uint32_t i;
+    uint32_t seed = 0x12345678;
+    for (i = 0; i < (BENCHMARK_BLOCK_FRAMES * num_channels); i++){
+        seed = (seed * 1103515245u) + 12345u;
+        input_buffer[i] = (int16_t) (seed >> 16);
+    }
+}
+
+static void benchmark_polyphase(uint32_t input_rate, uint32_t output_rate, uint8_t num_channels, uint16_t num_taps){
+    btstack_resample_polyphase_t resample;
+    char label[60];
+    uint32_t checksum = 0;
+    uint32_t input_frames = 0;
+    uint32_t i;
+
+    btstack_resample_polyphase_init(&resample, input_rate, output_rate, num_channels, num_taps, coefficients, sizeof(coefficients) / sizeof(int16_t));
+    benchmark_fill_input(num_channels);
+
+    double start = benchmark_time_us();
+    while (input_frames < (input_rate * BENCHMARK_SECONDS)){
+        uint32_t frames = btstack_resample_polyphase_block(&resample, input_buffer, BENCHMARK_BLOCK_FRAMES, output_buffer);
+        for (i = 0; i < (frames * num_channels); i++){
+            checksum = (checksum * 31u) + (uint16_t) output_buffer[i];
+        }
+        input_frames += BENCHMARK_BLOCK_FRAMES;
+    }
+    snprintf(label, sizeof(label), "polyphase %5u -> %5u, %u ch, %2u taps", input_rate, output_rate, num_channels, num_taps);
+    benchmark_report(label, input_frames, benchmark_time_us() - start, checksum);
+}
+
+static void benchmark_linear(uint32_t input_rate, uint32_t output_rate, uint8_t num_channels){
+    btstack_resample_t resample;
+    char label[60];
+    uint32_t checksum = 0;
+    uint32_t input_frames = 0;
+    uint32_t i;
+
+    btstack_resample_init(&resample, num_channels);
+    btstack_resample_set_factor(&resample, (uint32_t) (((uint64_t) input_rate << 16) / output_rate));
+    benchmark_fill_input(num_channels);
+
+    double start = benchmark_time_us();
+    while (input_frames < (input_rate * BENCHMARK_SECONDS)){
+        uint32_t frames = btstack_resample_block(&resample, input_buffer, BENCHMARK_BLOCK_FRAMES, output_buffer);
+        for (i = 0; i < (frames * num_channels); i++){
+            checksum = (checksum * 31u) + (uint16_t) output_buffer[i];
+        }
+        input_frames += BENCHMARK_BLOCK_FRAMES;
+    }
+    snprintf(label, sizeof(label), "linear    %5u -> %5u, %u ch", input_rate, output_rate, num_channels);
+    benchmark_report(label, input_frames, benchmark_time_us() - start, checksum);
+}
+
+int main(void){
+#if defined(BTSTACK_RESAMPLE_POLYPHASE_NO_SIMD)
+    printf("btstack_resample_polyphase without SIMD\n");
+#else
+    printf("btstack_resample_polyphase\n");
+#endif
+    benchmark_polyphase(44100, 48000, 2, 32);
+    benchmark_polyphase(44100, 48000, 2, 64);
+    benchmark_polyphase(48000, 44100, 2, 32);
+    benchmark_polyphase(16000, 48000, 1, 32);
+    benchmark_polyphase(48000, 16000, 1, 32);
+    benchmark_polyphase(16000, 32000, 1, 32);
+    benchmark_linear(44100, 48000, 2);
+    return 0;
+}
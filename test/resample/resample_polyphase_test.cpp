@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "bluetooth.h"
+#include "btstack_resample_polyphase.h"
+#include "btstack_util.h"
+
+#define NUM_TAPS       32
+#define MAX_FRAMES     48000
+#define MAX_CHANNELS   2
+
+static int16_t coefficients[441 * NUM_TAPS];
+static int16_t input_buffer[MAX_FRAMES * MAX_CHANNELS];
+static int16_t output_buffer[(MAX_FRAMES * 6 + 64) * MAX_CHANNELS];
+
+static btstack_resample_polyphase_t resample;
+
+static void generate_sine(int16_t * buffer, uint32_t num_frames, uint8_t num_channels, uint32_t sample_rate, double frequency, double amplitude){
+    uint32_t i;
+    uint8_t channel;
+    for (i = 0; i < num_frames; i++){
+        double value = amplitude * sin((2.0 * M_PI * frequency * i) / sample_rate);
+        for (channel = 0; channel < num_channels; channel++){
+            // second channel inverted
+            buffer[i * num_channels + channel] = (int16_t) lrint((channel == 0) ? value : -value);
+        }
+    }
+}
+
+// THD+N in dB: fit sine with known frequency, everything else is noise and distortion
+static double measure_thd_n(const int16_t * buffer, uint32_t num_frames, uint8_t num_channels, uint8_t channel, uint32_t sample_rate, double frequency){
+    double ss = 0.0, sc = 0.0, cc = 0.0, ys = 0.0, yc = 0.0;
+    uint32_t i;
+    for (i = 0; i < num_frames; i++){
+        double s = sin((2.0 * M_PI * frequency * i) / sample_rate);
+        double c = cos((2.0 * M_PI * frequency * i) / sample_rate);
+        double y = buffer[i * num_channels + channel];
+        ss += s * s; sc += s * c; cc += c * c;
+        ys += y * s; yc += y * c;
+    }
+    double det = (ss * cc) - (sc * sc);
+    double a = ((ys * cc) - (yc * sc)) / det;
+    double b = ((yc * ss) - (ys * sc)) / det;
+    double signal = 0.0, noise = 0.0;
+    for (i = 0; i < num_frames; i++){
+        double fit = (a * sin((2.0 * M_PI * frequency * i) / sample_rate)) + (b * cos((2.0 * M_PI * frequency * i) / sample_rate));
+        double error = buffer[i * num_channels + channel] - fit;
+        signal += fit * fit;
+        noise  += error * error;
+    }
+    return 10.0 * log10(signal / noise);
+}
+
+// resample one second of a sine in blocks of given size and return THD+N of output, settling time skipped
+static double resample_sine(uint32_t input_rate, uint32_t output_rate, uint8_t num_channels, double frequency, uint32_t block_frames, uint32_t * output_frames){
+    uint8_t status = btstack_resample_polyphase_init(&resample, input_rate, output_rate, num_channels, NUM_TAPS, coefficients, sizeof(coefficients) / sizeof(int16_t));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+    generate_sine(input_buffer, input_rate, num_channels, input_rate, frequency, 16384.0);
+    uint32_t num_output_frames = 0;
+    uint32_t pos;
+    for (pos = 0; pos < input_rate; pos += block_frames){
+        uint32_t num_frames = btstack_min(block_frames, input_rate - pos);
+        uint32_t max_frames = btstack_resample_polyphase_get_max_output_frames(&resample, num_frames);
+        uint32_t frames = btstack_resample_polyphase_block(&resample, &input_buffer[pos * num_channels], num_frames, &output_buffer[num_output_frames * num_channels]);
+        CHECK_TRUE(frames <= max_frames);
+        num_output_frames += frames;
+    }
+    *output_frames = num_output_frames;
+    uint32_t skip = NUM_TAPS * output_rate / input_rate;
+    double thd_n = measure_thd_n(&output_buffer[skip * num_channels], num_output_frames - skip, num_channels, 0, output_rate, frequency);
+    if (num_channels > 1){
+        double thd_n_right = measure_thd_n(&output_buffer[skip * num_channels], num_output_frames - skip, num_channels, 1, output_rate, frequency);
+        thd_n = fmin(thd_n, thd_n_right);
+    }
+    return thd_n;
+}
+
+uint32_t btstack_min(uint32_t a, uint32_t b){
+    return a < b ? a : b;
+}
+
+uint32_t btstack_max(uint32_t a, uint32_t b){
+    return a > b ? a : b;
+}
+
+TEST_GROUP(ResamplePolyphase){
+};
+
+TEST(ResamplePolyphase, InvalidParameters){
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, btstack_resample_polyphase_init(&resample, 44100, 48000, 0, NUM_TAPS, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, btstack_resample_polyphase_init(&resample, 44100, 48000, MAX_CHANNELS + 1, NUM_TAPS, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, btstack_resample_polyphase_init(&resample, 0, 48000, 1, NUM_TAPS, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, btstack_resample_polyphase_init(&resample, 44100, 48000, 1, 30, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, btstack_resample_polyphase_init(&resample, 44100, 48000, 1, BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS + 8, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    CHECK_EQUAL(ERROR_CODE_MEMORY_CAPACITY_EXCEEDED, btstack_resample_polyphase_init(&resample, 44100, 48000, 1, NUM_TAPS, coefficients, 160 * NUM_TAPS - 1));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, btstack_resample_polyphase_init(&resample, 44100, 48000, 1, NUM_TAPS, coefficients, 160 * NUM_TAPS));
+}
+
+TEST(ResamplePolyphase, NumCoefficients){
+    CHECK_EQUAL(160 * NUM_TAPS, btstack_resample_polyphase_get_num_coefficients(44100, 48000, NUM_TAPS));
+    CHECK_EQUAL(147 * NUM_TAPS, btstack_resample_polyphase_get_num_coefficients(48000, 44100, NUM_TAPS));
+    CHECK_EQUAL(3 * NUM_TAPS,   btstack_resample_polyphase_get_num_coefficients(16000, 48000, NUM_TAPS));
+    CHECK_EQUAL(1 * NUM_TAPS,   btstack_resample_polyphase_get_num_coefficients(48000, 16000, NUM_TAPS));
+    CHECK_EQUAL(2 * NUM_TAPS,   btstack_resample_polyphase_get_num_coefficients(16000, 32000, NUM_TAPS));
+    CHECK_EQUAL(0,              btstack_resample_polyphase_get_num_coefficients(16000, 32000, 12));
+}
+
+TEST(ResamplePolyphase, MaxOutputFramesLargeBlock){
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, btstack_resample_polyphase_init(&resample, 44100, 48000, 1, NUM_TAPS, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    // num_frames * num_phases exceeds 32 bit
+    uint32_t num_frames = 0x10000000u;
+    CHECK_EQUAL((uint32_t) (((uint64_t) num_frames * 160u) / 147u) + 1u, btstack_resample_polyphase_get_max_output_frames(&resample, num_frames));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, btstack_resample_polyphase_init(&resample, 16000, 48000, 1, NUM_TAPS, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    CHECK_EQUAL(UINT32_MAX, btstack_resample_polyphase_get_max_output_frames(&resample, UINT32_MAX));
+}
+
+TEST(ResamplePolyphase, DCGain){
+    uint32_t i;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, btstack_resample_polyphase_init(&resample, 44100, 48000, 1, NUM_TAPS, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    for (i = 0; i < 4410; i++){
+        input_buffer[i] = 10000;
+    }
+    uint32_t frames = btstack_resample_polyphase_block(&resample, input_buffer, 4410, output_buffer);
+    CHECK_EQUAL(4800, frames);
+    for (i = NUM_TAPS * 2; i < frames; i++){
+        CHECK_TRUE(abs(output_buffer[i] - 10000) <= 4);
+    }
+}
+
+TEST(ResamplePolyphase, Saturation){
+    uint32_t i;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, btstack_resample_polyphase_init(&resample, 16000, 48000, 1, NUM_TAPS, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    // full scale square wave overshoots
+    for (i = 0; i < 1600; i++){
+        input_buffer[i] = ((i / 8) & 1) ? 32767 : -32768;
+    }
+    uint32_t frames = btstack_resample_polyphase_block(&resample, input_buffer, 1600, output_buffer);
+    CHECK_EQUAL(4800, frames);
+    bool clipped = false;
+    for (i = 0; i < frames; i++){
+        if ((output_buffer[i] == 32767) || (output_buffer[i] == -32768)){
+            clipped = true;
+        }
+    }
+    CHECK_TRUE(clipped);
+}
+
+TEST(ResamplePolyphase, BlockSizeIndependent){
+    uint32_t frames_one_block;
+    uint32_t frames_small_blocks;
+    resample_sine(44100, 48000, 2, 1000.0, 44100, &frames_one_block);
+    static int16_t reference[48000 * 2];
+    memcpy(reference, output_buffer, sizeof(reference));
+    resample_sine(44100, 48000, 2, 1000.0, 13, &frames_small_blocks);
+    CHECK_EQUAL(48000, frames_one_block);
+    CHECK_EQUAL(48000, frames_small_blocks);
+    MEMCMP_EQUAL(reference, output_buffer, sizeof(reference));
+}
+
+TEST(ResamplePolyphase, Reset){
+    uint32_t frames;
+    resample_sine(16000, 48000, 1, 1000.0, 160, &frames);
+    static int16_t reference[48000];
+    memcpy(reference, output_buffer, sizeof(reference));
+    btstack_resample_polyphase_reset(&resample);
+    uint32_t pos;
+    frames = 0;
+    for (pos = 0; pos < 16000; pos += 160){
+        frames += btstack_resample_polyphase_block(&resample, &input_buffer[pos], 160, &output_buffer[frames]);
+    }
+    CHECK_EQUAL(48000, frames);
+    MEMCMP_EQUAL(reference, output_buffer, sizeof(reference));
+}
+
+// tone above output Nyquist frequency is removed
+TEST(ResamplePolyphase, AliasRejection){
+    uint32_t i;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, btstack_resample_polyphase_init(&resample, 48000, 16000, 1, NUM_TAPS, coefficients, sizeof(coefficients) / sizeof(int16_t)));
+    generate_sine(input_buffer, 48000, 1, 48000, 12000.0, 16384.0);
+    uint32_t frames = btstack_resample_polyphase_block(&resample, input_buffer, 48000, output_buffer);
+    CHECK_EQUAL(16000, frames);
+    double energy = 0.0;
+    for (i = NUM_TAPS; i < frames; i++){
+        energy += (double) output_buffer[i] * output_buffer[i];
+    }
+    double rms = sqrt(energy / (frames - NUM_TAPS));
+    double attenuation = 20.0 * log10((16384.0 / sqrt(2.0)) / rms);
+    printf("48000 -> 16000 Hz, 12000 Hz: attenuation %.1f dB\n", attenuation);
+    CHECK_TRUE(attenuation > 70.0);
+}
+
+// THD+N of 1 kHz sine at -6 dBFS for common conversions
+TEST(ResamplePolyphase, THD_N){
+    static const struct {
+        uint32_t input_rate;
+        uint32_t output_rate;
+        uint8_t  num_channels;
+        double   frequency;
+    } conversions[] = {
+        { 44100, 48000, 2, 1000.0 },
+        { 48000, 44100, 2, 1000.0 },
+        { 16000, 48000, 1, 1000.0 },
+        { 48000, 16000, 1, 1000.0 },
+        { 16000, 32000, 1, 1000.0 },
+        { 32000, 16000, 1, 1000.0 },
+        {  8000, 16000, 1, 1000.0 },
+        { 44100, 16000, 2, 3000.0 },
+        { 16000, 44100, 1, 3000.0 },
+    };
+    unsigned int i;
+    for (i = 0; i < sizeof(conversions) / sizeof(conversions[0]); i++){
+        uint32_t frames;
+        double thd_n = resample_sine(conversions[i].input_rate, conversions[i].output_rate, conversions[i].num_channels, conversions[i].frequency, 128, &frames);
+        printf("%5u -> %5u Hz, %u channel(s), %4.0f Hz: THD+N %.1f dB\n", conversions[i].input_rate, conversions[i].output_rate,
+               conversions[i].num_channels, conversions[i].frequency, thd_n);
+        CHECK_EQUAL(conversions[i].output_rate, frames);
+        CHECK_TRUE(thd_n > 80.0);
+    }
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
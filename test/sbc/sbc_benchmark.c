@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// Throughput benchmark for SBC encoder and decoder with C and SIMD filterbank implementations
+// reports frames per second and multiple of realtime for A2DP SBC (44.1 kHz, joint stereo, 8 subbands, 16 blocks, bitpool 53)
+// and mSBC (16 kHz mono)
+
+#include "btstack_config.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "btstack_sbc.h"
+#include "btstack_sbc_decoder_bluedroid.h"
+#include "btstack_sbc_encoder_bluedroid.h"
+#include "btstack_util.h"
+#include "hfp_msbc.h"
+
+#define BENCHMARK_FRAMES       100000
+#define BENCHMARK_PCM_FRAMES   64
+#define SBC_SAMPLE_RATE        44100
+#define SBC_BLOCKS             16
+#define SBC_SUBBANDS           8
+#define SBC_CHANNELS           2
+#define SBC_BITPOOL            53
+#define SBC_FRAME_MAX          512
+#define SBC_PCM_SAMPLES        (SBC_BLOCKS * SBC_SUBBANDS * SBC_CHANNELS)
+#define MSBC_SAMPLE_RATE       16000
+#define MSBC_PCM_SAMPLES       120
+
+static int16_t pcm[BENCHMARK_PCM_FRAMES][SBC_PCM_SAMPLES];
+static uint8_t sbc_data[BENCHMARK_FRAMES * SBC_FRAME_MAX];
+static uint32_t sbc_data_len;
+static uint32_t decoded_frames;
+
+static const char * encoder_simd_name[] = { "C", "SSE2", "AVX2" };
+static const char * decoder_simd_name[] = { "C", "AVX2" };
+
+static double benchmark_time_us(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double) now.tv_sec * 1000000.0) + ((double) now.tv_nsec / 1000.0);
+}
+
+static void benchmark_report(const char * name, uint32_t frames, uint32_t samples_per_frame, uint32_t sample_rate, double duration_us){
+    double frames_per_second = (frames * 1000000.0) / duration_us;
+    printf("%-40s %10.0f frames/s %8.1f x realtime\n", name, frames_per_second, (frames_per_second * samples_per_frame) / sample_rate);
+}
+
+static void handle_pcm_data(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context){
+    UNUSED(data);
+    UNUSED(num_samples);
+    UNUSED(num_channels);
+    UNUSED(sample_rate);
+    UNUSED(context);
+    decoded_frames++;
+}
+
+static void benchmark_encoder(uint8_t simd){
+    btstack_sbc_encoder_state_t encoder_state;
+    btstack_sbc_encoder_bluedroid_t encoder;
+    char label[60];
+    uint32_t i;
+
+    btstack_sbc_encoder_init_instance(&encoder_state, &encoder, SBC_MODE_STANDARD, SBC_BLOCKS, SBC_SUBBANDS,
+                                      SBC_ALLOCATION_METHOD_LOUDNESS, SBC_SAMPLE_RATE, SBC_BITPOOL, SBC_CHANNEL_MODE_JOINT_STEREO);
+    encoder.context.u8Simd = simd;
+
+    sbc_data_len = 0;
+    double start = benchmark_time_us();
+    for (i = 0; i < BENCHMARK_FRAMES; i++){
+        btstack_sbc_encoder_instance_process_data(&encoder_state, pcm[i % BENCHMARK_PCM_FRAMES]);
+        uint16_t len = btstack_sbc_encoder_instance_sbc_buffer_length(&encoder_state);
+        memcpy(&sbc_data[sbc_data_len], btstack_sbc_encoder_instance_sbc_buffer(&encoder_state), len);
+        sbc_data_len += len;
+    }
+    snprintf(label, sizeof(label), "SBC encoder (%s)", encoder_simd_name[simd]);
+    benchmark_report(label, BENCHMARK_FRAMES, SBC_BLOCKS * SBC_SUBBANDS, SBC_SAMPLE_RATE, benchmark_time_us() - start);
+}
+
+static void benchmark_decoder(uint8_t simd){
+    btstack_sbc_decoder_state_t decoder_state;
+    btstack_sbc_decoder_bluedroid_t decoder;
+    char label[60];
+    uint32_t pos;
+
+    btstack_sbc_decoder_init_instance(&decoder_state, &decoder, SBC_MODE_STANDARD, &handle_pcm_data, NULL);
+    decoder.decoder_context.common.simd = simd;
+
+    decoded_frames = 0;
+    double start = benchmark_time_us();
+    for (pos = 0; pos < sbc_data_len; pos += SBC_FRAME_MAX){
+        btstack_sbc_decoder_process_data(&decoder_state, 0, &sbc_data[pos], btstack_min(SBC_FRAME_MAX, sbc_data_len - pos));
+    }
+    snprintf(label, sizeof(label), "SBC decoder (%s)", decoder_simd_name[simd]);
+    benchmark_report(label, decoded_frames, SBC_BLOCKS * SBC_SUBBANDS, SBC_SAMPLE_RATE, benchmark_time_us() - start);
+}
+
+static void benchmark_msbc_encoder(uint8_t simd){
+    hfp_msbc_t msbc;
+    char label[60];
+    uint8_t msbc_frame[60];
+    uint32_t i;
+
+    hfp_msbc_init_instance(&msbc);
+    msbc.sbc_encoder.context.u8Simd = simd;
+
+    double start = benchmark_time_us();
+    for (i = 0; i < BENCHMARK_FRAMES; i++){
+        hfp_msbc_instance_encode_audio_frame(&msbc, pcm[i % BENCHMARK_PCM_FRAMES]);
+        hfp_msbc_instance_read_from_stream(&msbc, msbc_frame, sizeof(msbc_frame));
+    }
+    snprintf(label, sizeof(label), "mSBC encoder (%s)", encoder_simd_name[simd]);
+    benchmark_report(label, BENCHMARK_FRAMES, MSBC_PCM_SAMPLES, MSBC_SAMPLE_RATE, benchmark_time_us() - start);
+    hfp_msbc_deinit_instance(&msbc);
+}
+
+int main(void){
+    uint8_t encoder_simd_support = SBC_Encoder_GetSimdSupport();
+    uint8_t decoder_simd_support = OI_CODEC_SBC_GetSimdSupport();
+    int16_t * samples = &pcm[0][0];
+    uint32_t i;
+    uint8_t simd;
+
+    // two tones with noise, different per channel
+    for (i = 0; i < (BENCHMARK_PCM_FRAMES * SBC_BLOCKS * SBC_SUBBANDS); i++){
+        double t = (double) i / SBC_SAMPLE_RATE;
+        int16_t noise = (int16_t) (((i * 1103515245u) + 12345u) >> 22);
+        samples[(i * 2) + 0] = (int16_t) (8000.0 * sin(2.0 * M_PI * 440.0 * t)) + noise;
+        samples[(i * 2) + 1] = (int16_t) (6000.0 * sin(2.0 * M_PI * 1250.0 * t)) - noise;
+    }
+
+    for (simd = SBC_SIMD_NONE; simd <= SBC_SIMD_AVX2; simd++){
+        if (encoder_simd_support & (1 << simd)){
+            benchmark_encoder(simd);
+        }
+    }
+    for (simd = OI_CODEC_SBC_SIMD_NONE; simd <= OI_CODEC_SBC_SIMD_AVX2; simd++){
+        if (decoder_simd_support & (1 << simd)){
+            benchmark_decoder(simd);
+        }
+    }
+    for (simd = SBC_SIMD_NONE; simd <= SBC_SIMD_AVX2; simd++){
+        if (encoder_simd_support & (1 << simd)){
+            benchmark_msbc_encoder(simd);
+        }
+    }
+    return 0;
+}
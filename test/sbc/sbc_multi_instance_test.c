@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+ 
+// *****************************************************************************
+//
+// SBC multi-instance tests
+//
+// Encodes and decodes several streams with independent encoder/decoder instances,
+// interleaved on one thread and concurrently on worker threads, and compares the
+// result against encoding each stream on its own.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_sbc.h"
+#include "btstack_sbc_decoder_bluedroid.h"
+#include "btstack_sbc_encoder_bluedroid.h"
+#include "hfp_msbc.h"
+
+#define NUM_STREAMS      4
+#define NUM_FRAMES       200
+#define SBC_SAMPLE_RATE  44100
+#define SBC_BLOCKS       16
+#define SBC_SUBBANDS     8
+#define SBC_CHANNELS     2
+#define SBC_FRAME_MAX    512
+#define SBC_PCM_SAMPLES  (SBC_BLOCKS * SBC_SUBBANDS * SBC_CHANNELS)
+#define MSBC_PCM_SAMPLES 120
+#define MSBC_STREAM_SIZE (NUM_FRAMES * 60)
+
+typedef struct {
+    int stream;
+    // encoder
+    btstack_sbc_encoder_state_t encoder_state;
+    btstack_sbc_encoder_bluedroid_t encoder;
+    uint8_t  sbc_data[NUM_FRAMES][SBC_FRAME_MAX];
+    uint16_t sbc_len[NUM_FRAMES];
+    // decoder
+    btstack_sbc_decoder_state_t decoder_state;
+    btstack_sbc_decoder_bluedroid_t decoder;
+    uint32_t pcm_checksum;
+    int      pcm_frames;
+    // mSBC
+    hfp_msbc_t msbc;
+    uint8_t  msbc_data[MSBC_STREAM_SIZE];
+} test_stream_t;
+
+static test_stream_t reference[NUM_STREAMS];
+static test_stream_t interleaved[NUM_STREAMS];
+static test_stream_t threaded[NUM_STREAMS];
+
+static int errors;
+
+// each stream uses a different tone, bitpool and channel mode
+static void stream_pcm(int stream, int frame, int num_samples, int num_channels, int16_t * pcm){
+    int i;
+    double frequency = 440.0 * (stream + 1);
+    for (i = 0; i < num_samples; i++){
+        int sample_index = (frame * num_samples) + i;
+        double value = sin(2.0 * M_PI * frequency * sample_index / SBC_SAMPLE_RATE);
+        int channel;
+        for (channel = 0; channel < num_channels; channel++){
+            pcm[(i * num_channels) + channel] = (int16_t) (value * (8000 + (channel * 4000)));
+        }
+    }
+}
+
+static btstack_sbc_channel_mode_t stream_channel_mode(int stream){
+    return (stream & 1) ? SBC_CHANNEL_MODE_JOINT_STEREO : SBC_CHANNEL_MODE_STEREO;
+}
+
+static int stream_bitpool(int stream){
+    return 35 + (stream * 5);
+}
+
+static void handle_pcm_data(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context){
+    (void) sample_rate;
+    test_stream_t * test_stream = (test_stream_t *) context;
+    int i;
+    for (i = 0; i < (num_samples * num_channels); i++){
+        test_stream->pcm_checksum = (test_stream->pcm_checksum * 31u) + (uint16_t) data[i];
+    }
+    test_stream->pcm_frames++;
+}
+
+static void stream_init(test_stream_t * test_stream, int stream){
+    test_stream->stream = stream;
+    test_stream->pcm_checksum = 0;
+    test_stream->pcm_frames = 0;
+    btstack_sbc_encoder_init_instance(&test_stream->encoder_state, &test_stream->encoder, SBC_MODE_STANDARD,
+                                      SBC_BLOCKS, SBC_SUBBANDS, SBC_ALLOCATION_METHOD_LOUDNESS, SBC_SAMPLE_RATE,
+                                      stream_bitpool(stream), stream_channel_mode(stream));
+    btstack_sbc_decoder_init_instance(&test_stream->decoder_state, &test_stream->decoder, SBC_MODE_STANDARD,
+                                      &handle_pcm_data, test_stream);
+    hfp_msbc_init_instance(&test_stream->msbc);
+}
+
+static void stream_process_frame(test_stream_t * test_stream, int frame){
+    int16_t pcm[SBC_PCM_SAMPLES];
+    int16_t msbc_pcm[MSBC_PCM_SAMPLES];
+
+    // SBC encode + decode
+    stream_pcm(test_stream->stream, frame, SBC_BLOCKS * SBC_SUBBANDS, SBC_CHANNELS, pcm);
+    btstack_sbc_encoder_instance_process_data(&test_stream->encoder_state, pcm);
+    uint16_t len = btstack_sbc_encoder_instance_sbc_buffer_length(&test_stream->encoder_state);
+    memcpy(test_stream->sbc_data[frame], btstack_sbc_encoder_instance_sbc_buffer(&test_stream->encoder_state), len);
+    test_stream->sbc_len[frame] = len;
+    btstack_sbc_decoder_process_data(&test_stream->decoder_state, 0, test_stream->sbc_data[frame], len);
+
+    // mSBC encode
+    stream_pcm(test_stream->stream, frame, MSBC_PCM_SAMPLES, 1, msbc_pcm);
+    hfp_msbc_instance_encode_audio_frame(&test_stream->msbc, msbc_pcm);
+    hfp_msbc_instance_read_from_stream(&test_stream->msbc, &test_stream->msbc_data[frame * 60], 60);
+}
+
+static void * stream_thread(void * arg){
+    test_stream_t * test_stream = (test_stream_t *) arg;
+    int frame;
+    for (frame = 0; frame < NUM_FRAMES; frame++){
+        stream_process_frame(test_stream, frame);
+    }
+    return NULL;
+}
+
+static void compare(const char * name, test_stream_t * expected, test_stream_t * actual){
+    int stream;
+    for (stream = 0; stream < NUM_STREAMS; stream++){
+        if ((memcmp(expected[stream].sbc_len, actual[stream].sbc_len, sizeof(expected[stream].sbc_len)) != 0) ||
+            (memcmp(expected[stream].sbc_data, actual[stream].sbc_data, sizeof(expected[stream].sbc_data)) != 0)){
+            printf("%s: stream %u SBC data differs\n", name, stream);
+            errors++;
+        }
+        if ((expected[stream].pcm_frames != actual[stream].pcm_frames) ||
+            (expected[stream].pcm_checksum != actual[stream].pcm_checksum)){
+            printf("%s: stream %u decoded PCM differs\n", name, stream);
+            errors++;
+        }
+        if (memcmp(expected[stream].msbc_data, actual[stream].msbc_data, sizeof(expected[stream].msbc_data)) != 0){
+            printf("%s: stream %u mSBC data differs\n", name, stream);
+            errors++;
+        }
+    }
+}
+
+int main (int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+    int stream;
+    int frame;
+
+    // reference: one stream after the other
+    for (stream = 0; stream < NUM_STREAMS; stream++){
+        stream_init(&reference[stream], stream);
+        for (frame = 0; frame < NUM_FRAMES; frame++){
+            stream_process_frame(&reference[stream], frame);
+        }
+        if (reference[stream].pcm_frames != NUM_FRAMES){
+            printf("reference: stream %u decoded %u of %u frames\n", stream, reference[stream].pcm_frames, NUM_FRAMES);
+            errors++;
+        }
+    }
+
+    // legacy API must match reference for stream 0
+    btstack_sbc_encoder_state_t encoder_state;
+    btstack_sbc_encoder_init(&encoder_state, SBC_MODE_STANDARD, SBC_BLOCKS, SBC_SUBBANDS, SBC_ALLOCATION_METHOD_LOUDNESS,
+                             SBC_SAMPLE_RATE, stream_bitpool(0), stream_channel_mode(0));
+    hfp_msbc_init();
+    for (frame = 0; frame < NUM_FRAMES; frame++){
+        int16_t pcm[SBC_PCM_SAMPLES];
+        int16_t msbc_pcm[MSBC_PCM_SAMPLES];
+        uint8_t msbc_frame[60];
+        stream_pcm(0, frame, SBC_BLOCKS * SBC_SUBBANDS, SBC_CHANNELS, pcm);
+        btstack_sbc_encoder_process_data(pcm);
+        if ((btstack_sbc_encoder_sbc_buffer_length() != reference[0].sbc_len[frame]) ||
+            (memcmp(btstack_sbc_encoder_sbc_buffer(), reference[0].sbc_data[frame], reference[0].sbc_len[frame]) != 0)){
+            printf("legacy: SBC frame %u differs\n", frame);
+            errors++;
+            break;
+        }
+        stream_pcm(0, frame, MSBC_PCM_SAMPLES, 1, msbc_pcm);
+        hfp_msbc_encode_audio_frame(msbc_pcm);
+        hfp_msbc_read_from_stream(msbc_frame, sizeof(msbc_frame));
+        if (memcmp(msbc_frame, &reference[0].msbc_data[frame * 60], sizeof(msbc_frame)) != 0){
+            printf("legacy: mSBC frame %u differs\n", frame);
+            errors++;
+            break;
+        }
+    }
+    hfp_msbc_deinit();
+
+    // in place: stream 2 encoded back-to-back into one buffer, starting with bitpool of stream 0
+    static uint8_t in_place_data[NUM_FRAMES * SBC_FRAME_MAX];
+    btstack_sbc_encoder_state_t in_place_state;
+    btstack_sbc_encoder_bluedroid_t in_place_encoder;
+    uint32_t in_place_pos = 0;
+    btstack_sbc_encoder_init_instance(&in_place_state, &in_place_encoder, SBC_MODE_STANDARD, SBC_BLOCKS, SBC_SUBBANDS,
+                                      SBC_ALLOCATION_METHOD_LOUDNESS, SBC_SAMPLE_RATE, stream_bitpool(0), stream_channel_mode(2));
+    btstack_sbc_encoder_instance_set_bitpool(&in_place_state, stream_bitpool(2));
+    for (frame = 0; frame < NUM_FRAMES; frame++){
+        int16_t pcm[SBC_PCM_SAMPLES];
+        stream_pcm(2, frame, SBC_BLOCKS * SBC_SUBBANDS, SBC_CHANNELS, pcm);
+        btstack_sbc_encoder_instance_process_data_to_buffer(&in_place_state, pcm, &in_place_data[in_place_pos]);
+        uint16_t len = btstack_sbc_encoder_instance_sbc_buffer_length(&in_place_state);
+        if ((len != reference[2].sbc_len[frame]) || (memcmp(&in_place_data[in_place_pos], reference[2].sbc_data[frame], len) != 0)){
+            printf("in place: SBC frame %u differs\n", frame);
+            errors++;
+            break;
+        }
+        in_place_pos += len;
+    }
+    if (btstack_sbc_encoder_instance_sbc_buffer(&in_place_state) != in_place_encoder.sbc_packet){
+        printf("in place: SBC frame buffer not restored\n");
+        errors++;
+    }
+
+    // interleaved: all streams frame by frame on one thread
+    for (stream = 0; stream < NUM_STREAMS; stream++){
+        stream_init(&interleaved[stream], stream);
+    }
+    for (frame = 0; frame < NUM_FRAMES; frame++){
+        for (stream = 0; stream < NUM_STREAMS; stream++){
+            stream_process_frame(&interleaved[stream], frame);
+        }
+    }
+    compare("interleaved", reference, interleaved);
+
+    // threaded: each stream on its own worker thread
+    pthread_t threads[NUM_STREAMS];
+    for (stream = 0; stream < NUM_STREAMS; stream++){
+        stream_init(&threaded[stream], stream);
+        pthread_create(&threads[stream], NULL, &stream_thread, &threaded[stream]);
+    }
+    for (stream = 0; stream < NUM_STREAMS; stream++){
+        pthread_join(threads[stream], NULL);
+    }
+    compare("threaded", reference, threaded);
+
+    if (errors){
+        printf("SBC multi-instance test: %u errors\n", errors);
+        return 1;
+    }
+    printf("SBC multi-instance test: OK\n");
+    return 0;
+}
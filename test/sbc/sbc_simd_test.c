@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+ 
+// *****************************************************************************
+//
+// SBC SIMD tests
+//
+// Encodes the test/sbc/data wav files with all SBC configurations using the C analysis
+// window and each SIMD implementation supported by the CPU, and decodes the test/sbc/data
+// SBC/mSBC streams with the C and SIMD synthesis windows. Results must be identical.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_sbc.h"
+#include "btstack_sbc_decoder_bluedroid.h"
+#include "btstack_sbc_encoder_bluedroid.h"
+#include "btstack_util.h"
+#include "hfp_msbc.h"
+#include "wav_util.h"
+
+#define MAX_SBC_FRAMES    2000
+#define MAX_PCM_SAMPLES   (MAX_SBC_FRAMES * 16 * 8 * 2)
+#define SBC_FRAME_MAX     1000
+#define DECODER_CHUNK     512
+
+typedef struct {
+    const char * name;
+    int num_channels;
+    int sample_rate;
+    int num_samples;        // per channel
+    int16_t pcm[MAX_PCM_SAMPLES];
+} test_wav_t;
+
+typedef struct {
+    uint8_t  data[MAX_SBC_FRAMES][SBC_FRAME_MAX];
+    uint16_t len[MAX_SBC_FRAMES];
+    int      num_frames;
+} test_sbc_stream_t;
+
+typedef struct {
+    uint32_t checksum;
+    int      num_frames;
+    int      num_samples;
+} test_pcm_result_t;
+
+static test_wav_t wav;
+static test_sbc_stream_t sbc_reference;
+static test_sbc_stream_t sbc_simd;
+
+static uint8_t encoder_simd_support;
+static uint8_t decoder_simd_support;
+
+static int errors;
+static int encoder_checks;
+static int decoder_checks;
+
+static const char * encoder_simd_name(uint8_t simd){
+    switch (simd){
+        case SBC_SIMD_NONE: return "C";
+        case SBC_SIMD_SSE2: return "SSE2";
+        case SBC_SIMD_AVX2: return "AVX2";
+        default: return "?";
+    }
+}
+
+static const char * decoder_simd_name(uint8_t simd){
+    switch (simd){
+        case OI_CODEC_SBC_SIMD_NONE: return "C";
+        case OI_CODEC_SBC_SIMD_AVX2: return "AVX2";
+        default: return "?";
+    }
+}
+
+static int wav_load(const char * name){
+    char path[100];
+    snprintf(path, sizeof(path), "data/%s", name);
+    if (wav_reader_open(path) != 0){
+        printf("%s: cannot open\n", path);
+        errors++;
+        return 0;
+    }
+    wav.name = name;
+    wav.num_channels = wav_reader_get_num_channels();
+    wav.sample_rate  = wav_reader_get_sampling_rate();
+    wav.num_samples  = 0;
+    int max_samples = MAX_PCM_SAMPLES / wav.num_channels;
+    while (wav.num_samples < max_samples){
+        if (wav_reader_read_int16(wav.num_channels, &wav.pcm[wav.num_samples * wav.num_channels]) != 0) break;
+        wav.num_samples++;
+    }
+    wav_reader_close();
+    return 1;
+}
+
+// encode wav with given configuration and analysis window implementation
+static void encode(test_sbc_stream_t * stream, uint8_t simd, int blocks, int subbands,
+                   btstack_sbc_allocation_method_t allocation_method, int bitpool, btstack_sbc_channel_mode_t channel_mode){
+    btstack_sbc_encoder_state_t encoder_state;
+    btstack_sbc_encoder_bluedroid_t encoder;
+    btstack_sbc_encoder_init_instance(&encoder_state, &encoder, SBC_MODE_STANDARD, blocks, subbands, allocation_method,
+                                      wav.sample_rate, bitpool, channel_mode);
+    encoder.context.u8Simd = simd;
+
+    int samples_per_frame = blocks * subbands;
+    int frame;
+    stream->num_frames = 0;
+    for (frame = 0; frame < MAX_SBC_FRAMES; frame++){
+        if (((frame + 1) * samples_per_frame) > wav.num_samples) break;
+        btstack_sbc_encoder_instance_process_data(&encoder_state, &wav.pcm[frame * samples_per_frame * wav.num_channels]);
+        uint16_t len = btstack_sbc_encoder_instance_sbc_buffer_length(&encoder_state);
+        memcpy(stream->data[frame], btstack_sbc_encoder_instance_sbc_buffer(&encoder_state), len);
+        stream->len[frame] = len;
+        stream->num_frames++;
+    }
+}
+
+static void encode_msbc(test_sbc_stream_t * stream, uint8_t simd){
+    hfp_msbc_t msbc;
+    hfp_msbc_init_instance(&msbc);
+    msbc.sbc_encoder.context.u8Simd = simd;
+
+    int samples_per_frame = hfp_msbc_instance_num_audio_samples_per_frame(&msbc);
+    int frame;
+    stream->num_frames = 0;
+    for (frame = 0; frame < MAX_SBC_FRAMES; frame++){
+        if (((frame + 1) * samples_per_frame) > wav.num_samples) break;
+        hfp_msbc_instance_encode_audio_frame(&msbc, &wav.pcm[frame * samples_per_frame]);
+        stream->len[frame] = (uint16_t) hfp_msbc_instance_num_bytes_in_stream(&msbc);
+        hfp_msbc_instance_read_from_stream(&msbc, stream->data[frame], stream->len[frame]);
+        stream->num_frames++;
+    }
+    hfp_msbc_deinit_instance(&msbc);
+}
+
+static void compare_encoded(const char * config, uint8_t simd){
+    encoder_checks++;
+    if ((sbc_reference.num_frames != sbc_simd.num_frames) ||
+        (memcmp(sbc_reference.len, sbc_simd.len, sizeof(sbc_reference.len)) != 0)){
+        printf("%s %s: %s frame sizes differ\n", wav.name, config, encoder_simd_name(simd));
+        errors++;
+        return;
+    }
+    int frame;
+    for (frame = 0; frame < sbc_reference.num_frames; frame++){
+        if (memcmp(sbc_reference.data[frame], sbc_simd.data[frame], sbc_reference.len[frame]) != 0){
+            printf("%s %s: %s frame %u differs\n", wav.name, config, encoder_simd_name(simd), frame);
+            errors++;
+            return;
+        }
+    }
+}
+
+static void handle_pcm_data(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context){
+    (void) sample_rate;
+    test_pcm_result_t * result = (test_pcm_result_t *) context;
+    int i;
+    for (i = 0; i < (num_samples * num_channels); i++){
+        result->checksum = (result->checksum * 31u) + (uint16_t) data[i];
+    }
+    result->num_frames++;
+    result->num_samples += num_samples;
+}
+
+// decode buffer with given synthesis window implementation
+static void decode(btstack_sbc_mode_t mode, uint8_t simd, uint8_t * data, uint32_t size, test_pcm_result_t * result){
+    btstack_sbc_decoder_state_t decoder_state;
+    btstack_sbc_decoder_bluedroid_t decoder;
+    memset(result, 0, sizeof(test_pcm_result_t));
+    btstack_sbc_decoder_init_instance(&decoder_state, &decoder, mode, &handle_pcm_data, result);
+    decoder.decoder_context.common.simd = simd;
+    uint32_t pos = 0;
+    while (pos < size){
+        uint32_t chunk = btstack_min(DECODER_CHUNK, size - pos);
+        btstack_sbc_decoder_process_data(&decoder_state, 0, &data[pos], (uint16_t) chunk);
+        pos += chunk;
+    }
+}
+
+static void compare_decoded(const char * name, btstack_sbc_mode_t mode, uint8_t * data, uint32_t size){
+    test_pcm_result_t expected;
+    test_pcm_result_t actual;
+    uint8_t simd;
+    decode(mode, OI_CODEC_SBC_SIMD_NONE, data, size, &expected);
+    if (expected.num_frames == 0){
+        printf("%s: no frames decoded\n", name);
+        errors++;
+        return;
+    }
+    for (simd = OI_CODEC_SBC_SIMD_NONE + 1; simd <= OI_CODEC_SBC_SIMD_AVX2; simd++){
+        if ((decoder_simd_support & (1 << simd)) == 0) continue;
+        decoder_checks++;
+        decode(mode, simd, data, size, &actual);
+        if (memcmp(&expected, &actual, sizeof(expected)) != 0){
+            printf("%s: %s decoded PCM differs\n", name, decoder_simd_name(simd));
+            errors++;
+        }
+    }
+}
+
+static void compare_decoded_stream(const char * name, btstack_sbc_mode_t mode, test_sbc_stream_t * stream){
+    static uint8_t buffer[MAX_SBC_FRAMES * SBC_FRAME_MAX];
+    uint32_t size = 0;
+    int frame;
+    for (frame = 0; frame < stream->num_frames; frame++){
+        memcpy(&buffer[size], stream->data[frame], stream->len[frame]);
+        size += stream->len[frame];
+    }
+    compare_decoded(name, mode, buffer, size);
+}
+
+static void test_encoder_config(int blocks, int subbands, btstack_sbc_allocation_method_t allocation_method,
+                                int bitpool, btstack_sbc_channel_mode_t channel_mode){
+    char config[60];
+    uint8_t simd;
+    snprintf(config, sizeof(config), "blocks %u, subbands %u, alloc %u, bitpool %u, mode %u",
+             blocks, subbands, allocation_method, bitpool, channel_mode);
+
+    encode(&sbc_reference, SBC_SIMD_NONE, blocks, subbands, allocation_method, bitpool, channel_mode);
+    for (simd = SBC_SIMD_NONE + 1; simd <= SBC_SIMD_AVX2; simd++){
+        if ((encoder_simd_support & (1 << simd)) == 0) continue;
+        encode(&sbc_simd, simd, blocks, subbands, allocation_method, bitpool, channel_mode);
+        compare_encoded(config, simd);
+    }
+
+    // 4 subband streams use the C synthesis window, decode anyway to cover dispatch
+    char name[100];
+    snprintf(name, sizeof(name), "%s %s", wav.name, config);
+    compare_decoded_stream(name, SBC_MODE_STANDARD, &sbc_reference);
+}
+
+static void test_encoder(const char * name){
+    static const int blocks_list[] = { 4, 16 };
+    static const int subbands_list[] = { 4, 8 };
+    static const btstack_sbc_channel_mode_t stereo_modes[] = {
+        SBC_CHANNEL_MODE_STEREO, SBC_CHANNEL_MODE_JOINT_STEREO, SBC_CHANNEL_MODE_DUAL_CHANNEL
+    };
+    unsigned int b, s, m;
+
+    if (!wav_load(name)) return;
+
+    for (b = 0; b < sizeof(blocks_list) / sizeof(int); b++){
+        for (s = 0; s < sizeof(subbands_list) / sizeof(int); s++){
+            int subbands = subbands_list[s];
+            if (wav.num_channels == 1){
+                test_encoder_config(blocks_list[b], subbands, SBC_ALLOCATION_METHOD_LOUDNESS, 2, SBC_CHANNEL_MODE_MONO);
+                test_encoder_config(blocks_list[b], subbands, SBC_ALLOCATION_METHOD_SNR, 31, SBC_CHANNEL_MODE_MONO);
+                test_encoder_config(blocks_list[b], subbands, SBC_ALLOCATION_METHOD_LOUDNESS, 16 * subbands, SBC_CHANNEL_MODE_MONO);
+            } else {
+                for (m = 0; m < sizeof(stereo_modes) / sizeof(stereo_modes[0]); m++){
+                    int max_bitpool = (stereo_modes[m] == SBC_CHANNEL_MODE_DUAL_CHANNEL) ? (8 * subbands) : btstack_min(250, 32 * subbands);
+                    test_encoder_config(blocks_list[b], subbands, SBC_ALLOCATION_METHOD_LOUDNESS, 53, stereo_modes[m]);
+                    test_encoder_config(blocks_list[b], subbands, SBC_ALLOCATION_METHOD_SNR, max_bitpool, stereo_modes[m]);
+                }
+            }
+        }
+    }
+
+    if (wav.num_channels == 1){
+        uint8_t simd;
+        encode_msbc(&sbc_reference, SBC_SIMD_NONE);
+        for (simd = SBC_SIMD_NONE + 1; simd <= SBC_SIMD_AVX2; simd++){
+            if ((encoder_simd_support & (1 << simd)) == 0) continue;
+            encode_msbc(&sbc_simd, simd);
+            compare_encoded("mSBC", simd);
+        }
+        char msbc_name[60];
+        snprintf(msbc_name, sizeof(msbc_name), "%s mSBC", wav.name);
+        compare_decoded_stream(msbc_name, SBC_MODE_mSBC, &sbc_reference);
+    }
+}
+
+static void test_decoder(const char * name, btstack_sbc_mode_t mode){
+    static uint8_t data[MAX_SBC_FRAMES * SBC_FRAME_MAX];
+    char path[100];
+    snprintf(path, sizeof(path), "data/%s", name);
+    FILE * file = fopen(path, "rb");
+    if (file == NULL){
+        printf("%s: cannot open\n", path);
+        errors++;
+        return;
+    }
+    uint32_t size = (uint32_t) fread(data, 1, sizeof(data), file);
+    fclose(file);
+    compare_decoded(name, mode, data, size);
+}
+
+int main (int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+    uint8_t simd;
+
+    encoder_simd_support = SBC_Encoder_GetSimdSupport();
+    decoder_simd_support = OI_CODEC_SBC_GetSimdSupport();
+
+    printf("SBC SIMD test: encoder");
+    for (simd = SBC_SIMD_NONE + 1; simd <= SBC_SIMD_AVX2; simd++){
+        if (encoder_simd_support & (1 << simd)) printf(" %s", encoder_simd_name(simd));
+    }
+    printf(", decoder");
+    for (simd = OI_CODEC_SBC_SIMD_NONE + 1; simd <= OI_CODEC_SBC_SIMD_AVX2; simd++){
+        if (decoder_simd_support & (1 << simd)) printf(" %s", decoder_simd_name(simd));
+    }
+    printf("\n");
+
+    test_encoder("sine-mono.wav");
+    test_encoder("sine-stereo.wav");
+    test_encoder("fanfare-mono.wav");
+    test_encoder("fanfare-stereo.wav");
+
+    test_decoder("fanfare-4sb-mono.sbc",   SBC_MODE_STANDARD);
+    test_decoder("fanfare-4sb-stereo.sbc", SBC_MODE_STANDARD);
+    test_decoder("fanfare-8sb-mono.sbc",   SBC_MODE_STANDARD);
+    test_decoder("fanfare-8sb-stereo.sbc", SBC_MODE_STANDARD);
+    test_decoder("sine-4sb-stereo.sbc",    SBC_MODE_STANDARD);
+    test_decoder("sine-8sb-mono.sbc",      SBC_MODE_STANDARD);
+    test_decoder("sine-8sb-stereo.sbc",    SBC_MODE_STANDARD);
+    test_decoder("sine-stereo.sbc",        SBC_MODE_STANDARD);
+
+    if (errors){
+        printf("SBC SIMD test: %u errors\n", errors);
+        return 1;
+    }
+    printf("SBC SIMD test: %u encoder and %u decoder comparisons OK\n", encoder_checks, decoder_checks);
+    return 0;
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+
+// *****************************************************************************
+//
+// test SDP Server responses with and without UUID index
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "bluetooth_sdp.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "classic/sdp_server.h"
+#include "classic/sdp_util.h"
+#include "l2cap.h"
+
+#define TEST_NUM_RECORDS   12
+#define TEST_CID           0x41
+#define TEST_TRANSCRIPT    30000
+
+static const uint8_t custom_uuid128[] = { 0xE0, 0x1C, 0x3B, 0x00, 0x4A, 0x02, 0x11, 0xE8, 0x9B, 0x4C, 0x00, 0x02, 0xA5, 0xD5, 0xC5, 0x1B };
+
+static uint8_t  service_records[TEST_NUM_RECORDS][200];
+static uint8_t  transcript[TEST_TRANSCRIPT];
+static uint16_t transcript_len;
+static uint8_t  response[1000];
+static uint16_t response_len;
+static uint16_t remote_mtu;
+static btstack_packet_handler_t sdp_server_packet_handler;
+static sdp_server_uuid_index_entry_t uuid_index[100];
+
+// mock l2cap
+uint8_t l2cap_register_service(btstack_packet_handler_t packet_handler, uint16_t psm, uint16_t mtu, gap_security_level_t security_level){
+    UNUSED(psm);
+    UNUSED(mtu);
+    UNUSED(security_level);
+    sdp_server_packet_handler = packet_handler;
+    return ERROR_CODE_SUCCESS;
+}
+void l2cap_accept_connection(uint16_t local_cid){
+    UNUSED(local_cid);
+}
+void l2cap_decline_connection(uint16_t local_cid){
+    UNUSED(local_cid);
+}
+uint8_t l2cap_request_can_send_now_event(uint16_t local_cid){
+    UNUSED(local_cid);
+    return ERROR_CODE_SUCCESS;
+}
+uint16_t l2cap_get_remote_mtu_for_local_cid(uint16_t local_cid){
+    UNUSED(local_cid);
+    return remote_mtu;
+}
+uint8_t l2cap_send(uint16_t local_cid, const uint8_t *data, uint16_t len){
+    UNUSED(local_cid);
+    memcpy(response, data, len);
+    response_len = len;
+    return ERROR_CODE_SUCCESS;
+}
+
+static void create_record(uint8_t * record, uint32_t handle, uint16_t service_class, bool rfcomm, bool custom){
+    de_create_sequence(record);
+    de_add_number(record, DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_SERVICE_RECORD_HANDLE);
+    de_add_number(record, DE_UINT, DE_SIZE_32, handle);
+
+    de_add_number(record, DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_SERVICE_CLASS_ID_LIST);
+    uint8_t * attribute = de_push_sequence(record);
+    {
+        de_add_number(attribute, DE_UUID, DE_SIZE_16, service_class);
+        if (custom){
+            de_add_uuid128(attribute, (uint8_t *) custom_uuid128);
+        }
+    }
+    de_pop_sequence(record, attribute);
+
+    de_add_number(record, DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_PROTOCOL_DESCRIPTOR_LIST);
+    attribute = de_push_sequence(record);
+    {
+        uint8_t * l2cap = de_push_sequence(attribute);
+        de_add_number(l2cap, DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_L2CAP);
+        de_add_number(l2cap, DE_UINT, DE_SIZE_16, rfcomm ? BLUETOOTH_PROTOCOL_RFCOMM : 0x1001);
+        de_pop_sequence(attribute, l2cap);
+        if (rfcomm){
+            // UUID32 encoding of RFCOMM
+            uint8_t * rfcomm_protocol = de_push_sequence(attribute);
+            de_add_number(rfcomm_protocol, DE_UUID, DE_SIZE_32, BLUETOOTH_PROTOCOL_RFCOMM);
+            de_add_number(rfcomm_protocol, DE_UINT, DE_SIZE_8, (uint8_t) handle);
+            de_pop_sequence(attribute, rfcomm_protocol);
+        }
+    }
+    de_pop_sequence(record, attribute);
+
+    de_add_number(record, DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_BROWSE_GROUP_LIST);
+    attribute = de_push_sequence(record);
+    de_add_number(attribute, DE_UUID, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_PUBLIC_BROWSE_ROOT);
+    de_pop_sequence(record, attribute);
+
+    de_add_number(record, DE_UINT, DE_SIZE_16, 0x0100);
+    de_add_data(record, DE_STRING, 20, (uint8_t *) "Service Name 0123456");
+}
+
+static void send_request(const uint8_t * request, uint16_t len){
+    uint8_t packet[100];
+    memcpy(packet, request, len);
+    response_len = 0;
+    sdp_server_packet_handler(L2CAP_DATA_PACKET, TEST_CID, packet, len);
+    uint8_t event[2] = { L2CAP_EVENT_CAN_SEND_NOW, 0 };
+    sdp_server_packet_handler(HCI_EVENT_PACKET, TEST_CID, event, sizeof(event));
+    CHECK(response_len > 0);
+    CHECK((transcript_len + response_len) <= TEST_TRANSCRIPT);
+    memcpy(&transcript[transcript_len], response, response_len);
+    transcript_len += response_len;
+}
+
+// send request with given parameters and follow continuation state
+static void run_request(uint8_t pdu_id, const uint8_t * params, uint16_t params_len){
+    uint8_t  continuation[17];
+    uint16_t continuation_len = 1;
+    continuation[0] = 0;
+    uint16_t count = 0;
+    do {
+        uint8_t request[100];
+        request[0] = pdu_id;
+        big_endian_store_16(request, 1, count);
+        big_endian_store_16(request, 3, params_len + continuation_len);
+        memcpy(&request[5], params, params_len);
+        memcpy(&request[5 + params_len], continuation, continuation_len);
+        send_request(request, 5 + params_len + continuation_len);
+        uint16_t pos;
+        if (response[0] == SDP_ServiceSearchResponse){
+            pos = 9 + (4 * big_endian_read_16(response, 7));
+        } else {
+            pos = 7 + big_endian_read_16(response, 5);
+        }
+        continuation_len = 1 + response[pos];
+        CHECK_EQUAL(response_len, pos + continuation_len);
+        memcpy(continuation, &response[pos], continuation_len);
+        count++;
+    } while ((continuation[0] != 0) && (count < 100));
+    CHECK(count < 100);
+}
+
+static void run_requests(void){
+    uint8_t pattern[80];
+    uint8_t params[100];
+    uint16_t i;
+    transcript_len = 0;
+    for (i = 0; i < 10; i++){
+        de_create_sequence(pattern);
+        switch (i){
+            case 0:
+                de_add_number(pattern, DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_L2CAP);
+                break;
+            case 1:
+                de_add_number(pattern, DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_RFCOMM);
+                de_add_number(pattern, DE_UUID, DE_SIZE_32, BLUETOOTH_SERVICE_CLASS_SERIAL_PORT);
+                break;
+            case 2:
+                de_add_uuid128(pattern, (uint8_t *) custom_uuid128);
+                break;
+            case 3:
+                de_add_number(pattern, DE_UUID, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_PUBLIC_BROWSE_ROOT);
+                de_add_number(pattern, DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_L2CAP);
+                break;
+            case 4:
+                de_add_number(pattern, DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_L2CAP);
+                de_add_number(pattern, DE_UUID, DE_SIZE_16, 0x4242);
+                break;
+            case 5:
+                // empty pattern matches all records
+                break;
+            case 6:
+                // invalid element
+                de_add_number(pattern, DE_UINT, DE_SIZE_16, BLUETOOTH_PROTOCOL_L2CAP);
+                break;
+            case 7:
+            {
+                // more UUIDs than bits in search mask
+                uint16_t j;
+                for (j = 0; j < 17; j++){
+                    de_add_number(pattern, DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_L2CAP);
+                }
+                break;
+            }
+            case 8:
+                de_add_number(pattern, DE_UUID, DE_SIZE_16, BLUETOOTH_SERVICE_CLASS_AUDIO_SOURCE);
+                break;
+            default:
+                de_add_number(pattern, DE_UUID, DE_SIZE_16, BLUETOOTH_SERVICE_CLASS_SERIAL_PORT);
+                de_add_uuid128(pattern, (uint8_t *) custom_uuid128);
+                break;
+        }
+        uint16_t pattern_len = de_get_len(pattern);
+
+        // ServiceSearch
+        memcpy(params, pattern, pattern_len);
+        big_endian_store_16(params, pattern_len, 0xffff);
+        run_request(SDP_ServiceSearchRequest, params, pattern_len + 2);
+
+        // ServiceSearchAttribute, all attributes
+        memcpy(params, pattern, pattern_len);
+        big_endian_store_16(params, pattern_len, 0xffff);
+        uint8_t * attribute_id_list = &params[pattern_len + 2];
+        de_create_sequence(attribute_id_list);
+        de_add_number(attribute_id_list, DE_UINT, DE_SIZE_32, 0x0000ffff);
+        run_request(SDP_ServiceSearchAttributeRequest, params, pattern_len + 2 + de_get_len(attribute_id_list));
+
+        // ServiceSearchAttribute, single attribute
+        de_create_sequence(attribute_id_list);
+        de_add_number(attribute_id_list, DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_PROTOCOL_DESCRIPTOR_LIST);
+        run_request(SDP_ServiceSearchAttributeRequest, params, pattern_len + 2 + de_get_len(attribute_id_list));
+    }
+}
+
+TEST_GROUP(SDPServer){
+    uint8_t transcript_without_index[TEST_TRANSCRIPT];
+    uint16_t transcript_without_index_len;
+
+    void setup(void){
+        sdp_init();
+        uint16_t i;
+        for (i = 0; i < TEST_NUM_RECORDS; i++){
+            uint16_t service_class = ((i % 3) == 0) ? BLUETOOTH_SERVICE_CLASS_SERIAL_PORT : (BLUETOOTH_SERVICE_CLASS_AUDIO_SOURCE + (i % 3));
+            create_record(service_records[i], 0x10001 + i, service_class, (i % 2) == 0, (i % 4) == 1);
+            CHECK_EQUAL(0, sdp_register_service(service_records[i]));
+        }
+        uint8_t event[2] = { L2CAP_EVENT_INCOMING_CONNECTION, 0 };
+        sdp_server_packet_handler(HCI_EVENT_PACKET, TEST_CID, event, sizeof(event));
+        remote_mtu = 48;
+    }
+    void teardown(void){
+        uint16_t i;
+        for (i = 0; i < TEST_NUM_RECORDS; i++){
+            sdp_unregister_service(0x10001 + i);
+        }
+        sdp_deinit();
+    }
+    void run_requests_without_index(void){
+        run_requests();
+        memcpy(transcript_without_index, transcript, transcript_len);
+        transcript_without_index_len = transcript_len;
+    }
+    void check_same_transcript(void){
+        CHECK_EQUAL(transcript_without_index_len, transcript_len);
+        MEMCMP_EQUAL(transcript_without_index, transcript, transcript_len);
+    }
+};
+
+TEST(SDPServer, ServiceSearch){
+    uint8_t request[] = { SDP_ServiceSearchRequest, 0x00, 0x01, 0x00, 0x08, 0x35, 0x03, 0x19, 0x01, 0x00, 0xff, 0xff, 0x00 };
+    sdp_server_enable_uuid_index(uuid_index, sizeof(uuid_index) / sizeof(sdp_server_uuid_index_entry_t));
+    remote_mtu = 200;
+    transcript_len = 0;
+    send_request(request, sizeof(request));
+    // all records contain L2CAP
+    CHECK_EQUAL(TEST_NUM_RECORDS, big_endian_read_16(response, 5));
+    CHECK_EQUAL(TEST_NUM_RECORDS, big_endian_read_16(response, 7));
+}
+
+TEST(SDPServer, UUIDIndex){
+    run_requests_without_index();
+    sdp_server_enable_uuid_index(uuid_index, sizeof(uuid_index) / sizeof(sdp_server_uuid_index_entry_t));
+    run_requests();
+    check_same_transcript();
+}
+
+TEST(SDPServer, UUIDIndexUnregister){
+    sdp_unregister_service(0x10002);
+    sdp_unregister_service(0x10005);
+    run_requests_without_index();
+    sdp_deinit();
+    sdp_init();
+    sdp_server_enable_uuid_index(uuid_index, sizeof(uuid_index) / sizeof(sdp_server_uuid_index_entry_t));
+    uint16_t i;
+    for (i = 0; i < TEST_NUM_RECORDS; i++){
+        CHECK_EQUAL(0, sdp_register_service(service_records[i]));
+    }
+    uint8_t event[2] = { L2CAP_EVENT_INCOMING_CONNECTION, 0 };
+    sdp_server_packet_handler(HCI_EVENT_PACKET, TEST_CID, event, sizeof(event));
+    sdp_unregister_service(0x10002);
+    sdp_unregister_service(0x10005);
+    run_requests();
+    check_same_transcript();
+}
+
+TEST(SDPServer, UUIDIndexFull){
+    run_requests_without_index();
+    sdp_server_enable_uuid_index(uuid_index, 10);
+    run_requests();
+    check_same_transcript();
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
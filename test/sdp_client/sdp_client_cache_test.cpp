@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// test SDP Client result cache
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "bluetooth_sdp.h"
+#include "btstack_event.h"
+#include "btstack_run_loop.h"
+#include "btstack_tlv.h"
+#include "btstack_util.h"
+#include "classic/sdp_client.h"
+#include "classic/sdp_util.h"
+#include "l2cap.h"
+#include "mock_btstack_tlv.h"
+
+#define TEST_CID 0x41
+
+// AttributeLists with a single record: ServiceClassIDList = { Serial Port }
+static const uint8_t attribute_lists_serial_port[] = { 0x35, 0x08, 0x35, 0x06, 0x09, 0x00, 0x01, 0x35, 0x03, 0x19, 0x11, 0x01 };
+// AttributeLists with a single record: ServiceClassIDList = { Dialup Networking }
+static const uint8_t attribute_lists_dialup[]      = { 0x35, 0x08, 0x35, 0x06, 0x09, 0x00, 0x01, 0x35, 0x03, 0x19, 0x11, 0x03 };
+
+static bd_addr_t remote_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+static bd_addr_t other_addr  = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x77 };
+
+static mock_btstack_tlv_t tlv_context;
+
+// mock l2cap
+static btstack_packet_handler_t l2cap_packet_handler;
+static uint8_t  l2cap_outgoing_buffer[1000];
+static uint16_t l2cap_transaction_id;
+static int      l2cap_channels_created;
+static bool     l2cap_request_sent;
+
+uint8_t l2cap_create_channel(btstack_packet_handler_t handler, bd_addr_t address, uint16_t psm, uint16_t mtu, uint16_t * out_local_cid){
+    (void) address;
+    UNUSED(psm);
+    UNUSED(mtu);
+    UNUSED(out_local_cid);
+    l2cap_packet_handler = handler;
+    l2cap_channels_created++;
+    return ERROR_CODE_SUCCESS;
+}
+uint8_t l2cap_request_can_send_now_event(uint16_t cid){
+    uint8_t event[] = { L2CAP_EVENT_CAN_SEND_NOW, 2, 0, 0};
+    little_endian_store_16(event, 2, cid);
+    l2cap_packet_handler(HCI_EVENT_PACKET, cid, event, sizeof(event));
+    return ERROR_CODE_SUCCESS;
+}
+uint8_t l2cap_disconnect(uint16_t local_cid){
+    UNUSED(local_cid);
+    return ERROR_CODE_SUCCESS;
+}
+uint8_t *l2cap_get_outgoing_buffer(void){
+    return l2cap_outgoing_buffer;
+}
+uint16_t l2cap_max_mtu(void){
+    return sizeof(l2cap_outgoing_buffer);
+}
+bool l2cap_reserve_packet_buffer(void){
+    return true;
+}
+uint8_t l2cap_send_prepared(uint16_t local_cid, uint16_t len){
+    UNUSED(local_cid);
+    UNUSED(len);
+    l2cap_transaction_id = big_endian_read_16(l2cap_outgoing_buffer, 1);
+    l2cap_request_sent = true;
+    return 0;
+}
+
+// mock run loop
+static uint32_t run_loop_time_ms;
+static btstack_timer_source_t * run_loop_timer;
+
+void btstack_run_loop_set_timer_handler(btstack_timer_source_t * timer, void (*process)(btstack_timer_source_t * _timer)){
+    timer->process = process;
+}
+void btstack_run_loop_set_timer(btstack_timer_source_t * timer, uint32_t timeout_in_ms){
+    UNUSED(timeout_in_ms);
+    timer->timeout = run_loop_time_ms;
+}
+void btstack_run_loop_add_timer(btstack_timer_source_t * timer){
+    run_loop_timer = timer;
+}
+int btstack_run_loop_remove_timer(btstack_timer_source_t * timer){
+    if (run_loop_timer != timer) return 0;
+    run_loop_timer = NULL;
+    return 1;
+}
+uint32_t btstack_run_loop_get_time_ms(void){
+    return run_loop_time_ms;
+}
+
+static void run_loop_process_timer(void){
+    btstack_timer_source_t * timer = run_loop_timer;
+    if (timer == NULL) return;
+    run_loop_timer = NULL;
+    (*timer->process)(timer);
+}
+
+// query result
+static uint8_t  query_values[100];
+static uint16_t query_values_len;
+static bool     query_complete;
+static uint8_t  query_status;
+
+static void handle_query_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(packet_type);
+    UNUSED(channel);
+    UNUSED(size);
+    switch (hci_event_packet_get_type(packet)){
+        case SDP_EVENT_QUERY_ATTRIBUTE_VALUE:
+            CHECK(query_values_len < sizeof(query_values));
+            query_values[query_values_len++] = sdp_event_query_attribute_byte_get_data(packet);
+            break;
+        case SDP_EVENT_QUERY_COMPLETE:
+            query_complete = true;
+            query_status = sdp_event_query_complete_get_status(packet);
+            break;
+        default:
+            break;
+    }
+}
+
+static void start_query_uuid16(const uint8_t * addr, uint16_t uuid16){
+    query_values_len = 0;
+    query_complete = false;
+    query_status = 0xff;
+    uint8_t status = sdp_client_query_uuid16(&handle_query_event, (uint8_t *) addr, uuid16);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+}
+
+static void start_query(const uint8_t * addr){
+    start_query_uuid16(addr, BLUETOOTH_SERVICE_CLASS_SERIAL_PORT);
+}
+
+static void remote_open_channel(uint8_t status){
+    uint8_t event[21];
+    memset(event, 0, sizeof(event));
+    event[0] = L2CAP_EVENT_CHANNEL_OPENED;
+    event[1] = sizeof(event) - 2;
+    event[2] = status;
+    little_endian_store_16(event, 13, TEST_CID);
+    little_endian_store_16(event, 17, 200);
+    l2cap_request_sent = false;
+    (*l2cap_packet_handler)(HCI_EVENT_PACKET, TEST_CID, event, sizeof(event));
+}
+
+static void remote_close_channel(void){
+    uint8_t event[4];
+    event[0] = L2CAP_EVENT_CHANNEL_CLOSED;
+    event[1] = 2;
+    little_endian_store_16(event, 2, TEST_CID);
+    (*l2cap_packet_handler)(HCI_EVENT_PACKET, TEST_CID, event, sizeof(event));
+}
+
+// ServiceSearchAttributeResponse for pending request, followed by channel close
+static void remote_respond(const uint8_t * attribute_lists, uint16_t attribute_lists_len){
+    remote_open_channel(ERROR_CODE_SUCCESS);
+    CHECK(l2cap_request_sent);
+    uint8_t pdu[100];
+    uint16_t pos = 0;
+    pdu[pos++] = SDP_ServiceSearchAttributeResponse;
+    big_endian_store_16(pdu, pos, l2cap_transaction_id);
+    pos += 2;
+    big_endian_store_16(pdu, pos, 2 + attribute_lists_len + 1);
+    pos += 2;
+    big_endian_store_16(pdu, pos, attribute_lists_len);
+    pos += 2;
+    memcpy(&pdu[pos], attribute_lists, attribute_lists_len);
+    pos += attribute_lists_len;
+    pdu[pos++] = 0;
+    (*l2cap_packet_handler)(L2CAP_DATA_PACKET, TEST_CID, pdu, pos);
+    remote_close_channel();
+}
+
+// expected attribute value bytes for AttributeLists with single record and single attribute
+static void check_query_values(const uint8_t * attribute_lists){
+    CHECK(query_complete);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, query_status);
+    CHECK_EQUAL(5u, query_values_len);
+    MEMCMP_EQUAL(&attribute_lists[7], query_values, 5);
+}
+
+TEST_GROUP(SDPClientCache){
+    sdp_client_cache_statistics_t statistics;
+
+    void setup(void){
+        const btstack_tlv_t * tlv_impl = mock_btstack_tlv_init_instance(&tlv_context);
+        btstack_tlv_set_instance(tlv_impl, &tlv_context);
+        sdp_client_init();
+        l2cap_channels_created = 0;
+        run_loop_time_ms = 1000;
+        run_loop_timer = NULL;
+    }
+    void teardown(void){
+        sdp_client_deinit();
+        mock_btstack_tlv_deinit(&tlv_context);
+        btstack_tlv_set_instance(NULL, NULL);
+    }
+};
+
+TEST(SDPClientCache, QueryAnsweredFromCache){
+    start_query(remote_addr);
+    CHECK_EQUAL(1, l2cap_channels_created);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+    check_query_values(attribute_lists_serial_port);
+
+    start_query(remote_addr);
+    CHECK_FALSE(sdp_client_ready());
+    CHECK_FALSE(query_complete);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_serial_port);
+    CHECK_EQUAL(1, l2cap_channels_created);
+    CHECK(sdp_client_ready());
+
+    sdp_client_cache_get_statistics(&statistics);
+    CHECK_EQUAL(1u, statistics.hits);
+    CHECK_EQUAL(1u, statistics.misses);
+    CHECK_EQUAL(0u, statistics.verifications);
+}
+
+TEST(SDPClientCache, CacheIsPerDevice){
+    start_query(remote_addr);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+
+    start_query(other_addr);
+    CHECK_EQUAL(2, l2cap_channels_created);
+    remote_respond(attribute_lists_dialup, sizeof(attribute_lists_dialup));
+    check_query_values(attribute_lists_dialup);
+
+    start_query(remote_addr);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_serial_port);
+    CHECK_EQUAL(2, l2cap_channels_created);
+}
+
+TEST(SDPClientCache, ExpiredEntryIsVerified){
+    start_query(remote_addr);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+
+    // expired entry is delivered, then verified in background
+    run_loop_time_ms += SDP_CLIENT_CACHE_TIMEOUT_MS;
+    start_query(remote_addr);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_serial_port);
+    CHECK_EQUAL(2, l2cap_channels_created);
+    CHECK_FALSE(sdp_client_ready());
+    remote_respond(attribute_lists_dialup, sizeof(attribute_lists_dialup));
+    CHECK(sdp_client_ready());
+
+    // updated result delivered from cache
+    start_query(remote_addr);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_dialup);
+    CHECK_EQUAL(2, l2cap_channels_created);
+
+    sdp_client_cache_get_statistics(&statistics);
+    CHECK_EQUAL(2u, statistics.hits);
+    CHECK_EQUAL(1u, statistics.misses);
+    CHECK_EQUAL(1u, statistics.verifications);
+    CHECK_EQUAL(1u, statistics.changes);
+}
+
+TEST(SDPClientCache, EntryFromPreviousPowerCycleIsVerified){
+    start_query(remote_addr);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+
+    // TLV content is kept
+    sdp_client_deinit();
+    sdp_client_init();
+
+    start_query(remote_addr);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_serial_port);
+    CHECK_EQUAL(2, l2cap_channels_created);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+
+    sdp_client_cache_get_statistics(&statistics);
+    CHECK_EQUAL(1u, statistics.hits);
+    CHECK_EQUAL(1u, statistics.verifications);
+    CHECK_EQUAL(0u, statistics.changes);
+}
+
+static void start_query_dialup(void * context){
+    UNUSED(context);
+    start_query_uuid16(remote_addr, BLUETOOTH_SERVICE_CLASS_DIALUP_NETWORKING);
+}
+
+TEST(SDPClientCache, QueuedQueryServedBeforeVerification){
+    start_query_uuid16(remote_addr, BLUETOOTH_SERVICE_CLASS_SERIAL_PORT);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+    start_query_uuid16(remote_addr, BLUETOOTH_SERVICE_CLASS_DIALUP_NETWORKING);
+    remote_respond(attribute_lists_dialup, sizeof(attribute_lists_dialup));
+
+    // TLV content is kept, both entries need verification
+    sdp_client_deinit();
+    sdp_client_init();
+
+    start_query_uuid16(remote_addr, BLUETOOTH_SERVICE_CLASS_SERIAL_PORT);
+    btstack_context_callback_registration_t callback_registration;
+    callback_registration.callback = &start_query_dialup;
+    callback_registration.context = NULL;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, sdp_client_register_query_callback(&callback_registration));
+    run_loop_process_timer();
+
+    // queued query answered from cache before any verification
+    CHECK_EQUAL(2, l2cap_channels_created);
+    CHECK_FALSE(query_complete);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_dialup);
+
+    // then both entries are verified
+    CHECK_EQUAL(3, l2cap_channels_created);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+    CHECK_EQUAL(4, l2cap_channels_created);
+    remote_respond(attribute_lists_dialup, sizeof(attribute_lists_dialup));
+    CHECK(sdp_client_ready());
+
+    sdp_client_cache_get_statistics(&statistics);
+    CHECK_EQUAL(2u, statistics.hits);
+    CHECK_EQUAL(2u, statistics.verifications);
+    CHECK_EQUAL(0u, statistics.changes);
+}
+
+TEST(SDPClientCache, FailedVerificationRemovesEntry){
+    start_query(remote_addr);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+
+    run_loop_time_ms += SDP_CLIENT_CACHE_TIMEOUT_MS;
+    start_query(remote_addr);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_serial_port);
+    remote_open_channel(ERROR_CODE_PAGE_TIMEOUT);
+    CHECK(sdp_client_ready());
+
+    start_query(remote_addr);
+    CHECK_EQUAL(3, l2cap_channels_created);
+    CHECK(run_loop_timer == NULL);
+
+    sdp_client_cache_get_statistics(&statistics);
+    CHECK_EQUAL(1u, statistics.invalidations);
+    CHECK_EQUAL(2u, statistics.misses);
+}
+
+TEST(SDPClientCache, FailedQueryIsNotCached){
+    start_query(remote_addr);
+    remote_open_channel(ERROR_CODE_PAGE_TIMEOUT);
+    CHECK(query_complete);
+    CHECK_EQUAL(ERROR_CODE_PAGE_TIMEOUT, query_status);
+
+    start_query(remote_addr);
+    CHECK_EQUAL(2, l2cap_channels_created);
+}
+
+TEST(SDPClientCache, CacheIsPerRequest){
+    start_query_uuid16(remote_addr, BLUETOOTH_SERVICE_CLASS_SERIAL_PORT);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+    start_query_uuid16(remote_addr, BLUETOOTH_SERVICE_CLASS_DIALUP_NETWORKING);
+    CHECK_EQUAL(2, l2cap_channels_created);
+    remote_respond(attribute_lists_dialup, sizeof(attribute_lists_dialup));
+
+    start_query_uuid16(remote_addr, BLUETOOTH_SERVICE_CLASS_SERIAL_PORT);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_serial_port);
+    start_query_uuid16(remote_addr, BLUETOOTH_SERVICE_CLASS_DIALUP_NETWORKING);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_dialup);
+    CHECK_EQUAL(2, l2cap_channels_created);
+}
+
+TEST(SDPClientCache, Remove){
+    start_query(remote_addr);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+    start_query(other_addr);
+    remote_respond(attribute_lists_dialup, sizeof(attribute_lists_dialup));
+
+    sdp_client_cache_remove(remote_addr);
+
+    start_query(remote_addr);
+    CHECK_EQUAL(3, l2cap_channels_created);
+    remote_respond(attribute_lists_serial_port, sizeof(attribute_lists_serial_port));
+
+    start_query(other_addr);
+    run_loop_process_timer();
+    check_query_values(attribute_lists_dialup);
+    CHECK_EQUAL(3, l2cap_channels_created);
+
+    sdp_client_cache_flush();
+    start_query(other_addr);
+    CHECK_EQUAL(4, l2cap_channels_created);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
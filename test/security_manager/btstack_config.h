@@ -21,6 +21,7 @@
 #define ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
 #define ENABLE_LE_CENTRAL
 #define ENABLE_LE_PERIPHERAL
+#define ENABLE_LE_ADDRESS_RESOLUTION_CACHE
 #define ENABLE_LE_SECURE_CONNECTIONS
 #define ENABLE_LE_SIGNED_WRITE
 #define ENABLE_SDP_EXTRA_QUERIES
@@ -31,6 +32,7 @@
 #define HCI_INCOMING_PRE_BUFFER_SIZE 4
 
 #define MAX_NR_LE_DEVICE_DB_ENTRIES 4
+#define MAX_NR_SM_SETUP_CONTEXTS 4
 
 #define NVM_NUM_LINK_KEYS 2
 
@@ -18,13 +18,33 @@ static uint16_t packet_buffer_len = 0;
 
 static uint8_t aes128_cyphertext[16];
 
+#define MOCK_MAX_NR_CONNECTIONS 8
+
 static hci_connection_t  the_connection;
+static hci_connection_t  mock_connections[MOCK_MAX_NR_CONNECTIONS];
+static int               mock_num_connections;
 static btstack_linked_list_t     connections;
 static btstack_linked_list_t     event_packet_handlers;
 
+// if set, outgoing packets are reported instead of stored in packet buffer
+static void (*mock_packet_handler)(uint8_t packet_type, hci_con_handle_t con_handle, uint8_t * packet, uint16_t size);
+
 void mock_init(void){
 	the_connection.item.next = NULL;
 	connections = (btstack_linked_item_t*) &the_connection;
+	mock_num_connections = 0;
+	mock_packet_handler = NULL;
+}
+
+void mock_add_connection(hci_con_handle_t con_handle){
+	hci_connection_t * connection = &mock_connections[mock_num_connections++];
+	memset(connection, 0, sizeof(hci_connection_t));
+	connection->con_handle = con_handle;
+	btstack_linked_list_add_tail(&connections, (btstack_linked_item_t *) connection);
+}
+
+void mock_set_packet_handler(void (*packet_handler)(uint8_t packet_type, hci_con_handle_t con_handle, uint8_t * packet, uint16_t size)){
+	mock_packet_handler = packet_handler;
 }
 
 uint8_t * mock_packet_buffer(void){
@@ -78,9 +98,8 @@ void aes128_report_result(void){
 	mock_simulate_hci_event(&le_enc_result[0], sizeof(le_enc_result));
 }
 
-void mock_simulate_sm_data_packet(uint8_t * packet, uint16_t len){
+void mock_simulate_sm_data_packet_for_handle(hci_con_handle_t handle, uint8_t * packet, uint16_t len){
 
-	uint16_t handle = 0x40;
 	uint16_t cid = 0x06;
 
 	uint8_t acl_buffer[len + 8];
@@ -103,6 +122,10 @@ void mock_simulate_sm_data_packet(uint8_t * packet, uint16_t len){
 	btstack_run_loop_embedded_execute_once();
 }
 
+void mock_simulate_sm_data_packet(uint8_t * packet, uint16_t len){
+	mock_simulate_sm_data_packet_for_handle(0x40, packet, len);
+}
+
 void mock_simulate_command_complete(const hci_cmd_t *cmd){
 	uint8_t packet[] = {HCI_EVENT_COMMAND_COMPLETE, 4, 1, (uint8_t) cmd->opcode & 0xff, (uint8_t) cmd->opcode >> 8, 0};
 	mock_simulate_hci_event((uint8_t *)&packet, sizeof(packet));
@@ -146,6 +169,10 @@ hci_connection_t * hci_connection_for_bd_addr_and_type(const bd_addr_t addr, bd_
 	return &the_connection;
 }
 hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
+	int i;
+	for (i=0;i<mock_num_connections;i++){
+		if (mock_connections[i].con_handle == con_handle) return &mock_connections[i];
+	}
 	return &the_connection;
 }
 void hci_connections_get_iterator(btstack_linked_list_iterator_t *it){
@@ -201,6 +228,10 @@ uint8_t hci_send_cmd(const hci_cmd_t *cmd, ...){
     va_end(argptr);
 	hci_dump_packet(HCI_COMMAND_DATA_PACKET, 0, packet_buffer, len);
 	dump_packet(HCI_COMMAND_DATA_PACKET, packet_buffer, len);
+	if (mock_packet_handler != NULL){
+		(*mock_packet_handler)(HCI_COMMAND_DATA_PACKET, HCI_CON_HANDLE_INVALID, packet_buffer, len);
+		return ERROR_CODE_SUCCESS;
+	}
 	packet_buffer_len = len;
 
 	// track le encrypt and le rand
@@ -258,6 +289,10 @@ uint8_t l2cap_send_connectionless(uint16_t handle, uint16_t cid, uint8_t * buffe
 	hci_dump_packet(HCI_ACL_DATA_PACKET, 0, &packet_buffer[0], len + 8);
 
 	dump_packet(HCI_ACL_DATA_PACKET, packet_buffer, len + 8);
+	if (mock_packet_handler != NULL){
+		(*mock_packet_handler)(SM_DATA_PACKET, handle, buffer, len);
+		return ERROR_CODE_SUCCESS;
+	}
 	packet_buffer_len = len + 8;
 
 	return ERROR_CODE_SUCCESS;
@@ -24,7 +24,10 @@
 #include "hci_dump.h"
 #include "hci_dump_posix_fs.h"
 #include "l2cap.h"
+#include "ble/le_device_db.h"
 #include "ble/sm.h"
+#include "btstack_crypto.h"
+#include "btstack_event.h"
 
 uint8_t test_command_packet_sc_read_public_key[] = { 0x25, 0x20, 0x00 };
 
@@ -109,6 +112,11 @@ bd_addr_t test_device_addr = {0x34, 0xb1, 0xf7, 0xd1, 0x77, 0x9b};
 
 static btstack_packet_callback_registration_t sm_event_callback_registration;
 
+static int identity_resolving_succeeded_index;
+static int identity_resolving_failed;
+
+static void multi_link_pairing_complete(hci_con_handle_t con_handle, uint8_t status);
+
 extern "C" {
     void mock_init(void);
     void mock_simulate_hci_state_working(void);
@@ -120,6 +128,9 @@ extern "C" {
     uint8_t * mock_packet_buffer(void);
     uint16_t mock_packet_buffer_len(void);
     void mock_clear_packet_buffer(void);
+    void mock_add_connection(hci_con_handle_t con_handle);
+    void mock_set_packet_handler(void (*packet_handler)(uint8_t packet_type, hci_con_handle_t con_handle, uint8_t * packet, uint16_t size));
+    void mock_simulate_sm_data_packet_for_handle(hci_con_handle_t handle, uint8_t * packet, uint16_t len);
 }
 
 void app_packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
@@ -153,6 +164,18 @@ void app_packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *packet,
                     sm_authorization_grant(little_endian_read_16(packet, 2));
                     break;
 
+                case SM_EVENT_IDENTITY_RESOLVING_SUCCEEDED:
+                    identity_resolving_succeeded_index = sm_event_identity_resolving_succeeded_get_index(packet);
+                    break;
+
+                case SM_EVENT_IDENTITY_RESOLVING_FAILED:
+                    identity_resolving_failed++;
+                    break;
+
+                case SM_EVENT_PAIRING_COMPLETE:
+                    multi_link_pairing_complete(sm_event_pairing_complete_get_handle(packet), sm_event_pairing_complete_get_status(packet));
+                    break;
+
                 default:
                     break;
             }
@@ -412,6 +435,343 @@ TEST(SecurityManager, MainTest){
     CHECK_ACL_PACKET(test_acl_packet_22);
 }
 
+// answer LE Rand commands and process sm_run_trigger()
+static void process_sm(void){
+    int i;
+    for (i=0;i<20;i++){
+        if (little_endian_read_16(mock_packet_buffer(), 0) == hci_le_rand.opcode){
+            mock_clear_packet_buffer();
+            uint8_t rand_data_event[] = { 0x0e, 0x0c, 0x01, 0x18, 0x20, 0x00, 0x2f, 0x04, 0x82, 0x84, 0x72, 0x46, 0x9c, 0x93 };
+            mock_simulate_hci_event(&rand_data_event[0], sizeof(rand_data_event));
+        }
+        btstack_run_loop_embedded_execute_once();
+    }
+}
+
+// resolvable private address = prand || ah(irk, prand)
+static void create_resolvable_private_address(const sm_key_t irk, bd_addr_t address){
+    uint8_t r_prime[16];
+    uint8_t hash[16];
+    memset(r_prime, 0, 16);
+    address[0] = 0x4a;
+    address[1] = 0x12;
+    address[2] = 0x34;
+    memcpy(&r_prime[13], address, 3);
+    btstack_aes128_calc(irk, r_prime, hash);
+    memcpy(&address[3], &hash[13], 3);
+}
+
+static void lookup(bd_addr_t address){
+    identity_resolving_succeeded_index = -1;
+    sm_address_resolution_lookup(BD_ADDR_TYPE_LE_RANDOM, address);
+    process_sm();
+}
+
+TEST(SecurityManager, AddressResolutionCache){
+    mock_init();
+    mock_simulate_hci_state_working();
+    process_sm();
+
+    sm_key_t irks[3];
+    int indices[3];
+    int i;
+    for (i=0;i<3;i++){
+        bd_addr_t identity_address = { 0xc0, 0x11, 0x22, 0x33, 0x44, (uint8_t) i};
+        memset(irks[i], 0x10 + i, 16);
+        indices[i] = le_device_db_add(BD_ADDR_TYPE_LE_RANDOM, identity_address, irks[i]);
+        CHECK(indices[i] >= 0);
+    }
+
+    sm_address_resolution_reset_statistics();
+    sm_address_resolution_statistics_t statistics;
+
+    bd_addr_t address;
+    create_resolvable_private_address(irks[2], address);
+
+    // full lookup
+    lookup(address);
+    CHECK_EQUAL(indices[2], identity_resolving_succeeded_index);
+    sm_address_resolution_get_statistics(&statistics);
+    CHECK_EQUAL(1, statistics.lookups);
+    CHECK_EQUAL(1, statistics.resolved);
+    CHECK_EQUAL(0, statistics.cache_hits);
+
+    // resolved from cache
+    lookup(address);
+    CHECK_EQUAL(indices[2], identity_resolving_succeeded_index);
+    sm_address_resolution_get_statistics(&statistics);
+    CHECK_EQUAL(2, statistics.resolved);
+    CHECK_EQUAL(1, statistics.cache_hits);
+
+    // unknown device
+    sm_key_t unknown_irk;
+    memset(unknown_irk, 0x55, 16);
+    bd_addr_t unknown_address;
+    create_resolvable_private_address(unknown_irk, unknown_address);
+    int failed = identity_resolving_failed;
+    lookup(unknown_address);
+    CHECK_EQUAL(failed + 1, identity_resolving_failed);
+
+    // cached device removed, cache entry is not used
+    le_device_db_remove(indices[2]);
+    lookup(address);
+    CHECK_EQUAL(-1, identity_resolving_succeeded_index);
+    CHECK_EQUAL(failed + 2, identity_resolving_failed);
+    sm_address_resolution_get_statistics(&statistics);
+    CHECK_EQUAL(4, statistics.lookups);
+    CHECK_EQUAL(1, statistics.cache_hits);
+    CHECK_EQUAL(2, statistics.failed);
+}
+
+// multiple centrals pair concurrently using Legacy Pairing Just Works
+
+#define MULTI_LINK_NUM_LINKS 6
+#define MULTI_LINK_QUEUE_SIZE 32
+
+typedef struct {
+    hci_con_handle_t con_handle;
+    bd_addr_t address;
+    uint8_t   preq[7];
+    uint8_t   pres[7];
+    sm_key_t  mrand;
+    sm_key_t  sconfirm;
+    sm_key_t  stk;
+    bool      active;
+    bool      complete;
+    uint8_t   status;
+} multi_link_t;
+
+typedef struct {
+    uint8_t          packet_type;
+    hci_con_handle_t con_handle;
+    uint8_t          packet[64];
+    uint16_t         size;
+} multi_link_packet_t;
+
+static multi_link_t        multi_link_links[MULTI_LINK_NUM_LINKS];
+static multi_link_packet_t multi_link_queue[MULTI_LINK_QUEUE_SIZE];
+static int multi_link_queue_head;
+static int multi_link_queue_tail;
+static int multi_link_num_active;
+static int multi_link_max_active;
+static int multi_link_num_complete;
+static uint8_t multi_link_random_counter;
+
+static multi_link_t * multi_link_for_handle(hci_con_handle_t con_handle){
+    int i;
+    for (i=0;i<MULTI_LINK_NUM_LINKS;i++){
+        if (multi_link_links[i].con_handle == con_handle) return &multi_link_links[i];
+    }
+    return NULL;
+}
+
+static void multi_link_pairing_complete(hci_con_handle_t con_handle, uint8_t status){
+    multi_link_t * link = multi_link_for_handle(con_handle);
+    if (link == NULL) return;
+    if (link->active){
+        link->active = false;
+        multi_link_num_active--;
+    }
+    link->complete = true;
+    link->status = status;
+    multi_link_num_complete++;
+}
+
+// outgoing packets are queued and processed by the test to avoid re-entering the security manager
+static void multi_link_packet_handler(uint8_t packet_type, hci_con_handle_t con_handle, uint8_t * packet, uint16_t size){
+    CHECK(size <= sizeof(multi_link_queue[0].packet));
+    multi_link_packet_t * item = &multi_link_queue[multi_link_queue_tail];
+    multi_link_queue_tail = (multi_link_queue_tail + 1) % MULTI_LINK_QUEUE_SIZE;
+    CHECK(multi_link_queue_tail != multi_link_queue_head);
+    item->packet_type = packet_type;
+    item->con_handle = con_handle;
+    item->size = size;
+    memcpy(item->packet, packet, size);
+}
+
+// c1 confirm value generation function with TK = 0
+static void multi_link_c1(multi_link_t * link, const sm_key_t r, sm_key_t confirm){
+    sm_key_t tk;
+    sm_key_t p1;
+    sm_key_t p2;
+    sm_key_t t;
+    uint8_t own_address_type;
+    bd_addr_t own_address;
+    int i;
+    gap_le_get_own_connection_address(&own_address_type, own_address);
+    memset(tk, 0, 16);
+    reverse_56(link->pres, &p1[0]);
+    reverse_56(link->preq, &p1[7]);
+    p1[14] = own_address_type;
+    p1[15] = BD_ADDR_TYPE_LE_PUBLIC;
+    for (i=0;i<16;i++){
+        t[i] = r[i] ^ p1[i];
+    }
+    btstack_aes128_calc(tk, t, t);
+    memset(p2, 0, 16);
+    memcpy(&p2[4], link->address, 6);
+    memcpy(&p2[10], own_address, 6);
+    for (i=0;i<16;i++){
+        t[i] ^= p2[i];
+    }
+    btstack_aes128_calc(tk, t, confirm);
+}
+
+static void multi_link_send_pdu(multi_link_t * link, uint8_t code, const sm_key_t value){
+    uint8_t pdu[17];
+    pdu[0] = code;
+    reverse_128(value, &pdu[1]);
+    mock_simulate_sm_data_packet_for_handle(link->con_handle, pdu, sizeof(pdu));
+}
+
+static void multi_link_handle_sm_pdu(multi_link_t * link, uint8_t * pdu, uint16_t size){
+    sm_key_t value;
+    sm_key_t srand;
+    sm_key_t tk;
+
+    // outgoing packet was sent by Controller
+    uint8_t number_of_completed_packets_event[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 5, 1, 0, 0, 1, 0};
+    little_endian_store_16(number_of_completed_packets_event, 3, link->con_handle);
+    mock_simulate_hci_event(number_of_completed_packets_event, sizeof(number_of_completed_packets_event));
+
+    switch (pdu[0]){
+        case SM_CODE_PAIRING_RESPONSE:
+            memcpy(link->pres, pdu, 7);
+            link->active = true;
+            multi_link_num_active++;
+            if (multi_link_num_active > multi_link_max_active){
+                multi_link_max_active = multi_link_num_active;
+            }
+            multi_link_c1(link, link->mrand, value);
+            multi_link_send_pdu(link, SM_CODE_PAIRING_CONFIRM, value);
+            break;
+        case SM_CODE_PAIRING_CONFIRM:
+            reverse_128(&pdu[1], link->sconfirm);
+            multi_link_send_pdu(link, SM_CODE_PAIRING_RANDOM, link->mrand);
+            break;
+        case SM_CODE_PAIRING_RANDOM:{
+            // verify responder confirm
+            reverse_128(&pdu[1], srand);
+            multi_link_c1(link, srand, value);
+            CHECK_EQUAL_ARRAY(link->sconfirm, value, 16);
+            // STK = s1(TK, Srand, Mrand)
+            memcpy(&value[0], &srand[8], 8);
+            memcpy(&value[8], &link->mrand[8], 8);
+            memset(tk, 0, 16);
+            btstack_aes128_calc(tk, value, link->stk);
+            // start encryption
+            uint8_t ltk_request_event[] = { HCI_EVENT_LE_META, 13, HCI_SUBEVENT_LE_LONG_TERM_KEY_REQUEST, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+            little_endian_store_16(ltk_request_event, 3, link->con_handle);
+            mock_simulate_hci_event(ltk_request_event, sizeof(ltk_request_event));
+            break;
+        }
+        case SM_CODE_PAIRING_FAILED:
+            multi_link_pairing_complete(link->con_handle, ERROR_CODE_AUTHENTICATION_FAILURE);
+            break;
+        default:
+            // distributed keys are not used
+            break;
+    }
+}
+
+static void multi_link_handle_hci_command(uint8_t * packet, uint16_t size){
+    uint16_t opcode = little_endian_read_16(packet, 0);
+    if (opcode == hci_le_rand.opcode){
+        uint8_t rand_event[] = { HCI_EVENT_COMMAND_COMPLETE, 0x0c, 0x01, 0x18, 0x20, 0x00, 0, 0, 0, 0, 0, 0, 0, 0};
+        int i;
+        for (i=0;i<8;i++){
+            rand_event[6+i] = multi_link_random_counter++;
+        }
+        mock_simulate_hci_event(rand_event, sizeof(rand_event));
+        return;
+    }
+    if (opcode == hci_le_long_term_key_request_reply.opcode){
+        multi_link_t * link = multi_link_for_handle(little_endian_read_16(packet, 3));
+        CHECK(link != NULL);
+        sm_key_t ltk;
+        reverse_128(&packet[5], ltk);
+        CHECK_EQUAL_ARRAY(link->stk, ltk, 16);
+        uint8_t encryption_change_event[] = { HCI_EVENT_ENCRYPTION_CHANGE, 4, 0, 0, 0, 1};
+        little_endian_store_16(encryption_change_event, 3, link->con_handle);
+        mock_simulate_hci_event(encryption_change_event, sizeof(encryption_change_event));
+    }
+}
+
+static void multi_link_process(int max_iterations){
+    int i;
+    for (i=0;i<max_iterations;i++){
+        if (multi_link_num_complete == MULTI_LINK_NUM_LINKS) return;
+        if (multi_link_queue_head == multi_link_queue_tail){
+            btstack_run_loop_embedded_execute_once();
+            continue;
+        }
+        multi_link_packet_t item = multi_link_queue[multi_link_queue_head];
+        multi_link_queue_head = (multi_link_queue_head + 1) % MULTI_LINK_QUEUE_SIZE;
+        if (item.packet_type == HCI_COMMAND_DATA_PACKET){
+            multi_link_handle_hci_command(item.packet, item.size);
+        } else {
+            multi_link_t * link = multi_link_for_handle(item.con_handle);
+            CHECK(link != NULL);
+            multi_link_handle_sm_pdu(link, item.packet, item.size);
+        }
+    }
+}
+
+TEST(SecurityManager, MultiLinkPairing){
+    mock_init();
+    mock_set_packet_handler(&multi_link_packet_handler);
+    le_device_db_init();
+    multi_link_queue_head = 0;
+    multi_link_queue_tail = 0;
+    multi_link_num_active = 0;
+    multi_link_max_active = 0;
+    multi_link_num_complete = 0;
+
+    mock_simulate_hci_state_working();
+    // ec key generation
+    multi_link_process(100);
+
+    // release setup context of connection used by other tests
+    uint8_t disconnection_complete_event[] = { HCI_EVENT_DISCONNECTION_COMPLETE, 4, 0, 0x40, 0x00, 0x13};
+    mock_simulate_hci_event(disconnection_complete_event, sizeof(disconnection_complete_event));
+
+    int i;
+
+    for (i=0;i<MULTI_LINK_NUM_LINKS;i++){
+        multi_link_t * link = &multi_link_links[i];
+        memset(link, 0, sizeof(multi_link_t));
+        link->con_handle = 0x41 + i;
+        bd_addr_t address = { 0x00, 0x1a, 0x7d, 0xda, 0x71, (uint8_t) i};
+        memcpy(link->address, address, 6);
+        memset(link->mrand, 0x20 + i, 16);
+        mock_add_connection(link->con_handle);
+
+        // LE Connection Complete as peripheral
+        uint8_t connection_complete_event[] = { HCI_EVENT_LE_META, 0x13, HCI_SUBEVENT_LE_CONNECTION_COMPLETE, 0x00, 0, 0, HCI_ROLE_SLAVE, BD_ADDR_TYPE_LE_PUBLIC,
+                                                0, 0, 0, 0, 0, 0, 0x18, 0x00, 0x00, 0x00, 0x48, 0x00, 0x05};
+        little_endian_store_16(connection_complete_event, 4, link->con_handle);
+        reverse_bd_addr(link->address, &connection_complete_event[8]);
+        mock_simulate_hci_event(connection_complete_event, sizeof(connection_complete_event));
+    }
+
+    // all centrals send pairing request: no input no output, bonding, responder distributes LTK
+    for (i=0;i<MULTI_LINK_NUM_LINKS;i++){
+        uint8_t pairing_request[] = { SM_CODE_PAIRING_REQUEST, IO_CAPABILITY_NO_INPUT_NO_OUTPUT, 0x00, SM_AUTHREQ_BONDING, 0x10, 0x00, SM_KEYDIST_ENC_KEY};
+        memcpy(multi_link_links[i].preq, pairing_request, 7);
+        mock_simulate_sm_data_packet_for_handle(multi_link_links[i].con_handle, pairing_request, sizeof(pairing_request));
+    }
+
+    multi_link_process(10000);
+
+    CHECK_EQUAL(MULTI_LINK_NUM_LINKS, multi_link_num_complete);
+    for (i=0;i<MULTI_LINK_NUM_LINKS;i++){
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, multi_link_links[i].status);
+    }
+    // pairings have been performed concurrently, limited by number of setup contexts
+    CHECK_EQUAL(MAX_NR_SM_SETUP_CONTEXTS, multi_link_max_active);
+    mock_set_packet_handler(NULL);
+}
+
 int main (int argc, const char * argv[]){
     // log into file using HCI_DUMP_PACKETLOGGER format
     const char * log_path = "hci_dump.pklg";
@@ -10,11 +10,24 @@
 #include "btstack_config.h"
 #include "btstack_debug.h"
 #include <unistd.h>
+#include <sys/stat.h>
 
 #define TEST_DB "/tmp/test.tlv"
 
 #define TAG(a,b,c,d) ( ((a)<<24) | ((b)<<16) | ((c)<<8) | (d) )
 
+static uint32_t iterated_tags[10];
+static uint32_t iterated_sizes[10];
+static int      num_iterated_tags;
+
+static bool iterate_callback(void * context, uint32_t tag, uint32_t value_size){
+	int * max_tags = (int *) context;
+	iterated_tags[num_iterated_tags] = tag;
+	iterated_sizes[num_iterated_tags] = value_size;
+	num_iterated_tags++;
+	return num_iterated_tags < *max_tags;
+}
+
 /// TLV
 TEST_GROUP(BSTACK_TLV){
 	const btstack_tlv_t * btstack_tlv_impl;
@@ -184,6 +197,130 @@ TEST(BSTACK_TLV, TestWriteDeleteResetReadDeleteRead){
     CHECK_EQUAL(size, 0);
 }
 
+TEST(BSTACK_TLV, TestIterateTags){
+	uint8_t data[4] = { 1, 2, 3, 4 };
+	int max_tags = 10;
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, TAG('B','T','D', 0), data, 1);
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, TAG('B','T','D', 5), data, 2);
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, TAG('B','T','D', 7), data, 3);
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, TAG('B','T','L', 0), data, 4);
+	btstack_tlv_impl->delete_tag(&btstack_tlv_context, TAG('B','T','D', 7));
+
+	reopen_db();
+
+	num_iterated_tags = 0;
+	btstack_tlv_iterate_tags(btstack_tlv_impl, &btstack_tlv_context, TAG('B','T','D', 0), TAG('B','T','D', 0xff), &iterate_callback, &max_tags);
+	CHECK_EQUAL(2, num_iterated_tags);
+	int i;
+	for (i=0;i<num_iterated_tags;i++){
+		if (iterated_tags[i] == TAG('B','T','D', 0)){
+			CHECK_EQUAL(1, iterated_sizes[i]);
+		} else {
+			CHECK_EQUAL(TAG('B','T','D', 5), iterated_tags[i]);
+			CHECK_EQUAL(2, iterated_sizes[i]);
+		}
+	}
+
+	// stop after first tag
+	max_tags = 1;
+	num_iterated_tags = 0;
+	btstack_tlv_iterate_tags(btstack_tlv_impl, &btstack_tlv_context, TAG('B','T','D', 0), TAG('B','T','L', 0xff), &iterate_callback, &max_tags);
+	CHECK_EQUAL(1, num_iterated_tags);
+}
+
+TEST(BSTACK_TLV, TestIterateTagsFallback){
+	uint8_t data[4] = { 1, 2, 3, 4 };
+	int max_tags = 10;
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, TAG('B','T','D', 0), data, 1);
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, TAG('B','T','D', 5), data, 2);
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, TAG('B','T','L', 0), data, 4);
+
+	// TLV implementation without iterate_tags
+	btstack_tlv_t btstack_tlv_without_iterate = *btstack_tlv_impl;
+	btstack_tlv_without_iterate.iterate_tags = NULL;
+
+	num_iterated_tags = 0;
+	btstack_tlv_iterate_tags(&btstack_tlv_without_iterate, &btstack_tlv_context, TAG('B','T','D', 0), TAG('B','T','D', 0xff), &iterate_callback, &max_tags);
+	CHECK_EQUAL(2, num_iterated_tags);
+	CHECK_EQUAL(TAG('B','T','D', 0), iterated_tags[0]);
+	CHECK_EQUAL(1, iterated_sizes[0]);
+	CHECK_EQUAL(TAG('B','T','D', 5), iterated_tags[1]);
+	CHECK_EQUAL(2, iterated_sizes[1]);
+
+	// range including highest tag
+	num_iterated_tags = 0;
+	btstack_tlv_iterate_tags(&btstack_tlv_without_iterate, &btstack_tlv_context, 0xfffffff0, 0xffffffff, &iterate_callback, &max_tags);
+	CHECK_EQUAL(0, num_iterated_tags);
+}
+static long file_size(const char * path){
+	struct stat file_stat;
+	if (stat(path, &file_stat) != 0) return -1;
+	return (long) file_stat.st_size;
+}
+
+TEST(BSTACK_TLV, TestManyTags){
+	uint32_t i;
+	for (i=0;i<1000;i++){
+		btstack_tlv_impl->store_tag(&btstack_tlv_context, TAG('B','T', i >> 8, i & 0xff), (const uint8_t *) &i, sizeof(i));
+	}
+	for (i=0;i<1000;i+=2){
+		btstack_tlv_impl->delete_tag(&btstack_tlv_context, TAG('B','T', i >> 8, i & 0xff));
+	}
+	reopen_db();
+	for (i=0;i<1000;i++){
+		uint32_t value = 0;
+		int size = btstack_tlv_impl->get_tag(&btstack_tlv_context, TAG('B','T', i >> 8, i & 0xff), (uint8_t *) &value, sizeof(value));
+		if ((i & 1) == 0){
+			CHECK_EQUAL(0, size);
+		} else {
+			CHECK_EQUAL(sizeof(value), size);
+			CHECK_EQUAL(i, value);
+		}
+	}
+}
+
+TEST(BSTACK_TLV, TestCompaction){
+	uint8_t data[1000];
+	uint8_t buffer[1000];
+	memset(data, 0x55, sizeof(data));
+	uint32_t tag_a = TAG('a','a','a','a');
+	uint32_t tag_b = TAG('b','b','b','b');
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, tag_b, data, 10);
+	// overwrite tag a until garbage exceeds threshold, file is compacted on the way
+	int i;
+	for (i=0;i<100;i++){
+		data[0] = (uint8_t) i;
+		btstack_tlv_impl->store_tag(&btstack_tlv_context, tag_a, data, sizeof(data));
+	}
+	CHECK(file_size(TEST_DB) < 40000);
+	CHECK_EQUAL(-1, file_size(TEST_DB ".tmp"));
+
+	// append after compaction
+	data[0] = 0xaa;
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, tag_a, data, sizeof(data));
+
+	reopen_db();
+	CHECK_EQUAL(sizeof(data), btstack_tlv_impl->get_tag(&btstack_tlv_context, tag_a, buffer, sizeof(buffer)));
+	CHECK_EQUAL(0xaa, buffer[0]);
+	CHECK_EQUAL(10, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag_b, buffer, sizeof(buffer)));
+}
+
+TEST(BSTACK_TLV, TestTruncatedEntry){
+	uint32_t tag = TAG('a','b','c','d');
+	uint8_t  data = 7;
+	uint8_t  buffer = 0;
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, tag, &data, 1);
+
+	// simulate crash while appending entry
+	uint8_t partial_entry[6] = { 'a', 'b', 'c', 'e', 0, 0 };
+	fwrite(partial_entry, 1, sizeof(partial_entry), btstack_tlv_context.file);
+	fflush(btstack_tlv_context.file);
+
+	reopen_db();
+	CHECK_EQUAL(1, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag, &buffer, 1));
+	CHECK_EQUAL(data, buffer);
+	CHECK_EQUAL(8 + 8 + 1, file_size(TEST_DB));
+}
 
 int main (int argc, const char * argv[]){
     // log into file using HCI_DUMP_PACKETLOGGER format
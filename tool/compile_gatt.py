@@ -72,7 +72,8 @@ assigned_uuids = {
     'GAP_RECONNECTION_ADDRESS'    : 0x2A03,
     'GAP_PERIPHERAL_PREFERRED_CONNECTION_PARAMETERS' : 0x2A04,
     'GATT_SERVICE_CHANGED' : 0x2a05,
-    'GATT_DATABASE_HASH' : 0x2b2a
+    'GATT_DATABASE_HASH' : 0x2b2a,
+    'GATT_CLIENT_SUPPORTED_FEATURES' : 0x2b29
 }
 
 security_permsission = ['ANYBODY','ENCRYPTED', 'AUTHENTICATED', 'AUTHORIZED', 'AUTHENTICATED_SC']
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+#
+# Generate src/classic/hfp_at_command_trie.h: tries for the AT commands and result codes
+# recognized by the HFP AG and HF roles, used by parse_command() in src/classic/hfp.c
+#
+# Usage: ./hfp_at_command_trie_generator.py
+#
+
+import os
+import sys
+
+copyright = """/*
+ * Copyright (C) 2022 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+"""
+
+header_begin = """
+/*
+ * hfp_at_command_trie.h
+ *
+ * @brief Tries for AT commands (AG) and result codes (HF), included by hfp.c
+ *
+ * Generated by tool/hfp_at_command_trie_generator.py - do not edit
+ */
+
+#ifndef HFP_AT_COMMAND_TRIE_H
+#define HFP_AT_COMMAND_TRIE_H
+
+// children of a node are stored consecutively and sorted by character, node 0 is the root
+// command:        command id if the text ends at this node
+// prefix_command: command id if the text continues with a character that has no child
+typedef struct {
+    uint8_t character;
+    uint8_t first_child;
+    uint8_t num_children;
+    uint8_t command;
+    uint8_t prefix_command;
+} hfp_at_command_trie_node_t;
+
+#define HFP_AT_COMMAND_TRIE_NO_COMMAND 0xff
+"""
+
+header_end = """
+#endif // HFP_AT_COMMAND_TRIE_H
+"""
+
+# exact matches, AG role
+ag_commands = [
+    ( "AT+BAC=",   "HFP_CMD_AVAILABLE_CODECS" ),
+    ( "AT+BCC",    "HFP_CMD_TRIGGER_CODEC_CONNECTION_SETUP" ),
+    ( "AT+BCS=",   "HFP_CMD_HF_CONFIRMED_CODEC" ),
+    ( "AT+BIA=",   "HFP_CMD_ENABLE_INDIVIDUAL_AG_INDICATOR_STATUS_UPDATE" ), # +BIA:<enabled>,,<enabled>,,,<enabled>
+    ( "AT+BIEV=",  "HFP_CMD_HF_INDICATOR_STATUS" ),
+    ( "AT+BIND=",  "HFP_CMD_LIST_GENERIC_STATUS_INDICATORS" ),
+    ( "AT+BIND=?", "HFP_CMD_RETRIEVE_GENERIC_STATUS_INDICATORS" ),
+    ( "AT+BIND?",  "HFP_CMD_RETRIEVE_GENERIC_STATUS_INDICATORS_STATE" ),
+    ( "AT+BINP=",  "HFP_CMD_HF_REQUEST_PHONE_NUMBER" ),
+    ( "AT+BLDN",   "HFP_CMD_REDIAL_LAST_NUMBER" ),
+    ( "AT+BRSF=",  "HFP_CMD_SUPPORTED_FEATURES" ),
+    ( "AT+BTRH=",  "HFP_CMD_RESPONSE_AND_HOLD_COMMAND" ),
+    ( "AT+BTRH?",  "HFP_CMD_RESPONSE_AND_HOLD_QUERY" ),
+    ( "AT+BVRA=",  "HFP_CMD_HF_ACTIVATE_VOICE_RECOGNITION" ),
+    ( "AT+CCWA=",  "HFP_CMD_ENABLE_CALL_WAITING_NOTIFICATION" ),
+    ( "AT+CHLD=",  "HFP_CMD_CALL_HOLD" ),
+    ( "AT+CHLD=?", "HFP_CMD_SUPPORT_CALL_HOLD_AND_MULTIPARTY_SERVICES" ),
+    ( "AT+CHUP",   "HFP_CMD_HANG_UP_CALL" ),
+    ( "AT+CIND=?", "HFP_CMD_RETRIEVE_AG_INDICATORS" ),
+    ( "AT+CIND?",  "HFP_CMD_RETRIEVE_AG_INDICATORS_STATUS" ),
+    ( "AT+CLCC",   "HFP_CMD_LIST_CURRENT_CALLS" ),
+    ( "AT+CLIP=",  "HFP_CMD_ENABLE_CLIP" ),
+    ( "AT+CMEE=",  "HFP_CMD_ENABLE_EXTENDED_AUDIO_GATEWAY_ERROR" ),
+    ( "AT+CMER=",  "HFP_CMD_ENABLE_INDICATOR_STATUS_UPDATE" ),
+    ( "AT+CNUM",   "HFP_CMD_GET_SUBSCRIBER_NUMBER_INFORMATION" ),
+    ( "AT+COPS=",  "HFP_CMD_QUERY_OPERATOR_SELECTION_NAME_FORMAT" ),
+    ( "AT+COPS?",  "HFP_CMD_QUERY_OPERATOR_SELECTION_NAME" ),
+    ( "AT+NREC=",  "HFP_CMD_TURN_OFF_EC_AND_NR" ),
+    ( "AT+VGM=",   "HFP_CMD_SET_MICROPHONE_GAIN" ),
+    ( "AT+VGS=",   "HFP_CMD_SET_SPEAKER_GAIN" ),
+    ( "AT+VTS=",   "HFP_CMD_TRANSMIT_DTMF_CODES" ),
+    ( "ATA",       "HFP_CMD_CALL_ANSWERED" ),
+]
+
+# prefix matches, AG role
+# note: phone number is expected in line_buffer[3..]
+ag_prefixes = [
+    ( "ATD",       "HFP_CMD_CALL_PHONE_NUMBER" ),
+    # valid looking, but unknown commands
+    ( "AT+",       "HFP_CMD_UNKNOWN" ),
+]
+
+# exact matches, HF role
+hf_commands = [
+    ( "+BCS:",  "HFP_CMD_AG_SUGGESTED_CODEC" ),
+    ( "+BIND:", "HFP_CMD_SET_GENERIC_STATUS_INDICATOR_STATUS" ),
+    ( "+BINP:", "HFP_CMD_AG_SENT_PHONE_NUMBER" ),
+    ( "+BRSF:", "HFP_CMD_SUPPORTED_FEATURES" ),
+    ( "+BSIR:", "HFP_CMD_CHANGE_IN_BAND_RING_TONE_SETTING" ),
+    ( "+BTRH:", "HFP_CMD_RESPONSE_AND_HOLD_STATUS" ),
+    ( "+BVRA:", "HFP_CMD_AG_ACTIVATE_VOICE_RECOGNITION" ),
+    ( "+CCWA:", "HFP_CMD_AG_SENT_CALL_WAITING_NOTIFICATION_UPDATE" ),
+    ( "+CHLD:", "HFP_CMD_SUPPORT_CALL_HOLD_AND_MULTIPARTY_SERVICES" ),
+    ( "+CIEV:", "HFP_CMD_TRANSFER_AG_INDICATOR_STATUS" ),
+    ( "+CIND:", "HFP_CMD_RETRIEVE_AG_INDICATORS_GENERIC" ),
+    ( "+CLCC:", "HFP_CMD_LIST_CURRENT_CALLS" ),
+    ( "+CLIP:", "HFP_CMD_AG_SENT_CLIP_INFORMATION" ),
+    ( "+CME ERROR:", "HFP_CMD_EXTENDED_AUDIO_GATEWAY_ERROR" ),
+    ( "+CNUM:", "HFP_CMD_GET_SUBSCRIBER_NUMBER_INFORMATION" ),
+    ( "+COPS:", "HFP_CMD_QUERY_OPERATOR_SELECTION_NAME" ),
+    ( "+VGM:",  "HFP_CMD_SET_MICROPHONE_GAIN" ),
+    ( "+VGM=",  "HFP_CMD_SET_MICROPHONE_GAIN" ),
+    ( "+VGS:",  "HFP_CMD_SET_SPEAKER_GAIN" ),
+    ( "+VGS=",  "HFP_CMD_SET_SPEAKER_GAIN" ),
+    ( "ERROR",  "HFP_CMD_ERROR" ),
+    ( "NOP",    "HFP_CMD_NONE" ), # dummy command used by unit tests
+    ( "OK",     "HFP_CMD_OK" ),
+    ( "RING",   "HFP_CMD_RING" ),
+]
+
+# prefix matches, HF role
+hf_prefixes = [
+    # valid looking, but unknown result codes
+    ( "+",      "HFP_CMD_UNKNOWN" ),
+]
+
+class Node:
+    def __init__(self, character):
+        self.character = character
+        self.children = {}
+        self.command = None
+        self.prefix_command = None
+        self.index = 0
+
+def build_trie(commands, prefixes):
+    root = Node(None)
+    for (entries, is_prefix) in [(commands, False), (prefixes, True)]:
+        for (text, command) in entries:
+            node = root
+            for character in text:
+                node = node.children.setdefault(character, Node(character))
+            if is_prefix:
+                node.prefix_command = command
+            else:
+                node.command = command
+    # breadth-first order keeps children of a node consecutive
+    nodes = [root]
+    pos = 0
+    while pos < len(nodes):
+        node = nodes[pos]
+        for character in sorted(node.children):
+            nodes.append(node.children[character])
+        pos += 1
+    for (index, node) in enumerate(nodes):
+        node.index = index
+    if len(nodes) > 255:
+        print("Trie with %u nodes exceeds uint8_t index" % len(nodes))
+        sys.exit(1)
+    return nodes
+
+def format_character(character):
+    if character is None:
+        return "  0"
+    if character in "'\\":
+        return "'\\%s'" % character
+    return "'%s'" % character
+
+def write_trie(f, name, nodes):
+    f.write("\n// %u nodes\n" % len(nodes))
+    f.write("static const hfp_at_command_trie_node_t %s[] = {\n" % name)
+    for node in nodes:
+        children = [node.children[c] for c in sorted(node.children)]
+        first_child = children[0].index if children else 0
+        command = node.command if node.command else "HFP_AT_COMMAND_TRIE_NO_COMMAND"
+        prefix_command = node.prefix_command if node.prefix_command else "HFP_AT_COMMAND_TRIE_NO_COMMAND"
+        f.write("    { %s, %3u, %2u, %s, %s },\n" % (format_character(node.character), first_child, len(children), command, prefix_command))
+    f.write("};\n")
+
+if __name__ == "__main__":
+    btstack_root = os.path.abspath(os.path.dirname(sys.argv[0]) + '/..')
+    output_file = btstack_root + "/src/classic/hfp_at_command_trie.h"
+    with open(output_file, "wt") as f:
+        f.write(copyright)
+        f.write(header_begin)
+        write_trie(f, "hfp_ag_command_trie", build_trie(ag_commands, ag_prefixes))
+        write_trie(f, "hfp_hf_command_trie", build_trie(hf_commands, hf_prefixes))
+        f.write(header_end)
+    print("Generated %s" % output_file)